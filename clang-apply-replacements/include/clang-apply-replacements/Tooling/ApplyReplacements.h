@@ -50,6 +50,9 @@ typedef llvm::DenseMap<const clang::FileEntry *,
 /// TranslationUnitReplacements. All docs that successfully deserialize are
 /// added to \p TUs.
 ///
+/// A file may hold several YAML documents, e.g. the change descriptions of a
+/// whole run concatenated together. Files are read in parallel.
+///
 /// Directories starting with '.' are ignored during traversal.
 ///
 /// \param[in] Directory Directory to begin search for serialized
@@ -92,6 +95,8 @@ bool mergeAndDeduplicate(const TUReplacements &TUs, const TUDiagnostics &TUDs,
 
 /// \brief Apply \c AtomicChange on File and rewrite it.
 ///
+/// Changes to different files can be applied concurrently.
+///
 /// \param[in] File Path of the file where to apply AtomicChange.
 /// \param[in] Changes to apply.
 /// \param[in] Spec For code cleanup and formatting.
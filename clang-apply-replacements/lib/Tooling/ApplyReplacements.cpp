@@ -25,7 +25,9 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <iterator>
 
 using namespace llvm;
 using namespace clang;
@@ -35,57 +37,35 @@ static void eatDiagnostics(const SMDiagnostic &, void *) {}
 namespace clang {
 namespace replace {
 
-std::error_code collectReplacementsFromDirectory(
-    const llvm::StringRef Directory, TUReplacements &TUs,
-    TUReplacementFiles &TUFiles, clang::DiagnosticsEngine &Diagnostics) {
-  using namespace llvm::sys::fs;
-  using namespace llvm::sys::path;
-
-  std::error_code ErrorCode;
-
-  for (recursive_directory_iterator I(Directory, ErrorCode), E;
-       I != E && !ErrorCode; I.increment(ErrorCode)) {
-    if (filename(I->path())[0] == '.') {
-      // Indicate not to descend into directories beginning with '.'
-      I.no_push();
-      continue;
-    }
-
-    if (extension(I->path()) != ".yaml")
-      continue;
-
-    TUFiles.push_back(I->path());
-
-    ErrorOr<std::unique_ptr<MemoryBuffer>> Out =
-        MemoryBuffer::getFile(I->path());
-    if (std::error_code BufferError = Out.getError()) {
-      errs() << "Error reading " << I->path() << ": " << BufferError.message()
-             << "\n";
-      continue;
-    }
-
-    yaml::Input YIn(Out.get()->getBuffer(), nullptr, &eatDiagnostics);
-    tooling::TranslationUnitReplacements TU;
+/// \brief Deserializes every document of \p Buffer as a \c TUType. Files may
+/// hold several documents so that all the fixes of a run can be exported into
+/// a single stream. Reading stops at the first document that doesn't parse.
+template <typename TUType>
+static std::vector<TUType> parseTUs(llvm::StringRef Buffer) {
+  std::vector<TUType> TUs;
+  yaml::Input YIn(Buffer, nullptr, &eatDiagnostics);
+  do {
+    TUType TU;
     YIn >> TU;
     if (YIn.error()) {
-      // File doesn't appear to be a header change description. Ignore it.
-      continue;
+      // Document doesn't appear to be a change description. Ignore it.
+      break;
     }
-
-    // Only keep files that properly parse.
-    TUs.push_back(TU);
-  }
-
-  return ErrorCode;
+    // Only keep documents that properly parse.
+    TUs.push_back(std::move(TU));
+  } while (YIn.nextDocument());
+  return TUs;
 }
 
-std::error_code collectReplacementsFromDirectory(
-    const llvm::StringRef Directory, TUDiagnostics &TUs,
-    TUReplacementFiles &TUFiles, clang::DiagnosticsEngine &Diagnostics) {
+template <typename TUType>
+static std::error_code
+collectFromDirectory(const llvm::StringRef Directory, std::vector<TUType> &TUs,
+                     TUReplacementFiles &TUFiles) {
   using namespace llvm::sys::fs;
   using namespace llvm::sys::path;
 
   std::error_code ErrorCode;
+  std::vector<std::string> Files;
 
   for (recursive_directory_iterator I(Directory, ErrorCode), E;
        I != E && !ErrorCode; I.increment(ErrorCode)) {
@@ -98,31 +78,53 @@ std::error_code collectReplacementsFromDirectory(
     if (extension(I->path()) != ".yaml")
       continue;
 
-    TUFiles.push_back(I->path());
+    Files.push_back(I->path());
+  }
 
-    ErrorOr<std::unique_ptr<MemoryBuffer>> Out =
-        MemoryBuffer::getFile(I->path());
-    if (std::error_code BufferError = Out.getError()) {
-      errs() << "Error reading " << I->path() << ": " << BufferError.message()
-             << "\n";
-      continue;
-    }
+  // Files are parsed in parallel. Each one gets its own slot, so that the
+  // result keeps the order of the traversal.
+  std::vector<std::vector<TUType>> ParsedTUs(Files.size());
+  std::vector<std::error_code> ReadErrors(Files.size());
+  {
+    llvm::ThreadPool Pool;
+    for (size_t I = 0; I < Files.size(); ++I)
+      Pool.async([&, I] {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> Out =
+            MemoryBuffer::getFile(Files[I]);
+        if (!Out) {
+          ReadErrors[I] = Out.getError();
+          return;
+        }
+        ParsedTUs[I] = parseTUs<TUType>(Out.get()->getBuffer());
+      });
+  }
 
-    yaml::Input YIn(Out.get()->getBuffer(), nullptr, &eatDiagnostics);
-    tooling::TranslationUnitDiagnostics TU;
-    YIn >> TU;
-    if (YIn.error()) {
-      // File doesn't appear to be a header change description. Ignore it.
+  for (size_t I = 0; I < Files.size(); ++I) {
+    TUFiles.push_back(Files[I]);
+    if (ReadErrors[I]) {
+      errs() << "Error reading " << Files[I] << ": " << ReadErrors[I].message()
+             << "\n";
       continue;
     }
-
-    // Only keep files that properly parse.
-    TUs.push_back(TU);
+    std::move(ParsedTUs[I].begin(), ParsedTUs[I].end(),
+              std::back_inserter(TUs));
   }
 
   return ErrorCode;
 }
 
+std::error_code collectReplacementsFromDirectory(
+    const llvm::StringRef Directory, TUReplacements &TUs,
+    TUReplacementFiles &TUFiles, clang::DiagnosticsEngine &Diagnostics) {
+  return collectFromDirectory(Directory, TUs, TUFiles);
+}
+
+std::error_code collectReplacementsFromDirectory(
+    const llvm::StringRef Directory, TUDiagnostics &TUs,
+    TUReplacementFiles &TUFiles, clang::DiagnosticsEngine &Diagnostics) {
+  return collectFromDirectory(Directory, TUs, TUFiles);
+}
+
 /// \brief Extract replacements from collected TranslationUnitReplacements and
 /// TranslationUnitDiagnostics and group them per file. Identical replacements
 /// from diagnostics are deduplicated.
@@ -228,11 +230,12 @@ llvm::Expected<std::string>
 applyChanges(StringRef File, const std::vector<tooling::AtomicChange> &Changes,
              const tooling::ApplyChangesSpec &Spec,
              DiagnosticsEngine &Diagnostics) {
+  // No SourceManager here: it would register itself with the shared
+  // DiagnosticsEngine, and changes are applied to several files in parallel.
   FileManager Files((FileSystemOptions()));
-  SourceManager SM(Diagnostics, Files);
 
   llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
-      SM.getFileManager().getBufferForFile(File);
+      Files.getBufferForFile(File);
   if (!Buffer)
     return errorCodeToError(Buffer.getError());
   return tooling::applyAtomicChanges(File, Buffer.get()->getBuffer(), Changes,
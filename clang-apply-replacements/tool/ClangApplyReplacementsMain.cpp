@@ -20,8 +20,12 @@
 #include "clang/Format/Format.h"
 #include "clang/Rewrite/Core/Rewriter.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 
 using namespace llvm;
 using namespace clang;
@@ -42,6 +46,12 @@ static cl::opt<bool> RemoveTUReplacementFiles(
              "merging/replacing."),
     cl::init(false), cl::cat(ReplacementCategory));
 
+static cl::opt<unsigned> Jobs(
+    "j",
+    cl::desc("Number of files to apply the changes to in parallel.\n"
+             "0 uses all cores."),
+    cl::init(0), cl::cat(ReplacementCategory));
+
 static cl::opt<bool> DoFormat(
     "format",
     cl::desc("Enable formatting of code changed by applying replacements.\n"
@@ -81,6 +91,42 @@ private:
 };
 } // namespace
 
+/// Writes \p Contents to a temporary file renamed to \p Path, so that \p Path
+/// is never left partially written.
+static std::error_code writeFileAtomically(StringRef Path, StringRef Contents) {
+  // Renaming over a symlink would replace it, write to the file it points to.
+  SmallString<256> RealPath;
+  if (std::error_code EC = llvm::sys::fs::real_path(Path, RealPath))
+    return EC;
+  StringRef File = RealPath;
+  llvm::ErrorOr<llvm::sys::fs::perms> Perms =
+      llvm::sys::fs::getPermissions(File);
+  int FD;
+  SmallString<256> TempPath;
+  if (std::error_code EC = llvm::sys::fs::createUniqueFile(
+          File + "-%%%%%%%%.tmp", FD, TempPath))
+    return EC;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Contents;
+    OS.close();
+    if (std::error_code EC = OS.error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return EC;
+    }
+  }
+  // The temporary file is only accessible by its owner, keep the permissions
+  // of the file being replaced.
+  if (Perms)
+    llvm::sys::fs::setPermissions(TempPath, *Perms);
+  if (std::error_code EC = llvm::sys::fs::rename(TempPath, File)) {
+    llvm::sys::fs::remove(TempPath);
+    return EC;
+  }
+  return std::error_code();
+}
+
 static void printVersion(raw_ostream &OS) {
   OS << "clang-apply-replacements version " CLANG_VERSION_STRING << "\n";
 }
@@ -140,25 +186,42 @@ int main(int argc, char **argv) {
   Spec.Format = DoFormat ? tooling::ApplyChangesSpec::kAll
                          : tooling::ApplyChangesSpec::kNone;
 
-  for (const auto &FileChange : Changes) {
-    const FileEntry *Entry = FileChange.first;
-    StringRef FileName = Entry->getName();
-    llvm::Expected<std::string> NewFileData =
-        applyChanges(FileName, FileChange.second, Spec, Diagnostics);
-    if (!NewFileData) {
-      errs() << llvm::toString(NewFileData.takeError()) << "\n";
-      continue;
-    }
-
-    // Write new file to disk
-    std::error_code EC;
-    llvm::raw_fd_ostream FileStream(FileName, EC, llvm::sys::fs::F_None);
-    if (EC) {
-      llvm::errs() << "Could not open " << FileName << " for writing\n";
-      continue;
-    }
-    FileStream << *NewFileData;
+  // Files are independent, the changes are applied to them in parallel. Each
+  // file is read, changed and written by a single task so that only the
+  // buffers of the files being processed are kept in memory. Errors are
+  // reported afterwards in a deterministic order.
+  typedef std::pair<StringRef, const std::vector<tooling::AtomicChange> *>
+      FileAndChanges;
+  std::vector<FileAndChanges> FileChanges;
+  for (const auto &FileChange : Changes)
+    FileChanges.emplace_back(FileChange.first->getName(), &FileChange.second);
+  llvm::sort(FileChanges.begin(), FileChanges.end(),
+             [](const FileAndChanges &LHS, const FileAndChanges &RHS) {
+               return LHS.first < RHS.first;
+             });
+  std::vector<std::string> Errors(FileChanges.size());
+  {
+    llvm::ThreadPool Pool(Jobs == 0 ? llvm::hardware_concurrency()
+                                    : unsigned(Jobs));
+    for (size_t I = 0; I < FileChanges.size(); ++I)
+      Pool.async([&, I] {
+        StringRef FileName = FileChanges[I].first;
+        llvm::Expected<std::string> NewFileData =
+            applyChanges(FileName, *FileChanges[I].second, Spec, Diagnostics);
+        if (!NewFileData) {
+          Errors[I] = llvm::toString(NewFileData.takeError());
+          return;
+        }
+
+        // Write new file to disk
+        if (writeFileAtomically(FileName, *NewFileData))
+          Errors[I] = ("Could not open " + FileName + " for writing").str();
+      });
   }
 
+  for (const std::string &Error : Errors)
+    if (!Error.empty())
+      errs() << Error << "\n";
+
   return 0;
 }
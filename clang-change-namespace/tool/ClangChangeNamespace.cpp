@@ -29,6 +29,9 @@
 //    } // namespace x
 
 #include "ChangeNamespace.h"
+#include "FS.h"
+#include "index/FileRefs.h"
+#include "index/Serialization.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
@@ -38,7 +41,11 @@
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/YAMLTraits.h"
+#include <mutex>
+#include <set>
 
 using namespace clang;
 using namespace llvm;
@@ -78,6 +85,51 @@ cl::opt<std::string> WhiteListFile(
              "to be updated when changing namespaces around them."),
     cl::init(""), cl::cat(ChangeNamespaceCategory));
 
+cl::opt<std::string> IndexFile(
+    "index_file",
+    cl::desc("A clangd static index of the code base. If specified, only the "
+             "given files referencing symbols of the old namespace (or "
+             "sharing the stem of a header that does) are processed."),
+    cl::init(""), cl::cat(ChangeNamespaceCategory));
+
+cl::opt<unsigned> Jobs(
+    "j",
+    cl::desc("Number of files to process in parallel. 0 uses all cores."),
+    cl::init(1), cl::cat(ChangeNamespaceCategory));
+
+cl::opt<bool> CacheFiles(
+    "cache_files",
+    cl::desc("Read each file once for the whole run, instead of once per "
+             "processed file including it. Files are assumed not to change "
+             "during the run."),
+    cl::cat(ChangeNamespaceCategory));
+
+// Returns the files of \p Files that the index says may refer to the old
+// namespace, or \p Files itself if the index cannot tell.
+std::vector<std::string>
+FilterFilesByIndex(const std::vector<std::string> &Files) {
+  std::unique_ptr<clangd::SymbolIndex> Index = clangd::loadIndex(IndexFile);
+  if (!Index) {
+    llvm::errs() << "Failed to load index " << IndexFile
+                 << ". Processing all files.\n";
+    return Files;
+  }
+  std::string Scope = (StringRef(OldNamespace).ltrim(':') + "::").str();
+  llvm::DenseSet<clangd::SymbolID> IDs;
+  clangd::FuzzyFindRequest Req;
+  Req.AnyScope = true;
+  Index->fuzzyFind(Req, [&](const clangd::Symbol &S) {
+    if (S.Scope.startswith(Scope))
+      IDs.insert(S.ID);
+  });
+  if (IDs.empty()) {
+    llvm::errs() << "No symbol of " << OldNamespace
+                 << " found in the index. Processing all files.\n";
+    return Files;
+  }
+  return clangd::filterReferencingFiles(*Index, IDs, Files);
+}
+
 llvm::ErrorOr<std::vector<std::string>> GetWhiteListedSymbolPatterns() {
   std::vector<std::string> Patterns;
   if (WhiteListFile.empty())
@@ -95,13 +147,71 @@ llvm::ErrorOr<std::vector<std::string>> GetWhiteListedSymbolPatterns() {
   return Patterns;
 }
 
+// Runs the tool over \p Files on a thread pool, each file with its own
+// ChangeNamespaceTool, and merges their replacements into
+// \p FileToReplacements. With -cache_files, the files read are shared by all
+// of the tools. Headers get the same replacements from every file
+// including them, so identical replacements are only kept once.
+int RunInParallel(
+    const tooling::CompilationDatabase &Compilations,
+    llvm::ArrayRef<std::string> Files,
+    llvm::ArrayRef<std::string> WhiteListPatterns,
+    std::map<std::string, tooling::Replacements> &FileToReplacements) {
+  clangd::SharedFileContentCache FileCache;
+  IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS =
+      CacheFiles ? FileCache.getFS(llvm::vfs::getRealFileSystem())
+                 : llvm::vfs::getRealFileSystem();
+  std::mutex Mutex;
+  std::map<std::string, std::set<tooling::Replacement>> Merged;
+  int Status = 0;
+  {
+    llvm::ThreadPool Pool(Jobs == 0 ? llvm::hardware_concurrency()
+                                    : unsigned(Jobs));
+    for (size_t I = 0; I < Files.size(); ++I)
+      Pool.async([&, I] {
+        std::map<std::string, tooling::Replacements> Replacements;
+        change_namespace::ChangeNamespaceTool NamespaceTool(
+            OldNamespace, NewNamespace, FilePattern, WhiteListPatterns,
+            &Replacements, Style);
+        ast_matchers::MatchFinder Finder;
+        NamespaceTool.registerMatchers(&Finder);
+        std::unique_ptr<tooling::FrontendActionFactory> Factory =
+            tooling::newFrontendActionFactory(&Finder);
+        tooling::ClangTool Tool(Compilations, Files[I],
+                                std::make_shared<PCHContainerOperations>(), FS);
+        int Result = Tool.run(Factory.get());
+
+        std::lock_guard<std::mutex> Lock(Mutex);
+        if (Result)
+          Status = Result;
+        for (const auto &FileAndReplaces : Replacements)
+          Merged[FileAndReplaces.first].insert(FileAndReplaces.second.begin(),
+                                               FileAndReplaces.second.end());
+      });
+  }
+
+  for (const auto &FileAndReplaces : Merged) {
+    tooling::Replacements &Replaces = FileToReplacements[FileAndReplaces.first];
+    for (const tooling::Replacement &R : FileAndReplaces.second) {
+      if (auto Err = Replaces.add(R)) {
+        llvm::errs() << "Conflicting replacements in " << FileAndReplaces.first
+                     << ": " << llvm::toString(std::move(Err)) << "\n";
+        Status = 1;
+      }
+    }
+  }
+  return Status;
+}
+
 } // anonymous namespace
 
 int main(int argc, const char **argv) {
   llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
   tooling::CommonOptionsParser OptionsParser(argc, argv,
                                              ChangeNamespaceCategory);
-  const auto &Files = OptionsParser.getSourcePathList();
+  std::vector<std::string> Files = OptionsParser.getSourcePathList();
+  if (!IndexFile.empty())
+    Files = FilterFilesByIndex(Files);
   tooling::RefactoringTool Tool(OptionsParser.getCompilations(), Files);
   llvm::ErrorOr<std::vector<std::string>> WhiteListPatterns =
       GetWhiteListedSymbolPatterns();
@@ -110,16 +220,24 @@ int main(int argc, const char **argv) {
                  << WhiteListPatterns.getError().message() << "\n";
     return 1;
   }
-  change_namespace::ChangeNamespaceTool NamespaceTool(
-      OldNamespace, NewNamespace, FilePattern, *WhiteListPatterns,
-      &Tool.getReplacements(), Style);
-  ast_matchers::MatchFinder Finder;
-  NamespaceTool.registerMatchers(&Finder);
-  std::unique_ptr<tooling::FrontendActionFactory> Factory =
-      tooling::newFrontendActionFactory(&Finder);
-
-  if (int Result = Tool.run(Factory.get()))
-    return Result;
+  // RefactoringTool can't take a file system, so runs with a file cache go
+  // through RunInParallel too, on a single thread with -j1.
+  if (Jobs != 1 || CacheFiles) {
+    if (int Result = RunInParallel(OptionsParser.getCompilations(), Files,
+                                   *WhiteListPatterns, Tool.getReplacements()))
+      return Result;
+  } else {
+    change_namespace::ChangeNamespaceTool NamespaceTool(
+        OldNamespace, NewNamespace, FilePattern, *WhiteListPatterns,
+        &Tool.getReplacements(), Style);
+    ast_matchers::MatchFinder Finder;
+    NamespaceTool.registerMatchers(&Finder);
+    std::unique_ptr<tooling::FrontendActionFactory> Factory =
+        tooling::newFrontendActionFactory(&Finder);
+
+    if (int Result = Tool.run(Factory.get()))
+      return Result;
+  }
   LangOptions DefaultLangOptions;
   IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
   clang::TextDiagnosticPrinter DiagnosticPrinter(errs(), &*DiagOpts);
@@ -61,12 +61,10 @@ static void SymbolIDAbbrev(std::shared_ptr<llvm::BitCodeAbbrev> &Abbrev) {
                                    BitCodeConstants::USRBitLengthSize)});
 }
 
+// The blob carries its own length.
 static void StringAbbrev(std::shared_ptr<llvm::BitCodeAbbrev> &Abbrev) {
   AbbrevGen(Abbrev,
-            {// 0. Fixed-size integer (length of the following string)
-             llvm::BitCodeAbbrevOp(llvm::BitCodeAbbrevOp::Fixed,
-                                   BitCodeConstants::StringLengthSize),
-             // 1. The string blob
+            {// 0. The string blob
              llvm::BitCodeAbbrevOp(llvm::BitCodeAbbrevOp::Blob)});
 }
 
@@ -77,10 +75,7 @@ static void LocationAbbrev(std::shared_ptr<llvm::BitCodeAbbrev> &Abbrev) {
       {// 0. Fixed-size integer (line number)
        llvm::BitCodeAbbrevOp(llvm::BitCodeAbbrevOp::Fixed,
                              BitCodeConstants::LineNumberSize),
-       // 1. Fixed-size integer (length of the following string (filename))
-       llvm::BitCodeAbbrevOp(llvm::BitCodeAbbrevOp::Fixed,
-                             BitCodeConstants::StringLengthSize),
-       // 2. The string blob
+       // 1. The string blob (filename)
        llvm::BitCodeAbbrevOp(llvm::BitCodeAbbrevOp::Blob)});
 }
 
@@ -242,26 +237,17 @@ void ClangDocBitcodeWriter::emitVersionBlock() {
   emitRecord(VersionNumber, VERSION);
 }
 
-/// \brief Emits a block ID and the block name to the BLOCKINFO block.
+/// \brief Emits a block ID to the BLOCKINFO block.
+///
+/// The names of the blocks and records aren't emitted: every serialized info
+/// carries its own BLOCKINFO block, and the names made up most of its size.
 void ClangDocBitcodeWriter::emitBlockID(BlockId BID) {
-  const auto &BlockIdName = BlockIdNameMap[BID];
-  assert(BlockIdName.data() && BlockIdName.size() && "Unknown BlockId.");
+  assert(BlockIdNameMap[BID].data() && BlockIdNameMap[BID].size() &&
+         "Unknown BlockId.");
 
   Record.clear();
   Record.push_back(BID);
   Stream.EmitRecord(llvm::bitc::BLOCKINFO_CODE_SETBID, Record);
-  Stream.EmitRecord(llvm::bitc::BLOCKINFO_CODE_BLOCKNAME,
-                    ArrayRef<unsigned char>(BlockIdName.bytes_begin(),
-                                            BlockIdName.bytes_end()));
-}
-
-/// \brief Emits a record name to the BLOCKINFO block.
-void ClangDocBitcodeWriter::emitRecordID(RecordId ID) {
-  assert(RecordIdNameMap[ID] && "Unknown RecordId.");
-  prepRecordData(ID);
-  Record.append(RecordIdNameMap[ID].Name.begin(),
-                RecordIdNameMap[ID].Name.end());
-  Stream.EmitRecord(llvm::bitc::BLOCKINFO_CODE_SETRECORDNAME, Record);
 }
 
 // Abbreviations
@@ -294,8 +280,6 @@ void ClangDocBitcodeWriter::emitRecord(llvm::StringRef Str, RecordId ID) {
          "Abbrev type mismatch.");
   if (!prepRecordData(ID, !Str.empty()))
     return;
-  assert(Str.size() < (1U << BitCodeConstants::StringLengthSize));
-  Record.push_back(Str.size());
   Stream.EmitRecordWithBlob(Abbrevs.get(ID), Record, Str);
 }
 
@@ -307,8 +291,6 @@ void ClangDocBitcodeWriter::emitRecord(const Location &Loc, RecordId ID) {
     return;
   // FIXME: Assert that the line number is of the appropriate size.
   Record.push_back(Loc.LineNumber);
-  assert(Loc.Filename.size() < (1U << BitCodeConstants::StringLengthSize));
-  Record.push_back(Loc.Filename.size());
   Stream.EmitRecordWithBlob(Abbrevs.get(ID), Record, Loc.Filename);
 }
 
@@ -365,10 +347,8 @@ void ClangDocBitcodeWriter::emitBlockInfo(BlockId BID,
                                           const std::vector<RecordId> &RIDs) {
   assert(RIDs.size() < (1U << BitCodeConstants::SubblockIDSize));
   emitBlockID(BID);
-  for (RecordId RID : RIDs) {
-    emitRecordID(RID);
+  for (RecordId RID : RIDs)
     emitAbbrev(RID, BID);
-  }
 }
 
 // Block emission
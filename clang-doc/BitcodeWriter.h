@@ -30,7 +30,7 @@ namespace doc {
 // Current version number of clang-doc bitcode.
 // Should be bumped when removing or changing BlockIds, RecordIds, or
 // BitCodeConstants, though they can be added without breaking it.
-static const unsigned VersionNumber = 2;
+static const unsigned VersionNumber = 3;
 
 struct BitCodeConstants {
   static constexpr unsigned RecordSize = 32U;
@@ -38,8 +38,6 @@ struct BitCodeConstants {
   static constexpr unsigned SubblockIDSize = 4U;
   static constexpr unsigned BoolSize = 1U;
   static constexpr unsigned IntSize = 16U;
-  static constexpr unsigned StringLengthSize = 16U;
-  static constexpr unsigned FilenameLengthSize = 16U;
   static constexpr unsigned LineNumberSize = 16U;
   static constexpr unsigned ReferenceTypeSize = 8U;
   static constexpr unsigned USRLengthSize = 6U;
@@ -177,7 +175,6 @@ private:
   // Emission of validation and overview blocks.
   void emitHeader();
   void emitVersionBlock();
-  void emitRecordID(RecordId ID);
   void emitBlockID(BlockId ID);
   void emitBlockInfoBlock();
   void emitBlockInfo(BlockId BID, const std::vector<RecordId> &RIDs);
@@ -195,8 +192,8 @@ private:
   // Emission of appropriate abbreviation type.
   void emitAbbrev(RecordId ID, BlockId Block);
 
-  // Static size is the maximum length of the block/record names we're pushing
-  // to this + 1. Longest is currently `MemberTypeBlock` at 15 chars.
+  // Static size fits the longest record we're pushing to this, currently a
+  // USR: its length followed by the 20 bytes of its hash.
   SmallVector<uint32_t, BitCodeConstants::RecordSize> Record;
   llvm::BitstreamWriter &Stream;
   AbbreviationMap Abbrevs;
@@ -13,6 +13,7 @@
 #include "clang/Index/USRGeneration.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
 
 using clang::comments::FullComment;
 
@@ -37,6 +38,21 @@ template <typename T> bool MapASTVisitor::mapDecl(const T *D) {
   if (index::generateUSRForDecl(D, USR))
     return true;
 
+  // A declaration at a given location has already been mapped if another
+  // translation unit included the same header.
+  if (CDCtx.MappedDecls) {
+    PresumedLoc Loc =
+        D->getASTContext().getSourceManager().getPresumedLoc(D->getLocation());
+    if (Loc.isValid()) {
+      llvm::SmallString<256> Key(USR);
+      llvm::raw_svector_ostream OS(Key);
+      OS << '\0' << Loc.getFilename() << ':' << Loc.getLine() << ':'
+         << Loc.getColumn();
+      if (!CDCtx.MappedDecls->claim(OS.str()))
+        return true;
+    }
+  }
+
   auto I = serialize::emitInfo(
       D, getComment(D, D->getASTContext()), getLine(D, D->getASTContext()),
       getFile(D, D->getASTContext()), CDCtx.PublicOnly);
@@ -20,7 +20,9 @@
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSet.h"
 #include <array>
+#include <mutex>
 #include <string>
 
 namespace clang {
@@ -42,12 +44,16 @@ enum class InfoType {
 };
 
 // A representation of a parsed comment.
+//
+// Every decl carries a tree of these, making them the most numerous objects of
+// the representation. Kind fits every comment kind name inline, and the lists
+// that are rarely filled take no inline space.
 struct CommentInfo {
   CommentInfo() = default;
   CommentInfo(CommentInfo &Other) = delete;
   CommentInfo(CommentInfo &&Other) = default;
 
-  SmallString<16>
+  SmallString<24>
       Kind; // Kind of comment (FullComment, ParagraphComment, TextComment,
             // InlineCommandComment, HTMLStartTagComment, HTMLEndTagComment,
             // BlockCommandComment, ParamCommandComment,
@@ -61,11 +67,11 @@ struct CommentInfo {
   bool SelfClosing = false;  // Indicates if tag is self-closing (for HTML).
   bool Explicit = false; // Indicates if the direction of a param is explicit
                          // (for (T)ParamCommand).
-  llvm::SmallVector<SmallString<16>, 4>
+  llvm::SmallVector<SmallString<16>, 0>
       AttrKeys; // List of attribute keys (for HTML).
-  llvm::SmallVector<SmallString<16>, 4>
+  llvm::SmallVector<SmallString<16>, 0>
       AttrValues; // List of attribute values for each key (for HTML).
-  llvm::SmallVector<SmallString<16>, 4>
+  llvm::SmallVector<SmallString<16>, 0>
       Args; // List of arguments to commands (for InlineCommand).
   std::vector<std::unique_ptr<CommentInfo>>
       Children; // List of child comments for this CommentInfo.
@@ -279,9 +285,28 @@ struct EnumInfo : public SymbolInfo {
 llvm::Expected<std::unique_ptr<Info>>
 mergeInfos(std::vector<std::unique_ptr<Info>> &Values);
 
+// Set of the declarations mapped by the translation units of a run.
+// Declarations of a header are visited by every translation unit including
+// it, but they serialize to the same info, so only the first one is reported.
+class MappedDeclSet {
+public:
+  // Returns true the first time a declaration is claimed.
+  bool claim(StringRef Key) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Keys.insert(Key).second;
+  }
+
+private:
+  std::mutex Mutex;
+  llvm::StringSet<> Keys;
+};
+
 struct ClangDocContext {
   tooling::ExecutionContext *ECtx;
   bool PublicOnly;
+  // Declarations already mapped, shared by the translation units. May be null,
+  // in which case every declaration visited is reported.
+  MappedDeclSet *MappedDecls;
 };
 
 } // namespace doc
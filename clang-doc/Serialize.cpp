@@ -52,6 +52,7 @@ private:
 void ClangDocCommentVisitor::parseComment(const comments::Comment *C) {
   CurrentCI.Kind = C->getCommentKindName();
   ConstCommentVisitor<ClangDocCommentVisitor>::visit(C);
+  CurrentCI.Children.reserve(C->child_count());
   for (comments::Comment *Child :
        llvm::make_range(C->child_begin(), C->child_end())) {
     CurrentCI.Children.emplace_back(llvm::make_unique<CommentInfo>());
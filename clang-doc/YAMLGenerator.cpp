@@ -124,7 +124,7 @@ static void SymbolInfoMapping(IO &IO, SymbolInfo &I) {
 }
 
 static void CommentInfoMapping(IO &IO, CommentInfo &I) {
-  IO.mapOptional("Kind", I.Kind, SmallString<16>());
+  IO.mapOptional("Kind", I.Kind, SmallString<24>());
   IO.mapOptional("Text", I.Text, SmallString<64>());
   IO.mapOptional("Name", I.Name, SmallString<16>());
   IO.mapOptional("Direction", I.Direction, SmallString<8>());
@@ -132,11 +132,11 @@ static void CommentInfoMapping(IO &IO, CommentInfo &I) {
   IO.mapOptional("CloseName", I.CloseName, SmallString<16>());
   IO.mapOptional("SelfClosing", I.SelfClosing, false);
   IO.mapOptional("Explicit", I.Explicit, false);
-  IO.mapOptional("Args", I.Args, llvm::SmallVector<SmallString<16>, 4>());
+  IO.mapOptional("Args", I.Args, llvm::SmallVector<SmallString<16>, 0>());
   IO.mapOptional("AttrKeys", I.AttrKeys,
-                 llvm::SmallVector<SmallString<16>, 4>());
+                 llvm::SmallVector<SmallString<16>, 0>());
   IO.mapOptional("AttrValues", I.AttrValues,
-                 llvm::SmallVector<SmallString<16>, 4>());
+                 llvm::SmallVector<SmallString<16>, 0>());
   IO.mapOptional("Children", I.Children);
 }
 
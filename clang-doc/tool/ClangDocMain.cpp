@@ -17,28 +17,40 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "../../sharded-executor/ShardedExecution.h"
 #include "BitcodeReader.h"
 #include "BitcodeWriter.h"
 #include "ClangDoc.h"
 #include "Generators.h"
 #include "Representation.h"
+#include "Serialize.h"
 #include "clang/AST/AST.h"
 #include "clang/AST/Decl.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/ASTMatchers/ASTMatchersInternal.h"
+#include "clang/Basic/Version.h"
 #include "clang/Driver/Options.h"
 #include "clang/Frontend/FrontendActions.h"
+#include "clang/Tooling/AllTUsExecution.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Execution.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <mutex>
 #include <string>
 
 using namespace clang::ast_matchers;
@@ -62,6 +74,34 @@ static llvm::cl::opt<bool> DoxygenOnly(
     llvm::cl::desc("Use only doxygen-style comments to generate docs."),
     llvm::cl::init(false), llvm::cl::cat(ClangDocCategory));
 
+static llvm::cl::opt<bool> Bundle(
+    "bundle",
+    llvm::cl::desc("Write the docs of all infos to a single file,\n"
+                   "<output>/docs.<format>, instead of one file per info."),
+    llvm::cl::init(false), llvm::cl::cat(ClangDocCategory));
+
+static llvm::cl::opt<bool> Incremental(
+    "incremental",
+    llvm::cl::desc("Only regenerate the docs of infos that changed since the\n"
+                   "last run with the same output directory. Hashes of the\n"
+                   "infos are stored in <output>/.clang-doc-hashes."),
+    llvm::cl::init(false), llvm::cl::cat(ClangDocCategory));
+
+static llvm::cl::opt<std::string> ShardOutput(
+    "shard-output",
+    llvm::cl::desc("Write the infos reduced by this run to this file, as\n"
+                   "bitcode, instead of generating docs. Runs over shards\n"
+                   "of a project, e.g. with --executor=sharded, write these\n"
+                   "files, and --merge-dir generates the docs from them."),
+    llvm::cl::init(""), llvm::cl::cat(ClangDocCategory));
+
+static llvm::cl::opt<std::string> MergeDir(
+    "merge-dir",
+    llvm::cl::desc("Generate the docs of the infos in the files of this\n"
+                   "directory, written with --shard-output, instead of\n"
+                   "running over sources."),
+    llvm::cl::init(""), llvm::cl::cat(ClangDocCategory));
+
 enum OutputFormatTy {
   md,
   yaml,
@@ -119,60 +159,307 @@ bool CreateDirectory(const Twine &DirName, bool ClearDirectory = false) {
 //
 // }
 // }
-llvm::Expected<llvm::SmallString<128>>
+llvm::SmallString<128>
 getInfoOutputFile(StringRef Root,
                   llvm::SmallVectorImpl<doc::Reference> &Namespaces,
                   StringRef Name, StringRef Ext) {
-  std::error_code OK;
   llvm::SmallString<128> Path;
   llvm::sys::path::native(Root, Path);
   for (auto R = Namespaces.rbegin(), E = Namespaces.rend(); R != E; ++R)
     llvm::sys::path::append(Path, R->Name);
 
-  if (CreateDirectory(Path))
-    return llvm::make_error<llvm::StringError>("Unable to create directory.\n",
-                                               llvm::inconvertibleErrorCode());
-
   if (Name.empty())
     Name = "GlobalNamespace";
   llvm::sys::path::append(Path, Name + Ext);
   return Path;
 }
 
-// Iterate through tool results and build string map of info vectors from the
-// encoded bitstreams.
-bool bitcodeResultsToInfos(
-    tooling::ToolResults &Results,
-    llvm::StringMap<std::vector<std::unique_ptr<doc::Info>>> &Output) {
-  bool Err = false;
-  Results.forEachResult([&](StringRef Key, StringRef Value) {
-    llvm::BitstreamCursor Stream(Value);
+// Writes \p Contents to a temporary file renamed to \p Path. Infos with the
+// same name in the same namespace share a file; as they are generated in
+// parallel, this keeps one of them whole instead of interleaving them.
+std::error_code writeFileAtomically(StringRef Path, StringRef Contents) {
+  int FD;
+  llvm::SmallString<128> TempPath;
+  if (std::error_code EC =
+          llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%.tmp", FD, TempPath))
+    return EC;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Contents;
+    OS.close();
+    if (std::error_code EC = OS.error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return EC;
+    }
+  }
+  if (std::error_code EC = llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::sys::fs::remove(TempPath);
+    return EC;
+  }
+  return std::error_code();
+}
+
+// Decodes the bitcode-encoded infos of one USR.
+bool bitcodeToInfos(ArrayRef<StringRef> Bitcodes,
+                    std::vector<std::unique_ptr<doc::Info>> &Output,
+                    llvm::raw_ostream &ErrOS) {
+  for (StringRef Bitcode : Bitcodes) {
+    llvm::BitstreamCursor Stream(Bitcode);
     doc::ClangDocBitcodeReader Reader(Stream);
     auto Infos = Reader.readBitcode();
     if (!Infos) {
-      llvm::errs() << toString(Infos.takeError()) << "\n";
-      Err = true;
-      return;
+      ErrOS << toString(Infos.takeError()) << "\n";
+      return true;
+    }
+    for (auto &I : Infos.get())
+      Output.emplace_back(std::move(I));
+  }
+  return false;
+}
+
+// In incremental mode, the hash of each reduced info is stored in this
+// directory of the output, in a file named after the USR.
+llvm::SmallString<128> getHashDirectory() {
+  llvm::SmallString<128> Path;
+  llvm::sys::path::native(OutDirectory, Path);
+  llvm::sys::path::append(Path, ".clang-doc-hashes");
+  return Path;
+}
+
+llvm::SmallString<128> getHashFile(StringRef USR, StringRef Format) {
+  llvm::SmallString<128> Path = getHashDirectory();
+  llvm::sys::path::append(Path, USR + "." + Format);
+  return Path;
+}
+
+// Hashes what the documentation of a reduced info depends on: its bitcode,
+// the file it is written to and the version of the generators.
+std::string hashInfo(std::unique_ptr<doc::Info> &I, StringRef InfoPath) {
+  llvm::SHA1 Hasher;
+  Hasher.update(getClangFullVersion());
+  Hasher.update(StringRef("\0", 1));
+  Hasher.update(InfoPath);
+  Hasher.update(StringRef("\0", 1));
+  Hasher.update(doc::serialize::serialize(I));
+  return llvm::toHex(Hasher.final());
+}
+
+// Returns true if the documentation of an info was written by a previous run
+// from an info with the same hash.
+bool isUpToDate(StringRef InfoPath, StringRef HashPath, StringRef Hash) {
+  if (!llvm::sys::fs::exists(InfoPath))
+    return false;
+  auto Stored = llvm::MemoryBuffer::getFile(HashPath);
+  return Stored && Stored.get()->getBuffer() == Hash;
+}
+
+// Destination of the generated docs, shared by the threads generating them.
+// Each directory is only created once. In bundle mode, the docs are kept and
+// written to a single file at the end, so that no file is created per info.
+class DocOutput {
+public:
+  DocOutput(bool Bundle) : Bundle(Bundle) {}
+
+  // Writes \p Doc to \p Path, or keeps it for the bundle.
+  std::error_code add(StringRef Path, std::string Doc) {
+    if (Bundle) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      BundledDocs.emplace_back(Path, std::move(Doc));
+      return std::error_code();
     }
-    for (auto &I : Infos.get()) {
-      auto R =
-          Output.try_emplace(Key, std::vector<std::unique_ptr<doc::Info>>());
-      R.first->second.emplace_back(std::move(I));
+    if (std::error_code EC =
+            createDirectoryOnce(llvm::sys::path::parent_path(Path)))
+      return EC;
+    return writeFileAtomically(Path, Doc);
+  }
+
+  // Writes the bundled docs to \p BundlePath, sorted by the paths they would
+  // have been written to without bundling.
+  std::error_code writeBundle(StringRef BundlePath) {
+    llvm::sort(BundledDocs.begin(), BundledDocs.end());
+    if (std::error_code EC =
+            createDirectoryOnce(llvm::sys::path::parent_path(BundlePath)))
+      return EC;
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(BundlePath, EC, llvm::sys::fs::F_None);
+    if (EC)
+      return EC;
+    for (const auto &PathAndDoc : BundledDocs)
+      OS << PathAndDoc.second;
+    OS.close();
+    EC = OS.error();
+    OS.clear_error();
+    return EC;
+  }
+
+private:
+  std::error_code createDirectoryOnce(StringRef Dir) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (CreatedDirectories.count(Dir))
+      return std::error_code();
+    if (std::error_code EC = llvm::sys::fs::create_directories(Dir))
+      return EC;
+    CreatedDirectories.insert(Dir);
+    return std::error_code();
+  }
+
+  bool Bundle;
+  std::mutex Mutex;
+  llvm::StringSet<> CreatedDirectories;
+  std::vector<std::pair<std::string, std::string>> BundledDocs;
+};
+
+// The reduced infos of a run over a shard of a project, shared by the threads
+// reducing them. They are written to a single bitcode file.
+class ShardInfos {
+public:
+  void add(std::unique_ptr<doc::Info> I) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Infos.push_back(std::move(I));
+  }
+
+  std::error_code write(StringRef Path) {
+    llvm::SmallString<2048> Buffer;
+    {
+      llvm::BitstreamWriter Stream(Buffer);
+      doc::ClangDocBitcodeWriter Writer(Stream);
+      for (const auto &I : Infos)
+        Writer.dispatchInfoForWrite(I.get());
     }
-  });
-  return Err;
+    return writeFileAtomically(Path, Buffer);
+  }
+
+private:
+  std::mutex Mutex;
+  std::vector<std::unique_ptr<doc::Info>> Infos;
+};
+
+// Reads the infos in the shard files of \p Dir, in parallel. Each of them is
+// encoded on its own again, as the mapper reports them, and added to the infos
+// of its USR. Returns true if a file couldn't be read or decoded.
+bool readShards(StringRef Dir, llvm::StringSaver &Saver,
+                llvm::StringMap<std::vector<StringRef>> &USRToBitcode) {
+  std::atomic<bool> Failed(false);
+  std::mutex Mutex;
+  llvm::ThreadPool Pool(ExecutorConcurrency == 0
+                            ? llvm::hardware_concurrency()
+                            : unsigned(ExecutorConcurrency));
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator It(Dir, EC), End; It != End && !EC;
+       It.increment(EC)) {
+    Pool.async(
+        [&](std::string Path) {
+          auto Buffer = llvm::MemoryBuffer::getFile(Path);
+          if (!Buffer) {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            llvm::errs() << "Can't open " << Path << "\n";
+            Failed = true;
+            return;
+          }
+          std::string ErrMessages;
+          llvm::raw_string_ostream ErrOS(ErrMessages);
+          std::vector<std::unique_ptr<doc::Info>> Infos;
+          if (bitcodeToInfos(Buffer.get()->getBuffer(), Infos, ErrOS)) {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            llvm::errs() << "Can't decode " << Path << ": " << ErrOS.str();
+            Failed = true;
+            return;
+          }
+          std::vector<std::pair<std::string, std::string>> Bitcodes;
+          for (auto &I : Infos)
+            Bitcodes.emplace_back(llvm::toHex(llvm::toStringRef(I->USR)),
+                                  doc::serialize::serialize(I));
+          std::lock_guard<std::mutex> Lock(Mutex);
+          for (const auto &KeyAndBitcode : Bitcodes)
+            USRToBitcode[KeyAndBitcode.first].push_back(
+                Saver.save(KeyAndBitcode.second));
+        },
+        It->path());
+  }
+  Pool.wait();
+  if (EC) {
+    llvm::errs() << "Can't read " << Dir << ": " << EC.message() << "\n";
+    return true;
+  }
+  return Failed;
+}
+
+// Reduces the infos of one USR and generates their documentation, or adds the
+// reduced info to \p Shard if set. Returns true if the bitcode couldn't be
+// decoded.
+bool reduceAndGenerate(StringRef USR, ArrayRef<StringRef> Bitcodes,
+                       doc::Generator &G, StringRef Format, DocOutput &Output,
+                       ShardInfos *Shard, llvm::raw_ostream &ErrOS) {
+  std::vector<std::unique_ptr<doc::Info>> Infos;
+  if (bitcodeToInfos(Bitcodes, Infos, ErrOS))
+    return true;
+
+  auto Reduced = doc::mergeInfos(Infos);
+  if (!Reduced) {
+    ErrOS << llvm::toString(Reduced.takeError());
+    return false;
+  }
+
+  if (Shard) {
+    Shard->add(std::move(Reduced.get()));
+    return false;
+  }
+
+  doc::Info *I = Reduced.get().get();
+
+  llvm::SmallString<128> InfoPath =
+      getInfoOutputFile(OutDirectory, I->Namespace, I->Name, "." + Format);
+
+  std::string Hash;
+  llvm::SmallString<128> HashPath;
+  if (Incremental) {
+    Hash = hashInfo(Reduced.get(), InfoPath);
+    HashPath = getHashFile(USR, Format);
+    if (isUpToDate(InfoPath, HashPath, Hash))
+      return false;
+  }
+
+  std::string Doc;
+  llvm::raw_string_ostream InfoOS(Doc);
+  if (auto Err = G.generateDocForInfo(I, InfoOS)) {
+    ErrOS << toString(std::move(Err)) << "\n";
+    return false;
+  }
+  InfoOS.flush();
+  if (std::error_code FileErr = Output.add(InfoPath, std::move(Doc))) {
+    ErrOS << "Error writing info file: " << FileErr.message() << "\n";
+    return false;
+  }
+  if (Incremental)
+    if (std::error_code FileErr = writeFileAtomically(HashPath, Hash))
+      ErrOS << "Error writing hash file: " << FileErr.message() << "\n";
+  return false;
 }
 
 int main(int argc, const char **argv) {
   llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
-  std::error_code OK;
 
   ExecutorName.setInitialValue("all-TUs");
   auto Exec = clang::tooling::createExecutorFromCommandLineArgs(
       argc, argv, ClangDocCategory);
 
   if (!Exec) {
-    llvm::errs() << toString(Exec.takeError()) << "\n";
+    // Merging shards runs no tool, so it needs no compilation database.
+    if (MergeDir.empty()) {
+      llvm::errs() << toString(Exec.takeError()) << "\n";
+      return 1;
+    }
+    llvm::consumeError(Exec.takeError());
+  }
+
+  if (Bundle && Incremental) {
+    llvm::errs() << "-bundle and -incremental can't be used together.\n";
+    return 1;
+  }
+  if (!ShardOutput.empty() && (!MergeDir.empty() || Bundle || Incremental)) {
+    llvm::errs() << "-shard-output can't be used with -merge-dir, -bundle or "
+                    "-incremental.\n";
     return 1;
   }
 
@@ -185,58 +472,101 @@ int main(int argc, const char **argv) {
     return 1;
   }
 
-  ArgumentsAdjuster ArgAdjuster;
-  if (!DoxygenOnly)
-    ArgAdjuster = combineAdjusters(
-        getInsertArgumentAdjuster("-fparse-all-comments",
-                                  tooling::ArgumentInsertPosition::END),
-        ArgAdjuster);
-
-  // Mapping phase
-  llvm::outs() << "Mapping decls...\n";
-  clang::doc::ClangDocContext CDCtx = {Exec->get()->getExecutionContext(),
-                                       PublicOnly};
-  auto Err =
-      Exec->get()->execute(doc::newMapperActionFactory(CDCtx), ArgAdjuster);
-  if (Err) {
-    llvm::errs() << toString(std::move(Err)) << "\n";
-    return 1;
-  }
-
   // Collect values into output by key.
   // In ToolResults, the Key is the hashed USR and the value is the
-  // bitcode-encoded representation of the Info object.
-  llvm::outs() << "Collecting infos...\n";
-  llvm::StringMap<std::vector<std::unique_ptr<doc::Info>>> USRToInfos;
-  if (bitcodeResultsToInfos(*Exec->get()->getToolResults(), USRToInfos))
-    return 1;
+  // bitcode-encoded representation of the Info object. The bitcode is only
+  // decoded when its USR is reduced, so that decoded infos are only kept for
+  // the USRs being processed.
+  llvm::StringMap<std::vector<StringRef>> USRToBitcode;
+  llvm::BumpPtrAllocator ShardArena;
+  llvm::StringSaver ShardSaver(ShardArena);
+  if (!MergeDir.empty()) {
+    llvm::outs() << "Collecting infos of shards...\n";
+    if (readShards(MergeDir, ShardSaver, USRToBitcode))
+      return 1;
+  } else {
+    ArgumentsAdjuster ArgAdjuster;
+    if (!DoxygenOnly)
+      ArgAdjuster = combineAdjusters(
+          getInsertArgumentAdjuster("-fparse-all-comments",
+                                    tooling::ArgumentInsertPosition::END),
+          ArgAdjuster);
 
-  // First reducing phase (reduce all decls into one info per decl).
-  llvm::outs() << "Reducing " << USRToInfos.size() << " infos...\n";
-  for (auto &Group : USRToInfos) {
-    auto Reduced = doc::mergeInfos(Group.getValue());
-    if (!Reduced) {
-      llvm::errs() << llvm::toString(Reduced.takeError());
-      continue;
+    // Mapping phase
+    llvm::outs() << "Mapping decls...\n";
+    doc::MappedDeclSet MappedDecls;
+    clang::doc::ClangDocContext CDCtx = {Exec->get()->getExecutionContext(),
+                                         PublicOnly, &MappedDecls};
+    auto Err =
+        Exec->get()->execute(doc::newMapperActionFactory(CDCtx), ArgAdjuster);
+    if (Err) {
+      llvm::errs() << toString(std::move(Err)) << "\n";
+      return 1;
     }
 
-    doc::Info *I = Reduced.get().get();
+    llvm::outs() << "Collecting infos...\n";
+    Exec->get()->getToolResults()->forEachResult(
+        [&](StringRef Key, StringRef Value) {
+          USRToBitcode[Key].emplace_back(Value);
+        });
+  }
+
+  if (Incremental && CreateDirectory(getHashDirectory()))
+    return 1;
 
-    auto InfoPath =
-        getInfoOutputFile(OutDirectory, I->Namespace, I->Name, "." + Format);
-    if (!InfoPath) {
-      llvm::errs() << toString(InfoPath.takeError()) << "\n";
-      continue;
+  // First reducing phase (reduce all decls into one info per decl), and
+  // generation. USRs are independent, so they are processed in parallel.
+  llvm::outs() << "Reducing " << USRToBitcode.size() << " infos...\n";
+  DocOutput Output(Bundle);
+  std::unique_ptr<ShardInfos> Shard;
+  if (!ShardOutput.empty())
+    Shard = llvm::make_unique<ShardInfos>();
+  std::atomic<bool> DecodeError(false);
+  std::mutex ErrMutex;
+  {
+    llvm::ThreadPool Pool(ExecutorConcurrency == 0
+                              ? llvm::hardware_concurrency()
+                              : unsigned(ExecutorConcurrency));
+    for (auto &Group : USRToBitcode) {
+      StringRef USR = Group.getKey();
+      const std::vector<StringRef> *Bitcodes = &Group.getValue();
+      Pool.async([&, USR, Bitcodes] {
+        // Errors are buffered so that messages of different USRs don't
+        // interleave.
+        std::string ErrMessages;
+        llvm::raw_string_ostream ErrOS(ErrMessages);
+        if (reduceAndGenerate(USR, *Bitcodes, **G, Format, Output, Shard.get(),
+                              ErrOS))
+          DecodeError = true;
+        if (!ErrOS.str().empty()) {
+          std::lock_guard<std::mutex> Lock(ErrMutex);
+          llvm::errs() << ErrOS.str();
+        }
+      });
     }
-    std::error_code FileErr;
-    llvm::raw_fd_ostream InfoOS(InfoPath.get(), FileErr, llvm::sys::fs::F_None);
-    if (FileErr != OK) {
-      llvm::errs() << "Error opening info file: " << FileErr.message() << "\n";
-      continue;
+  }
+
+  if (DecodeError)
+    return 1;
+
+  if (Shard) {
+    if (std::error_code EC = Shard->write(ShardOutput)) {
+      llvm::errs() << "Error writing " << ShardOutput << ": " << EC.message()
+                   << "\n";
+      return 1;
     }
+    return 0;
+  }
 
-    if (auto Err = G->get()->generateDocForInfo(I, InfoOS))
-      llvm::errs() << toString(std::move(Err)) << "\n";
+  if (Bundle) {
+    llvm::SmallString<128> BundlePath;
+    llvm::sys::path::native(OutDirectory, BundlePath);
+    llvm::sys::path::append(BundlePath, "docs." + Format);
+    if (std::error_code EC = Output.writeBundle(BundlePath)) {
+      llvm::errs() << "Error writing " << BundlePath << ": " << EC.message()
+                   << "\n";
+      return 1;
+    }
   }
 
   return 0;
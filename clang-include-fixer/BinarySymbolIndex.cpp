@@ -0,0 +1,58 @@
+//===-- BinarySymbolIndex.cpp ---------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "BinarySymbolIndex.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/Path.h"
+
+using clang::find_all_symbols::BinarySymbolDatabase;
+using clang::find_all_symbols::SymbolAndSignals;
+
+namespace clang {
+namespace include_fixer {
+
+llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+BinarySymbolIndex::createFromFile(llvm::StringRef FilePath) {
+  // The database is read in place, never copy it to the heap.
+  auto Buffer = llvm::MemoryBuffer::getFile(
+      FilePath, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return Buffer.getError();
+
+  auto Database = BinarySymbolDatabase::create((*Buffer)->getBuffer());
+  if (!Database) {
+    llvm::consumeError(Database.takeError());
+    return llvm::make_error_code(llvm::errc::invalid_argument);
+  }
+  return std::unique_ptr<BinarySymbolIndex>(
+      new BinarySymbolIndex(std::move(*Buffer), std::move(*Database)));
+}
+
+llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+BinarySymbolIndex::createFromDirectory(llvm::StringRef Directory,
+                                       llvm::StringRef Name) {
+  // Walk upwards from Directory, looking for files.
+  for (llvm::SmallString<128> PathStorage = Directory; !Directory.empty();
+       Directory = llvm::sys::path::parent_path(Directory)) {
+    assert(Directory.size() <= PathStorage.size());
+    PathStorage.resize(Directory.size()); // Shrink to parent.
+    llvm::sys::path::append(PathStorage, Name);
+    if (auto DB = createFromFile(PathStorage))
+      return DB;
+  }
+  return llvm::make_error_code(llvm::errc::no_such_file_or_directory);
+}
+
+std::vector<SymbolAndSignals>
+BinarySymbolIndex::search(llvm::StringRef Identifier) {
+  return Database.lookup(Identifier);
+}
+
+} // namespace include_fixer
+} // namespace clang
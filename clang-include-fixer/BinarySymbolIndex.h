@@ -0,0 +1,47 @@
+//===-- BinarySymbolIndex.h -------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_BINARYSYMBOLINDEX_H
+#define LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_BINARYSYMBOLINDEX_H
+
+#include "SymbolIndex.h"
+#include "find-all-symbols/BinarySymbolDatabase.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <vector>
+
+namespace clang {
+namespace include_fixer {
+
+/// Binary format database, memory-mapped and searched in place.
+class BinarySymbolIndex : public SymbolIndex {
+public:
+  /// Create a new binary db from a file.
+  static llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+  createFromFile(llvm::StringRef FilePath);
+  /// Look for a file called \c Name in \c Directory and all parent directories.
+  static llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+  createFromDirectory(llvm::StringRef Directory, llvm::StringRef Name);
+
+  std::vector<find_all_symbols::SymbolAndSignals>
+  search(llvm::StringRef Identifier) override;
+
+private:
+  BinarySymbolIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                    find_all_symbols::BinarySymbolDatabase Database)
+      : Buffer(std::move(Buffer)), Database(std::move(Database)) {}
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  find_all_symbols::BinarySymbolDatabase Database;
+};
+
+} // namespace include_fixer
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_BINARYSYMBOLINDEX_H
@@ -6,7 +6,10 @@
 //
 //===----------------------------------------------------------------------===//
 #include "FuzzySymbolIndex.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Regex.h"
+#include <algorithm>
 
 using clang::find_all_symbols::SymbolAndSignals;
 using llvm::StringRef;
@@ -15,11 +18,29 @@ namespace clang {
 namespace include_fixer {
 namespace {
 
+// The length of the query prefixes symbols are indexed by.
+const size_t PrefixLength = 3;
+
+// Keeps, for each prefix a query can start with, the symbols it may match.
+//
+// A query matches the start of the first symbol token, then each of its
+// characters either follows the previous one in the same symbol token or
+// starts the next token. The prefixes of up to PrefixLength characters a
+// symbol can be matched by are few, so they make a cheap inverted index: a
+// search only runs the regex over the posting list of its own prefix.
 class MemSymbolIndex : public FuzzySymbolIndex {
 public:
   MemSymbolIndex(std::vector<SymbolAndSignals> Symbols) {
     for (auto &Symbol : Symbols) {
       auto Tokens = tokenize(Symbol.Symbol.getName());
+      std::vector<std::string> Prefixes;
+      if (!Tokens.empty() && !Tokens.front().empty())
+        addPrefixes(Tokens, 0, 0, "", Prefixes);
+      llvm::sort(Prefixes);
+      Prefixes.erase(std::unique(Prefixes.begin(), Prefixes.end()),
+                     Prefixes.end());
+      for (const std::string &Prefix : Prefixes)
+        PostingLists[Prefix].push_back(this->Symbols.size());
       this->Symbols.emplace_back(
           StringRef(llvm::join(Tokens.begin(), Tokens.end(), " ")),
           std::move(Symbol));
@@ -30,15 +51,43 @@ public:
     auto Tokens = tokenize(Query);
     llvm::Regex Pattern("^" + queryRegexp(Tokens));
     std::vector<SymbolAndSignals> Results;
-    for (const Entry &E : Symbols)
-      if (Pattern.match(E.first))
-        Results.push_back(E.second);
+    std::string Prefix =
+        llvm::join(Tokens.begin(), Tokens.end(), "").substr(0, PrefixLength);
+    if (Prefix.empty()) {
+      for (const Entry &E : Symbols)
+        if (Pattern.match(E.first))
+          Results.push_back(E.second);
+      return Results;
+    }
+    auto It = PostingLists.find(Prefix);
+    if (It == PostingLists.end())
+      return Results;
+    for (uint32_t Index : It->second)
+      if (Pattern.match(Symbols[Index].first))
+        Results.push_back(Symbols[Index].second);
     return Results;
   }
 
 private:
+  // Adds the prefixes continuing \p Prefix with character \p Char of token
+  // \p Token.
+  static void addPrefixes(const std::vector<std::string> &Tokens, size_t Token,
+                          size_t Char, std::string Prefix,
+                          std::vector<std::string> &Prefixes) {
+    Prefix.push_back(Tokens[Token][Char]);
+    Prefixes.push_back(Prefix);
+    if (Prefix.size() == PrefixLength)
+      return;
+    if (Char + 1 < Tokens[Token].size())
+      addPrefixes(Tokens, Token, Char + 1, Prefix, Prefixes);
+    if (Token + 1 < Tokens.size() && !Tokens[Token + 1].empty())
+      addPrefixes(Tokens, Token + 1, 0, Prefix, Prefixes);
+  }
+
   using Entry = std::pair<llvm::SmallString<32>, SymbolAndSignals>;
   std::vector<Entry> Symbols;
+  // The indices of the symbols each prefix may match, in increasing order.
+  llvm::StringMap<std::vector<uint32_t>> PostingLists;
 };
 
 // Helpers for tokenize state machine.
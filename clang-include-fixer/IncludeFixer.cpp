@@ -383,14 +383,26 @@ IncludeFixerSemaSource::query(StringRef Query, StringRef ScopedQualifiers,
   // 1. lookup a::b::foo.
   // 2. lookup b::foo.
   std::string QueryString = ScopedQualifiers.str() + Query.str();
-  // It's unsafe to do nested search for the identifier with scoped namespace
-  // context, it might treat the identifier as a nested class of the scoped
-  // namespace.
-  std::vector<find_all_symbols::SymbolInfo> MatchedSymbols =
-      SymbolIndexMgr.search(QueryString, /*IsNestedSearch=*/false, FileName);
-  if (MatchedSymbols.empty())
+  // The split between the qualifiers and the identifier matters for the
+  // fallback lookup, keep it in the key.
+  std::string Key = ScopedQualifiers.str();
+  Key += '\0';
+  Key += Query;
+  auto Cached = QueryCache.try_emplace(Key);
+  std::vector<find_all_symbols::SymbolInfo> &MatchedSymbols =
+      Cached.first->second;
+  if (Cached.second) {
+    // It's unsafe to do nested search for the identifier with scoped
+    // namespace context, it might treat the identifier as a nested class of
+    // the scoped namespace.
     MatchedSymbols =
-        SymbolIndexMgr.search(Query, /*IsNestedSearch=*/true, FileName);
+        SymbolIndexMgr.search(QueryString, /*IsNestedSearch=*/false, FileName);
+    if (MatchedSymbols.empty())
+      MatchedSymbols =
+          SymbolIndexMgr.search(Query, /*IsNestedSearch=*/true, FileName);
+  } else {
+    LLVM_DEBUG(llvm::dbgs() << " (cached)");
+  }
   LLVM_DEBUG(llvm::dbgs() << "Having found " << MatchedSymbols.size()
                           << " symbols\n");
   // We store a copy of MatchedSymbols in a place where it's globally reachable.
@@ -15,6 +15,7 @@
 #include "clang/Sema/ExternalSemaSource.h"
 #include "clang/Tooling/Core/Replacement.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/StringMap.h"
 #include <memory>
 #include <vector>
 
@@ -142,6 +143,11 @@ private:
   /// recovery.
   std::vector<find_all_symbols::SymbolInfo> MatchedSymbols;
 
+  /// Results of the index searches done for this translation unit, keyed by
+  /// the scoped qualifiers and the identifier. Sema asks for the same names
+  /// repeatedly during error recovery.
+  llvm::StringMap<std::vector<find_all_symbols::SymbolInfo>> QueryCache;
+
   /// The file path to the file being processed.
   std::string FilePath;
 
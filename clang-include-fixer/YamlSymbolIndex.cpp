@@ -21,6 +21,11 @@ using clang::find_all_symbols::SymbolAndSignals;
 namespace clang {
 namespace include_fixer {
 
+YamlSymbolIndex::YamlSymbolIndex(std::vector<SymbolAndSignals> Symbols) {
+  for (auto &Symbol : Symbols)
+    LookupTable[Symbol.Symbol.getName()].push_back(std::move(Symbol));
+}
+
 llvm::ErrorOr<std::unique_ptr<YamlSymbolIndex>>
 YamlSymbolIndex::createFromFile(llvm::StringRef FilePath) {
   auto Buffer = llvm::MemoryBuffer::getFile(FilePath);
@@ -48,12 +53,10 @@ YamlSymbolIndex::createFromDirectory(llvm::StringRef Directory,
 
 std::vector<SymbolAndSignals>
 YamlSymbolIndex::search(llvm::StringRef Identifier) {
-  std::vector<SymbolAndSignals> Results;
-  for (const auto &Symbol : Symbols) {
-    if (Symbol.Symbol.getName() == Identifier)
-      Results.push_back(Symbol);
-  }
-  return Results;
+  auto I = LookupTable.find(Identifier);
+  if (I != LookupTable.end())
+    return I->second;
+  return {};
 }
 
 } // namespace include_fixer
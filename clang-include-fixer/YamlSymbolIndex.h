@@ -11,6 +11,7 @@
 
 #include "SymbolIndex.h"
 #include "find-all-symbols/SymbolInfo.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/ErrorOr.h"
 #include <map>
 #include <vector>
@@ -33,10 +34,11 @@ public:
 
 private:
   explicit YamlSymbolIndex(
-      std::vector<find_all_symbols::SymbolAndSignals> Symbols)
-      : Symbols(std::move(Symbols)) {}
+      std::vector<find_all_symbols::SymbolAndSignals> Symbols);
 
-  std::vector<find_all_symbols::SymbolAndSignals> Symbols;
+  /// The symbols by name, in the order of the database.
+  llvm::StringMap<std::vector<find_all_symbols::SymbolAndSignals>>
+      LookupTable;
 };
 
 } // namespace include_fixer
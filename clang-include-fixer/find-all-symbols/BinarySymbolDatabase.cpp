@@ -0,0 +1,247 @@
+//===-- BinarySymbolDatabase.cpp - Binary symbol database -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "BinarySymbolDatabase.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DJB.h"
+#include "llvm/Support/Endian.h"
+#include <algorithm>
+
+namespace clang {
+namespace find_all_symbols {
+
+// The layout of the database, all integers being 32-bit little endian:
+//   Header:   Magic, Version, NumBuckets, NumSymbols, NumContexts,
+//             StringsSize
+//   Buckets:  NumBuckets x { FirstSymbol, NumSymbols }
+//   Symbols:  NumSymbols x { Name, FilePath, Kind, Seen, Used, FirstContext,
+//                            NumContexts }
+//   Contexts: NumContexts x { ContextType, Name }
+//   Strings:  StringsSize bytes of { Size, Size bytes }
+// Strings are referred to by their offset in the string table. The symbols of
+// a bucket are those whose name hashes to it.
+namespace {
+
+const char Magic[] = {'F', 'A', 'S', 'D'};
+const uint32_t Version = 1;
+const size_t HeaderSize = 6 * 4;
+const size_t BucketSize = 2 * 4;
+const size_t SymbolSize = 7 * 4;
+const size_t ContextSize = 2 * 4;
+
+void writeU32(llvm::raw_ostream &OS, uint32_t Value) {
+  char Buffer[4];
+  llvm::support::endian::write32le(Buffer, Value);
+  OS.write(Buffer, sizeof(Buffer));
+}
+
+uint32_t readU32(llvm::StringRef Section, size_t Offset) {
+  return llvm::support::endian::read32le(Section.data() + Offset);
+}
+
+uint32_t getBucket(llvm::StringRef Name, uint32_t NumBuckets) {
+  return llvm::djbHash(Name) % NumBuckets;
+}
+
+// Deduplicated, length-prefixed strings.
+class StringTableBuilder {
+public:
+  uint32_t add(llvm::StringRef S) {
+    auto Inserted = Offsets.try_emplace(S, Data.size());
+    if (Inserted.second) {
+      llvm::raw_string_ostream OS(Data);
+      writeU32(OS, S.size());
+      OS << S;
+    }
+    return Inserted.first->second;
+  }
+
+  const std::string &getData() const { return Data; }
+
+private:
+  llvm::StringMap<uint32_t> Offsets;
+  std::string Data;
+};
+
+} // namespace
+
+void WriteSymbolInfosToBinary(llvm::raw_ostream &OS,
+                              const SymbolInfo::SignalMap &Symbols) {
+  // The map is sorted by name: each name is in a single bucket, in order.
+  uint32_t NumBuckets = Symbols.size() / 2 + 1;
+  std::vector<std::pair<uint32_t, const SymbolInfo::SignalMap::value_type *>>
+      Sorted;
+  Sorted.reserve(Symbols.size());
+  for (const auto &Symbol : Symbols)
+    Sorted.emplace_back(getBucket(Symbol.first.getName(), NumBuckets),
+                        &Symbol);
+  std::stable_sort(Sorted.begin(), Sorted.end(),
+                   [](const decltype(Sorted)::value_type &LHS,
+                      const decltype(Sorted)::value_type &RHS) {
+                     return LHS.first < RHS.first;
+                   });
+
+  StringTableBuilder Strings;
+  std::string SymbolData, ContextData;
+  llvm::raw_string_ostream SymbolOS(SymbolData), ContextOS(ContextData);
+  std::vector<uint32_t> BucketSizes(NumBuckets);
+  uint32_t NumContexts = 0;
+  for (const auto &Entry : Sorted) {
+    const SymbolInfo &Symbol = Entry.second->first;
+    const SymbolInfo::Signals &Signals = Entry.second->second;
+    ++BucketSizes[Entry.first];
+    writeU32(SymbolOS, Strings.add(Symbol.getName()));
+    writeU32(SymbolOS, Strings.add(Symbol.getFilePath()));
+    writeU32(SymbolOS, static_cast<uint32_t>(Symbol.getSymbolKind()));
+    writeU32(SymbolOS, Signals.Seen);
+    writeU32(SymbolOS, Signals.Used);
+    writeU32(SymbolOS, NumContexts);
+    writeU32(SymbolOS, Symbol.getContexts().size());
+    for (const SymbolInfo::Context &Context : Symbol.getContexts()) {
+      writeU32(ContextOS, static_cast<uint32_t>(Context.first));
+      writeU32(ContextOS, Strings.add(Context.second));
+      ++NumContexts;
+    }
+  }
+
+  OS.write(Magic, sizeof(Magic));
+  writeU32(OS, Version);
+  writeU32(OS, NumBuckets);
+  writeU32(OS, Sorted.size());
+  writeU32(OS, NumContexts);
+  writeU32(OS, Strings.getData().size());
+  uint32_t FirstSymbol = 0;
+  for (uint32_t Size : BucketSizes) {
+    writeU32(OS, FirstSymbol);
+    writeU32(OS, Size);
+    FirstSymbol += Size;
+  }
+  OS << SymbolOS.str() << ContextOS.str() << Strings.getData();
+}
+
+bool isBinarySymbolDatabase(llvm::StringRef Data) {
+  return Data.startswith(llvm::StringRef(Magic, sizeof(Magic)));
+}
+
+llvm::Expected<BinarySymbolDatabase>
+BinarySymbolDatabase::create(llvm::StringRef Data) {
+  auto Error = [](const char *Message) {
+    return llvm::make_error<llvm::StringError>(Message,
+                                               llvm::inconvertibleErrorCode());
+  };
+  if (!isBinarySymbolDatabase(Data) || Data.size() < HeaderSize)
+    return Error("not a binary symbol database");
+  if (readU32(Data, 4) != Version)
+    return Error("unsupported binary symbol database version");
+
+  BinarySymbolDatabase DB;
+  DB.NumBuckets = readU32(Data, 8);
+  DB.NumSymbols = readU32(Data, 12);
+  DB.NumContexts = readU32(Data, 16);
+  uint64_t StringsSize = readU32(Data, 20);
+  uint64_t BucketsSize = uint64_t(DB.NumBuckets) * BucketSize;
+  uint64_t SymbolsSize = uint64_t(DB.NumSymbols) * SymbolSize;
+  uint64_t ContextsSize = uint64_t(DB.NumContexts) * ContextSize;
+  if (DB.NumBuckets == 0 || HeaderSize + BucketsSize + SymbolsSize +
+                                    ContextsSize + StringsSize !=
+                                Data.size())
+    return Error("corrupted binary symbol database");
+
+  size_t Offset = HeaderSize;
+  DB.Buckets = Data.substr(Offset, BucketsSize);
+  Offset += BucketsSize;
+  DB.Symbols = Data.substr(Offset, SymbolsSize);
+  Offset += SymbolsSize;
+  DB.Contexts = Data.substr(Offset, ContextsSize);
+  Offset += ContextsSize;
+  DB.Strings = Data.substr(Offset);
+  return DB;
+}
+
+llvm::Optional<llvm::StringRef>
+BinarySymbolDatabase::readString(uint32_t Offset) const {
+  if (uint64_t(Offset) + 4 > Strings.size())
+    return llvm::None;
+  uint32_t Size = readU32(Strings, Offset);
+  if (uint64_t(Offset) + 4 + Size > Strings.size())
+    return llvm::None;
+  return Strings.substr(Offset + 4, Size);
+}
+
+llvm::Optional<llvm::StringRef>
+BinarySymbolDatabase::readSymbolName(uint32_t Index) const {
+  return readString(readU32(Symbols, size_t(Index) * SymbolSize));
+}
+
+bool BinarySymbolDatabase::readSymbol(uint32_t Index,
+                                      SymbolAndSignals &Symbol) const {
+  size_t Offset = size_t(Index) * SymbolSize;
+  llvm::Optional<llvm::StringRef> Name = readString(readU32(Symbols, Offset));
+  llvm::Optional<llvm::StringRef> FilePath =
+      readString(readU32(Symbols, Offset + 4));
+  uint32_t Kind = readU32(Symbols, Offset + 8);
+  uint32_t FirstContext = readU32(Symbols, Offset + 20);
+  uint32_t SymbolContexts = readU32(Symbols, Offset + 24);
+  if (!Name || !FilePath ||
+      Kind > static_cast<uint32_t>(SymbolInfo::SymbolKind::Unknown) ||
+      uint64_t(FirstContext) + SymbolContexts > NumContexts)
+    return false;
+
+  std::vector<SymbolInfo::Context> SymbolContextList;
+  SymbolContextList.reserve(SymbolContexts);
+  for (uint32_t I = FirstContext; I < FirstContext + SymbolContexts; ++I) {
+    uint32_t Type = readU32(Contexts, size_t(I) * ContextSize);
+    llvm::Optional<llvm::StringRef> ContextName =
+        readString(readU32(Contexts, size_t(I) * ContextSize + 4));
+    if (!ContextName ||
+        Type > static_cast<uint32_t>(SymbolInfo::ContextType::EnumDecl))
+      return false;
+    SymbolContextList.emplace_back(static_cast<SymbolInfo::ContextType>(Type),
+                                   *ContextName);
+  }
+  Symbol.Symbol =
+      SymbolInfo(*Name, static_cast<SymbolInfo::SymbolKind>(Kind), *FilePath,
+                 SymbolContextList);
+  Symbol.Signals = SymbolInfo::Signals(readU32(Symbols, Offset + 12),
+                                       readU32(Symbols, Offset + 16));
+  return true;
+}
+
+std::vector<SymbolAndSignals>
+BinarySymbolDatabase::lookup(llvm::StringRef Name) const {
+  std::vector<SymbolAndSignals> Results;
+  size_t Bucket = getBucket(Name, NumBuckets) * BucketSize;
+  uint32_t First = readU32(Buckets, Bucket);
+  uint32_t Size = readU32(Buckets, Bucket + 4);
+  if (uint64_t(First) + Size > NumSymbols)
+    return Results;
+  for (uint32_t I = First; I < First + Size; ++I) {
+    // Compare the names before decoding the other hashed symbols.
+    llvm::Optional<llvm::StringRef> SymbolName = readSymbolName(I);
+    if (!SymbolName || *SymbolName != Name)
+      continue;
+    SymbolAndSignals Symbol;
+    if (readSymbol(I, Symbol))
+      Results.push_back(std::move(Symbol));
+  }
+  return Results;
+}
+
+std::vector<SymbolAndSignals> BinarySymbolDatabase::getAllSymbols() const {
+  std::vector<SymbolAndSignals> Results;
+  Results.reserve(NumSymbols);
+  for (uint32_t I = 0; I < NumSymbols; ++I) {
+    SymbolAndSignals Symbol;
+    if (readSymbol(I, Symbol))
+      Results.push_back(std::move(Symbol));
+  }
+  return Results;
+}
+
+} // namespace find_all_symbols
+} // namespace clang
@@ -0,0 +1,71 @@
+//===-- BinarySymbolDatabase.h - Binary symbol database ---------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_FIND_ALL_SYMBOLS_BINARYSYMBOLDATABASE_H
+#define LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_FIND_ALL_SYMBOLS_BINARYSYMBOLDATABASE_H
+
+#include "SymbolInfo.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+
+namespace clang {
+namespace find_all_symbols {
+
+/// \brief Write SymbolInfos to a stream, in the binary format read by
+/// \c BinarySymbolDatabase.
+void WriteSymbolInfosToBinary(llvm::raw_ostream &OS,
+                              const SymbolInfo::SignalMap &Symbols);
+
+/// \brief Returns whether \p Data starts like a binary symbol database.
+bool isBinarySymbolDatabase(llvm::StringRef Data);
+
+/// \brief A symbol database in binary form, read in place.
+///
+/// The database is made of fixed-size symbol records, grouped by a hash of
+/// their name in the buckets of a hash table, and of a table of strings, all
+/// in little endian. Looking up a name only decodes the symbols of its bucket,
+/// so the database can be memory-mapped and used without parsing it first.
+///
+/// The data must outlive the database.
+class BinarySymbolDatabase {
+public:
+  /// Checks the header of \p Data and creates a database reading it.
+  static llvm::Expected<BinarySymbolDatabase> create(llvm::StringRef Data);
+
+  /// Returns the symbols named \p Name, in the order they were written.
+  std::vector<SymbolAndSignals> lookup(llvm::StringRef Name) const;
+
+  /// Returns all the symbols of the database.
+  std::vector<SymbolAndSignals> getAllSymbols() const;
+
+private:
+  BinarySymbolDatabase() = default;
+
+  /// Decodes the symbol record \p Index. Returns false if it is corrupted.
+  bool readSymbol(uint32_t Index, SymbolAndSignals &Symbol) const;
+  /// Returns the name of the symbol record \p Index, or None if it is
+  /// corrupted.
+  llvm::Optional<llvm::StringRef> readSymbolName(uint32_t Index) const;
+  llvm::Optional<llvm::StringRef> readString(uint32_t Offset) const;
+
+  uint32_t NumBuckets = 0;
+  uint32_t NumSymbols = 0;
+  uint32_t NumContexts = 0;
+  llvm::StringRef Buckets;
+  llvm::StringRef Symbols;
+  llvm::StringRef Contexts;
+  llvm::StringRef Strings;
+};
+
+} // namespace find_all_symbols
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_FIND_ALL_SYMBOLS_BINARYSYMBOLDATABASE_H
@@ -22,8 +22,7 @@ namespace find_all_symbols {
 llvm::Optional<SymbolInfo>
 FindAllMacros::CreateMacroSymbol(const Token &MacroNameTok,
                                  const MacroInfo *info) {
-  std::string FilePath =
-      getIncludePath(*SM, info->getDefinitionLoc(), Collector);
+  const std::string &FilePath = IncludePaths.get(*SM, info->getDefinitionLoc());
   if (FilePath.empty())
     return llvm::None;
   return SymbolInfo(MacroNameTok.getIdentifierInfo()->getName(),
@@ -63,6 +62,7 @@ void FindAllMacros::EndOfMainFile() {
   Reporter->reportSymbols(SM->getFileEntryForID(SM->getMainFileID())->getName(),
                           FileSymbols);
   FileSymbols.clear();
+  IncludePaths.clear();
 }
 
 } // namespace find_all_symbols
@@ -10,6 +10,7 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_FIND_ALL_SYMBOLS_FIND_ALL_MACROS_H
 #define LLVM_CLANG_TOOLS_EXTRA_FIND_ALL_SYMBOLS_FIND_ALL_MACROS_H
 
+#include "PathConfig.h"
 #include "SymbolInfo.h"
 #include "SymbolReporter.h"
 #include "clang/Lex/PPCallbacks.h"
@@ -27,7 +28,8 @@ class FindAllMacros : public clang::PPCallbacks {
 public:
   explicit FindAllMacros(SymbolReporter *Reporter, SourceManager *SM,
                          HeaderMapCollector *Collector = nullptr)
-      : Reporter(Reporter), SM(SM), Collector(Collector) {}
+      : Reporter(Reporter), SM(SM), Collector(Collector),
+        IncludePaths(Collector) {}
 
   void MacroDefined(const Token &MacroNameTok,
                     const MacroDirective *MD) override;
@@ -56,6 +58,8 @@ private:
   // A remapping header file collector allowing clients to include a different
   // header.
   HeaderMapCollector *const Collector;
+  // Include paths of the files seen in the current main file.
+  IncludePathCache IncludePaths;
 };
 
 } // namespace find_all_symbols
@@ -71,7 +71,7 @@ std::vector<SymbolInfo::Context> GetContexts(const NamedDecl *ND) {
 
 llvm::Optional<SymbolInfo>
 CreateSymbolInfo(const NamedDecl *ND, const SourceManager &SM,
-                 const HeaderMapCollector *Collector) {
+                 IncludePathCache &IncludePaths) {
   SymbolInfo::SymbolKind Type;
   if (llvm::isa<VarDecl>(ND)) {
     Type = SymbolInfo::SymbolKind::Variable;
@@ -105,7 +105,7 @@ CreateSymbolInfo(const NamedDecl *ND, const SourceManager &SM,
     return llvm::None;
   }
 
-  std::string FilePath = getIncludePath(SM, Loc, Collector);
+  const std::string &FilePath = IncludePaths.get(SM, Loc);
   if (FilePath.empty()) return llvm::None;
 
   return SymbolInfo(ND->getNameAsString(), Type, FilePath, GetContexts(ND));
@@ -250,7 +250,7 @@ void FindAllSymbols::run(const MatchFinder::MatchResult &Result) {
     assert(false && "Must match a NamedDecl!");
 
   const SourceManager *SM = Result.SourceManager;
-  if (auto Symbol = CreateSymbolInfo(ND, *SM, Collector)) {
+  if (auto Symbol = CreateSymbolInfo(ND, *SM, IncludePaths)) {
     Filename = SM->getFileEntryForID(SM->getMainFileID())->getName();
     FileSymbols[*Symbol] += Signals;
   }
@@ -262,6 +262,7 @@ void FindAllSymbols::onEndOfTranslationUnit() {
     FileSymbols.clear();
     Filename = "";
   }
+  IncludePaths.clear();
 }
 
 } // namespace find_all_symbols
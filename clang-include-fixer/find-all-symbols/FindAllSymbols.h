@@ -9,6 +9,7 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_FIND_ALL_SYMBOLS_SYMBOL_MATCHER_H
 #define LLVM_CLANG_TOOLS_EXTRA_FIND_ALL_SYMBOLS_SYMBOL_MATCHER_H
 
+#include "PathConfig.h"
 #include "SymbolInfo.h"
 #include "SymbolReporter.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
@@ -35,7 +36,7 @@ class FindAllSymbols : public ast_matchers::MatchFinder::MatchCallback {
 public:
   explicit FindAllSymbols(SymbolReporter *Reporter,
                           HeaderMapCollector *Collector = nullptr)
-      : Reporter(Reporter), Collector(Collector) {}
+      : Reporter(Reporter), Collector(Collector), IncludePaths(Collector) {}
 
   void registerMatchers(ast_matchers::MatchFinder *MatchFinder);
 
@@ -54,6 +55,8 @@ private:
   // A remapping header file collector allowing clients include a different
   // header.
   HeaderMapCollector *const Collector;
+  // Include paths of the files seen in the current source file.
+  IncludePathCache IncludePaths;
 };
 
 } // namespace find_all_symbols
@@ -7,7 +7,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "HeaderMapCollector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Regex.h"
+#include <algorithm>
+#include <tuple>
 
 namespace clang {
 namespace find_all_symbols {
@@ -15,28 +20,113 @@ namespace find_all_symbols {
 HeaderMapCollector::HeaderMapCollector(
     const RegexHeaderMap *RegexHeaderMappingTable) {
   assert(RegexHeaderMappingTable);
-  this->RegexHeaderMappingTable.reserve(RegexHeaderMappingTable->size());
+  MappedHeaders.reserve(RegexHeaderMappingTable->size());
+  PostfixTrie.emplace_back();
   for (const auto &Entry : *RegexHeaderMappingTable) {
-    this->RegexHeaderMappingTable.emplace_back(llvm::Regex(Entry.first),
-                                               Entry.second);
+    unsigned Index = MappedHeaders.size();
+    MappedHeaders.push_back(Entry.second);
+    if (!addPostfixPattern(Entry.first, Index))
+      this->RegexHeaderMappingTable.emplace_back(llvm::Regex(Entry.first),
+                                                 Index);
   }
 }
 
+bool HeaderMapCollector::addPostfixPattern(llvm::StringRef Pattern,
+                                           unsigned Entry) {
+  if (!Pattern.consume_back("$"))
+    return false;
+  // Split the pattern into atoms first so that nothing is added to the trie
+  // for patterns that turn out to need a real regex. '\0' is the wildcard.
+  llvm::SmallVector<char, 64> Atoms;
+  for (size_t I = 0, E = Pattern.size(); I != E; ++I) {
+    char C = Pattern[I];
+    if (C == '\\') {
+      if (++I == E || llvm::isAlnum(Pattern[I]))
+        return false;
+      Atoms.push_back(Pattern[I]);
+    } else if (C == '.') {
+      Atoms.push_back('\0');
+    } else if (llvm::StringRef("^$*+?()[]{}|").count(C)) {
+      return false;
+    } else {
+      Atoms.push_back(C);
+    }
+  }
+
+  unsigned Node = 0;
+  for (char C : llvm::reverse(Atoms)) {
+    unsigned Next = 0;
+    if (C == '\0') {
+      Next = PostfixTrie[Node].Wildcard;
+    } else {
+      for (const auto &Child : PostfixTrie[Node].Children)
+        if (Child.first == C)
+          Next = Child.second;
+    }
+    if (!Next) {
+      Next = PostfixTrie.size();
+      if (C == '\0')
+        PostfixTrie[Node].Wildcard = Next;
+      else
+        PostfixTrie[Node].Children.emplace_back(C, Next);
+      PostfixTrie.emplace_back();
+    }
+    Node = Next;
+  }
+  // Earlier entries take precedence, as with the regex table.
+  PostfixTrie[Node].Entry = std::min(PostfixTrie[Node].Entry, Entry);
+  return true;
+}
+
+unsigned HeaderMapCollector::matchPostfix(llvm::StringRef Header) const {
+  unsigned Best = PostfixNode::NoEntry;
+  if (PostfixTrie.empty())
+    return Best;
+  // Patterns are not anchored at the start, so every node reached while
+  // walking the header backwards is a candidate. Wildcards make this a search
+  // over (node, matched length) pairs rather than a single path.
+  llvm::SmallVector<std::pair<unsigned, size_t>, 8> Worklist;
+  Worklist.emplace_back(0, 0);
+  while (!Worklist.empty()) {
+    unsigned Node;
+    size_t Matched;
+    std::tie(Node, Matched) = Worklist.pop_back_val();
+    const PostfixNode &N = PostfixTrie[Node];
+    Best = std::min(Best, N.Entry);
+    if (Matched == Header.size())
+      continue;
+    char C = Header[Header.size() - Matched - 1];
+    for (const auto &Child : N.Children)
+      if (Child.first == C)
+        Worklist.emplace_back(Child.second, Matched + 1);
+    if (N.Wildcard && C != '\n')
+      Worklist.emplace_back(N.Wildcard, Matched + 1);
+  }
+  return Best;
+}
+
 llvm::StringRef
 HeaderMapCollector::getMappedHeader(llvm::StringRef Header) const {
   auto Iter = HeaderMappingTable.find(Header);
   if (Iter != HeaderMappingTable.end())
     return Iter->second;
   // If there is no complete header name mapping for this header, check the
-  // regex header mapping.
+  // regex header mapping. The first matching entry of the table wins.
+  unsigned Best = matchPostfix(Header);
   for (auto &Entry : RegexHeaderMappingTable) {
+    if (Entry.second >= Best)
+      break;
 #ifndef NDEBUG
     std::string Dummy;
     assert(Entry.first.isValid(Dummy) && "Regex should never be invalid!");
 #endif
-    if (Entry.first.match(Header))
-      return Entry.second;
+    if (Entry.first.match(Header)) {
+      Best = Entry.second;
+      break;
+    }
   }
+  if (Best != PostfixNode::NoEntry)
+    return MappedHeaders[Best];
   return Header;
 }
 
@@ -30,8 +30,13 @@ public:
   void addHeaderMapping(llvm::StringRef OrignalHeaderPath,
                         llvm::StringRef MappingHeaderPath) {
     HeaderMappingTable[OrignalHeaderPath] = MappingHeaderPath;
+    ++Generation;
   };
 
+  /// A counter bumped whenever a header mapping is added, so clients caching
+  /// results of getMappedHeader() know when to drop them.
+  unsigned getGeneration() const { return Generation; }
+
   /// Check if there is a mapping from \p Header or a regex pattern that matches
   /// it to another header name.
   /// \param Header A header name.
@@ -43,11 +48,38 @@ private:
   /// A string-to-string map saving the mapping relationship.
   HeaderMap HeaderMappingTable;
 
-  // A map from header patterns to header names.
-  // The header names are not owned. This is only threadsafe because the regexes
-  // never fail.
-  mutable std::vector<std::pair<llvm::Regex, const char *>>
-      RegexHeaderMappingTable;
+  /// A node of the trie built from postfix patterns ("foo/bar\\.h$"), keyed
+  /// on the reversed pattern so a header is matched by walking it backwards.
+  struct PostfixNode {
+    static const unsigned NoEntry = ~0U;
+    // Children keyed by literal character; few enough to scan linearly.
+    std::vector<std::pair<char, unsigned>> Children;
+    // Child reached by a '.' wildcard, 0 if none.
+    unsigned Wildcard = 0;
+    // Index into the mapping table of the first pattern ending here.
+    unsigned Entry = NoEntry;
+  };
+
+  /// Add \p Pattern to the postfix trie. Returns false if it is not a plain
+  /// postfix pattern and has to be matched as a regex.
+  bool addPostfixPattern(llvm::StringRef Pattern, unsigned Entry);
+
+  /// Returns the table index of the first postfix pattern matching \p Header,
+  /// or PostfixNode::NoEntry.
+  unsigned matchPostfix(llvm::StringRef Header) const;
+
+  /// The mapped header names of the regex mapping table, in table order. The
+  /// header names are not owned.
+  std::vector<const char *> MappedHeaders;
+
+  /// Postfix patterns of the regex mapping table. Node 0 is the root.
+  std::vector<PostfixNode> PostfixTrie;
+
+  // The remaining patterns along with their table index.
+  // This is only threadsafe because the regexes never fail.
+  mutable std::vector<std::pair<llvm::Regex, unsigned>> RegexHeaderMappingTable;
+
+  unsigned Generation = 0;
 };
 
 } // namespace find_all_symbols
@@ -37,5 +37,23 @@ std::string getIncludePath(const SourceManager &SM, SourceLocation Loc,
   return CleanedFilePath.str();
 }
 
+const std::string &IncludePathCache::get(const SourceManager &SM,
+                                         SourceLocation Loc) {
+  if (!Loc.isValid() || !Loc.isFileID()) {
+    Uncached = getIncludePath(SM, Loc, Collector);
+    return Uncached;
+  }
+  unsigned Generation = Collector ? Collector->getGeneration() : 0;
+  if (CachedSM != &SM || CachedGeneration != Generation) {
+    Paths.clear();
+    CachedSM = &SM;
+    CachedGeneration = Generation;
+  }
+  auto Inserted = Paths.try_emplace(SM.getFileID(Loc));
+  if (Inserted.second)
+    Inserted.first->second = getIncludePath(SM, Loc, Collector);
+  return Inserted.first->second;
+}
+
 } // namespace find_all_symbols
 } // namespace clang
@@ -12,6 +12,7 @@
 
 #include "HeaderMapCollector.h"
 #include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/DenseMap.h"
 #include <string>
 
 namespace clang {
@@ -30,6 +31,36 @@ namespace find_all_symbols {
 std::string getIncludePath(const SourceManager &SM, SourceLocation Loc,
                            const HeaderMapCollector *Collector = nullptr);
 
+/// \brief Memoizes getIncludePath() per file of a translation unit.
+///
+/// The include path only depends on the FileID containing a location, and a
+/// header typically declares many symbols, so computing it once per file
+/// saves walking the include stack and the header mapping for every symbol.
+/// The cache is tied to one SourceManager; call clear() at the end of each
+/// translation unit. It is dropped on its own whenever new mappings are added
+/// to the collector.
+class IncludePathCache {
+public:
+  explicit IncludePathCache(const HeaderMapCollector *Collector = nullptr)
+      : Collector(Collector) {}
+
+  /// Same as getIncludePath(SM, Loc, Collector).
+  const std::string &get(const SourceManager &SM, SourceLocation Loc);
+
+  void clear() {
+    Paths.clear();
+    CachedSM = nullptr;
+  }
+
+private:
+  const HeaderMapCollector *const Collector;
+  const SourceManager *CachedSM = nullptr;
+  unsigned CachedGeneration = 0;
+  llvm::DenseMap<FileID, std::string> Paths;
+  // Result for locations that are not cached.
+  std::string Uncached;
+};
+
 } // namespace find_all_symbols
 } // namespace clang
 
@@ -6,6 +6,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "../../../sharded-executor/ShardedExecution.h"
+#include "BinarySymbolDatabase.h"
 #include "FindAllSymbolsAction.h"
 #include "STLPostfixHeaderMap.h"
 #include "SymbolInfo.h"
@@ -21,6 +23,7 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
@@ -58,6 +61,11 @@ static cl::opt<std::string> MergeDir("merge-dir", cl::desc(R"(
 The directory for merging symbols.)"),
                                      cl::init(""),
                                      cl::cat(FindAllSymbolsCategory));
+
+static cl::opt<bool> Binary("binary", cl::desc(R"(
+Write the merged symbols in the binary format read by
+clang-include-fixer -db=binary, instead of YAML.)"),
+                            cl::init(false), cl::cat(FindAllSymbolsCategory));
 namespace clang {
 namespace find_all_symbols {
 
@@ -77,13 +85,25 @@ public:
 
 bool Merge(llvm::StringRef MergeDir, llvm::StringRef OutputFile) {
   std::error_code EC;
-  SymbolInfo::SignalMap Symbols;
-  std::mutex SymbolMutex;
+  // Symbols are partitioned by name into shards with their own lock, so that
+  // threads merging different names don't wait for each other.
+  struct Shard {
+    std::mutex Mutex;
+    SymbolInfo::SignalMap Symbols;
+  };
+  const size_t NumShards = 64;
+  std::vector<Shard> Shards(NumShards);
   auto AddSymbols = [&](ArrayRef<SymbolAndSignals> NewSymbols) {
-    // Synchronize set accesses.
-    std::unique_lock<std::mutex> LockGuard(SymbolMutex);
-    for (const auto &Symbol : NewSymbols) {
-      Symbols[Symbol.Symbol] += Symbol.Signals;
+    std::vector<std::vector<const SymbolAndSignals *>> ByShard(NumShards);
+    for (const auto &Symbol : NewSymbols)
+      ByShard[llvm::djbHash(Symbol.Symbol.getName()) % NumShards].push_back(
+          &Symbol);
+    for (size_t I = 0; I < NumShards; ++I) {
+      if (ByShard[I].empty())
+        continue;
+      std::lock_guard<std::mutex> LockGuard(Shards[I].Mutex);
+      for (const SymbolAndSignals *Symbol : ByShard[I])
+        Shards[I].Symbols[Symbol->Symbol] += Symbol->Signals;
     }
   };
 
@@ -107,20 +127,29 @@ bool Merge(llvm::StringRef MergeDir, llvm::StringRef OutputFile) {
               Symbol.Signals.Seen = std::min(Symbol.Signals.Seen, 1u);
               Symbol.Signals.Used = std::min(Symbol.Signals.Used, 1u);
             }
-            // FIXME: Merge without creating such a heavy contention point.
             AddSymbols(Symbols);
           },
           Dir->path());
     }
   }
 
+  // Shards hold disjoint sets of names, they are simply put together.
+  SymbolInfo::SignalMap Symbols;
+  for (Shard &S : Shards) {
+    Symbols.insert(S.Symbols.begin(), S.Symbols.end());
+    S.Symbols.clear();
+  }
+
   llvm::raw_fd_ostream OS(OutputFile, EC, llvm::sys::fs::F_None);
   if (EC) {
     llvm::errs() << "Can't open '" << OutputFile << "': " << EC.message()
                  << '\n';
     return false;
   }
-  WriteSymbolInfosToStream(OS, Symbols);
+  if (Binary)
+    WriteSymbolInfosToBinary(OS, Symbols);
+  else
+    WriteSymbolInfosToStream(OS, Symbols);
   return true;
 }
 
@@ -129,8 +158,6 @@ bool Merge(llvm::StringRef MergeDir, llvm::StringRef OutputFile) {
 
 int main(int argc, const char **argv) {
   CommonOptionsParser OptionsParser(argc, argv, FindAllSymbolsCategory);
-  ClangTool Tool(OptionsParser.getCompilations(),
-                 OptionsParser.getSourcePathList());
 
   std::vector<std::string> sources = OptionsParser.getSourcePathList();
   if (sources.empty()) {
@@ -142,6 +169,21 @@ int main(int argc, const char **argv) {
     return 0;
   }
 
+  // When sharded, the sources only locate the compilation database, and the
+  // files of the shard are processed, like with the sharded executor. Runs
+  // over all shards write their symbols to the same -output-dir, to merge.
+  if (ShardCount > 1) {
+    if (ShardIndex >= ShardCount) {
+      llvm::errs() << "-shard-index must be less than -shard-count.\n";
+      return 1;
+    }
+    sources.clear();
+    for (std::string &File : OptionsParser.getCompilations().getAllFiles())
+      if (getShard(File, ShardCount) == ShardIndex)
+        sources.push_back(std::move(File));
+  }
+  ClangTool Tool(OptionsParser.getCompilations(), sources);
+
   clang::find_all_symbols::YamlReporter Reporter;
 
   auto Factory =
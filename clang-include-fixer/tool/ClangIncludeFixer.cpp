@@ -6,6 +6,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "BinarySymbolIndex.h"
 #include "FuzzySymbolIndex.h"
 #include "InMemorySymbolIndex.h"
 #include "IncludeFixer.h"
@@ -19,8 +20,10 @@
 #include "clang/Tooling/Core/Replacement.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/YAMLTraits.h"
+#include <cstdio>
 
 using namespace clang;
 using namespace llvm;
@@ -85,13 +88,16 @@ enum DatabaseFormatTy {
   fixed,     ///< Hard-coded mapping.
   yaml,      ///< Yaml database created by find-all-symbols.
   fuzzyYaml, ///< Yaml database with fuzzy-matched identifiers.
+  binary,    ///< Binary database created by find-all-symbols -binary.
 };
 
 cl::opt<DatabaseFormatTy> DatabaseFormat(
     "db", cl::desc("Specify input format"),
     cl::values(clEnumVal(fixed, "Hard-coded mapping"),
                clEnumVal(yaml, "Yaml database created by find-all-symbols"),
-               clEnumVal(fuzzyYaml, "Yaml database, with fuzzy-matched names")),
+               clEnumVal(fuzzyYaml, "Yaml database, with fuzzy-matched names"),
+               clEnumVal(binary, "Binary database created by find-all-symbols "
+                                 "-binary")),
     cl::init(yaml), cl::cat(IncludeFixerCategory));
 
 cl::opt<std::string> Input("input",
@@ -151,6 +157,22 @@ cl::opt<std::string> InsertHeader(
              "                     QualifiedName: \"a::foo\"} ]}\""),
     cl::init(""), cl::cat(IncludeFixerCategory));
 
+cl::opt<bool> ServerMode(
+    "server",
+    cl::desc("Keep the databases loaded and serve requests read from <stdin>,\n"
+             "one JSON object per line, for editor integration:\n"
+             "  {\"Command\": \"output-headers\", \"FilePath\": ...,\n"
+             "   \"Code\": ...}\n"
+             "  {\"Command\": \"query-symbol\", \"FilePath\": ...,\n"
+             "   \"Symbol\": \"a::foo\"}\n"
+             "  {\"Command\": \"insert-header\", \"Code\": ...,\n"
+             "   \"Context\": <-output-headers result>}\n"
+             "\"Code\" overrides the content of the file. Each response is\n"
+             "one line of JSON on stdout, with an \"Error\" on failure. The\n"
+             "source file given on the command line locates the compilation\n"
+             "database."),
+    cl::init(false), cl::cat(IncludeFixerCategory));
+
 cl::opt<std::string>
     Style("style",
           cl::desc("Fallback style for reformatting after inserting new\n"
@@ -231,6 +253,31 @@ createSymbolIndexManager(StringRef FilePath) {
         });
     break;
   }
+  case binary: {
+    auto CreateBinaryIdx =
+        [=]() -> std::unique_ptr<include_fixer::SymbolIndex> {
+      llvm::ErrorOr<std::unique_ptr<include_fixer::BinarySymbolIndex>> DB(
+          nullptr);
+      if (!Input.empty()) {
+        DB = include_fixer::BinarySymbolIndex::createFromFile(Input);
+      } else {
+        SmallString<128> AbsolutePath(tooling::getAbsolutePath(FilePath));
+        StringRef Directory = llvm::sys::path::parent_path(AbsolutePath);
+        DB = include_fixer::BinarySymbolIndex::createFromDirectory(
+            Directory, "find_all_symbols_db.bin");
+      }
+
+      if (!DB) {
+        llvm::errs() << "Couldn't find binary db: " << DB.getError().message()
+                     << '\n';
+        return nullptr;
+      }
+      return std::move(*DB);
+    };
+
+    SymbolIndexMgr->addSymbolIndex(std::move(CreateBinaryIdx));
+    break;
+  }
   }
   return SymbolIndexMgr;
 }
@@ -262,11 +309,220 @@ void writeToJson(llvm::raw_ostream &OS, const IncludeFixerContext& Context) {
   OS << "}\n";
 }
 
+llvm::json::Value toJSON(const IncludeFixerContext &Context) {
+  llvm::json::Array QuerySymbolInfos;
+  for (const auto &Info : Context.getQuerySymbolInfos())
+    QuerySymbolInfos.push_back(llvm::json::Object{
+        {"RawIdentifier", Info.RawIdentifier},
+        {"Range", llvm::json::Object{{"Offset", Info.Range.getOffset()},
+                                     {"Length", Info.Range.getLength()}}}});
+  llvm::json::Array HeaderInfos;
+  for (const auto &Info : Context.getHeaderInfos())
+    HeaderInfos.push_back(llvm::json::Object{
+        {"Header", Info.Header}, {"QualifiedName", Info.QualifiedName}});
+  return llvm::json::Object{{"FilePath", Context.getFilePath().str()},
+                            {"QuerySymbolInfos", std::move(QuerySymbolInfos)},
+                            {"HeaderInfos", std::move(HeaderInfos)}};
+}
+
+llvm::Error createError(const llvm::Twine &Message) {
+  return llvm::make_error<llvm::StringError>(Message,
+                                             llvm::inconvertibleErrorCode());
+}
+
+/// Inserts the header of \p Header, an IncludeFixerContext in YAML or JSON,
+/// into \p Code.
+llvm::Expected<std::string> insertHeader(StringRef Code, StringRef Header) {
+  llvm::yaml::Input yin(Header);
+  IncludeFixerContext Context;
+  yin >> Context;
+  if (yin.error())
+    return createError("Invalid header context: " + yin.error().message());
+
+  const auto &HeaderInfos = Context.getHeaderInfos();
+  if (HeaderInfos.empty())
+    return createError("Expect exactly one unique header.");
+  // We only accept one unique header.
+  // Check all elements in HeaderInfos have the same header.
+  bool IsUniqueHeader = std::equal(
+      HeaderInfos.begin()+1, HeaderInfos.end(), HeaderInfos.begin(),
+      [](const IncludeFixerContext::HeaderInfo &LHS,
+         const IncludeFixerContext::HeaderInfo &RHS) {
+        return LHS.Header == RHS.Header;
+      });
+  if (!IsUniqueHeader)
+    return createError("Expect exactly one unique header.");
+
+  // If a header has multiple symbols, we won't add the missing namespace
+  // qualifiers because we don't know which one is exactly used.
+  //
+  // Check whether all elements in HeaderInfos have the same qualified name.
+  bool IsUniqueQualifiedName = std::equal(
+      HeaderInfos.begin() + 1, HeaderInfos.end(), HeaderInfos.begin(),
+      [](const IncludeFixerContext::HeaderInfo &LHS,
+         const IncludeFixerContext::HeaderInfo &RHS) {
+        return LHS.QualifiedName == RHS.QualifiedName;
+      });
+  auto InsertStyle = format::getStyle(format::DefaultFormatStyle,
+                                      Context.getFilePath(), Style);
+  if (!InsertStyle)
+    return InsertStyle.takeError();
+  auto Replacements = clang::include_fixer::createIncludeFixerReplacements(
+      Code, Context, *InsertStyle,
+      /*AddQualifiers=*/IsUniqueQualifiedName);
+  if (!Replacements)
+    return createError("Failed to create replacements: " +
+                       llvm::toString(Replacements.takeError()));
+
+  return tooling::applyAllReplacements(Code, *Replacements);
+}
+
+IncludeFixerContext
+querySymbol(include_fixer::SymbolIndexManager &SymbolIndexMgr,
+            StringRef Query, StringRef SourceFilePath) {
+  auto MatchedSymbols = SymbolIndexMgr.search(
+      Query, /*IsNestedSearch=*/true, SourceFilePath);
+  for (auto &Symbol : MatchedSymbols) {
+    std::string HeaderPath = Symbol.getFilePath().str();
+    Symbol.SetFilePath(((HeaderPath[0] == '"' || HeaderPath[0] == '<')
+                            ? HeaderPath
+                            : "\"" + HeaderPath + "\""));
+  }
+
+  // We leave an empty symbol range as we don't know the range of the symbol
+  // being queried in this mode. clang-include-fixer won't add namespace
+  // qualifiers if the symbol range is empty, which also fits this case.
+  IncludeFixerContext::QuerySymbolInfo Symbol;
+  Symbol.RawIdentifier = Query;
+  return IncludeFixerContext(SourceFilePath, {Symbol}, MatchedSymbols);
+}
+
+/// Serves the requests of -server mode, keeping the symbol databases and the
+/// compilation database loaded between them.
+class IncludeFixerServer {
+public:
+  IncludeFixerServer(const tooling::CompilationDatabase &Compilations)
+      : Compilations(Compilations) {}
+
+  /// Reads requests from stdin until it is closed.
+  void run() {
+    std::string Line;
+    while (readLine(Line)) {
+      if (StringRef(Line).trim().empty())
+        continue;
+      llvm::json::Value Response = handle(Line);
+      llvm::outs() << Response << "\n";
+      llvm::outs().flush();
+    }
+  }
+
+private:
+  static bool readLine(std::string &Line) {
+    Line.clear();
+    char Buffer[4096];
+    while (std::fgets(Buffer, sizeof(Buffer), stdin)) {
+      Line += Buffer;
+      if (Line.back() == '\n') {
+        Line.pop_back();
+        return true;
+      }
+    }
+    return !Line.empty();
+  }
+
+  static llvm::json::Value errorResponse(llvm::Error Err) {
+    return llvm::json::Object{{"Error", llvm::toString(std::move(Err))}};
+  }
+
+  llvm::json::Value handle(StringRef Line) {
+    llvm::Expected<llvm::json::Value> Request = llvm::json::parse(Line);
+    if (!Request)
+      return errorResponse(Request.takeError());
+    const llvm::json::Object *Params = Request->getAsObject();
+    if (!Params)
+      return errorResponse(createError("Expect a JSON object."));
+    StringRef Command = Params->getString("Command").getValueOr("");
+    std::string FilePath = Params->getString("FilePath").getValueOr("");
+    llvm::Optional<StringRef> Code = Params->getString("Code");
+
+    if (Command == "insert-header") {
+      const llvm::json::Value *Context = Params->get("Context");
+      if (!Code || !Context)
+        return errorResponse(createError("Expect a Code and a Context."));
+      std::string Header;
+      llvm::raw_string_ostream OS(Header);
+      OS << *Context;
+      auto ChangedCode = insertHeader(*Code, OS.str());
+      if (!ChangedCode)
+        return errorResponse(ChangedCode.takeError());
+      return llvm::json::Object{{"Code", *ChangedCode}};
+    }
+    if (Command != "query-symbol" && Command != "output-headers")
+      return errorResponse(createError("Unknown command '" + Command + "'."));
+
+    if (FilePath.empty())
+      return errorResponse(createError("Expect a FilePath."));
+    FilePath = tooling::getAbsolutePath(FilePath);
+    include_fixer::SymbolIndexManager &SymbolIndexMgr =
+        getSymbolIndexManager(FilePath);
+
+    if (Command == "query-symbol") {
+      llvm::Optional<StringRef> Symbol = Params->getString("Symbol");
+      if (!Symbol)
+        return errorResponse(createError("Expect a Symbol."));
+      return toJSON(querySymbol(SymbolIndexMgr, *Symbol, FilePath));
+    }
+
+    tooling::ClangTool Tool(Compilations, {FilePath});
+    if (Code)
+      Tool.mapVirtualFile(FilePath, *Code);
+    std::vector<IncludeFixerContext> Contexts;
+    include_fixer::IncludeFixerActionFactory Factory(
+        SymbolIndexMgr, Contexts, Style, MinimizeIncludePaths);
+    if (Tool.run(&Factory) != 0 || Contexts.empty())
+      return errorResponse(
+          createError("Fatal compiler error occurred while parsing file!"
+                      " (incorrect include paths?)"));
+    return toJSON(Contexts.front());
+  }
+
+  /// The symbol databases are looked up from the directory of the files, each
+  /// directory gets its own manager so that the databases are loaded once.
+  include_fixer::SymbolIndexManager &
+  getSymbolIndexManager(StringRef FilePath) {
+    StringRef Key =
+        Input.empty() ? llvm::sys::path::parent_path(FilePath) : StringRef();
+    auto Inserted = SymbolIndexMgrs.try_emplace(Key);
+    ManagerEntry &Entry = Inserted.first->second;
+    if (Inserted.second) {
+      // The manager keeps a reference to the path to find the databases
+      // lazily, the entry owns it.
+      Entry.FilePath = FilePath;
+      Entry.SymbolIndexMgr = createSymbolIndexManager(Entry.FilePath);
+    }
+    return *Entry.SymbolIndexMgr;
+  }
+
+  struct ManagerEntry {
+    std::string FilePath;
+    std::unique_ptr<include_fixer::SymbolIndexManager> SymbolIndexMgr;
+  };
+
+  const tooling::CompilationDatabase &Compilations;
+  llvm::StringMap<ManagerEntry> SymbolIndexMgrs;
+};
+
 int includeFixerMain(int argc, const char **argv) {
   tooling::CommonOptionsParser options(argc, argv, IncludeFixerCategory);
   tooling::ClangTool tool(options.getCompilations(),
                           options.getSourcePathList());
 
+  if (ServerMode) {
+    IncludeFixerServer Server(options.getCompilations());
+    Server.run();
+    return 0;
+  }
+
   llvm::StringRef SourceFilePath = options.getSourcePathList().front();
   // In STDINMode, we override the file content with the <stdin> input.
   // Since `tool.mapVirtualFile` takes `StringRef`, we define `Code` outside of
@@ -294,52 +550,7 @@ int includeFixerMain(int argc, const char **argv) {
       return 1;
     }
 
-    llvm::yaml::Input yin(InsertHeader);
-    IncludeFixerContext Context;
-    yin >> Context;
-
-    const auto &HeaderInfos = Context.getHeaderInfos();
-    assert(!HeaderInfos.empty());
-    // We only accept one unique header.
-    // Check all elements in HeaderInfos have the same header.
-    bool IsUniqueHeader = std::equal(
-        HeaderInfos.begin()+1, HeaderInfos.end(), HeaderInfos.begin(),
-        [](const IncludeFixerContext::HeaderInfo &LHS,
-           const IncludeFixerContext::HeaderInfo &RHS) {
-          return LHS.Header == RHS.Header;
-        });
-    if (!IsUniqueHeader) {
-      errs() << "Expect exactly one unique header.\n";
-      return 1;
-    }
-
-    // If a header has multiple symbols, we won't add the missing namespace
-    // qualifiers because we don't know which one is exactly used.
-    //
-    // Check whether all elements in HeaderInfos have the same qualified name.
-    bool IsUniqueQualifiedName = std::equal(
-        HeaderInfos.begin() + 1, HeaderInfos.end(), HeaderInfos.begin(),
-        [](const IncludeFixerContext::HeaderInfo &LHS,
-           const IncludeFixerContext::HeaderInfo &RHS) {
-          return LHS.QualifiedName == RHS.QualifiedName;
-        });
-    auto InsertStyle = format::getStyle(format::DefaultFormatStyle,
-                                        Context.getFilePath(), Style);
-    if (!InsertStyle) {
-      llvm::errs() << llvm::toString(InsertStyle.takeError()) << "\n";
-      return 1;
-    }
-    auto Replacements = clang::include_fixer::createIncludeFixerReplacements(
-        Code->getBuffer(), Context, *InsertStyle,
-        /*AddQualifiers=*/IsUniqueQualifiedName);
-    if (!Replacements) {
-      errs() << "Failed to create replacements: "
-             << llvm::toString(Replacements.takeError()) << "\n";
-      return 1;
-    }
-
-    auto ChangedCode =
-        tooling::applyAllReplacements(Code->getBuffer(), *Replacements);
+    auto ChangedCode = insertHeader(Code->getBuffer(), InsertHeader);
     if (!ChangedCode) {
       llvm::errs() << llvm::toString(ChangedCode.takeError()) << "\n";
       return 1;
@@ -356,23 +567,8 @@ int includeFixerMain(int argc, const char **argv) {
 
   // Query symbol mode.
   if (!QuerySymbol.empty()) {
-    auto MatchedSymbols = SymbolIndexMgr->search(
-        QuerySymbol, /*IsNestedSearch=*/true, SourceFilePath);
-    for (auto &Symbol : MatchedSymbols) {
-      std::string HeaderPath = Symbol.getFilePath().str();
-      Symbol.SetFilePath(((HeaderPath[0] == '"' || HeaderPath[0] == '<')
-                              ? HeaderPath
-                              : "\"" + HeaderPath + "\""));
-    }
-
-    // We leave an empty symbol range as we don't know the range of the symbol
-    // being queried in this mode. clang-include-fixer won't add namespace
-    // qualifiers if the symbol range is empty, which also fits this case.
-    IncludeFixerContext::QuerySymbolInfo Symbol;
-    Symbol.RawIdentifier = QuerySymbol;
-    auto Context =
-        IncludeFixerContext(SourceFilePath, {Symbol}, MatchedSymbols);
-    writeToJson(llvm::outs(), Context);
+    writeToJson(llvm::outs(),
+                querySymbol(*SymbolIndexMgr, QuerySymbol, SourceFilePath));
     return 0;
   }
 
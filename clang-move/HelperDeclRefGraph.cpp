@@ -48,7 +48,8 @@ void HelperDeclRefGraph::addEdge(const Decl *Caller, const Decl *Callee) {
   // Allocate a new node, mark it as root, and process it's calls.
   CallGraphNode *CallerNode = getOrInsertNode(const_cast<Decl *>(Caller));
   CallGraphNode *CalleeNode = getOrInsertNode(const_cast<Decl *>(Callee));
-  CallerNode->addCallee(CalleeNode);
+  if (Edges.insert({CallerNode->getDecl(), CalleeNode->getDecl()}).second)
+    CallerNode->addCallee(CalleeNode);
 }
 
 void HelperDeclRefGraph::dump() const { print(llvm::errs()); }
@@ -70,20 +71,27 @@ CallGraphNode *HelperDeclRefGraph::getNode(const Decl *D) const {
 
 llvm::DenseSet<const CallGraphNode *>
 HelperDeclRefGraph::getReachableNodes(const Decl *Root) const {
-  const auto *RootNode = getNode(Root);
-  if (!RootNode)
-    return {};
+  return getReachableNodes(llvm::makeArrayRef(Root));
+}
+
+llvm::DenseSet<const CallGraphNode *>
+HelperDeclRefGraph::getReachableNodes(
+    llvm::ArrayRef<const Decl *> Roots) const {
   llvm::DenseSet<const CallGraphNode *> ConnectedNodes;
-  std::function<void(const CallGraphNode *)> VisitNode =
-      [&](const CallGraphNode *Node) {
-        if (ConnectedNodes.count(Node))
-          return;
-        ConnectedNodes.insert(Node);
-        for (auto It = Node->begin(), End = Node->end(); It != End; ++It)
-          VisitNode(*It);
-      };
-
-  VisitNode(RootNode);
+  // Use an explicit worklist, long chains of helpers would otherwise overflow
+  // the stack.
+  std::vector<const CallGraphNode *> Worklist;
+  for (const Decl *Root : Roots)
+    if (const auto *RootNode = getNode(Root))
+      Worklist.push_back(RootNode);
+  while (!Worklist.empty()) {
+    const CallGraphNode *Node = Worklist.back();
+    Worklist.pop_back();
+    if (!ConnectedNodes.insert(Node).second)
+      continue;
+    for (auto It = Node->begin(), End = Node->end(); It != End; ++It)
+      Worklist.push_back(*It);
+  }
   return ConnectedNodes;
 }
 
@@ -11,6 +11,7 @@
 
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Analysis/CallGraph.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseSet.h"
 #include <memory>
 #include <vector>
@@ -59,6 +60,12 @@ public:
   // including D.
   llvm::DenseSet<const CallGraphNode *> getReachableNodes(const Decl *D) const;
 
+  // Get all reachable nodes in the graph from the nodes of any of the given
+  // declarations, including theirs. Nodes shared by several roots are only
+  // visited once.
+  llvm::DenseSet<const CallGraphNode *>
+  getReachableNodes(llvm::ArrayRef<const Decl *> Roots) const;
+
   // Dump the call graph for debug purpose.
   void dump() const;
 
@@ -73,6 +80,11 @@ private:
 
   // DeclMap owns all CallGraphNodes.
   DeclMapTy DeclMap;
+
+  // Edges already in the graph, keyed by canonical declarations. A helper is
+  // typically referenced many times from the same caller, and CallGraphNode
+  // doesn't deduplicate its callees.
+  llvm::DenseSet<std::pair<const Decl *, const Decl *>> Edges;
 };
 
 // A builder helps to construct a call graph of helper declarations.
@@ -8,6 +8,7 @@
 
 #include "Move.h"
 #include "HelperDeclRefGraph.h"
+#include "clang/AST/ASTConsumer.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Format/Format.h"
@@ -459,12 +460,11 @@ llvm::DenseSet<const Decl *>
 getUsedDecls(const HelperDeclRefGraph *RG,
              const std::vector<const NamedDecl *> &Decls) {
   assert(RG);
-  llvm::DenseSet<const CallGraphNode *> Nodes;
-  for (const auto *D : Decls) {
-    auto Result = RG->getReachableNodes(
-        HelperDeclRGBuilder::getOutmostClassOrFunDecl(D));
-    Nodes.insert(Result.begin(), Result.end());
-  }
+  std::vector<const Decl *> Roots;
+  Roots.reserve(Decls.size());
+  for (const auto *D : Decls)
+    Roots.push_back(HelperDeclRGBuilder::getOutmostClassOrFunDecl(D));
+  llvm::DenseSet<const CallGraphNode *> Nodes = RG->getReachableNodes(Roots);
   llvm::DenseSet<const Decl *> Results;
   for (const auto *Node : Nodes)
     Results.insert(Node->getDecl());
@@ -476,6 +476,9 @@ getUsedDecls(const HelperDeclRefGraph *RG,
 std::unique_ptr<ASTConsumer>
 ClangMoveAction::CreateASTConsumer(CompilerInstance &Compiler,
                                    StringRef /*InFile*/) {
+  // Nothing is left to do once the declarations have been moved.
+  if (Context->MoveOnce && Context->Moved && !Context->DumpDeclarations)
+    return llvm::make_unique<ASTConsumer>();
   Compiler.getPreprocessor().addPPCallbacks(llvm::make_unique<FindAllIncludes>(
       &Compiler.getSourceManager(), &MoveTool));
   return MatchFinder.newASTConsumer();
@@ -900,6 +903,11 @@ void ClangMoveTool::onEndOfTranslationUnit() {
 
   if (RemovedDecls.empty())
     return;
+  if (Context->MoveOnce) {
+    if (Context->Moved)
+      return;
+    Context->Moved = true;
+  }
   // Ignore symbols that are not supported when checking if there is unremoved
   // symbol in old header. This makes sure that we always move old files to new
   // files when all symbols produced from dump_decls are moved.
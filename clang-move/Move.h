@@ -93,6 +93,14 @@ struct ClangMoveContext {
   std::string FallbackStyle;
   // Whether dump all declarations in old header.
   bool DumpDeclarations;
+  // Whether to only move declarations in the first translation unit that has
+  // declarations to move, instead of recomputing the same edits of old.h and
+  // new.h in every translation unit including old.h. The translation unit of
+  // old.cc should then be run first, as it is the one seeing all of the
+  // declarations and helpers being moved.
+  bool MoveOnce;
+  // Set when a translation unit has moved the declarations in MoveOnce mode.
+  bool Moved;
 };
 
 // This tool is used to move class/function definitions from the given source
@@ -203,7 +211,7 @@ class ClangMoveAction : public clang::ASTFrontendAction {
 public:
   ClangMoveAction(ClangMoveContext *const Context,
                   DeclarationReporter *const Reporter)
-      : MoveTool(Context, Reporter) {
+      : Context(Context), MoveTool(Context, Reporter) {
     MoveTool.registerMatchers(&MatchFinder);
   }
 
@@ -214,6 +222,8 @@ public:
                     llvm::StringRef InFile) override;
 
 private:
+  // Not owned.
+  ClangMoveContext *const Context;
   ast_matchers::MatchFinder MatchFinder;
   ClangMoveTool MoveTool;
 };
@@ -7,6 +7,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "Move.h"
+#include "index/FileRefs.h"
+#include "index/Serialization.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
@@ -19,6 +21,7 @@
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/YAMLTraits.h"
+#include <algorithm>
 #include <set>
 #include <string>
 
@@ -91,6 +94,55 @@ cl::opt<bool> DumpDecls(
              "An empty JSON will be returned if old header isn't specified."),
     cl::cat(ClangMoveCategory));
 
+cl::opt<std::string> IndexFile(
+    "index_file",
+    cl::desc("A clangd static index of the code base. If specified, only the "
+             "given files referencing the moved names (or sharing the stem of "
+             "a header that does) are processed."),
+    cl::cat(ClangMoveCategory));
+
+cl::opt<bool> MoveOnce(
+    "move_once",
+    cl::desc("Move the declarations in a single translation unit, old_cc if "
+             "it is given, instead of in every file including old_header. "
+             "The other files are only parsed."),
+    cl::cat(ClangMoveCategory));
+
+// Returns the files of \p Files that the index says may refer to the moved
+// names, or \p Files itself if the index cannot tell.
+std::vector<std::string>
+FilterFilesByIndex(const std::vector<std::string> &Files) {
+  std::unique_ptr<clangd::SymbolIndex> Index = clangd::loadIndex(IndexFile);
+  if (!Index) {
+    llvm::errs() << "Failed to load index " << IndexFile
+                 << ". Processing all files.\n";
+    return Files;
+  }
+  llvm::DenseSet<clangd::SymbolID> IDs;
+  for (StringRef Name : Names) {
+    Name = Name.ltrim(':');
+    size_t Pos = Name.rfind("::");
+    clangd::FuzzyFindRequest Req;
+    if (Pos == StringRef::npos) {
+      Req.Query = Name.str();
+      Req.Scopes = {""};
+    } else {
+      Req.Query = Name.substr(Pos + 2).str();
+      Req.Scopes = {Name.substr(0, Pos + 2).str()};
+    }
+    Index->fuzzyFind(Req, [&](const clangd::Symbol &S) {
+      if (S.Name == Req.Query)
+        IDs.insert(S.ID);
+    });
+  }
+  if (IDs.empty()) {
+    llvm::errs() << "None of the names found in the index. "
+                    "Processing all files.\n";
+    return Files;
+  }
+  return clangd::filterReferencingFiles(*Index, IDs, Files);
+}
+
 } // namespace
 
 int main(int argc, const char **argv) {
@@ -104,8 +156,24 @@ int main(int argc, const char **argv) {
     return 1;
   }
 
-  tooling::RefactoringTool Tool(OptionsParser.getCompilations(),
-                                OptionsParser.getSourcePathList());
+  std::vector<std::string> Files = OptionsParser.getSourcePathList();
+  if (!IndexFile.empty())
+    Files = FilterFilesByIndex(Files);
+  if (MoveOnce && !OldCC.empty()) {
+    // Run old.cc first, so that it is the translation unit moving the
+    // declarations.
+    auto Normalize = [](StringRef Path) {
+      SmallString<128> Result(Path);
+      llvm::sys::fs::make_absolute(Result);
+      llvm::sys::path::remove_dots(Result, /*remove_dot_dot=*/true);
+      return Result;
+    };
+    SmallString<128> AbsoluteOldCC = Normalize(OldCC);
+    std::stable_partition(Files.begin(), Files.end(), [&](StringRef File) {
+      return Normalize(File) == AbsoluteOldCC;
+    });
+  }
+  tooling::RefactoringTool Tool(OptionsParser.getCompilations(), Files);
   // Add "-fparse-all-comments" compile option to make clang parse all comments.
   Tool.appendArgumentsAdjuster(tooling::getInsertArgumentAdjuster(
       "-fparse-all-comments", tooling::ArgumentInsertPosition::BEGIN));
@@ -124,7 +192,9 @@ int main(int argc, const char **argv) {
                              Twine(EC.message()));
 
   move::ClangMoveContext Context{Spec, Tool.getReplacements(),
-                                 InitialDirectory.str(), Style, DumpDecls};
+                                 InitialDirectory.str(), Style,
+                                 DumpDecls, MoveOnce,
+                                 /*Moved=*/false};
   move::DeclarationReporter Reporter;
   move::ClangMoveActionFactory Factory(&Context, &Reporter);
 
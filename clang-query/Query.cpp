@@ -10,6 +10,7 @@
 #include "QuerySession.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/PCHContainerOperations.h"
 #include "clang/Frontend/TextDiagnostic.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -42,12 +43,18 @@ bool HelpQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
         "Set whether to bind the root matcher to \"root\".\n"
         "  set print-matcher (true|false)    "
         "Set whether to print the current matcher,\n"
+        "  set max-matches N                 "
+        "Stop reporting matches after the first N, 0 for no limit.\n"
+        "  set count-only (true|false)       "
+        "Set whether to only print the number of matches.\n"
         "  set output <feature>              "
         "Set whether to output only <feature> content.\n"
         "  enable output <feature>           "
         "Enable <feature> content non-exclusively.\n"
         "  disable output <feature>          "
         "Disable <feature> content non-exclusively.\n"
+        "  reload                            "
+        "Reparse the loaded ASTs from the files on disk.\n"
         "  quit, q                           "
         "Terminates the query session.\n\n"
         "Several commands accept a <feature> parameter. The available features "
@@ -68,14 +75,74 @@ bool QuitQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
   return true;
 }
 
+bool ReloadQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
+  bool Success = true;
+  for (auto &AST : QS.ASTs) {
+    // If the AST was built with a precompiled preamble, Reparse() keeps using
+    // it as long as the files it was built from did not change.
+    if (AST->Reparse(std::make_shared<PCHContainerOperations>())) {
+      OS << "Failed to reload " << AST->getMainFileName() << ".\n";
+      Success = false;
+    }
+  }
+  return Success;
+}
+
 namespace {
 
-struct CollectBoundNodes : MatchFinder::MatchCallback {
-  std::vector<BoundNodes> &Bindings;
-  CollectBoundNodes(std::vector<BoundNodes> &Bindings) : Bindings(Bindings) {}
+/// Prints each match as soon as the matcher finds it, so that the bound nodes
+/// of a query are never all held at once.
+class PrintBoundNodes : public MatchFinder::MatchCallback {
+public:
+  PrintBoundNodes(llvm::raw_ostream &OS, const QuerySession &QS, ASTUnit &AST,
+                  unsigned &MatchCount)
+      : OS(OS), QS(QS), AST(AST), MatchCount(MatchCount) {}
+
   void run(const MatchFinder::MatchResult &Result) override {
-    Bindings.push_back(Result.Nodes);
+    // MatchFinder cannot be interrupted, so once the limit is reached the
+    // remaining matches of this AST are only skipped.
+    if (QS.MaxMatches && MatchCount >= QS.MaxMatches)
+      return;
+    ++MatchCount;
+    if (QS.CountOnly)
+      return;
+
+    OS << "\nMatch #" << MatchCount << ":\n\n";
+
+    const BoundNodes::IDToNodeMap &Map = Result.Nodes.getMap();
+    for (auto BI = Map.begin(), BE = Map.end(); BI != BE; ++BI) {
+      if (QS.DiagOutput) {
+        clang::SourceRange R = BI->second.getSourceRange();
+        if (R.isValid()) {
+          TextDiagnostic TD(OS, AST.getASTContext().getLangOpts(),
+                            &AST.getDiagnostics().getDiagnosticOptions());
+          TD.emitDiagnostic(
+              FullSourceLoc(R.getBegin(), AST.getSourceManager()),
+              DiagnosticsEngine::Note, "\"" + BI->first + "\" binds here",
+              CharSourceRange::getTokenRange(R), None);
+        }
+      }
+      if (QS.PrintOutput) {
+        OS << "Binding for \"" << BI->first << "\":\n";
+        BI->second.print(OS, AST.getASTContext().getPrintingPolicy());
+        OS << "\n";
+      }
+      if (QS.DetailedASTOutput) {
+        OS << "Binding for \"" << BI->first << "\":\n";
+        BI->second.dump(OS, AST.getSourceManager());
+        OS << "\n";
+      }
+    }
+
+    if (Map.empty())
+      OS << "No bindings.\n";
   }
+
+private:
+  llvm::raw_ostream &OS;
+  const QuerySession &QS;
+  ASTUnit &AST;
+  unsigned &MatchCount;
 };
 
 } // namespace
@@ -84,20 +151,22 @@ bool MatchQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
   unsigned MatchCount = 0;
 
   for (auto &AST : QS.ASTs) {
+    // Later ASTs cannot add anything once the limit is reached.
+    if (QS.MaxMatches && MatchCount >= QS.MaxMatches)
+      break;
+
     MatchFinder Finder;
-    std::vector<BoundNodes> Matches;
     DynTypedMatcher MaybeBoundMatcher = Matcher;
     if (QS.BindRoot) {
       llvm::Optional<DynTypedMatcher> M = Matcher.tryBind("root");
       if (M)
         MaybeBoundMatcher = *M;
     }
-    CollectBoundNodes Collect(Matches);
-    if (!Finder.addDynamicMatcher(MaybeBoundMatcher, &Collect)) {
+    PrintBoundNodes Print(OS, QS, *AST, MatchCount);
+    if (!Finder.addDynamicMatcher(MaybeBoundMatcher, &Print)) {
       OS << "Not a valid top-level matcher.\n";
       return false;
     }
-    Finder.matchAST(AST->getASTContext());
 
     if (QS.PrintMatcher) {
       std::string prefixText = "Matcher: ";
@@ -105,40 +174,12 @@ bool MatchQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
       OS << "  " << std::string(prefixText.size() + Source.size(), '=') << '\n';
     }
 
-    for (auto MI = Matches.begin(), ME = Matches.end(); MI != ME; ++MI) {
-      OS << "\nMatch #" << ++MatchCount << ":\n\n";
-
-      for (auto BI = MI->getMap().begin(), BE = MI->getMap().end(); BI != BE;
-           ++BI) {
-        if (QS.DiagOutput) {
-          clang::SourceRange R = BI->second.getSourceRange();
-          if (R.isValid()) {
-            TextDiagnostic TD(OS, AST->getASTContext().getLangOpts(),
-                              &AST->getDiagnostics().getDiagnosticOptions());
-            TD.emitDiagnostic(
-                FullSourceLoc(R.getBegin(), AST->getSourceManager()),
-                DiagnosticsEngine::Note, "\"" + BI->first + "\" binds here",
-                CharSourceRange::getTokenRange(R), None);
-          }
-        }
-        if (QS.PrintOutput) {
-          OS << "Binding for \"" << BI->first << "\":\n";
-          BI->second.print(OS, AST->getASTContext().getPrintingPolicy());
-          OS << "\n";
-        }
-        if (QS.DetailedASTOutput) {
-          OS << "Binding for \"" << BI->first << "\":\n";
-          BI->second.dump(OS, AST->getSourceManager());
-          OS << "\n";
-        }
-      }
-
-      if (MI->getMap().empty())
-        OS << "No bindings.\n";
-    }
+    Finder.matchAST(AST->getASTContext());
   }
 
   OS << MatchCount << (MatchCount == 1 ? " match.\n" : " matches.\n");
+  if (QS.MaxMatches && MatchCount >= QS.MaxMatches)
+    OS << "Stopped at max-matches, results may be incomplete.\n";
   return true;
 }
 
@@ -153,6 +194,7 @@ bool LetQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
 
 #ifndef _MSC_VER
 const QueryKind SetQueryKind<bool>::value;
+const QueryKind SetQueryKind<unsigned>::value;
 const QueryKind SetQueryKind<OutputKind>::value;
 #endif
 
@@ -27,10 +27,12 @@ enum QueryKind {
   QK_Let,
   QK_Match,
   QK_SetBool,
+  QK_SetUnsigned,
   QK_SetOutputKind,
   QK_EnableOutputKind,
   QK_DisableOutputKind,
-  QK_Quit
+  QK_Quit,
+  QK_Reload
 };
 
 class QuerySession;
@@ -83,6 +85,14 @@ struct QuitQuery : Query {
   static bool classof(const Query *Q) { return Q->Kind == QK_Quit; }
 };
 
+/// Query for "reload".
+struct ReloadQuery : Query {
+  ReloadQuery() : Query(QK_Reload) {}
+  bool run(llvm::raw_ostream &OS, QuerySession &QS) const override;
+
+  static bool classof(const Query *Q) { return Q->Kind == QK_Reload; }
+};
+
 /// Query for "match MATCHER".
 struct MatchQuery : Query {
   MatchQuery(StringRef Source,
@@ -114,6 +124,10 @@ template <> struct SetQueryKind<bool> {
   static const QueryKind value = QK_SetBool;
 };
 
+template <> struct SetQueryKind<unsigned> {
+  static const QueryKind value = QK_SetUnsigned;
+};
+
 template <> struct SetQueryKind<OutputKind> {
   static const QueryKind value = QK_SetOutputKind;
 };
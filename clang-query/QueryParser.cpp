@@ -98,6 +98,16 @@ QueryRef QueryParser::parseSetBool(bool QuerySession::*Var) {
   return new SetQuery<bool>(Var, Value);
 }
 
+QueryRef QueryParser::parseSetUnsigned(unsigned QuerySession::*Var) {
+  StringRef ValStr = lexWord();
+  unsigned Value;
+  if (ValStr.getAsInteger(10, Value)) {
+    return new InvalidQuery("expected a non-negative integer, got '" + ValStr +
+                            "'");
+  }
+  return new SetQuery<unsigned>(Var, Value);
+}
+
 template <typename QueryType> QueryRef QueryParser::parseSetOutputKind() {
   StringRef ValStr;
   unsigned OutKind = LexOrCompleteWord<unsigned>(this, ValStr)
@@ -144,14 +154,17 @@ enum ParsedQueryKind {
   PQK_Unlet,
   PQK_Quit,
   PQK_Enable,
-  PQK_Disable
+  PQK_Disable,
+  PQK_Reload
 };
 
 enum ParsedQueryVariable {
   PQV_Invalid,
   PQV_Output,
   PQV_BindRoot,
-  PQV_PrintMatcher
+  PQV_PrintMatcher,
+  PQV_MaxMatches,
+  PQV_CountOnly
 };
 
 QueryRef makeInvalidQueryFromDiagnostics(const Diagnostics &Diag) {
@@ -188,6 +201,7 @@ QueryRef QueryParser::doParse() {
                               .Case("enable", PQK_Enable)
                               .Case("disable", PQK_Disable)
                               .Case("unlet", PQK_Unlet)
+                              .Case("reload", PQK_Reload)
                               .Default(PQK_Invalid);
 
   switch (QKind) {
@@ -201,6 +215,9 @@ QueryRef QueryParser::doParse() {
   case PQK_Quit:
     return endQuery(new QuitQuery);
 
+  case PQK_Reload:
+    return endQuery(new ReloadQuery);
+
   case PQK_Let: {
     StringRef Name = lexWord();
 
@@ -241,6 +258,8 @@ QueryRef QueryParser::doParse() {
             .Case("output", PQV_Output)
             .Case("bind-root", PQV_BindRoot)
             .Case("print-matcher", PQV_PrintMatcher)
+            .Case("max-matches", PQV_MaxMatches)
+            .Case("count-only", PQV_CountOnly)
             .Default(PQV_Invalid);
     if (VarStr.empty())
       return new InvalidQuery("expected variable name");
@@ -258,6 +277,12 @@ QueryRef QueryParser::doParse() {
     case PQV_PrintMatcher:
       Q = parseSetBool(&QuerySession::PrintMatcher);
       break;
+    case PQV_MaxMatches:
+      Q = parseSetUnsigned(&QuerySession::MaxMatches);
+      break;
+    case PQV_CountOnly:
+      Q = parseSetBool(&QuerySession::CountOnly);
+      break;
     case PQV_Invalid:
       llvm_unreachable("Invalid query kind");
     }
@@ -25,7 +25,7 @@ public:
   QuerySession(llvm::ArrayRef<std::unique_ptr<ASTUnit>> ASTs)
       : ASTs(ASTs), PrintOutput(false), DiagOutput(true),
         DetailedASTOutput(false), BindRoot(true), PrintMatcher(false),
-        Terminate(false) {}
+        CountOnly(false), MaxMatches(0), Terminate(false) {}
 
   llvm::ArrayRef<std::unique_ptr<ASTUnit>> ASTs;
 
@@ -35,6 +35,9 @@ public:
 
   bool BindRoot;
   bool PrintMatcher;
+  bool CountOnly;
+  /// Number of matches after which a match query stops, 0 for no limit.
+  unsigned MaxMatches;
   bool Terminate;
   llvm::StringMap<ast_matchers::dynamic::VariantValue> NamedValues;
 };
@@ -29,14 +29,18 @@
 #include "QueryParser.h"
 #include "QuerySession.h"
 #include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/LineEditor/LineEditor.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include <fstream>
 #include <string>
+#include <vector>
 
 using namespace clang;
 using namespace clang::ast_matchers;
@@ -62,6 +66,58 @@ static cl::opt<std::string> PreloadFile(
     cl::desc("Preload commands from file and start interactive mode"),
     cl::value_desc("file"), cl::cat(ClangQueryCategory));
 
+static cl::opt<bool> Stream(
+    "stream",
+    cl::desc("Build the ASTs on a thread pool and run the -c or -f commands\n"
+             "on each file as soon as its AST is ready, releasing the AST\n"
+             "afterwards, instead of loading every AST up front. Results\n"
+             "are printed per file, in input order."),
+    cl::cat(ClangQueryCategory));
+
+static cl::opt<unsigned> Jobs(
+    "j",
+    cl::desc("Number of ASTs to build in parallel with -stream.\n"
+             "0 uses all cores."),
+    cl::init(0), cl::cat(ClangQueryCategory));
+
+static cl::opt<bool> Preamble(
+    "preamble",
+    cl::desc("Build the ASTs with a precompiled preamble, so that the\n"
+             "\"reload\" command only reparses the code following the\n"
+             "includes of files whose headers did not change."),
+    cl::cat(ClangQueryCategory));
+
+namespace {
+
+/// Builds ASTs like ClangTool::buildASTs(), but asks ASTUnit to precompile
+/// the preamble of each file on its first parse.
+class PreambleASTBuilderAction : public ToolAction {
+  std::vector<std::unique_ptr<ASTUnit>> &ASTs;
+
+public:
+  PreambleASTBuilderAction(std::vector<std::unique_ptr<ASTUnit>> &ASTs)
+      : ASTs(ASTs) {}
+
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override {
+    std::unique_ptr<ASTUnit> AST = ASTUnit::LoadFromCompilerInvocation(
+        Invocation, std::move(PCHContainerOps),
+        CompilerInstance::createDiagnostics(&Invocation->getDiagnosticOpts(),
+                                            DiagConsumer,
+                                            /*ShouldOwnClient=*/false),
+        Files, /*OnlyLocalDecls=*/false, /*CaptureDiagnostics=*/false,
+        /*PrecompilePreambleAfterNParses=*/1);
+    if (!AST)
+      return false;
+    ASTs.push_back(std::move(AST));
+    return true;
+  }
+};
+
+} // namespace
+
 bool runCommandsInFile(const char *ExeName, std::string const &FileName,
                        QuerySession &QS) {
   std::ifstream Input(FileName.c_str());
@@ -80,6 +136,84 @@ bool runCommandsInFile(const char *ExeName, std::string const &FileName,
   return false;
 }
 
+static bool readCommandsInFile(const char *ExeName, std::string const &FileName,
+                               std::vector<std::string> &Lines) {
+  std::ifstream Input(FileName.c_str());
+  if (!Input.is_open()) {
+    llvm::errs() << ExeName << ": cannot open " << FileName << "\n";
+    return true;
+  }
+  while (Input.good()) {
+    std::string Line;
+    std::getline(Input, Line);
+    Lines.push_back(std::move(Line));
+  }
+  return false;
+}
+
+/// Runs \p Lines against each file of \p SourcePaths in its own session.
+/// ASTs are built on a thread pool and released once their file has been
+/// queried, so memory use is bounded by the number of jobs rather than by the
+/// number of inputs. The output of each file is buffered and printed in input
+/// order.
+static int runStreaming(const CompilationDatabase &Compilations,
+                        ArrayRef<std::string> SourcePaths,
+                        ArrayRef<std::string> Lines) {
+  struct FileResult {
+    std::string Output;
+    bool BuildFailed = false;
+    bool QueryFailed = false;
+  };
+  std::vector<FileResult> Results(SourcePaths.size());
+  std::vector<std::shared_future<void>> Done;
+  Done.reserve(SourcePaths.size());
+
+  ThreadPool Pool(Jobs == 0 ? llvm::hardware_concurrency() : unsigned(Jobs));
+  for (size_t I = 0; I < SourcePaths.size(); ++I)
+    Done.push_back(Pool.async([&, I] {
+      FileResult &Result = Results[I];
+      ClangTool Tool(Compilations, SourcePaths[I]);
+      std::vector<std::unique_ptr<ASTUnit>> ASTs;
+      if (Tool.buildASTs(ASTs) != 0)
+        Result.BuildFailed = true;
+      if (ASTs.empty())
+        return;
+
+      QuerySession QS(ASTs);
+      llvm::raw_string_ostream OS(Result.Output);
+      for (const std::string &Line : Lines) {
+        QueryRef Q = QueryParser::parse(Line, QS);
+        if (!Q->run(OS, QS)) {
+          Result.QueryFailed = true;
+          break;
+        }
+      }
+      OS.flush();
+    }));
+
+  unsigned BuildFailures = 0;
+  bool QueryFailed = false;
+  for (size_t I = 0; I < SourcePaths.size(); ++I) {
+    Done[I].wait();
+    FileResult &Result = Results[I];
+    llvm::outs() << Result.Output;
+    llvm::outs().flush();
+    std::string().swap(Result.Output);
+    BuildFailures += Result.BuildFailed;
+    QueryFailed |= Result.QueryFailed;
+  }
+
+  if (QueryFailed || BuildFailures == SourcePaths.size())
+    return 1;
+  if (BuildFailures != 0) {
+    llvm::errs() << "Failed to build AST for some of the files, "
+                 << "results may be incomplete."
+                 << "\n";
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, const char **argv) {
   llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
 
@@ -96,10 +230,24 @@ int main(int argc, const char **argv) {
     return 1;
   }
 
+  if (Stream) {
+    if (Commands.empty() && CommandFiles.empty()) {
+      llvm::errs() << argv[0] << ": --stream requires -c or -f\n";
+      return 1;
+    }
+    std::vector<std::string> Lines(Commands.begin(), Commands.end());
+    for (const std::string &File : CommandFiles)
+      if (readCommandsInFile(argv[0], File, Lines))
+        return 1;
+    return runStreaming(OptionsParser.getCompilations(),
+                        OptionsParser.getSourcePathList(), Lines);
+  }
+
   ClangTool Tool(OptionsParser.getCompilations(),
                  OptionsParser.getSourcePathList());
   std::vector<std::unique_ptr<ASTUnit>> ASTs;
-  int Status = Tool.buildASTs(ASTs);
+  PreambleASTBuilderAction PreambleBuilder(ASTs);
+  int Status = Preamble ? Tool.run(&PreambleBuilder) : Tool.buildASTs(ASTs);
   int ASTStatus = 0;
   if (Status == 1) {
     // Building ASTs failed.
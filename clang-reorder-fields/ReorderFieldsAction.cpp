@@ -17,6 +17,7 @@
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
+#include "clang/AST/RecordLayout.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Lex/Lexer.h"
@@ -78,6 +79,73 @@ getNewFieldsOrder(const RecordDecl *Definition,
   return NewFieldsOrder;
 }
 
+/// \brief Calculates an order of fields that minimizes the padding in the
+/// record, by sorting the fields by decreasing alignment.
+///
+/// Fields are only moved between positions with the same access, as
+/// reordering fields with different accesses is not supported.
+/// \returns empty vector if no order can be computed for the record, and
+/// the current order if sorting doesn't make the record smaller.
+static SmallVector<unsigned, 4>
+getPaddingMinimizingFieldsOrder(const RecordDecl *Definition,
+                                const ASTContext &Context) {
+  assert(Definition && "Definition is null");
+
+  SmallVector<const FieldDecl *, 10> Fields;
+  for (const auto *Field : Definition->fields()) {
+    if (Field->isBitField() || Field->getType()->isIncompleteType()) {
+      llvm::errs() << "Cannot compute the fields order of "
+                   << Definition->getName()
+                   << ": bit-fields and flexible array members are not "
+                      "supported\n";
+      return {};
+    }
+    Fields.push_back(Field);
+  }
+  if (Fields.empty() || Definition->isDependentType()) {
+    llvm::errs() << "Cannot compute the fields order of "
+                 << Definition->getName() << "\n";
+    return {};
+  }
+
+  SmallVector<unsigned, 4> NewFieldsOrder;
+  for (unsigned I = 0, E = Fields.size(); I < E; ++I)
+    NewFieldsOrder.push_back(I);
+  // The fields of a union or a packed record aren't padded.
+  if (Definition->isUnion() || Definition->hasAttr<PackedAttr>())
+    return NewFieldsOrder;
+
+  // Sort the fields of each access, leaving the positions of each access
+  // where they are.
+  for (AccessSpecifier Access :
+       {AS_public, AS_protected, AS_private, AS_none}) {
+    SmallVector<unsigned, 10> Positions;
+    for (unsigned I = 0, E = Fields.size(); I < E; ++I)
+      if (Fields[I]->getAccess() == Access)
+        Positions.push_back(I);
+    SmallVector<unsigned, 10> SortedFields(Positions.begin(), Positions.end());
+    std::stable_sort(SortedFields.begin(), SortedFields.end(),
+                     [&](unsigned LHS, unsigned RHS) {
+                       return Context.getDeclAlign(Fields[LHS]) >
+                              Context.getDeclAlign(Fields[RHS]);
+                     });
+    for (unsigned I = 0, E = Positions.size(); I < E; ++I)
+      NewFieldsOrder[Positions[I]] = SortedFields[I];
+  }
+
+  // Lay out the fields in the new order after the bases, and keep the
+  // current order unless that makes the record smaller.
+  const ASTRecordLayout &Layout = Context.getASTRecordLayout(Definition);
+  CharUnits Offset = Context.toCharUnitsFromBits(Layout.getFieldOffset(0));
+  for (unsigned Index : NewFieldsOrder)
+    Offset = Offset.alignTo(Context.getDeclAlign(Fields[Index])) +
+             Context.getTypeSizeInChars(Fields[Index]->getType());
+  if (Offset.alignTo(Layout.getAlignment()) >= Layout.getSize())
+    for (unsigned I = 0, E = Fields.size(); I < E; ++I)
+      NewFieldsOrder[I] = I;
+  return NewFieldsOrder;
+}
+
 // FIXME: error-handling
 /// \brief Replaces one range of source code by another.
 static void
@@ -247,63 +315,79 @@ static bool reorderFieldsInInitListExpr(
   return true;
 }
 
+/// \brief Reorders the fields of one record, along with the initializers in
+/// its constructors and in brace initializations of it.
+///
+/// \returns true on success.
+static bool
+reorderRecord(const RecordReordering &Reordering, ASTContext &Context,
+              std::map<std::string, tooling::Replacements> &Replacements) {
+  const RecordDecl *RD = findDefinition(Reordering.RecordName, Context);
+  if (!RD)
+    return false;
+  SmallVector<unsigned, 4> NewFieldsOrder =
+      Reordering.FieldsOrder.empty()
+          ? getPaddingMinimizingFieldsOrder(RD, Context)
+          : getNewFieldsOrder(RD, Reordering.FieldsOrder);
+  if (NewFieldsOrder.empty())
+    return false;
+  if (!reorderFieldsInDefinition(RD, NewFieldsOrder, Context, Replacements))
+    return false;
+
+  // CXXRD will be nullptr if C code (not C++) is being processed.
+  const CXXRecordDecl *CXXRD = dyn_cast<CXXRecordDecl>(RD);
+  if (CXXRD)
+    for (const auto *C : CXXRD->ctors())
+      if (const auto *D = dyn_cast<CXXConstructorDecl>(C->getDefinition()))
+        reorderFieldsInConstructor(cast<const CXXConstructorDecl>(D),
+                                   NewFieldsOrder, Context, Replacements);
+
+  // We only need to reorder init list expressions for
+  // plain C structs or C++ aggregate types.
+  // For other types the order of constructor parameters is used,
+  // which we don't change at the moment.
+  // Now (v0) partial initialization is not supported.
+  if (!CXXRD || CXXRD->isAggregate())
+    for (auto Result :
+         match(initListExpr(hasType(equalsNode(RD))).bind("initListExpr"),
+               Context))
+      if (!reorderFieldsInInitListExpr(
+              Result.getNodeAs<InitListExpr>("initListExpr"), NewFieldsOrder,
+              Context, Replacements))
+        return false;
+  return true;
+}
+
 namespace {
 class ReorderingConsumer : public ASTConsumer {
-  StringRef RecordName;
-  ArrayRef<std::string> DesiredFieldsOrder;
+  ArrayRef<RecordReordering> Reorderings;
   std::map<std::string, tooling::Replacements> &Replacements;
 
 public:
-  ReorderingConsumer(StringRef RecordName,
-                     ArrayRef<std::string> DesiredFieldsOrder,
+  ReorderingConsumer(ArrayRef<RecordReordering> Reorderings,
                      std::map<std::string, tooling::Replacements> &Replacements)
-      : RecordName(RecordName), DesiredFieldsOrder(DesiredFieldsOrder),
-        Replacements(Replacements) {}
+      : Reorderings(Reorderings), Replacements(Replacements) {}
 
   ReorderingConsumer(const ReorderingConsumer &) = delete;
   ReorderingConsumer &operator=(const ReorderingConsumer &) = delete;
 
   void HandleTranslationUnit(ASTContext &Context) override {
-    const RecordDecl *RD = findDefinition(RecordName, Context);
-    if (!RD)
-      return;
-    SmallVector<unsigned, 4> NewFieldsOrder =
-        getNewFieldsOrder(RD, DesiredFieldsOrder);
-    if (NewFieldsOrder.empty())
-      return;
-    if (!reorderFieldsInDefinition(RD, NewFieldsOrder, Context, Replacements))
-      return;
-
-    // CXXRD will be nullptr if C code (not C++) is being processed.
-    const CXXRecordDecl *CXXRD = dyn_cast<CXXRecordDecl>(RD);
-    if (CXXRD)
-      for (const auto *C : CXXRD->ctors())
-        if (const auto *D = dyn_cast<CXXConstructorDecl>(C->getDefinition()))
-          reorderFieldsInConstructor(cast<const CXXConstructorDecl>(D),
-                                     NewFieldsOrder, Context, Replacements);
-
-    // We only need to reorder init list expressions for
-    // plain C structs or C++ aggregate types.
-    // For other types the order of constructor parameters is used,
-    // which we don't change at the moment.
-    // Now (v0) partial initialization is not supported.
-    if (!CXXRD || CXXRD->isAggregate())
-      for (auto Result :
-           match(initListExpr(hasType(equalsNode(RD))).bind("initListExpr"),
-                 Context))
-        if (!reorderFieldsInInitListExpr(
-                Result.getNodeAs<InitListExpr>("initListExpr"), NewFieldsOrder,
-                Context, Replacements)) {
-          Replacements.clear();
-          return;
-        }
+    for (const RecordReordering &Reordering : Reorderings) {
+      // Collect the replacements of each record separately, so that a
+      // record that can't be reordered leaves the others alone.
+      std::map<std::string, tooling::Replacements> RecordReplacements;
+      if (!reorderRecord(Reordering, Context, RecordReplacements))
+        continue;
+      for (const auto &FileAndReplaces : RecordReplacements)
+        for (const tooling::Replacement &R : FileAndReplaces.second)
+          consumeError(Replacements[FileAndReplaces.first].add(R));
+    }
   }
 };
 } // end anonymous namespace
 
 std::unique_ptr<ASTConsumer> ReorderFieldsAction::newASTConsumer() {
-  return llvm::make_unique<ReorderingConsumer>(RecordName, DesiredFieldsOrder,
-                                               Replacements);
+  return llvm::make_unique<ReorderingConsumer>(Reorderings, Replacements);
 }
 
 } // namespace reorder_fields
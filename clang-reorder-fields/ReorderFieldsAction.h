@@ -8,7 +8,7 @@
 ///
 /// \file
 /// This file contains the declarations of the ReorderFieldsAction class and
-/// the FieldPosition struct.
+/// the RecordReordering struct.
 ///
 //===----------------------------------------------------------------------===//
 
@@ -22,9 +22,17 @@ class ASTConsumer;
 
 namespace reorder_fields {
 
+/// \brief A record to reorder, and the desired order of its fields.
+///
+/// An empty FieldsOrder asks for an order that minimizes the padding in the
+/// record.
+struct RecordReordering {
+  std::string RecordName;
+  std::vector<std::string> FieldsOrder;
+};
+
 class ReorderFieldsAction {
-  llvm::StringRef RecordName;
-  llvm::ArrayRef<std::string> DesiredFieldsOrder;
+  std::vector<RecordReordering> Reorderings;
   std::map<std::string, tooling::Replacements> &Replacements;
 
 public:
@@ -32,8 +40,17 @@ public:
       llvm::StringRef RecordName,
       llvm::ArrayRef<std::string> DesiredFieldsOrder,
       std::map<std::string, tooling::Replacements> &Replacements)
-      : RecordName(RecordName), DesiredFieldsOrder(DesiredFieldsOrder),
-        Replacements(Replacements) {}
+      : Reorderings(1), Replacements(Replacements) {
+    Reorderings[0].RecordName = RecordName;
+    Reorderings[0].FieldsOrder = DesiredFieldsOrder;
+  }
+
+  /// \brief Reorders all of the given records in a single pass over each
+  /// translation unit.
+  ReorderFieldsAction(
+      llvm::ArrayRef<RecordReordering> Reorderings,
+      std::map<std::string, tooling::Replacements> &Replacements)
+      : Reorderings(Reorderings), Replacements(Replacements) {}
 
   ReorderFieldsAction(const ReorderFieldsAction &) = delete;
   ReorderFieldsAction &operator=(const ReorderFieldsAction &) = delete;
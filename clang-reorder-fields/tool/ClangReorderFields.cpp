@@ -25,6 +25,7 @@
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <cstdlib>
 #include <string>
 #include <system_error>
@@ -35,20 +36,63 @@ using namespace clang;
 cl::OptionCategory ClangReorderFieldsCategory("clang-reorder-fields options");
 
 static cl::opt<std::string>
-    RecordName("record-name", cl::Required,
-               cl::desc("The name of the struct/class."),
+    RecordName("record-name", cl::desc("The name of the struct/class."),
                cl::cat(ClangReorderFieldsCategory));
 
 static cl::list<std::string> FieldsOrder("fields-order", cl::CommaSeparated,
-                                         cl::OneOrMore,
+                                         cl::ZeroOrMore,
                                          cl::desc("The desired fields order."),
                                          cl::cat(ClangReorderFieldsCategory));
 
+static cl::opt<bool> AutoOrder(
+    "auto-order",
+    cl::desc("Reorder the fields of -record-name to minimize padding,\n"
+             "instead of using -fields-order."),
+    cl::cat(ClangReorderFieldsCategory));
+
+static cl::opt<std::string> SpecFile(
+    "spec-file",
+    cl::desc("A file listing the records to reorder in a single run, one\n"
+             "per line as '<record-name> <field>,<field>,...'. A record\n"
+             "without a fields order is reordered to minimize padding.\n"
+             "Empty lines and lines starting with '#' are ignored."),
+    cl::cat(ClangReorderFieldsCategory));
+
 static cl::opt<bool> Inplace("i", cl::desc("Overwrite edited files."),
                              cl::cat(ClangReorderFieldsCategory));
 
 const char Usage[] = "A tool to reorder fields in C/C++ structs/classes.\n";
 
+/// \brief Reads the records to reorder from the -spec-file.
+static bool
+readSpecFile(StringRef Path,
+             std::vector<reorder_fields::RecordReordering> &Reorderings) {
+  auto Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer) {
+    errs() << "Cannot read " << Path << ": " << Buffer.getError().message()
+           << "\n";
+    return false;
+  }
+  SmallVector<StringRef, 16> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    Line = Line.trim();
+    if (Line.empty() || Line.startswith("#"))
+      continue;
+    size_t NameEnd = Line.find_first_of(" \t");
+    StringRef Name = Line.substr(0, NameEnd);
+    StringRef Order = Line.substr(NameEnd);
+    reorder_fields::RecordReordering Reordering;
+    Reordering.RecordName = Name.str();
+    SmallVector<StringRef, 8> Fields;
+    Order.trim().split(Fields, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+    for (StringRef Field : Fields)
+      Reordering.FieldsOrder.push_back(Field.trim().str());
+    Reorderings.push_back(std::move(Reordering));
+  }
+  return true;
+}
+
 int main(int argc, const char **argv) {
   tooling::CommonOptionsParser OP(argc, argv, ClangReorderFieldsCategory,
                                   Usage);
@@ -56,7 +100,26 @@ int main(int argc, const char **argv) {
   auto Files = OP.getSourcePathList();
   tooling::RefactoringTool Tool(OP.getCompilations(), Files);
 
-  reorder_fields::ReorderFieldsAction Action(RecordName, FieldsOrder,
+  std::vector<reorder_fields::RecordReordering> Reorderings;
+  if (!SpecFile.empty() && !readSpecFile(SpecFile, Reorderings))
+    return 1;
+  if (!RecordName.empty()) {
+    if (FieldsOrder.empty() == !AutoOrder) {
+      errs() << "Exactly one of -fields-order and -auto-order must be given "
+                "with -record-name\n";
+      return 1;
+    }
+    reorder_fields::RecordReordering Reordering;
+    Reordering.RecordName = RecordName;
+    Reordering.FieldsOrder.assign(FieldsOrder.begin(), FieldsOrder.end());
+    Reorderings.push_back(std::move(Reordering));
+  }
+  if (Reorderings.empty()) {
+    errs() << "Either -record-name or -spec-file must be given\n";
+    return 1;
+  }
+
+  reorder_fields::ReorderFieldsAction Action(Reorderings,
                                              Tool.getReplacements());
 
   auto Factory = tooling::newFrontendActionFactory(&Action);
@@ -19,6 +19,7 @@
 #include "ClangTidyModuleRegistry.h"
 #include "ClangTidyProfiling.h"
 #include "ExpandModularHeadersPPCallbacks.h"
+#include "ResultCache.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
@@ -43,9 +44,19 @@
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/ReplacementsYaml.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/Regex.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <mutex>
 #include <utility>
 
 using namespace clang::ast_matchers;
@@ -96,12 +107,14 @@ private:
 class ErrorReporter {
 public:
   ErrorReporter(ClangTidyContext &Context, bool ApplyFixes,
-                llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> BaseFS)
+                llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> BaseFS,
+                unsigned NumThreads)
       : Files(FileSystemOptions(), BaseFS), DiagOpts(new DiagnosticOptions()),
         DiagPrinter(new TextDiagnosticPrinter(llvm::outs(), &*DiagOpts)),
         Diags(IntrusiveRefCntPtr<DiagnosticIDs>(new DiagnosticIDs), &*DiagOpts,
               DiagPrinter),
         SourceMgr(Diags, Files), Context(Context), ApplyFixes(ApplyFixes),
+        NumThreads(NumThreads ? NumThreads : llvm::hardware_concurrency()),
         TotalFixes(0), AppliedFixes(0), WarningsAsErrors(0) {
     DiagOpts->ShowColors = llvm::sys::Process::StandardOutHasColors();
     DiagPrinter->BeginSourceFile(LangOpts);
@@ -190,51 +203,40 @@ public:
   }
 
   void Finish() {
-    if (ApplyFixes && TotalFixes > 0) {
-      Rewriter Rewrite(SourceMgr, LangOpts);
-      for (const auto &FileAndReplacements : FileReplacements) {
-        StringRef File = FileAndReplacements.first();
-        llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
-            SourceMgr.getFileManager().getBufferForFile(File);
-        if (!Buffer) {
-          llvm::errs() << "Can't get buffer for file " << File << ": "
-                       << Buffer.getError().message() << "\n";
-          // FIXME: Maybe don't apply fixes for other files as well.
-          continue;
-        }
-        StringRef Code = Buffer.get()->getBuffer();
-        auto Style = format::getStyle(
-            *Context.getOptionsForFile(File).FormatStyle, File, "none");
-        if (!Style) {
-          llvm::errs() << llvm::toString(Style.takeError()) << "\n";
-          continue;
-        }
-        llvm::Expected<tooling::Replacements> Replacements =
-            format::cleanupAroundReplacements(Code, FileAndReplacements.second,
-                                              *Style);
-        if (!Replacements) {
-          llvm::errs() << llvm::toString(Replacements.takeError()) << "\n";
-          continue;
-        }
-        if (llvm::Expected<tooling::Replacements> FormattedReplacements =
-                format::formatReplacements(Code, *Replacements, *Style)) {
-          Replacements = std::move(FormattedReplacements);
-          if (!Replacements)
-            llvm_unreachable("!Replacements");
-        } else {
-          llvm::errs() << llvm::toString(FormattedReplacements.takeError())
-                       << ". Skipping formatting.\n";
-        }
-        if (!tooling::applyAllReplacements(Replacements.get(), Rewrite)) {
-          llvm::errs() << "Can't apply replacements for file " << File << "\n";
-        }
-      }
-      if (Rewrite.overwriteChangedFiles()) {
-        llvm::errs() << "clang-tidy failed to apply suggested fixes.\n";
-      } else {
-        llvm::errs() << "clang-tidy applied " << AppliedFixes << " of "
-                     << TotalFixes << " suggested fixes.\n";
-      }
+    if (!ApplyFixes || TotalFixes == 0)
+      return;
+    std::vector<FileFixes> Fixes;
+    for (const auto &FileAndReplacements : FileReplacements) {
+      Fixes.emplace_back();
+      FileFixes &Fix = Fixes.back();
+      Fix.File = FileAndReplacements.first();
+      Fix.Replaces = &FileAndReplacements.second;
+      // The options provider may not be thread-safe.
+      Fix.FormatStyle = *Context.getOptionsForFile(Fix.File).FormatStyle;
+    }
+
+    // Files are independent, they are fixed and formatted in parallel.
+    llvm::vfs::FileSystem &FS = Files.getVirtualFileSystem();
+    if (NumThreads > 1 && Fixes.size() > 1) {
+      llvm::ThreadPool Pool(std::min<size_t>(NumThreads, Fixes.size()));
+      for (FileFixes &Fix : Fixes)
+        Pool.async([&FS, &Fix] { applyFixes(Fix, FS); });
+      Pool.wait();
+    } else {
+      for (FileFixes &Fix : Fixes)
+        applyFixes(Fix, FS);
+    }
+
+    bool WriteFailed = false;
+    for (const FileFixes &Fix : Fixes) {
+      llvm::errs() << Fix.Errors;
+      WriteFailed |= Fix.WriteFailed;
+    }
+    if (WriteFailed) {
+      llvm::errs() << "clang-tidy failed to apply suggested fixes.\n";
+    } else {
+      llvm::errs() << "clang-tidy applied " << AppliedFixes << " of "
+                   << TotalFixes << " suggested fixes.\n";
     }
   }
 
@@ -250,6 +252,95 @@ private:
     return SourceMgr.getLocForStartOfFile(ID).getLocWithOffset(Offset);
   }
 
+  /// The replacements of a file, and the outcome of applying them.
+  struct FileFixes {
+    std::string File;
+    const Replacements *Replaces;
+    std::string FormatStyle;
+    /// The messages to print about the file.
+    std::string Errors;
+    bool WriteFailed = false;
+  };
+
+  /// Applies the replacements of a file, reading it once, and writes it
+  /// atomically. Called concurrently for different files.
+  static void applyFixes(FileFixes &Fix, llvm::vfs::FileSystem &FS) {
+    llvm::raw_string_ostream Errors(Fix.Errors);
+    llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+        FS.getBufferForFile(Fix.File);
+    if (!Buffer) {
+      Errors << "Can't get buffer for file " << Fix.File << ": "
+             << Buffer.getError().message() << "\n";
+      // FIXME: Maybe don't apply fixes for other files as well.
+      return;
+    }
+    StringRef Code = Buffer.get()->getBuffer();
+    auto Style = format::getStyle(Fix.FormatStyle, Fix.File, "none");
+    if (!Style) {
+      Errors << llvm::toString(Style.takeError()) << "\n";
+      return;
+    }
+    llvm::Expected<tooling::Replacements> Replacements =
+        format::cleanupAroundReplacements(Code, *Fix.Replaces, *Style);
+    if (!Replacements) {
+      Errors << llvm::toString(Replacements.takeError()) << "\n";
+      return;
+    }
+    if (llvm::Expected<tooling::Replacements> FormattedReplacements =
+            format::formatReplacements(Code, *Replacements, *Style)) {
+      Replacements = std::move(FormattedReplacements);
+      if (!Replacements)
+        llvm_unreachable("!Replacements");
+    } else {
+      Errors << llvm::toString(FormattedReplacements.takeError())
+             << ". Skipping formatting.\n";
+    }
+    llvm::Expected<std::string> NewCode =
+        tooling::applyAllReplacements(Code, *Replacements);
+    if (!NewCode) {
+      llvm::consumeError(NewCode.takeError());
+      Errors << "Can't apply replacements for file " << Fix.File << "\n";
+      return;
+    }
+    if (*NewCode == Code)
+      return;
+    if (std::error_code EC = writeFileAtomically(Fix.File, *NewCode)) {
+      Errors << "Can't write " << Fix.File << ": " << EC.message() << "\n";
+      Fix.WriteFailed = true;
+    }
+  }
+
+  /// Writes \p Contents to a temporary file renamed to \p Path, so that \p Path
+  /// is never left partially written.
+  static std::error_code writeFileAtomically(StringRef Path,
+                                             StringRef Contents) {
+    // Renaming over a symlink would replace it, write to the file it points to.
+    llvm::SmallString<256> RealPath;
+    if (std::error_code EC = llvm::sys::fs::real_path(Path, RealPath))
+      return EC;
+    StringRef File = RealPath;
+    int FD;
+    llvm::SmallString<256> TempPath;
+    if (std::error_code EC = llvm::sys::fs::createUniqueFile(
+            File + "-%%%%%%%%.tmp", FD, TempPath))
+      return EC;
+    {
+      llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+      OS << Contents;
+      OS.close();
+      if (std::error_code EC = OS.error()) {
+        OS.clear_error();
+        llvm::sys::fs::remove(TempPath);
+        return EC;
+      }
+    }
+    if (std::error_code EC = llvm::sys::fs::rename(TempPath, File)) {
+      llvm::sys::fs::remove(TempPath);
+      return EC;
+    }
+    return std::error_code();
+  }
+
   void reportNote(const tooling::DiagnosticMessage &Message) {
     SourceLocation Loc = getLocation(Message.FilePath, Message.FileOffset);
     Diags.Report(Loc, Diags.getCustomDiagID(DiagnosticsEngine::Note, "%0"))
@@ -265,24 +356,207 @@ private:
   llvm::StringMap<Replacements> FileReplacements;
   ClangTidyContext &Context;
   bool ApplyFixes;
+  unsigned NumThreads;
   unsigned TotalFixes;
   unsigned AppliedFixes;
   unsigned WarningsAsErrors;
 };
 
+/// Restricts the traversal of the AST matchers to the top-level declarations
+/// that aren't in headers claimed by other translation units. Must run before
+/// the consumer of the MatchFinder. While it exists, checks working on the
+/// preprocessor can skip the claimed headers through the context.
+class HeaderClaimingConsumer : public ASTConsumer {
+public:
+  HeaderClaimingConsumer(HeaderClaims &Claims, ClangTidyContext &Context,
+                         const Preprocessor &PP, unsigned &NumSkippedHeaders)
+      : Claims(Claims), Context(Context), PP(PP),
+        NumSkippedHeaders(NumSkippedHeaders) {
+    Context.setHeaderClaimFilter(
+        [this](FileID FID) { return isSkipped(PP.getSourceManager(), FID); });
+  }
+
+  ~HeaderClaimingConsumer() override { Context.setHeaderClaimFilter(nullptr); }
+
+  void HandleTranslationUnit(ASTContext &Ctx) override {
+    const SourceManager &SM = Ctx.getSourceManager();
+    std::vector<Decl *> Scope;
+    bool SkippedAny = false;
+    for (Decl *D : Ctx.getTranslationUnitDecl()->decls()) {
+      if (isSkipped(SM, SM.getFileID(SM.getExpansionLoc(D->getLocation()))))
+        SkippedAny = true;
+      else
+        Scope.push_back(D);
+    }
+    if (SkippedAny)
+      Ctx.setTraversalScope(Scope);
+  }
+
+private:
+  bool isSkipped(const SourceManager &SM, FileID FID) {
+    auto It = Skipped.find(FID);
+    if (It == Skipped.end()) {
+      It = Skipped.try_emplace(FID, isClaimedByOthers(SM, FID)).first;
+      if (It->second)
+        ++NumSkippedHeaders;
+    }
+    return It->second;
+  }
+
+  bool isClaimedByOthers(const SourceManager &SM, FileID FID) {
+    if (FID.isInvalid() || FID == SM.getMainFileID())
+      return false;
+    const FileEntry *File = SM.getFileEntryForID(FID);
+    if (!HeaderFilter)
+      HeaderFilter = llvm::make_unique<llvm::Regex>(
+          *Context.getOptions().HeaderFilterRegex);
+    if (!File || !HeaderFilter->match(File->getName()))
+      return false;
+    if (!*Context.getOptions().SystemHeaders &&
+        SM.isInSystemHeader(SM.getLocForStartOfFile(FID)))
+      return false;
+
+    if (Predefines.empty())
+      Predefines = llvm::utohexstr(llvm::hash_value(PP.getPredefines()));
+    llvm::SmallString<256> Path(File->getName());
+    SM.getFileManager().makeAbsolutePath(Path);
+    std::string Key = Path.str();
+    Key += '\0';
+    Key += llvm::utohexstr(llvm::hash_value(SM.getBufferData(FID)));
+    Key += '\0';
+    Key += Predefines;
+    // A header included several times is checked in all of its inclusions by
+    // the translation unit that claimed it.
+    if (OwnClaims.count(Key))
+      return false;
+    if (!Claims.claim(Key))
+      return true;
+    OwnClaims.insert(Key);
+    return false;
+  }
+
+  HeaderClaims &Claims;
+  ClangTidyContext &Context;
+  const Preprocessor &PP;
+  unsigned &NumSkippedHeaders;
+  std::unique_ptr<llvm::Regex> HeaderFilter;
+  std::string Predefines;
+  llvm::StringSet<> OwnClaims;
+  llvm::DenseMap<FileID, bool> Skipped;
+};
+
+/// Restricts the traversal of the AST matchers to the top-level declarations
+/// that overlap a line range of the line filter. Warnings elsewhere would be
+/// filtered out anyway, unless a check reports them away from the declaration
+/// it matched. Must run before the consumer of the MatchFinder.
+class LineFilterScopeConsumer : public ASTConsumer {
+public:
+  explicit LineFilterScopeConsumer(const ClangTidyContext &Context)
+      : Context(Context) {}
+
+  void HandleTranslationUnit(ASTContext &Ctx) override {
+    const SourceManager &SM = Ctx.getSourceManager();
+    // Narrow down the scope left by the consumers before this one.
+    std::vector<Decl *> Candidates = Ctx.getTraversalScope();
+    if (Candidates.size() == 1 && isa<TranslationUnitDecl>(Candidates[0]))
+      Candidates.assign(Ctx.getTranslationUnitDecl()->decls_begin(),
+                        Ctx.getTranslationUnitDecl()->decls_end());
+    std::vector<Decl *> Scope;
+    for (Decl *D : Candidates)
+      if (overlapsFilter(SM, D))
+        Scope.push_back(D);
+    Ctx.setTraversalScope(Scope);
+  }
+
+private:
+  bool overlapsFilter(const SourceManager &SM, const Decl *D) {
+    CharSourceRange Range = SM.getExpansionRange(D->getSourceRange());
+    SourceLocation Begin = Range.getBegin(), End = Range.getEnd();
+    if (Begin.isInvalid() || End.isInvalid())
+      return true;
+    FileID FID = SM.getFileID(Begin);
+    // Not worth guessing which lines a declaration spanning files covers.
+    if (FID != SM.getFileID(End))
+      return true;
+    const FileEntry *File = SM.getFileEntryForID(FID);
+    if (!File)
+      return true;
+    unsigned FirstLine = SM.getExpansionLineNumber(Begin);
+    unsigned LastLine = SM.getExpansionLineNumber(End);
+    // Same lookup as ClangTidyDiagnosticConsumer::passesLineFilter().
+    for (const FileFilter &Filter : Context.getGlobalOptions().LineFilter) {
+      if (!File->getName().endswith(Filter.Name))
+        continue;
+      if (Filter.LineRanges.empty())
+        return true;
+      return llvm::any_of(Filter.LineRanges,
+                          [&](const FileFilter::LineRange &Lines) {
+                            return Lines.first <= LastLine &&
+                                   FirstLine <= Lines.second;
+                          });
+    }
+    return false;
+  }
+
+  const ClangTidyContext &Context;
+};
+
+/// Registers the matchers of the checks that need identifiers once the
+/// translation unit is parsed, skipping those whose identifiers weren't seen,
+/// and runs the MatchFinder.
+class MatchingConsumer : public ASTConsumer {
+public:
+  MatchingConsumer(ast_matchers::MatchFinder &Finder,
+                   std::vector<ClangTidyCheck *> DeferredChecks)
+      : Finder(Finder), DeferredChecks(std::move(DeferredChecks)) {}
+
+  void HandleTranslationUnit(ASTContext &Ctx) override {
+    for (ClangTidyCheck *Check : DeferredChecks)
+      if (hasAnyIdentifier(Ctx.Idents, Check->getRequiredIdentifiers()))
+        Check->registerMatchers(&Finder);
+    Finder.matchAST(Ctx);
+  }
+
+private:
+  static bool hasAnyIdentifier(const IdentifierTable &Idents,
+                               ArrayRef<StringRef> Names) {
+    // Identifiers of a PCH or of modules are only looked up on demand, they
+    // aren't all in the table.
+    if (Idents.getExternalIdentifierLookup())
+      return true;
+    return llvm::any_of(Names, [&](StringRef Name) {
+      return Idents.find(Name) != Idents.end();
+    });
+  }
+
+  ast_matchers::MatchFinder &Finder;
+  std::vector<ClangTidyCheck *> DeferredChecks;
+};
+
 class ClangTidyASTConsumer : public MultiplexConsumer {
 public:
-  ClangTidyASTConsumer(std::vector<std::unique_ptr<ASTConsumer>> Consumers,
+  ClangTidyASTConsumer(ClangTidyContext &Context,
+                       std::vector<std::unique_ptr<ASTConsumer>> Consumers,
                        std::unique_ptr<ClangTidyProfiling> Profiling,
                        std::unique_ptr<ast_matchers::MatchFinder> Finder,
                        std::vector<std::unique_ptr<ClangTidyCheck>> Checks)
-      : MultiplexConsumer(std::move(Consumers)),
+      : MultiplexConsumer(std::move(Consumers)), Context(Context),
         Profiling(std::move(Profiling)), Finder(std::move(Finder)),
         Checks(std::move(Checks)) {}
 
+  void HandleTranslationUnit(ASTContext &Ctx) override {
+    MultiplexConsumer::HandleTranslationUnit(Ctx);
+    // Matching is over, the profile is complete. Report it now: a compiler
+    // running the checks as a plugin may leak its AST consumer (-disable-free).
+    if (Context.getCallbackProfiling() == Profiling.get())
+      Context.setCallbackProfiling(nullptr);
+    Profiling.reset();
+  }
+
 private:
-  // Destructor order matters! Profiling must be destructed last.
-  // Or at least after Finder.
+  ClangTidyContext &Context;
+  // Destructor order matters! Finder records into Profiling while matching,
+  // Profiling must be destructed last, or once matching is over.
   std::unique_ptr<ClangTidyProfiling> Profiling;
   std::unique_ptr<ast_matchers::MatchFinder> Finder;
   std::vector<std::unique_ptr<ClangTidyCheck>> Checks;
@@ -366,17 +640,21 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
   if (WorkingDir)
     Context.setCurrentBuildDirectory(WorkingDir.get());
 
+  // Checks for other languages aren't created.
   std::vector<std::unique_ptr<ClangTidyCheck>> Checks;
-  CheckFactories->createChecks(&Context, Checks);
+  CheckFactories->createChecks(&Context, Checks, &Context.getLangOpts());
 
   ast_matchers::MatchFinder::MatchFinderOptions FinderOptions;
 
   std::unique_ptr<ClangTidyProfiling> Profiling;
   if (Context.getEnableProfiling()) {
     Profiling = llvm::make_unique<ClangTidyProfiling>(
-        Context.getProfileStorageParams());
+        Context.getProfileStorageParams(), Context.getProfileAggregator(),
+        File);
     FinderOptions.CheckProfiling.emplace(Profiling->Records);
   }
+  Context.setCallbackProfiling(
+      Profiling && Context.getProfileCallbacks() ? Profiling.get() : nullptr);
 
   std::unique_ptr<ast_matchers::MatchFinder> Finder(
       new ast_matchers::MatchFinder(std::move(FinderOptions)));
@@ -384,22 +662,41 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
   Preprocessor *PP = &Compiler.getPreprocessor();
   Preprocessor *ModuleExpanderPP = PP;
 
+  std::unique_ptr<ExpandModularHeadersPPCallbacks> ModuleExpander;
   if (Context.getLangOpts().Modules && OverlayFS != nullptr) {
-    auto ModuleExpander = llvm::make_unique<ExpandModularHeadersPPCallbacks>(
+    ModuleExpander = llvm::make_unique<ExpandModularHeadersPPCallbacks>(
         &Compiler, OverlayFS);
     ModuleExpanderPP = ModuleExpander->getPreprocessor();
-    PP->addPPCallbacks(std::move(ModuleExpander));
   }
 
+  std::vector<ClangTidyCheck *> DeferredChecks;
   for (auto &Check : Checks) {
-    Check->registerMatchers(&*Finder);
+    if (Check->getRequiredIdentifiers().empty())
+      Check->registerMatchers(&*Finder);
+    else
+      DeferredChecks.push_back(Check.get());
     Check->registerPPCallbacks(Compiler);
     Check->registerPPCallbacks(*SM, PP, ModuleExpanderPP);
   }
+  // Preprocessing the modular headers again is as costly as parsing them, only
+  // do it if a check listens to the result.
+  if (ModuleExpander && ModuleExpanderPP->getPPCallbacks())
+    PP->addPPCallbacks(std::move(ModuleExpander));
 
   std::vector<std::unique_ptr<ASTConsumer>> Consumers;
-  if (!Checks.empty())
-    Consumers.push_back(Finder->newASTConsumer());
+  if (!Checks.empty()) {
+    if (Claims)
+      Consumers.push_back(llvm::make_unique<HeaderClaimingConsumer>(
+          *Claims, Context, *PP, NumSkippedHeaders));
+    const ClangTidyGlobalOptions &GlobalOptions = Context.getGlobalOptions();
+    if (GlobalOptions.SkipUnchangedDecls && !GlobalOptions.LineFilter.empty())
+      Consumers.push_back(llvm::make_unique<LineFilterScopeConsumer>(Context));
+    if (DeferredChecks.empty())
+      Consumers.push_back(Finder->newASTConsumer());
+    else
+      Consumers.push_back(llvm::make_unique<MatchingConsumer>(
+          *Finder, std::move(DeferredChecks)));
+  }
 
 #if CLANG_ENABLE_STATIC_ANALYZER
   AnalyzerOptionsRef AnalyzerOptions = Compiler.getAnalyzerOpts();
@@ -419,7 +716,7 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
   }
 #endif // CLANG_ENABLE_STATIC_ANALYZER
   return llvm::make_unique<ClangTidyASTConsumer>(
-      std::move(Consumers), std::move(Profiling), std::move(Finder),
+      Context, std::move(Consumers), std::move(Profiling), std::move(Finder),
       std::move(Checks));
 }
 
@@ -471,89 +768,352 @@ getCheckOptions(const ClangTidyOptions &Options,
   return Factory.getCheckOptions();
 }
 
-std::vector<ClangTidyError>
-runClangTidy(clang::tidy::ClangTidyContext &Context,
-             const CompilationDatabase &Compilations,
-             ArrayRef<std::string> InputFiles,
-             llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
-             bool EnableCheckProfile, llvm::StringRef StoreCheckProfile) {
-  ClangTool Tool(Compilations, InputFiles,
-                 std::make_shared<PCHContainerOperations>(), BaseFS);
-
-  // Add extra arguments passed by the clang-tidy command-line.
-  ArgumentsAdjuster PerFileExtraArgumentsInserter =
-      [&Context](const CommandLineArguments &Args, StringRef Filename) {
-        ClangTidyOptions Opts = Context.getOptionsForFile(Filename);
-        CommandLineArguments AdjustedArgs = Args;
-        if (Opts.ExtraArgsBefore) {
-          auto I = AdjustedArgs.begin();
-          if (I != AdjustedArgs.end() && !StringRef(*I).startswith("-"))
-            ++I; // Skip compiler binary name, if it is there.
-          AdjustedArgs.insert(I, Opts.ExtraArgsBefore->begin(),
-                              Opts.ExtraArgsBefore->end());
-        }
-        if (Opts.ExtraArgs)
-          AdjustedArgs.insert(AdjustedArgs.end(), Opts.ExtraArgs->begin(),
-                              Opts.ExtraArgs->end());
-        return AdjustedArgs;
-      };
-
-  Tool.appendArgumentsAdjuster(PerFileExtraArgumentsInserter);
-  Tool.appendArgumentsAdjuster(getStripPluginsAdjuster());
-  Context.setEnableProfiling(EnableCheckProfile);
-  Context.setProfileStoragePrefix(StoreCheckProfile);
-
-  ClangTidyDiagnosticConsumer DiagConsumer(Context);
-  DiagnosticsEngine DE(new DiagnosticIDs(), new DiagnosticOptions(),
-                       &DiagConsumer, /*ShouldOwnClient=*/false);
-  Context.setDiagnosticsEngine(&DE);
-  Tool.setDiagnosticConsumer(&DiagConsumer);
-
-  class ActionFactory : public FrontendActionFactory {
+namespace {
+class ActionFactory : public FrontendActionFactory {
+public:
+  ActionFactory(ClangTidyContext &Context,
+                IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS)
+      : ConsumerFactory(Context, BaseFS) {}
+  FrontendAction *create() override { return new Action(this); }
+
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override {
+    // Explicitly set ProgramAction to RunAnalysis to make the preprocessor
+    // define __clang_analyzer__ macro. The frontend analyzer action will not
+    // be called here.
+    Invocation->getFrontendOpts().ProgramAction = frontend::RunAnalysis;
+    return FrontendActionFactory::runInvocation(
+        Invocation, Files, PCHContainerOps, DiagConsumer);
+  }
+
+  ClangTidyASTConsumerFactory &getConsumerFactory() { return ConsumerFactory; }
+
+  /// Starts recording the files read by the next runs.
+  void trackDependencies() { Dependencies.emplace(); }
+
+  /// Returns the files read since trackDependencies(), or None if some of
+  /// them couldn't be tracked.
+  llvm::Optional<std::vector<std::pair<std::string, std::string>>>
+  takeDependencies() {
+    auto Result = std::move(Dependencies);
+    Dependencies.reset();
+    return Result;
+  }
+
+private:
+  class Action : public ASTFrontendAction {
   public:
-    ActionFactory(ClangTidyContext &Context,
-                  IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS)
-        : ConsumerFactory(Context, BaseFS) {}
-    FrontendAction *create() override { return new Action(&ConsumerFactory); }
-
-    bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
-                       FileManager *Files,
-                       std::shared_ptr<PCHContainerOperations> PCHContainerOps,
-                       DiagnosticConsumer *DiagConsumer) override {
-      // Explicitly set ProgramAction to RunAnalysis to make the preprocessor
-      // define __clang_analyzer__ macro. The frontend analyzer action will not
-      // be called here.
-      Invocation->getFrontendOpts().ProgramAction = frontend::RunAnalysis;
-      return FrontendActionFactory::runInvocation(
-          Invocation, Files, PCHContainerOps, DiagConsumer);
+    Action(ActionFactory *Owner) : Owner(Owner) {}
+    std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
+                                                   StringRef File) override {
+      return Owner->ConsumerFactory.CreateASTConsumer(Compiler, File);
+    }
+
+    void EndSourceFileAction() override {
+      if (!Owner->Dependencies)
+        return;
+      auto Files = getDependencies(getCompilerInstance());
+      if (!Files) {
+        Owner->Dependencies.reset();
+        return;
+      }
+      std::move(Files->begin(), Files->end(),
+                std::back_inserter(*Owner->Dependencies));
     }
 
   private:
-    class Action : public ASTFrontendAction {
-    public:
-      Action(ClangTidyASTConsumerFactory *Factory) : Factory(Factory) {}
-      std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
-                                                     StringRef File) override {
-        return Factory->CreateASTConsumer(Compiler, File);
+    ActionFactory *Owner;
+  };
+
+  ClangTidyASTConsumerFactory ConsumerFactory;
+  llvm::Optional<std::vector<std::pair<std::string, std::string>>>
+      Dependencies;
+};
+
+ClangTidyStats statsDifference(const ClangTidyStats &After,
+                               const ClangTidyStats &Before) {
+  ClangTidyStats Result;
+  Result.ErrorsDisplayed = After.ErrorsDisplayed - Before.ErrorsDisplayed;
+  Result.ErrorsIgnoredCheckFilter =
+      After.ErrorsIgnoredCheckFilter - Before.ErrorsIgnoredCheckFilter;
+  Result.ErrorsIgnoredNOLINT =
+      After.ErrorsIgnoredNOLINT - Before.ErrorsIgnoredNOLINT;
+  Result.ErrorsIgnoredNonUserCode =
+      After.ErrorsIgnoredNonUserCode - Before.ErrorsIgnoredNonUserCode;
+  Result.ErrorsIgnoredLineFilter =
+      After.ErrorsIgnoredLineFilter - Before.ErrorsIgnoredLineFilter;
+  return Result;
+}
+
+/// Runs the checks of a context over translation units. The checks and the
+/// diagnostics engine are created once, and reused for every run().
+///
+/// With a ResultCache, files are processed one at a time, and the results of
+/// unchanged files are taken from the cache instead.
+class TidyRunner {
+public:
+  TidyRunner(ClangTidyContext &Context,
+             IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
+             bool EnableCheckProfile, llvm::StringRef StoreCheckProfile,
+             bool RemoveIncompatibleErrors = true,
+             const ResultCache *Cache = nullptr,
+             HeaderClaims *Claims = nullptr)
+      : Context(Context), BaseFS(BaseFS), Cache(Cache),
+        RemoveIncompatibleErrors(RemoveIncompatibleErrors),
+        // Per-file results are stored before the errors of all files are
+        // merged.
+        DiagConsumer(Context, RemoveIncompatibleErrors && !Cache),
+        DE(new DiagnosticIDs(), new DiagnosticOptions(), &DiagConsumer,
+           /*ShouldOwnClient=*/false),
+        Factory(Context, BaseFS) {
+    Context.setEnableProfiling(EnableCheckProfile);
+    Context.setProfileStoragePrefix(StoreCheckProfile);
+    Context.setDiagnosticsEngine(&DE);
+    Factory.getConsumerFactory().setHeaderClaims(Claims);
+  }
+
+  void run(const CompilationDatabase &Compilations,
+           ArrayRef<std::string> InputFiles) {
+    if (!Cache)
+      return runTool(Compilations, InputFiles);
+    for (const std::string &File : InputFiles)
+      runCached(Compilations, File);
+  }
+
+  std::vector<ClangTidyError> take() {
+    std::vector<ClangTidyError> Errors = DiagConsumer.take();
+    if (!Cache)
+      return Errors;
+    std::move(CachedErrors.begin(), CachedErrors.end(),
+              std::back_inserter(Errors));
+    CachedErrors.clear();
+    deduplicateErrors(Errors, RemoveIncompatibleErrors);
+    return Errors;
+  }
+
+private:
+  void runCached(const CompilationDatabase &Compilations,
+                 const std::string &File) {
+    llvm::Optional<std::string> Key;
+    if (auto AbsolutePath = getAbsolutePath(*BaseFS, File)) {
+      Key = ResultCache::getKey(Compilations.getCompileCommands(*AbsolutePath),
+                                Context.getOptionsForFile(*AbsolutePath),
+                                Context.getGlobalOptions(),
+                                Context.canEnableAnalyzerAlphaCheckers(),
+                                *AbsolutePath, *BaseFS);
+    } else {
+      llvm::consumeError(AbsolutePath.takeError());
+    }
+    if (Key) {
+      if (auto Hit = Cache->lookup(*Key, *BaseFS)) {
+        std::move(Hit->Errors.begin(), Hit->Errors.end(),
+                  std::back_inserter(CachedErrors));
+        Context.addStats(Hit->Stats);
+        return;
       }
+    }
 
-    private:
-      ClangTidyASTConsumerFactory *Factory;
-    };
+    ClangTidyStats Before = Context.getStats();
+    const ClangTidyASTConsumerFactory &ConsumerFactory =
+        Factory.getConsumerFactory();
+    unsigned SkippedBefore = ConsumerFactory.getNumSkippedHeaders();
+    Factory.trackDependencies();
+    runTool(Compilations, File);
+    CachedResult Result;
+    // Taking the errors finalizes the last one, which updates the stats.
+    Result.Errors = DiagConsumer.take();
+    Result.Stats = statsDifference(Context.getStats(), Before);
+    auto Dependencies = Factory.takeDependencies();
+    // A header that wasn't found isn't a dependency, the result would not be
+    // invalidated once it is created.
+    bool Uncompilable =
+        llvm::any_of(Result.Errors, [](const ClangTidyError &Error) {
+          return Error.DiagnosticName == "clang-diagnostic-error";
+        });
+    // Diagnostics of headers claimed by other translation units are missing.
+    bool SkippedHeaders =
+        ConsumerFactory.getNumSkippedHeaders() != SkippedBefore;
+    if (Key && Dependencies && !Uncompilable && !SkippedHeaders) {
+      Result.Dependencies = std::move(*Dependencies);
+      Cache->store(*Key, Result);
+    }
+    std::move(Result.Errors.begin(), Result.Errors.end(),
+              std::back_inserter(CachedErrors));
+  }
 
-    ClangTidyASTConsumerFactory ConsumerFactory;
-  };
+  void runTool(const CompilationDatabase &Compilations,
+               ArrayRef<std::string> InputFiles) {
+    ClangTool Tool(Compilations, InputFiles,
+                   std::make_shared<PCHContainerOperations>(), BaseFS);
+
+    // Add extra arguments passed by the clang-tidy command-line.
+    ArgumentsAdjuster PerFileExtraArgumentsInserter =
+        [this](const CommandLineArguments &Args, StringRef Filename) {
+          ClangTidyOptions Opts = Context.getOptionsForFile(Filename);
+          CommandLineArguments AdjustedArgs = Args;
+          if (Opts.ExtraArgsBefore) {
+            auto I = AdjustedArgs.begin();
+            if (I != AdjustedArgs.end() && !StringRef(*I).startswith("-"))
+              ++I; // Skip compiler binary name, if it is there.
+            AdjustedArgs.insert(I, Opts.ExtraArgsBefore->begin(),
+                                Opts.ExtraArgsBefore->end());
+          }
+          if (Opts.ExtraArgs)
+            AdjustedArgs.insert(AdjustedArgs.end(), Opts.ExtraArgs->begin(),
+                                Opts.ExtraArgs->end());
+          return AdjustedArgs;
+        };
+
+    Tool.appendArgumentsAdjuster(PerFileExtraArgumentsInserter);
+    Tool.appendArgumentsAdjuster(getStripPluginsAdjuster());
+    Tool.setDiagnosticConsumer(&DiagConsumer);
+    Tool.run(&Factory);
+  }
+
+  ClangTidyContext &Context;
+  IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS;
+  const ResultCache *Cache;
+  bool RemoveIncompatibleErrors;
+  /// The errors of the files processed with the cache, in input order.
+  std::vector<ClangTidyError> CachedErrors;
+  ClangTidyDiagnosticConsumer DiagConsumer;
+  DiagnosticsEngine DE;
+  ActionFactory Factory;
+};
+
+/// The options of the files processed by a parallel run, computed once per
+/// file by the options provider of the run's context. The provider is only
+/// called with Mu held: FileOptionsProvider is thread-safe, but other providers
+/// may not be.
+class SharedOptions {
+public:
+  SharedOptions(ClangTidyContext &Context) : Context(Context) {}
+
+  const ClangTidyGlobalOptions &getGlobalOptions() const {
+    return Context.getGlobalOptions();
+  }
+
+  ClangTidyOptions getOptions(llvm::StringRef File) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = Cache.find(File);
+    if (It == Cache.end())
+      It = Cache.try_emplace(File, Context.getOptionsForFile(File)).first;
+    return It->second;
+  }
+
+private:
+  ClangTidyContext &Context;
+  std::mutex Mu;
+  llvm::StringMap<ClangTidyOptions> Cache;
+};
+
+/// Gives the context of a worker thread the options in SharedOptions.
+class SharedOptionsProvider : public ClangTidyOptionsProvider {
+public:
+  SharedOptionsProvider(SharedOptions &Options) : Options(Options) {}
+
+  const ClangTidyGlobalOptions &getGlobalOptions() override {
+    return Options.getGlobalOptions();
+  }
 
-  ActionFactory Factory(Context, BaseFS);
-  Tool.run(&Factory);
-  return DiagConsumer.take();
+  std::vector<OptionsSource> getRawOptions(llvm::StringRef FileName) override {
+    // The options are already merged, a single source is enough.
+    std::vector<OptionsSource> Result;
+    Result.emplace_back(Options.getOptions(FileName), "shared options");
+    return Result;
+  }
+
+private:
+  SharedOptions &Options;
+};
+} // namespace
+
+std::vector<ClangTidyError>
+runClangTidy(clang::tidy::ClangTidyContext &Context,
+             const CompilationDatabase &Compilations,
+             ArrayRef<std::string> InputFiles,
+             llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
+             bool EnableCheckProfile, llvm::StringRef StoreCheckProfile,
+             unsigned NumThreads, llvm::StringRef ResultCacheDir,
+             bool CheckHeadersOnce) {
+  // Profiles describe the checks that ran, cached results have none.
+  llvm::Optional<ResultCache> Cache;
+  if (!ResultCacheDir.empty() && !EnableCheckProfile) {
+    // Running the tool may change the working directory.
+    llvm::SmallString<256> Dir(ResultCacheDir);
+    llvm::sys::fs::make_absolute(Dir);
+    Cache.emplace(Dir);
+  }
+  const ResultCache *CachePtr = Cache ? Cache.getPointer() : nullptr;
+  // Shared by all threads, a header is checked once per run.
+  HeaderClaims Claims;
+  HeaderClaims *ClaimsPtr = CheckHeadersOnce ? &Claims : nullptr;
+
+  NumThreads = std::min<size_t>(NumThreads, InputFiles.size());
+  // Every thread needs a file system with its own working directory, so only
+  // a BaseFS without overlays can be replaced by a per-thread physical file
+  // system. Profiles printed to stderr by several threads would interleave.
+  bool HasOverlays =
+      std::distance(BaseFS->overlays_begin(), BaseFS->overlays_end()) > 1;
+  bool PrintsProfiles = EnableCheckProfile && StoreCheckProfile.empty() &&
+                        !Context.getProfileAggregator();
+  if (NumThreads <= 1 || HasOverlays || PrintsProfiles) {
+    TidyRunner Runner(Context, BaseFS, EnableCheckProfile, StoreCheckProfile,
+                      /*RemoveIncompatibleErrors=*/true, CachePtr, ClaimsPtr);
+    Runner.run(Compilations, InputFiles);
+    return Runner.take();
+  }
+
+  // Each thread has its own context, checks and diagnostics, and takes the
+  // next file until all are processed. The compilation database is only read.
+  // Errors are merged as if a single consumer had collected them, which makes
+  // the result independent of the scheduling.
+  SharedOptions Options(Context);
+  std::vector<std::vector<ClangTidyError>> Errors(NumThreads);
+  std::vector<ClangTidyStats> Stats(NumThreads);
+  std::atomic<size_t> NextFile(0);
+  {
+    llvm::ThreadPool Pool(NumThreads);
+    for (unsigned I = 0; I < NumThreads; ++I)
+      Pool.async([&, I] {
+        ClangTidyContext WorkerContext(
+            llvm::make_unique<SharedOptionsProvider>(Options),
+            Context.canEnableAnalyzerAlphaCheckers());
+        WorkerContext.setProfileAggregator(Context.getProfileAggregator());
+        WorkerContext.setProfileCallbacks(Context.getProfileCallbacks());
+        IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> WorkerFS(
+            new llvm::vfs::OverlayFileSystem(
+                llvm::vfs::createPhysicalFileSystem().release()));
+        TidyRunner Runner(WorkerContext, WorkerFS, EnableCheckProfile,
+                          StoreCheckProfile,
+                          /*RemoveIncompatibleErrors=*/false, CachePtr,
+                          ClaimsPtr);
+        for (size_t File = NextFile++; File < InputFiles.size();
+             File = NextFile++)
+          Runner.run(Compilations, InputFiles[File]);
+        Errors[I] = Runner.take();
+        Stats[I] = WorkerContext.getStats();
+      });
+    Pool.wait();
+  }
+
+  std::vector<ClangTidyError> Result;
+  for (unsigned I = 0; I < NumThreads; ++I) {
+    Context.addStats(Stats[I]);
+    std::move(Errors[I].begin(), Errors[I].end(), std::back_inserter(Result));
+  }
+  deduplicateErrors(Result);
+  return Result;
 }
 
 void handleErrors(llvm::ArrayRef<ClangTidyError> Errors,
                   ClangTidyContext &Context, bool Fix,
                   unsigned &WarningsAsErrorsCount,
-                  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> BaseFS) {
-  ErrorReporter Reporter(Context, Fix, BaseFS);
+                  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> BaseFS,
+                  unsigned NumThreads) {
+  ErrorReporter Reporter(Context, Fix, BaseFS, NumThreads);
   llvm::vfs::FileSystem &FileSystem =
       Reporter.getSourceManager().getFileManager().getVirtualFileSystem();
   auto InitialWorkingDir = FileSystem.getCurrentWorkingDirectory();
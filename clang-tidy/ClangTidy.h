@@ -12,8 +12,10 @@
 #include "ClangTidyCheck.h"
 #include "ClangTidyDiagnosticConsumer.h"
 #include "ClangTidyOptions.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/raw_ostream.h"
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace clang {
@@ -27,6 +29,25 @@ namespace tidy {
 
 class ClangTidyCheckFactories;
 
+/// \brief The headers whose declarations were already checked in a run.
+///
+/// A header is identified by its path, its contents and the predefined macros
+/// of the translation unit, so that a header seen with other command-line
+/// macros or language options is checked again. Macros defined by the main
+/// file before the #include are not taken into account. Thread-safe.
+class HeaderClaims {
+public:
+  /// Returns true if no translation unit claimed \p Key before.
+  bool claim(llvm::StringRef Key) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    return Claimed.insert(Key).second;
+  }
+
+private:
+  std::mutex Mu;
+  llvm::StringSet<> Claimed;
+};
+
 class ClangTidyASTConsumerFactory {
 public:
   ClangTidyASTConsumerFactory(
@@ -43,10 +64,21 @@ public:
   /// \brief Get the union of options from all checks.
   ClangTidyOptions::OptionMap getCheckOptions();
 
+  /// \brief Makes the AST matchers skip the top-level declarations of headers
+  /// claimed by earlier translation units. Headers matching the header filter
+  /// are claimed by the first translation unit that includes them.
+  void setHeaderClaims(HeaderClaims *Claims) { this->Claims = Claims; }
+
+  /// \brief The number of headers skipped because of the claims, over all
+  /// translation units.
+  unsigned getNumSkippedHeaders() const { return NumSkippedHeaders; }
+
 private:
   ClangTidyContext &Context;
   IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> OverlayFS;
   std::unique_ptr<ClangTidyCheckFactories> CheckFactories;
+  HeaderClaims *Claims = nullptr;
+  unsigned NumSkippedHeaders = 0;
 };
 
 /// \brief Fills the list of check names that are enabled when the provided
@@ -71,13 +103,28 @@ getCheckOptions(const ClangTidyOptions &Options,
 /// \param StoreCheckProfile If provided, and EnableCheckProfile is true,
 /// the profile will not be output to stderr, but will instead be stored
 /// as a JSON file in the specified directory.
+/// \param NumThreads If greater than 1, files are processed by that many
+/// threads, each with its own context created from the options of \p Context.
+/// The results and the stats in \p Context are the same as with one thread.
+/// Files are read through the real file system instead of \p BaseFS, so files
+/// are processed sequentially if \p BaseFS has overlays. They are too if the
+/// profiles are printed to stderr, unless \p Context has a ProfileAggregator.
+/// \param ResultCacheDir If not empty, the results of translation units are
+/// stored in that directory, and reused while the files they read are
+/// unchanged. Ignored if EnableCheckProfile is true.
+/// \param CheckHeadersOnce If true, the declarations of a header matching the
+/// header filter are only matched in the first translation unit including it,
+/// see HeaderClaims. Results of the other translation units aren't cached.
 std::vector<ClangTidyError>
 runClangTidy(clang::tidy::ClangTidyContext &Context,
              const tooling::CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
              llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
              bool EnableCheckProfile = false,
-             llvm::StringRef StoreCheckProfile = StringRef());
+             llvm::StringRef StoreCheckProfile = StringRef(),
+             unsigned NumThreads = 1,
+             llvm::StringRef ResultCacheDir = StringRef(),
+             bool CheckHeadersOnce = false);
 
 // FIXME: This interface will need to be significantly extended to be useful.
 // FIXME: Implement confidence levels for displaying/fixing errors.
@@ -85,10 +132,12 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
 /// \brief Displays the found \p Errors to the users. If \p Fix is true, \p
 /// Errors containing fixes are automatically applied and reformatted. If no
 /// clang-format configuration file is found, the given \P FormatStyle is used.
+/// Up to \p NumThreads files are fixed in parallel, 0 uses all cores.
 void handleErrors(llvm::ArrayRef<ClangTidyError> Errors,
                   ClangTidyContext &Context, bool Fix,
                   unsigned &WarningsAsErrorsCount,
-                  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> BaseFS);
+                  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> BaseFS,
+                  unsigned NumThreads = 1);
 
 /// \brief Serializes replacements into YAML and writes them to the specified
 /// output stream.
@@ -27,7 +27,23 @@ void ClangTidyCheck::run(const ast_matchers::MatchFinder::MatchResult &Result) {
   // For historical reasons, checks don't implement the MatchFinder run()
   // callback directly. We keep the run()/check() distinction to avoid interface
   // churn, and to allow us to add cross-cutting logic in the future.
+  ClangTidyProfiling *Profiling = Context->getCallbackProfiling();
+  if (!Profiling) {
+    check(Result);
+    return;
+  }
+
+  llvm::TimeRecord Start = llvm::TimeRecord::getCurrentTime(/*Start=*/true);
   check(Result);
+  llvm::TimeRecord Time = llvm::TimeRecord::getCurrentTime(/*Start=*/false);
+  Time -= Start;
+  std::string BoundIDs;
+  for (const auto &Node : Result.Nodes.getMap()) {
+    if (!BoundIDs.empty())
+      BoundIDs += ',';
+    BoundIDs += Node.first;
+  }
+  Profiling->addCallback(CheckName, BoundIDs, Time);
 }
 
 ClangTidyCheck::OptionsView::OptionsView(StringRef CheckName,
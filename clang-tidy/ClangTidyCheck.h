@@ -53,6 +53,20 @@ public:
   /// constructor using the Options.get() methods below.
   ClangTidyCheck(StringRef CheckName, ClangTidyContext *Context);
 
+  /// \brief Hide this to declare the languages the check applies to.
+  ///
+  /// Checks registered with ``ClangTidyCheckFactories::registerCheck`` aren't
+  /// created for translation units in other languages, which saves
+  /// registering their matchers and ``PPCallbacks``. For example:
+  /// \code
+  ///   static bool isLanguageSupported(const LangOptions &LangOpts) {
+  ///     return LangOpts.CPlusPlus11;
+  ///   }
+  /// \endcode
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return true;
+  }
+
   /// DEPRECATED: Use the other overload.
   virtual void registerPPCallbacks(CompilerInstance &Compiler) {}
 
@@ -88,6 +102,16 @@ public:
   /// matches occur in the order of the AST traversal.
   virtual void registerMatchers(ast_matchers::MatchFinder *Finder) {}
 
+  /// \brief Override this to return identifiers, one of which must appear in a
+  /// translation unit for the check's matchers to match in it, e.g. the
+  /// unqualified names given to ``hasName()``.
+  ///
+  /// The matchers of such checks are only registered once the translation
+  /// unit is parsed, and only if one of these identifiers was seen, which saves
+  /// matching in the other translation units. Checks returning no identifiers
+  /// always have their matchers registered.
+  virtual ArrayRef<StringRef> getRequiredIdentifiers() const { return None; }
+
   /// \brief ``ClangTidyChecks`` that register ASTMatchers should do the actual
   /// work in here.
   virtual void check(const ast_matchers::MatchFinder::MatchResult &Result) {}
@@ -96,6 +120,13 @@ public:
   DiagnosticBuilder diag(SourceLocation Loc, StringRef Description,
                          DiagnosticIDs::Level Level = DiagnosticIDs::Warning);
 
+  /// \brief Returns ``true`` if the header \p FID is checked by another
+  /// translation unit of the run. Checks working on the preprocessor should
+  /// skip the directives of such headers.
+  bool isHeaderClaimedByOthers(FileID FID) const {
+    return Context->isHeaderClaimedByOthers(FID);
+  }
+
   /// \brief Should store all options supported by this check with their
   /// current values or default values for options that haven't been overridden.
   ///
@@ -189,6 +220,11 @@ protected:
   StringRef getCurrentMainFile() const { return Context->getCurrentFile(); }
   /// \brief Returns the language options from the context.
   LangOptions getLangOpts() const { return Context->getLangOpts(); }
+  /// \brief Returns the #include directives of the current translation unit,
+  /// for ``utils::IncludeInserter``.
+  IncludeDirectives &getIncludeDirectives() const {
+    return Context->getIncludeDirectives();
+  }
 };
 
 } // namespace tidy
@@ -122,36 +122,47 @@ static bool ConsumeNegativeIndicator(StringRef &GlobList) {
   }
   return false;
 }
-// Converts first glob from the comma-separated list of globs to Regex and
-// removes it and the trailing comma from the GlobList.
-static llvm::Regex ConsumeGlob(StringRef &GlobList) {
+// Splits the first glob from the comma-separated list of globs at its '*'s,
+// and removes it and the trailing comma from the GlobList.
+static std::vector<std::string> ConsumeGlob(StringRef &GlobList) {
   StringRef UntrimmedGlob = GlobList.substr(0, GlobList.find(','));
   StringRef Glob = UntrimmedGlob.trim(' ');
   GlobList = GlobList.substr(UntrimmedGlob.size() + 1);
-  SmallString<128> RegexText("^");
-  StringRef MetaChars("()^$|*+?.[]\\{}");
-  for (char C : Glob) {
-    if (C == '*')
-      RegexText.push_back('.');
-    else if (MetaChars.find(C) != StringRef::npos)
-      RegexText.push_back('\\');
-    RegexText.push_back(C);
-  }
-  RegexText.push_back('$');
-  return llvm::Regex(RegexText);
+  SmallVector<StringRef, 4> Parts;
+  Glob.split(Parts, '*');
+  return std::vector<std::string>(Parts.begin(), Parts.end());
 }
 
-GlobList::GlobList(StringRef Globs)
-    : Positive(!ConsumeNegativeIndicator(Globs)), Regex(ConsumeGlob(Globs)),
-      NextGlob(Globs.empty() ? nullptr : new GlobList(Globs)) {}
+GlobList::GlobList(StringRef Globs) {
+  do {
+    Glob G;
+    G.Positive = !ConsumeNegativeIndicator(Globs);
+    G.Parts = ConsumeGlob(Globs);
+    this->Globs.push_back(std::move(G));
+  } while (!Globs.empty());
+}
 
-bool GlobList::contains(StringRef S, bool Contains) {
-  if (Regex.match(S))
-    Contains = Positive;
+bool GlobList::Glob::matches(StringRef S) const {
+  if (Parts.size() == 1)
+    return S == Parts.front();
+  if (!S.consume_front(Parts.front()) || !S.consume_back(Parts.back()))
+    return false;
+  // Taking the first occurrence of each part leaves the most room for the
+  // next ones.
+  for (size_t I = 1; I + 1 < Parts.size(); ++I) {
+    size_t Pos = S.find(Parts[I]);
+    if (Pos == StringRef::npos)
+      return false;
+    S = S.drop_front(Pos + Parts[I].size());
+  }
+  return true;
+}
 
-  if (NextGlob)
-    Contains = NextGlob->contains(S, Contains);
-  return Contains;
+bool GlobList::contains(StringRef S) const {
+  for (const Glob &G : llvm::reverse(Globs))
+    if (G.matches(S))
+      return G.Positive;
+  return false;
 }
 
 class ClangTidyContext::CachedGlobList {
@@ -204,6 +215,7 @@ void ClangTidyContext::setSourceManager(SourceManager *SourceMgr) {
 
 void ClangTidyContext::setCurrentFile(StringRef File) {
   CurrentFile = File;
+  Includes.reset();
   CurrentOptions = getOptionsForFile(CurrentFile);
   CheckFilter = llvm::make_unique<CachedGlobList>(*getOptions().Checks);
   WarningAsErrorFilter =
@@ -273,6 +285,8 @@ ClangTidyDiagnosticConsumer::ClangTidyDiagnosticConsumer(
       LastErrorWasIgnored(false) {}
 
 void ClangTidyDiagnosticConsumer::finalizeLastError() {
+  // The last error doesn't relate to user code, it is dropped below.
+  PendingDiags.clear();
   if (!Errors.empty()) {
     ClangTidyError &Error = Errors.back();
     if (!Context.isCheckEnabled(Error.DiagnosticName) &&
@@ -368,11 +382,14 @@ static bool LineIsMarkedWithNOLINT(const SourceManager &SM, SourceLocation Loc,
   return false;
 }
 
-static bool LineIsMarkedWithNOLINTinMacro(const SourceManager &SM,
-                                          SourceLocation Loc, unsigned DiagID,
-                                          const ClangTidyContext &Context) {
+static bool
+LineIsMarkedWithNOLINTinMacro(const SourceManager &SM, SourceLocation Loc,
+                              unsigned DiagID, const ClangTidyContext &Context,
+                              llvm::function_ref<bool(FileID)> MayHaveNOLINT) {
   while (true) {
-    if (LineIsMarkedWithNOLINT(SM, Loc, DiagID, Context))
+    // Lines of files without any NOLINT don't need to be scanned.
+    if ((Loc.isMacroID() || MayHaveNOLINT(SM.getFileID(Loc))) &&
+        LineIsMarkedWithNOLINT(SM, Loc, DiagID, Context))
       return true;
     if (!Loc.isMacroID())
       return false;
@@ -381,6 +398,41 @@ static bool LineIsMarkedWithNOLINTinMacro(const SourceManager &SM,
   return false;
 }
 
+void ClangTidyDiagnosticConsumer::BeginSourceFile(const LangOptions &LangOpts,
+                                                  const Preprocessor *PP) {
+  ++SourceFileDepth;
+  DiagnosticConsumer::BeginSourceFile(LangOpts, PP);
+}
+
+void ClangTidyDiagnosticConsumer::EndSourceFile() {
+  DiagnosticConsumer::EndSourceFile();
+  if (SourceFileDepth > 0 && --SourceFileDepth > 0)
+    return;
+  // The deferred diagnostics refer to the SourceManager of the file. The last
+  // error is dropped by finalizeLastError() anyway.
+  PendingDiags.clear();
+  FilesWithNOLINT.clear();
+  FilesWithNOLINTSM = nullptr;
+}
+
+bool ClangTidyDiagnosticConsumer::mayHaveNOLINT(const SourceManager &SM,
+                                                FileID FID) {
+  if (&SM != FilesWithNOLINTSM) {
+    FilesWithNOLINT.clear();
+    FilesWithNOLINTSM = &SM;
+  }
+  auto It = FilesWithNOLINT.find(FID);
+  if (It == FilesWithNOLINT.end()) {
+    bool Invalid = false;
+    StringRef Buffer = SM.getBufferData(FID, &Invalid);
+    It = FilesWithNOLINT
+             .try_emplace(FID, Invalid || Buffer.find("NOLINT") !=
+                                              StringRef::npos)
+             .first;
+  }
+  return It->second;
+}
+
 void ClangTidyDiagnosticConsumer::HandleDiagnostic(
     DiagnosticsEngine::Level DiagLevel, const Diagnostic &Info) {
   if (LastErrorWasIgnored && DiagLevel == DiagnosticsEngine::Note)
@@ -388,9 +440,11 @@ void ClangTidyDiagnosticConsumer::HandleDiagnostic(
 
   if (Info.getLocation().isValid() && DiagLevel != DiagnosticsEngine::Error &&
       DiagLevel != DiagnosticsEngine::Fatal &&
-      LineIsMarkedWithNOLINTinMacro(Info.getSourceManager(),
-                                    Info.getLocation(), Info.getID(),
-                                    Context)) {
+      LineIsMarkedWithNOLINTinMacro(
+          Info.getSourceManager(), Info.getLocation(), Info.getID(), Context,
+          [&](FileID FID) {
+            return mayHaveNOLINT(Info.getSourceManager(), FID);
+          })) {
     ++Context.Stats.ErrorsIgnoredNOLINT;
     // Ignored a warning, should ignore related notes as well
     LastErrorWasIgnored = true;
@@ -404,8 +458,16 @@ void ClangTidyDiagnosticConsumer::HandleDiagnostic(
   if (DiagLevel == DiagnosticsEngine::Note) {
     assert(!Errors.empty() &&
            "A diagnostic note can only be appended to a message.");
+    if (!PendingDiags.empty()) {
+      if (Info.hasSourceManager())
+        checkFilters(Info.getLocation(), Info.getSourceManager());
+      PendingDiags.emplace_back(DiagLevel, Info);
+      // A note in user code makes the whole error relate to user code.
+      if (LastErrorRelatesToUserCode)
+        emitPendingDiagnostics();
+      return;
+    }
   } else {
-    finalizeLastError();
     std::string CheckName = Context.getCheckName(Info.getID());
     if (CheckName.empty()) {
       // This is a compiler diagnostic without a warning option. Assign check
@@ -424,9 +486,20 @@ void ClangTidyDiagnosticConsumer::HandleDiagnostic(
       }
     }
 
+    bool IsError = DiagLevel == DiagnosticsEngine::Error ||
+                   DiagLevel == DiagnosticsEngine::Fatal;
+    if (!IsError && !Context.isCheckEnabled(CheckName)) {
+      // finalizeLastError() would drop it whatever its location and notes, so
+      // it isn't rendered at all. Like with NOLINT, the previous error stays
+      // the last one.
+      ++Context.Stats.ErrorsIgnoredCheckFilter;
+      LastErrorWasIgnored = true;
+      return;
+    }
+
+    finalizeLastError();
     ClangTidyError::Level Level = ClangTidyError::Warning;
-    if (DiagLevel == DiagnosticsEngine::Error ||
-        DiagLevel == DiagnosticsEngine::Fatal) {
+    if (IsError) {
       // Force reporting of Clang errors regardless of filters and non-user
       // code.
       Level = ClangTidyError::Error;
@@ -437,23 +510,52 @@ void ClangTidyDiagnosticConsumer::HandleDiagnostic(
                             Context.treatAsError(CheckName);
     Errors.emplace_back(CheckName, Level, Context.getCurrentBuildDirectory(),
                         IsWarningAsError);
+
+    // Rendering is the expensive part, and most warnings outside of user code
+    // are dropped. Keep them until a note relates them to user code, or the
+    // next error drops them. Outside of a source file, the SourceManager may
+    // not outlive the diagnostic.
+    if (Info.hasSourceManager()) {
+      checkFilters(Info.getLocation(), Info.getSourceManager());
+      if (!LastErrorRelatesToUserCode && SourceFileDepth > 0) {
+        PendingDiags.emplace_back(DiagLevel, Info);
+        return;
+      }
+    }
   }
 
-  ClangTidyDiagnosticRenderer Converter(
-      Context.getLangOpts(), &Context.DiagEngine->getDiagnosticOptions(),
-      Errors.back());
   SmallString<100> Message;
   Info.FormatDiagnostic(Message);
   FullSourceLoc Loc;
   if (Info.getLocation().isValid() && Info.hasSourceManager())
     Loc = FullSourceLoc(Info.getLocation(), Info.getSourceManager());
-  Converter.emitDiagnostic(Loc, DiagLevel, Message, Info.getRanges(),
-                           Info.getFixItHints());
+  emitDiagnostic(Loc, DiagLevel, Message, Info.getRanges(),
+                 Info.getFixItHints());
 
-  if (Info.hasSourceManager())
+  if (DiagLevel == DiagnosticsEngine::Note && Info.hasSourceManager())
     checkFilters(Info.getLocation(), Info.getSourceManager());
 }
 
+void ClangTidyDiagnosticConsumer::emitDiagnostic(
+    FullSourceLoc Loc, DiagnosticsEngine::Level DiagLevel, StringRef Message,
+    ArrayRef<CharSourceRange> Ranges, ArrayRef<FixItHint> FixIts) {
+  ClangTidyDiagnosticRenderer Converter(
+      Context.getLangOpts(), &Context.DiagEngine->getDiagnosticOptions(),
+      Errors.back());
+  Converter.emitDiagnostic(Loc, DiagLevel, Message, Ranges, FixIts);
+}
+
+void ClangTidyDiagnosticConsumer::emitPendingDiagnostics() {
+  for (const StoredDiagnostic &Diag : PendingDiags) {
+    FullSourceLoc Loc;
+    if (Diag.getLocation().isValid())
+      Loc = Diag.getLocation();
+    emitDiagnostic(Loc, Diag.getLevel(), Diag.getMessage(), Diag.getRanges(),
+                   Diag.getFixIts());
+  }
+  PendingDiags.clear();
+}
+
 bool ClangTidyDiagnosticConsumer::passesLineFilter(StringRef FileName,
                                                    unsigned LineNumber) const {
   if (Context.getGlobalOptions().LineFilter.empty())
@@ -502,13 +604,22 @@ void ClangTidyDiagnosticConsumer::checkFilters(SourceLocation Location,
   StringRef FileName(File->getName());
   LastErrorRelatesToUserCode = LastErrorRelatesToUserCode ||
                                Sources.isInMainFile(Location) ||
-                               getHeaderFilter()->match(FileName);
+                               matchesHeaderFilter(FileName);
 
   unsigned LineNumber = Sources.getExpansionLineNumber(Location);
   LastErrorPassesLineFilter =
       LastErrorPassesLineFilter || passesLineFilter(FileName, LineNumber);
 }
 
+bool ClangTidyDiagnosticConsumer::matchesHeaderFilter(StringRef FileName) {
+  auto It = HeaderFilterMatches.find(FileName);
+  if (It == HeaderFilterMatches.end())
+    It = HeaderFilterMatches
+             .try_emplace(FileName, getHeaderFilter()->match(FileName))
+             .first;
+  return It->second;
+}
+
 llvm::Regex *ClangTidyDiagnosticConsumer::getHeaderFilter() {
   if (!HeaderFilter)
     HeaderFilter =
@@ -516,7 +627,7 @@ llvm::Regex *ClangTidyDiagnosticConsumer::getHeaderFilter() {
   return HeaderFilter.get();
 }
 
-void ClangTidyDiagnosticConsumer::removeIncompatibleErrors() {
+static void removeIncompatibleErrors(std::vector<ClangTidyError> &Errors) {
   // Each error is modelled as the set of intervals in which it applies
   // replacements. To detect overlapping replacements, we use a sweep line
   // algorithm over these sets of intervals.
@@ -591,7 +702,7 @@ void ClangTidyDiagnosticConsumer::removeIncompatibleErrors() {
   }
 
   // Build events from error intervals.
-  std::map<std::string, std::vector<Event>> FileEvents;
+  llvm::StringMap<std::vector<Event>> FileEvents;
   for (unsigned I = 0; I < Errors.size(); ++I) {
     for (const auto &FileAndReplace : Errors[I].Fix) {
       for (const auto &Replace : FileAndReplace.second) {
@@ -611,6 +722,11 @@ void ClangTidyDiagnosticConsumer::removeIncompatibleErrors() {
   std::vector<bool> Apply(Errors.size(), true);
   for (auto &FileAndEvents : FileEvents) {
     std::vector<Event> &Events = FileAndEvents.second;
+    // The replacements of a single error don't overlap each other, and the
+    // events of an error are contiguous. Most files only have the fixes of one
+    // error and need no sorting.
+    if (Events.front().ErrorId == Events.back().ErrorId)
+      continue;
     // Sweep.
     std::sort(Events.begin(), Events.end());
     int OpenIntervals = 0;
@@ -657,10 +773,35 @@ struct EqualClangTidyError {
 std::vector<ClangTidyError> ClangTidyDiagnosticConsumer::take() {
   finalizeLastError();
 
-  std::sort(Errors.begin(), Errors.end(), LessClangTidyError());
-  Errors.erase(std::unique(Errors.begin(), Errors.end(), EqualClangTidyError()),
-               Errors.end());
-  if (RemoveIncompatibleErrors)
-    removeIncompatibleErrors();
+  deduplicateErrors(Errors, RemoveIncompatibleErrors);
   return std::move(Errors);
 }
+
+void clang::tidy::deduplicateErrors(std::vector<ClangTidyError> &Errors,
+                                    bool RemoveIncompatibleErrors) {
+  // Errors are large, sort pointers to them and move each error only once.
+  std::vector<ClangTidyError *> Order;
+  Order.reserve(Errors.size());
+  for (ClangTidyError &Error : Errors)
+    Order.push_back(&Error);
+  LessClangTidyError Less;
+  EqualClangTidyError Equal;
+  std::sort(Order.begin(), Order.end(),
+            [&](const ClangTidyError *LHS, const ClangTidyError *RHS) {
+              return Less(*LHS, *RHS);
+            });
+  Order.erase(std::unique(Order.begin(), Order.end(),
+                          [&](const ClangTidyError *LHS,
+                              const ClangTidyError *RHS) {
+                            return Equal(*LHS, *RHS);
+                          }),
+              Order.end());
+  std::vector<ClangTidyError> Sorted;
+  Sorted.reserve(Order.size());
+  for (ClangTidyError *Error : Order)
+    Sorted.push_back(std::move(*Error));
+  Errors = std::move(Sorted);
+
+  if (RemoveIncompatibleErrors)
+    removeIncompatibleErrors(Errors);
+}
@@ -11,6 +11,7 @@
 
 #include "ClangTidyOptions.h"
 #include "ClangTidyProfiling.h"
+#include "IncludeDirectives.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Tooling/Core/Diagnostic.h"
@@ -19,6 +20,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/Timer.h"
+#include <functional>
 
 namespace clang {
 
@@ -50,6 +52,10 @@ struct ClangTidyError : tooling::Diagnostic {
 /// \brief Read-only set of strings represented as a list of positive and
 /// negative globs. Positive globs add all matched strings to the set, negative
 /// globs remove them in the order of appearance in the list.
+///
+/// Globs are matched without regular expressions: a glob is split at its '*'s
+/// into literal parts, which must be found in order in the string. The list is
+/// scanned from the end, and stops at the first matching glob.
 class GlobList {
 public:
   /// \brief \p GlobList is a comma-separated list of globs (only '*'
@@ -58,14 +64,20 @@ public:
 
   /// \brief Returns \c true if the pattern matches \p S. The result is the last
   /// matching glob's Positive flag.
-  bool contains(StringRef S) { return contains(S, false); }
+  bool contains(StringRef S) const;
 
 private:
-  bool contains(StringRef S, bool Contains);
+  struct Glob {
+    bool Positive;
+    /// The text between the '*'s of the glob, so a glob without '*' has a
+    /// single part, and one starting or ending with '*' an empty first or
+    /// last part.
+    std::vector<std::string> Parts;
+
+    bool matches(StringRef S) const;
+  };
 
-  bool Positive;
-  llvm::Regex Regex;
-  std::unique_ptr<GlobList> NextGlob;
+  std::vector<Glob> Globs;
 };
 
 /// \brief Contains displayed and ignored diagnostic counters for a ClangTidy
@@ -85,6 +97,15 @@ struct ClangTidyStats {
     return ErrorsIgnoredNOLINT + ErrorsIgnoredCheckFilter +
            ErrorsIgnoredNonUserCode + ErrorsIgnoredLineFilter;
   }
+
+  ClangTidyStats &operator+=(const ClangTidyStats &Other) {
+    ErrorsDisplayed += Other.ErrorsDisplayed;
+    ErrorsIgnoredCheckFilter += Other.ErrorsIgnoredCheckFilter;
+    ErrorsIgnoredNOLINT += Other.ErrorsIgnoredNOLINT;
+    ErrorsIgnoredNonUserCode += Other.ErrorsIgnoredNonUserCode;
+    ErrorsIgnoredLineFilter += Other.ErrorsIgnoredLineFilter;
+    return *this;
+  }
 };
 
 /// \brief Every \c ClangTidyCheck reports errors through a \c DiagnosticsEngine
@@ -165,6 +186,10 @@ public:
   /// counters.
   const ClangTidyStats &getStats() const { return Stats; }
 
+  /// \brief Adds the counters of another context, e.g. one that processed
+  /// other translation units in parallel.
+  void addStats(const ClangTidyStats &Other) { Stats += Other; }
+
   /// \brief Control profile collection in clang-tidy.
   void setEnableProfiling(bool Profile);
   bool getEnableProfiling() const { return Profile; }
@@ -174,6 +199,29 @@ public:
   llvm::Optional<ClangTidyProfiling::StorageParams>
   getProfileStorageParams() const;
 
+  /// \brief If set, profiles are added to \p Aggregator instead of being
+  /// printed.
+  void setProfileAggregator(ProfileAggregator *Aggregator) {
+    this->Aggregator = Aggregator;
+  }
+  ProfileAggregator *getProfileAggregator() const { return Aggregator; }
+
+  /// \brief If true, the callbacks of the checks are profiled too, see
+  /// ClangTidyProfiling::Callbacks.
+  void setProfileCallbacks(bool ProfileCallbacks) {
+    this->ProfileCallbacks = ProfileCallbacks;
+  }
+  bool getProfileCallbacks() const { return ProfileCallbacks; }
+
+  /// \brief The profiling of the current translation unit, if its callbacks
+  /// are profiled.
+  void setCallbackProfiling(ClangTidyProfiling *Profiling) {
+    CallbackProfiling = Profiling;
+  }
+  ClangTidyProfiling *getCallbackProfiling() const {
+    return CallbackProfiling;
+  }
+
   /// \brief Should be called when starting to process new translation unit.
   void setCurrentBuildDirectory(StringRef BuildDirectory) {
     CurrentBuildDirectory = BuildDirectory;
@@ -190,6 +238,20 @@ public:
     return AllowEnablingAnalyzerAlphaCheckers;
   }
 
+  /// \brief Returns the #include directives of the current translation unit,
+  /// shared by the checks inserting includes.
+  IncludeDirectives &getIncludeDirectives() { return Includes; }
+
+  /// \brief Returns \c true if the header \p FID of the current translation
+  /// unit is checked by another translation unit of the run, see
+  /// \c HeaderClaims. Checks working on the preprocessor skip such headers.
+  bool isHeaderClaimedByOthers(FileID FID) const {
+    return HeaderClaimFilter && HeaderClaimFilter(FID);
+  }
+  void setHeaderClaimFilter(std::function<bool(FileID)> Filter) {
+    HeaderClaimFilter = std::move(Filter);
+  }
+
 private:
   // Writes to Stats.
   friend class ClangTidyDiagnosticConsumer;
@@ -209,10 +271,17 @@ private:
 
   std::string CurrentBuildDirectory;
 
+  IncludeDirectives Includes;
+
+  std::function<bool(FileID)> HeaderClaimFilter;
+
   llvm::DenseMap<unsigned, std::string> CheckNamesByDiagnosticID;
 
   bool Profile;
   std::string ProfilePrefix;
+  ProfileAggregator *Aggregator = nullptr;
+  bool ProfileCallbacks = false;
+  ClangTidyProfiling *CallbackProfiling = nullptr;
 
   bool AllowEnablingAnalyzerAlphaCheckers;
 };
@@ -233,31 +302,63 @@ public:
   void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
                         const Diagnostic &Info) override;
 
+  void BeginSourceFile(const LangOptions &LangOpts,
+                       const Preprocessor *PP = nullptr) override;
+  void EndSourceFile() override;
+
   // Retrieve the diagnostics that were captured.
   std::vector<ClangTidyError> take();
 
 private:
   void finalizeLastError();
-  void removeIncompatibleErrors();
 
   /// \brief Returns the \c HeaderFilter constructed for the options set in the
   /// context.
   llvm::Regex *getHeaderFilter();
 
+  /// \brief Returns true if \p FileName matches the \c HeaderFilter. Results
+  /// are cached, many diagnostics are usually in the same headers.
+  bool matchesHeaderFilter(StringRef FileName);
+
   /// \brief Updates \c LastErrorRelatesToUserCode and LastErrorPassesLineFilter
   /// according to the diagnostic \p Location.
   void checkFilters(SourceLocation Location, const SourceManager& Sources);
   bool passesLineFilter(StringRef FileName, unsigned LineNumber) const;
 
+  /// \brief Returns false if the file \p FID doesn't contain "NOLINT"
+  /// anywhere, so that its lines don't need to be scanned.
+  bool mayHaveNOLINT(const SourceManager &SM, FileID FID);
+
+  /// \brief Renders a diagnostic into the last error.
+  void emitDiagnostic(FullSourceLoc Loc, DiagnosticsEngine::Level DiagLevel,
+                      StringRef Message, ArrayRef<CharSourceRange> Ranges,
+                      ArrayRef<FixItHint> FixIts);
+  void emitPendingDiagnostics();
+
   ClangTidyContext &Context;
   bool RemoveIncompatibleErrors;
   std::vector<ClangTidyError> Errors;
   std::unique_ptr<llvm::Regex> HeaderFilter;
+  llvm::StringMap<bool> HeaderFilterMatches;
   bool LastErrorRelatesToUserCode;
   bool LastErrorPassesLineFilter;
   bool LastErrorWasIgnored;
+  /// The diagnostics of the last error, while it doesn't relate to user code.
+  /// They are rendered only if one of its notes does.
+  std::vector<StoredDiagnostic> PendingDiags;
+  /// Whether each file of \c FilesWithNOLINTSM contains "NOLINT".
+  llvm::DenseMap<FileID, bool> FilesWithNOLINT;
+  const SourceManager *FilesWithNOLINTSM = nullptr;
+  unsigned SourceFileDepth = 0;
 };
 
+/// \brief Sorts \p Errors and removes duplicates, like
+/// \c ClangTidyDiagnosticConsumer::take() does. If \p RemoveIncompatibleErrors
+/// is true, also drops the fixes that overlap with other fixes. Used to merge
+/// the errors of several consumers.
+void deduplicateErrors(std::vector<ClangTidyError> &Errors,
+                       bool RemoveIncompatibleErrors = true);
+
 } // end namespace tidy
 } // end namespace clang
 
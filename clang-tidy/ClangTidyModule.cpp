@@ -15,17 +15,30 @@
 namespace clang {
 namespace tidy {
 
-void ClangTidyCheckFactories::registerCheckFactory(StringRef Name,
-                                                   CheckFactory Factory) {
+void ClangTidyCheckFactories::registerCheckFactory(
+    StringRef Name, CheckFactory Factory,
+    LanguagePredicate IsLanguageSupported) {
   Factories[Name] = std::move(Factory);
+  if (IsLanguageSupported)
+    LanguagePredicates[Name] = IsLanguageSupported;
+  else
+    LanguagePredicates.erase(Name);
 }
 
 void ClangTidyCheckFactories::createChecks(
     ClangTidyContext *Context,
-    std::vector<std::unique_ptr<ClangTidyCheck>> &Checks) {
+    std::vector<std::unique_ptr<ClangTidyCheck>> &Checks,
+    const LangOptions *LangOpts) const {
   for (const auto &Factory : Factories) {
-    if (Context->isCheckEnabled(Factory.first))
-      Checks.emplace_back(Factory.second(Factory.first, Context));
+    if (!Context->isCheckEnabled(Factory.first))
+      continue;
+    if (LangOpts) {
+      auto Predicate = LanguagePredicates.find(Factory.first);
+      if (Predicate != LanguagePredicates.end() &&
+          !Predicate->second(*LangOpts))
+        continue;
+    }
+    Checks.emplace_back(Factory.second(Factory.first, Context));
   }
 }
 
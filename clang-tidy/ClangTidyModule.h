@@ -10,6 +10,7 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANGTIDYMODULE_H
 
 #include "ClangTidy.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include <functional>
 #include <map>
@@ -28,11 +29,15 @@ public:
   typedef std::function<ClangTidyCheck *(StringRef Name,
                                          ClangTidyContext *Context)>
       CheckFactory;
+  typedef bool (*LanguagePredicate)(const LangOptions &LangOpts);
 
   /// \brief Registers check \p Factory with name \p Name.
   ///
   /// For all checks that have default constructors, use \c registerCheck.
-  void registerCheckFactory(StringRef Name, CheckFactory Factory);
+  /// If \p IsLanguageSupported is given, the check is only created for the
+  /// translation units it returns true for.
+  void registerCheckFactory(StringRef Name, CheckFactory Factory,
+                            LanguagePredicate IsLanguageSupported = nullptr);
 
   /// \brief Registers the \c CheckType with the name \p Name.
   ///
@@ -55,19 +60,27 @@ public:
   ///   }
   /// };
   /// \endcode
+  ///
+  /// The check is only created for the languages accepted by
+  /// \c CheckType::isLanguageSupported.
   template <typename CheckType> void registerCheck(StringRef CheckName) {
     registerCheckFactory(CheckName,
                          [](StringRef Name, ClangTidyContext *Context) {
                            return new CheckType(Name, Context);
-                         });
+                         },
+                         &CheckType::isLanguageSupported);
   }
 
   /// \brief Create instances of all checks matching \p CheckRegexString and
   /// store them in \p Checks.
   ///
+  /// If \p LangOpts is given, only the checks supporting that language are
+  /// created.
+  ///
   /// The caller takes ownership of the return \c ClangTidyChecks.
   void createChecks(ClangTidyContext *Context,
-                    std::vector<std::unique_ptr<ClangTidyCheck>> &Checks);
+                    std::vector<std::unique_ptr<ClangTidyCheck>> &Checks,
+                    const LangOptions *LangOpts = nullptr) const;
 
   typedef std::map<std::string, CheckFactory> FactoryMap;
   FactoryMap::const_iterator begin() const { return Factories.begin(); }
@@ -76,6 +89,7 @@ public:
 
 private:
   FactoryMap Factories;
+  llvm::StringMap<LanguagePredicate> LanguagePredicates;
 };
 
 /// \brief A clang-tidy module groups a number of \c ClangTidyChecks and gives
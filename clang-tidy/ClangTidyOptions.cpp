@@ -217,7 +217,8 @@ FileOptionsProvider::FileOptionsProvider(
     const ClangTidyOptions &OverrideOptions,
     const FileOptionsProvider::ConfigFileHandlers &ConfigHandlers)
     : DefaultOptionsProvider(GlobalOptions, DefaultOptions),
-      OverrideOptions(OverrideOptions), ConfigHandlers(ConfigHandlers) {}
+      OverrideOptions(OverrideOptions), ConfigHandlers(ConfigHandlers),
+      FS(llvm::vfs::getRealFileSystem()) {}
 
 // FIXME: This method has some common logic with clang::format::getStyle().
 // Consider pulling out common bits to a findParentFileWithName function or
@@ -240,33 +241,46 @@ FileOptionsProvider::getRawOptions(StringRef FileName) {
   // Look for a suitable configuration file in all parent directories of the
   // file. Start with the immediate parent directory and move up.
   StringRef Path = llvm::sys::path::parent_path(AbsoluteFilePath.str());
-  for (StringRef CurrentPath = Path; !CurrentPath.empty();
+  std::shared_ptr<const OptionsSource> Result = findConfiguration(Path);
+  if (Result)
+    RawOptions.push_back(*Result);
+  RawOptions.push_back(CommandLineOptions);
+  return RawOptions;
+}
+
+std::shared_ptr<const FileOptionsProvider::OptionsSource>
+FileOptionsProvider::findConfiguration(StringRef Path) {
+  StringRef CurrentPath = Path;
+  std::shared_ptr<const OptionsSource> Result;
+  for (; !CurrentPath.empty();
        CurrentPath = llvm::sys::path::parent_path(CurrentPath)) {
-    llvm::Optional<OptionsSource> Result;
-
-    auto Iter = CachedOptions.find(CurrentPath);
-    if (Iter != CachedOptions.end())
-      Result = Iter->second;
-
-    if (!Result)
-      Result = tryReadConfigFile(CurrentPath);
-
-    if (Result) {
-      // Store cached value for all intermediate directories.
-      while (Path != CurrentPath) {
-        LLVM_DEBUG(llvm::dbgs()
-                   << "Caching configuration for path " << Path << ".\n");
-        CachedOptions[Path] = *Result;
-        Path = llvm::sys::path::parent_path(Path);
+    {
+      std::lock_guard<std::mutex> Lock(CacheMutex);
+      auto Iter = CachedOptions.find(CurrentPath);
+      if (Iter != CachedOptions.end()) {
+        Result = Iter->second;
+        break;
       }
-      CachedOptions[Path] = *Result;
-
-      RawOptions.push_back(*Result);
+    }
+    if (llvm::Optional<OptionsSource> Found = tryReadConfigFile(CurrentPath)) {
+      Result = std::make_shared<const OptionsSource>(std::move(*Found));
       break;
     }
   }
-  RawOptions.push_back(CommandLineOptions);
-  return RawOptions;
+
+  // Store the result for all intermediate directories, even when no
+  // configuration was found, so that they aren't probed again. They all share
+  // the same options.
+  std::lock_guard<std::mutex> Lock(CacheMutex);
+  while (Path != CurrentPath) {
+    LLVM_DEBUG(llvm::dbgs()
+               << "Caching configuration for path " << Path << ".\n");
+    CachedOptions[Path] = Result;
+    Path = llvm::sys::path::parent_path(Path);
+  }
+  if (!CurrentPath.empty())
+    CachedOptions[CurrentPath] = Result;
+  return Result;
 }
 
 llvm::Optional<OptionsSource>
@@ -303,6 +317,17 @@ FileOptionsProvider::tryReadConfigFile(StringRef Directory) {
     // redirection.
     if ((*Text)->getBuffer().empty())
       continue;
+    // Identical configuration files, e.g. copied to several projects, are
+    // parsed once.
+    std::string Key = ConfigHandler.first;
+    Key += '\0';
+    Key += (*Text)->getBuffer();
+    {
+      std::lock_guard<std::mutex> Lock(CacheMutex);
+      auto Iter = ParsedConfigs.find(Key);
+      if (Iter != ParsedConfigs.end())
+        return OptionsSource(Iter->second, ConfigFile.c_str());
+    }
     llvm::ErrorOr<ClangTidyOptions> ParsedOptions =
         ConfigHandler.second((*Text)->getBuffer());
     if (!ParsedOptions) {
@@ -311,6 +336,8 @@ FileOptionsProvider::tryReadConfigFile(StringRef Directory) {
                      << ParsedOptions.getError().message() << "\n";
       continue;
     }
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    ParsedConfigs.try_emplace(Key, *ParsedOptions);
     return OptionsSource(*ParsedOptions, ConfigFile.c_str());
   }
   return llvm::None;
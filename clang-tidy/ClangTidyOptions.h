@@ -17,6 +17,8 @@
 #include "llvm/Support/VirtualFileSystem.h"
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <utility>
@@ -43,6 +45,11 @@ struct ClangTidyGlobalOptions {
   /// \brief Output warnings from certain line ranges of certain files only.
   /// If empty, no warnings will be filtered.
   std::vector<FileFilter> LineFilter;
+
+  /// \brief If set, the AST matchers only visit the top-level declarations
+  /// that overlap a line range of \c LineFilter, so that checking the changed
+  /// lines of a diff costs in proportion to the diff.
+  bool SkipUnchangedDecls = false;
 };
 
 /// \brief Contains options for clang-tidy. These options may be read from
@@ -252,7 +259,20 @@ protected:
   /// \c ConfigHandlers.
   llvm::Optional<OptionsSource> tryReadConfigFile(llvm::StringRef Directory);
 
-  llvm::StringMap<OptionsSource> CachedOptions;
+  /// \brief Returns the configuration that applies to the directory \p Path,
+  /// read from it or from its closest parent directory that has one, or null
+  /// if there is none.
+  std::shared_ptr<const OptionsSource> findConfiguration(llvm::StringRef Path);
+
+  /// The configuration of each directory looked up, null if none applies to
+  /// it. Directories using the same configuration file share it.
+  llvm::StringMap<std::shared_ptr<const OptionsSource>> CachedOptions;
+  /// The options parsed from each configuration file contents, keyed by the
+  /// name of the handler and the contents.
+  llvm::StringMap<ClangTidyOptions> ParsedConfigs;
+  /// Guards CachedOptions and ParsedConfigs, so that files can be looked up by
+  /// several threads.
+  std::mutex CacheMutex;
   ClangTidyOptions OverrideOptions;
   ConfigFileHandlers ConfigHandlers;
   llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS;
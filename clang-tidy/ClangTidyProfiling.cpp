@@ -7,9 +7,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "ClangTidyProfiling.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
@@ -43,14 +46,46 @@ void ClangTidyProfiling::printUserFriendlyTable(llvm::raw_ostream &OS) {
   OS.flush();
 }
 
+void ClangTidyProfiling::printCallbacksTable(llvm::raw_ostream &OS) {
+  std::string Title = "clang-tidy check callbacks profiling";
+  OS << "===" << std::string(73, '-') << "===\n"
+     << std::string((80 - Title.size()) / 2, ' ') << Title << "\n"
+     << "===" << std::string(73, '-') << "===\n"
+     << "   ---User Time---   --System Time--   ---Wall Time---     Calls  "
+        "--- Name ---\n";
+  for (const auto &Row : getCallbackRows()) {
+    const llvm::TimeRecord &Time = Row.second.Time;
+    OS << llvm::format("  %8.4f           %8.4f           %8.4f         %9u  ",
+                       Time.getUserTime(), Time.getSystemTime(),
+                       Time.getWallTime(), Row.second.Calls)
+       << Row.first << "\n";
+  }
+  OS << "\n";
+  OS.flush();
+}
+
 void ClangTidyProfiling::printAsJSON(llvm::raw_ostream &OS) {
   OS << "{\n";
   OS << "\"file\": \"" << Storage->SourceFilename << "\",\n";
   OS << "\"timestamp\": \"" << Storage->Timestamp << "\",\n";
   OS << "\"profile\": {\n";
   TG->printJSONValues(OS, "");
+  OS << "\n}";
+  if (!Callbacks.empty()) {
+    OS << ",\n\"callbacks\": {\n";
+    llvm::StringRef Separator = "";
+    for (const auto &Row : getCallbackRows()) {
+      const llvm::TimeRecord &Time = Row.second.Time;
+      OS << Separator << "\t" << llvm::json::Value(Row.first) << ": "
+         << llvm::json::Object{{"calls", Row.second.Calls},
+                               {"wall", Time.getWallTime()},
+                               {"user", Time.getUserTime()},
+                               {"sys", Time.getSystemTime()}};
+      Separator = ",\n";
+    }
+    OS << "\n}";
+  }
   OS << "\n}\n";
-  OS << "}\n";
   OS.flush();
 }
 
@@ -79,13 +114,156 @@ void ClangTidyProfiling::storeProfileData() {
 ClangTidyProfiling::ClangTidyProfiling(llvm::Optional<StorageParams> Storage)
     : Storage(std::move(Storage)) {}
 
+ClangTidyProfiling::ClangTidyProfiling(llvm::Optional<StorageParams> Storage,
+                                       ProfileAggregator *Aggregator,
+                                       llvm::StringRef SourceFile)
+    : Storage(std::move(Storage)), Aggregator(Aggregator),
+      SourceFile(SourceFile) {}
+
+void ClangTidyProfiling::addCallback(llvm::StringRef Check,
+                                     llvm::StringRef BoundIDs,
+                                     const llvm::TimeRecord &Time) {
+  CallbackRecord &Total = Callbacks[(Check + "::check()").str()];
+  Total.Time += Time;
+  ++Total.Calls;
+  // Keep the name distinct from the total.
+  if (BoundIDs.empty())
+    BoundIDs = "<none>";
+  CallbackRecord &ByNodes =
+      Callbacks[(Check + "::check(" + BoundIDs + ")").str()];
+  ByNodes.Time += Time;
+  ++ByNodes.Calls;
+}
+
+std::vector<std::pair<std::string, ClangTidyProfiling::CallbackRecord>>
+ClangTidyProfiling::getCallbackRows() const {
+  std::vector<std::pair<std::string, CallbackRecord>> Rows;
+  for (const auto &Callback : Callbacks) {
+    Rows.emplace_back(Callback.getKey(), Callback.getValue());
+    llvm::StringRef Check = Callback.getKey();
+    if (!Check.consume_back("::check()"))
+      continue;
+    // The time of a check in Records includes its callbacks.
+    auto It = Records.find(Check);
+    if (It == Records.end())
+      continue;
+    CallbackRecord Matching;
+    Matching.Time = It->getValue();
+    Matching.Time -= Callback.getValue().Time;
+    Rows.emplace_back((Check + "::matching").str(), Matching);
+  }
+  llvm::sort(Rows, [](const std::pair<std::string, CallbackRecord> &L,
+                      const std::pair<std::string, CallbackRecord> &R) {
+    return std::make_pair(-L.second.Time.getWallTime(), L.first) <
+           std::make_pair(-R.second.Time.getWallTime(), R.first);
+  });
+  return Rows;
+}
+
 ClangTidyProfiling::~ClangTidyProfiling() {
+  if (Aggregator) {
+    Aggregator->add(SourceFile, Records);
+    llvm::StringMap<llvm::TimeRecord> CheckTimes;
+    for (const auto &Callback : Callbacks) {
+      llvm::StringRef Name = Callback.getKey();
+      if (Name.consume_back("::check()"))
+        CheckTimes[Name] += Callback.getValue().Time;
+    }
+    if (!CheckTimes.empty())
+      Aggregator->addCallbacks(CheckTimes);
+  }
+
   TG.emplace("clang-tidy", "clang-tidy checks profiling", Records);
 
-  if (!Storage.hasValue())
-    printUserFriendlyTable(llvm::errs());
-  else
+  if (Storage.hasValue()) {
     storeProfileData();
+  } else if (!Aggregator) {
+    printUserFriendlyTable(llvm::errs());
+    if (!Callbacks.empty())
+      printCallbacksTable(llvm::errs());
+  }
+}
+
+void ProfileAggregator::add(llvm::StringRef SourceFile,
+                            const llvm::StringMap<llvm::TimeRecord> &Records) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  ++NumFiles;
+  for (const auto &Record : Records) {
+    CheckTimes &Times = Checks[Record.getKey()];
+    double Wall = Record.getValue().getWallTime();
+    if (Times.WallTimes.empty() || Wall > Times.SlowestTime) {
+      Times.SlowestTime = Wall;
+      Times.SlowestFile = SourceFile;
+    }
+    Times.Total += Record.getValue();
+    Times.WallTimes.push_back(Wall);
+  }
+}
+
+void ProfileAggregator::addCallbacks(
+    const llvm::StringMap<llvm::TimeRecord> &CheckTimes) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  for (const auto &Check : CheckTimes)
+    CallbackTotals[Check.getKey()] += Check.getValue();
+}
+
+llvm::StringMap<llvm::TimeRecord> ProfileAggregator::getTotals() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  llvm::StringMap<llvm::TimeRecord> Totals;
+  for (const auto &Check : Checks)
+    Totals[Check.getKey()] = Check.getValue().Total;
+  return Totals;
+}
+
+llvm::StringMap<llvm::TimeRecord> ProfileAggregator::getCallbackTotals() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  return CallbackTotals;
+}
+
+// The nearest-rank percentile of sorted values.
+static double percentile(llvm::ArrayRef<double> Sorted, unsigned Percent) {
+  size_t Rank = (Sorted.size() * Percent + 99) / 100;
+  return Sorted[Rank ? Rank - 1 : 0];
+}
+
+void ProfileAggregator::print(llvm::raw_ostream &OS) const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  using Entry = std::pair<llvm::StringRef, const CheckTimes *>;
+  std::vector<Entry> Sorted;
+  double TotalWall = 0;
+  for (const auto &Check : Checks) {
+    Sorted.emplace_back(Check.getKey(), &Check.getValue());
+    TotalWall += Check.getValue().Total.getWallTime();
+  }
+  llvm::sort(Sorted, [](const Entry &L, const Entry &R) {
+    return std::make_pair(-L.second->Total.getWallTime(), L.first) <
+           std::make_pair(-R.second->Total.getWallTime(), R.first);
+  });
+
+  std::string Title = ("clang-tidy checks profile of " + llvm::Twine(NumFiles) +
+                       " translation units")
+                          .str();
+  OS << "===" << std::string(73, '-') << "===\n"
+     << std::string((80 - Title.size()) / 2, ' ') << Title << "\n"
+     << "===" << std::string(73, '-') << "===\n"
+     << "  Total Wall Time: " << llvm::format("%.4f", TotalWall)
+     << " seconds\n\n"
+     << "   ---Wall Time---   --User--   --Sys---  -Median-   ---90%--  "
+        "--Max---  TUs  --- Name ---\n";
+  for (const auto &Check : Sorted) {
+    const CheckTimes &Times = *Check.second;
+    std::vector<double> WallTimes = Times.WallTimes;
+    llvm::sort(WallTimes);
+    double Wall = Times.Total.getWallTime();
+    OS << llvm::format("  %8.4f (%5.1f%%)  %8.4f  %8.4f  %8.4f   %8.4f  %8.4f"
+                       "  %3u  ",
+                       Wall, TotalWall ? 100 * Wall / TotalWall : 0.0,
+                       Times.Total.getUserTime(), Times.Total.getSystemTime(),
+                       percentile(WallTimes, 50), percentile(WallTimes, 90),
+                       Times.SlowestTime, unsigned(WallTimes.size()))
+       << Check.first << " (slowest: " << Times.SlowestFile << ")\n";
+  }
+  OS.flush();
 }
 
 } // namespace tidy
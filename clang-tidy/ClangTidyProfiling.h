@@ -14,6 +14,7 @@
 #include "llvm/Support/Chrono.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -21,6 +22,45 @@
 namespace clang {
 namespace tidy {
 
+/// \brief Merges the check profiles of translation units into a report of the
+/// whole run. Thread-safe, translation units processed by several threads can
+/// share an aggregator.
+class ProfileAggregator {
+public:
+  void add(llvm::StringRef SourceFile,
+           const llvm::StringMap<llvm::TimeRecord> &Records);
+
+  /// \brief Adds the time spent in the check() method of each check, keyed by
+  /// check name, when callbacks are profiled.
+  void addCallbacks(const llvm::StringMap<llvm::TimeRecord> &CheckTimes);
+
+  /// \brief Returns the total time of each check, matching and callbacks.
+  llvm::StringMap<llvm::TimeRecord> getTotals() const;
+
+  /// \brief Returns the total time spent in the check() method of each check.
+  llvm::StringMap<llvm::TimeRecord> getCallbackTotals() const;
+
+  /// \brief Prints, for each check, its total time over all translation
+  /// units, then the median, 90th percentile and maximum of its time per
+  /// translation unit, and its slowest translation unit. Checks are sorted by
+  /// decreasing total wall time.
+  void print(llvm::raw_ostream &OS) const;
+
+private:
+  struct CheckTimes {
+    llvm::TimeRecord Total;
+    /// The wall time of each translation unit the check ran on.
+    std::vector<double> WallTimes;
+    double SlowestTime = 0;
+    std::string SlowestFile;
+  };
+
+  mutable std::mutex Mu;
+  llvm::StringMap<CheckTimes> Checks;
+  llvm::StringMap<llvm::TimeRecord> CallbackTotals;
+  unsigned NumFiles = 0;
+};
+
 class ClangTidyProfiling {
 public:
   struct StorageParams {
@@ -38,7 +78,11 @@ private:
 
   llvm::Optional<StorageParams> Storage;
 
+  ProfileAggregator *Aggregator = nullptr;
+  std::string SourceFile;
+
   void printUserFriendlyTable(llvm::raw_ostream &OS);
+  void printCallbacksTable(llvm::raw_ostream &OS);
   void printAsJSON(llvm::raw_ostream &OS);
 
   void storeProfileData();
@@ -46,10 +90,37 @@ private:
 public:
   llvm::StringMap<llvm::TimeRecord> Records;
 
+  struct CallbackRecord {
+    llvm::TimeRecord Time;
+    unsigned Calls = 0;
+  };
+
+  /// \brief The time spent in the check() method of each check, named
+  /// "<check>::check()", and in the calls with each set of bound nodes, named
+  /// "<check>::check(<IDs>)". As checks usually bind different nodes in each
+  /// of their matchers, the latter tell the matchers apart. Only filled when
+  /// ClangTidyContext::getProfileCallbacks() is true.
+  llvm::StringMap<CallbackRecord> Callbacks;
+
+  /// \brief Adds a call to the check() method of \p Check, with the nodes
+  /// bound to \p BoundIDs, separated by commas.
+  void addCallback(llvm::StringRef Check, llvm::StringRef BoundIDs,
+                   const llvm::TimeRecord &Time);
+
+  /// \brief Returns the callbacks and, for each check with callbacks, the time
+  /// spent matching, named "<check>::matching", sorted by decreasing wall
+  /// time. Matching calls aren't counted.
+  std::vector<std::pair<std::string, CallbackRecord>> getCallbackRows() const;
+
   ClangTidyProfiling() = default;
 
   ClangTidyProfiling(llvm::Optional<StorageParams> Storage);
 
+  /// \brief Adds the records to \p Aggregator instead of printing them. They
+  /// are still stored if \p Storage is set.
+  ClangTidyProfiling(llvm::Optional<StorageParams> Storage,
+                     ProfileAggregator *Aggregator, llvm::StringRef SourceFile);
+
   ~ClangTidyProfiling();
 };
 
@@ -0,0 +1,60 @@
+//===--- IncludeDirectives.cpp - clang-tidy -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "IncludeDirectives.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Token.h"
+
+namespace clang {
+namespace tidy {
+
+class IncludeDirectivesCallbacks : public PPCallbacks {
+public:
+  IncludeDirectivesCallbacks(IncludeDirectives &Directives,
+                             const SourceManager &SM)
+      : Directives(Directives), SM(SM) {}
+
+  void InclusionDirective(SourceLocation HashLocation,
+                          const Token &IncludeToken, StringRef FileName,
+                          bool IsAngled, CharSourceRange FileNameRange,
+                          const FileEntry * /*IncludedFile*/,
+                          StringRef /*SearchPath*/, StringRef /*RelativePath*/,
+                          const Module * /*ImportedModule*/,
+                          SrcMgr::CharacteristicKind /*FileType*/) override {
+    Directives.DirectivesByFile[SM.getFileID(HashLocation)].push_back(
+        {FileName, IsAngled, HashLocation, IncludeToken.getEndLoc()});
+  }
+
+private:
+  IncludeDirectives &Directives;
+  const SourceManager &SM;
+};
+
+std::unique_ptr<PPCallbacks>
+IncludeDirectives::createPPCallbacks(const SourceManager &SM) {
+  if (Recording)
+    return llvm::make_unique<PPCallbacks>();
+  Recording = true;
+  return llvm::make_unique<IncludeDirectivesCallbacks>(*this, SM);
+}
+
+llvm::ArrayRef<IncludeDirectives::Directive>
+IncludeDirectives::getDirectives(FileID File) const {
+  auto It = DirectivesByFile.find(File);
+  if (It == DirectivesByFile.end())
+    return llvm::None;
+  return It->second;
+}
+
+void IncludeDirectives::reset() {
+  DirectivesByFile.clear();
+  Recording = false;
+}
+
+} // end namespace tidy
+} // end namespace clang
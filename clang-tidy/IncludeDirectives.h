@@ -0,0 +1,61 @@
+//===--- IncludeDirectives.h - clang-tidy -----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_INCLUDEDIRECTIVES_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_INCLUDEDIRECTIVES_H
+
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+class SourceManager;
+
+namespace tidy {
+
+/// \brief The #include directives of the current translation unit, by file.
+///
+/// Checks inserting includes need the directives already in a file.
+/// ``ClangTidyContext`` keeps a single instance, so that the directives are
+/// recorded once for all these checks instead of once per check.
+class IncludeDirectives {
+public:
+  struct Directive {
+    std::string FileName;
+    bool IsAngled;
+    SourceLocation HashLocation;
+    SourceLocation EndLocation;
+  };
+
+  /// Returns the callbacks recording the directives of the preprocessor of
+  /// \p SM, the first time it is called since the last ``reset()``. Later
+  /// calls return callbacks doing nothing, the directives are already being
+  /// recorded.
+  std::unique_ptr<PPCallbacks> createPPCallbacks(const SourceManager &SM);
+
+  /// Returns the directives of \p File, in order.
+  llvm::ArrayRef<Directive> getDirectives(FileID File) const;
+
+  /// Forgets the directives, before the next translation unit.
+  void reset();
+
+private:
+  friend class IncludeDirectivesCallbacks;
+
+  llvm::DenseMap<FileID, std::vector<Directive>> DirectivesByFile;
+  bool Recording = false;
+};
+
+} // end namespace tidy
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_INCLUDEDIRECTIVES_H
@@ -0,0 +1,313 @@
+//===--- ResultCache.cpp - clang-tidy -------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ResultCache.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+namespace {
+
+std::string hashContents(llvm::StringRef Data) {
+  return llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef(Data)));
+}
+
+llvm::json::Value toJSON(const tooling::DiagnosticMessage &Message) {
+  return llvm::json::Object{{"message", Message.Message},
+                            {"filePath", Message.FilePath},
+                            {"fileOffset", Message.FileOffset}};
+}
+
+llvm::json::Value toJSON(const ClangTidyError &Error) {
+  llvm::json::Array Notes;
+  for (const tooling::DiagnosticMessage &Note : Error.Notes)
+    Notes.push_back(toJSON(Note));
+  llvm::json::Array Fix;
+  for (const auto &FileAndReplacements : Error.Fix) {
+    for (const tooling::Replacement &R : FileAndReplacements.second)
+      Fix.push_back(llvm::json::Object{{"filePath", R.getFilePath()},
+                                       {"offset", R.getOffset()},
+                                       {"length", R.getLength()},
+                                       {"text", R.getReplacementText()}});
+  }
+  return llvm::json::Object{{"name", Error.DiagnosticName},
+                            {"level", static_cast<int>(Error.DiagLevel)},
+                            {"buildDirectory", Error.BuildDirectory},
+                            {"warningAsError", Error.IsWarningAsError},
+                            {"message", toJSON(Error.Message)},
+                            {"notes", std::move(Notes)},
+                            {"fix", std::move(Fix)}};
+}
+
+llvm::json::Value toJSON(const ClangTidyStats &Stats) {
+  return llvm::json::Object{
+      {"errorsDisplayed", Stats.ErrorsDisplayed},
+      {"errorsIgnoredCheckFilter", Stats.ErrorsIgnoredCheckFilter},
+      {"errorsIgnoredNOLINT", Stats.ErrorsIgnoredNOLINT},
+      {"errorsIgnoredNonUserCode", Stats.ErrorsIgnoredNonUserCode},
+      {"errorsIgnoredLineFilter", Stats.ErrorsIgnoredLineFilter}};
+}
+
+bool fromJSON(const llvm::json::Value &V, tooling::DiagnosticMessage &Message) {
+  const llvm::json::Object *O = V.getAsObject();
+  if (!O)
+    return false;
+  auto Text = O->getString("message");
+  auto FilePath = O->getString("filePath");
+  auto FileOffset = O->getInteger("fileOffset");
+  if (!Text || !FilePath || !FileOffset)
+    return false;
+  Message.Message = *Text;
+  Message.FilePath = *FilePath;
+  Message.FileOffset = *FileOffset;
+  return true;
+}
+
+bool fromJSON(const llvm::json::Value &V, ClangTidyError &Error) {
+  const llvm::json::Object *O = V.getAsObject();
+  if (!O)
+    return false;
+  auto Name = O->getString("name");
+  auto Level = O->getInteger("level");
+  auto BuildDirectory = O->getString("buildDirectory");
+  auto WarningAsError = O->getBoolean("warningAsError");
+  const llvm::json::Value *Message = O->get("message");
+  const llvm::json::Array *Notes = O->getArray("notes");
+  const llvm::json::Array *Fix = O->getArray("fix");
+  if (!Name || !Level || !BuildDirectory || !WarningAsError || !Message ||
+      !Notes || !Fix)
+    return false;
+  Error = ClangTidyError(*Name, static_cast<ClangTidyError::Level>(*Level),
+                         *BuildDirectory, *WarningAsError);
+  if (!fromJSON(*Message, Error.Message))
+    return false;
+  for (const llvm::json::Value &Note : *Notes) {
+    Error.Notes.emplace_back();
+    if (!fromJSON(Note, Error.Notes.back()))
+      return false;
+  }
+  for (const llvm::json::Value &Value : *Fix) {
+    const llvm::json::Object *R = Value.getAsObject();
+    if (!R)
+      return false;
+    auto FilePath = R->getString("filePath");
+    auto Offset = R->getInteger("offset");
+    auto Length = R->getInteger("length");
+    auto Text = R->getString("text");
+    if (!FilePath || !Offset || !Length || !Text)
+      return false;
+    if (llvm::Error Err = Error.Fix[*FilePath].add(
+            tooling::Replacement(*FilePath, *Offset, *Length, *Text))) {
+      llvm::consumeError(std::move(Err));
+      return false;
+    }
+  }
+  return true;
+}
+
+bool fromJSON(const llvm::json::Value &V, ClangTidyStats &Stats) {
+  const llvm::json::Object *O = V.getAsObject();
+  if (!O)
+    return false;
+  auto Displayed = O->getInteger("errorsDisplayed");
+  auto CheckFilter = O->getInteger("errorsIgnoredCheckFilter");
+  auto NOLINT = O->getInteger("errorsIgnoredNOLINT");
+  auto NonUserCode = O->getInteger("errorsIgnoredNonUserCode");
+  auto LineFilter = O->getInteger("errorsIgnoredLineFilter");
+  if (!Displayed || !CheckFilter || !NOLINT || !NonUserCode || !LineFilter)
+    return false;
+  Stats.ErrorsDisplayed = *Displayed;
+  Stats.ErrorsIgnoredCheckFilter = *CheckFilter;
+  Stats.ErrorsIgnoredNOLINT = *NOLINT;
+  Stats.ErrorsIgnoredNonUserCode = *NonUserCode;
+  Stats.ErrorsIgnoredLineFilter = *LineFilter;
+  return true;
+}
+
+bool fromJSON(const llvm::json::Value &V, CachedResult &Result) {
+  const llvm::json::Object *O = V.getAsObject();
+  if (!O)
+    return false;
+  const llvm::json::Array *Errors = O->getArray("errors");
+  const llvm::json::Value *Stats = O->get("stats");
+  const llvm::json::Array *Dependencies = O->getArray("dependencies");
+  if (!Errors || !Stats || !Dependencies || !fromJSON(*Stats, Result.Stats))
+    return false;
+  for (const llvm::json::Value &Error : *Errors) {
+    Result.Errors.emplace_back("", ClangTidyError::Warning, "", false);
+    if (!fromJSON(Error, Result.Errors.back()))
+      return false;
+  }
+  for (const llvm::json::Value &Value : *Dependencies) {
+    const llvm::json::Object *Dependency = Value.getAsObject();
+    if (!Dependency)
+      return false;
+    auto Path = Dependency->getString("path");
+    auto Hash = Dependency->getString("hash");
+    if (!Path || !Hash)
+      return false;
+    Result.Dependencies.emplace_back(*Path, *Hash);
+  }
+  return true;
+}
+
+} // namespace
+
+llvm::Optional<std::string>
+ResultCache::getKey(llvm::ArrayRef<tooling::CompileCommand> Commands,
+                    const ClangTidyOptions &Options,
+                    const ClangTidyGlobalOptions &GlobalOptions,
+                    bool AllowEnablingAnalyzerAlphaCheckers,
+                    llvm::StringRef MainFile, llvm::vfs::FileSystem &FS) {
+  auto Buffer = FS.getBufferForFile(MainFile);
+  if (!Buffer)
+    return llvm::None;
+
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  OS << getClangToolFullVersion("clang-tidy") << '\0';
+  for (const tooling::CompileCommand &Cmd : Commands) {
+    OS << Cmd.Directory << '\0' << Cmd.Filename << '\0';
+    for (const std::string &Arg : Cmd.CommandLine)
+      OS << Arg << '\0';
+    OS << '\1';
+  }
+  OS << configurationAsText(Options) << '\0';
+  // Not part of the configuration file, but they change the diagnostics.
+  OS << Options.SystemHeaders.getValueOr(false)
+     << AllowEnablingAnalyzerAlphaCheckers << '\0';
+  for (const FileFilter &Filter : GlobalOptions.LineFilter) {
+    OS << Filter.Name;
+    for (const FileFilter::LineRange &Range : Filter.LineRanges)
+      OS << ':' << Range.first << '-' << Range.second;
+    OS << '\0';
+  }
+  OS << hashContents((*Buffer)->getBuffer());
+  return hashContents(OS.str());
+}
+
+// Entries are spread over subdirectories named after the first two digits of
+// their keys, so that no directory gets too large.
+static std::string entryPath(llvm::StringRef Dir, llvm::StringRef Key) {
+  llvm::SmallString<256> Path(Dir);
+  llvm::sys::path::append(Path, Key.take_front(2), Key + ".json");
+  return Path.str();
+}
+
+llvm::Optional<CachedResult>
+ResultCache::lookup(llvm::StringRef Key, llvm::vfs::FileSystem &FS) const {
+  auto Buffer = llvm::MemoryBuffer::getFile(entryPath(Dir, Key));
+  if (!Buffer)
+    return llvm::None;
+  auto JSON = llvm::json::parse((*Buffer)->getBuffer());
+  if (!JSON) {
+    llvm::consumeError(JSON.takeError());
+    return llvm::None;
+  }
+  CachedResult Result;
+  if (!fromJSON(*JSON, Result))
+    return llvm::None;
+  for (const auto &Dependency : Result.Dependencies) {
+    auto DependencyBuffer = FS.getBufferForFile(Dependency.first);
+    if (!DependencyBuffer ||
+        hashContents((*DependencyBuffer)->getBuffer()) != Dependency.second)
+      return llvm::None;
+  }
+  return std::move(Result);
+}
+
+void ResultCache::store(llvm::StringRef Key, const CachedResult &Result) const {
+  llvm::json::Array Errors;
+  for (const ClangTidyError &Error : Result.Errors)
+    Errors.push_back(toJSON(Error));
+  llvm::json::Array Dependencies;
+  for (const auto &Dependency : Result.Dependencies)
+    Dependencies.push_back(llvm::json::Object{{"path", Dependency.first},
+                                              {"hash", Dependency.second}});
+  llvm::json::Value Entry =
+      llvm::json::Object{{"errors", std::move(Errors)},
+                         {"stats", toJSON(Result.Stats)},
+                         {"dependencies", std::move(Dependencies)}};
+
+  // The entry is written to a temporary file and renamed, so that concurrent
+  // readers never see a partial entry.
+  std::string Path = entryPath(Dir, Key);
+  if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(Path)))
+    return;
+  int FD;
+  llvm::SmallString<256> TempPath;
+  if (llvm::sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", FD, TempPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Entry;
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath, Path))
+    llvm::sys::fs::remove(TempPath);
+}
+
+llvm::Optional<std::vector<std::pair<std::string, std::string>>>
+getDependencies(CompilerInstance &Compiler) {
+  // Module files are read outside of the SourceManager.
+  if (Compiler.getLangOpts().Modules)
+    return llvm::None;
+
+  std::vector<std::pair<std::string, std::string>> Dependencies;
+  const SourceManager &SM = Compiler.getSourceManager();
+  FileManager &FM = Compiler.getFileManager();
+  auto AddDependency = [&](llvm::StringRef File,
+                           llvm::StringRef Contents) {
+    llvm::SmallString<256> Path(File);
+    FM.makeAbsolutePath(Path);
+    llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+    Dependencies.emplace_back(Path.str(), hashContents(Contents));
+  };
+  for (auto It = SM.fileinfo_begin(), End = SM.fileinfo_end(); It != End;
+       ++It) {
+    if (const llvm::MemoryBuffer *Buffer = It->second->getRawBuffer()) {
+      AddDependency(It->first->getName(), Buffer->getBuffer());
+      continue;
+    }
+    // Files that were looked up but never loaded.
+    auto Buffer = FM.getVirtualFileSystem().getBufferForFile(
+        It->first->getName());
+    if (!Buffer)
+      return llvm::None;
+    AddDependency(It->first->getName(), (*Buffer)->getBuffer());
+  }
+
+  const std::string &PCH = Compiler.getPreprocessorOpts().ImplicitPCHInclude;
+  if (!PCH.empty()) {
+    llvm::SmallString<256> Path(PCH);
+    FM.makeAbsolutePath(Path);
+    auto Buffer = FM.getVirtualFileSystem().getBufferForFile(Path);
+    if (!Buffer)
+      return llvm::None;
+    AddDependency(Path, (*Buffer)->getBuffer());
+  }
+  return std::move(Dependencies);
+}
+
+} // end namespace tidy
+} // end namespace clang
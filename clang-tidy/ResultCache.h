@@ -0,0 +1,79 @@
+//===--- ResultCache.h - clang-tidy -----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_RESULTCACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_RESULTCACHE_H
+
+#include "ClangTidyDiagnosticConsumer.h"
+#include "ClangTidyOptions.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang {
+class CompilerInstance;
+
+namespace tidy {
+
+/// \brief The outcome of running clang-tidy on a translation unit.
+struct CachedResult {
+  std::vector<ClangTidyError> Errors;
+  /// What processing the translation unit added to the context's stats.
+  ClangTidyStats Stats;
+  /// The files the translation unit read, with their SHA1 as hex strings.
+  std::vector<std::pair<std::string, std::string>> Dependencies;
+};
+
+/// \brief Stores the results of translation units in a directory, so that
+/// unchanged translation units aren't parsed again.
+///
+/// Like ccache's direct mode, a result is found by a key computed without
+/// preprocessing: the compile commands, the options, the version of clang-tidy
+/// and the contents of the main file. Then the files the translation unit read
+/// are hashed, and compared to those recorded with the result.
+///
+/// Entries are written atomically, the cache can be shared by several threads
+/// and processes.
+class ResultCache {
+public:
+  ResultCache(llvm::StringRef Dir) : Dir(Dir) {}
+
+  /// Returns the key of a translation unit, or None if its main file can't be
+  /// read. \p AllowEnablingAnalyzerAlphaCheckers changes the checks that run.
+  static llvm::Optional<std::string>
+  getKey(llvm::ArrayRef<tooling::CompileCommand> Commands,
+         const ClangTidyOptions &Options,
+         const ClangTidyGlobalOptions &GlobalOptions,
+         bool AllowEnablingAnalyzerAlphaCheckers, llvm::StringRef MainFile,
+         llvm::vfs::FileSystem &FS);
+
+  /// Returns the result stored for \p Key, if the files it depends on are
+  /// unchanged.
+  llvm::Optional<CachedResult> lookup(llvm::StringRef Key,
+                                      llvm::vfs::FileSystem &FS) const;
+
+  void store(llvm::StringRef Key, const CachedResult &Result) const;
+
+private:
+  std::string Dir;
+};
+
+/// \brief Returns the files read by the translation unit in \p Compiler with
+/// the SHA1 of their contents, or None if they can't all be tracked, e.g. with
+/// modules.
+llvm::Optional<std::vector<std::pair<std::string, std::string>>>
+getDependencies(CompilerInstance &Compiler);
+
+} // end namespace tidy
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_RESULTCACHE_H
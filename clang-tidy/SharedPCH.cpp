@@ -0,0 +1,266 @@
+//===--- SharedPCH.cpp - clang-tidy ---------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "SharedPCH.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Frontend/Utils.h"
+#include "clang/Tooling/ArgumentsAdjusters.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tidy {
+
+std::vector<std::string> getLeadingIncludes(llvm::StringRef Code) {
+  std::vector<std::string> Includes;
+  bool InBlockComment = false;
+  while (!Code.empty()) {
+    llvm::StringRef Line;
+    std::tie(Line, Code) = Code.split('\n');
+    Line = Line.trim();
+    if (InBlockComment) {
+      size_t End = Line.find("*/");
+      if (End == llvm::StringRef::npos)
+        continue;
+      InBlockComment = false;
+      Line = Line.drop_front(End + 2).ltrim();
+    }
+    if (Line.startswith("/*")) {
+      size_t End = Line.find("*/", 2);
+      if (End == llvm::StringRef::npos) {
+        InBlockComment = true;
+        continue;
+      }
+      Line = Line.drop_front(End + 2).ltrim();
+    }
+    if (Line.empty() || Line.startswith("//"))
+      continue;
+    // Anything else than an #include of a header name ends the run: other
+    // directives may change what the headers mean.
+    if (!Line.consume_front("#"))
+      break;
+    Line = Line.ltrim();
+    if (!Line.consume_front("include"))
+      break;
+    Line = Line.ltrim();
+    if (!Line.startswith("<") && !Line.startswith("\""))
+      break;
+    Includes.push_back(("#include " + Line).str());
+  }
+  return Includes;
+}
+
+namespace {
+
+std::string absolutePath(llvm::StringRef Directory, llvm::StringRef File) {
+  llvm::SmallString<256> Path;
+  if (llvm::sys::path::is_absolute(File))
+    Path = File;
+  else
+    llvm::sys::path::append(Path, Directory, File);
+  llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  return Path.str();
+}
+
+// The language of the PCH for a main file, as given to -x.
+llvm::StringRef headerLanguage(llvm::StringRef File) {
+  llvm::StringRef Ext = llvm::sys::path::extension(File);
+  if (Ext == ".c")
+    return "c-header";
+  if (Ext == ".m")
+    return "objective-c-header";
+  if (Ext == ".mm")
+    return "objective-c++-header";
+  return "c++-header";
+}
+
+// Files with the same flags, in the same directory, can share a PCH.
+struct Group {
+  std::string Directory; // Of the commands.
+  std::string SourceDirectory;
+  std::vector<std::string> Flags;
+  std::vector<std::string> Files;
+  // The #include lines all files start with.
+  std::vector<std::string> Includes;
+};
+
+// The arguments of \p Cmd, without the input file and the outputs. Commands
+// of the files in a group only differ in those.
+std::vector<std::string> getFlags(const tooling::CompileCommand &Cmd,
+                                  llvm::StringRef AbsolutePath) {
+  std::vector<std::string> Args = tooling::getClangStripOutputAdjuster()(
+      Cmd.CommandLine, Cmd.Filename);
+  Args = tooling::getClangStripDependencyFileAdjuster()(Args, Cmd.Filename);
+  llvm::erase_if(Args, [&](const std::string &Arg) {
+    return Arg == Cmd.Filename ||
+           absolutePath(Cmd.Directory, Arg) == AbsolutePath;
+  });
+  return Args;
+}
+
+bool buildPCH(const Group &G, llvm::StringRef Prelude, llvm::StringRef PCH,
+              llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS) {
+  std::vector<std::string> Args = G.Flags;
+  // The main files find quoted includes in their own directory.
+  Args.insert(Args.end(), {"-iquote", G.SourceDirectory, "-x",
+                           headerLanguage(G.Files.front()).str(), Prelude.str(),
+                           "-o", PCH.str()});
+  std::vector<const char *> Argv;
+  for (const std::string &Arg : Args)
+    Argv.push_back(Arg.c_str());
+
+  IgnoringDiagConsumer IgnoreDiags;
+  llvm::IntrusiveRefCntPtr<DiagnosticsEngine> CommandLineDiags =
+      CompilerInstance::createDiagnostics(new DiagnosticOptions, &IgnoreDiags,
+                                          /*ShouldOwnClient=*/false);
+  std::shared_ptr<CompilerInvocation> CI =
+      createInvocationFromCommandLine(Argv, CommandLineDiags, FS);
+  if (!CI)
+    return false;
+  CI->getFrontendOpts().DisableFree = false;
+  CI->getFileSystemOpts().WorkingDir = G.Directory;
+  // Main files are parsed with __clang_analyzer__ defined, the headers must
+  // see it too.
+  CI->getFrontendOpts().ProgramAction = frontend::RunAnalysis;
+
+  CompilerInstance Clang;
+  Clang.setInvocation(std::move(CI));
+  Clang.createDiagnostics(&IgnoreDiags, /*ShouldOwnClient=*/false);
+  Clang.createFileManager(FS);
+  GeneratePCHAction Action;
+  return Clang.ExecuteAction(Action) &&
+         !Clang.getDiagnostics().hasErrorOccurred();
+}
+
+} // namespace
+
+SharedPCHDatabase::SharedPCHDatabase(
+    const tooling::CompilationDatabase &Base,
+    llvm::ArrayRef<std::string> InputFiles, llvm::StringRef PCHDir,
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS)
+    : Base(Base) {
+  auto CWD = FS->getCurrentWorkingDirectory();
+  if (!CWD)
+    return;
+  std::string AbsolutePCHDir = absolutePath(*CWD, PCHDir);
+  if (std::error_code EC = llvm::sys::fs::create_directories(AbsolutePCHDir)) {
+    llvm::errs() << "Error creating PCH directory " << AbsolutePCHDir << ": "
+                 << EC.message() << "\n";
+    return;
+  }
+
+  // Groups are kept in the order of their first file, so that the PCHs get
+  // the same names in every run.
+  std::vector<Group> Groups;
+  llvm::StringMap<size_t> GroupIndex;
+  for (const std::string &File : InputFiles) {
+    std::string AbsolutePath = absolutePath(*CWD, File);
+    auto Commands = Base.getCompileCommands(AbsolutePath);
+    if (Commands.empty())
+      continue;
+    const tooling::CompileCommand &Cmd = Commands.front();
+    if (llvm::is_contained(Cmd.CommandLine, "-include-pch"))
+      continue;
+    auto Buffer = FS->getBufferForFile(AbsolutePath);
+    if (!Buffer)
+      continue;
+    std::vector<std::string> Includes =
+        getLeadingIncludes((*Buffer)->getBuffer());
+    if (Includes.empty())
+      continue;
+
+    std::vector<std::string> Flags = getFlags(Cmd, AbsolutePath);
+    std::string SourceDirectory = llvm::sys::path::parent_path(AbsolutePath);
+    std::string Key = Cmd.Directory + '\0' + SourceDirectory + '\0' +
+                      headerLanguage(AbsolutePath).str() + '\0' +
+                      llvm::join(Flags, llvm::StringRef("\0", 1));
+    auto Inserted = GroupIndex.try_emplace(Key, Groups.size());
+    if (Inserted.second) {
+      Groups.emplace_back();
+      Group &G = Groups.back();
+      G.Directory = Cmd.Directory;
+      G.SourceDirectory = std::move(SourceDirectory);
+      G.Flags = std::move(Flags);
+      G.Includes = std::move(Includes);
+      G.Files.push_back(std::move(AbsolutePath));
+      continue;
+    }
+    Group &G = Groups[Inserted.first->second];
+    size_t Common = 0;
+    while (Common < G.Includes.size() && Common < Includes.size() &&
+           G.Includes[Common] == Includes[Common])
+      ++Common;
+    G.Includes.resize(Common);
+    G.Files.push_back(std::move(AbsolutePath));
+  }
+
+  for (size_t I = 0; I < Groups.size(); ++I) {
+    const Group &G = Groups[I];
+    if (G.Files.size() < 2 || G.Includes.empty())
+      continue;
+    llvm::SmallString<256> Prelude(AbsolutePCHDir), PCH(AbsolutePCHDir);
+    llvm::sys::path::append(Prelude, "shared-" + llvm::Twine(I) + ".h");
+    llvm::sys::path::append(PCH, "shared-" + llvm::Twine(I) + ".pch");
+    {
+      std::error_code EC;
+      llvm::raw_fd_ostream OS(Prelude, EC, llvm::sys::fs::F_Text);
+      if (EC)
+        continue;
+      for (const std::string &Include : G.Includes)
+        OS << Include << "\n";
+    }
+    if (!buildPCH(G, Prelude, PCH, FS)) {
+      llvm::errs() << "Failed to build a shared PCH for " << G.Files.front()
+                   << " and " << G.Files.size() - 1 << " other files\n";
+      continue;
+    }
+    for (const std::string &File : G.Files)
+      PCHs[File] = PCH.str();
+  }
+}
+
+std::vector<tooling::CompileCommand>
+SharedPCHDatabase::getCompileCommands(llvm::StringRef FilePath) const {
+  std::vector<tooling::CompileCommand> Commands =
+      Base.getCompileCommands(FilePath);
+  llvm::StringRef PCH = getPCH(FilePath);
+  if (PCH.empty())
+    return Commands;
+  for (tooling::CompileCommand &Cmd : Commands) {
+    if (Cmd.CommandLine.empty())
+      continue;
+    // Right after the compiler name.
+    Cmd.CommandLine.insert(Cmd.CommandLine.begin() + 1,
+                           {"-include-pch", PCH.str()});
+  }
+  return Commands;
+}
+
+std::vector<std::string> SharedPCHDatabase::getAllFiles() const {
+  return Base.getAllFiles();
+}
+
+std::vector<tooling::CompileCommand>
+SharedPCHDatabase::getAllCompileCommands() const {
+  return Base.getAllCompileCommands();
+}
+
+llvm::StringRef SharedPCHDatabase::getPCH(llvm::StringRef FilePath) const {
+  auto It = PCHs.find(absolutePath("", FilePath));
+  return It == PCHs.end() ? llvm::StringRef() : llvm::StringRef(It->second);
+}
+
+} // end namespace tidy
+} // end namespace clang
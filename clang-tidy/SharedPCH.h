@@ -0,0 +1,67 @@
+//===--- SharedPCH.h - clang-tidy -------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_SHAREDPCH_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_SHAREDPCH_H
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+
+/// \brief A compilation database that makes translation units share
+/// precompiled headers.
+///
+/// Input files with the same compile flags, in the same directory, usually
+/// start with the same #include directives. For each such group of at least
+/// two files, the longest run of #include lines they all start with is
+/// compiled into a PCH, and the files' commands are given "-include-pch".
+/// The headers are then parsed once per group instead of once per file. The
+/// directives in the main files are skipped by their include guards, so the
+/// headers must have include guards or "#pragma once".
+///
+/// Commands already using a PCH, e.g. one of the build system, are left alone.
+/// Compiler warnings in the precompiled headers are not reported, while
+/// clang-tidy checks still see their declarations.
+class SharedPCHDatabase : public tooling::CompilationDatabase {
+public:
+  /// Builds the PCHs of \p InputFiles into \p PCHDir, which is created if
+  /// needed. Groups whose PCH fails to build keep their original commands.
+  SharedPCHDatabase(const tooling::CompilationDatabase &Base,
+                    llvm::ArrayRef<std::string> InputFiles,
+                    llvm::StringRef PCHDir,
+                    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS);
+
+  std::vector<tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override;
+  std::vector<std::string> getAllFiles() const override;
+  std::vector<tooling::CompileCommand> getAllCompileCommands() const override;
+
+  /// Returns the PCH of \p FilePath, or an empty string if it has none.
+  llvm::StringRef getPCH(llvm::StringRef FilePath) const;
+
+private:
+  const tooling::CompilationDatabase &Base;
+  /// The PCH of each input file that has one, keyed by absolute path.
+  llvm::StringMap<std::string> PCHs;
+};
+
+/// \brief Returns the #include directives that \p Code starts with, skipping
+/// blank lines and comments. Exposed for testing.
+std::vector<std::string> getLeadingIncludes(llvm::StringRef Code);
+
+} // end namespace tidy
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_SHAREDPCH_H
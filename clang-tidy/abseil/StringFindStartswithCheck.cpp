@@ -115,8 +115,8 @@ void StringFindStartswithCheck::check(const MatchFinder::MatchResult &Result) {
 
 void StringFindStartswithCheck::registerPPCallbacks(
     const SourceManager &SM, Preprocessor *PP, Preprocessor *ModuleExpanderPP) {
-  IncludeInserter = llvm::make_unique<utils::IncludeInserter>(SM, getLangOpts(),
-                                                              IncludeStyle);
+  IncludeInserter = llvm::make_unique<utils::IncludeInserter>(
+      SM, getLangOpts(), IncludeStyle, &getIncludeDirectives());
   PP->addPPCallbacks(IncludeInserter->CreatePPCallbacks());
 }
 
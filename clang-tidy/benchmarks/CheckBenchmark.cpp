@@ -0,0 +1,126 @@
+//===--- CheckBenchmark.cpp - clang-tidy check benchmarks -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Runs each selected check alone over all the files of a compilation database,
+// e.g. a fixed corpus of representative translation units. The time of an
+// iteration includes parsing, which the "Parse" benchmark, running no check,
+// measures. Each benchmark also reports the seconds per iteration spent in the
+// check's matchers and in its check() callbacks, and the allocations per
+// iteration.
+//
+// The results of two versions can be compared with the compare.py script of
+// the benchmark library, from their --benchmark_out JSON reports.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../ClangTidy.h"
+#include "../ClangTidyForceLinker.h"
+#include "../ClangTidyProfiling.h"
+#include "benchmark/benchmark.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Counts allocations made by the benchmarked code.
+static std::atomic<size_t> Allocations = {0};
+
+void *operator new(size_t Size) {
+  ++Allocations;
+  if (void *Result = std::malloc(Size ? Size : 1))
+    return Result;
+  llvm::report_bad_alloc_error("Allocation failed");
+}
+
+void operator delete(void *Ptr) noexcept { std::free(Ptr); }
+
+namespace clang {
+namespace tidy {
+namespace {
+
+std::unique_ptr<tooling::CompilationDatabase> Compilations;
+std::vector<std::string> Files;
+
+// Runs the checks selected by \p Checks over all the files.
+void runChecks(benchmark::State &State, const std::string &Checks) {
+  ClangTidyOptions Options;
+  Options.Checks = Checks;
+  llvm::TimeRecord Total, Callbacks;
+  size_t Before = Allocations;
+  for (auto _ : State) {
+    ClangTidyContext Context(llvm::make_unique<DefaultOptionsProvider>(
+        ClangTidyGlobalOptions(),
+        ClangTidyOptions::getDefaults().mergeWith(Options)));
+    ProfileAggregator Aggregator;
+    Context.setProfileAggregator(&Aggregator);
+    Context.setProfileCallbacks(true);
+    llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> FS(
+        new llvm::vfs::OverlayFileSystem(llvm::vfs::getRealFileSystem()));
+    benchmark::DoNotOptimize(runClangTidy(Context, *Compilations, Files, FS,
+                                          /*EnableCheckProfile=*/true));
+    for (const auto &Check : Aggregator.getTotals())
+      Total += Check.getValue();
+    for (const auto &Check : Aggregator.getCallbackTotals())
+      Callbacks += Check.getValue();
+  }
+  double Iterations = State.iterations();
+  // The profile of a check covers its matchers and its callbacks.
+  State.counters["matching"] =
+      (Total.getWallTime() - Callbacks.getWallTime()) / Iterations;
+  State.counters["callbacks"] = Callbacks.getWallTime() / Iterations;
+  State.counters["allocs"] = double(Allocations - Before) / Iterations;
+}
+
+} // namespace
+} // namespace tidy
+} // namespace clang
+
+int main(int argc, char *argv[]) {
+  using namespace clang::tidy;
+  if (argc < 3) {
+    llvm::errs() << "Usage: " << argv[0]
+                 << " build-directory checks BENCHMARK_OPTIONS...\n";
+    return -1;
+  }
+  std::string Error;
+  Compilations =
+      clang::tooling::CompilationDatabase::loadFromDirectory(argv[1], Error);
+  if (!Compilations) {
+    llvm::errs() << "Error when loading the compilation database: " << Error
+                 << '\n';
+    return -1;
+  }
+  Files = Compilations->getAllFiles();
+
+  llvm::InitializeAllTargetInfos();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmParsers();
+
+  ClangTidyOptions Options;
+  Options.Checks = argv[2];
+  benchmark::RegisterBenchmark("Parse", runChecks, std::string("-*"));
+  for (const std::string &Check :
+       getCheckNames(ClangTidyOptions::getDefaults().mergeWith(Options),
+                     /*AllowEnablingAnalyzerAlphaCheckers=*/false))
+    benchmark::RegisterBenchmark(Check.c_str(), runChecks, "-*," + Check);
+
+  // Trim first two arguments of the benchmark invocation and pretend no
+  // arguments were passed in the first place.
+  argv[2] = argv[0];
+  argv += 2;
+  argc -= 2;
+  ::benchmark::Initialize(&argc, argv);
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -34,10 +34,12 @@ void StringConstructorCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
   Options.store(Opts, "LargeLengthThreshold", LargeLengthThreshold);
 }
 
-void StringConstructorCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus)
-    return;
+ArrayRef<StringRef> StringConstructorCheck::getRequiredIdentifiers() const {
+  static const StringRef Identifiers[] = {"basic_string"};
+  return Identifiers;
+}
 
+void StringConstructorCheck::registerMatchers(MatchFinder *Finder) {
   const auto ZeroExpr = expr(ignoringParenImpCasts(integerLiteral(equals(0))));
   const auto CharExpr = expr(ignoringParenImpCasts(characterLiteral()));
   const auto NegativeExpr = expr(ignoringParenImpCasts(
@@ -22,8 +22,12 @@ namespace bugprone {
 class StringConstructorCheck : public ClangTidyCheck {
 public:
   StringConstructorCheck(StringRef Name, ClangTidyContext *Context);
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus;
+  }
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  ArrayRef<StringRef> getRequiredIdentifiers() const override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 
 private:
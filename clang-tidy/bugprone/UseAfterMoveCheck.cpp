@@ -11,6 +11,7 @@
 #include "clang/Analysis/CFG.h"
 #include "clang/Lex/Lexer.h"
 
+#include "../utils/CFGCache.h"
 #include "../utils/ExprSequence.h"
 
 using namespace clang::ast_matchers;
@@ -36,7 +37,7 @@ struct UseAfterMove {
 /// various internal helper functions).
 class UseAfterMoveFinder {
 public:
-  UseAfterMoveFinder(ASTContext *TheContext);
+  UseAfterMoveFinder(ASTContext *TheContext, CFGCache &CFGs);
 
   // Within the given function body, finds the first use of 'MovedVariable' that
   // occurs after 'MovingCall' (the expression that performs the move). If a
@@ -59,8 +60,9 @@ private:
                   llvm::SmallPtrSetImpl<const DeclRefExpr *> *DeclRefs);
 
   ASTContext *Context;
-  std::unique_ptr<ExprSequence> Sequence;
-  std::unique_ptr<StmtToBlockMap> BlockMap;
+  CFGCache &CFGs;
+  const ExprSequence *Sequence = nullptr;
+  const StmtToBlockMap *BlockMap = nullptr;
   llvm::SmallPtrSet<const CFGBlock *, 8> Visited;
 };
 
@@ -80,30 +82,19 @@ static StatementMatcher inDecltypeOrTemplateArg() {
                    to(functionDecl(ast_matchers::isTemplateInstantiation())))));
 }
 
-UseAfterMoveFinder::UseAfterMoveFinder(ASTContext *TheContext)
-    : Context(TheContext) {}
+UseAfterMoveFinder::UseAfterMoveFinder(ASTContext *TheContext, CFGCache &CFGs)
+    : Context(TheContext), CFGs(CFGs) {}
 
 bool UseAfterMoveFinder::find(Stmt *FunctionBody, const Expr *MovingCall,
                               const ValueDecl *MovedVariable,
                               UseAfterMove *TheUseAfterMove) {
-  // Generate the CFG manually instead of through an AnalysisDeclContext because
-  // it seems the latter can't be used to generate a CFG for the body of a
-  // labmda.
-  //
-  // We include implicit and temporary destructors in the CFG so that
-  // destructors marked [[noreturn]] are handled correctly in the control flow
-  // analysis. (These are used in some styles of assertion macros.)
-  CFG::BuildOptions Options;
-  Options.AddImplicitDtors = true;
-  Options.AddTemporaryDtors = true;
-  std::unique_ptr<CFG> TheCFG =
-      CFG::buildCFG(nullptr, FunctionBody, Context, Options);
-  if (!TheCFG)
+  // The CFG of a function is built once for all the moves in it.
+  const CFGCache::Entry *Analyses = CFGs.get(FunctionBody, Context);
+  if (!Analyses)
     return false;
 
-  Sequence =
-      llvm::make_unique<ExprSequence>(TheCFG.get(), FunctionBody, Context);
-  BlockMap = llvm::make_unique<StmtToBlockMap>(TheCFG.get(), Context);
+  Sequence = Analyses->Sequence.get();
+  BlockMap = Analyses->BlockMap.get();
   Visited.clear();
 
   const CFGBlock *Block = BlockMap->blockContainingStmt(MovingCall);
@@ -374,9 +365,6 @@ static void emitDiagnostic(const Expr *MovingCall, const DeclRefExpr *MoveArg,
 }
 
 void UseAfterMoveCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus11)
-    return;
-
   auto CallMoveMatcher =
       callExpr(callee(functionDecl(hasName("::std::move"))), argumentCountIs(1),
                hasArgument(0, declRefExpr().bind("arg")),
@@ -402,6 +390,23 @@ void UseAfterMoveCheck::registerMatchers(MatchFinder *Finder) {
       this);
 }
 
+// Generate the CFG manually instead of through an AnalysisDeclContext because
+// it seems the latter can't be used to generate a CFG for the body of a
+// labmda.
+//
+// We include implicit and temporary destructors in the CFG so that
+// destructors marked [[noreturn]] are handled correctly in the control flow
+// analysis. (These are used in some styles of assertion macros.)
+static CFG::BuildOptions getCFGBuildOptions() {
+  CFG::BuildOptions Options;
+  Options.AddImplicitDtors = true;
+  Options.AddTemporaryDtors = true;
+  return Options;
+}
+
+UseAfterMoveCheck::UseAfterMoveCheck(StringRef Name, ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context), CFGs(getCFGBuildOptions()) {}
+
 void UseAfterMoveCheck::check(const MatchFinder::MatchResult &Result) {
   const auto *ContainingLambda =
       Result.Nodes.getNodeAs<LambdaExpr>("containing-lambda");
@@ -427,7 +432,7 @@ void UseAfterMoveCheck::check(const MatchFinder::MatchResult &Result) {
   if (!Arg->getDecl()->getDeclContext()->isFunctionOrMethod())
     return;
 
-  UseAfterMoveFinder finder(Result.Context);
+  UseAfterMoveFinder finder(Result.Context, CFGs);
   UseAfterMove Use;
   if (finder.find(FunctionBody, MovingCall, Arg->getDecl(), &Use))
     emitDiagnostic(MovingCall, Arg, Use, this, Result.Context);
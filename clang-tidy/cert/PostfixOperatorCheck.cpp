@@ -18,9 +18,6 @@ namespace tidy {
 namespace cert {
 
 void PostfixOperatorCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   Finder->addMatcher(functionDecl(anyOf(hasOverloadedOperatorName("++"),
                                         hasOverloadedOperatorName("--")),
                                   unless(isInstantiated()))
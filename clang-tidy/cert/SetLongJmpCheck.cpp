@@ -44,22 +44,12 @@ public:
 void SetLongJmpCheck::registerPPCallbacks(const SourceManager &SM,
                                           Preprocessor *PP,
                                           Preprocessor *ModuleExpanderPP) {
-  // This checker only applies to C++, where exception handling is a superior
-  // solution to setjmp/longjmp calls.
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   // Per [headers]p5, setjmp must be exposed as a macro instead of a function,
   // despite the allowance in C for setjmp to also be an extern function.
   PP->addPPCallbacks(llvm::make_unique<SetJmpMacroCallbacks>(*this));
 }
 
 void SetLongJmpCheck::registerMatchers(MatchFinder *Finder) {
-  // This checker only applies to C++, where exception handling is a superior
-  // solution to setjmp/longjmp calls.
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   // In case there is an implementation that happens to define setjmp as a
   // function instead of a macro, this will also catch use of it. However, we
   // are primarily searching for uses of longjmp.
@@ -30,6 +30,10 @@ public:
   NoMallocCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context),
         AllocList(Options.get("Allocations", "::malloc;::calloc")),
+  // C-style memory management is only problematic in C++.
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus;
+  }
         ReallocList(Options.get("Reallocations", "::realloc")),
         DeallocList(Options.get("Deallocations", "::free")) {}
 
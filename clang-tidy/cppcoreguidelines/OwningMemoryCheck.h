@@ -26,6 +26,9 @@ public:
       : ClangTidyCheck(Name, Context),
         LegacyResourceProducers(Options.get(
             "LegacyResourceProducers", "::malloc;::aligned_alloc;::realloc;"
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus11;
+  }
                                        "::calloc;::fopen;::freopen;::tmpfile")),
         LegacyResourceConsumers(Options.get(
             "LegacyResourceConsumers", "::free;::realloc;::freopen;::fclose")) {
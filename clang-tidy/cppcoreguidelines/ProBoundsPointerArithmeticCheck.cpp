@@ -17,9 +17,6 @@ namespace tidy {
 namespace cppcoreguidelines {
 
 void ProBoundsPointerArithmeticCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   const auto AllPointerTypes = anyOf(
       hasType(pointerType()), hasType(autoType(hasDeducedType(pointerType()))),
       hasType(decltypeType(hasUnderlyingType(pointerType()))));
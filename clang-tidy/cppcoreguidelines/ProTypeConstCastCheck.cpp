@@ -17,9 +17,6 @@ namespace tidy {
 namespace cppcoreguidelines {
 
 void ProTypeConstCastCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   Finder->addMatcher(cxxConstCastExpr().bind("cast"), this);
 }
 
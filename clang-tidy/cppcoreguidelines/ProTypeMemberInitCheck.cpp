@@ -253,9 +253,6 @@ ProTypeMemberInitCheck::ProTypeMemberInitCheck(StringRef Name,
       IgnoreArrays(Options.get("IgnoreArrays", false)) {}
 
 void ProTypeMemberInitCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   auto IsUserProvidedNonDelegatingConstructor =
       allOf(isUserProvided(),
             unless(anyOf(isInstantiated(), isDelegatingConstructor())));
@@ -53,10 +53,6 @@ FixItHint generateFixItHint(const VarDecl *Decl, bool IsConst) {
 }  // namespace
 
 void GlobalVariableDeclarationCheck::registerMatchers(MatchFinder *Finder) {
-  // The relevant Style Guide rule only applies to Objective-C.
-  if (!getLangOpts().ObjC)
-    return;
-
   // need to add two matchers since we need to bind different ids to distinguish
   // constants and variables. Since bind() can only be called on node matchers,
   // we cannot make it in one matcher.
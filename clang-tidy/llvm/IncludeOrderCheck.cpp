@@ -104,6 +104,10 @@ void IncludeOrderPPCallbacks::EndOfMainFile() {
   // know if the comment refers to the next include or the whole block that
   // follows.
   for (auto &Bucket : IncludeDirectives) {
+    // The includes of headers checked by another translation unit of the run
+    // are in the same order there.
+    if (Check.isHeaderClaimedByOthers(Bucket.first))
+      continue;
     auto &FileDirectives = Bucket.second;
     std::vector<unsigned> Blocks(1, 0);
     for (unsigned I = 1, E = FileDirectives.size(); I != E; ++I)
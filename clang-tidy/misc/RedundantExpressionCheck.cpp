@@ -18,6 +18,7 @@
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Casting.h"
 #include <algorithm>
 #include <cassert>
@@ -296,17 +297,20 @@ AST_MATCHER(Expr, isIntegerConstantExpr) {
   return Node.isIntegerConstantExpr(Finder->getASTContext());
 }
 
-AST_MATCHER(BinaryOperator, operandsAreEquivalent) {
-  return areEquivalentExpr(Node.getLHS(), Node.getRHS());
+AST_MATCHER_P(BinaryOperator, operandsAreEquivalent, ExprEquivalence *,
+              Equivalence) {
+  return Equivalence->areEquivalent(Node.getLHS(), Node.getRHS());
 }
 
-AST_MATCHER(ConditionalOperator, expressionsAreEquivalent) {
-  return areEquivalentExpr(Node.getTrueExpr(), Node.getFalseExpr());
+AST_MATCHER_P(ConditionalOperator, expressionsAreEquivalent, ExprEquivalence *,
+              Equivalence) {
+  return Equivalence->areEquivalent(Node.getTrueExpr(), Node.getFalseExpr());
 }
 
-AST_MATCHER(CallExpr, parametersAreEquivalent) {
+AST_MATCHER_P(CallExpr, parametersAreEquivalent, ExprEquivalence *,
+              Equivalence) {
   return Node.getNumArgs() == 2 &&
-         areEquivalentExpr(Node.getArg(0), Node.getArg(1));
+         Equivalence->areEquivalent(Node.getArg(0), Node.getArg(1));
 }
 
 AST_MATCHER(BinaryOperator, binaryOperatorIsInMacro) {
@@ -628,6 +632,92 @@ static bool areExprsMacroAndNonMacro(const Expr *&LhsExpr,
 }
 } // namespace
 
+bool ExprEquivalence::areEquivalent(const Expr *Left, const Expr *Right) {
+  if (!Left || !Right)
+    return !Left && !Right;
+  llvm::Optional<size_t> LeftHash = getHash(Left);
+  if (!LeftHash)
+    return false;
+  llvm::Optional<size_t> RightHash = getHash(Right);
+  if (!RightHash || *LeftHash != *RightHash)
+    return false;
+  // Same hashes, but they may collide.
+  return areEquivalentExpr(Left, Right);
+}
+
+// Equivalent expressions, as compared by areEquivalentExpr, get the same hash.
+llvm::Optional<size_t> ExprEquivalence::getHash(const Expr *E) {
+  // Children which aren't expressions are all equivalent.
+  if (!E)
+    return size_t(0);
+  E = E->IgnoreParens();
+  auto It = Hashes.find(E);
+  if (It != Hashes.end())
+    return It->second;
+
+  llvm::Optional<size_t> Result = [&]() -> llvm::Optional<size_t> {
+    llvm::hash_code Hash = llvm::hash_value(E->getStmtClass());
+    switch (E->getStmtClass()) {
+    default:
+      return None;
+    case Stmt::CharacterLiteralClass:
+      Hash = llvm::hash_combine(Hash, cast<CharacterLiteral>(E)->getValue());
+      break;
+    case Stmt::IntegerLiteralClass:
+      Hash = llvm::hash_combine(Hash, cast<IntegerLiteral>(E)->getValue());
+      break;
+    case Stmt::StringLiteralClass:
+      Hash = llvm::hash_combine(Hash, cast<StringLiteral>(E)->getBytes());
+      break;
+    case Stmt::CXXOperatorCallExprClass:
+      Hash = llvm::hash_combine(Hash,
+                                cast<CXXOperatorCallExpr>(E)->getOperator());
+      break;
+    case Stmt::DependentScopeDeclRefExprClass:
+      Hash = llvm::hash_combine(Hash, cast<DependentScopeDeclRefExpr>(E)
+                                          ->getDeclName()
+                                          .getAsOpaquePtr());
+      break;
+    case Stmt::DeclRefExprClass:
+      Hash = llvm::hash_combine(Hash, cast<DeclRefExpr>(E)->getDecl());
+      break;
+    case Stmt::MemberExprClass:
+      Hash = llvm::hash_combine(Hash, cast<MemberExpr>(E)->getMemberDecl());
+      break;
+    case Stmt::CXXFunctionalCastExprClass:
+    case Stmt::CStyleCastExprClass:
+      Hash = llvm::hash_combine(
+          Hash,
+          cast<ExplicitCastExpr>(E)->getTypeAsWritten().getAsOpaquePtr());
+      break;
+    case Stmt::FloatingLiteralClass:
+    case Stmt::CallExprClass:
+    case Stmt::ImplicitCastExprClass:
+    case Stmt::ArraySubscriptExprClass:
+      break;
+    case Stmt::UnaryOperatorClass:
+      if (cast<UnaryOperator>(E)->isIncrementDecrementOp())
+        return None;
+      Hash = llvm::hash_combine(Hash, cast<UnaryOperator>(E)->getOpcode());
+      break;
+    case Stmt::BinaryOperatorClass:
+      Hash = llvm::hash_combine(Hash, cast<BinaryOperator>(E)->getOpcode());
+      break;
+    }
+
+    for (const Stmt *Child : E->children()) {
+      llvm::Optional<size_t> ChildHash =
+          getHash(dyn_cast_or_null<Expr>(Child));
+      if (!ChildHash)
+        return None;
+      Hash = llvm::hash_combine(Hash, *ChildHash);
+    }
+    return size_t(Hash);
+  }();
+  Hashes[E] = Result;
+  return Result;
+}
+
 void RedundantExpressionCheck::registerMatchers(MatchFinder *Finder) {
   const auto AnyLiteralExpr = ignoringParenImpCasts(
       anyOf(cxxBoolLiteral(), characterLiteral(), integerLiteral()));
@@ -643,7 +733,7 @@ void RedundantExpressionCheck::registerMatchers(MatchFinder *Finder) {
                            matchers::isComparisonOperator(),
                            hasOperatorName("&&"), hasOperatorName("||"),
                            hasOperatorName("=")),
-                     operandsAreEquivalent(),
+                     operandsAreEquivalent(&Equivalence),
                      // Filter noisy false positives.
                      unless(isInTemplateInstantiation()),
                      unless(binaryOperatorIsInMacro()),
@@ -655,7 +745,7 @@ void RedundantExpressionCheck::registerMatchers(MatchFinder *Finder) {
       this);
 
   // Conditional (trenary) operator with equivalent operands, like (Y ? X : X).
-  Finder->addMatcher(conditionalOperator(expressionsAreEquivalent(),
+  Finder->addMatcher(conditionalOperator(expressionsAreEquivalent(&Equivalence),
                                          // Filter noisy false positives.
                                          unless(conditionalOperatorIsInMacro()),
                                          unless(isInTemplateInstantiation()))
@@ -674,7 +764,7 @@ void RedundantExpressionCheck::registerMatchers(MatchFinder *Finder) {
               hasOverloadedOperatorName(">"), hasOverloadedOperatorName(">="),
               hasOverloadedOperatorName("&&"), hasOverloadedOperatorName("||"),
               hasOverloadedOperatorName("=")),
-          parametersAreEquivalent(),
+          parametersAreEquivalent(&Equivalence),
           // Filter noisy false positives.
           unless(isMacro()), unless(isInTemplateInstantiation()))
           .bind("call"),
@@ -737,7 +827,7 @@ void RedundantExpressionCheck::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(binaryOperator(isComparisonOperator(),
                                     hasLHS(BinOpCstLeft), hasRHS(BinOpCstRight),
                                     // Already reported as redundant.
-                                    unless(operandsAreEquivalent()))
+                                    unless(operandsAreEquivalent(&Equivalence)))
                          .bind("binop-const-compare-to-binop-const"),
                      this);
 
@@ -752,7 +842,7 @@ void RedundantExpressionCheck::registerMatchers(MatchFinder *Finder) {
       binaryOperator(anyOf(hasOperatorName("||"), hasOperatorName("&&")),
                      hasLHS(ComparisonLeft), hasRHS(ComparisonRight),
                      // Already reported as redundant.
-                     unless(operandsAreEquivalent()))
+                     unless(operandsAreEquivalent(&Equivalence)))
           .bind("comparisons-of-symbol-and-const"),
       this);
 }
@@ -769,7 +859,7 @@ void RedundantExpressionCheck::checkArithmeticExpr(
     if (!retrieveBinOpIntegerConstantExpr(Result, "lhs", LhsOpcode, LhsSymbol,
                                           LhsValue) ||
         !retrieveSymbolicExpr(Result, "rhs", RhsSymbol) ||
-        !areEquivalentExpr(LhsSymbol, RhsSymbol))
+        !Equivalence.areEquivalent(LhsSymbol, RhsSymbol))
       return;
 
     // Check expressions: x + k == x  or  x - k == x.
@@ -792,7 +882,7 @@ void RedundantExpressionCheck::checkArithmeticExpr(
                                           LhsValue) ||
         !retrieveBinOpIntegerConstantExpr(Result, "rhs", RhsOpcode, RhsSymbol,
                                           RhsValue) ||
-        !areEquivalentExpr(LhsSymbol, RhsSymbol))
+        !Equivalence.areEquivalent(LhsSymbol, RhsSymbol))
       return;
 
     transformSubToCanonicalAddExpr(LhsOpcode, LhsValue);
@@ -921,7 +1011,7 @@ void RedundantExpressionCheck::checkRelationalExpr(
             Result, "lhs", LhsExpr, LhsOpcode, LhsSymbol, LhsValue, LhsConst) ||
         !retrieveRelationalIntegerConstantExpr(
             Result, "rhs", RhsExpr, RhsOpcode, RhsSymbol, RhsValue, RhsConst) ||
-        !areEquivalentExpr(LhsSymbol, RhsSymbol))
+        !Equivalence.areEquivalent(LhsSymbol, RhsSymbol))
       return;
 
     // Bring expr to a canonical form: smallest constant must be on the left.
@@ -10,11 +10,32 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_MISC_REDUNDANT_EXPRESSION_H
 
 #include "../ClangTidyCheck.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 
 namespace clang {
 namespace tidy {
 namespace misc {
 
+/// Compares expressions structurally, like (X != 2) and (X != 2).
+///
+/// A hash consistent with the comparison is computed once for each
+/// subexpression of the translation unit, so that most pairs of expressions
+/// are told apart without walking them, e.g. the operands of the operators of
+/// long chains like (A == X || A == Y || ...).
+class ExprEquivalence {
+public:
+  bool areEquivalent(const Expr *Left, const Expr *Right);
+  void clear() { Hashes.clear(); }
+
+private:
+  /// Returns the hash of \p E, or None if \p E contains an expression that
+  /// isn't equivalent to any other.
+  llvm::Optional<size_t> getHash(const Expr *E);
+
+  llvm::DenseMap<const Expr *, llvm::Optional<size_t>> Hashes;
+};
+
 /// The checker detects expressions that are redundant, because they contain
 /// ineffective, useless parts.
 ///
@@ -26,11 +47,14 @@ public:
       : ClangTidyCheck(Name, Context) {}
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override { Equivalence.clear(); }
 
 private:
   void checkArithmeticExpr(const ast_matchers::MatchFinder::MatchResult &R);
   void checkBitwiseExpr(const ast_matchers::MatchFinder::MatchResult &R);
   void checkRelationalExpr(const ast_matchers::MatchFinder::MatchResult &R);
+
+  ExprEquivalence Equivalence;
 };
 
 } // namespace misc
@@ -23,10 +23,6 @@ ThrowByValueCatchByReferenceCheck::ThrowByValueCatchByReferenceCheck(
       CheckAnonymousTemporaries(Options.get("CheckThrowTemporaries", true)) {}
 
 void ThrowByValueCatchByReferenceCheck::registerMatchers(MatchFinder *Finder) {
-  // This is a C++ only check thus we register the matchers only for C++
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   Finder->addMatcher(cxxThrowExpr().bind("throw"), this);
   Finder->addMatcher(cxxCatchStmt().bind("catch"), this);
 }
@@ -29,6 +29,10 @@ namespace misc {
 class ThrowByValueCatchByReferenceCheck : public ClangTidyCheck {
 public:
   ThrowByValueCatchByReferenceCheck(StringRef Name, ClangTidyContext *Context);
+  // This is a C++ only check.
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus;
+  }
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
@@ -16,12 +16,12 @@ namespace clang {
 namespace tidy {
 namespace misc {
 
-void UniqueptrResetReleaseCheck::registerMatchers(MatchFinder *Finder) {
-  // Only register the matchers for C++11; the functionality currently does not
-  // provide any benefit to other languages, despite being benign.
-  if (!getLangOpts().CPlusPlus11)
-    return;
+ArrayRef<StringRef> UniqueptrResetReleaseCheck::getRequiredIdentifiers() const {
+  static const StringRef Identifiers[] = {"unique_ptr"};
+  return Identifiers;
+}
 
+void UniqueptrResetReleaseCheck::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(
       cxxMemberCallExpr(
           on(expr().bind("left")), callee(memberExpr().bind("reset_member")),
@@ -30,8 +30,12 @@ class UniqueptrResetReleaseCheck : public ClangTidyCheck {
 public:
   UniqueptrResetReleaseCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus11;
+  }
 
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  ArrayRef<StringRef> getRequiredIdentifiers() const override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 };
 
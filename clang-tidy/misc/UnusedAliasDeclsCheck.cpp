@@ -18,11 +18,6 @@ namespace tidy {
 namespace misc {
 
 void UnusedAliasDeclsCheck::registerMatchers(MatchFinder *Finder) {
-  // Only register the matchers for C++11; the functionality currently does not
-  // provide any benefit to other languages, despite being benign.
-  if (!getLangOpts().CPlusPlus11)
-    return;
-
   // We cannot do anything about headers (yet), as the alias declarations
   // used in one header could be used by some other translation unit.
   Finder->addMatcher(namespaceAliasDecl(isExpansionInMainFile()).bind("alias"),
@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "LoopConvertUtils.h"
+#include "clang/AST/DeclObjC.h"
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Basic/LLVM.h"
 #include "clang/Basic/Lambda.h"
@@ -30,6 +31,31 @@ namespace clang {
 namespace tidy {
 namespace modernize {
 
+void StmtAncestorASTVisitor::gatherAncestors(ASTContext &Ctx,
+                                             const DeclContext *DC) {
+  if (GatheredAST)
+    return;
+  // Statements of local classes, lambdas and blocks have the statements of the
+  // enclosing function as ancestors.
+  const DeclContext *Outermost = nullptr;
+  for (; DC; DC = DC->getParent()) {
+    if (DC->isFunctionOrMethod())
+      Outermost = DC;
+    else if (!isa<RecordDecl>(DC))
+      break;
+  }
+  if (!Outermost ||
+      !(isa<FunctionDecl>(Outermost) || isa<ObjCMethodDecl>(Outermost))) {
+    // E.g. a block in the initializer of a global variable.
+    TraverseAST(Ctx);
+    GatheredAST = true;
+    return;
+  }
+  const auto *Function = cast<Decl>(Outermost);
+  if (GatheredFunctions.insert(Function).second)
+    TraverseDecl(const_cast<Decl *>(Function));
+}
+
 /// \brief Tracks a stack of parent statements during traversal.
 ///
 /// All this really does is inject push_back() before running
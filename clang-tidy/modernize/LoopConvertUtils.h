@@ -14,6 +14,7 @@
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Basic/SourceLocation.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -55,13 +56,13 @@ class StmtAncestorASTVisitor
 public:
   StmtAncestorASTVisitor() { StmtStack.push_back(nullptr); }
 
-  /// \brief Run the analysis on the AST.
+  /// \brief Run the analysis on the outermost function containing the
+  /// statements of \p DC, or on the whole AST if they may be outside of any
+  /// function.
   ///
-  /// In case we're running this analysis multiple times, don't repeat the work.
-  void gatherAncestors(ASTContext &Ctx) {
-    if (StmtAncestors.empty())
-      TraverseAST(Ctx);
-  }
+  /// The results of successive runs accumulate, and a function is only
+  /// analyzed once, so that the loops of a function share the work.
+  void gatherAncestors(ASTContext &Ctx, const DeclContext *DC);
 
   /// Accessor for StmtAncestors.
   const StmtParentMap &getStmtToParentStmtMap() { return StmtAncestors; }
@@ -75,6 +76,8 @@ private:
   StmtParentMap StmtAncestors;
   DeclParentMap DeclParents;
   llvm::SmallVector<const clang::Stmt *, 16> StmtStack;
+  llvm::SmallPtrSet<const clang::Decl *, 8> GatheredFunctions;
+  bool GatheredAST = false;
 
   bool TraverseStmt(clang::Stmt *Statement);
   bool VisitDeclStmt(clang::DeclStmt *Statement);
@@ -69,8 +69,8 @@ void MakeSmartPtrCheck::registerPPCallbacks(const SourceManager &SM,
                                             Preprocessor *PP,
                                             Preprocessor *ModuleExpanderPP) {
   if (isLanguageVersionSupported(getLangOpts())) {
-    Inserter = llvm::make_unique<utils::IncludeInserter>(SM, getLangOpts(),
-                                                         IncludeStyle);
+    Inserter = llvm::make_unique<utils::IncludeInserter>(
+        SM, getLangOpts(), IncludeStyle, &getIncludeDirectives());
     PP->addPPCallbacks(Inserter->CreatePPCallbacks());
   }
 }
@@ -130,11 +130,6 @@ void PassByValueCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
 }
 
 void PassByValueCheck::registerMatchers(MatchFinder *Finder) {
-  // Only register the matchers for C++; the functionality currently does not
-  // provide any benefit to other languages, despite being benign.
-  if (!getLangOpts().CPlusPlus)
-    return;
-
   Finder->addMatcher(
       cxxConstructorDecl(
           forEachConstructorInitializer(
@@ -171,8 +166,8 @@ void PassByValueCheck::registerPPCallbacks(const SourceManager &SM,
   // currently does not provide any benefit to other languages, despite being
   // benign.
   if (getLangOpts().CPlusPlus) {
-    Inserter = llvm::make_unique<utils::IncludeInserter>(SM, getLangOpts(),
-                                                         IncludeStyle);
+    Inserter = llvm::make_unique<utils::IncludeInserter>(
+        SM, getLangOpts(), IncludeStyle, &getIncludeDirectives());
     PP->addPPCallbacks(Inserter->CreatePPCallbacks());
   }
 }
@@ -32,6 +32,9 @@ class RedundantVoidArgCheck : public ClangTidyCheck {
 public:
   RedundantVoidArgCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus;
+  }
 
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
 
@@ -17,9 +17,6 @@ namespace tidy {
 namespace modernize {
 
 void UnaryStaticAssertCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus17)
-    return;
-
   Finder->addMatcher(staticAssertDecl().bind("static_assert"), this);
 }
 
@@ -30,10 +30,6 @@ void UseOverrideCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
 }
 
 void UseOverrideCheck::registerMatchers(MatchFinder *Finder) {
-  // Only register the matcher for C++11.
-  if (!getLangOpts().CPlusPlus11)
-    return;
-
   if (IgnoreDestructors)
     Finder->addMatcher(
         cxxMethodDecl(isOverride(), unless(cxxDestructorDecl())).bind("method"),
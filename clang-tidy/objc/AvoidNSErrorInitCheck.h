@@ -24,6 +24,10 @@ class AvoidNSErrorInitCheck : public ClangTidyCheck {
  public:
   AvoidNSErrorInitCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
+  // this check should only be applied to ObjC sources.
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.ObjC;
+  }
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 };
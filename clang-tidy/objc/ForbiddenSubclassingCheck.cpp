@@ -76,10 +76,6 @@ ForbiddenSubclassingCheck::ForbiddenSubclassingCheck(
 }
 
 void ForbiddenSubclassingCheck::registerMatchers(MatchFinder *Finder) {
-  // this check should only be applied to ObjC sources.
-  if (!getLangOpts().ObjC)
-    return;
-
   Finder->addMatcher(
       objcInterfaceDecl(
           isSubclassOf(
@@ -0,0 +1,173 @@
+//===--- ExceptionOverheadCheck.cpp - clang-tidy --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ExceptionOverheadCheck.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/TypeLoc.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+namespace {
+
+enum FunctionKind { FK_None = -1, FK_Swap, FK_Hash, FK_Comparison };
+
+// Whether a handler does nothing but resume the loop.
+bool ignoresException(const CXXCatchStmt &Handler) {
+  const auto *Block = dyn_cast<CompoundStmt>(Handler.getHandlerBlock());
+  if (!Block || Block->size() > 1)
+    return false;
+  return Block->body_empty() ||
+         isa<ContinueStmt>(Block->body_front()) ||
+         isa<BreakStmt>(Block->body_front()) ||
+         isa<NullStmt>(Block->body_front());
+}
+
+bool isReferenceTo(QualType Param, QualType Type) {
+  return Param->isLValueReferenceType() &&
+         Param->getPointeeType().getCanonicalType().getUnqualifiedType() ==
+             Type.getCanonicalType().getUnqualifiedType();
+}
+
+// The functions the standard library behaves better with when they are
+// noexcept: std::swap is noexcept if the swapped type's swap is, and
+// unordered containers don't store the hashes when the hash function is.
+FunctionKind classify(const FunctionDecl &Function, const ASTContext &Context) {
+  const auto *Method = dyn_cast<CXXMethodDecl>(&Function);
+  unsigned NumParams = Function.getNumParams();
+  if (Function.getName() == "swap") {
+    if (Method && !Method->isStatic() && NumParams == 1 &&
+        isReferenceTo(Function.getParamDecl(0)->getType(),
+                      Context.getRecordType(Method->getParent())))
+      return FK_Swap;
+    if ((!Method || Method->isStatic()) && NumParams == 2) {
+      QualType Second = Function.getParamDecl(1)->getType();
+      if (Second->isLValueReferenceType() &&
+          isReferenceTo(Function.getParamDecl(0)->getType(),
+                        Second->getPointeeType()))
+        return FK_Swap;
+    }
+    return FK_None;
+  }
+  if (!Method || Function.getOverloadedOperator() != OO_Call)
+    return FK_None;
+  QualType Result = Function.getReturnType().getCanonicalType();
+  if (NumParams == 1 &&
+      Context.hasSameType(Result, Context.getSizeType().getCanonicalType()))
+    return FK_Hash;
+  if (NumParams == 2 && Result->isBooleanType() &&
+      Context.hasSameUnqualifiedType(
+          Function.getParamDecl(0)->getType().getNonReferenceType(),
+          Function.getParamDecl(1)->getType().getNonReferenceType()))
+    return FK_Comparison;
+  return FK_None;
+}
+
+} // namespace
+
+ExceptionOverheadCheck::ExceptionOverheadCheck(StringRef Name,
+                                               ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context) {
+  Tracer.ignoreBadAlloc(true);
+}
+
+void ExceptionOverheadCheck::registerMatchers(MatchFinder *Finder) {
+  Finder->addMatcher(
+      cxxTryStmt(hasAncestor(stmt(anyOf(forStmt(), cxxForRangeStmt(),
+                                        whileStmt(), doStmt()))),
+                 unless(isInTemplateInstantiation()))
+          .bind("try"),
+      this);
+  Finder->addMatcher(
+      functionDecl(isDefinition(), unless(isImplicit()), unless(isDeleted()),
+                   unless(isInstantiated()), unless(isNoThrow()),
+                   anyOf(hasName("swap"), hasOverloadedOperatorName("()")))
+          .bind("function"),
+      this);
+}
+
+void ExceptionOverheadCheck::check(const MatchFinder::MatchResult &Result) {
+  if (const auto *Try = Result.Nodes.getNodeAs<CXXTryStmt>("try"))
+    checkTry(*Try);
+  else if (const auto *Function =
+               Result.Nodes.getNodeAs<FunctionDecl>("function"))
+    checkNoexcept(*Function, *Result.Context);
+}
+
+void ExceptionOverheadCheck::checkTry(const CXXTryStmt &Try) {
+  bool MayThrow = false;
+  bool Analyzed = false;
+  for (unsigned I = 0; I < Try.getNumHandlers(); ++I) {
+    const CXXCatchStmt &Handler = *Try.getHandler(I);
+    if (!ignoresException(Handler))
+      continue;
+    // A try block that can't throw costs nothing.
+    if (!Analyzed) {
+      MayThrow = Tracer.analyze(Try.getTryBlock()).getBehaviour() !=
+                 utils::ExceptionAnalyzer::State::NotThrowing;
+      Analyzed = true;
+    }
+    if (!MayThrow)
+      return;
+    diag(Handler.getCatchLoc(),
+         "exception ignored in a loop is used for control flow; throwing is "
+         "much slower than returning, consider reporting the failure with the "
+         "return value");
+  }
+}
+
+void ExceptionOverheadCheck::checkNoexcept(const FunctionDecl &Function,
+                                           ASTContext &Context) {
+  if (Function.isDependentContext())
+    return;
+  FunctionKind Kind = classify(Function, Context);
+  if (Kind == FK_None)
+    return;
+  const auto *Proto = Function.getType()->getAs<FunctionProtoType>();
+  if (!Proto || isUnresolvedExceptionSpec(Proto->getExceptionSpecType()) ||
+      Proto->getExceptionSpecType() != EST_None)
+    return;
+  // Unknown callees may throw.
+  if (Tracer.analyze(&Function).getBehaviour() !=
+      utils::ExceptionAnalyzer::State::NotThrowing)
+    return;
+
+  auto Diag = diag(Function.getLocation(),
+                   "%select{swap function|hash function|comparison function}0 "
+                   "%1 can't throw but isn't marked noexcept")
+              << Kind << &Function;
+
+  // noexcept goes after the qualifiers, and must be on all the declarations.
+  const SourceManager &SM = Context.getSourceManager();
+  std::vector<FixItHint> Fixes;
+  for (const FunctionDecl *Decl = &Function; Decl;
+       Decl = Decl->getPreviousDecl()) {
+    const TypeSourceInfo *TSI = Decl->getTypeSourceInfo();
+    if (!TSI)
+      return;
+    auto FTL = TSI->getTypeLoc().IgnoreParens().getAs<FunctionTypeLoc>();
+    if (!FTL || Proto->hasTrailingReturn())
+      return;
+    SourceLocation End = FTL.getLocalRangeEnd();
+    if (End.isMacroID())
+      return;
+    Fixes.push_back(FixItHint::CreateInsertion(
+        Lexer::getLocForEndOfToken(End, 0, SM, Context.getLangOpts()),
+        " noexcept"));
+  }
+  Diag << Fixes;
+}
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
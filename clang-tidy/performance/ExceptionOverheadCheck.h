@@ -0,0 +1,47 @@
+//===--- ExceptionOverheadCheck.h - clang-tidy ------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_EXCEPTION_OVERHEAD_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_EXCEPTION_OVERHEAD_H
+
+#include "../ClangTidyCheck.h"
+#include "../utils/ExceptionAnalyzer.h"
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+/// \brief Finds exceptions thrown and ignored in loops, i.e. used for control
+/// flow, and swap, hash and comparison functions that can't throw but aren't
+/// marked noexcept.
+///
+/// For the user-facing documentation see:
+/// http://clang.llvm.org/extra/clang-tidy/checks/performance-exception-overhead.html
+class ExceptionOverheadCheck : public ClangTidyCheck {
+public:
+  ExceptionOverheadCheck(StringRef Name, ClangTidyContext *Context);
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus11 && LangOpts.CXXExceptions;
+  }
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+
+private:
+  void checkTry(const CXXTryStmt &Try);
+  void checkNoexcept(const FunctionDecl &Function, ASTContext &Context);
+
+  /// Shared by all the functions of the translation unit, so that each callee
+  /// is analyzed once.
+  utils::ExceptionAnalyzer Tracer;
+};
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_EXCEPTION_OVERHEAD_H
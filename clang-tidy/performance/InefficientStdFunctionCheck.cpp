@@ -0,0 +1,149 @@
+//===--- InefficientStdFunctionCheck.cpp - clang-tidy ---------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "InefficientStdFunctionCheck.h"
+#include "../utils/DeclRefExprUtils.h"
+#include "../utils/OptionsUtils.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+namespace {
+
+const char DefaultFunctionTypes[] = "::std::function";
+
+} // namespace
+
+InefficientStdFunctionCheck::InefficientStdFunctionCheck(
+    StringRef Name, ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context),
+      FunctionTypes(utils::options::parseStringList(
+          Options.get("FunctionTypes", DefaultFunctionTypes))),
+      MaxCaptureSize(Options.get("MaxCaptureSize", 16U)) {}
+
+void InefficientStdFunctionCheck::registerMatchers(MatchFinder *Finder) {
+  const auto FunctionType = qualType(hasCanonicalType(
+      hasDeclaration(classTemplateSpecializationDecl(hasAnyName(
+          SmallVector<StringRef, 2>(FunctionTypes.begin(),
+                                    FunctionTypes.end()))))));
+
+  const auto FunctionParam =
+      parmVarDecl(hasType(qualType(
+                      anyOf(FunctionType, references(FunctionType)))))
+          .bind("param");
+  // Templates would break virtual methods, and overriders can't change their
+  // signature anyway.
+  Finder->addMatcher(
+      functionDecl(isDefinition(), hasBody(stmt()), unless(isImplicit()),
+                   unless(isInstantiated()), unless(cxxMethodDecl(isVirtual())),
+                   has(typeLoc(forEach(FunctionParam))))
+          .bind("function"),
+      this);
+
+  // Before C++17, the closure is moved into the parameter of the converting
+  // constructor or assignment operator.
+  const auto Lambda = lambdaExpr().bind("lambda");
+  const auto LambdaArg = ignoringImplicit(anyOf(
+      Lambda, cxxConstructExpr(hasType(cxxRecordDecl(isLambda())),
+                               hasArgument(0, ignoringImplicit(Lambda)))));
+  Finder->addMatcher(
+      cxxConstructExpr(hasType(FunctionType), hasArgument(0, LambdaArg),
+                       unless(isInTemplateInstantiation()))
+          .bind("conversion"),
+      this);
+  Finder->addMatcher(
+      cxxOperatorCallExpr(hasOverloadedOperatorName("="),
+                          hasArgument(0, expr(hasType(FunctionType))),
+                          hasArgument(1, LambdaArg),
+                          unless(isInTemplateInstantiation()))
+          .bind("conversion"),
+      this);
+}
+
+void InefficientStdFunctionCheck::check(
+    const MatchFinder::MatchResult &Result) {
+  if (const auto *Param = Result.Nodes.getNodeAs<ParmVarDecl>("param")) {
+    checkParam(*Param, *Result.Nodes.getNodeAs<FunctionDecl>("function"),
+               *Result.Context);
+    return;
+  }
+  const auto *Lambda = Result.Nodes.getNodeAs<LambdaExpr>("lambda");
+  const auto *Conversion = Result.Nodes.getNodeAs<Expr>("conversion");
+  QualType FunctionType = Conversion->getType();
+  if (const auto *Call = dyn_cast<CXXOperatorCallExpr>(Conversion))
+    FunctionType = Call->getArg(0)->getType();
+  checkLambda(*Lambda, FunctionType, *Result.Context);
+}
+
+void InefficientStdFunctionCheck::checkParam(const ParmVarDecl &Param,
+                                             const FunctionDecl &Function,
+                                             ASTContext &Context) {
+  // The parameter must only be called, or tested for emptiness: storing,
+  // copying or forwarding it needs the type erasure.
+  const auto ParamRef = declRefExpr(to(equalsNode(&Param))).bind("ref");
+  const auto Call =
+      cxxOperatorCallExpr(hasOverloadedOperatorName("()"),
+                          hasArgument(0, ignoringParenImpCasts(ParamRef)));
+  const auto Test =
+      cxxMemberCallExpr(on(ParamRef), callee(cxxConversionDecl()));
+  const Stmt &Body = *Function.getBody();
+  // Lambdas capturing the parameter may outlive the call.
+  for (const auto &Match :
+       match(findAll(lambdaExpr().bind("lambda")), Body, Context)) {
+    for (const LambdaCapture &Capture :
+         Match.getNodeAs<LambdaExpr>("lambda")->captures())
+      if (Capture.capturesVariable() && Capture.getCapturedVar() == &Param)
+        return;
+  }
+  auto Calls = match(findAll(Call), Body, Context);
+  if (Calls.empty())
+    return;
+  auto Tests = match(findAll(Test), Body, Context);
+  if (Calls.size() + Tests.size() !=
+      utils::decl_ref_expr::allDeclRefExprs(Param, Body, Context).size())
+    return;
+
+  diag(Param.getLocation(),
+       "parameter %0 of type %1 is only invoked; consider a template "
+       "parameter or a non-owning callable reference to avoid the type "
+       "erasure")
+      << &Param << Param.getType().getNonReferenceType().getUnqualifiedType();
+}
+
+void InefficientStdFunctionCheck::checkLambda(const LambdaExpr &Lambda,
+                                              QualType FunctionType,
+                                              ASTContext &Context) {
+  QualType ClosureType = Lambda.getType();
+  if (ClosureType->isDependentType() || ClosureType->isIncompleteType())
+    return;
+  CharUnits::QuantityType Size =
+      Context.getTypeSizeInChars(ClosureType).getQuantity();
+  if (static_cast<uint64_t>(Size) <= MaxCaptureSize)
+    return;
+  diag(Lambda.getBeginLoc(),
+       "lambda captures %0 bytes, more than %1 can store inline; converting "
+       "it allocates memory on the heap")
+      << static_cast<unsigned>(Size)
+      << FunctionType.getNonReferenceType().getUnqualifiedType();
+}
+
+void InefficientStdFunctionCheck::storeOptions(
+    ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "FunctionTypes",
+                utils::options::serializeStringList(FunctionTypes));
+  Options.store(Opts, "MaxCaptureSize", MaxCaptureSize);
+}
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
@@ -9,6 +9,8 @@
 #include "InefficientStringConcatenationCheck.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/Preprocessor.h"
 
 using namespace clang::ast_matchers;
 
@@ -16,24 +18,79 @@ namespace clang {
 namespace tidy {
 namespace performance {
 
+static const char DiagMsg[] =
+    "string concatenation results in allocation of unnecessary temporary "
+    "strings; consider using 'operator+=' or 'string::append()' instead";
+
+// Collects the operands of a chain of string operator+ calls, and the calls.
+static void flattenConcatenation(const Expr *E,
+                                 SmallVectorImpl<const Expr *> &Operands,
+                                 SmallVectorImpl<const Expr *> &Calls) {
+  const Expr *Inner = E->IgnoreImplicit();
+  const auto *Call = dyn_cast<CXXOperatorCallExpr>(Inner);
+  if (Call && Call->getOperator() == OO_Plus && Call->getNumArgs() == 2 &&
+      Call->getType()->getAsCXXRecordDecl() ==
+          E->getType()->getAsCXXRecordDecl()) {
+    Calls.push_back(Call);
+    flattenConcatenation(Call->getArg(0), Operands, Calls);
+    flattenConcatenation(Call->getArg(1), Operands, Calls);
+    return;
+  }
+  Operands.push_back(Inner);
+}
+
+// The character type of a std::basic_string type, or a null type.
+static QualType getCharType(QualType StringType) {
+  const auto *Specialization =
+      dyn_cast_or_null<ClassTemplateSpecializationDecl>(
+          StringType->getAsCXXRecordDecl());
+  if (!Specialization || Specialization->getTemplateArgs().size() == 0 ||
+      Specialization->getTemplateArgs()[0].getKind() != TemplateArgument::Type)
+    return QualType();
+  return Specialization->getTemplateArgs()[0].getAsType();
+}
+
+// Whether \p E can be spelled in place of a larger expression without
+// parentheses.
+static bool isSimpleExpr(const Expr *E) {
+  E = E->IgnoreImpCasts();
+  return isa<DeclRefExpr>(E) || isa<MemberExpr>(E) || isa<StringLiteral>(E) ||
+         isa<CallExpr>(E) || isa<ParenExpr>(E);
+}
+
 void InefficientStringConcatenationCheck::storeOptions(
     ClangTidyOptions::OptionMap &Opts) {
   Options.store(Opts, "StrictMode", StrictMode);
+  Options.store(Opts, "ConcatFunction", ConcatFunction);
+  Options.store(Opts, "ConcatFunctionHeader", ConcatFunctionHeader);
+  Options.store(Opts, "IncludeStyle",
+                utils::IncludeSorter::toString(IncludeStyle));
 }
 
 InefficientStringConcatenationCheck::InefficientStringConcatenationCheck(
     StringRef Name, ClangTidyContext *Context)
     : ClangTidyCheck(Name, Context),
-      StrictMode(Options.getLocalOrGlobal("StrictMode", 0)) {}
+      StrictMode(Options.getLocalOrGlobal("StrictMode", 0)),
+      ConcatFunction(Options.get("ConcatFunction", "")),
+      ConcatFunctionHeader(Options.get("ConcatFunctionHeader", "")),
+      IncludeStyle(utils::IncludeSorter::parseIncludeStyle(
+          Options.getLocalOrGlobal("IncludeStyle", "llvm"))) {}
+
+void InefficientStringConcatenationCheck::registerPPCallbacks(
+    const SourceManager &SM, Preprocessor *PP, Preprocessor *ModuleExpanderPP) {
+  Inserter = llvm::make_unique<utils::IncludeInserter>(
+      SM, getLangOpts(), IncludeStyle, &getIncludeDirectives());
+  PP->addPPCallbacks(Inserter->CreatePPCallbacks());
+}
 
 void InefficientStringConcatenationCheck::registerMatchers(
     MatchFinder *Finder) {
   if (!getLangOpts().CPlusPlus)
     return;
 
-  const auto BasicStringType =
-      hasType(qualType(hasUnqualifiedDesugaredType(recordType(
-          hasDeclaration(cxxRecordDecl(hasName("::std::basic_string")))))));
+  const auto BasicString = qualType(hasUnqualifiedDesugaredType(recordType(
+      hasDeclaration(cxxRecordDecl(hasName("::std::basic_string"))))));
+  const auto BasicStringType = hasType(BasicString);
 
   const auto BasicStringPlusOperator = cxxOperatorCallExpr(
       hasOverloadedOperatorName("+"),
@@ -55,33 +112,178 @@ void InefficientStringConcatenationCheck::registerMatchers(
                          hasDeclaration(decl(equalsBoundNode("lhsStrT"))))))),
       hasDescendant(BasicStringPlusOperator));
 
+  // A chain of at least two concatenations bound to a const string reference
+  // parameter: only its result is needed.
+  const auto StringPlus =
+      cxxOperatorCallExpr(hasOverloadedOperatorName("+"), BasicStringType);
+  const auto ConstStringRefArgument = forEachArgumentWithParam(
+      ignoringImplicit(
+          cxxOperatorCallExpr(StringPlus,
+                              hasAnyArgument(ignoringImplicit(StringPlus)))
+              .bind("argumentChain")),
+      parmVarDecl(hasType(
+          lValueReferenceType(pointee(qualType(isConstQualified(),
+                                               BasicString))))));
+  // The operands of a chain are themselves bound to the parameters of
+  // operator+, and assignments are handled below.
+  const auto ArgumentChain = expr(anyOf(
+      callExpr(unless(cxxOperatorCallExpr(
+                   anyOf(hasOverloadedOperatorName("+"),
+                         hasOverloadedOperatorName("=")))),
+               ConstStringRefArgument),
+      cxxConstructExpr(ConstStringRefArgument)));
+
   if (StrictMode) {
     Finder->addMatcher(cxxOperatorCallExpr(anyOf(AssignOperator, PlusOperator)),
                        this);
+    Finder->addMatcher(ArgumentChain, this);
   } else {
+    const auto InLoop = hasAncestor(
+        stmt(anyOf(cxxForRangeStmt(), whileStmt(), forStmt())));
     Finder->addMatcher(
-        cxxOperatorCallExpr(anyOf(AssignOperator, PlusOperator),
-                            hasAncestor(stmt(anyOf(cxxForRangeStmt(),
-                                                   whileStmt(), forStmt())))),
+        cxxOperatorCallExpr(anyOf(AssignOperator, PlusOperator), InLoop),
         this);
+    Finder->addMatcher(expr(ArgumentChain, InLoop), this);
   }
+
+  // std::string(X).c_str() copies X only to get back the characters it
+  // already refers to.
+  const auto Copy = cxxConstructExpr(
+      hasArgument(0, expr().bind("source")),
+      unless(hasArgument(1, unless(cxxDefaultArgExpr()))));
+  const auto Temporary =
+      cxxFunctionalCastExpr(BasicStringType,
+                            hasSourceExpression(ignoringImplicit(Copy)))
+          .bind("temporary");
+  Finder->addMatcher(
+      cxxMemberCallExpr(callee(cxxMethodDecl(hasAnyName("c_str", "data"))),
+                        on(ignoringImplicit(Temporary)),
+                        unless(isInTemplateInstantiation()))
+          .bind("roundTrip"),
+      this);
 }
 
 void InefficientStringConcatenationCheck::check(
     const MatchFinder::MatchResult &Result) {
+  if (const auto *Chain = Result.Nodes.getNodeAs<Expr>("argumentChain")) {
+    diagnoseArgumentChain(*Chain, *Result.Context);
+    return;
+  }
+  if (const auto *RoundTrip =
+          Result.Nodes.getNodeAs<CXXMemberCallExpr>("roundTrip")) {
+    diagnoseRoundTrip(*RoundTrip, Result);
+    return;
+  }
+
   const auto *LhsStr = Result.Nodes.getNodeAs<DeclRefExpr>("lhsStr");
   const auto *PlusOperator =
       Result.Nodes.getNodeAs<CXXOperatorCallExpr>("plusOperator");
-  const auto DiagMsg =
-      "string concatenation results in allocation of unnecessary temporary "
-      "strings; consider using 'operator+=' or 'string::append()' instead";
 
   if (LhsStr)
     diag(LhsStr->getExprLoc(), DiagMsg);
-  else if (PlusOperator)
+  else if (PlusOperator && !ReportedChains.count(PlusOperator))
     diag(PlusOperator->getExprLoc(), DiagMsg);
 }
 
+void InefficientStringConcatenationCheck::diagnoseArgumentChain(
+    const Expr &Chain, ASTContext &Context) {
+  SmallVector<const Expr *, 8> Operands, Calls;
+  flattenConcatenation(&Chain, Operands, Calls);
+  // The calls are visited after the call they are an argument of.
+  ReportedChains.insert(Calls.begin(), Calls.end());
+
+  if (ConcatFunction.empty()) {
+    diag(Chain.getExprLoc(),
+         "string concatenation results in allocation of unnecessary "
+         "temporary strings; consider building the argument with "
+         "'string::append()' instead");
+    return;
+  }
+  auto Diag = diag(Chain.getExprLoc(),
+                   "string concatenation results in allocation of unnecessary "
+                   "temporary strings; consider using '%0' instead")
+              << ConcatFunction;
+
+  // StrCat-like functions take char strings and numbers, not characters.
+  QualType CharType = getCharType(Chain.getType());
+  if (CharType.isNull() || !Context.hasSameType(CharType, Context.CharTy))
+    return;
+  const SourceManager &SM = Context.getSourceManager();
+  std::string Replacement = ConcatFunction + "(";
+  for (size_t I = 0; I < Operands.size(); ++I) {
+    const Expr *Operand = Operands[I];
+    if (Operand->getType()->isAnyCharacterType() ||
+        Operand->getBeginLoc().isMacroID() || Operand->getEndLoc().isMacroID())
+      return;
+    if (I > 0)
+      Replacement += ", ";
+    Replacement += Lexer::getSourceText(
+        CharSourceRange::getTokenRange(Operand->getSourceRange()), SM,
+        Context.getLangOpts());
+  }
+  Replacement += ")";
+  SourceRange Range = Chain.IgnoreImplicit()->getSourceRange();
+  if (Range.getBegin().isMacroID() || Range.getEnd().isMacroID())
+    return;
+  Diag << FixItHint::CreateReplacement(Range, Replacement);
+  if (ConcatFunctionHeader.empty())
+    return;
+  if (auto IncludeFixit = Inserter->CreateIncludeInsertion(
+          SM.getFileID(Range.getBegin()), ConcatFunctionHeader,
+          /*IsAngled=*/false))
+    Diag << *IncludeFixit;
+}
+
+void InefficientStringConcatenationCheck::diagnoseRoundTrip(
+    const CXXMemberCallExpr &RoundTrip,
+    const MatchFinder::MatchResult &Result) {
+  const auto *Temporary = Result.Nodes.getNodeAs<Expr>("temporary");
+  const auto *Source = Result.Nodes.getNodeAs<Expr>("source");
+  const ASTContext &Context = *Result.Context;
+
+  // Only copies of the same characters: a string of the same type, or a
+  // pointer to its characters.
+  QualType StringType = Temporary->getType();
+  QualType SourceType = Source->getType();
+  bool FromString = Context.hasSameUnqualifiedType(
+      Source->IgnoreImpCasts()->getType(), StringType);
+  QualType CharType = getCharType(StringType);
+  bool FromPointer = !CharType.isNull() && SourceType->isPointerType() &&
+                     Context.hasSameUnqualifiedType(
+                         SourceType->getPointeeType(), CharType);
+  if (!FromString && !FromPointer)
+    return;
+  // The non-const data() of C++17 lets the callee write into the copy.
+  QualType Pointee = RoundTrip.getType()->getPointeeType();
+  if (Pointee.isNull() || !Pointee.isConstQualified())
+    return;
+
+  StringRef Method = RoundTrip.getMethodDecl()->getName();
+  auto Diag = diag(RoundTrip.getExprLoc(),
+                   "a temporary string is constructed only to call '%0()' on "
+                   "it; use the original %select{string|characters}1 directly")
+              << Method << FromPointer;
+
+  const SourceManager &SM = Context.getSourceManager();
+  const Expr *Argument = Source->IgnoreImpCasts();
+  // X.c_str() for a string, X itself for characters.
+  SourceRange Range =
+      FromPointer ? RoundTrip.getSourceRange() : Temporary->getSourceRange();
+  if (Range.getBegin().isMacroID() || Range.getEnd().isMacroID() ||
+      Argument->getBeginLoc().isMacroID() || Argument->getEndLoc().isMacroID())
+    return;
+  std::string Replacement = Lexer::getSourceText(
+      CharSourceRange::getTokenRange(Argument->getSourceRange()), SM,
+      Context.getLangOpts());
+  if (!isSimpleExpr(Argument))
+    Replacement = "(" + Replacement + ")";
+  Diag << FixItHint::CreateReplacement(Range, Replacement);
+}
+
+void InefficientStringConcatenationCheck::onEndOfTranslationUnit() {
+  ReportedChains.clear();
+}
+
 } // namespace performance
 } // namespace tidy
 } // namespace clang
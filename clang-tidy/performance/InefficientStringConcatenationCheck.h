@@ -11,13 +11,16 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_INEFFICIENTSTRINGCONCATENATION_H
 
 #include "../ClangTidyCheck.h"
+#include "../utils/IncludeInserter.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 namespace clang {
 namespace tidy {
 namespace performance {
 
 /// This check is to warn about the performance overhead arising from
-/// concatenating strings, using the operator+, instead of operator+=.
+/// concatenating strings, using the operator+, instead of operator+=, and
+/// from temporary strings only used to get their characters back.
 ///
 /// For the user-facing documentation see:
 /// http://clang.llvm.org/extra/clang-tidy/checks/performance-inefficient-string-concatenation.html
@@ -27,10 +30,23 @@ public:
                                       ClangTidyContext *Context);
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
+                           Preprocessor *ModuleExpanderPP) override;
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  void onEndOfTranslationUnit() override;
 
 private:
+  void diagnoseArgumentChain(const Expr &Chain, ASTContext &Context);
+  void diagnoseRoundTrip(const CXXMemberCallExpr &RoundTrip,
+                         const ast_matchers::MatchFinder::MatchResult &Result);
+
   const bool StrictMode;
+  const std::string ConcatFunction;
+  const std::string ConcatFunctionHeader;
+  const utils::IncludeSorter::IncludeStyle IncludeStyle;
+  std::unique_ptr<utils::IncludeInserter> Inserter;
+  /// The operator+ calls of the chains already reported as arguments.
+  llvm::SmallPtrSet<const Expr *, 8> ReportedChains;
 };
 
 } // namespace performance
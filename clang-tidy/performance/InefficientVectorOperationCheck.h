@@ -16,7 +16,8 @@ namespace tidy {
 namespace performance {
 
 /// Finds possible inefficient `std::vector` operations (e.g. `push_back`) in
-/// for loops that may cause unnecessary memory reallocations.
+/// for loops that may cause unnecessary memory reallocations. The same goes
+/// for other containers with `reserve()`, and for proto repeated fields.
 ///
 /// For the user-facing documentation see:
 /// http://clang.llvm.org/extra/clang-tidy/checks/performance-inefficient-vector-operation.html
@@ -28,7 +29,14 @@ public:
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
 
 private:
+  void addMatcher(const ast_matchers::DeclarationMatcher &TargetRecordDecl,
+                  StringRef VarDeclName, StringRef VarDeclStmtName,
+                  const ast_matchers::DeclarationMatcher &AppendMethodDecl,
+                  StringRef AppendCallName, ast_matchers::MatchFinder *Finder);
   const std::vector<std::string> VectorLikeClasses;
+
+  // If true, also check inefficient operations for proto repeated fields.
+  bool EnableProto;
 };
 
 } // namespace performance
@@ -39,10 +39,12 @@ void MoveConstArgCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
   Options.store(Opts, "CheckTriviallyCopyableMove", CheckTriviallyCopyableMove);
 }
 
-void MoveConstArgCheck::registerMatchers(MatchFinder *Finder) {
-  if (!getLangOpts().CPlusPlus)
-    return;
+ArrayRef<StringRef> MoveConstArgCheck::getRequiredIdentifiers() const {
+  static const StringRef Identifiers[] = {"move"};
+  return Identifiers;
+}
 
+void MoveConstArgCheck::registerMatchers(MatchFinder *Finder) {
   auto MoveCallMatcher =
       callExpr(callee(functionDecl(hasName("::std::move"))), argumentCountIs(1),
                unless(isInTemplateInstantiation()))
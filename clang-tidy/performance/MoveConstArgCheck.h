@@ -27,8 +27,12 @@ public:
       : ClangTidyCheck(Name, Context),
         CheckTriviallyCopyableMove(
             Options.get("CheckTriviallyCopyableMove", true)) {}
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus;
+  }
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  ArrayRef<StringRef> getRequiredIdentifiers() const override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 
 private:
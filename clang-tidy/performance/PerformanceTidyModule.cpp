@@ -9,18 +9,25 @@
 #include "../ClangTidy.h"
 #include "../ClangTidyModule.h"
 #include "../ClangTidyModuleRegistry.h"
+#include "ExceptionOverheadCheck.h"
 #include "FasterStringFindCheck.h"
 #include "ForRangeCopyCheck.h"
 #include "ImplicitConversionInLoopCheck.h"
 #include "InefficientAlgorithmCheck.h"
+#include "InefficientStdFunctionCheck.h"
 #include "InefficientStringConcatenationCheck.h"
 #include "InefficientVectorOperationCheck.h"
 #include "MoveConstArgCheck.h"
 #include "MoveConstructorInitCheck.h"
 #include "NoexceptMoveConstructorCheck.h"
+#include "StructLayoutCheck.h"
 #include "TypePromotionInMathFnCheck.h"
+#include "UnnecessaryConstRefParamCheck.h"
 #include "UnnecessaryCopyInitialization.h"
+#include "UnnecessaryCopyOnLastUseCheck.h"
+#include "UnnecessaryOrderedContainerCheck.h"
 #include "UnnecessaryValueParamCheck.h"
+#include "VirtualCallInLoopCheck.h"
 
 namespace clang {
 namespace tidy {
@@ -29,6 +36,8 @@ namespace performance {
 class PerformanceModule : public ClangTidyModule {
 public:
   void addCheckFactories(ClangTidyCheckFactories &CheckFactories) override {
+    CheckFactories.registerCheck<ExceptionOverheadCheck>(
+        "performance-exception-overhead");
     CheckFactories.registerCheck<FasterStringFindCheck>(
         "performance-faster-string-find");
     CheckFactories.registerCheck<ForRangeCopyCheck>(
@@ -37,6 +46,8 @@ public:
         "performance-implicit-conversion-in-loop");
     CheckFactories.registerCheck<InefficientAlgorithmCheck>(
         "performance-inefficient-algorithm");
+    CheckFactories.registerCheck<InefficientStdFunctionCheck>(
+        "performance-inefficient-std-function");
     CheckFactories.registerCheck<InefficientStringConcatenationCheck>(
         "performance-inefficient-string-concatenation");
     CheckFactories.registerCheck<InefficientVectorOperationCheck>(
@@ -47,12 +58,22 @@ public:
         "performance-move-constructor-init");
     CheckFactories.registerCheck<NoexceptMoveConstructorCheck>(
         "performance-noexcept-move-constructor");
+    CheckFactories.registerCheck<StructLayoutCheck>(
+        "performance-struct-layout");
     CheckFactories.registerCheck<TypePromotionInMathFnCheck>(
         "performance-type-promotion-in-math-fn");
+    CheckFactories.registerCheck<UnnecessaryConstRefParamCheck>(
+        "performance-unnecessary-const-ref-param");
     CheckFactories.registerCheck<UnnecessaryCopyInitialization>(
         "performance-unnecessary-copy-initialization");
+    CheckFactories.registerCheck<UnnecessaryCopyOnLastUseCheck>(
+        "performance-unnecessary-copy-on-last-use");
+    CheckFactories.registerCheck<UnnecessaryOrderedContainerCheck>(
+        "performance-unnecessary-ordered-container");
     CheckFactories.registerCheck<UnnecessaryValueParamCheck>(
         "performance-unnecessary-value-param");
+    CheckFactories.registerCheck<VirtualCallInLoopCheck>(
+        "performance-virtual-call-in-loop");
   }
 };
 
@@ -0,0 +1,177 @@
+//===--- StructLayoutCheck.cpp - clang-tidy -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "StructLayoutCheck.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/RecordLayout.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/STLExtras.h"
+#include <algorithm>
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+namespace {
+
+struct FieldLayout {
+  const FieldDecl *Field;
+  CharUnits Size;
+  CharUnits Align;
+};
+
+bool isAtomic(QualType Type) {
+  Type = Type.getCanonicalType();
+  if (Type->isAtomicType())
+    return true;
+  // libc++ declares it in an inline namespace, std::__1.
+  const auto *Record = Type->getAsCXXRecordDecl();
+  return Record && Record->isInStdNamespace() && Record->getName() == "atomic";
+}
+
+} // namespace
+
+StructLayoutCheck::StructLayoutCheck(StringRef Name, ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context),
+      PaddingThreshold(Options.get("PaddingThreshold", 4U)),
+      CacheLineSize(Options.get("CacheLineSize", 64U)) {}
+
+void StructLayoutCheck::storeOptions(ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "PaddingThreshold", PaddingThreshold);
+  Options.store(Opts, "CacheLineSize", CacheLineSize);
+}
+
+void StructLayoutCheck::registerMatchers(MatchFinder *Finder) {
+  Finder->addMatcher(
+      recordDecl(isDefinition(), unless(isImplicit()), unless(isUnion()))
+          .bind("record"),
+      this);
+}
+
+void StructLayoutCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *Record = Result.Nodes.getNodeAs<RecordDecl>("record");
+  if (Record->isInvalidDecl() || Record->isDependentType() ||
+      Record->getLocation().isMacroID())
+    return;
+  // The fields of templates are reordered in the template, and lambda
+  // captures have no declaration.
+  if (const auto *CXXRecord = dyn_cast<CXXRecordDecl>(Record))
+    if (CXXRecord->getTemplateInstantiationPattern() || CXXRecord->isLambda())
+      return;
+
+  const ASTRecordLayout &Layout = Result.Context->getASTRecordLayout(Record);
+  checkPadding(*Record, Layout, *Result.Context);
+  checkFalseSharing(*Record, Layout, *Result.Context);
+}
+
+void StructLayoutCheck::checkPadding(const RecordDecl &Record,
+                                     const ASTRecordLayout &Layout,
+                                     const ASTContext &Context) {
+  // Only the layouts where the fields alone decide of the padding.
+  if (Record.getName().empty() || Record.hasAttr<PackedAttr>() ||
+      Record.hasAttr<MaxFieldAlignmentAttr>())
+    return;
+  if (const auto *CXXRecord = dyn_cast<CXXRecordDecl>(&Record))
+    if (CXXRecord->getNumBases() > 0 || CXXRecord->isDynamicClass())
+      return;
+
+  SmallVector<FieldLayout, 8> Fields;
+  CharUnits FieldsSize = CharUnits::Zero();
+  for (const FieldDecl *Field : Record.fields()) {
+    // clang-reorder-fields needs the names of the fields.
+    if (Field->isBitField() || Field->getName().empty() ||
+        Field->getType()->isIncompleteArrayType() ||
+        Field->getType()->isDependentType())
+      return;
+    FieldLayout F = {Field, Context.getTypeSizeInChars(Field->getType()),
+                     Context.getDeclAlign(Field)};
+    FieldsSize += F.Size;
+    Fields.push_back(F);
+  }
+  if (Fields.size() < 2)
+    return;
+
+  // Fields ordered by decreasing alignment need no padding between them, as
+  // their sizes are multiples of their alignments.
+  std::stable_sort(Fields.begin(), Fields.end(),
+                   [](const FieldLayout &L, const FieldLayout &R) {
+                     return L.Align > R.Align;
+                   });
+  CharUnits Offset = CharUnits::Zero();
+  for (const FieldLayout &F : Fields)
+    Offset = Offset.alignTo(F.Align) + F.Size;
+  CharUnits Size = Layout.getSize();
+  CharUnits OptimalSize = Offset.alignTo(Layout.getAlignment());
+  if (Size - OptimalSize < CharUnits::fromQuantity(PaddingThreshold))
+    return;
+
+  std::string Order;
+  for (const FieldLayout &F : Fields) {
+    if (!Order.empty())
+      Order += ',';
+    Order += F.Field->getName();
+  }
+  diag(Record.getLocation(),
+       "%0 is %1 bytes large with %2 bytes of padding; reordering its fields "
+       "would make it %3 bytes large")
+      << &Record << static_cast<unsigned>(Size.getQuantity())
+      << static_cast<unsigned>((Size - FieldsSize).getQuantity())
+      << static_cast<unsigned>(OptimalSize.getQuantity());
+  diag(Record.getLocation(),
+       "fields ordered by decreasing alignment; apply with "
+       "'clang-reorder-fields -record-name=%0 -fields-order=%1'",
+       DiagnosticIDs::Note)
+      << Record.getQualifiedNameAsString() << Order;
+}
+
+void StructLayoutCheck::checkFalseSharing(const RecordDecl &Record,
+                                          const ASTRecordLayout &Layout,
+                                          const ASTContext &Context) {
+  if (CacheLineSize == 0)
+    return;
+  const LangOptions &LangOpts = Context.getLangOpts();
+  SmallVector<const FieldDecl *, 8> Fields(Record.field_begin(),
+                                           Record.field_end());
+  const FieldDecl *Previous = nullptr;
+  uint64_t PreviousLine = 0;
+  for (size_t I = 0; I < Fields.size(); ++I) {
+    const FieldDecl *Field = Fields[I];
+    if (!isAtomic(Field->getType()))
+      continue;
+    uint64_t Line = Context
+                        .toCharUnitsFromBits(
+                            Layout.getFieldOffset(Field->getFieldIndex()))
+                        .getQuantity() /
+                    CacheLineSize;
+    if (Previous && Line == PreviousLine) {
+      auto Diag = diag(Field->getLocation(),
+                       "atomic field %0 shares a cache line with %1; consider "
+                       "aligning it to a cache line to avoid false sharing")
+                  << Field << Previous;
+      // Declarations of several fields can't be aligned separately.
+      SourceLocation Begin = Field->getBeginLoc();
+      bool SharesDeclaration =
+          (I > 0 && Fields[I - 1]->getBeginLoc() == Begin) ||
+          (I + 1 < Fields.size() && Fields[I + 1]->getBeginLoc() == Begin);
+      if (!Begin.isMacroID() && !SharesDeclaration &&
+          (LangOpts.CPlusPlus11 || LangOpts.C11))
+        Diag << FixItHint::CreateInsertion(
+            Begin, (llvm::Twine(LangOpts.CPlusPlus ? "alignas(" : "_Alignas(") +
+                    llvm::Twine(CacheLineSize) + ") ")
+                       .str());
+    }
+    Previous = Field;
+    PreviousLine = Line;
+  }
+}
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
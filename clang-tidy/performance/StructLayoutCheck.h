@@ -0,0 +1,48 @@
+//===--- StructLayoutCheck.h - clang-tidy -----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_STRUCT_LAYOUT_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_STRUCT_LAYOUT_H
+
+#include "../ClangTidyCheck.h"
+
+namespace clang {
+class ASTRecordLayout;
+
+namespace tidy {
+namespace performance {
+
+/// \brief Finds structs whose fields could be reordered to remove padding,
+/// and atomic fields of a struct sharing a cache line.
+///
+/// For the user-facing documentation see:
+/// http://clang.llvm.org/extra/clang-tidy/checks/performance-struct-layout.html
+class StructLayoutCheck : public ClangTidyCheck {
+public:
+  StructLayoutCheck(StringRef Name, ClangTidyContext *Context);
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+
+private:
+  void checkPadding(const RecordDecl &Record, const ASTRecordLayout &Layout,
+                    const ASTContext &Context);
+  void checkFalseSharing(const RecordDecl &Record,
+                         const ASTRecordLayout &Layout,
+                         const ASTContext &Context);
+
+  /// The number of bytes a reordering must save to be suggested.
+  const unsigned PaddingThreshold;
+  const unsigned CacheLineSize;
+};
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_STRUCT_LAYOUT_H
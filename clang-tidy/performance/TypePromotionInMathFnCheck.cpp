@@ -36,8 +36,8 @@ TypePromotionInMathFnCheck::TypePromotionInMathFnCheck(
 
 void TypePromotionInMathFnCheck::registerPPCallbacks(
     const SourceManager &SM, Preprocessor *PP, Preprocessor *ModuleExpanderPP) {
-  IncludeInserter = llvm::make_unique<utils::IncludeInserter>(SM, getLangOpts(),
-                                                              IncludeStyle);
+  IncludeInserter = llvm::make_unique<utils::IncludeInserter>(
+      SM, getLangOpts(), IncludeStyle, &getIncludeDirectives());
   PP->addPPCallbacks(IncludeInserter->CreatePPCallbacks());
 }
 
@@ -0,0 +1,267 @@
+//===--- UnnecessaryConstRefParamCheck.cpp - clang-tidy -------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "UnnecessaryConstRefParamCheck.h"
+
+#include "../utils/DeclRefExprUtils.h"
+#include "../utils/Matchers.h"
+#include "../utils/OptionsUtils.h"
+#include "../utils/ParameterUtils.h"
+#include "../utils/TypeTraits.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/TypeLoc.h"
+#include "clang/Basic/TargetInfo.h"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+namespace {
+
+// Whether a value of type T can keep a reference to an object bound to it,
+// e.g. a pointer, a view or a std::reference_wrapper.
+bool mayHoldReference(QualType T) {
+  if (T->isReferenceType() || T->isPointerType())
+    return true;
+  const auto *Record = T->getAsCXXRecordDecl();
+  if (!Record || !Record->hasDefinition())
+    return false;
+  return llvm::any_of(Record->fields(), [](const FieldDecl *Field) {
+    return Field->getType()->isReferenceType() ||
+           Field->getType()->isPointerType();
+  });
+}
+
+// Returns the outermost expression that still designates the object E refers
+// to, or one of its members: parentheses, qualification conversions, member
+// accesses and the branches of conditional operators are looked through.
+const Expr *outermostAlias(const Expr *E, ASTContext &Context) {
+  while (true) {
+    auto Parents = Context.getParents(*E);
+    if (Parents.size() != 1)
+      return E;
+    const auto *Parent = Parents[0].get<Expr>();
+    if (!Parent)
+      return E;
+    if (const auto *Cast = dyn_cast<ImplicitCastExpr>(Parent)) {
+      if (Cast->getCastKind() != CK_NoOp &&
+          Cast->getCastKind() != CK_DerivedToBase &&
+          Cast->getCastKind() != CK_UncheckedDerivedToBase)
+        return E;
+    } else if (const auto *Member = dyn_cast<MemberExpr>(Parent)) {
+      if (Member->isArrow() || !isa<FieldDecl>(Member->getMemberDecl()))
+        return E;
+    } else if (const auto *Conditional =
+                   dyn_cast<AbstractConditionalOperator>(Parent)) {
+      if (!Conditional->isGLValue() || E == Conditional->getCond())
+        return E;
+    } else if (!isa<ParenExpr>(Parent)) {
+      return E;
+    }
+    E = Parent;
+  }
+}
+
+// Whether the argument Arg of Call is bound to a reference parameter.
+bool bindsToReference(const CallExpr &Call, const Expr *Arg) {
+  const auto *Args = Call.getArgs();
+  unsigned Index = std::find(Args, Args + Call.getNumArgs(), Arg) - Args;
+  if (Index == Call.getNumArgs())
+    return false;
+  const FunctionDecl *Callee = Call.getDirectCallee();
+  if (!Callee)
+    return true;
+  // The object argument of a member operator has no ParmVarDecl.
+  if (isa<CXXOperatorCallExpr>(Call) && isa<CXXMethodDecl>(Callee)) {
+    if (Index == 0)
+      return true;
+    --Index;
+  }
+  return Index < Callee->getNumParams() &&
+         Callee->getParamDecl(Index)->getType()->isReferenceType();
+}
+
+// Whether Alias, which designates the parameter, is bound to a reference or a
+// pointer that may outlive the function, or that the function returns.
+bool bindsIdentity(const Expr *Alias, const FunctionDecl &Function,
+                   ASTContext &Context) {
+  auto Parents = Context.getParents(*Alias);
+  if (Parents.size() != 1)
+    return false;
+  const ast_type_traits::DynTypedNode &Parent = Parents[0];
+  if (const auto *Op = Parent.get<UnaryOperator>())
+    return Op->getOpcode() == UO_AddrOf;
+  if (Parent.get<ReturnStmt>())
+    return Function.getReturnType()->isReferenceType();
+  if (const auto *Var = Parent.get<VarDecl>())
+    return Var->getType()->isReferenceType();
+  if (const auto *InitList = Parent.get<InitListExpr>())
+    return mayHoldReference(InitList->getType());
+  // A method called on the parameter, which may return a reference into it.
+  if (Parent.get<MemberExpr>()) {
+    auto CallParents = Context.getParents(Parent);
+    const auto *Call =
+        CallParents.size() == 1 ? CallParents[0].get<CXXMemberCallExpr>()
+                                : nullptr;
+    return Call && mayHoldReference(Call->getCallReturnType(Context));
+  }
+  if (const auto *Call = Parent.get<CallExpr>())
+    return bindsToReference(*Call, Alias) &&
+           mayHoldReference(Call->getCallReturnType(Context));
+  if (const auto *Construct = Parent.get<CXXConstructExpr>()) {
+    const CXXConstructorDecl *Ctor = Construct->getConstructor();
+    if (Ctor->isCopyOrMoveConstructor())
+      return false;
+    const auto *Args = Construct->getArgs();
+    unsigned Index =
+        std::find(Args, Args + Construct->getNumArgs(), Alias) - Args;
+    return Index < Ctor->getNumParams() &&
+           Ctor->getParamDecl(Index)->getType()->isReferenceType() &&
+           mayHoldReference(Construct->getType());
+  }
+  return false;
+}
+
+// Whether the function relies on the parameter referring to the argument
+// itself: a reference or a pointer to it is kept or returned, a lambda
+// captures it by reference, or the argument may be modified through another
+// parameter, e.g. in f(Data[0], Data).
+bool dependsOnIdentity(const ParmVarDecl &Param, const FunctionDecl &Function,
+                       ASTContext &Context) {
+  bool AliasesMutableParam =
+      llvm::any_of(Function.parameters(), [&](const ParmVarDecl *Other) {
+        QualType T = Other->getType();
+        return Other != &Param &&
+               (T->isReferenceType() || T->isPointerType()) &&
+               !T->getPointeeType().isConstQualified();
+      });
+  if (AliasesMutableParam)
+    return true;
+
+  const auto *Ctor = dyn_cast<CXXConstructorDecl>(&Function);
+  for (const DeclRefExpr *Ref :
+       utils::decl_ref_expr::allDeclRefExprs(Param, Function, Context)) {
+    const Expr *Alias = outermostAlias(Ref, Context);
+    if (bindsIdentity(Alias, Function, Context))
+      return true;
+    if (Ctor)
+      for (const CXXCtorInitializer *Init : Ctor->inits())
+        if (Init->isAnyMemberInitializer() &&
+            Init->getAnyMember()->getType()->isReferenceType() &&
+            Init->getInit()->IgnoreParens() == Alias->IgnoreParens())
+          return true;
+  }
+
+  auto Lambdas = match(decl(forEachDescendant(lambdaExpr().bind("lambda"))),
+                       Function, Context);
+  for (const auto &Match : Lambdas)
+    for (const LambdaCapture &Capture :
+         Match.getNodeAs<LambdaExpr>("lambda")->captures())
+      if (Capture.capturesVariable() && Capture.getCapturedVar() == &Param &&
+          Capture.getCaptureKind() == LCK_ByRef)
+        return true;
+  return false;
+}
+
+} // namespace
+
+UnnecessaryConstRefParamCheck::UnnecessaryConstRefParamCheck(
+    StringRef Name, ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context), MaxSize(Options.get("MaxSize", 0U)),
+      AllowedTypes(
+          utils::options::parseStringList(Options.get("AllowedTypes", ""))) {}
+
+void UnnecessaryConstRefParamCheck::registerMatchers(MatchFinder *Finder) {
+  const auto ConstRefParamDecl = parmVarDecl(
+      hasType(lValueReferenceType(pointee(qualType(
+          isConstQualified(),
+          unless(hasDeclaration(
+              namedDecl(matchers::matchesAnyListedName(AllowedTypes)))))))),
+      decl().bind("param"));
+  // Copy and move operations must take their argument by reference.
+  Finder->addMatcher(
+      functionDecl(
+          hasBody(stmt()), isDefinition(), unless(isImplicit()),
+          unless(cxxMethodDecl(anyOf(isOverride(), isFinal(),
+                                     isCopyAssignmentOperator(),
+                                     isMoveAssignmentOperator()))),
+          unless(cxxConstructorDecl(
+              anyOf(isCopyConstructor(), isMoveConstructor()))),
+          has(typeLoc(forEach(ConstRefParamDecl))), unless(isInstantiated()),
+          decl().bind("functionDecl")),
+      this);
+}
+
+void UnnecessaryConstRefParamCheck::check(
+    const MatchFinder::MatchResult &Result) {
+  const auto *Param = Result.Nodes.getNodeAs<ParmVarDecl>("param");
+  const auto *Function = Result.Nodes.getNodeAs<FunctionDecl>("functionDecl");
+  ASTContext &Context = *Result.Context;
+
+  // Two registers is what the common ABIs pass aggregates in.
+  uint64_t Limit =
+      MaxSize ? MaxSize : 2 * Context.getTargetInfo().getPointerWidth(0) / 8;
+  QualType PointeeType =
+      Param->getType().getNonReferenceType().getCanonicalType();
+  if (!utils::type_traits::isCheapToCopy(PointeeType, Context, Limit) ||
+      dependsOnIdentity(*Param, *Function, Context))
+    return;
+
+  const size_t Index = std::find(Function->parameters().begin(),
+                                 Function->parameters().end(), Param) -
+                       Function->parameters().begin();
+
+  auto Diag = diag(Param->getLocation(),
+                   "the parameter %0 is a const reference to a small, "
+                   "trivially copyable type; consider passing it by value")
+              << utils::paramNameOrIndex(Param->getName(), Index);
+  // Do not propose fixes when:
+  // 1. the ParmVarDecl is in a macro, since we cannot place them correctly
+  // 2. the function is virtual as it might break overrides
+  // 3. the function is referenced outside of a call expression within the
+  //    compilation unit as the signature change could introduce build errors.
+  // 4. the function is an explicit template specialization.
+  const auto *Method = llvm::dyn_cast<CXXMethodDecl>(Function);
+  if (Param->getBeginLoc().isMacroID() || (Method && Method->isVirtual()) ||
+      utils::isReferencedOutsideOfCallExpr(*Function, Context) ||
+      utils::isExplicitTemplateSpecialization(*Function))
+    return;
+  // Removing the '&' is enough: the const qualifier still prevents the
+  // definition from modifying its copy. All declarations are fixed or none,
+  // e.g. when one of them spells the reference through a typedef.
+  std::vector<FixItHint> Fixes;
+  for (const auto *FunctionDecl = Function; FunctionDecl != nullptr;
+       FunctionDecl = FunctionDecl->getPreviousDecl()) {
+    const ParmVarDecl &CurrentParam = *FunctionDecl->getParamDecl(Index);
+    const TypeSourceInfo *TSI = CurrentParam.getTypeSourceInfo();
+    if (!TSI)
+      return;
+    auto RefLoc = TSI->getTypeLoc().getAs<LValueReferenceTypeLoc>();
+    if (!RefLoc || RefLoc.getAmpLoc().isMacroID())
+      return;
+    Fixes.push_back(FixItHint::CreateRemoval(
+        CharSourceRange::getTokenRange(RefLoc.getAmpLoc())));
+  }
+  Diag << Fixes;
+}
+
+void UnnecessaryConstRefParamCheck::storeOptions(
+    ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "MaxSize", MaxSize);
+  Options.store(Opts, "AllowedTypes",
+                utils::options::serializeStringList(AllowedTypes));
+}
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,303 @@
+//===--- UnnecessaryCopyOnLastUseCheck.cpp - clang-tidy -------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "UnnecessaryCopyOnLastUseCheck.h"
+
+#include "../utils/DeclRefExprUtils.h"
+#include "../utils/Matchers.h"
+#include "../utils/OptionsUtils.h"
+#include "../utils/TypeTraits.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+namespace {
+
+// As in bugprone-use-after-move, destructors are added so that [[noreturn]]
+// ones end the control flow. Calls that may throw lead to the handlers of
+// their try block, which may use the variable after the copy.
+CFG::BuildOptions getCFGBuildOptions() {
+  CFG::BuildOptions Options;
+  Options.AddImplicitDtors = true;
+  Options.AddTemporaryDtors = true;
+  Options.AddEHEdges = true;
+  return Options;
+}
+
+const Stmt *getParentStmt(const Stmt &S, ASTContext &Context) {
+  const auto Parents = Context.getParents(S);
+  return Parents.empty() ? nullptr : Parents[0].get<Stmt>();
+}
+
+// Whether the argument \p I of \p Callee binds to a non-const reference.
+bool bindsToMutableReference(const FunctionDecl *Callee, unsigned I) {
+  // Calls through pointers and variadic arguments aren't followed.
+  if (!Callee || I >= Callee->getNumParams())
+    return true;
+  QualType Param = Callee->getParamDecl(I)->getType();
+  return Param->isReferenceType() &&
+         !Param.getNonReferenceType().isConstQualified();
+}
+
+// Whether \p Ref, an expression referring to a variable, creates a pointer or
+// a reference to it or to one of its subobjects. The expressions referring to
+// subobjects, like its members or the result of its operator[], are followed
+// up to one that reads a value, or that lets the address escape.
+bool escapes(const Expr *Ref, ASTContext &Context) {
+  while (true) {
+    const auto Parents = Context.getParents(*Ref);
+    if (Parents.empty())
+      return false;
+    if (const auto *Init = Parents[0].get<VarDecl>())
+      return Init->getType()->isReferenceType();
+    const auto *Parent = Parents[0].get<Expr>();
+    if (!Parent)
+      return false;
+
+    // A method or an overloaded operator called on the variable, like begin(),
+    // data(), operator[] or operator*. Iterators and views are classes, so a
+    // result of class type may point into the variable too.
+    const Expr *CalledOn = nullptr;
+    if (const auto *Member = dyn_cast<MemberExpr>(Parent)) {
+      if (const auto *Call = dyn_cast_or_null<CXXMemberCallExpr>(
+              getParentStmt(*Member, Context)))
+        if (Call->getCallee() == Member)
+          CalledOn = Call;
+    } else if (const auto *Op = dyn_cast<CXXOperatorCallExpr>(Parent)) {
+      const Decl *Callee = Op->getCalleeDecl();
+      if (Callee && isa<CXXMethodDecl>(Callee) && Op->getArg(0) == Ref)
+        CalledOn = Op;
+    }
+    if (CalledOn) {
+      if (!CalledOn->isGLValue())
+        return CalledOn->getType()->isPointerType() ||
+               CalledOn->getType()->isRecordType();
+      Ref = CalledOn;
+      continue;
+    }
+
+    if (const auto *Cast = dyn_cast<ImplicitCastExpr>(Parent)) {
+      if (Cast->getCastKind() == CK_ArrayToPointerDecay)
+        return true;
+      if (Cast->getCastKind() == CK_LValueToRValue)
+        return false;
+    } else if (const auto *Unary = dyn_cast<UnaryOperator>(Parent)) {
+      if (Unary->getOpcode() == UO_AddrOf)
+        return true;
+      if (Unary->getOpcode() != UO_Deref)
+        return false;
+    } else if (const auto *Call = dyn_cast<CallExpr>(Parent)) {
+      // Passed as an argument. The implicit object argument of a member
+      // operator isn't a parameter.
+      const auto *Callee =
+          dyn_cast_or_null<FunctionDecl>(Call->getCalleeDecl());
+      bool IsMemberOperator = isa<CXXOperatorCallExpr>(Call) && Callee &&
+                              isa<CXXMethodDecl>(Callee);
+      unsigned Shift = IsMemberOperator ? 1 : 0;
+      for (unsigned I = Shift; I < Call->getNumArgs(); ++I)
+        if (Call->getArg(I) == Ref)
+          return bindsToMutableReference(Callee, I - Shift);
+      return false;
+    } else if (const auto *Construct = dyn_cast<CXXConstructExpr>(Parent)) {
+      for (unsigned I = 0; I < Construct->getNumArgs(); ++I)
+        if (Construct->getArg(I) == Ref)
+          return bindsToMutableReference(Construct->getConstructor(), I);
+      return false;
+    } else if (!isa<MemberExpr>(Parent) && !isa<ParenExpr>(Parent) &&
+               !isa<ArraySubscriptExpr>(Parent) &&
+               !isa<ConditionalOperator>(Parent) &&
+               !isa<MaterializeTemporaryExpr>(Parent)) {
+      return false;
+    }
+    Ref = Parent;
+  }
+}
+
+// Whether a pointer or a reference to \p Var or its subobjects is created in
+// \p Body, through which it could be used after its last direct use.
+bool isAliased(const VarDecl &Var, const Stmt &Body, ASTContext &Context) {
+  for (const DeclRefExpr *Ref :
+       utils::decl_ref_expr::allDeclRefExprs(Var, Body, Context))
+    if (escapes(Ref, Context))
+      return true;
+  auto Aliases = match(
+      findAll(cxxForRangeStmt(hasRangeInit(
+          ignoringImplicit(declRefExpr(to(equalsNode(&Var))))))),
+      Body, Context);
+  if (!Aliases.empty())
+    return true;
+  // Lambdas capturing it by reference may be called after its last use.
+  for (const auto &Match :
+       match(findAll(lambdaExpr().bind("lambda")), Body, Context)) {
+    for (const LambdaCapture &Capture :
+         Match.getNodeAs<LambdaExpr>("lambda")->captures())
+      if (Capture.capturesVariable() && Capture.getCapturedVar() == &Var &&
+          Capture.getCaptureKind() == LCK_ByRef)
+        return true;
+  }
+  return false;
+}
+
+} // namespace
+
+UnnecessaryCopyOnLastUseCheck::UnnecessaryCopyOnLastUseCheck(
+    StringRef Name, ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context), CFGs(getCFGBuildOptions()),
+      IncludeStyle(utils::IncludeSorter::parseIncludeStyle(
+          Options.getLocalOrGlobal("IncludeStyle", "llvm"))),
+      AllowedTypes(
+          utils::options::parseStringList(Options.get("AllowedTypes", ""))) {}
+
+void UnnecessaryCopyOnLastUseCheck::registerMatchers(MatchFinder *Finder) {
+  const auto MovableVar = varDecl(
+      hasLocalStorage(),
+      hasType(qualType(
+          hasCanonicalType(matchers::isExpensiveToCopy()),
+          unless(anyOf(referenceType(), isConstQualified(),
+                       isVolatileQualified(),
+                       hasDeclaration(namedDecl(
+                           matchers::matchesAnyListedName(AllowedTypes))))))));
+  const auto Use =
+      ignoringImplicit(declRefExpr(to(MovableVar.bind("var"))).bind("use"));
+  const auto InFunction =
+      anyOf(hasAncestor(lambdaExpr().bind("lambda")),
+            hasAncestor(functionDecl().bind("function")));
+
+  Finder->addMatcher(
+      cxxConstructExpr(hasDeclaration(cxxConstructorDecl(isCopyConstructor())),
+                       hasArgument(0, Use), unless(isInTemplateInstantiation()),
+                       InFunction)
+          .bind("copy"),
+      this);
+  Finder->addMatcher(
+      cxxOperatorCallExpr(
+          hasOverloadedOperatorName("="),
+          callee(cxxMethodDecl(isCopyAssignmentOperator())),
+          hasArgument(1, Use), unless(isInTemplateInstantiation()), InFunction)
+          .bind("copy"),
+      this);
+}
+
+void UnnecessaryCopyOnLastUseCheck::check(
+    const MatchFinder::MatchResult &Result) {
+  const auto *Copy = Result.Nodes.getNodeAs<Expr>("copy");
+  const auto *Use = Result.Nodes.getNodeAs<DeclRefExpr>("use");
+  const auto *Var = Result.Nodes.getNodeAs<VarDecl>("var");
+  const auto *Lambda = Result.Nodes.getNodeAs<LambdaExpr>("lambda");
+  const auto *Function = Result.Nodes.getNodeAs<FunctionDecl>("function");
+
+  // The variable must belong to the innermost function: a lambda can't move
+  // what it captures by copy, nor what it captures by reference.
+  const DeclContext *Owner = Lambda ? Lambda->getCallOperator() : Function;
+  Stmt *Body = Lambda ? Lambda->getBody() : Function->getBody();
+  if (!Body || Var->getDeclContext() != Owner)
+    return;
+
+  // Moving only pays off if the move is cheaper than the copy.
+  QualType Type = Var->getType().getCanonicalType();
+  bool IsAssignment = isa<CXXOperatorCallExpr>(Copy);
+  if (!(IsAssignment
+            ? utils::type_traits::hasNonTrivialMoveAssignment(Type)
+            : utils::type_traits::hasNonTrivialMoveConstructor(Type)))
+    return;
+
+  if (!isLastUse(*Use, *Copy, *Var, Body, *Result.Context))
+    return;
+
+  auto Diag = diag(Use->getBeginLoc(),
+                   "%select{local variable|parameter}0 %1 is copied on its "
+                   "last use; consider moving it to avoid the copy")
+              << isa<ParmVarDecl>(Var) << Var;
+  if (Use->getBeginLoc().isMacroID())
+    return;
+  const SourceManager &SM = *Result.SourceManager;
+  SourceLocation EndLoc = Lexer::getLocForEndOfToken(
+      Use->getEndLoc(), 0, SM, Result.Context->getLangOpts());
+  Diag << FixItHint::CreateInsertion(Use->getBeginLoc(), "std::move(")
+       << FixItHint::CreateInsertion(EndLoc, ")");
+  if (auto IncludeFixit = Inserter->CreateIncludeInsertion(
+          SM.getFileID(Use->getBeginLoc()), "utility",
+          /*IsAngled=*/true))
+    Diag << *IncludeFixit;
+}
+
+bool UnnecessaryCopyOnLastUseCheck::isLastUse(const DeclRefExpr &Use,
+                                              const Expr &Copy,
+                                              const VarDecl &Var, Stmt *Body,
+                                              ASTContext &Context) {
+  const utils::CFGCache::Entry *Analyses = CFGs.get(Body, &Context);
+  if (!Analyses)
+    return false;
+  const CFGBlock *CopyBlock = Analyses->BlockMap->blockContainingStmt(&Copy);
+  if (!CopyBlock || isAliased(Var, *Body, Context))
+    return false;
+
+  // The blocks that may run after the copy, up to a new declaration of the
+  // variable, e.g. in the next iteration of a loop.
+  llvm::SmallPtrSet<const CFGBlock *, 8> Declaring;
+  for (const CFGBlock *Block : *Analyses->TheCFG) {
+    for (const CFGElement &Element : *Block) {
+      Optional<CFGStmt> S = Element.getAs<CFGStmt>();
+      if (!S)
+        continue;
+      const auto *Decl = dyn_cast<DeclStmt>(S->getStmt());
+      if (Decl && Decl->isSingleDecl() && Decl->getSingleDecl() == &Var)
+        Declaring.insert(Block);
+    }
+  }
+  llvm::SmallPtrSet<const CFGBlock *, 8> Reachable;
+  SmallVector<const CFGBlock *, 8> Worklist(CopyBlock->succ_begin(),
+                                            CopyBlock->succ_end());
+  while (!Worklist.empty()) {
+    const CFGBlock *Block = Worklist.pop_back_val();
+    if (!Block || Declaring.count(Block) || !Reachable.insert(Block).second)
+      continue;
+    Worklist.append(Block->succ_begin(), Block->succ_end());
+  }
+  if (Reachable.count(CopyBlock))
+    return false;
+
+  for (const DeclRefExpr *Other :
+       utils::decl_ref_expr::allDeclRefExprs(Var, *Body, Context)) {
+    if (Other == &Use)
+      continue;
+    // Uses the CFG doesn't contain can't be ordered. Those in lambdas are found
+    // in the block creating the lambda, where they are captured.
+    const CFGBlock *Block = Analyses->BlockMap->blockContainingStmt(Other);
+    if (!Block || Reachable.count(Block) ||
+        (Block == CopyBlock &&
+         Analyses->Sequence->potentiallyAfter(Other, &Copy)))
+      return false;
+  }
+  return true;
+}
+
+void UnnecessaryCopyOnLastUseCheck::registerPPCallbacks(
+    const SourceManager &SM, Preprocessor *PP, Preprocessor *ModuleExpanderPP) {
+  Inserter = llvm::make_unique<utils::IncludeInserter>(
+      SM, getLangOpts(), IncludeStyle, &getIncludeDirectives());
+  PP->addPPCallbacks(Inserter->CreatePPCallbacks());
+}
+
+void UnnecessaryCopyOnLastUseCheck::storeOptions(
+    ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "IncludeStyle",
+                utils::IncludeSorter::toString(IncludeStyle));
+  Options.store(Opts, "AllowedTypes",
+                utils::options::serializeStringList(AllowedTypes));
+}
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,153 @@
+//===--- UnnecessaryOrderedContainerCheck.cpp - clang-tidy ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "UnnecessaryOrderedContainerCheck.h"
+#include "../utils/OptionsUtils.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+namespace {
+
+bool isStdRecord(QualType Type, StringRef Name) {
+  const auto *Record = Type->getAsCXXRecordDecl();
+  return Record && Record->isInStdNamespace() && Record->getName() == Name;
+}
+
+// Whether std::hash, which hashed containers use by default, supports keys of
+// type \p Key.
+bool isHashable(QualType Key) {
+  Key = Key.getCanonicalType();
+  return Key->isIntegralOrEnumerationType() || Key->isRealFloatingType() ||
+         Key->isPointerType() || Key->isNullPtrType() ||
+         isStdRecord(Key, "basic_string");
+}
+
+} // namespace
+
+UnnecessaryOrderedContainerCheck::UnnecessaryOrderedContainerCheck(
+    StringRef Name, ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context),
+      OrderedContainers(utils::options::parseStringList(
+          Options.get("OrderedContainers", "::std::map;::std::set"))),
+      Replacements(utils::options::parseStringList(Options.get(
+          "Replacements", "std::unordered_map;std::unordered_set"))) {}
+
+void UnnecessaryOrderedContainerCheck::storeOptions(
+    ClangTidyOptions::OptionMap &Opts) {
+  Options.store(Opts, "OrderedContainers",
+                utils::options::serializeStringList(OrderedContainers));
+  Options.store(Opts, "Replacements",
+                utils::options::serializeStringList(Replacements));
+}
+
+void UnnecessaryOrderedContainerCheck::registerMatchers(MatchFinder *Finder) {
+  // All the uses of locals, and of the private fields of the classes of the
+  // main file, are seen.
+  const auto Candidate = valueDecl(
+      hasType(hasUnqualifiedDesugaredType(recordType(
+          hasDeclaration(classTemplateSpecializationDecl(
+                             hasAnyName(SmallVector<StringRef, 4>(
+                                 OrderedContainers.begin(),
+                                 OrderedContainers.end())))
+                             .bind("container"))))),
+      anyOf(varDecl(hasLocalStorage(), unless(parmVarDecl())),
+            fieldDecl(isPrivate(), isExpansionInMainFile())),
+      unless(isInstantiated()));
+  const auto Reference =
+      expr(anyOf(declRefExpr(to(Candidate)), memberExpr(member(Candidate))));
+  const auto LookupMethods = hasAnyName(
+      "at", "clear", "count", "contains", "emplace", "emplace_hint", "empty",
+      "end", "cend", "erase", "find", "insert", "insert_or_assign", "size",
+      "try_emplace");
+
+  Finder->addMatcher(Candidate.bind("candidate"), this);
+  Finder->addMatcher(Reference.bind("reference"), this);
+  Finder->addMatcher(cxxMemberCallExpr(on(Reference.bind("lookup")),
+                                       callee(cxxMethodDecl(LookupMethods))),
+                     this);
+  Finder->addMatcher(
+      cxxOperatorCallExpr(hasOverloadedOperatorName("[]"),
+                          hasArgument(0, ignoringParenImpCasts(
+                                             Reference.bind("lookup")))),
+      this);
+}
+
+void UnnecessaryOrderedContainerCheck::check(
+    const MatchFinder::MatchResult &Result) {
+  if (const auto *Lookup = Result.Nodes.getNodeAs<Expr>("lookup")) {
+    Lookups.insert(Lookup);
+    return;
+  }
+
+  if (const auto *Ref = Result.Nodes.getNodeAs<Expr>("reference")) {
+    const ValueDecl *D = isa<DeclRefExpr>(Ref)
+                             ? cast<DeclRefExpr>(Ref)->getDecl()
+                             : cast<MemberExpr>(Ref)->getMemberDecl();
+    References[D].push_back(Ref);
+    return;
+  }
+
+  const auto *D = Result.Nodes.getNodeAs<ValueDecl>("candidate");
+  const auto *Container =
+      Result.Nodes.getNodeAs<ClassTemplateSpecializationDecl>("container");
+  // The uses in templates may depend on their arguments.
+  if (D->getDeclContext()->isDependentContext())
+    return;
+
+  // Hashed containers compare keys for equality, which is only equivalent to
+  // the default ordering.
+  const TemplateArgumentList &Args = Container->getTemplateArgs();
+  if (Args.size() == 0 || Args[0].getKind() != TemplateArgument::Type ||
+      !isHashable(Args[0].getAsType()))
+    return;
+  bool ComparedWithLess =
+      llvm::any_of(Args.asArray(), [](const TemplateArgument &Arg) {
+        return Arg.getKind() == TemplateArgument::Type &&
+               isStdRecord(Arg.getAsType(), "less");
+      });
+  if (!ComparedWithLess)
+    return;
+
+  for (size_t I = 0; I < OrderedContainers.size() && I < Replacements.size();
+       ++I) {
+    if (!match(namedDecl(hasName(OrderedContainers[I])), *Container,
+               *Result.Context)
+             .empty()) {
+      Candidates[D] = Replacements[I];
+      return;
+    }
+  }
+}
+
+void UnnecessaryOrderedContainerCheck::onEndOfTranslationUnit() {
+  for (const auto &Candidate : Candidates) {
+    auto It = References.find(Candidate.first);
+    if (It == References.end() ||
+        !llvm::all_of(It->second,
+                      [&](const Expr *Ref) { return Lookups.count(Ref); }))
+      continue;
+    diag(Candidate.first->getLocation(),
+         "%0 is only used for lookups; consider using '%1' instead")
+        << Candidate.first << Candidate.second;
+  }
+  Candidates.clear();
+  References.clear();
+  Lookups.clear();
+}
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,59 @@
+//===--- UnnecessaryOrderedContainerCheck.h - clang-tidy --------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_UNNECESSARY_ORDERED_CONTAINER_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_UNNECESSARY_ORDERED_CONTAINER_H
+
+#include "../ClangTidyCheck.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+/// Finds local variables and private fields of ordered associative containers,
+/// like std::map and std::set, that are only used for lookups, and suggests
+/// hashed or flat containers instead.
+///
+/// For the user-facing documentation see:
+/// http://clang.llvm.org/extra/clang-tidy/checks/performance-unnecessary-ordered-container.html
+class UnnecessaryOrderedContainerCheck : public ClangTidyCheck {
+public:
+  UnnecessaryOrderedContainerCheck(StringRef Name, ClangTidyContext *Context);
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus;
+  }
+  void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  const std::vector<std::string> OrderedContainers;
+  const std::vector<std::string> Replacements;
+
+  /// The suggested replacement of each candidate declaration.
+  llvm::MapVector<const ValueDecl *, StringRef> Candidates;
+  /// All the references to each candidate declaration.
+  llvm::DenseMap<const ValueDecl *, llvm::SmallVector<const Expr *, 4>>
+      References;
+  /// The references which are lookups.
+  llvm::DenseSet<const Expr *> Lookups;
+};
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_UNNECESSARY_ORDERED_CONTAINER_H
@@ -0,0 +1,90 @@
+//===--- VirtualCallInLoopCheck.cpp - clang-tidy --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "VirtualCallInLoopCheck.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+
+using namespace clang::ast_matchers;
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+void VirtualCallInLoopCheck::registerMatchers(MatchFinder *Finder) {
+  // Instantiations are definitions too, and may derive from any class.
+  Finder->addMatcher(cxxRecordDecl(isDefinition()).bind("record"), this);
+  Finder->addMatcher(
+      cxxMemberCallExpr(
+          callee(cxxMethodDecl(isVirtual(), unless(isFinal()))),
+          hasAncestor(stmt(anyOf(forStmt(), cxxForRangeStmt(), whileStmt(),
+                                 doStmt()))),
+          unless(isInTemplateInstantiation()))
+          .bind("call"),
+      this);
+}
+
+void VirtualCallInLoopCheck::check(const MatchFinder::MatchResult &Result) {
+  if (const auto *Record = Result.Nodes.getNodeAs<CXXRecordDecl>("record")) {
+    for (const CXXBaseSpecifier &Base : Record->bases())
+      if (const auto *BaseRecord = Base.getType()->getAsCXXRecordDecl())
+        Bases.insert(BaseRecord->getCanonicalDecl());
+    return;
+  }
+
+  const auto *Call = Result.Nodes.getNodeAs<CXXMemberCallExpr>("call");
+  // Qualified calls aren't virtual.
+  const auto *Callee = dyn_cast<MemberExpr>(Call->getCallee()->IgnoreParens());
+  if (!Callee || Callee->hasQualifier())
+    return;
+  const CXXRecordDecl *Record = Call->getRecordDecl();
+  if (!Record || !Record->hasDefinition())
+    return;
+  Record = Record->getDefinition();
+  if (Record->hasAttr<FinalAttr>() || Record->isAbstract() ||
+      Record->getDescribedClassTemplate() ||
+      isa<ClassTemplateSpecializationDecl>(Record))
+    return;
+  // Classes defined in the main file or with internal linkage can only be
+  // derived from in this translation unit.
+  const SourceManager &SM = *Result.SourceManager;
+  if (!SM.isInMainFile(SM.getExpansionLoc(Record->getLocation())) &&
+      !Record->isInAnonymousNamespace())
+    return;
+  Calls[Record->getCanonicalDecl()].push_back(Call);
+}
+
+void VirtualCallInLoopCheck::onEndOfTranslationUnit() {
+  for (const auto &Entry : Calls) {
+    if (Bases.count(Entry.first))
+      continue;
+    const CXXRecordDecl *Record = Entry.first->getDefinition();
+    const LangOptions &LangOpts = Record->getASTContext().getLangOpts();
+    const SourceManager &SM = Record->getASTContext().getSourceManager();
+    {
+      auto Diag = diag(Record->getLocation(),
+                       "%0 has no derived classes and its virtual methods are "
+                       "called in loops; mark it 'final' to let them be "
+                       "devirtualized")
+                  << Record;
+      if (!Record->getLocation().isMacroID())
+        Diag << FixItHint::CreateInsertion(
+            Lexer::getLocForEndOfToken(Record->getLocation(), 0, SM, LangOpts),
+            " final");
+    }
+    for (const CXXMemberCallExpr *Call : Entry.second)
+      diag(Call->getExprLoc(), "virtual call in a loop", DiagnosticIDs::Note);
+  }
+  Bases.clear();
+  Calls.clear();
+}
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,50 @@
+//===--- VirtualCallInLoopCheck.h - clang-tidy ------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_VIRTUAL_CALL_IN_LOOP_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_VIRTUAL_CALL_IN_LOOP_H
+
+#include "../ClangTidyCheck.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
+
+namespace clang {
+namespace tidy {
+namespace performance {
+
+/// \brief Finds classes that can't have derived classes outside of the
+/// translation unit, have none in it, and whose virtual methods are called in
+/// loops: marking them final lets the compiler devirtualize the calls.
+///
+/// For the user-facing documentation see:
+/// http://clang.llvm.org/extra/clang-tidy/checks/performance-virtual-call-in-loop.html
+class VirtualCallInLoopCheck : public ClangTidyCheck {
+public:
+  VirtualCallInLoopCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  static bool isLanguageSupported(const LangOptions &LangOpts) {
+    return LangOpts.CPlusPlus11;
+  }
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override;
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
+  void onEndOfTranslationUnit() override;
+
+private:
+  /// The classes with a derived class in the translation unit.
+  llvm::DenseSet<const CXXRecordDecl *> Bases;
+  /// The virtual calls in loops, by the class of their object.
+  llvm::MapVector<const CXXRecordDecl *,
+                  SmallVector<const CXXMemberCallExpr *, 4>>
+      Calls;
+};
+
+} // namespace performance
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_PERFORMANCE_VIRTUAL_CALL_IN_LOOP_H
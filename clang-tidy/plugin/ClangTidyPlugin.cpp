@@ -7,63 +7,263 @@
 //===----------------------------------------------------------------------===//
 
 #include "../ClangTidy.h"
+#include "../ClangTidyDiagnosticConsumer.h"
 #include "../ClangTidyForceLinker.h"
 #include "../ClangTidyModule.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendPluginRegistry.h"
 #include "clang/Frontend/MultiplexConsumer.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
 
 namespace clang {
 namespace tidy {
 
-/// The core clang tidy plugin action. This just provides the AST consumer and
-/// command line flag parsing for using clang-tidy as a clang plugin.
+/// The core clang tidy plugin action. This provides the AST consumer and
+/// command line flag parsing for using clang-tidy as a clang plugin, so that
+/// the checks run during the compilation instead of parsing the code again.
+///
+/// The arguments are those of clang-tidy with the same names: -checks=,
+/// -warnings-as-errors=, -header-filter=, -system-headers, -config=,
+/// -export-fixes[=<file>], -enable-check-profile and -store-check-profile=.
+/// Without a file, -export-fixes writes the fixes of a translation unit next
+/// to its output file, in <output>.yaml.
 class ClangTidyPluginAction : public PluginASTAction {
-  /// Wrapper to grant the context the same lifetime as the action. We use
+  /// Runs the checks on a translation unit. Diagnostics of the checks go
+  /// through a ClangTidyDiagnosticConsumer first, which applies NOLINT and the
+  /// header and line filters like clang-tidy does. Those that pass are then
+  /// reported by the compiler, as its own warnings.
+  class TidyRun {
+  public:
+    TidyRun(std::unique_ptr<ClangTidyContext> Context,
+            CompilerInstance &Compiler, llvm::Optional<std::string> ExportFixes)
+        : Context(std::move(Context)), Compiler(Compiler),
+          ExportFixes(std::move(ExportFixes)), DiagConsumer(*this->Context),
+          DE(new DiagnosticIDs(), new DiagnosticOptions(), &DiagConsumer,
+             /*ShouldOwnClient=*/false) {
+      this->Context->setDiagnosticsEngine(&DE);
+    }
+
+    ClangTidyContext &getContext() { return *Context; }
+
+    /// Reports the diagnostics of the checks so far to the compiler.
+    void reportErrors() {
+      std::vector<ClangTidyError> Errors = DiagConsumer.take();
+      DiagnosticsEngine &Diags = Compiler.getDiagnostics();
+      for (const ClangTidyError &Error : Errors)
+        reportError(Error, Diags);
+      std::move(Errors.begin(), Errors.end(), std::back_inserter(Reported));
+    }
+
+    /// Reports the diagnostics emitted at the end of the main file, and writes
+    /// the fixes of the translation unit.
+    void finish() {
+      // The compiler's diagnostic client is done with the file by now, it is
+      // only told about these diagnostics if there are any.
+      std::vector<ClangTidyError> Late = DiagConsumer.take();
+      if (!Late.empty()) {
+        DiagnosticConsumer &Client = *Compiler.getDiagnostics().getClient();
+        Client.BeginSourceFile(Compiler.getLangOpts(),
+                               &Compiler.getPreprocessor());
+        for (const ClangTidyError &Error : Late)
+          reportError(Error, Compiler.getDiagnostics());
+        Client.EndSourceFile();
+        std::move(Late.begin(), Late.end(), std::back_inserter(Reported));
+      }
+      if (ExportFixes)
+        exportFixes();
+    }
+
+  private:
+    SourceLocation getLocation(StringRef FilePath, unsigned Offset) {
+      if (FilePath.empty())
+        return SourceLocation();
+      SourceManager &SM = Compiler.getSourceManager();
+      const FileEntry *File = SM.getFileManager().getFile(FilePath);
+      if (!File)
+        return SourceLocation();
+      FileID ID = SM.getOrCreateFileID(File, SrcMgr::C_User);
+      return SM.getLocForStartOfFile(ID).getLocWithOffset(Offset);
+    }
+
+    void reportError(const ClangTidyError &Error, DiagnosticsEngine &Diags) {
+      auto Level = static_cast<DiagnosticsEngine::Level>(Error.DiagLevel);
+      std::string Name = Error.DiagnosticName;
+      if (Error.IsWarningAsError) {
+        Name += ",-warnings-as-errors";
+        Level = DiagnosticsEngine::Error;
+      }
+      {
+        auto Diag = Diags.Report(getLocation(Error.Message.FilePath,
+                                             Error.Message.FileOffset),
+                                 Diags.getCustomDiagID(Level, "%0 [%1]"))
+                    << Error.Message.Message << Name;
+        for (const auto &FileAndReplacements : Error.Fix)
+          for (const auto &Repl : FileAndReplacements.second) {
+            if (!Repl.isApplicable())
+              continue;
+            SourceLocation Begin =
+                getLocation(Repl.getFilePath(), Repl.getOffset());
+            if (Begin.isInvalid())
+              continue;
+            Diag << FixItHint::CreateReplacement(
+                CharSourceRange::getCharRange(
+                    Begin, Begin.getLocWithOffset(Repl.getLength())),
+                Repl.getReplacementText());
+          }
+      }
+      for (const auto &Note : Error.Notes)
+        Diags.Report(getLocation(Note.FilePath, Note.FileOffset),
+                     Diags.getCustomDiagID(DiagnosticsEngine::Note, "%0"))
+            << Note.Message;
+    }
+
+    void exportFixes() {
+      std::string Path = *ExportFixes;
+      if (Path.empty()) {
+        Path = Compiler.getFrontendOpts().OutputFile;
+        if (Path.empty() || Path == "-")
+          Path = Context->getCurrentFile();
+        Path += ".yaml";
+      }
+      std::error_code EC;
+      llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+      if (EC) {
+        DiagnosticsEngine &Diags = Compiler.getDiagnostics();
+        Diags.Report(Diags.getCustomDiagID(
+            DiagnosticsEngine::Error,
+            "clang-tidy can't write the fixes to '%0': %1"))
+            << Path << EC.message();
+        return;
+      }
+      exportReplacements(Context->getCurrentFile(), Reported, OS);
+    }
+
+    std::unique_ptr<ClangTidyContext> Context;
+    CompilerInstance &Compiler;
+    llvm::Optional<std::string> ExportFixes;
+    ClangTidyDiagnosticConsumer DiagConsumer;
+    DiagnosticsEngine DE;
+    /// The errors reported so far, for -export-fixes.
+    std::vector<ClangTidyError> Reported;
+  };
+
+  /// Finishes the run once the checks' callbacks for the end of the main file
+  /// have been called. Registered before the checks' callbacks, it runs after
+  /// them.
+  class FinishCallback : public PPCallbacks {
+  public:
+    FinishCallback(TidyRun &Run) : Run(Run) {}
+    void EndOfMainFile() override { Run.finish(); }
+
+  private:
+    TidyRun &Run;
+  };
+
+  /// Wrapper to grant the run the same lifetime as the checks. We use
   /// MultiplexConsumer to avoid writing out all the forwarding methods.
   class WrapConsumer : public MultiplexConsumer {
-    std::unique_ptr<ClangTidyContext> Context;
+    std::unique_ptr<TidyRun> Run;
 
   public:
-    WrapConsumer(std::unique_ptr<ClangTidyContext> Context,
+    WrapConsumer(std::unique_ptr<TidyRun> Run,
                  std::vector<std::unique_ptr<ASTConsumer>> Consumer)
-        : MultiplexConsumer(std::move(Consumer)), Context(std::move(Context)) {}
+        : MultiplexConsumer(std::move(Consumer)), Run(std::move(Run)) {}
+
+    void HandleTranslationUnit(ASTContext &Ctx) override {
+      MultiplexConsumer::HandleTranslationUnit(Ctx);
+      Run->reportErrors();
+    }
   };
 
 public:
   std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
                                                  StringRef File) override {
-    // Insert the current diagnostics engine.
-    Context->setDiagnosticsEngine(&Compiler.getDiagnostics());
+    auto Run = llvm::make_unique<TidyRun>(std::move(Context), Compiler,
+                                          ExportFixes);
+    Compiler.getPreprocessor().addPPCallbacks(
+        llvm::make_unique<FinishCallback>(*Run));
 
     // Create the AST consumer.
-    ClangTidyASTConsumerFactory Factory(*Context);
+    ClangTidyASTConsumerFactory Factory(Run->getContext());
     std::vector<std::unique_ptr<ASTConsumer>> Vec;
     Vec.push_back(Factory.CreateASTConsumer(Compiler, File));
 
-    return llvm::make_unique<WrapConsumer>(std::move(Context), std::move(Vec));
+    return llvm::make_unique<WrapConsumer>(std::move(Run), std::move(Vec));
   }
 
-  bool ParseArgs(const CompilerInstance &,
+  bool ParseArgs(const CompilerInstance &Compiler,
                  const std::vector<std::string> &Args) override {
+    // The same defaults as clang-tidy.
     ClangTidyGlobalOptions GlobalOptions;
-    ClangTidyOptions DefaultOptions;
+    ClangTidyOptions DefaultOptions = ClangTidyOptions::getDefaults();
+    DefaultOptions.Checks = "clang-diagnostic-*,clang-analyzer-*";
     ClangTidyOptions OverrideOptions;
+    llvm::Optional<std::string> Config;
+    bool EnableCheckProfile = false;
+    std::string StoreCheckProfile;
 
-    // Parse the extra command line args.
-    // FIXME: This is very limited at the moment.
-    for (StringRef Arg : Args)
-      if (Arg.startswith("-checks="))
-        OverrideOptions.Checks = Arg.substr(strlen("-checks="));
+    DiagnosticsEngine &Diags = Compiler.getDiagnostics();
+    for (StringRef Arg : Args) {
+      if (Arg.consume_front("-checks="))
+        OverrideOptions.Checks = Arg;
+      else if (Arg.consume_front("-warnings-as-errors="))
+        OverrideOptions.WarningsAsErrors = Arg;
+      else if (Arg.consume_front("-header-filter="))
+        OverrideOptions.HeaderFilterRegex = Arg;
+      else if (Arg == "-system-headers")
+        OverrideOptions.SystemHeaders = true;
+      else if (Arg.consume_front("-config="))
+        Config = Arg.str();
+      else if (Arg == "-export-fixes")
+        ExportFixes = "";
+      else if (Arg.consume_front("-export-fixes="))
+        ExportFixes = Arg.str();
+      else if (Arg == "-enable-check-profile")
+        EnableCheckProfile = true;
+      else if (Arg.consume_front("-store-check-profile="))
+        StoreCheckProfile = Arg.str();
+      else {
+        Diags.Report(Diags.getCustomDiagID(
+            DiagnosticsEngine::Error,
+            "unknown argument '%0' for the clang-tidy plugin"))
+            << Arg;
+        return false;
+      }
+    }
 
-    auto Options = llvm::make_unique<FileOptionsProvider>(
-        GlobalOptions, DefaultOptions, OverrideOptions);
+    std::unique_ptr<ClangTidyOptionsProvider> Options;
+    if (Config) {
+      llvm::ErrorOr<ClangTidyOptions> ParsedConfig =
+          parseConfiguration(*Config);
+      if (!ParsedConfig) {
+        Diags.Report(Diags.getCustomDiagID(
+            DiagnosticsEngine::Error,
+            "invalid clang-tidy configuration: %0"))
+            << ParsedConfig.getError().message();
+        return false;
+      }
+      Options = llvm::make_unique<ConfigOptionsProvider>(
+          GlobalOptions, DefaultOptions, *ParsedConfig, OverrideOptions);
+    } else {
+      Options = llvm::make_unique<FileOptionsProvider>(
+          GlobalOptions, DefaultOptions, OverrideOptions);
+    }
     Context = llvm::make_unique<ClangTidyContext>(std::move(Options));
+    Context->setEnableProfiling(EnableCheckProfile);
+    if (!StoreCheckProfile.empty()) {
+      SmallString<256> Prefix(StoreCheckProfile);
+      llvm::sys::fs::make_absolute(Prefix);
+      Context->setProfileStoragePrefix(Prefix);
+    }
     return true;
   }
 
 private:
   std::unique_ptr<ClangTidyContext> Context;
+  llvm::Optional<std::string> ExportFixes;
 };
 } // namespace tidy
 } // namespace clang
@@ -10,10 +10,12 @@
 
 #include "../utils/ASTUtils.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Basic/CharInfo.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
 
@@ -247,18 +249,43 @@ void IdentifierNamingCheck::registerPPCallbacks(
                                                           this));
 }
 
+// Whether \p Name is in the case \p Case. Identifiers are ASCII, so scanning
+// them is much cheaper than matching regular expressions.
+static bool matchesCase(StringRef Name, IdentifierNamingCheck::CaseType Case) {
+  if (Name.empty())
+    return Case == IdentifierNamingCheck::CT_AnyCase;
+
+  char First = Name.front();
+  StringRef Rest = Name.drop_front();
+  switch (Case) {
+  case IdentifierNamingCheck::CT_AnyCase:
+    return true;
+  case IdentifierNamingCheck::CT_LowerCase:
+    return isLowercase(First) && llvm::all_of(Rest, [](char C) {
+             return isLowercase(C) || isDigit(C) || C == '_';
+           });
+  case IdentifierNamingCheck::CT_CamelBack:
+    return isLowercase(First) &&
+           llvm::all_of(Rest, [](char C) { return isAlphanumeric(C); });
+  case IdentifierNamingCheck::CT_UpperCase:
+    return isUppercase(First) && llvm::all_of(Rest, [](char C) {
+             return isUppercase(C) || isDigit(C) || C == '_';
+           });
+  case IdentifierNamingCheck::CT_CamelCase:
+    return isUppercase(First) &&
+           llvm::all_of(Rest, [](char C) { return isAlphanumeric(C); });
+  // The patterns of the snake cases used to be unanchored at the end, so that
+  // only their first character was checked. Keep it that way.
+  case IdentifierNamingCheck::CT_CamelSnakeCase:
+    return isUppercase(First);
+  case IdentifierNamingCheck::CT_CamelSnakeBack:
+    return isLowercase(First);
+  }
+  llvm_unreachable("unknown CaseType");
+}
+
 static bool matchesStyle(StringRef Name,
                          IdentifierNamingCheck::NamingStyle Style) {
-  static llvm::Regex Matchers[] = {
-      llvm::Regex("^.*$"),
-      llvm::Regex("^[a-z][a-z0-9_]*$"),
-      llvm::Regex("^[a-z][a-zA-Z0-9]*$"),
-      llvm::Regex("^[A-Z][A-Z0-9_]*$"),
-      llvm::Regex("^[A-Z][a-zA-Z0-9]*$"),
-      llvm::Regex("^[A-Z]([a-z0-9]*(_[A-Z])?)*"),
-      llvm::Regex("^[a-z]([a-z0-9]*(_[A-Z])?)*"),
-  };
-
   bool Matches = true;
   if (Name.startswith(Style.Prefix))
     Name = Name.drop_front(Style.Prefix.size());
@@ -275,7 +302,7 @@ static bool matchesStyle(StringRef Name,
   if (Name.startswith("_") || Name.endswith("_"))
     Matches = false;
 
-  if (Style.Case && !Matchers[static_cast<size_t>(*Style.Case)].match(Name))
+  if (Style.Case && !matchesCase(Name, *Style.Case))
     Matches = false;
 
   return Matches;
@@ -16,10 +16,13 @@
 
 #include "../ClangTidy.h"
 #include "../ClangTidyForceLinker.h"
+#include "../SharedPCH.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
+#include <cstdio>
 
 using namespace clang::ast_matchers;
 using namespace clang::driver;
@@ -107,6 +110,16 @@ JSON array of objects:
                                        cl::init(""),
                                        cl::cat(ClangTidyCategory));
 
+static cl::opt<bool> SkipUnchangedDecls("skip-unchanged-decls", cl::desc(R"(
+Only match the top-level declarations that
+overlap a line range of -line-filter, e.g. the
+changed lines of a diff. Warnings that checks
+report away from the declaration they matched
+may be missed.
+)"),
+                                        cl::init(false),
+                                        cl::cat(ClangTidyCategory));
+
 static cl::opt<bool> Fix("fix", cl::desc(R"(
 Apply suggested fixes. Without -fix-errors
 clang-tidy will bail out if any compilation
@@ -191,6 +204,29 @@ these per-TU profiles are instead stored as JSON.
                                               cl::value_desc("prefix"),
                                               cl::cat(ClangTidyCategory));
 
+static cl::opt<bool> AggregateCheckProfile("aggregate-check-profile",
+                                           cl::desc(R"(
+Enable per-check timing profiles, and print a
+single report of all translation units to stderr,
+with the total and per-TU times of each check.
+Per-TU profiles are still stored if
+-store-check-profile is passed.
+)"),
+                                           cl::init(false),
+                                           cl::cat(ClangTidyCategory));
+
+static cl::opt<bool> ProfileCheckCallbacks("profile-check-callbacks",
+                                           cl::desc(R"(
+Enable per-check timing profiles, and also
+profile the check() callback of each check. The
+time and number of calls of check() are reported
+per set of bound node IDs, which usually tells
+the matchers of a check apart, and the time spent
+matching per check.
+)"),
+                                           cl::init(false),
+                                           cl::cat(ClangTidyCategory));
+
 /// This option allows enabling the experimental alpha checkers from the static
 /// analyzer. This option is set to false and not visible in help, because it is
 /// highly not recommended for users.
@@ -216,6 +252,62 @@ options are specified.
                            cl::init(false),
                            cl::cat(ClangTidyCategory));
 
+static cl::opt<unsigned> Jobs("j", cl::desc(R"(
+Number of translation units to process in
+parallel, in one process. 0 uses all cores.
+The reported diagnostics and fixes are the same
+as with -j=1. Files are processed sequentially
+when -vfsoverlay is used, or profiles are
+printed to stderr. Fixes are applied to this
+many files in parallel.
+)"),
+                              cl::init(1), cl::cat(ClangTidyCategory));
+
+static cl::opt<std::string> ResultCacheDir("result-cache", cl::desc(R"(
+Store the diagnostics of each translation unit
+in this directory, and reuse them while its
+compile command, its options and the files it
+reads are unchanged. Ignored with
+-enable-check-profile.
+)"),
+                                           cl::value_desc("directory"),
+                                           cl::cat(ClangTidyCategory));
+
+static cl::opt<bool> CheckHeadersOnce("check-headers-once", cl::desc(R"(
+Match the declarations of a header that
+-header-filter selects, and check its header
+guard and #include order, only in the first
+translation unit including it. Diagnostics in
+the header that depend on the code of other
+translation units are not reported.
+)"),
+                                      cl::init(false),
+                                      cl::cat(ClangTidyCategory));
+
+static cl::opt<std::string> SharedPCHDir("shared-pch-dir", cl::desc(R"(
+Precompile the #include directives that input
+files with the same flags in the same directory
+start with, into this directory, and parse them
+once per group of files instead of once per
+file. Headers must have include guards or
+'#pragma once'. Compiler warnings in these
+headers are not reported.
+)"),
+                                         cl::value_desc("directory"),
+                                         cl::cat(ClangTidyCategory));
+
+static cl::opt<bool> Serve("serve", cl::desc(R"(
+Keep running, and read the files to check from
+standard input, one per line. The diagnostics of
+each file are printed, followed by the line
+"clang-tidy: done: <file>". The compilation
+database and the .clang-tidy files are loaded
+once for all the files. Needs -p or '--'.
+The exit code is that of checking all of the
+files at once.
+)"),
+                           cl::init(false), cl::cat(ClangTidyCategory));
+
 static cl::opt<std::string> VfsOverlay("vfsoverlay", cl::desc(R"(
 Overlay the virtual filesystem described by file
 over the real file system.
@@ -262,6 +354,7 @@ static std::unique_ptr<ClangTidyOptionsProvider> createOptionsProvider(
     llvm::cl::PrintHelpMessage(/*Hidden=*/false, /*Categorized=*/true);
     return nullptr;
   }
+  GlobalOptions.SkipUnchangedDecls = SkipUnchangedDecls;
 
   ClangTidyOptions DefaultOptions;
   DefaultOptions.Checks = DefaultChecks;
@@ -325,6 +418,61 @@ getVfsFromFile(const std::string &OverlayFile,
   return FS;
 }
 
+static bool readLine(std::FILE *In, std::string &Line) {
+  Line.clear();
+  char Buffer[1024];
+  while (std::fgets(Buffer, sizeof(Buffer), In)) {
+    Line += Buffer;
+    if (Line.back() == '\n')
+      return true;
+  }
+  return !Line.empty();
+}
+
+/// Checks the files read from standard input until it is closed, reusing the
+/// context, its options and the compilation database. Returns the exit code
+/// of a run checking all of the files at once.
+static int serve(ClangTidyContext &Context,
+                 const CompilationDatabase &Compilations,
+                 llvm::IntrusiveRefCntPtr<vfs::OverlayFileSystem> BaseFS,
+                 StringRef ProfilePrefix) {
+  std::string Line;
+  bool FoundAnyErrors = false;
+  unsigned WErrorCount = 0;
+  while (readLine(stdin, Line)) {
+    std::string File = StringRef(Line).trim();
+    if (File.empty())
+      continue;
+    std::vector<ClangTidyError> Errors = runClangTidy(
+        Context, Compilations, File, BaseFS, EnableCheckProfile, ProfilePrefix,
+        /*NumThreads=*/1, ResultCacheDir);
+    bool FoundErrors = llvm::find_if(Errors, [](const ClangTidyError &E) {
+                         return E.DiagLevel == ClangTidyError::Error;
+                       }) != Errors.end();
+    FoundAnyErrors |= FoundErrors;
+    handleErrors(Errors, Context, FixErrors || (Fix && !FoundErrors),
+                 WErrorCount, BaseFS);
+    llvm::outs() << "clang-tidy: done: " << File << "\n";
+    llvm::outs().flush();
+  }
+
+  if (WErrorCount) {
+    if (!Quiet) {
+      StringRef Plural = WErrorCount == 1 ? "" : "s";
+      llvm::errs() << WErrorCount << " warning" << Plural << " treated as error"
+                   << Plural << "\n";
+    }
+    return WErrorCount;
+  }
+  // As when checking the files at once, -fix-errors always returns zero.
+  if (FoundAnyErrors && !FixErrors) {
+    if (!Quiet)
+      llvm::errs() << "Found compiler error(s).\n";
+    return 1;
+  }
+  return 0;
+}
+
 static int clangTidyMain(int argc, const char **argv) {
   llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
   CommonOptionsParser OptionsParser(argc, argv, ClangTidyCategory,
@@ -414,7 +562,7 @@ static int clangTidyMain(int argc, const char **argv) {
     return 1;
   }
 
-  if (PathList.empty()) {
+  if (PathList.empty() && !Serve) {
     llvm::errs() << "Error: no input files specified.\n";
     llvm::cl::PrintHelpMessage(/*Hidden=*/false, /*Categorized=*/true);
     return 1;
@@ -426,9 +574,26 @@ static int clangTidyMain(int argc, const char **argv) {
 
   ClangTidyContext Context(std::move(OwningOptionsProvider),
                            AllowEnablingAnalyzerAlphaCheckers);
-  std::vector<ClangTidyError> Errors =
-      runClangTidy(Context, OptionsParser.getCompilations(), PathList, BaseFS,
-                   EnableCheckProfile, ProfilePrefix);
+  const CompilationDatabase *Compilations = &OptionsParser.getCompilations();
+  if (Serve)
+    return serve(Context, *Compilations, BaseFS, ProfilePrefix);
+  std::unique_ptr<SharedPCHDatabase> SharedPCHCompilations;
+  if (!SharedPCHDir.empty()) {
+    SharedPCHCompilations = llvm::make_unique<SharedPCHDatabase>(
+        *Compilations, PathList, SharedPCHDir, BaseFS);
+    Compilations = SharedPCHCompilations.get();
+  }
+  ProfileAggregator Aggregator;
+  if (AggregateCheckProfile)
+    Context.setProfileAggregator(&Aggregator);
+  Context.setProfileCallbacks(ProfileCheckCallbacks);
+  unsigned NumThreads = Jobs ? unsigned(Jobs) : llvm::hardware_concurrency();
+  std::vector<ClangTidyError> Errors = runClangTidy(
+      Context, *Compilations, PathList, BaseFS,
+      EnableCheckProfile || AggregateCheckProfile || ProfileCheckCallbacks,
+      ProfilePrefix, NumThreads, ResultCacheDir, CheckHeadersOnce);
+  if (AggregateCheckProfile)
+    Aggregator.print(llvm::errs());
   bool FoundErrors = llvm::find_if(Errors, [](const ClangTidyError &E) {
                        return E.DiagLevel == ClangTidyError::Error;
                      }) != Errors.end();
@@ -439,7 +604,7 @@ static int clangTidyMain(int argc, const char **argv) {
 
   // -fix-errors implies -fix.
   handleErrors(Errors, Context, (FixErrors || Fix) && !DisableFixes, WErrorCount,
-               BaseFS);
+               BaseFS, NumThreads);
 
   if (!ExportFixes.empty() && !Errors.empty()) {
     std::error_code EC;
@@ -157,6 +157,9 @@ def main():
                       'command line.')
   parser.add_argument('-quiet', action='store_true', default=False,
                       help='Run clang-tidy in quiet mode')
+  parser.add_argument('-skip-unchanged-decls', action='store_true',
+                      default=False,
+                      help='Only match the declarations with changed lines')
   clang_tidy_args = []
   argv = sys.argv[1:]
   if '--' in argv:
@@ -237,6 +240,8 @@ def main():
     # Run clang-tidy on files containing changes.
     command = [args.clang_tidy_binary]
     command.append('-line-filter=' + line_filter_json)
+    if args.skip_unchanged_decls:
+      command.append('-skip-unchanged-decls')
     if yaml and args.export_fixes:
       # Get a temporary file. We immediately close the handle so clang-tidy can
       # overwrite it.
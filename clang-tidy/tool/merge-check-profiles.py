@@ -0,0 +1,140 @@
+#!/usr/bin/env python
+#
+#===- merge-check-profiles.py - Merge clang-tidy profiles ----*- python -*--===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+
+"""
+clang-tidy profile merger
+=========================
+
+Merges the per-TU JSON profiles written by clang-tidy -enable-check-profile
+-store-check-profile=<prefix> into a single report, in the format of
+clang-tidy -aggregate-check-profile.
+
+Example invocations.
+- Merge all the profiles stored in a directory:
+    merge-check-profiles.py /tmp/profiles
+
+- Merge some profiles, and print the report as JSON:
+    merge-check-profiles.py -json /tmp/profiles/*-foo.cpp.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import glob
+import json
+import os
+import sys
+
+PREFIX = 'time.clang-tidy.'
+KINDS = ('wall', 'user', 'sys')
+
+
+def find_profiles(paths):
+  """Yields the JSON files among paths, and those in the directories."""
+  for path in paths:
+    if os.path.isdir(path):
+      for profile in sorted(glob.glob(os.path.join(path, '*.json'))):
+        yield profile
+    else:
+      yield path
+
+
+def read_profile(path):
+  """Returns the source file of a profile and its times by check and kind."""
+  with open(path) as f:
+    data = json.load(f)
+  times = {}
+  for key, value in data.get('profile', {}).items():
+    if not key.startswith(PREFIX):
+      continue
+    # Check names may contain dots, e.g. clang-analyzer-core.NullDereference.
+    check, _, kind = key[len(PREFIX):].rpartition('.')
+    if kind in KINDS:
+      times.setdefault(check, {})[kind] = value
+  return data.get('file', path), times
+
+
+def percentile(sorted_values, percent):
+  """Returns the nearest-rank percentile of sorted values."""
+  rank = (len(sorted_values) * percent + 99) // 100
+  return sorted_values[max(rank, 1) - 1]
+
+
+def aggregate(profiles):
+  checks = {}
+  for source, times in profiles:
+    for check, kinds in times.items():
+      entry = checks.setdefault(check, {'wall': 0.0, 'user': 0.0, 'sys': 0.0,
+                                        'walls': [], 'slowest': None})
+      wall = kinds.get('wall', 0.0)
+      if entry['slowest'] is None or wall > max(entry['walls']):
+        entry['slowest'] = source
+      for kind in KINDS:
+        entry[kind] += kinds.get(kind, 0.0)
+      entry['walls'].append(wall)
+
+  result = []
+  for check, entry in checks.items():
+    walls = sorted(entry['walls'])
+    result.append({'name': check, 'wall': entry['wall'],
+                   'user': entry['user'], 'sys': entry['sys'],
+                   'median': percentile(walls, 50),
+                   'p90': percentile(walls, 90), 'max': walls[-1],
+                   'files': len(walls), 'slowest': entry['slowest']})
+  result.sort(key=lambda check: (-check['wall'], check['name']))
+  return result
+
+
+def print_table(checks, num_files):
+  total_wall = sum(check['wall'] for check in checks)
+  title = 'clang-tidy checks profile of %d translation units' % num_files
+  print('===' + '-' * 73 + '===')
+  print(' ' * ((80 - len(title)) // 2) + title)
+  print('===' + '-' * 73 + '===')
+  print('  Total Wall Time: %.4f seconds' % total_wall)
+  print()
+  print('   ---Wall Time---   --User--   --Sys---  -Median-   ---90%--  '
+        '--Max---  TUs  --- Name ---')
+  for check in checks:
+    share = 100 * check['wall'] / total_wall if total_wall else 0.0
+    print('  %8.4f (%5.1f%%)  %8.4f  %8.4f  %8.4f   %8.4f  %8.4f  %3u  '
+          '%s (slowest: %s)' %
+          (check['wall'], share, check['user'], check['sys'], check['median'],
+           check['p90'], check['max'], check['files'], check['name'],
+           check['slowest']))
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Merges the per-TU profiles '
+                                   'stored by clang-tidy into a single report.')
+  parser.add_argument('paths', nargs='+', metavar='path',
+                      help='JSON profiles, or directories containing them')
+  parser.add_argument('-json', action='store_true',
+                      help='print the report as JSON instead of a table')
+  args = parser.parse_args()
+
+  profiles = []
+  for path in find_profiles(args.paths):
+    try:
+      profiles.append(read_profile(path))
+    except (IOError, ValueError) as e:
+      print('Skipping %s: %s' % (path, e), file=sys.stderr)
+  checks = aggregate(profiles)
+
+  if args.json:
+    json.dump({'files': len(profiles), 'checks': checks}, sys.stdout,
+              indent=2, sort_keys=True)
+    print()
+  else:
+    print_table(checks, len(profiles))
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,35 @@
+//===--- CFGCache.cpp - clang-tidy ----------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "CFGCache.h"
+
+namespace clang {
+namespace tidy {
+namespace utils {
+
+const CFGCache::Entry *CFGCache::get(Stmt *Body, ASTContext *Context) {
+  auto Inserted = Entries.try_emplace(Body, nullptr);
+  std::unique_ptr<Entry> &Result = Inserted.first->second;
+  // Bodies whose CFG can't be built keep a null entry.
+  if (!Inserted.second)
+    return Result.get();
+
+  std::unique_ptr<CFG> TheCFG = CFG::buildCFG(nullptr, Body, Context, Options);
+  if (!TheCFG)
+    return nullptr;
+  Result = llvm::make_unique<Entry>();
+  Result->Sequence =
+      llvm::make_unique<ExprSequence>(TheCFG.get(), Body, Context);
+  Result->BlockMap = llvm::make_unique<StmtToBlockMap>(TheCFG.get(), Context);
+  Result->TheCFG = std::move(TheCFG);
+  return Result.get();
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace clang
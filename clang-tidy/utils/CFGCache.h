@@ -0,0 +1,53 @@
+//===--- CFGCache.h - clang-tidy --------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_UTILS_CFGCACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_UTILS_CFGCACHE_H
+
+#include "ExprSequence.h"
+#include "clang/Analysis/CFG.h"
+#include "llvm/ADT/DenseMap.h"
+#include <memory>
+
+namespace clang {
+namespace tidy {
+namespace utils {
+
+/// Builds the CFGs of function bodies, with their `ExprSequence` and
+/// `StmtToBlockMap`, once per body.
+///
+/// Checks analyzing several statements of a function, e.g. each
+/// `std::move()` call in it, would otherwise build the same CFG for each of
+/// them. A cache must not outlive the AST; a check can own one, as checks are
+/// created per translation unit.
+class CFGCache {
+public:
+  /// The analyses of a function body.
+  struct Entry {
+    std::unique_ptr<CFG> TheCFG;
+    std::unique_ptr<ExprSequence> Sequence;
+    std::unique_ptr<StmtToBlockMap> BlockMap;
+  };
+
+  /// CFGs are built for bodies with \p Options.
+  CFGCache(const CFG::BuildOptions &Options) : Options(Options) {}
+
+  /// Returns the analyses of \p Body, built on the first call, or null if its
+  /// CFG can't be built. The results stay valid as long as the cache.
+  const Entry *get(Stmt *Body, ASTContext *Context);
+
+private:
+  CFG::BuildOptions Options;
+  llvm::DenseMap<const Stmt *, std::unique_ptr<Entry>> Entries;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_UTILS_CFGCACHE_H
@@ -7,11 +7,144 @@
 //===----------------------------------------------------------------------===//
 
 #include "ExceptionAnalyzer.h"
+#include "clang/AST/ODRHash.h"
+#include "clang/Index/USRGeneration.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include <mutex>
 
 namespace clang {
 namespace tidy {
 namespace utils {
 
+namespace {
+
+// The functions defined in headers that were found not to throw, shared by
+// all the analyzers of the process: the same header functions are analyzed
+// in every translation unit.
+//
+// Only results without exception types nor unknown callees are kept. These
+// don't refer to the AST and don't depend on the order of the translation
+// units, while unknown callees may be defined, and throw, in the next one.
+// Each summary holds the keys of the functions called directly, as whether a
+// function throws depends on their definitions in the translation unit, see
+// hasNonThrowingSummary().
+class NonThrowingSummaries {
+public:
+  bool matches(llvm::StringRef Key,
+               const std::vector<std::string> &CalleeKeys) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = Summaries.find(Key);
+    return It != Summaries.end() && It->second == CalleeKeys;
+  }
+
+  void insert(llvm::StringRef Key, std::vector<std::string> CalleeKeys) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Summaries[Key] = std::move(CalleeKeys);
+  }
+
+private:
+  std::mutex Mu;
+  llvm::StringMap<std::vector<std::string>> Summaries;
+};
+
+NonThrowingSummaries &getSummaries() {
+  static NonThrowingSummaries Summaries;
+  return Summaries;
+}
+
+// Adds the functions called directly from \p St to \p Callees.
+void collectCallees(const Stmt *St,
+                    llvm::SmallVectorImpl<const FunctionDecl *> &Callees) {
+  if (!St)
+    return;
+  if (const auto *Call = dyn_cast<CallExpr>(St))
+    if (const FunctionDecl *Callee = Call->getDirectCallee())
+      Callees.push_back(Callee);
+  for (const Stmt *Child : St->children())
+    collectCallees(Child, Callees);
+}
+
+} // namespace
+
+// Identifies the definition \p Func across translation units by its USR and
+// the ODR hash of its body, which differs if macros or preprocessor
+// conditionals changed it. Functions of the main file aren't shared.
+llvm::Optional<std::string>
+ExceptionAnalyzer::getSummaryKey(const FunctionDecl *Func) {
+  auto It = SummaryKeys.find(Func);
+  if (It != SummaryKeys.end())
+    return It->second;
+  llvm::Optional<std::string> &Key = SummaryKeys[Func];
+  const SourceManager &SM = Func->getASTContext().getSourceManager();
+  SourceLocation Loc = SM.getExpansionLoc(Func->getLocation());
+  if (Loc.isInvalid() || SM.isInMainFile(Loc))
+    return Key;
+  llvm::SmallString<128> USR;
+  if (index::generateUSRForDecl(Func, USR))
+    return Key;
+  ODRHash Hash;
+  Hash.AddFunctionDecl(Func);
+  USR += '#';
+  USR += llvm::utohexstr(Hash.CalculateHash());
+  Key = USR.str().str();
+  return Key;
+}
+
+llvm::Optional<std::vector<std::string>> ExceptionAnalyzer::getCalleeKeys(
+    const FunctionDecl *Func,
+    llvm::SmallVectorImpl<const FunctionDecl *> &Definitions) {
+  llvm::SmallVector<const FunctionDecl *, 8> Callees;
+  collectCallees(Func->getBody(), Callees);
+  std::vector<std::string> Keys;
+  for (const FunctionDecl *Callee : Callees) {
+    // Callees without a definition make the result unknown, it isn't shared.
+    const FunctionDecl *Definition = nullptr;
+    if (!Callee->getBody(Definition))
+      return llvm::None;
+    llvm::Optional<std::string> Key = getSummaryKey(Definition);
+    if (!Key)
+      return llvm::None;
+    Keys.push_back(std::move(*Key));
+    Definitions.push_back(Definition);
+  }
+  llvm::sort(Keys);
+  Keys.erase(std::unique(Keys.begin(), Keys.end()), Keys.end());
+  return Keys;
+}
+
+// A summary found for the same definition applies if the functions it calls
+// are the same definitions, and have summaries that apply too. Each
+// definition is hashed once per analyzer, whichever function the analysis
+// started from.
+bool ExceptionAnalyzer::hasNonThrowingSummary(const FunctionDecl *Func) {
+  auto It = SummaryHits.find(Func);
+  if (It != SummaryHits.end())
+    return It->second;
+  llvm::SmallVector<const FunctionDecl *, 8> Callees;
+  llvm::Optional<std::string> Key = getSummaryKey(Func);
+  llvm::Optional<std::vector<std::string>> CalleeKeys;
+  if (Key)
+    CalleeKeys = getCalleeKeys(Func, Callees);
+  if (!CalleeKeys || !getSummaries().matches(*Key, *CalleeKeys))
+    return SummaryHits[Func] = false;
+
+  // Like in throwsException(), recursive calls are assumed not to throw. The
+  // results that relied on this are dropped if Func has no summary after all.
+  size_t FirstHit = SummaryHitOrder.size();
+  SummaryHits[Func] = true;
+  SummaryHitOrder.push_back(Func);
+  for (const FunctionDecl *Callee : Callees) {
+    if (hasNonThrowingSummary(Callee))
+      continue;
+    for (size_t I = FirstHit; I < SummaryHitOrder.size(); ++I)
+      SummaryHits.erase(SummaryHitOrder[I]);
+    SummaryHitOrder.resize(FirstHit);
+    return SummaryHits[Func] = false;
+  }
+  return true;
+}
+
 void ExceptionAnalyzer::ExceptionInfo::registerException(
     const Type *ExceptionType) {
   assert(ExceptionType != nullptr && "Only valid types are accepted");
@@ -112,14 +245,31 @@ void ExceptionAnalyzer::ExceptionInfo::reevaluateBehaviour() {
 ExceptionAnalyzer::ExceptionInfo ExceptionAnalyzer::throwsException(
     const FunctionDecl *Func,
     llvm::SmallSet<const FunctionDecl *, 32> &CallStack) {
-  if (CallStack.count(Func))
+  if (CallStack.count(Func)) {
+    AssumedNonThrowing = true;
     return ExceptionInfo::createNonThrowing();
+  }
 
-  if (const Stmt *Body = Func->getBody()) {
+  const FunctionDecl *Definition = nullptr;
+  if (const Stmt *Body = Func->getBody(Definition)) {
+    if (hasNonThrowingSummary(Definition))
+      return ExceptionInfo(State::NotThrowing);
+    // Results that assumed a recursive call doesn't throw aren't shared: that
+    // call may still turn out to throw.
+    bool AssumedByCaller = AssumedNonThrowing;
+    AssumedNonThrowing = false;
     CallStack.insert(Func);
     ExceptionInfo Result =
         throwsException(Body, ExceptionInfo::Throwables(), CallStack);
     CallStack.erase(Func);
+    if (!AssumedNonThrowing && Result.getExceptionTypes().empty() &&
+        !Result.containsUnknownElements()) {
+      llvm::SmallVector<const FunctionDecl *, 8> Callees;
+      if (llvm::Optional<std::string> Key = getSummaryKey(Definition))
+        if (auto CalleeKeys = getCalleeKeys(Definition, Callees))
+          getSummaries().insert(*Key, std::move(*CalleeKeys));
+    }
+    AssumedNonThrowing |= AssumedByCaller;
     return Result;
   }
 
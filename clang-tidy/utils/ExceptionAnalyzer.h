@@ -11,6 +11,7 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/StringSet.h"
 
@@ -144,9 +145,26 @@ private:
 
   template <typename T> ExceptionInfo analyzeDispatch(const T *Node);
 
+  /// Identifies the summary of \p Func, a definition, shared with the
+  /// analyzers of other translation units. None if it isn't shared.
+  llvm::Optional<std::string> getSummaryKey(const FunctionDecl *Func);
+  /// The sorted summary keys of the functions \p Func calls directly, whose
+  /// definitions are added to \p Definitions. None if one isn't shared.
+  llvm::Optional<std::vector<std::string>>
+  getCalleeKeys(const FunctionDecl *Func,
+                llvm::SmallVectorImpl<const FunctionDecl *> &Definitions);
+  /// Whether the summaries shared across translation units show that \p Func,
+  /// a definition, doesn't throw.
+  bool hasNonThrowingSummary(const FunctionDecl *Func);
+
   bool IgnoreBadAlloc = true;
   llvm::StringSet<> IgnoredExceptions;
   std::map<const FunctionDecl *, ExceptionInfo> FunctionCache;
+  std::map<const FunctionDecl *, llvm::Optional<std::string>> SummaryKeys;
+  std::map<const FunctionDecl *, bool> SummaryHits;
+  std::vector<const FunctionDecl *> SummaryHitOrder;
+  /// Set when a recursive call was assumed not to throw.
+  bool AssumedNonThrowing = false;
 };
 
 } // namespace utils
@@ -37,7 +37,10 @@ public:
     // guards.
     SourceManager &SM = PP->getSourceManager();
     if (Reason == EnterFile && FileType == SrcMgr::C_User) {
-      if (const FileEntry *FE = SM.getFileEntryForID(SM.getFileID(Loc))) {
+      FileID FID = SM.getFileID(Loc);
+      if (Check->isHeaderClaimedByOthers(FID))
+        return;
+      if (const FileEntry *FE = SM.getFileEntryForID(FID)) {
         std::string FileName = cleanPath(FE->getName());
         Files[FileName] = FE;
       }
@@ -79,8 +82,12 @@ public:
       if (!MI->isUsedForHeaderGuard())
         continue;
 
-      const FileEntry *FE =
-          SM.getFileEntryForID(SM.getFileID(MI->getDefinitionLoc()));
+      // Headers checked by another translation unit of the run are skipped,
+      // their guard doesn't depend on the including file.
+      FileID FID = SM.getFileID(MI->getDefinitionLoc());
+      if (Check->isHeaderClaimedByOthers(FID))
+        continue;
+      const FileEntry *FE = SM.getFileEntryForID(FID);
       std::string FileName = cleanPath(FE->getName());
       Files.erase(FileName);
 
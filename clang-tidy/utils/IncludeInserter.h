@@ -9,6 +9,7 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_INCLUDEINSERTER_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_INCLUDEINSERTER_H
 
+#include "../IncludeDirectives.h"
 #include "IncludeSorter.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/LangOptions.h"
@@ -34,7 +35,8 @@ namespace utils {
 ///   void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
 ///                            Preprocessor *ModuleExpanderPP) override {
 ///     Inserter = llvm::make_unique<IncludeInserter>(
-///         SM, getLangOpts(), utils::IncludeSorter::IS_Google);
+///         SM, getLangOpts(), utils::IncludeSorter::IS_Google,
+///         &getIncludeDirectives());
 ///     PP->addPPCallbacks(Inserter->CreatePPCallbacks());
 ///   }
 ///
@@ -53,13 +55,21 @@ namespace utils {
 ///   std::unique_ptr<clang::tidy::utils::IncludeInserter> Inserter;
 /// };
 /// \endcode
+///
+/// The include directives are recorded by \p Directives, which checks share
+/// so that they are recorded once per translation unit; without it, the
+/// inserter records its own. The directives of a file are only sorted when an
+/// include is inserted into it.
 class IncludeInserter {
 public:
   IncludeInserter(const SourceManager &SourceMgr, const LangOptions &LangOpts,
-                  IncludeSorter::IncludeStyle Style);
+                  IncludeSorter::IncludeStyle Style,
+                  IncludeDirectives *Directives = nullptr);
   ~IncludeInserter();
 
   /// Create ``PPCallbacks`` for registration with the compiler's preprocessor.
+  /// These do nothing if another inserter already records the shared
+  /// directives.
   std::unique_ptr<PPCallbacks> CreatePPCallbacks();
 
   /// Creates a \p Header inclusion directive fixit. Returns ``llvm::None`` on
@@ -68,15 +78,13 @@ public:
   CreateIncludeInsertion(FileID FileID, llvm::StringRef Header, bool IsAngled);
 
 private:
-  void AddInclude(StringRef FileName, bool IsAngled,
-                  SourceLocation HashLocation, SourceLocation EndLocation);
-
+  IncludeDirectives OwnDirectives;
+  IncludeDirectives &Directives;
   llvm::DenseMap<FileID, std::unique_ptr<IncludeSorter>> IncludeSorterByFile;
   llvm::DenseMap<FileID, std::set<std::string>> InsertedHeaders;
   const SourceManager &SourceMgr;
   const LangOptions &LangOpts;
   const IncludeSorter::IncludeStyle Style;
-  friend class IncludeInserterCallback;
 };
 
 } // namespace utils
@@ -0,0 +1,37 @@
+//===--- ParameterUtils.h - clang-tidy --------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_UTILS_PARAMETERUTILS_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_UTILS_PARAMETERUTILS_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include <string>
+
+namespace clang {
+namespace tidy {
+namespace utils {
+
+/// Returns the quoted \p Name of a parameter to use in a diagnostic, or
+/// '#N' for the unnamed parameter at \p Index.
+std::string paramNameOrIndex(StringRef Name, size_t Index);
+
+/// Returns true if \p Function is referenced other than by calling it, e.g.
+/// its address is taken. Changing its signature could then break the build.
+bool isReferencedOutsideOfCallExpr(const FunctionDecl &Function,
+                                   ASTContext &Context);
+
+/// Returns true if \p Function is an explicit specialization of a function
+/// template or of a member of a class template.
+bool isExplicitTemplateSpecialization(const FunctionDecl &Function);
+
+} // namespace utils
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_UTILS_PARAMETERUTILS_H
@@ -48,6 +48,18 @@ llvm::Optional<bool> isExpensiveToCopy(QualType Type,
          !Type->isObjCLifetimeType();
 }
 
+bool isCheapToCopy(QualType Type, const ASTContext &Context,
+                   uint64_t MaxSize) {
+  if (Type->isDependentType() || Type->isIncompleteType() ||
+      Type->isArrayType() || Type->isFunctionType() ||
+      Type.isVolatileQualified())
+    return false;
+  if (!Type.isTriviallyCopyableType(Context) || hasDeletedCopyConstructor(Type))
+    return false;
+  return static_cast<uint64_t>(
+             Context.getTypeSizeInChars(Type).getQuantity()) <= MaxSize;
+}
+
 bool recordIsTriviallyDefaultConstructible(const RecordDecl &RecordDecl,
                                            const ASTContext &Context) {
   const auto *ClassDecl = dyn_cast<CXXRecordDecl>(&RecordDecl);
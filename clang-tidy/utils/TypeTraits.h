@@ -21,6 +21,11 @@ namespace type_traits {
 llvm::Optional<bool> isExpensiveToCopy(QualType Type,
                                        const ASTContext &Context);
 
+/// Returns `true` if `Type` can be passed by value, and is trivially copyable
+/// and at most `MaxSize` bytes large, so that copying it costs no more than
+/// passing its address.
+bool isCheapToCopy(QualType Type, const ASTContext &Context, uint64_t MaxSize);
+
 /// Returns `true` if `Type` is trivially default constructible.
 bool isTriviallyDefaultConstructible(QualType Type, const ASTContext &Context);
 
@@ -24,6 +24,10 @@
 namespace clang {
 namespace clangd {
 namespace {
+// Time from receiving an LSP call to sending the reply.
+constexpr trace::Metric LSPLatency("lsp_latency", trace::Metric::Distribution,
+                                   "method_name");
+
 class IgnoreCompletionError : public llvm::ErrorInfo<CancelledError> {
 public:
   void log(llvm::raw_ostream &OS) const override {
@@ -215,29 +219,62 @@ private:
       }
     }
 
+    // Results that have a writeJSON() overload are serialized directly,
+    // without building a json::Value.
+    template <typename T>
+    auto operator()(llvm::Expected<T> Reply)
+        -> decltype(writeJSON(std::declval<llvm::raw_ostream &>(), *Reply)) {
+      // Traces record the reply as a json::Value anyway.
+      if (!Reply || TraceArgs)
+        return (*this)(llvm::Expected<llvm::json::Value>(std::move(Reply)));
+      std::string Serialized;
+      llvm::raw_string_ostream OS(Serialized);
+      writeJSON(OS, *Reply);
+      OS.flush();
+      auto Duration = markReplied();
+      if (!Duration)
+        return;
+      log("--> reply:{0}({1}) {2:ms}", Method, ID, *Duration);
+      std::lock_guard<std::mutex> Lock(Server->TranspWriter);
+      Server->Transp.replyRaw(std::move(ID), Serialized);
+    }
+
     void operator()(llvm::Expected<llvm::json::Value> Reply) {
-      assert(Server && "moved-from!");
-      if (Replied.exchange(true)) {
-        elog("Replied twice to message {0}({1})", Method, ID);
-        assert(false && "must reply to each call only once!");
+      auto Duration = markReplied();
+      if (!Duration)
         return;
-      }
-      auto Duration = std::chrono::steady_clock::now() - Start;
       if (Reply) {
-        log("--> reply:{0}({1}) {2:ms}", Method, ID, Duration);
+        log("--> reply:{0}({1}) {2:ms}", Method, ID, *Duration);
         if (TraceArgs)
           (*TraceArgs)["Reply"] = *Reply;
         std::lock_guard<std::mutex> Lock(Server->TranspWriter);
         Server->Transp.reply(std::move(ID), std::move(Reply));
       } else {
         llvm::Error Err = Reply.takeError();
-        log("--> reply:{0}({1}) {2:ms}, error: {3}", Method, ID, Duration, Err);
+        log("--> reply:{0}({1}) {2:ms}, error: {3}", Method, ID, *Duration,
+            Err);
         if (TraceArgs)
           (*TraceArgs)["Error"] = llvm::to_string(Err);
         std::lock_guard<std::mutex> Lock(Server->TranspWriter);
         Server->Transp.reply(std::move(ID), std::move(Err));
       }
     }
+
+  private:
+    // Records the reply's latency, and returns it. Returns None if there was
+    // already a reply, which must not be sent.
+    llvm::Optional<std::chrono::steady_clock::duration> markReplied() {
+      assert(Server && "moved-from!");
+      if (Replied.exchange(true)) {
+        elog("Replied twice to message {0}({1})", Method, ID);
+        assert(false && "must reply to each call only once!");
+        return llvm::None;
+      }
+      auto Duration = std::chrono::steady_clock::now() - Start;
+      LSPLatency.record(
+          std::chrono::duration<double, std::milli>(Duration).count(), Method);
+      return Duration;
+    }
   };
 
   llvm::StringMap<std::function<void(llvm::json::Value)>> Notifications;
@@ -311,6 +348,13 @@ void ClangdLSPServer::notify(llvm::StringRef Method, llvm::json::Value Params) {
   Transp.notify(Method, std::move(Params));
 }
 
+void ClangdLSPServer::notifyRaw(llvm::StringRef Method,
+                                llvm::StringRef Params) {
+  log("--> {0}", Method);
+  std::lock_guard<std::mutex> Lock(TranspWriter);
+  Transp.notifyRaw(Method, Params);
+}
+
 void ClangdLSPServer::onInitialize(const InitializeParams &Params,
                                    Callback<llvm::json::Value> Reply) {
   // Determine character encoding first as it affects constructed ClangdServer.
@@ -407,6 +451,15 @@ void ClangdLSPServer::onShutdown(const ShutdownParams &Params,
   Reply(nullptr);
 }
 
+// $/memoryUsage is a clangd extension: it reports where memory is used.
+void ClangdLSPServer::onMemoryUsage(const NoParams &Params,
+                                    Callback<MemoryTree> Reply) {
+  MemoryTree MT;
+  Server->profile(MT.child("clangd_server"));
+  MT.child("drafts").addUsage(DraftMgr.getUsedBytes());
+  Reply(std::move(MT));
+}
+
 // sync is a clangd extension: it blocks until all background work completes.
 // It blocks the calling thread, so no messages are processed until it returns!
 void ClangdLSPServer::onSync(const NoParams &Params,
@@ -451,7 +504,20 @@ void ClangdLSPServer::onDocumentDidChange(
   Server->addDocument(File, *Contents, WantDiags);
 }
 
+void ClangdLSPServer::onDocumentDidChangeVisibleRange(
+    const DidChangeVisibleRangeParams &Params) {
+  Server->setVisibleRange(Params.textDocument.uri.file(), Params.range);
+}
+
 void ClangdLSPServer::onFileEvent(const DidChangeWatchedFilesParams &Params) {
+  if (BaseCDB) {
+    std::vector<std::string> Files;
+    for (const FileEvent &Event : Params.changes)
+      Files.push_back(Event.uri.file().str());
+    // The opened files may have new compile commands.
+    if (BaseCDB->filesChanged(Files))
+      reparseOpenedFiles();
+  }
   Server->onFileEvent(Params);
 }
 
@@ -877,12 +943,15 @@ void ClangdLSPServer::applyConfiguration(
 
 void ClangdLSPServer::publishDiagnostics(
     const URIForFile &File, std::vector<clangd::Diagnostic> Diagnostics) {
-  // Publish diagnostics.
-  notify("textDocument/publishDiagnostics",
-         llvm::json::Object{
-             {"uri", File},
-             {"diagnostics", std::move(Diagnostics)},
-         });
+  PublishDiagnosticsParams Params;
+  Params.uri = File;
+  Params.diagnostics = std::move(Diagnostics);
+  // Serialize outside the transport lock.
+  std::string Serialized;
+  llvm::raw_string_ostream OS(Serialized);
+  writeJSON(OS, Params);
+  OS.flush();
+  notifyRaw("textDocument/publishDiagnostics", Serialized);
 }
 
 // FIXME: This function needs to be properly tested.
@@ -920,6 +989,7 @@ ClangdLSPServer::ClangdLSPServer(
   MsgHandler->bind("initialize", &ClangdLSPServer::onInitialize);
   MsgHandler->bind("shutdown", &ClangdLSPServer::onShutdown);
   MsgHandler->bind("sync", &ClangdLSPServer::onSync);
+  MsgHandler->bind("$/memoryUsage", &ClangdLSPServer::onMemoryUsage);
   MsgHandler->bind("textDocument/rangeFormatting", &ClangdLSPServer::onDocumentRangeFormatting);
   MsgHandler->bind("textDocument/onTypeFormatting", &ClangdLSPServer::onDocumentOnTypeFormatting);
   MsgHandler->bind("textDocument/formatting", &ClangdLSPServer::onDocumentFormatting);
@@ -939,6 +1009,7 @@ ClangdLSPServer::ClangdLSPServer(
   MsgHandler->bind("textDocument/didOpen", &ClangdLSPServer::onDocumentDidOpen);
   MsgHandler->bind("textDocument/didClose", &ClangdLSPServer::onDocumentDidClose);
   MsgHandler->bind("textDocument/didChange", &ClangdLSPServer::onDocumentDidChange);
+  MsgHandler->bind("textDocument/didChangeVisibleRange", &ClangdLSPServer::onDocumentDidChangeVisibleRange);
   MsgHandler->bind("workspace/didChangeWatchedFiles", &ClangdLSPServer::onFileEvent);
   MsgHandler->bind("workspace/didChangeConfiguration", &ClangdLSPServer::onChangeConfiguration);
   MsgHandler->bind("textDocument/symbolInfo", &ClangdLSPServer::onSymbolInfo);
@@ -60,9 +60,11 @@ private:
   void onInitialize(const InitializeParams &, Callback<llvm::json::Value>);
   void onShutdown(const ShutdownParams &, Callback<std::nullptr_t>);
   void onSync(const NoParams &, Callback<std::nullptr_t>);
+  void onMemoryUsage(const NoParams &, Callback<MemoryTree>);
   void onDocumentDidOpen(const DidOpenTextDocumentParams &);
   void onDocumentDidChange(const DidChangeTextDocumentParams &);
   void onDocumentDidClose(const DidCloseTextDocumentParams &);
+  void onDocumentDidChangeVisibleRange(const DidChangeVisibleRangeParams &);
   void onDocumentOnTypeFormatting(const DocumentOnTypeFormattingParams &,
                                   Callback<std::vector<TextEdit>>);
   void onDocumentRangeFormatting(const DocumentRangeFormattingParams &,
@@ -137,6 +139,8 @@ private:
   std::mutex TranspWriter;
   void call(StringRef Method, llvm::json::Value Params);
   void notify(StringRef Method, llvm::json::Value Params);
+  /// Sends a notification whose params were serialized with writeJSON().
+  void notifyRaw(StringRef Method, StringRef Params);
 
   const FileSystemProvider &FSProvider;
   /// Options used for code completion
@@ -159,7 +163,7 @@ private:
   // The CDB is created by the "initialize" LSP method.
   bool UseDirBasedCDB;                     // FIXME: make this a capability.
   llvm::Optional<Path> CompileCommandsDir; // FIXME: merge with capability?
-  std::unique_ptr<GlobalCompilationDatabase> BaseCDB;
+  std::unique_ptr<DirectoryBasedGlobalCompilationDatabase> BaseCDB;
   // CDB is BaseCDB plus any comands overridden via LSP extensions.
   llvm::Optional<OverlayCDB> CDB;
   // The ClangdServer is created by the "initialize" LSP method.
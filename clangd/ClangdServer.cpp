@@ -66,12 +66,17 @@ public:
 
 // Update the FileIndex with new ASTs and plumb the diagnostics responses.
 struct UpdateIndexCallbacks : public ParsingCallbacks {
-  UpdateIndexCallbacks(FileIndex *FIndex, DiagnosticsConsumer &DiagConsumer)
-      : FIndex(FIndex), DiagConsumer(DiagConsumer) {}
+  UpdateIndexCallbacks(FileIndex *FIndex, FileNameIndex &FileNames,
+                       DiagnosticsConsumer &DiagConsumer)
+      : FIndex(FIndex), FileNames(FileNames), DiagConsumer(DiagConsumer) {}
 
   void onPreambleAST(PathRef Path, ASTContext &Ctx,
                      std::shared_ptr<clang::Preprocessor> PP,
                      const CanonicalIncludes &CanonIncludes) override {
+    const auto &SM = Ctx.getSourceManager();
+    for (auto It = SM.fileinfo_begin(); It != SM.fileinfo_end(); ++It)
+      if (auto File = getCanonicalPath(It->first, SM))
+        FileNames.addFile(*File);
     if (FIndex)
       FIndex->updatePreamble(Path, Ctx, std::move(PP), CanonIncludes);
   }
@@ -91,13 +96,16 @@ struct UpdateIndexCallbacks : public ParsingCallbacks {
 
 private:
   FileIndex *FIndex;
+  FileNameIndex &FileNames;
   DiagnosticsConsumer &DiagConsumer;
 };
 } // namespace
 
 ClangdServer::Options ClangdServer::optsForTest() {
   ClangdServer::Options Opts;
-  Opts.UpdateDebounce = std::chrono::steady_clock::duration::zero(); // Faster!
+  // Faster!
+  Opts.UpdateDebounce =
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero());
   Opts.StorePreamblesInMemory = true;
   Opts.AsyncThreadsCount = 4; // Consistent!
   return Opts;
@@ -113,6 +121,8 @@ ClangdServer::ClangdServer(const GlobalCompilationDatabase &CDB,
                      : nullptr),
       ClangTidyOptProvider(Opts.ClangTidyOptProvider),
       SuggestMissingIncludes(Opts.SuggestMissingIncludes),
+      PrebuildPreambles(Opts.PrebuildPreambles),
+      WatchedFilesForPreambles(Opts.WatchedFilesForPreambles),
       WorkspaceRoot(Opts.WorkspaceRoot),
       PCHs(std::make_shared<PCHContainerOperations>()),
       // Pass a callback into `WorkScheduler` to extract symbols from a newly
@@ -121,52 +131,117 @@ ClangdServer::ClangdServer(const GlobalCompilationDatabase &CDB,
       // FIXME(ioeric): this can be slow and we may be able to index on less
       // critical paths.
       WorkScheduler(Opts.AsyncThreadsCount, Opts.StorePreamblesInMemory,
-                    llvm::make_unique<UpdateIndexCallbacks>(DynamicIdx.get(),
-                                                            DiagConsumer),
+                    llvm::make_unique<UpdateIndexCallbacks>(
+                        DynamicIdx.get(), FileNames, DiagConsumer),
                     Opts.UpdateDebounce, Opts.RetentionPolicy) {
   // Adds an index to the stack, at higher priority than existing indexes.
+  // A static index may be large or slow, so it's queried concurrently with
+  // the indexes stacked on top of it.
   auto AddIndex = [&](SymbolIndex *Idx) {
     if (this->Index != nullptr) {
-      MergedIdx.push_back(llvm::make_unique<MergedIndex>(Idx, this->Index));
+      MergedIdx.push_back(llvm::make_unique<MergedIndex>(
+          Idx, this->Index, /*Concurrent=*/Opts.StaticIndex != nullptr));
       this->Index = MergedIdx.back().get();
     } else {
       this->Index = Idx;
     }
   };
-  if (Opts.StaticIndex)
+  if (Opts.StaticIndex) {
+    StaticIdx = Opts.StaticIndex;
     AddIndex(Opts.StaticIndex);
+  }
+  // The background index and the dynamic index snapshots share the storage.
+  PersistDynamicIndex = DynamicIdx && Opts.PersistDynamicIndex;
+  std::shared_ptr<BackgroundIndexStorage::Factory> IndexStorageFactory;
+  if (Opts.BackgroundIndex || PersistDynamicIndex)
+    IndexStorageFactory = std::make_shared<BackgroundIndexStorage::Factory>(
+        Opts.PackedBackgroundIndexStorage
+            ? BackgroundIndexStorage::createPackedStorageFactory()
+            : BackgroundIndexStorage::createDiskBackedStorageFactory());
+  if (PersistDynamicIndex)
+    DynamicIdx->setSnapshotStorage(
+        [this, IndexStorageFactory](PathRef File) -> BackgroundIndexStorage * {
+          ProjectInfo Project;
+          if (!this->CDB.getCompileCommand(File, &Project))
+            return nullptr;
+          return (*IndexStorageFactory)(Project.SourceRoot);
+        });
   if (Opts.BackgroundIndex) {
     BackgroundIdx = llvm::make_unique<BackgroundIndex>(
         Context::current().clone(), FSProvider, CDB,
-        BackgroundIndexStorage::createDiskBackedStorageFactory(),
-        Opts.BackgroundIndexRebuildPeriodMs);
+        [IndexStorageFactory](llvm::StringRef CDBDirectory) {
+          return (*IndexStorageFactory)(CDBDirectory);
+        },
+        Opts.BackgroundIndexRebuildPeriodMs,
+        llvm::heavyweight_hardware_concurrency(),
+        WorkScheduler.concurrencyLimit(), Opts.BackgroundIndexColdRefsDistance,
+        &FileNames);
     AddIndex(BackgroundIdx.get());
   }
   if (DynamicIdx)
     AddIndex(DynamicIdx.get());
+  if (this->Index && Opts.IndexResultCacheBytes) {
+    CachedIdx = llvm::make_unique<CachingIndex>(this->Index,
+                                                Opts.IndexResultCacheBytes);
+    this->Index = CachedIdx.get();
+  }
 }
 
 void ClangdServer::addDocument(PathRef File, llvm::StringRef Contents,
                                WantDiagnostics WantDiags) {
+  FileNames.addFile(File);
   ParseOptions Opts;
   Opts.ClangTidyOpts = tidy::ClangTidyOptions::getDefaults();
   if (ClangTidyOptProvider)
     Opts.ClangTidyOpts = ClangTidyOptProvider->getOptions(File);
   Opts.SuggestMissingIncludes = SuggestMissingIncludes;
+  Opts.IncludeFixCache = &IncludeFixCache;
+  if (WatchedFilesForPreambles)
+    Opts.WatchedFileChanges = &WatchedFileChanges;
   // FIXME: some build systems like Bazel will take time to preparing
   // environment to build the file, it would be nice if we could emit a
   // "PreparingBuild" status to inform users, it is non-trivial given the
   // current implementation.
   ParseInputs Inputs;
-  Inputs.CompileCommand = getCompileCommand(File);
+  // The compilation database may need to be loaded, do this on the worker
+  // thread of the file: requests for other files don't wait for it.
+  std::string FileCopy = File;
+  Inputs.GetCompileCommand = [this, FileCopy] {
+    return getCompileCommand(FileCopy);
+  };
   Inputs.FS = FSProvider.getFileSystem();
   Inputs.Contents = Contents;
   Inputs.Opts = std::move(Opts);
   Inputs.Index = Index;
+  // Serve the last snapshot of the file's symbols while it is parsed.
+  if (PersistDynamicIndex && RestoredSnapshots.insert(File).second) {
+    std::string ContentsCopy = Contents;
+    WorkScheduler.run("RestoreIndexSnapshot", [this, FileCopy, ContentsCopy] {
+      DynamicIdx->restoreSnapshot(FileCopy, ContentsCopy);
+    });
+  }
   WorkScheduler.update(File, Inputs, WantDiags);
+  if (BackgroundIdx)
+    BackgroundIdx->boostRelated(File);
+
+  if (PrebuildPreambles && PrebuiltCounterparts.insert(File).second)
+    if (auto Counterpart = switchSourceHeader(File))
+      prebuildPreamble(*Counterpart);
 }
 
-void ClangdServer::removeDocument(PathRef File) { WorkScheduler.remove(File); }
+void ClangdServer::removeDocument(PathRef File) {
+  PrebuiltCounterparts.erase(File);
+  {
+    std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
+    CompletionsAfterIndexResults.erase(File);
+  }
+  WorkScheduler.remove(File);
+}
+
+void ClangdServer::setVisibleRange(PathRef File,
+                                   llvm::Optional<Range> Visible) {
+  WorkScheduler.setVisibleRange(File, Visible);
+}
 
 void ClangdServer::codeComplete(PathRef File, Position Pos,
                                 const clangd::CodeCompleteOptions &Opts,
@@ -175,6 +250,8 @@ void ClangdServer::codeComplete(PathRef File, Position Pos,
   auto CodeCompleteOpts = Opts;
   if (!CodeCompleteOpts.Index) // Respect overridden index.
     CodeCompleteOpts.Index = Index;
+  if (!CodeCompleteOpts.ProximityCache)
+    CodeCompleteOpts.ProximityCache = &CompletionProximityCache;
 
   // Copy PCHs to avoid accessing this->PCHs concurrently
   std::shared_ptr<PCHContainerOperations> PCHs = this->PCHs;
@@ -188,21 +265,72 @@ void ClangdServer::codeComplete(PathRef File, Position Pos,
     if (isCancelled())
       return CB(llvm::make_error<CancelledError>());
 
+    if (CodeCompleteOpts.IndexResultsFirst) {
+      std::shared_ptr<const PastCompletion> Earlier;
+      {
+        std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
+        Earlier = CompletionsAfterIndexResults.lookup(File);
+      }
+      if (Earlier)
+        if (auto Result = refilterCompletions(*Earlier, IP->Contents, Pos,
+                                              CodeCompleteOpts))
+          return CB(std::move(*Result));
+    }
+
     llvm::Optional<SpeculativeFuzzyFind> SpecFuzzyFind;
-    if (CodeCompleteOpts.Index && CodeCompleteOpts.SpeculativeIndexRequest) {
+    if (CodeCompleteOpts.Index && (CodeCompleteOpts.SpeculativeIndexRequest ||
+                                   CodeCompleteOpts.ReuseIndexResults ||
+                                   CodeCompleteOpts.IndexResultsFirst)) {
       SpecFuzzyFind.emplace();
       {
         std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
-        SpecFuzzyFind->CachedReq = CachedCompletionFuzzyFindRequestByFile[File];
+        if (CodeCompleteOpts.SpeculativeIndexRequest ||
+            CodeCompleteOpts.IndexResultsFirst)
+          SpecFuzzyFind->CachedReq =
+              CachedCompletionFuzzyFindRequestByFile[File];
+        if (CodeCompleteOpts.ReuseIndexResults)
+          SpecFuzzyFind->CachedResults =
+              CachedCompletionFuzzyFindResultsByFile.lookup(File);
       }
     }
 
+    // Sema completion runs after the index results are sent, unless it already
+    // runs for an earlier completion in the file.
+    bool AnsweredFromIndex = false;
+    if (CodeCompleteOpts.IndexResultsFirst && SpecFuzzyFind) {
+      if (auto Result = codeCompleteFromIndex(
+              File, IP->Command, IP->Preamble, IP->Contents, Pos, FS,
+              CodeCompleteOpts, *SpecFuzzyFind)) {
+        {
+          clang::clangd::trace::Span Tracer("Completion results callback");
+          CB(std::move(*Result));
+        }
+        AnsweredFromIndex = true;
+        std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
+        if (!CompletionsRunningAfterIndexResults.insert(File).second)
+          return;
+      }
+    }
+
+    // The results kept for refiltering are not truncated: a longer filter
+    // may select items that didn't make it into the first Limit.
+    auto SemaOpts = CodeCompleteOpts;
+    if (AnsweredFromIndex)
+      SemaOpts.Limit = 0;
     // FIXME(ibiryukov): even if Preamble is non-null, we may want to check
     // both the old and the new version in case only one of them matches.
     CodeCompleteResult Result = clangd::codeComplete(
-        File, IP->Command, IP->Preamble, IP->Contents, Pos, FS, PCHs,
-        CodeCompleteOpts, SpecFuzzyFind ? SpecFuzzyFind.getPointer() : nullptr);
-    {
+        File, IP->Command, IP->Preamble, IP->Contents, Pos, FS, PCHs, SemaOpts,
+        SpecFuzzyFind ? SpecFuzzyFind.getPointer() : nullptr);
+    if (AnsweredFromIndex) {
+      auto Past = std::make_shared<PastCompletion>();
+      Past->Contents = IP->Contents;
+      Past->Pos = Pos;
+      Past->Result = std::move(Result);
+      std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
+      CompletionsAfterIndexResults[File] = std::move(Past);
+      CompletionsRunningAfterIndexResults.erase(File);
+    } else {
       clang::clangd::trace::Span Tracer("Completion results callback");
       CB(std::move(Result));
     }
@@ -210,6 +338,8 @@ void ClangdServer::codeComplete(PathRef File, Position Pos,
       std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
       CachedCompletionFuzzyFindRequestByFile[File] =
           SpecFuzzyFind->NewReq.getValue();
+      // Results from an older request can't be reused for the next one.
+      CachedCompletionFuzzyFindResultsByFile[File] = SpecFuzzyFind->NewResults;
     }
     // SpecFuzzyFind is only destroyed after speculative fuzzy find finishes.
     // We don't want `codeComplete` to wait for the async call if it doesn't use
@@ -351,8 +481,8 @@ void ClangdServer::enumerateTweaks(PathRef File, Range Sel,
     if (!Selection)
       return CB(Selection.takeError());
     std::vector<TweakRef> Res;
-    for (auto &T : prepareTweaks(*Selection))
-      Res.push_back({T->id(), T->title()});
+    for (auto &T : availableTweaks(*Selection))
+      Res.push_back({std::move(T.first), std::move(T.second)});
     CB(std::move(Res));
   };
 
@@ -409,37 +539,43 @@ void ClangdServer::dumpAST(PathRef File,
 
 void ClangdServer::locateSymbolAt(PathRef File, Position Pos,
                                   Callback<std::vector<LocatedSymbol>> CB) {
-  auto Action = [Pos, this](decltype(CB) CB,
+  auto Action = [Pos, this](Path File, decltype(CB) CB,
                             llvm::Expected<InputsAndAST> InpAST) {
     if (!InpAST)
       return CB(InpAST.takeError());
-    CB(clangd::locateSymbolAt(InpAST->AST, Pos, Index));
+    auto Result = clangd::locateSymbolAt(InpAST->AST, Pos, Index);
+    std::vector<std::string> Targets;
+    if (PrebuildPreambles)
+      for (const auto &Sym : Result) {
+        const Location &Target =
+            Sym.Definition ? *Sym.Definition : Sym.PreferredDeclaration;
+        if (Target.uri.file() != File)
+          Targets.push_back(Target.uri.file());
+      }
+    CB(std::move(Result));
+    // The user is likely to jump to one of the targets.
+    for (const auto &Target : Targets)
+      prebuildPreamble(Target);
   };
 
-  WorkScheduler.runWithAST("Definitions", File, Bind(Action, std::move(CB)));
+  WorkScheduler.runWithAST("Definitions", File,
+                           Bind(Action, File.str(), std::move(CB)));
 }
 
 llvm::Optional<Path> ClangdServer::switchSourceHeader(PathRef Path) {
+  // Instance of vfs::FileSystem, used for file existence checks.
+  auto FS = FSProvider.getFileSystem();
 
-  llvm::StringRef SourceExtensions[] = {".cpp", ".c", ".cc", ".cxx",
-                                        ".c++", ".m", ".mm"};
-  llvm::StringRef HeaderExtensions[] = {".h", ".hh", ".hpp", ".hxx", ".inc"};
-
-  llvm::StringRef PathExt = llvm::sys::path::extension(Path);
+  // Most counterparts were seen in some include graph or compile command, so
+  // a single check replaces probing each extension. Known files may have been
+  // deleted since.
+  if (auto Known = FileNames.counterpart(Path))
+    if (FS->exists(*Known))
+      return Known;
 
   // Lookup in a list of known extensions.
-  auto SourceIter =
-      llvm::find_if(SourceExtensions, [&PathExt](PathRef SourceExt) {
-        return SourceExt.equals_lower(PathExt);
-      });
-  bool IsSource = SourceIter != std::end(SourceExtensions);
-
-  auto HeaderIter =
-      llvm::find_if(HeaderExtensions, [&PathExt](PathRef HeaderExt) {
-        return HeaderExt.equals_lower(PathExt);
-      });
-
-  bool IsHeader = HeaderIter != std::end(HeaderExtensions);
+  bool IsSource = isSourceFilePath(Path);
+  bool IsHeader = isHeaderFilePath(Path);
 
   // We can only switch between the known extensions.
   if (!IsSource && !IsHeader)
@@ -449,28 +585,29 @@ llvm::Optional<Path> ClangdServer::switchSourceHeader(PathRef Path) {
   // extension was found.
   llvm::ArrayRef<llvm::StringRef> NewExts;
   if (IsSource)
-    NewExts = HeaderExtensions;
+    NewExts = headerFileExtensions();
   else
-    NewExts = SourceExtensions;
+    NewExts = sourceFileExtensions();
 
   // Storage for the new path.
   llvm::SmallString<128> NewPath = llvm::StringRef(Path);
 
-  // Instance of vfs::FileSystem, used for file existence checks.
-  auto FS = FSProvider.getFileSystem();
-
   // Loop through switched extension candidates.
   for (llvm::StringRef NewExt : NewExts) {
     llvm::sys::path::replace_extension(NewPath, NewExt);
-    if (FS->exists(NewPath))
+    if (FS->exists(NewPath)) {
+      FileNames.addFile(NewPath);
       return NewPath.str().str(); // First str() to convert from SmallString to
                                   // StringRef, second to convert from StringRef
                                   // to std::string
+    }
 
     // Also check NewExt in upper-case, just in case.
     llvm::sys::path::replace_extension(NewPath, NewExt.upper());
-    if (FS->exists(NewPath))
+    if (FS->exists(NewPath)) {
+      FileNames.addFile(NewPath);
       return NewPath.str().str();
+    }
   }
 
   return None;
@@ -525,14 +662,16 @@ void ClangdServer::findHover(PathRef File, Position Pos,
 void ClangdServer::typeHierarchy(PathRef File, Position Pos, int Resolve,
                                  TypeHierarchyDirection Direction,
                                  Callback<Optional<TypeHierarchyItem>> CB) {
-  auto Action = [Pos, Resolve, Direction](decltype(CB) CB,
-                                          Expected<InputsAndAST> InpAST) {
+  auto Action = [Pos, Resolve, Direction, this](Path File, decltype(CB) CB,
+                                                Expected<InputsAndAST> InpAST) {
     if (!InpAST)
       return CB(InpAST.takeError());
-    CB(clangd::getTypeHierarchy(InpAST->AST, Pos, Resolve, Direction));
+    CB(clangd::getTypeHierarchy(InpAST->AST, Pos, Resolve, Direction, Index,
+                                File));
   };
 
-  WorkScheduler.runWithAST("Type Hierarchy", File, Bind(Action, std::move(CB)));
+  WorkScheduler.runWithAST("Type Hierarchy", File,
+                           Bind(Action, File.str(), std::move(CB)));
 }
 
 tooling::CompileCommand ClangdServer::getCompileCommand(PathRef File) {
@@ -543,9 +682,26 @@ tooling::CompileCommand ClangdServer::getCompileCommand(PathRef File) {
   return std::move(*C);
 }
 
+void ClangdServer::prebuildPreamble(PathRef File) {
+  auto FS = FSProvider.getFileSystem();
+  auto Buffer = FS->getBufferForFile(File);
+  if (!Buffer)
+    return;
+  ParseInputs Inputs;
+  Inputs.CompileCommand = getCompileCommand(File);
+  Inputs.FS = std::move(FS);
+  Inputs.Contents = (*Buffer)->getBuffer();
+  WorkScheduler.prebuildPreamble(File, std::move(Inputs));
+}
+
 void ClangdServer::onFileEvent(const DidChangeWatchedFilesParams &Params) {
-  // FIXME: Do nothing for now. This will be used for indexing and potentially
-  // invalidating other caches.
+  // FIXME: This could be used for invalidating other caches.
+  std::vector<std::string> Files;
+  for (const FileEvent &Event : Params.changes)
+    Files.push_back(Event.uri.file().str());
+  WatchedFileChanges.changed(Files);
+  if (BackgroundIdx)
+    BackgroundIdx->filesChanged(Files);
 }
 
 void ClangdServer::workspaceSymbols(
@@ -603,6 +759,17 @@ ClangdServer::getUsedBytesPerFile() const {
   return WorkScheduler.getUsedBytesPerFile();
 }
 
+void ClangdServer::profile(MemoryTree &MT) const {
+  WorkScheduler.profile(MT.child("tuscheduler"));
+  if (DynamicIdx)
+    DynamicIdx->profile(MT.child("dynamic_index"));
+  if (BackgroundIdx)
+    MT.child("background_index")
+        .addUsage(BackgroundIdx->estimateMemoryUsage());
+  if (StaticIdx)
+    MT.child("static_index").addUsage(StaticIdx->estimateMemoryUsage());
+}
+
 LLVM_NODISCARD bool
 ClangdServer::blockUntilIdleForTest(llvm::Optional<double> TimeoutSeconds) {
   return WorkScheduler.blockUntilIdle(timeoutSeconds(TimeoutSeconds)) &&
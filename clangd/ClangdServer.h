@@ -14,12 +14,15 @@
 #include "ClangdUnit.h"
 #include "CodeComplete.h"
 #include "FSProvider.h"
+#include "FileNameIndex.h"
 #include "Function.h"
 #include "GlobalCompilationDatabase.h"
+#include "IncludeFixer.h"
 #include "Protocol.h"
 #include "TUScheduler.h"
 #include "XRefs.h"
 #include "index/Background.h"
+#include "index/CachingIndex.h"
 #include "index/FileIndex.h"
 #include "index/Index.h"
 #include "refactor/Tweak.h"
@@ -29,6 +32,7 @@
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include <functional>
 #include <future>
 #include <string>
@@ -92,9 +96,33 @@ public:
     /// periodically every BuildIndexPeriodMs milliseconds; otherwise, the
     /// symbol index will be updated for each indexed file.
     size_t BackgroundIndexRebuildPeriodMs = 0;
+    /// If true, the background index packs the shards of each project into a
+    /// few files rather than writing one file per source file.
+    bool PackedBackgroundIndexStorage = false;
+    /// If set, the background index only keeps the refs of files within this
+    /// FileDistance of recently opened files in memory. Refs of other files
+    /// are loaded from their shards when requested.
+    llvm::Optional<unsigned> BackgroundIndexColdRefsDistance;
+    /// If true, snapshots of the dynamic index of each file are saved in the
+    /// background index storage of its project. When a file is opened, its
+    /// last snapshot is served until the file is indexed again.
+    bool PersistDynamicIndex = false;
+
+    /// If true, preambles of files that are likely to be opened next (targets
+    /// of go-to-definition, and the matching header/source of opened files)
+    /// are built speculatively on idle threads.
+    bool PrebuildPreambles = false;
+
+    /// If true, the client is trusted to report all changes to the headers
+    /// included by preambles, through workspace/didChangeWatchedFiles.
+    /// Checking whether a preamble can be reused then needs no stat()s.
+    bool WatchedFilesForPreambles = false;
 
     /// If set, use this index to augment code completion results.
     SymbolIndex *StaticIndex = nullptr;
+    /// If non-zero, results of recent fuzzyFind requests to the index are
+    /// cached, using at most this many bytes.
+    size_t IndexResultCacheBytes = 0;
 
     /// If set, enable clang-tidy in clangd, used to get clang-tidy
     /// configurations for a particular file.
@@ -115,8 +143,8 @@ public:
     llvm::Optional<std::string> ResourceDir = llvm::None;
 
     /// Time to wait after a new file version before computing diagnostics.
-    std::chrono::steady_clock::duration UpdateDebounce =
-        std::chrono::milliseconds(500);
+    /// Adapts to how long the file takes to build, within the policy bounds.
+    DebouncePolicy UpdateDebounce;
 
     bool SuggestMissingIncludes = false;
   };
@@ -152,6 +180,10 @@ public:
   /// be delivered, even if requested with WantDiags::Auto or WantDiags::Yes.
   void removeDocument(PathRef File);
 
+  /// Sets the range of \p File visible in the editor, or clears it. The
+  /// diagnostics of the visible range are computed and reported first.
+  void setVisibleRange(PathRef File, llvm::Optional<Range> Visible);
+
   /// Run code completion for \p File at \p Pos.
   /// Request is processed asynchronously.
   ///
@@ -252,6 +284,10 @@ public:
   /// FIXME: those metrics might be useful too, we should add them.
   std::vector<std::pair<Path, std::size_t>> getUsedBytesPerFile() const;
 
+  /// Adds the memory used by the server to \p MT: open files (ASTs and
+  /// preambles), and each index.
+  void profile(MemoryTree &MT) const;
+
   /// Returns the active dynamic index if one was built.
   /// This can be useful for testing, debugging, or observing memory usage.
   const SymbolIndex *dynamicIndex() const { return DynamicIdx.get(); }
@@ -269,9 +305,15 @@ private:
              ArrayRef<tooling::Range> Ranges);
 
   tooling::CompileCommand getCompileCommand(PathRef File);
+  /// Reads \p File and schedules a speculative build of its preamble.
+  /// Threadsafe.
+  void prebuildPreamble(PathRef File);
 
   const GlobalCompilationDatabase &CDB;
   const FileSystemProvider &FSProvider;
+  // Files seen in the project, used to find related files without probing the
+  // filesystem.
+  FileNameIndex FileNames;
 
   Path ResourceDir;
   // The index used to look up symbols. This could be:
@@ -280,12 +322,16 @@ private:
   //   - the static index passed to the constructor
   //   - a merged view of a static and dynamic index (MergedIndex)
   const SymbolIndex *Index = nullptr;
+  // The static index, if any. Not owned.
+  const SymbolIndex *StaticIdx = nullptr;
   // If present, an index of symbols in open files. Read via *Index.
   std::unique_ptr<FileIndex> DynamicIdx;
   // If present, the new "auto-index" maintained in background threads.
   std::unique_ptr<BackgroundIndex> BackgroundIdx;
   // Storage for merged views of the various indexes.
   std::vector<std::unique_ptr<SymbolIndex>> MergedIdx;
+  // If present, caches fuzzyFind results of the merged index. Read via *Index.
+  std::unique_ptr<CachingIndex> CachedIdx;
 
   // The provider used to provide a clang-tidy option for a specific file.
   tidy::ClangTidyOptionsProvider *ClangTidyOptProvider = nullptr;
@@ -293,11 +339,37 @@ private:
   // If this is true, suggest include insertion fixes for diagnostic errors that
   // can be caused by missing includes (e.g. member access in incomplete type).
   bool SuggestMissingIncludes = false;
+  // Index results of IncludeFixer, shared by all files.
+  IncludeFixerCache IncludeFixCache;
+
+  bool PrebuildPreambles = false;
+  // Opened files whose matching header/source was prebuilt.
+  llvm::StringSet<> PrebuiltCounterparts;
+
+  bool WatchedFilesForPreambles = false;
+  // Files reported changed by the client.
+  FileChangeTracker WatchedFileChanges;
+
+  bool PersistDynamicIndex = false;
+  // Opened files whose dynamic index snapshot was restored (or looked for).
+  llvm::StringSet<> RestoredSnapshots;
 
   // GUARDED_BY(CachedCompletionFuzzyFindRequestMutex)
   llvm::StringMap<llvm::Optional<FuzzyFindRequest>>
       CachedCompletionFuzzyFindRequestByFile;
+  // GUARDED_BY(CachedCompletionFuzzyFindRequestMutex)
+  llvm::StringMap<std::shared_ptr<const CachedFuzzyFindResults>>
+      CachedCompletionFuzzyFindResultsByFile;
+  // Sema completions that ran after answering from the index, see
+  // CodeCompleteOptions::IndexResultsFirst, and the files where one is running.
+  // GUARDED_BY(CachedCompletionFuzzyFindRequestMutex)
+  llvm::StringMap<std::shared_ptr<const PastCompletion>>
+      CompletionsAfterIndexResults;
+  // GUARDED_BY(CachedCompletionFuzzyFindRequestMutex)
+  llvm::StringSet<> CompletionsRunningAfterIndexResults;
   mutable std::mutex CachedCompletionFuzzyFindRequestMutex;
+  // File proximity of the last code completion in each file.
+  URIDistanceCache CompletionProximityCache;
 
   llvm::Optional<std::string> WorkspaceRoot;
   std::shared_ptr<PCHContainerOperations> PCHs;
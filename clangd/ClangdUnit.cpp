@@ -56,10 +56,40 @@ template <class T> std::size_t getUsedBytes(const std::vector<T> &Vec) {
   return Vec.capacity() * sizeof(T);
 }
 
+// Returns the offset of the end of the function body starting at the first
+// '{' after \p Offset in the main file, found by matching braces in the raw
+// tokens. Braces of constructor initializers before the body are skipped.
+unsigned findBodyEnd(const SourceManager &SM, unsigned Offset,
+                     const LangOptions &LangOpts) {
+  FileID FID = SM.getMainFileID();
+  llvm::StringRef Code = SM.getBufferData(FID);
+  Lexer Lex(SM.getLocForStartOfFile(FID), LangOpts, Code.begin(),
+            Code.begin() + Offset, Code.end());
+  Token Tok;
+  unsigned Depth = 0;
+  llvm::Optional<unsigned> GroupEnd;
+  while (!Lex.LexFromRawLexer(Tok)) {
+    if (Tok.is(tok::l_brace)) {
+      ++Depth;
+    } else if (Tok.is(tok::r_brace) && Depth > 0) {
+      if (--Depth == 0)
+        GroupEnd = SM.getFileOffset(Tok.getLocation()) + 1;
+      continue;
+    } else if (GroupEnd && Depth == 0 && !Tok.is(tok::comma)) {
+      // The last group was the body, no more initializers follow.
+      return *GroupEnd;
+    }
+    GroupEnd.reset();
+  }
+  return GroupEnd ? *GroupEnd : Code.size();
+}
+
 class DeclTrackingASTConsumer : public ASTConsumer {
 public:
-  DeclTrackingASTConsumer(std::vector<Decl *> &TopLevelDecls)
-      : TopLevelDecls(TopLevelDecls) {}
+  DeclTrackingASTConsumer(
+      std::vector<Decl *> &TopLevelDecls,
+      llvm::Optional<std::pair<unsigned, unsigned>> BodiesIn)
+      : TopLevelDecls(TopLevelDecls), BodiesIn(BodiesIn) {}
 
   bool HandleTopLevelDecl(DeclGroupRef DG) override {
     for (Decl *D : DG) {
@@ -75,22 +105,46 @@ public:
     return true;
   }
 
+  bool shouldSkipFunctionBody(Decl *D) override {
+    if (!BodiesIn)
+      return false;
+    const SourceManager &SM = D->getASTContext().getSourceManager();
+    // The body follows the declarator, which ends at D's current end.
+    SourceLocation Loc = SM.getExpansionLoc(D->getEndLoc());
+    if (!SM.isWrittenInMainFile(Loc))
+      return false;
+    unsigned Offset = SM.getFileOffset(Loc);
+    if (Offset >= BodiesIn->second)
+      return true;
+    return findBodyEnd(SM, Offset, D->getASTContext().getLangOpts()) <
+           BodiesIn->first;
+  }
+
 private:
   std::vector<Decl *> &TopLevelDecls;
+  /// The offsets of the main file range where bodies are parsed, if only some
+  /// of them are.
+  llvm::Optional<std::pair<unsigned, unsigned>> BodiesIn;
 };
 
 class ClangdFrontendAction : public SyntaxOnlyAction {
 public:
+  ClangdFrontendAction(
+      llvm::Optional<std::pair<unsigned, unsigned>> BodiesIn = None)
+      : BodiesIn(BodiesIn) {}
+
   std::vector<Decl *> takeTopLevelDecls() { return std::move(TopLevelDecls); }
 
 protected:
   std::unique_ptr<ASTConsumer>
   CreateASTConsumer(CompilerInstance &CI, llvm::StringRef InFile) override {
-    return llvm::make_unique<DeclTrackingASTConsumer>(/*ref*/ TopLevelDecls);
+    return llvm::make_unique<DeclTrackingASTConsumer>(/*ref*/ TopLevelDecls,
+                                                      BodiesIn);
   }
 
 private:
   std::vector<Decl *> TopLevelDecls;
+  llvm::Optional<std::pair<unsigned, unsigned>> BodiesIn;
 };
 
 class CppFilePreambleCallbacks : public PreambleCallbacks {
@@ -236,8 +290,57 @@ private:
   const LangOptions &LangOpts;
 };
 
+// Fails to read any file once the build using it is cancelled.
+class CancellableFS : public llvm::vfs::ProxyFileSystem {
+public:
+  CancellableFS(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+                const std::atomic<bool> &Cancelled)
+      : ProxyFileSystem(std::move(FS)), Cancelled(Cancelled) {}
+
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const llvm::Twine &Path) override {
+    if (Cancelled)
+      return std::make_error_code(std::errc::operation_canceled);
+    return getUnderlyingFS().openFileForRead(Path);
+  }
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &Path) override {
+    if (Cancelled)
+      return std::make_error_code(std::errc::operation_canceled);
+    return getUnderlyingFS().status(Path);
+  }
+
+private:
+  const std::atomic<bool> &Cancelled;
+};
+
+// The factories of all clang-tidy checks, registered by instantiating every
+// module once instead of on each build.
+const tidy::ClangTidyCheckFactories &getClangTidyCheckFactories() {
+  static const tidy::ClangTidyCheckFactories *Factories = [] {
+    auto *Result = new tidy::ClangTidyCheckFactories;
+    for (const auto &E : tidy::ClangTidyModuleRegistry::entries())
+      E.instantiate()->addCheckFactories(*Result);
+    return Result;
+  }();
+  return *Factories;
+}
+
 } // namespace
 
+// The clang-tidy checks of an AST. They are kept alive after building it if
+// running their matchers was deferred.
+struct ParsedAST::ClangTidyState {
+  llvm::Optional<tidy::ClangTidyContext> Context;
+  std::vector<std::unique_ptr<tidy::ClangTidyCheck>> Checks;
+  ast_matchers::MatchFinder Finder;
+
+  Diag::Source diagSource(const Diag &D) const {
+    return !Context->getCheckName(D.ID).empty() ? Diag::ClangTidy
+                                                : Diag::Clang;
+  }
+};
+
 void dumpAST(ParsedAST &AST, llvm::raw_ostream &OS) {
   AST.getASTContext().getTranslationUnitDecl()->dump(OS, true);
 }
@@ -250,6 +353,10 @@ ParsedAST::build(std::unique_ptr<CompilerInvocation> CI,
                  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS,
                  const SymbolIndex *Index, const ParseOptions &Opts) {
   assert(CI);
+  // FIXME: the whole main file is reparsed on every edit. Reusing the
+  // unchanged top-level decls of the previous AST needs clang to support
+  // reparsing a single function body into an existing ASTContext, which it
+  // doesn't.
   // Command-line parsing sets DisableFree to true by default, but we don't want
   // to leak memory in clangd.
   CI->getFrontendOpts().DisableFree = false;
@@ -257,15 +364,30 @@ ParsedAST::build(std::unique_ptr<CompilerInvocation> CI,
       Preamble ? &Preamble->Preamble : nullptr;
 
   StoreDiags ASTDiags;
+  ASTDiags.setDetailLimit(Opts.DetailedDiagnosticsLimit);
   std::string Content = Buffer->getBuffer();
 
+  llvm::Optional<std::pair<unsigned, unsigned>> BodiesIn;
+  if (Opts.ParseBodiesIn) {
+    auto Begin = positionToOffset(Content, Opts.ParseBodiesIn->start);
+    auto End = positionToOffset(Content, Opts.ParseBodiesIn->end);
+    if (Begin && End) {
+      BodiesIn = std::make_pair(*Begin, *End);
+      // Sema only asks the consumer which bodies to skip in this mode.
+      CI->getFrontendOpts().SkipFunctionBodies = true;
+    } else {
+      llvm::consumeError(Begin.takeError());
+      llvm::consumeError(End.takeError());
+    }
+  }
+
   auto Clang =
       prepareCompilerInstance(std::move(CI), PreamblePCH, std::move(Buffer),
                               std::move(PCHs), VFS, ASTDiags);
   if (!Clang)
     return None;
 
-  auto Action = llvm::make_unique<ClangdFrontendAction>();
+  auto Action = llvm::make_unique<ClangdFrontendAction>(BodiesIn);
   const FrontendInputFile &MainInput = Clang->getFrontendOpts().Inputs[0];
   if (!Action->BeginSourceFile(*Clang, MainInput)) {
     log("BeginSourceFile() failed when building AST for {0}",
@@ -279,29 +401,25 @@ ParsedAST::build(std::unique_ptr<CompilerInvocation> CI,
   //  - matchers run only over the main-file top-level decls (and can't see
   //    ancestors outside this scope).
   // In practice almost all checks work well without modifications.
-  std::vector<std::unique_ptr<tidy::ClangTidyCheck>> CTChecks;
-  ast_matchers::MatchFinder CTFinder;
-  llvm::Optional<tidy::ClangTidyContext> CTContext;
+  auto Tidy = llvm::make_unique<ClangTidyState>();
   {
     trace::Span Tracer("ClangTidyInit");
     dlog("ClangTidy configuration for file {0}: {1}", MainInput.getFile(),
          tidy::configurationAsText(Opts.ClangTidyOpts));
-    tidy::ClangTidyCheckFactories CTFactories;
-    for (const auto &E : tidy::ClangTidyModuleRegistry::entries())
-      E.instantiate()->addCheckFactories(CTFactories);
-    CTContext.emplace(llvm::make_unique<tidy::DefaultOptionsProvider>(
+    Tidy->Context.emplace(llvm::make_unique<tidy::DefaultOptionsProvider>(
         tidy::ClangTidyGlobalOptions(), Opts.ClangTidyOpts));
-    CTContext->setDiagnosticsEngine(&Clang->getDiagnostics());
-    CTContext->setASTContext(&Clang->getASTContext());
-    CTContext->setCurrentFile(MainInput.getFile());
-    CTFactories.createChecks(CTContext.getPointer(), CTChecks);
+    Tidy->Context->setDiagnosticsEngine(&Clang->getDiagnostics());
+    Tidy->Context->setASTContext(&Clang->getASTContext());
+    Tidy->Context->setCurrentFile(MainInput.getFile());
+    getClangTidyCheckFactories().createChecks(
+        Tidy->Context.getPointer(), Tidy->Checks, &Clang->getLangOpts());
     Preprocessor *PP = &Clang->getPreprocessor();
-    for (const auto &Check : CTChecks) {
+    for (const auto &Check : Tidy->Checks) {
       // FIXME: the PP callbacks skip the entire preamble.
       // Checks that want to see #includes in the main file do not see them.
       Check->registerPPCallbacks(*Clang);
       Check->registerPPCallbacks(Clang->getSourceManager(), PP, PP);
-      Check->registerMatchers(&CTFinder);
+      Check->registerMatchers(&Tidy->Finder);
     }
   }
 
@@ -313,17 +431,19 @@ ParsedAST::build(std::unique_ptr<CompilerInvocation> CI,
     auto Style = getFormatStyleForFile(MainInput.getFile(), Content, VFS.get());
     auto Inserter = std::make_shared<IncludeInserter>(
         MainInput.getFile(), Content, Style, BuildDir.get(),
-        Clang->getPreprocessor().getHeaderSearchInfo());
+        Clang->getPreprocessor().getHeaderSearchInfo(),
+        Preamble ? Preamble->IncludeSpellings.get() : nullptr);
     if (Preamble) {
       for (const auto &Inc : Preamble->Includes.MainFileIncludes)
         Inserter->addExisting(Inc);
     }
     FixIncludes.emplace(MainInput.getFile(), Inserter, *Index,
-                        /*IndexRequestLimit=*/5);
-    ASTDiags.contributeFixes([&FixIncludes](DiagnosticsEngine::Level DiagLevl,
-                                            const clang::Diagnostic &Info) {
-      return FixIncludes->fix(DiagLevl, Info);
-    });
+                        /*IndexRequestLimit=*/5, Opts.IncludeFixCache);
+    ASTDiags.contributeDeferredFixes(
+        [&FixIncludes](DiagnosticsEngine::Level DiagLevl,
+                       const clang::Diagnostic &Info) {
+          return FixIncludes->fix(DiagLevl, Info);
+        });
     Clang->setExternalSemaSource(FixIncludes->unresolvedNameRecorder());
   }
 
@@ -356,11 +476,11 @@ ParsedAST::build(std::unique_ptr<CompilerInvocation> CI,
   std::vector<Decl *> ParsedDecls = Action->takeTopLevelDecls();
   // AST traversals should exclude the preamble, to avoid performance cliffs.
   Clang->getASTContext().setTraversalScope(ParsedDecls);
-  {
+  if (!Opts.DeferClangTidy) {
     // Run the AST-dependent part of the clang-tidy checks.
     // (The preprocessor part ran already, via PPCallbacks).
     trace::Span Tracer("ClangTidyMatch");
-    CTFinder.matchAST(Clang->getASTContext());
+    Tidy->Finder.matchAST(Clang->getASTContext());
   }
 
   // UnitDiagsConsumer is local, we can not store it in CompilerInstance that
@@ -376,21 +496,45 @@ ParsedAST::build(std::unique_ptr<CompilerInvocation> CI,
   std::vector<Diag> Diags = ASTDiags.take();
   // Populate diagnostic source.
   for (auto &D : Diags)
-    D.S =
-        !CTContext->getCheckName(D.ID).empty() ? Diag::ClangTidy : Diag::Clang;
+    D.S = Tidy->diagSource(D);
   // Add diagnostics from the preamble, if any.
   if (Preamble)
     Diags.insert(Diags.begin(), Preamble->Diags.begin(), Preamble->Diags.end());
+  // Keep the checks around only if their matchers still have to run.
+  if (!Opts.DeferClangTidy || Tidy->Checks.empty())
+    Tidy.reset();
   return ParsedAST(std::move(Preamble), std::move(Clang), std::move(Action),
-                   std::move(ParsedDecls), std::move(Diags),
+                   std::move(Tidy), std::move(ParsedDecls), std::move(Diags),
                    std::move(Includes), std::move(CanonIncludes));
 }
 
+void ParsedAST::runClangTidy() {
+  if (!Tidy)
+    return;
+  trace::Span Tracer("ClangTidyMatch");
+  // The diagnostics engine ignores diagnostics once the AST is built, collect
+  // those of the checks while they run.
+  StoreDiags TidyDiags;
+  DiagnosticsEngine &Engine = Clang->getDiagnostics();
+  Engine.setClient(&TidyDiags, /*ShouldOwnClient=*/false);
+  TidyDiags.BeginSourceFile(Clang->getLangOpts(), &Clang->getPreprocessor());
+  Tidy->Finder.matchAST(Clang->getASTContext());
+  TidyDiags.EndSourceFile();
+  Engine.setClient(new IgnoreDiagnostics);
+  for (Diag &D : TidyDiags.take()) {
+    D.S = Tidy->diagSource(D);
+    Diags.push_back(std::move(D));
+  }
+  Tidy.reset();
+}
+
 ParsedAST::ParsedAST(ParsedAST &&Other) = default;
 
 ParsedAST &ParsedAST::operator=(ParsedAST &&Other) = default;
 
 ParsedAST::~ParsedAST() {
+  // The checks refer to the ASTContext.
+  Tidy.reset();
   if (Action) {
     // We already notified the PP of end-of-file earlier, so detach it first.
     // We must keep it alive until after EndSourceFile(), Sema relies on this.
@@ -429,6 +573,8 @@ std::size_t ParsedAST::getUsedBytes() const {
   // Message and Fixes inside each diagnostic.
   std::size_t Total =
       clangd::getUsedBytes(LocalTopLevelDecls) + clangd::getUsedBytes(Diags);
+  if (Occurrences)
+    Total += Occurrences->bytes();
 
   // FIXME: the rest of the function is almost a direct copy-paste from
   // libclang's clang_getCXTUResourceUsage. We could share the implementation.
@@ -459,6 +605,24 @@ const IncludeStructure &ParsedAST::getIncludeStructure() const {
   return Includes;
 }
 
+std::shared_ptr<const SelectionTree>
+ParsedAST::getSelectionTree(unsigned Begin, unsigned End) {
+  if (!LastSelection || LastSelectionRange != std::make_pair(Begin, End)) {
+    LastSelection = std::make_shared<SelectionTree>(*this, Begin, End);
+    LastSelectionRange = {Begin, End};
+  }
+  return LastSelection;
+}
+
+const DeclOccurrences &ParsedAST::getDeclOccurrences() {
+  if (!Occurrences) {
+    trace::Span Tracer("DeclOccurrences");
+    Occurrences = DeclOccurrences::build(getASTContext(), getPreprocessor(),
+                                         getLocalTopLevelDecls());
+  }
+  return *Occurrences;
+}
+
 const CanonicalIncludes &ParsedAST::getCanonicalIncludes() const {
   return CanonIncludes;
 }
@@ -469,16 +633,19 @@ PreambleData::PreambleData(PrecompiledPreamble Preamble,
                            CanonicalIncludes CanonIncludes)
     : Preamble(std::move(Preamble)), Diags(std::move(Diags)),
       Includes(std::move(Includes)), StatCache(std::move(StatCache)),
-      CanonIncludes(std::move(CanonIncludes)) {}
+      CanonIncludes(std::move(CanonIncludes)),
+      CompletionCache(llvm::make_unique<CompletionStringsCache>()),
+      IncludeSpellings(llvm::make_unique<IncludeSpellingCache>()) {}
 
 ParsedAST::ParsedAST(std::shared_ptr<const PreambleData> Preamble,
                      std::unique_ptr<CompilerInstance> Clang,
                      std::unique_ptr<FrontendAction> Action,
+                     std::unique_ptr<ClangTidyState> Tidy,
                      std::vector<Decl *> LocalTopLevelDecls,
                      std::vector<Diag> Diags, IncludeStructure Includes,
                      CanonicalIncludes CanonIncludes)
     : Preamble(std::move(Preamble)), Clang(std::move(Clang)),
-      Action(std::move(Action)), Diags(std::move(Diags)),
+      Action(std::move(Action)), Tidy(std::move(Tidy)), Diags(std::move(Diags)),
       LocalTopLevelDecls(std::move(LocalTopLevelDecls)),
       Includes(std::move(Includes)), CanonIncludes(std::move(CanonIncludes)) {
   assert(this->Clang);
@@ -491,17 +658,29 @@ buildPreamble(PathRef FileName, CompilerInvocation &CI,
               const tooling::CompileCommand &OldCompileCommand,
               const ParseInputs &Inputs,
               std::shared_ptr<PCHContainerOperations> PCHs, bool StoreInMemory,
-              PreambleParsedCallback PreambleCallback) {
+              PreambleParsedCallback PreambleCallback,
+              const std::atomic<bool> *Cancelled) {
   // Note that we don't need to copy the input contents, preamble can live
   // without those.
   auto ContentsBuffer = llvm::MemoryBuffer::getMemBuffer(Inputs.Contents);
   auto Bounds =
       ComputePreambleBounds(*CI.getLangOpts(), ContentsBuffer.get(), 0);
 
+  const FileChangeTracker *Changes = Inputs.Opts.WatchedFileChanges;
+  // Read before building, changes made during the build must be stat()ed.
+  llvm::Optional<uint64_t> ChangesVersion;
+  if (Changes)
+    ChangesVersion = Changes->version();
+  // The headers of the preamble are stat()ed, unless the client watches them.
+  auto ReuseFS = Inputs.FS;
+  if (OldPreamble && Changes && OldPreamble->WatchedFileChangesVersion &&
+      OldPreamble->StatCache)
+    ReuseFS = OldPreamble->StatCache->getWatchedFS(
+        ReuseFS, *Changes, *OldPreamble->WatchedFileChangesVersion);
   if (OldPreamble &&
       compileCommandsAreEqual(Inputs.CompileCommand, OldCompileCommand) &&
       OldPreamble->Preamble.CanReuse(CI, ContentsBuffer.get(), Bounds,
-                                     Inputs.FS.get())) {
+                                     ReuseFS.get())) {
     vlog("Reusing preamble for file {0}", llvm::Twine(FileName));
     return OldPreamble;
   }
@@ -511,6 +690,7 @@ buildPreamble(PathRef FileName, CompilerInvocation &CI,
   trace::Span Tracer("BuildPreamble");
   SPAN_ATTACH(Tracer, "File", FileName);
   StoreDiags PreambleDiagnostics;
+  PreambleDiagnostics.setDetailLimit(Inputs.Opts.DetailedDiagnosticsLimit);
   llvm::IntrusiveRefCntPtr<DiagnosticsEngine> PreambleDiagsEngine =
       CompilerInstance::createDiagnostics(&CI.getDiagnosticOpts(),
                                           &PreambleDiagnostics, false);
@@ -523,6 +703,14 @@ buildPreamble(PathRef FileName, CompilerInvocation &CI,
   // to read back. We rely on dynamic index for the comments instead.
   CI.getPreprocessorOpts().WriteCommentListToPCH = false;
 
+  // The AST of a cancelled build misses headers, don't let callers index it.
+  if (Cancelled && PreambleCallback)
+    PreambleCallback = [Cancelled, PreambleCallback](
+                           ASTContext &Ctx, std::shared_ptr<Preprocessor> PP,
+                           const CanonicalIncludes &CanonIncludes) {
+      if (!*Cancelled)
+        PreambleCallback(Ctx, std::move(PP), CanonIncludes);
+    };
   CppFilePreambleCallbacks SerializedDeclsCollector(FileName, PreambleCallback);
   if (Inputs.FS->setCurrentWorkingDirectory(Inputs.CompileCommand.Directory)) {
     log("Couldn't set working directory when building the preamble.");
@@ -533,25 +721,35 @@ buildPreamble(PathRef FileName, CompilerInvocation &CI,
   llvm::SmallString<32> AbsFileName(FileName);
   Inputs.FS->makeAbsolute(AbsFileName);
   auto StatCache = llvm::make_unique<PreambleFileStatusCache>(AbsFileName);
+  auto BuildFS = StatCache->getProducingFS(Inputs.FS);
+  if (Cancelled)
+    BuildFS = new CancellableFS(std::move(BuildFS), *Cancelled);
   auto BuiltPreamble = PrecompiledPreamble::Build(
-      CI, ContentsBuffer.get(), Bounds, *PreambleDiagsEngine,
-      StatCache->getProducingFS(Inputs.FS), PCHs, StoreInMemory,
-      SerializedDeclsCollector);
+      CI, ContentsBuffer.get(), Bounds, *PreambleDiagsEngine, BuildFS, PCHs,
+      StoreInMemory, SerializedDeclsCollector);
 
   // When building the AST for the main file, we do want the function
   // bodies.
   CI.getFrontendOpts().SkipFunctionBodies = false;
 
+  if (Cancelled && *Cancelled) {
+    log("Cancelled the preamble build of {0}", FileName);
+    return nullptr;
+  }
+
   if (BuiltPreamble) {
     vlog("Built preamble of size {0} for file {1}", BuiltPreamble->getSize(),
          FileName);
     std::vector<Diag> Diags = PreambleDiagnostics.take();
     for (auto &Diag : Diags)
       Diag.S = Diag::Clang;
-    return std::make_shared<PreambleData>(
+    auto Preamble = std::make_shared<PreambleData>(
         std::move(*BuiltPreamble), std::move(Diags),
         SerializedDeclsCollector.takeIncludes(), std::move(StatCache),
         SerializedDeclsCollector.takeCanonicalIncludes());
+    Preamble->CompileCommand = Inputs.CompileCommand;
+    Preamble->WatchedFileChangesVersion = ChangesVersion;
+    return Preamble;
   } else {
     elog("Could not build a preamble for file {0}", FileName);
     return nullptr;
@@ -9,13 +9,16 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_CLANGDUNIT_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_CLANGDUNIT_H
 
+#include "CodeCompletionStrings.h"
 #include "Compiler.h"
+#include "DeclOccurrences.h"
 #include "Diagnostics.h"
 #include "FS.h"
 #include "Function.h"
 #include "Headers.h"
 #include "Path.h"
 #include "Protocol.h"
+#include "Selection.h"
 #include "index/CanonicalIncludes.h"
 #include "index/Index.h"
 #include "clang/Frontend/FrontendAction.h"
@@ -24,6 +27,7 @@
 #include "clang/Serialization/ASTBitCodes.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "clang/Tooling/Core/Replacement.h"
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -62,6 +66,13 @@ struct PreambleData {
   // When reusing a preamble, this cache can be consumed to save IO.
   std::unique_ptr<PreambleFileStatusCache> StatCache;
   CanonicalIncludes CanonIncludes;
+  // The version of ParseOptions::WatchedFileChanges before the build, if set.
+  llvm::Optional<uint64_t> WatchedFileChangesVersion;
+  // Completion strings of decls from this preamble, filled by code completion.
+  std::unique_ptr<CompletionStringsCache> CompletionCache;
+  // Spellings of headers inserted by code completion and include fixes, which
+  // use the header search configuration of this preamble.
+  std::unique_ptr<IncludeSpellingCache> IncludeSpellings;
 };
 
 /// Stores and provides access to parsed AST.
@@ -99,16 +110,53 @@ public:
 
   const std::vector<Diag> &getDiagnostics() const;
 
+  /// Runs the AST matchers of the clang-tidy checks if they were deferred when
+  /// building (see ParseOptions::DeferClangTidy), adding their diagnostics.
+  /// Does nothing if they ran already.
+  void runClangTidy();
+  /// Whether runClangTidy() has anything to do.
+  bool hasPendingClangTidy() const { return Tidy != nullptr; }
+
   /// Returns the esitmated size of the AST and the accessory structures, in
   /// bytes. Does not include the size of the preamble.
   std::size_t getUsedBytes() const;
   const IncludeStructure &getIncludeStructure() const;
   const CanonicalIncludes &getCanonicalIncludes() const;
 
+  /// Returns the selection tree of the range [Begin, End) of the main file.
+  /// The last one is cached: a code action and the command it triggers select
+  /// the same range.
+  std::shared_ptr<const SelectionTree> getSelectionTree(unsigned Begin,
+                                                        unsigned End);
+
+  /// The declarations referenced in the main file. Built on first use, and
+  /// shared by all the queries on this AST.
+  const DeclOccurrences &getDeclOccurrences();
+
+  /// Storage for the document symbols of the main file. Editors ask for them
+  /// after each change, and again for the same version, so getDocumentSymbols()
+  /// computes them once per AST.
+  llvm::Optional<std::vector<DocumentSymbol>> &cachedDocumentSymbols() {
+    return DocumentSymbols;
+  }
+
+  /// Storage for the tweaks available on the last selected range, see
+  /// availableTweaks(). Editors ask for code actions on every cursor move,
+  /// often several times for the same range.
+  struct TweakCache {
+    std::pair<unsigned, unsigned> Range;
+    /// The ID and title of each available tweak.
+    std::vector<std::pair<std::string, std::string>> Tweaks;
+  };
+  llvm::Optional<TweakCache> &cachedTweaks() { return Tweaks; }
+
 private:
+  struct ClangTidyState;
+
   ParsedAST(std::shared_ptr<const PreambleData> Preamble,
             std::unique_ptr<CompilerInstance> Clang,
             std::unique_ptr<FrontendAction> Action,
+            std::unique_ptr<ClangTidyState> Tidy,
             std::vector<Decl *> LocalTopLevelDecls, std::vector<Diag> Diags,
             IncludeStructure Includes, CanonicalIncludes CanonIncludes);
 
@@ -122,6 +170,8 @@ private:
   // FrontendAction.EndSourceFile).
   std::unique_ptr<CompilerInstance> Clang;
   std::unique_ptr<FrontendAction> Action;
+  // Set while the matchers of the clang-tidy checks haven't run.
+  std::unique_ptr<ClangTidyState> Tidy;
 
   // Data, stored after parsing.
   std::vector<Diag> Diags;
@@ -130,6 +180,12 @@ private:
   std::vector<Decl *> LocalTopLevelDecls;
   IncludeStructure Includes;
   CanonicalIncludes CanonIncludes;
+  // The last result of getSelectionTree() and its range.
+  std::shared_ptr<const SelectionTree> LastSelection;
+  std::pair<unsigned, unsigned> LastSelectionRange;
+  llvm::Optional<DeclOccurrences> Occurrences;
+  llvm::Optional<std::vector<DocumentSymbol>> DocumentSymbols;
+  llvm::Optional<TweakCache> Tweaks;
 };
 
 using PreambleParsedCallback =
@@ -142,13 +198,22 @@ using PreambleParsedCallback =
 /// If \p PreambleCallback is set, it will be run on top of the AST while
 /// building the preamble. Note that if the old preamble was reused, no AST is
 /// built and, therefore, the callback will not be executed.
+/// If \p Cancelled becomes true during the build, headers that weren't read
+/// yet are treated as missing so the build ends early, the callback is not
+/// run and null is returned.
+///
+/// FIXME: files with identical preamble text and flags still get a preamble
+/// each. A preamble can't be shared with another main file: the PCH and the
+/// IncludeStructure record the main file it was built for, so locations in
+/// the preamble region and the include graph would refer to the wrong file.
 std::shared_ptr<const PreambleData>
 buildPreamble(PathRef FileName, CompilerInvocation &CI,
               std::shared_ptr<const PreambleData> OldPreamble,
               const tooling::CompileCommand &OldCompileCommand,
               const ParseInputs &Inputs,
               std::shared_ptr<PCHContainerOperations> PCHs, bool StoreInMemory,
-              PreambleParsedCallback PreambleCallback);
+              PreambleParsedCallback PreambleCallback,
+              const std::atomic<bool> *Cancelled = nullptr);
 
 /// Build an AST from provided user inputs. This function does not check if
 /// preamble can be reused, as this function expects that \p Preamble is the
@@ -37,6 +37,8 @@
 #include "index/Symbol.h"
 #include "clang/AST/Decl.h"
 #include "clang/AST/DeclBase.h"
+#include "clang/AST/DeclObjC.h"
+#include "clang/Basic/CharInfo.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Format/Format.h"
@@ -261,8 +263,9 @@ struct ScoredBundleGreater {
 // computed from the first candidate, in the constructor.
 // Others vary per candidate, so add() must be called for remaining candidates.
 struct CodeCompletionBuilder {
-  CodeCompletionBuilder(ASTContext &ASTCtx, const CompletionCandidate &C,
-                        CodeCompletionString *SemaCCS,
+  // ASTCtx can be nullptr if no candidate has a Sema result.
+  CodeCompletionBuilder(ASTContext *ASTCtx, const CompletionCandidate &C,
+                        const CompletionStrings *SemaStrings,
                         llvm::ArrayRef<std::string> QueryScopes,
                         const IncludeInserter &Includes,
                         llvm::StringRef FileName,
@@ -270,10 +273,10 @@ struct CodeCompletionBuilder {
                         const CodeCompleteOptions &Opts)
       : ASTCtx(ASTCtx), ExtractDocumentation(Opts.IncludeComments),
         EnableFunctionArgSnippets(Opts.EnableFunctionArgSnippets) {
-    add(C, SemaCCS);
+    add(C, SemaStrings);
     if (C.SemaResult) {
       Completion.Origin |= SymbolOrigin::AST;
-      Completion.Name = llvm::StringRef(SemaCCS->getTypedText());
+      Completion.Name = SemaStrings->TypedText;
       if (Completion.Scope.empty()) {
         if ((C.SemaResult->Kind == CodeCompletionResult::RK_Declaration) ||
             (C.SemaResult->Kind == CodeCompletionResult::RK_Pattern))
@@ -290,8 +293,8 @@ struct CodeCompletionBuilder {
           Completion.Name.back() == '/')
         Completion.Kind = CompletionItemKind::Folder;
       for (const auto &FixIt : C.SemaResult->FixIts) {
-        Completion.FixIts.push_back(
-            toTextEdit(FixIt, ASTCtx.getSourceManager(), ASTCtx.getLangOpts()));
+        Completion.FixIts.push_back(toTextEdit(
+            FixIt, ASTCtx->getSourceManager(), ASTCtx->getLangOpts()));
       }
       llvm::sort(Completion.FixIts, [](const TextEdit &X, const TextEdit &Y) {
         return std::tie(X.range.start.line, X.range.start.character) <
@@ -341,6 +344,9 @@ struct CodeCompletionBuilder {
     // Calculate include paths and edits for all possible headers.
     for (const auto &Inc : C.RankedIncludeHeaders) {
       if (auto ToInclude = Inserted(Inc)) {
+        // Without Sema, headers that were never spelled before are skipped.
+        if (ToInclude->first.empty())
+          continue;
         CodeCompletion::IncludeCandidate Include;
         Include.Header = ToInclude->first;
         if (ToInclude->second && ShouldInsert)
@@ -359,14 +365,15 @@ struct CodeCompletionBuilder {
                           });
   }
 
-  void add(const CompletionCandidate &C, CodeCompletionString *SemaCCS) {
-    assert(bool(C.SemaResult) == bool(SemaCCS));
+  void add(const CompletionCandidate &C, const CompletionStrings *SemaStrings) {
+    assert(bool(C.SemaResult) == bool(SemaStrings));
     Bundled.emplace_back();
     BundledEntry &S = Bundled.back();
     if (C.SemaResult) {
-      getSignature(*SemaCCS, &S.Signature, &S.SnippetSuffix,
-                   &Completion.RequiredQualifier);
-      S.ReturnType = getReturnType(*SemaCCS);
+      S.Signature = SemaStrings->Signature;
+      S.SnippetSuffix = SemaStrings->SnippetSuffix;
+      Completion.RequiredQualifier = SemaStrings->RequiredQualifier;
+      S.ReturnType = SemaStrings->ReturnType;
     } else if (C.IndexResult) {
       S.Signature = C.IndexResult->Signature;
       S.SnippetSuffix = C.IndexResult->CompletionSnippetSuffix;
@@ -376,7 +383,7 @@ struct CodeCompletionBuilder {
       if (C.IndexResult)
         Completion.Documentation = C.IndexResult->Documentation;
       else if (C.SemaResult)
-        Completion.Documentation = getDocComment(ASTCtx, *C.SemaResult,
+        Completion.Documentation = getDocComment(*ASTCtx, *C.SemaResult,
                                                  /*CommentsFromHeader=*/false);
     }
   }
@@ -471,7 +478,7 @@ private:
     return "(…)";
   }
 
-  ASTContext &ASTCtx;
+  ASTContext *ASTCtx;
   CodeCompletion Completion;
   llvm::SmallVector<BundledEntry, 1> Bundled;
   bool ExtractDocumentation;
@@ -661,7 +668,8 @@ static bool isBlacklistedMember(const NamedDecl &D) {
 }
 
 // The CompletionRecorder captures Sema code-complete output, including context.
-// It filters out ignored results (but doesn't apply fuzzy-filtering yet).
+// It filters out ignored results, and those whose name doesn't match the
+// filter text when that's cheap to check (fuzzy-scoring happens later).
 // It doesn't do scoring or conversion to CompletionItem yet, as we want to
 // merge with index results first.
 // Generally the fields and methods of this object should only be used from
@@ -713,10 +721,22 @@ struct CompletionRecorder : public CodeCompleteConsumer {
     // Record the completion context.
     CCSema = &S;
     CCContext = Context;
+    // Most results of global-scope completion don't match the typed filter.
+    // Dropping them now avoids building their candidates (and sometimes their
+    // CodeCompletionStrings) only to discard them in scoring.
+    llvm::StringRef FilterText = S.getPreprocessor().getCodeCompletionFilter();
+    llvm::Optional<FuzzyMatcher> Filter;
+    if (!FilterText.empty())
+      Filter.emplace(FilterText);
 
     // Retain the results we might want.
     for (unsigned I = 0; I < NumResults; ++I) {
       auto &Result = InResults[I];
+      if (Filter) {
+        llvm::StringRef Name = getNameIfCheap(Result);
+        if (!Name.empty() && !Filter->match(Name))
+          continue;
+      }
       // Class members that are shadowed by subclasses are usually noise.
       if (Result.Hidden && Result.Declaration &&
           Result.Declaration->isCXXClassMember())
@@ -747,6 +767,16 @@ struct CompletionRecorder : public CodeCompleteConsumer {
   // Returns the filtering/sorting name for Result, which must be from Results.
   // Returned string is owned by this recorder (or the AST).
   llvm::StringRef getName(const CodeCompletionResult &Result) {
+    llvm::StringRef Name = getNameIfCheap(Result);
+    if (!Name.empty())
+      return Name;
+    auto *CCS = codeCompletionString(Result);
+    return CCS->getTypedText();
+  }
+
+  // Returns the filtering/sorting name for Result if it's available without
+  // building a CodeCompletionString (e.g. not for operators), or "".
+  static llvm::StringRef getNameIfCheap(const CodeCompletionResult &Result) {
     switch (Result.Kind) {
     case CodeCompletionResult::RK_Declaration:
       if (auto *ID = Result.Declaration->getIdentifier())
@@ -759,8 +789,7 @@ struct CompletionRecorder : public CodeCompleteConsumer {
     case CodeCompletionResult::RK_Pattern:
       return Result.Pattern->getTypedText();
     }
-    auto *CCS = codeCompletionString(Result);
-    return CCS->getTypedText();
+    return "";
   }
 
   // Build a CodeCompletion string for R, which must be from Results.
@@ -1123,6 +1152,31 @@ speculativeFuzzyFindRequestForCompletion(FuzzyFindRequest CachedReq,
   return CachedReq;
 }
 
+// Whether the results of Cached contain all results of Req: Cached must differ
+// only by a query that Req's query extends, and must not have been truncated.
+// The index must not have changed since, it's now at Generation.
+bool canReuseResults(const CachedFuzzyFindResults &Cached,
+                     const FuzzyFindRequest &Req, uint64_t Generation) {
+  if (Cached.Incomplete || Cached.Generation != Generation ||
+      !llvm::StringRef(Req.Query).startswith(Cached.Req.Query))
+    return false;
+  FuzzyFindRequest Relaxed = Req;
+  Relaxed.Query = Cached.Req.Query;
+  return Relaxed == Cached.Req;
+}
+
+// Answers Req from cached results, see canReuseResults().
+SymbolSlab refilterCachedResults(const CachedFuzzyFindResults &Cached,
+                                 const FuzzyFindRequest &Req) {
+  trace::Span Tracer("Refilter cached index results");
+  FuzzyMatcher Filter(Req.Query);
+  SymbolSlab::Builder Matches;
+  for (const Symbol &Sym : *Cached.Symbols)
+    if (Filter.match(Sym.Name))
+      Matches.insert(Sym);
+  return std::move(Matches).build();
+}
+
 // Runs Sema-based (AST) and Index-based completion, returns merged results.
 //
 // There are a few tricky considerations:
@@ -1161,18 +1215,23 @@ class CodeCompleteFlow {
   // Sema takes ownership of Recorder. Recorder is valid until Sema cleanup.
   CompletionRecorder *Recorder = nullptr;
   int NSema = 0, NIndex = 0, NBoth = 0; // Counters for logging.
+  // Initialized once Sema runs, or guessed without Sema.
+  CodeCompletionContext::Kind CCContextKind = CodeCompletionContext::CCC_Other;
   bool Incomplete = false;       // Would more be available with a higher limit?
   llvm::Optional<FuzzyMatcher> Filter;  // Initialized once Sema runs.
   std::vector<std::string> QueryScopes; // Initialized once Sema runs.
   // Initialized once QueryScopes is initialized, if there are scopes.
   llvm::Optional<ScopeDistance> ScopeProximity;
-  llvm::Optional<OpaqueType> PreferredType; // Initialized once Sema runs.
+  // Initialized once Sema runs.
+  llvm::Optional<PreferredTypeMatcher> PreferredType;
   // Whether to query symbols from any scope. Initialized once Sema runs.
   bool AllScopes = false;
   // Include-insertion and proximity scoring rely on the include structure.
   // This is available after Sema has run.
   llvm::Optional<IncludeInserter> Inserter;  // Available during runWithSema.
-  llvm::Optional<URIDistance> FileProximity; // Initialized once Sema runs.
+  std::unique_ptr<URIDistance> FileProximity; // Initialized once Sema runs.
+  // Completion strings of preamble decls, shared with other requests.
+  CompletionStringsCache *StringsCache = nullptr; // Can be nullptr.
   /// Speculative request based on the cached request and the filter text before
   /// the cursor.
   /// Initialized right before sema run. This is only set if `SpecFuzzyFind` is
@@ -1189,11 +1248,17 @@ public:
 
   CodeCompleteResult run(const SemaCompleteInput &SemaCCInput) && {
     trace::Span Tracer("CodeCompleteFlow");
+    if (SemaCCInput.Preamble)
+      StringsCache = SemaCCInput.Preamble->CompletionCache.get();
     if (Opts.Index && SpecFuzzyFind && SpecFuzzyFind->CachedReq.hasValue()) {
       assert(!SpecFuzzyFind->Result.valid());
       if ((SpecReq = speculativeFuzzyFindRequestForCompletion(
                *SpecFuzzyFind->CachedReq, SemaCCInput.FileName,
-               SemaCCInput.Contents, SemaCCInput.Pos)))
+               SemaCCInput.Contents, SemaCCInput.Pos)) &&
+          // No need to speculate if we'll answer from cached results.
+          !(SpecFuzzyFind->CachedResults &&
+            canReuseResults(*SpecFuzzyFind->CachedResults, *SpecReq,
+                            Opts.Index->generation())))
         SpecFuzzyFind->Result = startAsyncFuzzyFind(*Opts.Index, *SpecReq);
     }
 
@@ -1210,30 +1275,18 @@ public:
       Inserter.emplace(
           SemaCCInput.FileName, SemaCCInput.Contents, Style,
           SemaCCInput.Command.Directory,
-          Recorder->CCSema->getPreprocessor().getHeaderSearchInfo());
+          Recorder->CCSema->getPreprocessor().getHeaderSearchInfo(),
+          SemaCCInput.Preamble ? SemaCCInput.Preamble->IncludeSpellings.get()
+                               : nullptr);
       for (const auto &Inc : Includes.MainFileIncludes)
         Inserter->addExisting(Inc);
 
-      // Most of the cost of file proximity is in initializing the FileDistance
-      // structures based on the observed includes, once per query. Conceptually
-      // that happens here (though the per-URI-scheme initialization is lazy).
-      // The per-result proximity scoring is (amortized) very cheap.
-      FileDistanceOptions ProxOpts{}; // Use defaults.
       const auto &SM = Recorder->CCSema->getSourceManager();
-      llvm::StringMap<SourceParams> ProxSources;
-      for (auto &Entry : Includes.includeDepth(
-               SM.getFileEntryForID(SM.getMainFileID())->getName())) {
-        auto &Source = ProxSources[Entry.getKey()];
-        Source.Cost = Entry.getValue() * ProxOpts.IncludeCost;
-        // Symbols near our transitive includes are good, but only consider
-        // things in the same directory or below it. Otherwise there can be
-        // many false positives.
-        if (Entry.getValue() > 0)
-          Source.MaxUpTraversals = 1;
-      }
-      FileProximity.emplace(ProxSources, ProxOpts);
+      initFileProximity(SM.getFileEntryForID(SM.getMainFileID())->getName());
 
       Output = runWithSema();
+      if (Opts.ProximityCache)
+        Opts.ProximityCache->put(FileName, std::move(FileProximity));
       Inserter.reset(); // Make sure this doesn't out-live Clang.
       SPAN_ATTACH(Tracer, "sema_completion_kind",
                   getCompletionKindString(Recorder->CCContext.getKind()));
@@ -1265,7 +1318,83 @@ public:
     return Output;
   }
 
+  // Answers from the index alone, with the scopes of the cached request of
+  // SpecFuzzyFind and the identifier before the cursor as filter. The results
+  // are always incomplete: Sema may know better.
+  CodeCompleteResult runWithoutSema(const SemaCompleteInput &Input,
+                                    llvm::StringRef FilterText,
+                                    size_t Offset) && {
+    trace::Span Tracer("CodeCompleteFlow without Sema");
+    assert(SpecFuzzyFind && SpecFuzzyFind->CachedReq);
+    CCContextKind = CodeCompletionContext::CCC_Recovery;
+    Filter = FuzzyMatcher(FilterText);
+    QueryScopes = SpecFuzzyFind->CachedReq->Scopes;
+    AllScopes = SpecFuzzyFind->CachedReq->AnyScope;
+    if (!QueryScopes.empty())
+      ScopeProximity.emplace(QueryScopes);
+    // Headers can only be spelled if an earlier request with the same preamble
+    // spelled them.
+    auto Style =
+        getFormatStyleForFile(Input.FileName, Input.Contents, Input.VFS.get());
+    Inserter.emplace(Input.FileName, Input.Contents, Style,
+                     Input.Command.Directory,
+                     Input.Preamble ? Input.Preamble->IncludeSpellings.get()
+                                    : nullptr);
+    for (const auto &Inc : Includes.MainFileIncludes)
+      Inserter->addExisting(Inc);
+    initFileProximity(FileName);
+
+    Range TextEditRange;
+    TextEditRange.start = TextEditRange.end = Input.Pos;
+    TextEditRange.start.character -= FilterText.size();
+    while (Offset < Input.Contents.size() &&
+           isIdentifierBody(Input.Contents[Offset])) {
+      ++Offset;
+      ++TextEditRange.end.character;
+    }
+
+    auto IndexResults = queryIndex();
+    auto Top = mergeResults(/*SemaResults=*/{}, *IndexResults);
+    CodeCompleteResult Output = toCodeCompleteResult(Top, TextEditRange);
+    Output.HasMore = true;
+    if (Opts.ProximityCache)
+      Opts.ProximityCache->put(FileName, std::move(FileProximity));
+    Inserter.reset();
+
+    SPAN_ATTACH(Tracer, "index_results", NIndex);
+    SPAN_ATTACH(Tracer, "returned_results", int64_t(Output.Completions.size()));
+    log("Code complete without Sema: {0} results from Index, {1} returned.",
+        NIndex, Output.Completions.size());
+    return Output;
+  }
+
 private:
+  // Most of the cost of file proximity is in initializing the FileDistance
+  // structures based on the observed includes, once per query. Conceptually
+  // that happens here (though the per-URI-scheme initialization is lazy).
+  // The per-result proximity scoring is (amortized) very cheap.
+  void initFileProximity(llvm::StringRef MainFile) {
+    FileDistanceOptions ProxOpts{}; // Use defaults.
+    llvm::StringMap<SourceParams> ProxSources;
+    for (auto &Entry : Includes.includeDepth(MainFile)) {
+      auto &Source = ProxSources[Entry.getKey()];
+      Source.Cost = Entry.getValue() * ProxOpts.IncludeCost;
+      // Symbols near our transitive includes are good, but only consider
+      // things in the same directory or below it. Otherwise there can be
+      // many false positives.
+      if (Entry.getValue() > 0)
+        Source.MaxUpTraversals = 1;
+    }
+    // The include structure rarely changes between completions in a file, so
+    // the structures (and distances to index results) can often be reused.
+    if (Opts.ProximityCache)
+      FileProximity =
+          Opts.ProximityCache->take(FileName, std::move(ProxSources));
+    else
+      FileProximity =
+          llvm::make_unique<URIDistance>(std::move(ProxSources), ProxOpts);
+  }
+
   // This is called by run() once Sema code completion is done, but before the
   // Sema data structures are torn down. It does all the real work.
   CodeCompleteResult runWithSema() {
@@ -1286,6 +1415,7 @@ private:
           Recorder->CCSema->getPreprocessor().getCodeCompletionLoc());
       TextEditRange.start = TextEditRange.end = Pos;
     }
+    CCContextKind = Recorder->CCContext.getKind();
     Filter = FuzzyMatcher(
         Recorder->CCSema->getPreprocessor().getCodeCompletionFilter());
     std::tie(QueryScopes, AllScopes) =
@@ -1293,8 +1423,8 @@ private:
     if (!QueryScopes.empty())
       ScopeProximity.emplace(QueryScopes);
     PreferredType =
-        OpaqueType::fromType(Recorder->CCSema->getASTContext(),
-                             Recorder->CCContext.getPreferredType());
+        PreferredTypeMatcher::create(Recorder->CCSema->getASTContext(),
+                                     Recorder->CCContext.getPreferredType());
     // Sema provides the needed context to query the index.
     // FIXME: in addition to querying for extra/overlapping symbols, we should
     //        explicitly request symbols corresponding to Sema results.
@@ -1302,12 +1432,16 @@ private:
     // We must copy index results to preserve them, but there are at most Limit.
     auto IndexResults = (Opts.Index && allowIndex(Recorder->CCContext))
                             ? queryIndex()
-                            : SymbolSlab();
+                            : std::make_shared<const SymbolSlab>();
     trace::Span Tracer("Populate CodeCompleteResult");
     // Merge Sema and Index results, score them, and pick the winners.
-    auto Top = mergeResults(Recorder->Results, IndexResults);
-    CodeCompleteResult Output;
+    auto Top = mergeResults(Recorder->Results, *IndexResults);
+    return toCodeCompleteResult(Top, TextEditRange);
+  }
 
+  CodeCompleteResult toCodeCompleteResult(const std::vector<ScoredBundle> &Top,
+                                          const Range &TextEditRange) {
+    CodeCompleteResult Output;
     // Convert the results to final form, assembling the expensive strings.
     for (auto &C : Top) {
       Output.Completions.push_back(toCodeCompletion(C.first));
@@ -1315,12 +1449,11 @@ private:
       Output.Completions.back().CompletionTokenRange = TextEditRange;
     }
     Output.HasMore = Incomplete;
-    Output.Context = Recorder->CCContext.getKind();
-
+    Output.Context = CCContextKind;
     return Output;
   }
 
-  SymbolSlab queryIndex() {
+  std::shared_ptr<const SymbolSlab> queryIndex() {
     trace::Span Tracer("Query index");
     SPAN_ATTACH(Tracer, "limit", int64_t(Opts.Limit));
 
@@ -1335,28 +1468,59 @@ private:
     // FIXME: we should send multiple weighted paths here.
     Req.ProximityPaths.push_back(FileName);
     if (PreferredType)
-      Req.PreferredTypes.push_back(PreferredType->raw());
+      Req.PreferredTypes.push_back(PreferredType->encoded().raw());
     vlog("Code complete: fuzzyFind({0:2})", toJSON(Req));
 
     if (SpecFuzzyFind)
       SpecFuzzyFind->NewReq = Req;
+    // Read before querying: results must not outlive the index they came from.
+    uint64_t Generation = Opts.Index->generation();
+    if (SpecFuzzyFind && SpecFuzzyFind->CachedResults &&
+        canReuseResults(*SpecFuzzyFind->CachedResults, Req, Generation)) {
+      vlog("Code complete: re-filtering {0} cached index results.",
+           SpecFuzzyFind->CachedResults->Symbols->size());
+      SPAN_ATTACH(Tracer, "Cached results", true);
+      return rememberResults(
+          Req, refilterCachedResults(*SpecFuzzyFind->CachedResults, Req),
+          /*More=*/false, Generation);
+    }
     if (SpecFuzzyFind && SpecFuzzyFind->Result.valid() && (*SpecReq == Req)) {
       vlog("Code complete: speculative fuzzy request matches the actual index "
            "request. Waiting for the speculative index results.");
       SPAN_ATTACH(Tracer, "Speculative results", true);
 
       trace::Span WaitSpec("Wait speculative results");
-      return SpecFuzzyFind->Result.get();
+      // We don't know whether the speculative results were truncated.
+      return rememberResults(Req, SpecFuzzyFind->Result.get(), /*More=*/true,
+                             Generation);
     }
 
     SPAN_ATTACH(Tracer, "Speculative results", false);
 
     // Run the query against the index.
     SymbolSlab::Builder ResultsBuilder;
-    if (Opts.Index->fuzzyFind(
-            Req, [&](const Symbol &Sym) { ResultsBuilder.insert(Sym); }))
+    bool More = Opts.Index->fuzzyFind(
+        Req, [&](const Symbol &Sym) { ResultsBuilder.insert(Sym); });
+    if (More)
       Incomplete = true;
-    return std::move(ResultsBuilder).build();
+    return rememberResults(Req, std::move(ResultsBuilder).build(), More,
+                           Generation);
+  }
+
+  // Shares index results with the caller, so later completions can reuse them.
+  std::shared_ptr<const SymbolSlab>
+  rememberResults(const FuzzyFindRequest &Req, SymbolSlab Symbols, bool More,
+                  uint64_t Generation) {
+    auto Shared = std::make_shared<const SymbolSlab>(std::move(Symbols));
+    if (SpecFuzzyFind && Opts.ReuseIndexResults) {
+      auto Results = std::make_shared<CachedFuzzyFindResults>();
+      Results->Req = Req;
+      Results->Symbols = Shared;
+      Results->Incomplete = More;
+      Results->Generation = Generation;
+      SpecFuzzyFind->NewResults = std::move(Results);
+    }
+    return Shared;
   }
 
   // Merges Sema and Index results where possible, to form CompletionCandidates.
@@ -1400,7 +1564,7 @@ private:
       return nullptr;
     };
     // Emit all Sema results, merging them with Index results if possible.
-    for (auto &SemaResult : Recorder->Results)
+    for (auto &SemaResult : SemaResults)
       AddToBundles(&SemaResult, CorrespondingIndexResult(SemaResult));
     // Now emit any Index-only results.
     for (const auto &IndexResult : IndexResults) {
@@ -1430,9 +1594,9 @@ private:
                     CompletionCandidate::Bundle Bundle) {
     SymbolQualitySignals Quality;
     SymbolRelevanceSignals Relevance;
-    Relevance.Context = Recorder->CCContext.getKind();
+    Relevance.Context = CCContextKind;
     Relevance.Query = SymbolRelevanceSignals::CodeComplete;
-    Relevance.FileProximityMatch = FileProximity.getPointer();
+    Relevance.FileProximityMatch = FileProximity.get();
     if (ScopeProximity)
       Relevance.ScopeProximityMatch = ScopeProximity.getPointer();
     if (PreferredType)
@@ -1454,7 +1618,7 @@ private:
         if (!Candidate.IndexResult->Type.empty())
           Relevance.HadSymbolType |= true;
         if (PreferredType &&
-            PreferredType->raw() == Candidate.IndexResult->Type) {
+            PreferredType->encoded().raw() == Candidate.IndexResult->Type) {
           Relevance.TypeMatchesPreferred = true;
         }
       }
@@ -1462,10 +1626,9 @@ private:
         Quality.merge(*Candidate.SemaResult);
         Relevance.merge(*Candidate.SemaResult);
         if (PreferredType) {
-          if (auto CompletionType = OpaqueType::fromCompletionResult(
-                  Recorder->CCSema->getASTContext(), *Candidate.SemaResult)) {
+          if (auto Matches = PreferredType->matches(*Candidate.SemaResult)) {
             Relevance.HadSymbolType |= true;
-            if (PreferredType == CompletionType)
+            if (*Matches)
               Relevance.TypeMatchesPreferred = true;
           }
         }
@@ -1493,18 +1656,39 @@ private:
       Incomplete = true;
   }
 
+  // Renders the strings of a Sema result, or reuses them from the preamble's
+  // cache when they can't depend on this request.
+  CompletionStrings semaCompletionStrings(const CodeCompletionResult &R) {
+    llvm::Optional<SymbolID> ID;
+    if (StringsCache && R.Kind == CodeCompletionResult::RK_Declaration &&
+        !R.Qualifier && !isa<ObjCMethodDecl>(R.Declaration) &&
+        !isa<ObjCPropertyDecl>(R.Declaration) &&
+        Recorder->CCSema->getSourceManager().isLoadedSourceLocation(
+            R.Declaration->getLocation()))
+      ID = getSymbolID(R.Declaration);
+    if (ID)
+      if (auto Cached = StringsCache->get(*ID, R.StartParameter))
+        return std::move(*Cached);
+    auto Strings = getCompletionStrings(*Recorder->codeCompletionString(R));
+    if (ID)
+      StringsCache->put(*ID, R.StartParameter, Strings);
+    return Strings;
+  }
+
   CodeCompletion toCodeCompletion(const CompletionCandidate::Bundle &Bundle) {
     llvm::Optional<CodeCompletionBuilder> Builder;
     for (const auto &Item : Bundle) {
-      CodeCompletionString *SemaCCS =
-          Item.SemaResult ? Recorder->codeCompletionString(*Item.SemaResult)
-                          : nullptr;
+      llvm::Optional<CompletionStrings> SemaStrings;
+      if (Item.SemaResult)
+        SemaStrings = semaCompletionStrings(*Item.SemaResult);
+      const CompletionStrings *SemaStringsPtr =
+          SemaStrings ? SemaStrings.getPointer() : nullptr;
       if (!Builder)
-        Builder.emplace(Recorder->CCSema->getASTContext(), Item, SemaCCS,
-                        QueryScopes, *Inserter, FileName,
-                        Recorder->CCContext.getKind(), Opts);
+        Builder.emplace(Recorder ? &Recorder->CCSema->getASTContext() : nullptr,
+                        Item, SemaStringsPtr, QueryScopes, *Inserter, FileName,
+                        CCContextKind, Opts);
       else
-        Builder->add(Item, SemaCCS);
+        Builder->add(Item, SemaStringsPtr);
     }
     return Builder->build();
   }
@@ -1576,6 +1760,116 @@ codeComplete(PathRef FileName, const tooling::CompileCommand &Command,
       .run({FileName, Command, Preamble, Contents, Pos, VFS, PCHs});
 }
 
+// Whether the scopes of CachedReq fit a completion whose identifier starts at
+// FilterStart in Content: it must not be a member access, and must have the
+// same qualifier as the completion that made CachedReq. Qualifiers are only
+// compared as written, e.g. `ns::` to the scope "ns::".
+static bool canUseCachedScopes(llvm::StringRef Content, size_t FilterStart,
+                               const FuzzyFindRequest &CachedReq) {
+  llvm::StringRef Before = Content.take_front(FilterStart).rtrim();
+  if (Before.endswith(".") || Before.endswith("->"))
+    return false;
+  if (!Before.endswith("::"))
+    return llvm::is_contained(CachedReq.Scopes, "");
+  size_t QualifierStart = Before.size();
+  while (QualifierStart > 0 && (isIdentifierBody(Before[QualifierStart - 1]) ||
+                                Before[QualifierStart - 1] == ':'))
+    --QualifierStart;
+  // E.g. `vector<int>::` or `decltype(x)::`.
+  if (QualifierStart > 0 && (Before[QualifierStart - 1] == '>' ||
+                             Before[QualifierStart - 1] == ')'))
+    return false;
+  llvm::StringRef Qualifier = Before.drop_front(QualifierStart);
+  Qualifier.consume_front("::");
+  return !CachedReq.AnyScope && CachedReq.Scopes.size() == 1 &&
+         CachedReq.Scopes.front() == Qualifier;
+}
+
+llvm::Optional<CodeCompleteResult>
+codeCompleteFromIndex(PathRef FileName, const tooling::CompileCommand &Command,
+                      const PreambleData *Preamble, llvm::StringRef Contents,
+                      Position Pos,
+                      llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS,
+                      CodeCompleteOptions Opts,
+                      SpeculativeFuzzyFind &SpecFuzzyFind) {
+  if (!Opts.Index || !SpecFuzzyFind.CachedReq)
+    return None;
+  auto Offset = positionToOffset(Contents, Pos);
+  if (!Offset) {
+    vlog("Code complete without Sema: {0}", Offset.takeError());
+    return None;
+  }
+  auto Filter = speculateCompletionFilter(Contents, Pos);
+  if (!Filter) {
+    vlog("Code complete without Sema: {0}", Filter.takeError());
+    return None;
+  }
+  if (!canUseCachedScopes(Contents, *Offset - Filter->size(),
+                          *SpecFuzzyFind.CachedReq))
+    return None;
+  return CodeCompleteFlow(FileName,
+                          Preamble ? Preamble->Includes : IncludeStructure(),
+                          &SpecFuzzyFind, Opts)
+      .runWithoutSema({FileName, Command, Preamble, Contents, Pos, VFS,
+                       /*PCHs=*/nullptr},
+                      *Filter, *Offset);
+}
+
+llvm::Optional<CodeCompleteResult>
+refilterCompletions(const PastCompletion &Earlier,
+                    llvm::StringRef Contents, Position Pos,
+                    const CodeCompleteOptions &Opts) {
+  // Items missing from an incomplete result may match the longer filter.
+  if (Earlier.Result.HasMore || Pos.line != Earlier.Pos.line)
+    return None;
+  auto EarlierOffset = positionToOffset(Earlier.Contents, Earlier.Pos);
+  auto EarlierFilter = speculateCompletionFilter(Earlier.Contents, Earlier.Pos);
+  auto Offset = positionToOffset(Contents, Pos);
+  auto Filter = speculateCompletionFilter(Contents, Pos);
+  if (!EarlierOffset || !EarlierFilter || !Offset || !Filter) {
+    llvm::consumeError(EarlierOffset.takeError());
+    llvm::consumeError(EarlierFilter.takeError());
+    llvm::consumeError(Offset.takeError());
+    llvm::consumeError(Filter.takeError());
+    return None;
+  }
+  // The identifier must start at the same place, after the same text.
+  size_t Start = *EarlierOffset - EarlierFilter->size();
+  if (*Offset - Filter->size() != Start ||
+      !Filter->startswith(*EarlierFilter) ||
+      Contents.take_front(Start) !=
+          llvm::StringRef(Earlier.Contents).take_front(Start))
+    return None;
+
+  trace::Span Tracer("Refilter completions");
+  CodeCompleteResult Result;
+  Result.Context = Earlier.Result.Context;
+  FuzzyMatcher Matcher(*Filter);
+  for (const CodeCompletion &C : Earlier.Result.Completions) {
+    auto NameMatch = Matcher.match(C.Name);
+    if (!NameMatch)
+      continue;
+    Result.Completions.push_back(C);
+    CodeCompletion::Scores &Score = Result.Completions.back().Score;
+    Score.Total = Score.ExcludingName * *NameMatch;
+    if (Score.Quality)
+      Score.Relevance = Score.Total / Score.Quality;
+    Result.Completions.back().CompletionTokenRange.end.character +=
+        Pos.character - Earlier.Pos.character;
+  }
+  llvm::sort(Result.Completions,
+             [](const CodeCompletion &L, const CodeCompletion &R) {
+               if (L.Score.Total != R.Score.Total)
+                 return L.Score.Total > R.Score.Total;
+               return L.Name < R.Name;
+             });
+  if (Opts.Limit && Result.Completions.size() > Opts.Limit) {
+    Result.Completions.resize(Opts.Limit);
+    Result.HasMore = true;
+  }
+  return Result;
+}
+
 SignatureHelp signatureHelp(PathRef FileName,
                             const tooling::CompileCommand &Command,
                             const PreambleData *Preamble,
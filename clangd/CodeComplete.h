@@ -16,6 +16,7 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_CODECOMPLETE_H
 
 #include "ClangdUnit.h"
+#include "FileDistance.h"
 #include "Headers.h"
 #include "Logger.h"
 #include "Path.h"
@@ -32,6 +33,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
 #include <future>
+#include <memory>
 
 namespace clang {
 class NamedDecl;
@@ -89,6 +91,19 @@ struct CodeCompleteOptions {
   /// this should be effective for a number of code completions.
   bool SpeculativeIndexRequest = false;
 
+  /// If set to true, the index results of the last code completion on the same
+  /// file are reused while the user keeps typing: if the new index request only
+  /// extends the query of the last one, and the last results were not
+  /// truncated, they are re-filtered instead of querying the index again.
+  bool ReuseIndexResults = false;
+
+  /// If set, a completion is answered right away from the index alone, with
+  /// the scopes of the last code completion in the file, when these fit the
+  /// text before the cursor. This answer is marked incomplete. Sema code
+  /// completion still runs afterwards, and later completions continuing the
+  /// same identifier are answered from its results.
+  bool IndexResultsFirst = false;
+
   // Populated internally by clangd, do not set.
   /// If `Index` is set, it is used to augment the code completion
   /// results.
@@ -96,6 +111,11 @@ struct CodeCompleteOptions {
   /// clangd.
   const SymbolIndex *Index = nullptr;
 
+  // Populated internally by clangd, do not set.
+  /// If set, the file proximity data of a completion is kept here, and reused
+  /// by the next completion in the same file while its includes don't change.
+  URIDistanceCache *ProximityCache = nullptr;
+
   /// Include completions that require small corrections, e.g. change '.' to
   /// '->' on member access etc.
   bool IncludeFixIts = false;
@@ -200,6 +220,17 @@ struct CodeCompleteResult {
 };
 raw_ostream &operator<<(raw_ostream &, const CodeCompleteResult &);
 
+/// Index results of a past code completion, see
+/// CodeCompleteOptions::ReuseIndexResults.
+struct CachedFuzzyFindResults {
+  FuzzyFindRequest Req;
+  std::shared_ptr<const SymbolSlab> Symbols;
+  /// Whether the index had more results than Req.Limit.
+  bool Incomplete = true;
+  /// The SymbolIndex::generation() of the index when the query ran.
+  uint64_t Generation = 0;
+};
+
 /// A speculative and asynchronous fuzzy find index request (based on cached
 /// request) that can be sent before parsing sema. This would reduce completion
 /// latency if the speculation succeeds.
@@ -210,6 +241,12 @@ struct SpeculativeFuzzyFind {
   /// The actual request used by `codeComplete()`.
   /// Set by `codeComplete()`. This can be used by callers to update cache.
   llvm::Optional<FuzzyFindRequest> NewReq;
+  /// Cached results from past code completions, if ReuseIndexResults is set.
+  /// Set by caller of `codeComplete()`.
+  std::shared_ptr<const CachedFuzzyFindResults> CachedResults;
+  /// The index results used by `codeComplete()`, if ReuseIndexResults is set.
+  /// Set by `codeComplete()`. This can be used by callers to update cache.
+  std::shared_ptr<const CachedFuzzyFindResults> NewResults;
   /// The result is consumed by `codeComplete()` if speculation succeeded.
   /// NOTE: the destructor will wait for the async call to finish.
   std::future<SymbolSlab> Result;
@@ -230,6 +267,34 @@ CodeCompleteResult codeComplete(PathRef FileName,
                                 CodeCompleteOptions Opts,
                                 SpeculativeFuzzyFind *SpecFuzzyFind = nullptr);
 
+/// Answers a code completion at \p Pos from the index alone, using the scopes
+/// of SpecFuzzyFind.CachedReq. Returns None if they may not apply: there is no
+/// cached request, the completion is a member access, or its qualifier differs
+/// from the one of the cached request. Results are marked incomplete.
+llvm::Optional<CodeCompleteResult>
+codeCompleteFromIndex(PathRef FileName, const tooling::CompileCommand &Command,
+                      const PreambleData *Preamble, StringRef Contents,
+                      Position Pos,
+                      IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS,
+                      CodeCompleteOptions Opts,
+                      SpeculativeFuzzyFind &SpecFuzzyFind);
+
+/// A code completion and the file contents it ran on.
+struct PastCompletion {
+  std::string Contents;
+  Position Pos;
+  CodeCompleteResult Result;
+};
+
+/// Answers a code completion at \p Pos in \p Contents from the results of an
+/// earlier one, if it continues the identifier completed by \p Earlier and
+/// the text before that identifier didn't change and \p Earlier is complete.
+/// The results are scored again with the longer filter text, then truncated
+/// to the limit in \p Opts.
+llvm::Optional<CodeCompleteResult>
+refilterCompletions(const PastCompletion &Earlier, StringRef Contents,
+                    Position Pos, const CodeCompleteOptions &Opts);
+
 /// Get signature help at a specified \p Pos in \p FileName.
 SignatureHelp signatureHelp(PathRef FileName,
                             const tooling::CompileCommand &Command,
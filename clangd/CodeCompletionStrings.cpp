@@ -205,5 +205,37 @@ std::string getReturnType(const CodeCompletionString &CCS) {
   return "";
 }
 
+CompletionStrings getCompletionStrings(const CodeCompletionString &CCS) {
+  CompletionStrings Result;
+  if (const char *TypedText = CCS.getTypedText())
+    Result.TypedText = TypedText;
+  getSignature(CCS, &Result.Signature, &Result.SnippetSuffix,
+               &Result.RequiredQualifier);
+  Result.ReturnType = getReturnType(CCS);
+  return Result;
+}
+
+// Only returned items are rendered, so the cache grows slowly. The bound keeps
+// long sessions on a single preamble in check.
+constexpr size_t MaxCachedCompletionStrings = 20000;
+
+llvm::Optional<CompletionStrings>
+CompletionStringsCache::get(const SymbolID &ID,
+                            unsigned StartParameter) const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto It = Entries.find({ID, StartParameter});
+  if (It == Entries.end())
+    return llvm::None;
+  return It->second;
+}
+
+void CompletionStringsCache::put(const SymbolID &ID, unsigned StartParameter,
+                                 CompletionStrings Strings) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (Entries.size() >= MaxCachedCompletionStrings)
+    Entries.clear();
+  Entries[{ID, StartParameter}] = std::move(Strings);
+}
+
 } // namespace clangd
 } // namespace clang
@@ -14,7 +14,12 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_CODECOMPLETIONSTRINGS_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_CODECOMPLETIONSTRINGS_H
 
+#include "index/SymbolID.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include <mutex>
+#include <utility>
 
 namespace clang {
 class ASTContext;
@@ -57,6 +62,38 @@ std::string formatDocumentation(const CodeCompletionString &CCS,
 /// is usually the return type of a function.
 std::string getReturnType(const CodeCompletionString &CCS);
 
+/// The parts of a CodeCompletionString that completion items are built from.
+struct CompletionStrings {
+  std::string TypedText;
+  std::string Signature;
+  std::string SnippetSuffix;
+  std::string RequiredQualifier;
+  std::string ReturnType;
+};
+
+/// Renders \p CCS into its parts, see getSignature() and getReturnType().
+CompletionStrings getCompletionStrings(const CodeCompletionString &CCS);
+
+/// Remembers the completion strings of declarations across completion requests,
+/// keyed by SymbolID and by the parameter the completion starts at (see
+/// CodeCompletionResult::StartParameter). Rendering is dominated by printing
+/// types, and the same declarations (e.g. all members of a class) show up in
+/// many requests.
+/// Only suitable for declarations that are the same in every request, such as
+/// those from the preamble.
+/// This class is thread-safe.
+class CompletionStringsCache {
+public:
+  llvm::Optional<CompletionStrings> get(const SymbolID &ID,
+                                        unsigned StartParameter) const;
+  void put(const SymbolID &ID, unsigned StartParameter,
+           CompletionStrings Strings);
+
+private:
+  mutable std::mutex Mu;
+  llvm::DenseMap<std::pair<SymbolID, unsigned>, CompletionStrings> Entries;
+};
+
 } // namespace clangd
 } // namespace clang
 
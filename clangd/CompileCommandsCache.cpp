@@ -0,0 +1,405 @@
+//===--- CompileCommandsCache.cpp - Binary compile_commands.json ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The cache file consists of little-endian 32 bit words, except for the
+// version and the string data:
+//  - Magic "CDBc", format version.
+//  - JSON size and modification time, 64 bits each.
+//  - NumStrings, StringDataSize, NumArgs, NumCommands, NumBuckets.
+//  - NumStrings + 1 offsets into the string data, then the string data padded
+//    to a multiple of 4 bytes. String i is [Offsets[i], Offsets[i + 1]).
+//  - NumArgs string IDs. The argument vector of a command is a range of them;
+//    commands with equal arguments share the range.
+//  - NumCommands commands: the string IDs of the file key (the path
+//    JSONCompilationDatabase indexes the command by), Directory, Filename and
+//    Output, then the range of arguments.
+//  - A hash table of NumBuckets (a power of two) words, with linear probing.
+//    Non-zero entries are 1 + the index of a command, hashed by file key.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CompileCommandsCache.h"
+#include "Logger.h"
+#include "Trace.h"
+#include "clang/Tooling/JSONCompilationDatabase.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/DJB.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
+#include <map>
+#include <mutex>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+constexpr llvm::StringLiteral Magic = "CDBc";
+constexpr uint32_t FormatVersion = 1;
+// Magic, version, JSON version, five counts.
+constexpr size_t HeaderSize = 4 + 4 + 8 + 8 + 5 * 4;
+// Words per command.
+constexpr size_t CommandSize = 6;
+
+// The path JSONCompilationDatabase indexes a command by.
+std::string fileKey(llvm::StringRef Directory, llvm::StringRef File) {
+  llvm::SmallString<128> Native;
+  if (llvm::sys::path::is_relative(File)) {
+    llvm::SmallString<128> Absolute(Directory);
+    llvm::sys::path::append(Absolute, File);
+    llvm::sys::path::remove_dots(Absolute, /*remove_dot_dot=*/true);
+    llvm::sys::path::native(Absolute, Native);
+  } else {
+    llvm::sys::path::native(File, Native);
+  }
+  return Native.str();
+}
+
+void write32(uint32_t I, llvm::raw_ostream &OS) {
+  char Buf[4];
+  llvm::support::endian::write32le(Buf, I);
+  OS.write(Buf, sizeof(Buf));
+}
+
+void write64(uint64_t I, llvm::raw_ostream &OS) {
+  char Buf[8];
+  llvm::support::endian::write64le(Buf, I);
+  OS.write(Buf, sizeof(Buf));
+}
+
+class CachedCompilationDatabase : public tooling::CompilationDatabase {
+public:
+  // Returns nullptr if Buffer isn't a well-formed cache for Version.
+  static std::unique_ptr<CachedCompilationDatabase>
+  create(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+         CompileCommandsVersion Version, PathRef JSONPath) {
+    using namespace llvm::support::endian;
+    llvm::StringRef Data = Buffer->getBuffer();
+    if (Data.size() < HeaderSize || !Data.startswith(Magic))
+      return nullptr;
+    const char *P = Data.data() + Magic.size();
+    if (read32le(P) != FormatVersion || read64le(P + 4) != Version.Size ||
+        read64le(P + 12) != Version.MTime)
+      return nullptr;
+    P += 20;
+    std::unique_ptr<CachedCompilationDatabase> DB(
+        new CachedCompilationDatabase());
+    DB->NumStrings = read32le(P);
+    DB->StringDataSize = read32le(P + 4);
+    DB->NumArgs = read32le(P + 8);
+    DB->NumCommands = read32le(P + 12);
+    DB->NumBuckets = read32le(P + 16);
+    P += 20;
+    if (!llvm::isPowerOf2_32(DB->NumBuckets) ||
+        DB->NumBuckets <= DB->NumCommands)
+      return nullptr;
+    uint64_t ExpectedSize =
+        HeaderSize + 4 * (uint64_t(DB->NumStrings) + 1) +
+        llvm::alignTo(DB->StringDataSize, 4) + 4 * uint64_t(DB->NumArgs) +
+        4 * CommandSize * uint64_t(DB->NumCommands) +
+        4 * uint64_t(DB->NumBuckets);
+    if (ExpectedSize != Data.size())
+      return nullptr;
+    DB->StringOffsets = P;
+    DB->StringData = DB->StringOffsets + 4 * (DB->NumStrings + 1);
+    DB->Args = DB->StringData + llvm::alignTo(DB->StringDataSize, 4);
+    DB->Commands = DB->Args + 4 * DB->NumArgs;
+    DB->Buckets = DB->Commands + 4 * CommandSize * DB->NumCommands;
+    DB->Buffer = std::move(Buffer);
+    DB->JSONPath = JSONPath;
+    return DB;
+  }
+
+  std::vector<tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override {
+    llvm::SmallString<128> NativePath;
+    llvm::sys::path::native(FilePath, NativePath);
+    llvm::StringRef Key = NativePath;
+    std::vector<tooling::CompileCommand> Result;
+    uint32_t Mask = NumBuckets - 1;
+    uint32_t Bucket = llvm::djbHash(Key) & Mask;
+    // The table is never full, the bound only protects from corrupt files.
+    for (uint32_t Probes = 0; Probes < NumBuckets; ++Probes) {
+      uint32_t Entry = word(Buckets, Bucket);
+      if (Entry == 0)
+        break;
+      if (Entry <= NumCommands && string(commandWord(Entry - 1, 0)) == Key)
+        Result.push_back(command(Entry - 1));
+      Bucket = (Bucket + 1) & Mask;
+    }
+    if (!Result.empty() || !hasFileNamed(llvm::sys::path::filename(Key)))
+      return Result;
+    // The JSON database also finds commands of equivalent paths with the same
+    // file name, e.g. through symlinks. Only then is it worth parsing.
+    if (const tooling::CompilationDatabase *JSON = getJSONDatabase())
+      return JSON->getCompileCommands(FilePath);
+    return Result;
+  }
+
+  std::vector<std::string> getAllFiles() const override {
+    std::vector<std::string> Result;
+    llvm::StringSet<> Seen;
+    for (uint32_t I = 0; I < NumCommands; ++I) {
+      llvm::StringRef Key = string(commandWord(I, 0));
+      if (Seen.insert(Key).second)
+        Result.push_back(Key);
+    }
+    return Result;
+  }
+
+  std::vector<tooling::CompileCommand> getAllCompileCommands() const override {
+    std::vector<tooling::CompileCommand> Result;
+    Result.reserve(NumCommands);
+    for (uint32_t I = 0; I < NumCommands; ++I)
+      Result.push_back(command(I));
+    return Result;
+  }
+
+private:
+  CachedCompilationDatabase() = default;
+
+  bool hasFileNamed(llvm::StringRef Name) const {
+    for (uint32_t I = 0; I < NumCommands; ++I)
+      if (llvm::sys::path::filename(string(commandWord(I, 0))) == Name)
+        return true;
+    return false;
+  }
+
+  // Parses JSONPath the first time, returns nullptr if it can't.
+  const tooling::CompilationDatabase *getJSONDatabase() const {
+    std::lock_guard<std::mutex> Lock(JSONMutex);
+    if (JSONPath.empty() || JSONDatabase)
+      return JSONDatabase.get();
+    std::string Error;
+    JSONDatabase = tooling::JSONCompilationDatabase::loadFromFile(
+        JSONPath, Error, tooling::JSONCommandLineSyntax::AutoDetect);
+    if (!JSONDatabase) {
+      elog("Failed to load compilation database {0}: {1}", JSONPath, Error);
+      JSONPath.clear();
+    }
+    return JSONDatabase.get();
+  }
+
+  static uint32_t word(const char *Table, uint32_t I) {
+    return llvm::support::endian::read32le(Table + 4 * I);
+  }
+
+  uint32_t commandWord(uint32_t Command, uint32_t Field) const {
+    return word(Commands, Command * CommandSize + Field);
+  }
+
+  // Out-of-range IDs (in a corrupt file) yield empty strings.
+  llvm::StringRef string(uint32_t ID) const {
+    if (ID >= NumStrings)
+      return "";
+    uint32_t Begin = word(StringOffsets, ID), End = word(StringOffsets, ID + 1);
+    if (Begin > End || End > StringDataSize)
+      return "";
+    return llvm::StringRef(StringData + Begin, End - Begin);
+  }
+
+  tooling::CompileCommand command(uint32_t I) const {
+    std::vector<std::string> CommandLine;
+    uint32_t ArgsBegin = commandWord(I, 4), ArgsEnd = commandWord(I, 5);
+    if (ArgsBegin <= ArgsEnd && ArgsEnd <= NumArgs)
+      for (uint32_t Arg = ArgsBegin; Arg < ArgsEnd; ++Arg)
+        CommandLine.push_back(string(word(Args, Arg)));
+    return tooling::CompileCommand(string(commandWord(I, 1)),
+                                   string(commandWord(I, 2)),
+                                   std::move(CommandLine),
+                                   string(commandWord(I, 3)));
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  uint32_t NumStrings = 0, StringDataSize = 0, NumArgs = 0, NumCommands = 0,
+           NumBuckets = 0;
+  // Tables, pointing into Buffer.
+  const char *StringOffsets = nullptr, *StringData = nullptr, *Args = nullptr,
+             *Commands = nullptr, *Buckets = nullptr;
+
+  mutable std::mutex JSONMutex;
+  // Cleared if it can't be parsed.
+  mutable std::string JSONPath; // GUARDED_BY(JSONMutex)
+  // GUARDED_BY(JSONMutex)
+  mutable std::unique_ptr<tooling::CompilationDatabase> JSONDatabase;
+};
+
+// Wraps a database the way JSONCompilationDatabasePlugin does.
+std::unique_ptr<tooling::CompilationDatabase>
+wrapJSONDatabase(std::unique_ptr<tooling::CompilationDatabase> Base) {
+  return tooling::inferTargetAndDriverMode(
+      tooling::inferMissingCompileCommands(std::move(Base)));
+}
+
+llvm::Error writeCacheFile(llvm::StringRef Path,
+                           llvm::ArrayRef<tooling::CompileCommand> Commands,
+                           CompileCommandsVersion Version) {
+  if (auto EC = llvm::sys::fs::create_directories(
+          llvm::sys::path::parent_path(Path)))
+    return llvm::errorCodeToError(EC);
+  // Write to a temporary file first, so that concurrent clangd instances
+  // never read a partial cache.
+  auto Temp = llvm::sys::fs::TempFile::create(Path + ".tmp.%%%%%%%%");
+  if (!Temp)
+    return Temp.takeError();
+  {
+    llvm::raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    writeCompileCommandsCache(Commands, Version, OS);
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      return llvm::joinErrors(
+          llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                  "failed to write cache"),
+          Temp->discard());
+    }
+  }
+  return Temp->keep(Path);
+}
+
+} // namespace
+
+void writeCompileCommandsCache(llvm::ArrayRef<tooling::CompileCommand> Commands,
+                               CompileCommandsVersion Version,
+                               llvm::raw_ostream &OS) {
+  llvm::StringMap<uint32_t> StringIDs;
+  std::vector<llvm::StringRef> Strings;
+  auto Intern = [&](llvm::StringRef S) {
+    auto R = StringIDs.try_emplace(S, Strings.size());
+    if (R.second)
+      Strings.push_back(R.first->getKey());
+    return R.first->second;
+  };
+  std::map<std::vector<uint32_t>, std::pair<uint32_t, uint32_t>> ArgVectors;
+  std::vector<uint32_t> Args;
+  std::vector<uint32_t> Entries;
+  Entries.reserve(Commands.size() * CommandSize);
+  for (const auto &Cmd : Commands) {
+    std::vector<uint32_t> ArgIDs;
+    ArgIDs.reserve(Cmd.CommandLine.size());
+    for (const auto &Arg : Cmd.CommandLine)
+      ArgIDs.push_back(Intern(Arg));
+    auto R = ArgVectors.emplace(std::move(ArgIDs), std::make_pair(0u, 0u));
+    if (R.second) {
+      R.first->second.first = Args.size();
+      Args.insert(Args.end(), R.first->first.begin(), R.first->first.end());
+      R.first->second.second = Args.size();
+    }
+    Entries.push_back(Intern(fileKey(Cmd.Directory, Cmd.Filename)));
+    Entries.push_back(Intern(Cmd.Directory));
+    Entries.push_back(Intern(Cmd.Filename));
+    Entries.push_back(Intern(Cmd.Output));
+    Entries.push_back(R.first->second.first);
+    Entries.push_back(R.first->second.second);
+  }
+
+  // Keep the load factor at most 1/2.
+  uint32_t NumBuckets = llvm::PowerOf2Ceil(2 * Commands.size() + 1);
+  std::vector<uint32_t> Buckets(NumBuckets);
+  for (uint32_t I = 0; I < Commands.size(); ++I) {
+    uint32_t Bucket =
+        llvm::djbHash(Strings[Entries[I * CommandSize]]) & (NumBuckets - 1);
+    while (Buckets[Bucket])
+      Bucket = (Bucket + 1) & (NumBuckets - 1);
+    Buckets[Bucket] = I + 1;
+  }
+
+  uint32_t StringDataSize = 0;
+  for (llvm::StringRef S : Strings)
+    StringDataSize += S.size();
+
+  OS << Magic;
+  write32(FormatVersion, OS);
+  write64(Version.Size, OS);
+  write64(Version.MTime, OS);
+  write32(Strings.size(), OS);
+  write32(StringDataSize, OS);
+  write32(Args.size(), OS);
+  write32(Commands.size(), OS);
+  write32(NumBuckets, OS);
+  uint32_t Offset = 0;
+  write32(Offset, OS);
+  for (llvm::StringRef S : Strings)
+    write32(Offset += S.size(), OS);
+  for (llvm::StringRef S : Strings)
+    OS << S;
+  for (uint32_t I = StringDataSize; I % 4; ++I)
+    OS.write('\0');
+  for (uint32_t Arg : Args)
+    write32(Arg, OS);
+  for (uint32_t Word : Entries)
+    write32(Word, OS);
+  for (uint32_t Entry : Buckets)
+    write32(Entry, OS);
+}
+
+std::unique_ptr<tooling::CompilationDatabase>
+readCompileCommandsCache(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                         CompileCommandsVersion Version, PathRef JSONPath) {
+  return CachedCompilationDatabase::create(std::move(Buffer), Version,
+                                           JSONPath);
+}
+
+llvm::Optional<std::string> getCompileCommandsCacheDir() {
+  llvm::SmallString<128> Dir;
+  if (!llvm::sys::path::cache_directory(Dir))
+    return llvm::None;
+  llvm::sys::path::append(Dir, "clangd", "compile_commands");
+  return Dir.str().str();
+}
+
+std::unique_ptr<tooling::CompilationDatabase>
+loadCachedJSONCompilationDatabase(PathRef Dir, PathRef CacheDir) {
+  llvm::SmallString<128> JSONPath(Dir);
+  llvm::sys::path::append(JSONPath, "compile_commands.json");
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(JSONPath, Status) ||
+      !llvm::sys::fs::is_regular_file(Status))
+    return nullptr;
+  CompileCommandsVersion Version;
+  Version.Size = Status.getSize();
+  Version.MTime = Status.getLastModificationTime().time_since_epoch().count();
+
+  trace::Span Tracer("LoadCompilationDatabase");
+  SPAN_ATTACH(Tracer, "Path", JSONPath.str());
+  // The caches of all projects share the directory, so they're named after
+  // the path of their JSON file.
+  llvm::SmallString<128> CachePath(CacheDir);
+  llvm::sys::path::append(CachePath,
+                          llvm::utohexstr(llvm::xxHash64(JSONPath)) + ".bin");
+  if (auto Buffer = llvm::MemoryBuffer::getFile(CachePath, /*FileSize=*/-1,
+                                                /*RequiresNullTerminator=*/
+                                                false)) {
+    if (auto DB =
+            readCompileCommandsCache(std::move(*Buffer), Version, JSONPath)) {
+      vlog("Loaded compilation database from cache {0}", CachePath);
+      return wrapJSONDatabase(std::move(DB));
+    }
+    vlog("Compilation database cache {0} is stale", CachePath);
+  }
+
+  std::string Error;
+  auto Base = tooling::JSONCompilationDatabase::loadFromFile(
+      JSONPath, Error, tooling::JSONCommandLineSyntax::AutoDetect);
+  if (!Base) {
+    elog("Failed to load compilation database {0}: {1}", JSONPath, Error);
+    return nullptr;
+  }
+  if (auto Err =
+          writeCacheFile(CachePath, Base->getAllCompileCommands(), Version))
+    elog("Failed to write compilation database cache {0}: {1}", CachePath,
+         std::move(Err));
+  return wrapJSONDatabase(std::move(Base));
+}
+
+} // namespace clangd
+} // namespace clang
@@ -0,0 +1,70 @@
+//===--- CompileCommandsCache.h - Binary compile_commands.json --*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Parsing a large compile_commands.json takes seconds. The first time a
+/// project's database is loaded, clangd writes its commands in a binary form
+/// to its cache directory, e.g. ~/.cache/clangd/compile_commands. Later loads
+/// map the binary file instead of parsing the JSON, as long as the JSON's size
+/// and modification time are unchanged.
+///
+/// The binary form interns strings and argument vectors, and has a hash table
+/// from file paths to commands: looking up a command doesn't read the rest of
+/// the file. Paths that aren't found are looked up in the JSON database, which
+/// also matches equivalent paths (e.g. through symlinks).
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_COMPILECOMMANDSCACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_COMPILECOMMANDSCACHE_H
+
+#include "Path.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+
+namespace clang {
+namespace clangd {
+
+/// Identifies the version of compile_commands.json a cache was built from.
+struct CompileCommandsVersion {
+  uint64_t Size = 0;
+  uint64_t MTime = 0; // In the units of llvm::sys::TimePoint<>.
+};
+
+/// Writes the binary form of \p Commands, as read from the JSON file with
+/// version \p Version.
+void writeCompileCommandsCache(llvm::ArrayRef<tooling::CompileCommand> Commands,
+                               CompileCommandsVersion Version,
+                               llvm::raw_ostream &OS);
+
+/// Returns a database reading commands from \p Buffer, or nullptr if it isn't
+/// a cache of the JSON file with version \p Version. Files the cache doesn't
+/// have are looked up in \p JSONPath, if not empty, which is then parsed.
+std::unique_ptr<tooling::CompilationDatabase>
+readCompileCommandsCache(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                         CompileCommandsVersion Version,
+                         PathRef JSONPath = "");
+
+/// Returns the directory the caches are stored in, under the user's cache
+/// directory, or None if there's none.
+llvm::Optional<std::string> getCompileCommandsCacheDir();
+
+/// Loads \p Dir/compile_commands.json like tooling::CompilationDatabase's
+/// loadFromDirectory(), using and updating its binary cache in \p CacheDir.
+/// Returns nullptr if there's no such file, or it can't be parsed.
+std::unique_ptr<tooling::CompilationDatabase>
+loadCachedJSONCompilationDatabase(PathRef Dir, PathRef CacheDir);
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_COMPILECOMMANDSCACHE_H
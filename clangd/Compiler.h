@@ -16,14 +16,18 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_COMPILER_H
 
 #include "../clang-tidy/ClangTidyOptions.h"
+#include "Protocol.h"
 #include "index/Index.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/CompilerInvocation.h"
 #include "clang/Frontend/PrecompiledPreamble.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include <functional>
 
 namespace clang {
 namespace clangd {
+class FileChangeTracker;
+class IncludeFixerCache;
 
 class IgnoreDiagnostics : public DiagnosticConsumer {
 public:
@@ -38,11 +42,35 @@ public:
 struct ParseOptions {
   tidy::ClangTidyOptions ClangTidyOpts;
   bool SuggestMissingIncludes = false;
+  /// If set, the index results used to suggest missing includes are shared
+  /// with other builds. Must outlive the build.
+  IncludeFixerCache *IncludeFixCache = nullptr;
+  /// If set, the files of a preamble are assumed unchanged unless reported
+  /// here, so checking whether the preamble can be reused needs no stat()s.
+  /// Must outlive the build.
+  const FileChangeTracker *WatchedFileChanges = nullptr;
+  /// If true, the AST matchers of clang-tidy checks only run when
+  /// ParsedAST::runClangTidy() is called, so that the compiler diagnostics
+  /// are available sooner.
+  bool DeferClangTidy = false;
+  /// If set, only the function bodies of the main file that intersect this
+  /// range are parsed, the others are skipped. Makes for a quick parse of the
+  /// code visible in the editor, whose diagnostics can be shown first.
+  llvm::Optional<Range> ParseBodiesIn;
+  /// Notes and fixes are only computed for this many diagnostics, later ones
+  /// just have a message and range. Files with thousands of warnings spend
+  /// most of their diagnostics time on details no one looks at. 0 means no
+  /// limit.
+  unsigned DetailedDiagnosticsLimit = 1000;
 };
 
 /// Information required to run clang, e.g. to parse AST or do code completion.
 struct ParseInputs {
   tooling::CompileCommand CompileCommand;
+  /// If set, TUScheduler replaces CompileCommand with the result of this on
+  /// the thread building the file, rather than the one scheduling the update:
+  /// looking up a command may load a compilation database, which is slow.
+  std::function<tooling::CompileCommand()> GetCompileCommand;
   IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS;
   std::string Contents;
   // Used to recover from diagnostics (e.g. find missing includes for symbol).
@@ -100,8 +100,11 @@ public:
   template <class Type> const Type *get(const Key<Type> &Key) const {
     for (const Data *DataPtr = this->DataPtr.get(); DataPtr != nullptr;
          DataPtr = DataPtr->Parent.get()) {
+      // The key determines the type of the value.
       if (DataPtr->KeyPtr == &Key)
-        return static_cast<const Type *>(DataPtr->Value->getValuePtr());
+        return &static_cast<
+                    const TypedData<typename std::decay<Type>::type> *>(DataPtr)
+                    ->Value;
     }
     return nullptr;
   }
@@ -120,20 +123,18 @@ public:
   template <class Type>
   Context derive(const Key<Type> &Key,
                  typename std::decay<Type>::type Value) const & {
-    return Context(std::make_shared<Data>(Data{
-        /*Parent=*/DataPtr, &Key,
-        llvm::make_unique<TypedAnyStorage<typename std::decay<Type>::type>>(
-            std::move(Value))}));
+    return Context(
+        std::make_shared<TypedData<typename std::decay<Type>::type>>(
+            /*Parent=*/DataPtr, &Key, std::move(Value)));
   }
 
   template <class Type>
   Context
   derive(const Key<Type> &Key,
          typename std::decay<Type>::type Value) && /* takes ownership */ {
-    return Context(std::make_shared<Data>(Data{
-        /*Parent=*/std::move(DataPtr), &Key,
-        llvm::make_unique<TypedAnyStorage<typename std::decay<Type>::type>>(
-            std::move(Value))}));
+    return Context(
+        std::make_shared<TypedData<typename std::decay<Type>::type>>(
+            /*Parent=*/std::move(DataPtr), &Key, std::move(Value)));
   }
 
   /// Derives a child context, using an anonymous key.
@@ -152,34 +153,29 @@ public:
   Context clone() const;
 
 private:
-  class AnyStorage {
-  public:
-    virtual ~AnyStorage() = default;
-    virtual void *getValuePtr() = 0;
+  struct Data {
+    std::shared_ptr<const Data> Parent;
+    const void *KeyPtr;
   };
 
-  template <class T> class TypedAnyStorage : public Context::AnyStorage {
+  // A node of the context holding a value of type T. The value is allocated
+  // together with the node (and the shared_ptr control block), so deriving a
+  // context is a single allocation.
+  template <class T> struct TypedData : Data {
     static_assert(std::is_same<typename std::decay<T>::type, T>::value,
-                  "Argument to TypedAnyStorage must be decayed");
+                  "Argument to TypedData must be decayed");
 
-  public:
-    TypedAnyStorage(T &&Value) : Value(std::move(Value)) {}
+    TypedData(std::shared_ptr<const Data> Parent, const void *KeyPtr,
+              T &&Value)
+        : Data{std::move(Parent), KeyPtr}, Value(std::move(Value)) {}
 
-    void *getValuePtr() override { return &Value; }
-
-  private:
+    // We need to make sure Parent outlives the Value, which it does as base
+    // class members are destroyed last. We do that to allow classes stored in
+    // Context's child layers to store references to the data in the parent
+    // layers.
     T Value;
   };
 
-  struct Data {
-    // We need to make sure Parent outlives the Value, so the order of members
-    // is important. We do that to allow classes stored in Context's child
-    // layers to store references to the data in the parent layers.
-    std::shared_ptr<const Data> Parent;
-    const void *KeyPtr;
-    std::unique_ptr<AnyStorage> Value;
-  };
-
   std::shared_ptr<const Data> DataPtr;
 };
 
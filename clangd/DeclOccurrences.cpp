@@ -0,0 +1,129 @@
+//===--- DeclOccurrences.cpp -------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "DeclOccurrences.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/Index/IndexDataConsumer.h"
+#include "clang/Index/IndexingAction.h"
+#include "llvm/ADT/STLExtras.h"
+#include <algorithm>
+#include <tuple>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+bool isImplicitExpr(const Expr *E) {
+  if (!E)
+    return false;
+  // We assume that a constructor expression is implict (was inserted by
+  // clang) if it has an invalid paren/brace location, since such
+  // experssion is impossible to write down.
+  if (const auto *CtorExpr = dyn_cast<CXXConstructExpr>(E))
+    return CtorExpr->getParenOrBraceRange().isInvalid();
+  return isa<ImplicitCastExpr>(E);
+}
+
+class OccurrenceCollector : public index::IndexDataConsumer {
+public:
+  OccurrenceCollector(const SourceManager &SM,
+                      std::vector<DeclOccurrences::Occurrence> &Occurrences)
+      : SM(SM), Occurrences(Occurrences) {}
+
+  bool
+  handleDeclOccurence(const Decl *D, index::SymbolRoleSet Roles,
+                      llvm::ArrayRef<index::SymbolRelation> Relations,
+                      SourceLocation Loc,
+                      index::IndexDataConsumer::ASTNodeInfo ASTNode) override {
+    assert(D->isCanonicalDecl() && "expect D to be a canonical declaration");
+    Occurrences.push_back(
+        {Loc, SM.getFileLoc(Loc), D, Roles, isImplicitExpr(ASTNode.OrigE)});
+    return true;
+  }
+
+private:
+  const SourceManager &SM;
+  std::vector<DeclOccurrences::Occurrence> &Occurrences;
+};
+
+} // namespace
+
+DeclOccurrences DeclOccurrences::build(ASTContext &AST, Preprocessor &PP,
+                                       llvm::ArrayRef<Decl *> TopLevelDecls) {
+  DeclOccurrences Result;
+  const SourceManager &SM = AST.getSourceManager();
+  OccurrenceCollector Collector(SM, Result.ByLoc);
+  index::IndexingOptions IndexOpts;
+  IndexOpts.SystemSymbolFilter =
+      index::IndexingOptions::SystemSymbolFilterKind::All;
+  IndexOpts.IndexFunctionLocals = true;
+  IndexOpts.IndexParametersInDeclarations = true;
+  IndexOpts.IndexTemplateParameters = true;
+  indexTopLevelDecls(AST, PP, TopLevelDecls, Collector, IndexOpts);
+
+  // The order of the occurrences at the same location doesn't matter, keep the
+  // traversal order.
+  std::stable_sort(Result.ByLoc.begin(), Result.ByLoc.end(),
+                   [](const Occurrence &L, const Occurrence &R) {
+                     return L.Loc < R.Loc;
+                   });
+  for (const Occurrence &O : Result.ByLoc)
+    if (SM.isWrittenInMainFile(O.FileLoc))
+      Result.ByDecl.push_back(O);
+  llvm::sort(Result.ByDecl, [](const Occurrence &L, const Occurrence &R) {
+    return std::tie(L.D, L.FileLoc, L.Roles) <
+           std::tie(R.D, R.FileLoc, R.Roles);
+  });
+  // We sometimes see duplicates when parts of the AST get traversed twice.
+  Result.ByDecl.erase(
+      std::unique(Result.ByDecl.begin(), Result.ByDecl.end(),
+                  [](const Occurrence &L, const Occurrence &R) {
+                    return std::tie(L.D, L.FileLoc, L.Roles) ==
+                           std::tie(R.D, R.FileLoc, R.Roles);
+                  }),
+      Result.ByDecl.end());
+  Result.ByDecl.shrink_to_fit();
+  return Result;
+}
+
+llvm::ArrayRef<DeclOccurrences::Occurrence>
+DeclOccurrences::at(SourceLocation Loc) const {
+  struct Compare {
+    bool operator()(const Occurrence &O, SourceLocation Loc) const {
+      return O.Loc < Loc;
+    }
+    bool operator()(SourceLocation Loc, const Occurrence &O) const {
+      return Loc < O.Loc;
+    }
+  };
+  auto Range = std::equal_range(ByLoc.begin(), ByLoc.end(), Loc, Compare());
+  return llvm::makeArrayRef(ByLoc).slice(Range.first - ByLoc.begin(),
+                                         Range.second - Range.first);
+}
+
+llvm::ArrayRef<DeclOccurrences::Occurrence>
+DeclOccurrences::inMainFile(const Decl *D) const {
+  struct Compare {
+    bool operator()(const Occurrence &O, const Decl *D) const {
+      return O.D < D;
+    }
+    bool operator()(const Decl *D, const Occurrence &O) const {
+      return D < O.D;
+    }
+  };
+  auto Range = std::equal_range(ByDecl.begin(), ByDecl.end(), D, Compare());
+  return llvm::makeArrayRef(ByDecl).slice(Range.first - ByDecl.begin(),
+                                          Range.second - Range.first);
+}
+
+size_t DeclOccurrences::bytes() const {
+  return (ByLoc.capacity() + ByDecl.capacity()) * sizeof(Occurrence);
+}
+
+} // namespace clangd
+} // namespace clang
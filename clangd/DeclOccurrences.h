@@ -0,0 +1,69 @@
+//===--- DeclOccurrences.h - Declarations referenced in a file ---*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Features like go-to-definition, hover and document highlights need the
+// declarations referenced at the cursor, and the references to them in the
+// main file. Rather than running the indexer over the whole main file for each
+// request, DeclOccurrences collects all the occurrences once per AST, sorted
+// so that each query is a binary search.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_DECLOCCURRENCES_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_DECLOCCURRENCES_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Index/IndexSymbol.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <vector>
+
+namespace clang {
+namespace clangd {
+
+/// The occurrences of declarations reported by the indexer when traversing
+/// the top-level decls of an AST.
+class DeclOccurrences {
+public:
+  struct Occurrence {
+    /// The location reported by the indexer, possibly inside a macro.
+    SourceLocation Loc;
+    /// The file location of Loc.
+    SourceLocation FileLoc;
+    /// The canonical declaration.
+    const Decl *D;
+    index::SymbolRoleSet Roles;
+    /// Whether the occurrence is an implicit expression inserted by clang,
+    /// e.g. an implicit cast or constructor call.
+    bool Implicit;
+  };
+
+  static DeclOccurrences build(ASTContext &AST, Preprocessor &PP,
+                               llvm::ArrayRef<Decl *> TopLevelDecls);
+
+  /// The occurrences at exactly \p Loc.
+  llvm::ArrayRef<Occurrence> at(SourceLocation Loc) const;
+
+  /// The occurrences of the canonical declaration \p D whose file location is
+  /// in the main file, sorted by location. Duplicates are removed.
+  llvm::ArrayRef<Occurrence> inMainFile(const Decl *D) const;
+
+  size_t bytes() const;
+
+private:
+  /// All occurrences, sorted by Loc.
+  std::vector<Occurrence> ByLoc;
+  /// The occurrences in the main file, sorted by D and FileLoc.
+  std::vector<Occurrence> ByDecl;
+};
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_DECLOCCURRENCES_H
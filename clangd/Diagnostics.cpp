@@ -290,7 +290,15 @@ int getSeverity(DiagnosticsEngine::Level L) {
   llvm_unreachable("Unknown diagnostic level!");
 }
 
-std::vector<Diag> StoreDiags::take() { return std::move(Output); }
+std::vector<Diag> StoreDiags::take() {
+  for (auto &Deferred : DeferredFixes) {
+    auto &Fixes = Output[Deferred.first].Fixes;
+    auto ExtraFixes = Deferred.second();
+    Fixes.insert(Fixes.end(), ExtraFixes.begin(), ExtraFixes.end());
+  }
+  DeferredFixes.clear();
+  return std::move(Output);
+}
 
 void StoreDiags::BeginSourceFile(const LangOptions &Opts,
                                  const Preprocessor *) {
@@ -380,6 +388,9 @@ void StoreDiags::HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
     LastDiag->ID = Info.getID();
     FillDiagBase(*LastDiag);
 
+    LastDiagDetailed = !DetailLimit || Output.size() < DetailLimit;
+    if (!LastDiagDetailed)
+      return;
     if (!Info.getFixItHints().empty())
       AddFix(true /* try to invent a message instead of repeating the diag */);
     if (Fixer) {
@@ -387,6 +398,8 @@ void StoreDiags::HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
       LastDiag->Fixes.insert(LastDiag->Fixes.end(), ExtraFixes.begin(),
                              ExtraFixes.end());
     }
+    if (DeferredFixer)
+      LastDiagDeferredFix = DeferredFixer(DiagLevel, Info);
   } else {
     // Handle a note to an existing diagnostic.
     if (!LastDiag) {
@@ -394,6 +407,11 @@ void StoreDiags::HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
       IgnoreDiagnostics::log(DiagLevel, Info);
       return;
     }
+    // Without details, notes are only kept if they are what brings a
+    // diagnostic into the main file.
+    if (!LastDiagDetailed &&
+        (LastDiag->InsideMainFile || !isInsideMainFile(Info)))
+      return;
 
     if (!Info.getFixItHints().empty()) {
       // A clang note with fix-it is not a separate diagnostic in clangd. We
@@ -413,12 +431,17 @@ void StoreDiags::HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
 void StoreDiags::flushLastDiag() {
   if (!LastDiag)
     return;
-  if (mentionsMainFile(*LastDiag))
+  if (mentionsMainFile(*LastDiag)) {
     Output.push_back(std::move(*LastDiag));
-  else
+    if (LastDiagDeferredFix)
+      DeferredFixes.emplace_back(Output.size() - 1,
+                                 std::move(LastDiagDeferredFix));
+  } else {
     vlog("Dropped diagnostic outside main file: {0}: {1}", LastDiag->File,
          LastDiag->Message);
+  }
   LastDiag.reset();
+  LastDiagDeferredFix = nullptr;
 }
 
 } // namespace clangd
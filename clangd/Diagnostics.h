@@ -116,13 +116,34 @@ public:
   /// If set, possibly adds fixes for diagnostics using \p Fixer.
   void contributeFixes(DiagFixer Fixer) { this->Fixer = Fixer; }
 
+  /// Computes the fixes of a diagnostic when take() is called.
+  using DeferredFix = std::function<std::vector<Fix>()>;
+  using DeferredDiagFixer = std::function<DeferredFix(
+      DiagnosticsEngine::Level, const clang::Diagnostic &)>;
+  /// Like contributeFixes(), but \p Fixer may delay the work until all the
+  /// diagnostics are seen, e.g. to batch index queries.
+  void contributeDeferredFixes(DeferredDiagFixer Fixer) {
+    this->DeferredFixer = Fixer;
+  }
+  /// Once \p Limit diagnostics are stored, the ones after keep only their
+  /// message and range: their notes and fixes are not computed. 0 means no
+  /// limit.
+  void setDetailLimit(unsigned Limit) { DetailLimit = Limit; }
+
 private:
   void flushLastDiag();
 
   DiagFixer Fixer = nullptr;
+  DeferredDiagFixer DeferredFixer = nullptr;
+  DeferredFix LastDiagDeferredFix = nullptr;
+  // The deferred fixes of diagnostics in Output, by their index.
+  std::vector<std::pair<size_t, DeferredFix>> DeferredFixes;
   std::vector<Diag> Output;
   llvm::Optional<LangOptions> LangOpts;
   llvm::Optional<Diag> LastDiag;
+  unsigned DetailLimit = 0;
+  // Whether the notes and fixes of LastDiag are recorded.
+  bool LastDiagDetailed = true;
 };
 
 } // namespace clangd
@@ -9,6 +9,7 @@
 #include "DraftStore.h"
 #include "SourceCode.h"
 #include "llvm/Support/Errc.h"
+#include <algorithm>
 
 namespace clang {
 namespace clangd {
@@ -20,7 +21,7 @@ llvm::Optional<std::string> DraftStore::getDraft(PathRef File) const {
   if (It == Drafts.end())
     return None;
 
-  return It->second;
+  return It->second.Contents;
 }
 
 std::vector<Path> DraftStore::getActiveFiles() const {
@@ -33,10 +34,86 @@ std::vector<Path> DraftStore::getActiveFiles() const {
   return ResultVector;
 }
 
+size_t DraftStore::getUsedBytes() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  size_t Bytes = Drafts.getNumBuckets() * sizeof(void *);
+  for (const auto &D : Drafts)
+    Bytes += sizeof(D) + D.getKeyLength() + D.second.Contents.capacity() +
+             D.second.LineStarts.capacity() * sizeof(size_t);
+  return Bytes;
+}
+
 void DraftStore::addDraft(PathRef File, llvm::StringRef Contents) {
   std::lock_guard<std::mutex> Lock(Mutex);
 
-  Drafts[File] = Contents;
+  Draft &D = Drafts[File];
+  D.Contents = Contents;
+  D.LineStarts = computeLineStarts(D.Contents);
+}
+
+llvm::Error
+DraftStore::applyChange(Draft &D,
+                        const TextDocumentContentChangeEvent &Change) {
+  if (!Change.range) {
+    D.Contents = Change.text;
+    D.LineStarts = computeLineStarts(D.Contents);
+    return llvm::Error::success();
+  }
+
+  const Position &Start = Change.range->start;
+  llvm::Expected<size_t> StartIndex =
+      positionToOffset(D.Contents, D.LineStarts, Start, false);
+  if (!StartIndex)
+    return StartIndex.takeError();
+
+  const Position &End = Change.range->end;
+  llvm::Expected<size_t> EndIndex =
+      positionToOffset(D.Contents, D.LineStarts, End, false);
+  if (!EndIndex)
+    return EndIndex.takeError();
+
+  if (*EndIndex < *StartIndex)
+    return llvm::make_error<llvm::StringError>(
+        llvm::formatv(
+            "Range's end position ({0}) is before start position ({1})", End,
+            Start),
+        llvm::errc::invalid_argument);
+
+  // Since the range length between two LSP positions is dependent on the
+  // contents of the buffer we compute the range length between the start and
+  // end position ourselves and compare it to the range length of the LSP
+  // message to verify the buffers of the client and server are in sync.
+
+  // EndIndex and StartIndex are in bytes, but Change.rangeLength is in UTF-16
+  // code units.
+  ssize_t ComputedRangeLength = lspLength(
+      llvm::StringRef(D.Contents).substr(*StartIndex, *EndIndex - *StartIndex));
+
+  if (Change.rangeLength && ComputedRangeLength != *Change.rangeLength)
+    return llvm::make_error<llvm::StringError>(
+        llvm::formatv("Change's rangeLength ({0}) doesn't match the "
+                      "computed range length ({1}).",
+                      *Change.rangeLength, *EndIndex - *StartIndex),
+        llvm::errc::invalid_argument);
+
+  D.Contents.replace(*StartIndex, *EndIndex - *StartIndex, Change.text);
+
+  // Patch the line index: drop the lines whose newline was in the replaced
+  // range, add the ones introduced by the new text and shift the rest.
+  auto First = std::upper_bound(D.LineStarts.begin(), D.LineStarts.end(),
+                                *StartIndex);
+  auto Last = std::upper_bound(First, D.LineStarts.end(), *EndIndex);
+  std::vector<size_t> Inserted;
+  for (size_t NL = Change.text.find('\n'); NL != std::string::npos;
+       NL = Change.text.find('\n', NL + 1))
+    Inserted.push_back(*StartIndex + NL + 1);
+  ssize_t Delta = static_cast<ssize_t>(Change.text.size()) -
+                  static_cast<ssize_t>(*EndIndex - *StartIndex);
+  for (auto It = Last; It != D.LineStarts.end(); ++It)
+    *It += Delta;
+  First = D.LineStarts.erase(First, Last);
+  D.LineStarts.insert(First, Inserted.begin(), Inserted.end());
+  return llvm::Error::success();
 }
 
 llvm::Expected<std::string> DraftStore::updateDraft(
@@ -50,62 +127,22 @@ llvm::Expected<std::string> DraftStore::updateDraft(
         llvm::errc::invalid_argument);
   }
 
-  std::string Contents = EntryIt->second;
-
-  for (const TextDocumentContentChangeEvent &Change : Changes) {
-    if (!Change.range) {
-      Contents = Change.text;
-      continue;
-    }
-
-    const Position &Start = Change.range->start;
-    llvm::Expected<size_t> StartIndex =
-        positionToOffset(Contents, Start, false);
-    if (!StartIndex)
-      return StartIndex.takeError();
-
-    const Position &End = Change.range->end;
-    llvm::Expected<size_t> EndIndex = positionToOffset(Contents, End, false);
-    if (!EndIndex)
-      return EndIndex.takeError();
-
-    if (*EndIndex < *StartIndex)
-      return llvm::make_error<llvm::StringError>(
-          llvm::formatv(
-              "Range's end position ({0}) is before start position ({1})", End,
-              Start),
-          llvm::errc::invalid_argument);
-
-    // Since the range length between two LSP positions is dependent on the
-    // contents of the buffer we compute the range length between the start and
-    // end position ourselves and compare it to the range length of the LSP
-    // message to verify the buffers of the client and server are in sync.
-
-    // EndIndex and StartIndex are in bytes, but Change.rangeLength is in UTF-16
-    // code units.
-    ssize_t ComputedRangeLength =
-        lspLength(Contents.substr(*StartIndex, *EndIndex - *StartIndex));
-
-    if (Change.rangeLength && ComputedRangeLength != *Change.rangeLength)
-      return llvm::make_error<llvm::StringError>(
-          llvm::formatv("Change's rangeLength ({0}) doesn't match the "
-                        "computed range length ({1}).",
-                        *Change.rangeLength, *EndIndex - *StartIndex),
-          llvm::errc::invalid_argument);
-
-    std::string NewContents;
-    NewContents.reserve(*StartIndex + Change.text.length() +
-                        (Contents.length() - *EndIndex));
-
-    NewContents = Contents.substr(0, *StartIndex);
-    NewContents += Change.text;
-    NewContents += Contents.substr(*EndIndex);
-
-    Contents = std::move(NewContents);
+  // A single change (the common case while typing) is validated before it
+  // touches the draft, so it can be applied in place. A sequence of changes
+  // must leave the draft untouched if any of them fails, so work on a copy.
+  if (Changes.size() == 1) {
+    if (llvm::Error Err = applyChange(EntryIt->second, Changes.front()))
+      return std::move(Err);
+    return EntryIt->second.Contents;
   }
 
-  EntryIt->second = Contents;
-  return Contents;
+  Draft Updated = EntryIt->second;
+  for (const TextDocumentContentChangeEvent &Change : Changes)
+    if (llvm::Error Err = applyChange(Updated, Change))
+      return std::move(Err);
+
+  EntryIt->second = std::move(Updated);
+  return EntryIt->second.Contents;
 }
 
 void DraftStore::removeDraft(PathRef File) {
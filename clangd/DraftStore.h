@@ -48,9 +48,24 @@ public:
   /// Remove the draft from the store.
   void removeDraft(PathRef File);
 
+  /// Returns the estimated memory used by all drafts.
+  size_t getUsedBytes() const;
+
 private:
+  struct Draft {
+    std::string Contents;
+    /// Offsets of the start of each line in Contents, kept up to date across
+    /// incremental edits so LSP positions can be resolved without rescanning
+    /// the whole buffer.
+    std::vector<size_t> LineStarts;
+  };
+
+  /// Applies a single change to \p D in place. On error, \p D is unchanged.
+  static llvm::Error applyChange(Draft &D,
+                                 const TextDocumentContentChangeEvent &Change);
+
   mutable std::mutex Mutex;
-  llvm::StringMap<std::string> Drafts;
+  llvm::StringMap<Draft> Drafts;
 };
 
 } // namespace clangd
@@ -86,5 +86,26 @@ OpaqueType::fromCompletionResult(ASTContext &Ctx,
   return encode(Ctx, *T);
 }
 
+llvm::Optional<PreferredTypeMatcher>
+PreferredTypeMatcher::create(ASTContext &Ctx, QualType Preferred) {
+  auto Encoded = OpaqueType::fromType(Ctx, Preferred);
+  if (!Encoded)
+    return None;
+  return PreferredTypeMatcher(Ctx, toEquivClass(Ctx, Preferred),
+                              std::move(*Encoded));
+}
+
+llvm::Optional<bool>
+PreferredTypeMatcher::matches(const CodeCompletionResult &R) const {
+  auto T = typeOfCompletion(R);
+  if (!T)
+    return None;
+  const Type *C = toEquivClass(*Ctx, *T);
+  if (!C)
+    return None;
+  // Equivalence classes are canonical types, equal types are the same object.
+  return C == Class;
+}
+
 } // namespace clangd
 } // namespace clang
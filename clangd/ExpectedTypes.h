@@ -59,6 +59,33 @@ private:
 
   std::string Data;
 };
+
+/// Matches the types of code completion results from an AST against the
+/// preferred type of a completion in the same AST. Types of the same AST are
+/// compared by their equivalence class, a canonical type of the AST, which
+/// unlike OpaqueType doesn't need to be encoded for every result. The preferred
+/// type is encoded once, to be compared with the types stored in the index.
+class PreferredTypeMatcher {
+public:
+  /// Returns None if \p Preferred has no OpaqueType.
+  static llvm::Optional<PreferredTypeMatcher> create(ASTContext &Ctx,
+                                                     QualType Preferred);
+
+  /// The encoding of the preferred type.
+  const OpaqueType &encoded() const { return Encoded; }
+
+  /// Returns None if \p R has no type to compare, or whether its type matches
+  /// the preferred type, as OpaqueType::fromCompletionResult() would.
+  llvm::Optional<bool> matches(const CodeCompletionResult &R) const;
+
+private:
+  PreferredTypeMatcher(ASTContext &Ctx, const Type *Class, OpaqueType Encoded)
+      : Ctx(&Ctx), Class(Class), Encoded(std::move(Encoded)) {}
+
+  ASTContext *Ctx;
+  const Type *Class;
+  OpaqueType Encoded;
+};
 } // namespace clangd
 } // namespace clang
 #endif
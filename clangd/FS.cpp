@@ -9,11 +9,39 @@
 #include "FS.h"
 #include "clang/Basic/LLVM.h"
 #include "llvm/ADT/None.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Path.h"
 
 namespace clang {
 namespace clangd {
 
+// The preamble and the client may spell paths differently, e.g. "a/../b.h".
+static std::string normalizePath(llvm::StringRef Path) {
+  llvm::SmallString<128> Result(Path);
+  llvm::sys::path::remove_dots(Result, /*remove_dot_dot=*/true);
+  return Result.str();
+}
+
+void FileChangeTracker::changed(llvm::ArrayRef<std::string> Files) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  ++Version;
+  for (const auto &File : Files)
+    LastChange[normalizePath(File)] = Version;
+}
+
+uint64_t FileChangeTracker::version() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  return Version;
+}
+
+bool FileChangeTracker::changedSince(llvm::StringRef File,
+                                     uint64_t Version) const {
+  std::string Key = normalizePath(File);
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto It = LastChange.find(Key);
+  return It != LastChange.end() && It->second > Version;
+}
+
 PreambleFileStatusCache::PreambleFileStatusCache(llvm::StringRef MainFilePath)
     : MainFilePath(MainFilePath) {
   assert(llvm::sys::path::is_absolute(MainFilePath));
@@ -39,6 +67,14 @@ PreambleFileStatusCache::lookup(llvm::StringRef File) const {
   return None;
 }
 
+size_t PreambleFileStatusCache::getUsedBytes() const {
+  size_t Bytes = MainFilePath.capacity() +
+                 StatCache.getNumBuckets() * sizeof(void *);
+  for (const auto &S : StatCache)
+    Bytes += sizeof(S) + S.getKeyLength() + S.second.getName().size();
+  return Bytes;
+}
+
 llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem>
 PreambleFileStatusCache::getProducingFS(
     llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS) {
@@ -100,5 +136,161 @@ PreambleFileStatusCache::getConsumingFS(
   return llvm::IntrusiveRefCntPtr<CacheVFS>(new CacheVFS(std::move(FS), *this));
 }
 
+llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem>
+PreambleFileStatusCache::getWatchedFS(
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+    const FileChangeTracker &Changes, uint64_t Version) const {
+  class WatchedVFS : public llvm::vfs::ProxyFileSystem {
+  public:
+    WatchedVFS(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+               const PreambleFileStatusCache &StatCache,
+               const FileChangeTracker &Changes, uint64_t Version)
+        : ProxyFileSystem(std::move(FS)), StatCache(StatCache),
+          Changes(Changes), Version(Version) {}
+
+    llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &Path) override {
+      std::string File = Path.str();
+      if (!Changes.changedSince(File, Version))
+        if (auto S = StatCache.lookup(File))
+          return *S;
+      return getUnderlyingFS().status(Path);
+    }
+
+  private:
+    const PreambleFileStatusCache &StatCache;
+    const FileChangeTracker &Changes;
+    uint64_t Version;
+  };
+  return llvm::IntrusiveRefCntPtr<WatchedVFS>(
+      new WatchedVFS(std::move(FS), *this, Changes, Version));
+}
+
+IntrusiveRefCntPtr<llvm::vfs::FileSystem>
+SharedFileContentCache::getFS(IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS) {
+  class CachedContentFile : public llvm::vfs::File {
+  public:
+    CachedContentFile(llvm::vfs::Status S, const llvm::MemoryBuffer &Content)
+        : S(std::move(S)), Content(Content) {}
+
+    llvm::ErrorOr<llvm::vfs::Status> status() override { return S; }
+
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+    getBuffer(const llvm::Twine &Name, int64_t /*FileSize*/,
+              bool RequiresNullTerminator, bool /*IsVolatile*/) override {
+      return llvm::MemoryBuffer::getMemBuffer(Content.getBuffer(), Name.str(),
+                                              RequiresNullTerminator);
+    }
+
+    std::error_code close() override { return std::error_code(); }
+
+  private:
+    llvm::vfs::Status S;
+    const llvm::MemoryBuffer &Content;
+  };
+
+  class CachingVFS : public llvm::vfs::ProxyFileSystem {
+  public:
+    CachingVFS(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+               SharedFileContentCache &Cache)
+        : ProxyFileSystem(std::move(FS)), Cache(Cache) {}
+
+    llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &Path) override {
+      llvm::SmallString<128> Key;
+      if (!getKey(Path, Key))
+        return getUnderlyingFS().status(Path);
+      {
+        std::lock_guard<std::mutex> Lock(Cache.Mu);
+        auto It = Cache.Files.find(Key);
+        if (It != Cache.Files.end())
+          return named(It->second.Status, Path);
+      }
+      auto S = getUnderlyingFS().status(Path);
+      if (!S && S.getError() != std::errc::no_such_file_or_directory)
+        return S;
+      std::lock_guard<std::mutex> Lock(Cache.Mu);
+      auto Inserted = Cache.Files.try_emplace(Key);
+      if (Inserted.second && S)
+        Inserted.first->second.Status = *S;
+      return named(Inserted.first->second.Status, Path);
+    }
+
+    llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+    openFileForRead(const llvm::Twine &Path) override {
+      llvm::SmallString<128> Key;
+      if (!getKey(Path, Key))
+        return getUnderlyingFS().openFileForRead(Path);
+      {
+        std::lock_guard<std::mutex> Lock(Cache.Mu);
+        auto It = Cache.Files.find(Key);
+        if (It != Cache.Files.end()) {
+          if (!It->second.Status)
+            return std::make_error_code(std::errc::no_such_file_or_directory);
+          if (It->second.Content)
+            return open(It->second, Path);
+        }
+      }
+      auto File = getUnderlyingFS().openFileForRead(Path);
+      if (!File)
+        return File;
+      auto S = (*File)->status();
+      if (!S)
+        return S.getError();
+      auto Content = (*File)->getBuffer(Key);
+      if (!Content)
+        return Content.getError();
+      std::lock_guard<std::mutex> Lock(Cache.Mu);
+      CachedFile &Entry = Cache.Files[Key];
+      // Another thread may have read the file meanwhile.
+      if (!Entry.Content) {
+        Entry.Status = std::move(*S);
+        Entry.Content = std::move(*Content);
+      }
+      return open(Entry, Path);
+    }
+
+  private:
+    // Files are cached by their absolute path, normalized like the paths of
+    // FileChangeTracker.
+    bool getKey(const llvm::Twine &Path, llvm::SmallString<128> &Key) const {
+      Path.toVector(Key);
+      if (makeAbsolute(Key))
+        return false;
+      llvm::sys::path::remove_dots(Key, /*remove_dot_dot=*/true);
+      return true;
+    }
+
+    // The cached file may have been found through another path.
+    static llvm::ErrorOr<llvm::vfs::Status>
+    named(const llvm::Optional<llvm::vfs::Status> &S,
+          const llvm::Twine &Path) {
+      if (!S)
+        return std::make_error_code(std::errc::no_such_file_or_directory);
+      return llvm::vfs::Status::copyWithNewName(*S, Path.str());
+    }
+
+    static std::unique_ptr<llvm::vfs::File> open(const CachedFile &Entry,
+                                                 const llvm::Twine &Path) {
+      return llvm::make_unique<CachedContentFile>(
+          llvm::vfs::Status::copyWithNewName(*Entry.Status, Path.str()),
+          *Entry.Content);
+    }
+
+    SharedFileContentCache &Cache;
+  };
+  return llvm::IntrusiveRefCntPtr<CachingVFS>(
+      new CachingVFS(std::move(FS), *this));
+}
+
+size_t SharedFileContentCache::getUsedBytes() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  size_t Bytes = Files.getNumBuckets() * sizeof(void *);
+  for (const auto &F : Files) {
+    Bytes += sizeof(F) + F.getKeyLength();
+    if (F.second.Content)
+      Bytes += F.second.Content->getBufferSize();
+  }
+  return Bytes;
+}
+
 } // namespace clangd
 } // namespace clang
@@ -10,12 +10,35 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_FS_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include <memory>
+#include <mutex>
 
 namespace clang {
 namespace clangd {
 
+/// Records the files reported changed by the file watcher of the client, see
+/// workspace/didChangeWatchedFiles. Each batch of changes gets a new version.
+/// This is thread-safe.
+class FileChangeTracker {
+public:
+  /// Records that \p Files (absolute paths) were created, changed or deleted.
+  void changed(llvm::ArrayRef<std::string> Files);
+  /// Returns the current version, which increases with each call to changed().
+  uint64_t version() const;
+  /// Whether \p File was reported after the changes of version \p Version.
+  bool changedSince(llvm::StringRef File, uint64_t Version) const;
+
+private:
+  mutable std::mutex Mu;
+  uint64_t Version = 0;
+  llvm::StringMap<uint64_t> LastChange; // Keyed by normalized path.
+};
+
 /// Records status information for files open()ed or stat()ed during preamble
 /// build (except for the main file), so we can avoid stat()s on the underlying
 /// FS when reusing the preamble. For example, code completion can re-stat files
@@ -44,6 +67,9 @@ public:
   /// \p Path is a path stored in preamble.
   llvm::Optional<llvm::vfs::Status> lookup(llvm::StringRef Path) const;
 
+  /// Returns the estimated memory used by the cache.
+  size_t getUsedBytes() const;
+
   /// Returns a VFS that collects file status.
   /// Only cache stats for files that exist because
   ///   1) we only care about existing files when reusing preamble, unlike
@@ -60,11 +86,54 @@ public:
   IntrusiveRefCntPtr<llvm::vfs::FileSystem>
   getConsumingFS(IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS) const;
 
+  /// Returns a VFS that uses the cache collected for the files that \p Changes
+  /// didn't report after \p Version, which must be from before the preamble
+  /// build. Unlike getConsumingFS(), this can check whether the preamble is
+  /// still valid without stat()ing its files, as long as the client watches
+  /// all of them.
+  ///
+  /// Note that the returned VFS should not outlive the cache or \p Changes.
+  IntrusiveRefCntPtr<llvm::vfs::FileSystem>
+  getWatchedFS(IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+               const FileChangeTracker &Changes, uint64_t Version) const;
+
 private:
   std::string MainFilePath;
   llvm::StringMap<llvm::vfs::Status> StatCache;
 };
 
+/// Caches the status and contents of the files read during a whole run of a
+/// tool over many translation units, which otherwise stat()s and reads the
+/// same headers again for each of them. Files that don't exist are cached
+/// too, as most stat()s of header search don't find anything.
+///
+/// Unlike PreambleFileStatusCache, files are assumed not to change during the
+/// run, so the cache is never invalidated. This is thread-safe: the FS of the
+/// cache can be shared by tools running on several threads.
+///
+/// The cache is keyed by absolute path.
+class SharedFileContentCache {
+public:
+  /// Returns a VFS reading files through the cache, and \p FS for files that
+  /// aren't cached yet. Directory listings are not cached.
+  ///
+  /// Note that the returned VFS should not outlive the cache.
+  IntrusiveRefCntPtr<llvm::vfs::FileSystem>
+  getFS(IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS);
+
+  /// Returns the estimated memory used by the cache.
+  size_t getUsedBytes() const;
+
+private:
+  struct CachedFile {
+    llvm::Optional<llvm::vfs::Status> Status; // None if the file is missing.
+    std::unique_ptr<llvm::MemoryBuffer> Content; // Null until the file is read.
+  };
+
+  mutable std::mutex Mu;
+  llvm::StringMap<CachedFile> Files;
+};
+
 } // namespace clangd
 } // namespace clang
 
@@ -176,6 +176,40 @@ FileDistance &URIDistance::forScheme(llvm::StringRef Scheme) {
   return *Delegate;
 }
 
+static bool sameSources(const llvm::StringMap<SourceParams> &L,
+                        const llvm::StringMap<SourceParams> &R) {
+  if (L.size() != R.size())
+    return false;
+  for (const auto &Source : L) {
+    auto It = R.find(Source.getKey());
+    if (It == R.end() || It->second.Cost != Source.second.Cost ||
+        It->second.MaxUpTraversals != Source.second.MaxUpTraversals)
+      return false;
+  }
+  return true;
+}
+
+std::unique_ptr<URIDistance>
+URIDistanceCache::take(llvm::StringRef Key,
+                       llvm::StringMap<SourceParams> Sources) {
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = ByKey.find(Key);
+    if (It != ByKey.end() && It->second &&
+        sameSources(It->second->sources(), Sources))
+      return std::move(It->second);
+  }
+  return llvm::make_unique<URIDistance>(std::move(Sources), Opts);
+}
+
+void URIDistanceCache::put(llvm::StringRef Key,
+                           std::unique_ptr<URIDistance> Distance) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (ByKey.size() >= MaxEntries && !ByKey.count(Key))
+    ByKey.clear();
+  ByKey[Key] = std::move(Distance);
+}
+
 static std::pair<std::string, int> scopeToPath(llvm::StringRef Scope) {
   llvm::SmallVector<llvm::StringRef, 4> Split;
   Scope.split(Split, "::", /*MaxSplit=*/-1, /*KeepEmpty=*/false);
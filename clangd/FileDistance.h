@@ -48,6 +48,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/StringSaver.h"
 #include <memory>
+#include <mutex>
 
 namespace clang {
 namespace clangd {
@@ -100,6 +101,8 @@ public:
   // Only sources that can be mapped into the URI's scheme are considered.
   unsigned distance(llvm::StringRef URI);
 
+  const llvm::StringMap<SourceParams> &sources() const { return Sources; }
+
 private:
   // Returns the FileDistance for a URI scheme, creating it if needed.
   FileDistance &forScheme(llvm::StringRef Scheme);
@@ -111,6 +114,30 @@ private:
   FileDistanceOptions Opts;
 };
 
+// Keeps URIDistances around between requests, e.g. consecutive code
+// completions in the same file. These usually have the same sources, and
+// the memoized distances to the URIs of their results are reused.
+// This class is threadsafe, but each URIDistance is only handed to one user.
+class URIDistanceCache {
+public:
+  URIDistanceCache(const FileDistanceOptions &Opts = {}) : Opts(Opts) {}
+
+  // Returns the distance stored under Key if it has the same sources, or a
+  // new one otherwise. Pass it back to put() once done.
+  std::unique_ptr<URIDistance> take(llvm::StringRef Key,
+                                    llvm::StringMap<SourceParams> Sources);
+  // Stores a distance returned by take() for later requests.
+  void put(llvm::StringRef Key, std::unique_ptr<URIDistance> Distance);
+
+private:
+  // Keys are typically open files, so clearing everything is rarely needed.
+  static constexpr unsigned MaxEntries = 64;
+
+  std::mutex Mu;
+  llvm::StringMap<std::unique_ptr<URIDistance>> ByKey; // GUARDED_BY(Mu)
+  FileDistanceOptions Opts;
+};
+
 /// Support lookups like FileDistance, but the lookup keys are symbol scopes.
 /// For example, a scope "na::nb::" is converted to "/na/nb".
 class ScopeDistance {
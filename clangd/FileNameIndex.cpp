@@ -0,0 +1,96 @@
+//===--- FileNameIndex.cpp - Files of the project by name -------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "FileNameIndex.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Path.h"
+
+namespace clang {
+namespace clangd {
+namespace {
+
+const llvm::StringRef SourceExtensions[] = {".cpp", ".c",   ".cc", ".cxx",
+                                            ".c++", ".m",   ".mm"};
+const llvm::StringRef HeaderExtensions[] = {".h", ".hh", ".hpp", ".hxx",
+                                            ".inc"};
+
+// Returns the index of the extension of Path in Extensions, compared case
+// insensitively, or -1.
+int extensionRank(PathRef Path, llvm::ArrayRef<llvm::StringRef> Extensions) {
+  llvm::StringRef Ext = llvm::sys::path::extension(Path);
+  auto It = llvm::find_if(Extensions, [&](llvm::StringRef Candidate) {
+    return Candidate.equals_lower(Ext);
+  });
+  return It == Extensions.end() ? -1 : It - Extensions.begin();
+}
+
+llvm::StringRef withoutExtension(PathRef Path) {
+  return Path.drop_back(llvm::sys::path::extension(Path).size());
+}
+
+} // namespace
+
+llvm::ArrayRef<llvm::StringRef> sourceFileExtensions() {
+  return SourceExtensions;
+}
+
+llvm::ArrayRef<llvm::StringRef> headerFileExtensions() {
+  return HeaderExtensions;
+}
+
+bool isSourceFilePath(PathRef Path) {
+  return extensionRank(Path, SourceExtensions) >= 0;
+}
+
+bool isHeaderFilePath(PathRef Path) {
+  return extensionRank(Path, HeaderExtensions) >= 0;
+}
+
+void FileNameIndex::addFile(PathRef File) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto &Known = Files[withoutExtension(File)];
+  if (llvm::is_contained(Known, File))
+    return;
+  Known.push_back(File.str());
+  ++NumFiles;
+}
+
+llvm::Optional<Path> FileNameIndex::counterpart(PathRef File) const {
+  llvm::ArrayRef<llvm::StringRef> Wanted;
+  if (isSourceFilePath(File))
+    Wanted = HeaderExtensions;
+  else if (isHeaderFilePath(File))
+    Wanted = SourceExtensions;
+  else
+    return llvm::None;
+
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto It = Files.find(withoutExtension(File));
+  if (It == Files.end())
+    return llvm::None;
+  const std::string *Best = nullptr;
+  int BestRank = -1;
+  for (const std::string &Candidate : It->second) {
+    int Rank = extensionRank(Candidate, Wanted);
+    if (Rank >= 0 && (!Best || Rank < BestRank)) {
+      Best = &Candidate;
+      BestRank = Rank;
+    }
+  }
+  if (!Best)
+    return llvm::None;
+  return *Best;
+}
+
+size_t FileNameIndex::size() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  return NumFiles;
+}
+
+} // namespace clangd
+} // namespace clang
@@ -0,0 +1,71 @@
+//===--- FileNameIndex.h - Files of the project by name ----------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Remembers the files clangd has seen in the project: main files from the
+// compilation database, files open in the editor, and files in their include
+// graphs. Queries that look for a file related by name, such as switching
+// between a header and its source file, can then be answered with a lookup
+// instead of probing the filesystem for each candidate name, which is slow on
+// network filesystems.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_FILENAMEINDEX_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_FILENAMEINDEX_H
+
+#include "Path.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <mutex>
+#include <string>
+
+namespace clang {
+namespace clangd {
+
+/// Extensions of C-family source and header files, with the dot, in order of
+/// preference when looking for the counterpart of a file.
+llvm::ArrayRef<llvm::StringRef> sourceFileExtensions();
+llvm::ArrayRef<llvm::StringRef> headerFileExtensions();
+
+/// Whether \p Path has the extension of a C-family source file.
+bool isSourceFilePath(PathRef Path);
+/// Whether \p Path has the extension of a C-family header file.
+bool isHeaderFilePath(PathRef Path);
+
+/// The set of known files of the project, indexed by their path without the
+/// extension. Files are never removed: a stale entry only costs a filesystem
+/// check by the caller.
+/// This class is thread-safe.
+class FileNameIndex {
+public:
+  /// Records that \p File exists. \p File must be an absolute path.
+  void addFile(PathRef File);
+
+  /// Returns a known file in the directory of \p File with the same name but
+  /// the opposite kind, i.e. a header for a source file and vice versa.
+  /// Files with a known extension are preferred in the order of the list of
+  /// source or header extensions.
+  llvm::Optional<Path> counterpart(PathRef File) const;
+
+  /// Number of known files.
+  size_t size() const;
+
+private:
+  mutable std::mutex Mu;
+  // Known files by their path without extension. Most have one or two.
+  llvm::StringMap<llvm::SmallVector<std::string, 2>> Files;
+  size_t NumFiles = 0;
+};
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_FILENAMEINDEX_H
@@ -67,17 +67,11 @@ getWorkspaceSymbols(llvm::StringRef Query, int Limit,
   Index->fuzzyFind(Req, [HintPath, &Top, &Filter](const Symbol &Sym) {
     // Prefer the definition over e.g. a function declaration in a header
     auto &CD = Sym.Definition ? Sym.Definition : Sym.CanonicalDeclaration;
-    auto Uri = URI::parse(CD.FileURI);
-    if (!Uri) {
-      log("Workspace symbol: Could not parse URI '{0}' for symbol '{1}'.",
-          CD.FileURI, Sym.Name);
-      return;
-    }
-    auto Path = URI::resolve(*Uri, HintPath);
+    auto Path = URI::resolve(CD.FileURI, HintPath);
     if (!Path) {
       log("Workspace symbol: Could not resolve path for URI '{0}' for symbol "
-          "'{1}'.",
-          Uri->toString(), Sym.Name);
+          "'{1}': {2}",
+          CD.FileURI, Sym.Name, Path.takeError());
       return;
     }
     Location L;
@@ -260,7 +254,10 @@ std::vector<DocumentSymbol> collectDocSymbols(ParsedAST &AST) {
 } // namespace
 
 llvm::Expected<std::vector<DocumentSymbol>> getDocumentSymbols(ParsedAST &AST) {
-  return collectDocSymbols(AST);
+  auto &Cached = AST.cachedDocumentSymbols();
+  if (!Cached)
+    Cached = collectDocSymbols(AST);
+  return *Cached;
 }
 
 } // namespace clangd
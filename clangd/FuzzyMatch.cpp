@@ -185,16 +185,19 @@ bool FuzzyMatcher::init(llvm::StringRef NewWord) {
   std::copy(NewWord.begin(), NewWord.begin() + WordN, Word);
   if (PatN == 0)
     return true;
-  for (int I = 0; I < WordN; ++I)
-    LowWord[I] = lower(Word[I]);
 
-  // Cheap subsequence check.
+  // Cheap subsequence check. Most words are rejected here, so it runs before
+  // any other per-word work.
+  // The greedy scan also finds the earliest position at which each pattern
+  // character can be matched, which buildGraph() uses to skip dead cells.
   for (int W = 0, P = 0; P != PatN; ++W) {
     if (W == WordN)
       return false;
-    if (LowWord[W] == LowPat[P])
-      ++P;
+    if (lower(Word[W]) == LowPat[P])
+      FirstMatch[P++] = W;
   }
+  for (int I = 0; I < WordN; ++I)
+    LowWord[I] = lower(Word[I]);
 
   // FIXME: some words are hard to tokenize algorithmically.
   // e.g. vsprintf is V S Print F, and should match [pri] but not [int].
@@ -213,6 +216,11 @@ bool FuzzyMatcher::init(llvm::StringRef NewWord) {
 // and 3 being a great one. So we treat the score range as [0, 3 * PatN].
 // This range is not strict: we can apply larger bonuses/penalties, or penalize
 // non-matched characters.
+//
+// Only cells that can be on a complete match are filled in: Pat[..P] can't be
+// matched before Word[FirstMatch[P]], and the rest of the pattern needs as many
+// word characters. Other cells are never read, except for the left boundary of
+// each row, which is set to AwfulScore.
 void FuzzyMatcher::buildGraph() {
   for (int W = 0; W < WordN; ++W) {
     Scores[0][W + 1][Miss] = {Scores[0][W][Miss].Score - skipPenalty(W, Miss),
@@ -220,7 +228,9 @@ void FuzzyMatcher::buildGraph() {
     Scores[0][W + 1][Match] = {AwfulScore, Miss};
   }
   for (int P = 0; P < PatN; ++P) {
-    for (int W = P; W < WordN; ++W) {
+    Scores[P + 1][FirstMatch[P]][Miss] = {AwfulScore, Miss};
+    Scores[P + 1][FirstMatch[P]][Match] = {AwfulScore, Miss};
+    for (int W = FirstMatch[P], End = WordN - PatN + P + 1; W < End; ++W) {
       auto &Score = Scores[P + 1][W + 1], &PreMiss = Scores[P + 1][W];
 
       auto MatchMissScore = PreMiss[Match].Score;
@@ -322,7 +332,9 @@ llvm::SmallString<256> FuzzyMatcher::dumpLast(llvm::raw_ostream &OS) const {
     return Result;
   } else if (isAwful(std::max(Scores[PatN][WordN][Match].Score,
                               Scores[PatN][WordN][Miss].Score))) {
+    // There's no match to reconstruct, and parts of the table weren't filled.
     OS << "Substring check passed, but all matches are forbidden\n";
+    return Result;
   }
   if (!(PatTypeSet & 1 << Upper))
     OS << "Lowercase query, so scoring ignores case\n";
@@ -384,7 +396,9 @@ llvm::SmallString<256> FuzzyMatcher::dumpLast(llvm::raw_ostream &OS) const {
     for (Action A : {Miss, Match}) {
       OS << ((I && A == Miss) ? Pat[I - 1] : ' ') << "|";
       for (int J = 0; J <= WordN; ++J) {
-        if (!isAwful(Scores[I][J][A].Score))
+        bool Filled =
+            I == 0 || (J > FirstMatch[I - 1] && J <= WordN - PatN + I);
+        if (Filled && !isAwful(Scores[I][J][A].Score))
           OS << llvm::format("%3d%c", Scores[I][J][A].Score,
                              Scores[I][J][A].Prev == Match ? '*' : ' ');
         else
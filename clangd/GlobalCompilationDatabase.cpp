@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "GlobalCompilationDatabase.h"
+#include "CompileCommandsCache.h"
 #include "Logger.h"
 #include "clang/Frontend/CompilerInvocation.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
@@ -72,7 +73,8 @@ GlobalCompilationDatabase::getFallbackCommand(PathRef File) const {
 DirectoryBasedGlobalCompilationDatabase::
     DirectoryBasedGlobalCompilationDatabase(
         llvm::Optional<Path> CompileCommandsDir)
-    : CompileCommandsDir(std::move(CompileCommandsDir)) {}
+    : CDBSnapshot(std::make_shared<CDBMap>()),
+      CompileCommandsDir(std::move(CompileCommandsDir)) {}
 
 DirectoryBasedGlobalCompilationDatabase::
     ~DirectoryBasedGlobalCompilationDatabase() = default;
@@ -91,53 +93,131 @@ DirectoryBasedGlobalCompilationDatabase::getCompileCommand(
   return None;
 }
 
-std::pair<tooling::CompilationDatabase *, /*Cached*/ bool>
+std::pair<DirectoryBasedGlobalCompilationDatabase::CDBPtr, /*Cached*/ bool>
 DirectoryBasedGlobalCompilationDatabase::getCDBInDirLocked(PathRef Dir) const {
-  // FIXME(ibiryukov): Invalidate cached compilation databases on changes
   auto CachedIt = CompilationDatabases.find(Dir);
   if (CachedIt != CompilationDatabases.end())
-    return {CachedIt->second.get(), true};
+    return {CachedIt->second, true};
   std::string Error = "";
-  auto CDB = tooling::CompilationDatabase::loadFromDirectory(Dir, Error);
-  auto Result = CDB.get();
-  CompilationDatabases.insert(std::make_pair(Dir, std::move(CDB)));
+  // compile_commands.json is loaded through a binary cache, other kinds of
+  // databases (e.g. compile_flags.txt) directly.
+  static const llvm::Optional<std::string> CacheDir =
+      getCompileCommandsCacheDir();
+  std::unique_ptr<tooling::CompilationDatabase> CDB;
+  if (CacheDir)
+    CDB = loadCachedJSONCompilationDatabase(Dir, *CacheDir);
+  if (!CDB)
+    CDB = tooling::CompilationDatabase::loadFromDirectory(Dir, Error);
+  CDBPtr Result = std::move(CDB);
+  CompilationDatabases.insert(std::make_pair(Dir, Result));
   return {Result, false};
 }
 
-tooling::CompilationDatabase *
-DirectoryBasedGlobalCompilationDatabase::getCDBForFile(
-    PathRef File, ProjectInfo *Project) const {
-  namespace path = llvm::sys::path;
-  assert((path::is_absolute(File, path::Style::posix) ||
-          path::is_absolute(File, path::Style::windows)) &&
-         "path must be absolute");
+void DirectoryBasedGlobalCompilationDatabase::updateSnapshotLocked() const {
+  auto NewSnapshot = std::make_shared<CDBMap>(CompilationDatabases);
+  std::atomic_store(&CDBSnapshot,
+                    std::shared_ptr<const CDBMap>(std::move(NewSnapshot)));
+}
 
-  tooling::CompilationDatabase *CDB = nullptr;
-  bool Cached = false;
-  std::lock_guard<std::mutex> Lock(Mutex);
+DirectoryBasedGlobalCompilationDatabase::CDBPtr
+DirectoryBasedGlobalCompilationDatabase::findCDB(
+    PathRef File, ProjectInfo *Project,
+    llvm::function_ref<CDBPtr(PathRef Dir)> GetCDBInDir) const {
+  namespace path = llvm::sys::path;
+  CDBPtr CDB;
   if (CompileCommandsDir) {
-    std::tie(CDB, Cached) = getCDBInDirLocked(*CompileCommandsDir);
+    CDB = GetCDBInDir(*CompileCommandsDir);
     if (Project && CDB)
       Project->SourceRoot = *CompileCommandsDir;
   } else {
     for (auto Path = path::parent_path(File); !CDB && !Path.empty();
          Path = path::parent_path(Path)) {
-      std::tie(CDB, Cached) = getCDBInDirLocked(Path);
+      CDB = GetCDBInDir(Path);
       if (Project && CDB)
         Project->SourceRoot = Path;
     }
   }
+  return CDB;
+}
+
+DirectoryBasedGlobalCompilationDatabase::CDBPtr
+DirectoryBasedGlobalCompilationDatabase::getCDBForFile(
+    PathRef File, ProjectInfo *Project) const {
+  namespace path = llvm::sys::path;
+  assert((path::is_absolute(File, path::Style::posix) ||
+          path::is_absolute(File, path::Style::windows)) &&
+         "path must be absolute");
+
+  // Usually all the directories were searched before, and the snapshot has
+  // the answer.
+  bool Complete = true;
+  auto Snapshot = std::atomic_load(&CDBSnapshot);
+  auto CDB = findCDB(File, Project, [&](PathRef Dir) {
+    auto It = Snapshot->find(Dir);
+    if (It != Snapshot->end())
+      return It->second;
+    Complete = false;
+    return CDBPtr();
+  });
+  if (Complete)
+    return CDB;
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  std::vector<CDBPtr> Loaded;
+  CDB = findCDB(File, Project, [&](PathRef Dir) {
+    auto Result = getCDBInDirLocked(Dir);
+    if (Result.first && !Result.second)
+      Loaded.push_back(Result.first);
+    return Result.first;
+  });
+  updateSnapshotLocked();
   // FIXME: getAllFiles() may return relative paths, we need absolute paths.
   // Hopefully the fix is to change JSONCompilationDatabase and the interface.
-  if (CDB && !Cached)
-    OnCommandChanged.broadcast(CDB->getAllFiles());
+  for (const auto &LoadedCDB : Loaded)
+    OnCommandChanged.broadcast(LoadedCDB->getAllFiles());
   return CDB;
 }
 
+bool DirectoryBasedGlobalCompilationDatabase::filesChanged(
+    llvm::ArrayRef<std::string> ChangedFiles) {
+  std::vector<std::string> AffectedFiles;
+  bool Reloaded = false;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    for (const std::string &File : ChangedFiles) {
+      llvm::StringRef Name = llvm::sys::path::filename(File);
+      if (Name != "compile_commands.json" && Name != "compile_flags.txt")
+        continue;
+      llvm::StringRef Dir = llvm::sys::path::parent_path(File);
+      // Directories that were never searched are loaded when first needed.
+      auto It = CompilationDatabases.find(Dir);
+      if (It == CompilationDatabases.end())
+        continue;
+      if (It->second) {
+        auto Files = It->second->getAllFiles();
+        AffectedFiles.insert(AffectedFiles.end(), Files.begin(), Files.end());
+      }
+      CompilationDatabases.erase(It);
+      if (auto CDB = getCDBInDirLocked(Dir).first) {
+        auto Files = CDB->getAllFiles();
+        AffectedFiles.insert(AffectedFiles.end(), Files.begin(), Files.end());
+      }
+      log("Reloaded compilation database in {0}", Dir);
+      Reloaded = true;
+    }
+    if (Reloaded)
+      updateSnapshotLocked();
+  }
+  if (!AffectedFiles.empty())
+    OnCommandChanged.broadcast(AffectedFiles);
+  return Reloaded;
+}
+
 OverlayCDB::OverlayCDB(const GlobalCompilationDatabase *Base,
                        std::vector<std::string> FallbackFlags,
                        llvm::Optional<std::string> ResourceDir)
-    : Base(Base), ResourceDir(ResourceDir ? std::move(*ResourceDir)
+    : Commands(std::make_shared<CommandMap>()), Base(Base),
+      ResourceDir(ResourceDir ? std::move(*ResourceDir)
                                           : getStandardResourceDir()),
       FallbackFlags(std::move(FallbackFlags)) {
   if (Base)
@@ -149,14 +229,12 @@ OverlayCDB::OverlayCDB(const GlobalCompilationDatabase *Base,
 llvm::Optional<tooling::CompileCommand>
 OverlayCDB::getCompileCommand(PathRef File, ProjectInfo *Project) const {
   llvm::Optional<tooling::CompileCommand> Cmd;
-  {
-    std::lock_guard<std::mutex> Lock(Mutex);
-    auto It = Commands.find(File);
-    if (It != Commands.end()) {
-      if (Project)
-        Project->SourceRoot = "";
-      Cmd = It->second;
-    }
+  auto Snapshot = std::atomic_load(&Commands);
+  auto It = Snapshot->find(File);
+  if (It != Snapshot->end()) {
+    if (Project)
+      Project->SourceRoot = "";
+    Cmd = It->second;
   }
   if (!Cmd && Base)
     Cmd = Base->getCompileCommand(File, Project);
@@ -169,7 +247,6 @@ OverlayCDB::getCompileCommand(PathRef File, ProjectInfo *Project) const {
 tooling::CompileCommand OverlayCDB::getFallbackCommand(PathRef File) const {
   auto Cmd = Base ? Base->getFallbackCommand(File)
                   : GlobalCompilationDatabase::getFallbackCommand(File);
-  std::lock_guard<std::mutex> Lock(Mutex);
   Cmd.CommandLine.insert(Cmd.CommandLine.end(), FallbackFlags.begin(),
                          FallbackFlags.end());
   return Cmd;
@@ -178,11 +255,14 @@ tooling::CompileCommand OverlayCDB::getFallbackCommand(PathRef File) const {
 void OverlayCDB::setCompileCommand(
     PathRef File, llvm::Optional<tooling::CompileCommand> Cmd) {
   {
-    std::unique_lock<std::mutex> Lock(Mutex);
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto NewCommands = std::make_shared<CommandMap>(*Commands);
     if (Cmd)
-      Commands[File] = std::move(*Cmd);
+      (*NewCommands)[File] = std::move(*Cmd);
     else
-      Commands.erase(File);
+      NewCommands->erase(File);
+    std::atomic_store(&Commands, std::shared_ptr<const CommandMap>(
+                                     std::move(NewCommands)));
   }
   OnCommandChanged.broadcast({File});
 }
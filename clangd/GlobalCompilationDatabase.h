@@ -11,7 +11,9 @@
 
 #include "Function.h"
 #include "Path.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include <memory>
 #include <mutex>
@@ -74,17 +76,32 @@ public:
   llvm::Optional<tooling::CompileCommand>
   getCompileCommand(PathRef File, ProjectInfo * = nullptr) const override;
 
+  /// Reloads the cached databases of directories whose compile_commands.json
+  /// or compile_flags.txt is among \p ChangedFiles, and notifies watchers of
+  /// the files in the old and new databases. Returns true if any database was
+  /// reloaded.
+  bool filesChanged(llvm::ArrayRef<std::string> ChangedFiles);
+
 private:
-  tooling::CompilationDatabase *getCDBForFile(PathRef File,
-                                              ProjectInfo *) const;
-  std::pair<tooling::CompilationDatabase *, /*Cached*/ bool>
-  getCDBInDirLocked(PathRef File) const;
+  using CDBPtr = std::shared_ptr<tooling::CompilationDatabase>;
+
+  CDBPtr getCDBForFile(PathRef File, ProjectInfo *) const;
+  std::pair<CDBPtr, /*Cached*/ bool> getCDBInDirLocked(PathRef File) const;
+  CDBPtr findCDB(PathRef File, ProjectInfo *Project,
+                 llvm::function_ref<CDBPtr(PathRef Dir)> GetCDBInDir) const;
+  void updateSnapshotLocked() const;
+
+  using CDBMap = llvm::StringMap<CDBPtr>;
 
   mutable std::mutex Mutex;
   /// Caches compilation databases loaded from directories(keys are
-  /// directories).
-  mutable llvm::StringMap<std::unique_ptr<clang::tooling::CompilationDatabase>>
-      CompilationDatabases;
+  /// directories). Databases are shared with the snapshots, so that readers
+  /// can keep using a database that filesChanged() replaced.
+  mutable CDBMap CompilationDatabases;
+  /// A copy of CompilationDatabases, read without locking Mutex. Replaced by a
+  /// new snapshot when directories are added or reloaded. Accessed with
+  /// std::atomic_load and std::atomic_store.
+  mutable std::shared_ptr<const CDBMap> CDBSnapshot;
 
   /// Used for command argument pointing to folder where compile_commands.json
   /// is located.
@@ -111,8 +128,13 @@ public:
                     llvm::Optional<tooling::CompileCommand> CompilationCommand);
 
 private:
-  mutable std::mutex Mutex;
-  llvm::StringMap<tooling::CompileCommand> Commands; /* GUARDED_BY(Mut) */
+  using CommandMap = llvm::StringMap<tooling::CompileCommand>;
+
+  /// Serializes setCompileCommand() calls.
+  std::mutex Mutex;
+  /// Read without locking: setCompileCommand() replaces the whole map.
+  /// Accessed with std::atomic_load and std::atomic_store.
+  std::shared_ptr<const CommandMap> Commands;
   const GlobalCompilationDatabase *Base;
   std::string ResourceDir;
   std::vector<std::string> FallbackFlags;
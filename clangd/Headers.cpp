@@ -189,13 +189,20 @@ IncludeInserter::calculateIncludePath(const HeaderFile &DeclaringHeader,
   assert(DeclaringHeader.valid() && InsertedHeader.valid());
   if (InsertedHeader.Verbatim)
     return InsertedHeader.File;
+  if (SpellingCache)
+    if (auto Cached = SpellingCache->get(BuildDir, InsertedHeader.File))
+      return std::move(*Cached);
+  if (!HeaderSearchInfo)
+    return "";
   bool IsSystem = false;
-  std::string Suggested = HeaderSearchInfo.suggestPathToFileForDiagnostics(
+  std::string Suggested = HeaderSearchInfo->suggestPathToFileForDiagnostics(
       InsertedHeader.File, BuildDir, &IsSystem);
   if (IsSystem)
     Suggested = "<" + Suggested + ">";
   else
     Suggested = "\"" + Suggested + "\"";
+  if (SpellingCache)
+    SpellingCache->put(BuildDir, InsertedHeader.File, Suggested);
   return Suggested;
 }
 
@@ -208,6 +215,35 @@ IncludeInserter::insert(llvm::StringRef VerbatimHeader) const {
   return Edit;
 }
 
+// Spellings are small, but the bound keeps long sessions on a single preamble
+// in check.
+constexpr size_t MaxCachedIncludeSpellings = 10000;
+
+// Keys are the build directory and the header, separated by a character that
+// can't appear in paths.
+static std::string spellingKey(llvm::StringRef BuildDir,
+                               llvm::StringRef Header) {
+  return (BuildDir + llvm::Twine('\0') + Header).str();
+}
+
+llvm::Optional<std::string>
+IncludeSpellingCache::get(llvm::StringRef BuildDir,
+                          llvm::StringRef Header) const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto It = Spellings.find(spellingKey(BuildDir, Header));
+  if (It == Spellings.end())
+    return llvm::None;
+  return It->second;
+}
+
+void IncludeSpellingCache::put(llvm::StringRef BuildDir,
+                               llvm::StringRef Header, std::string Spelled) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (Spellings.size() >= MaxCachedIncludeSpellings)
+    Spellings.clear();
+  Spellings[spellingKey(BuildDir, Header)] = std::move(Spelled);
+}
+
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const Inclusion &Inc) {
   return OS << Inc.Written << " = "
             << (Inc.Resolved.empty() ? Inc.Resolved : "[unresolved]") << " at "
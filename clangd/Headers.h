@@ -18,10 +18,13 @@
 #include "clang/Lex/PPCallbacks.h"
 #include "clang/Tooling/Inclusions/HeaderIncludes.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include <mutex>
 
 namespace clang {
 namespace clangd {
@@ -116,14 +119,42 @@ private:
 std::unique_ptr<PPCallbacks>
 collectIncludeStructureCallback(const SourceManager &SM, IncludeStructure *Out);
 
+/// Remembers how headers are spelled in #include directives, which only
+/// depends on the header search configuration. Computing a spelling walks the
+/// search paths, and the same headers are suggested in many requests.
+/// Only suitable for requests with the same header search configuration, such
+/// as those sharing a preamble.
+/// This class is thread-safe.
+class IncludeSpellingCache {
+public:
+  llvm::Optional<std::string> get(llvm::StringRef BuildDir,
+                                  llvm::StringRef Header) const;
+  void put(llvm::StringRef BuildDir, llvm::StringRef Header,
+           std::string Spelled);
+
+private:
+  mutable std::mutex Mu;
+  llvm::StringMap<std::string> Spellings;
+};
+
 // Calculates insertion edit for including a new header in a file.
 class IncludeInserter {
 public:
+  /// \p SpellingCache, if set, is used to reuse the spelling of headers.
+  IncludeInserter(StringRef FileName, StringRef Code,
+                  const format::FormatStyle &Style, StringRef BuildDir,
+                  HeaderSearch &HeaderSearchInfo,
+                  IncludeSpellingCache *SpellingCache = nullptr)
+      : FileName(FileName), Code(Code), BuildDir(BuildDir),
+        HeaderSearchInfo(&HeaderSearchInfo), SpellingCache(SpellingCache),
+        Inserter(FileName, Code, Style.IncludeStyle) {}
+  /// Without the header search paths of a compiler, only verbatim headers and
+  /// the headers spelled in \p SpellingCache can be included.
   IncludeInserter(StringRef FileName, StringRef Code,
                   const format::FormatStyle &Style, StringRef BuildDir,
-                  HeaderSearch &HeaderSearchInfo)
+                  IncludeSpellingCache *SpellingCache)
       : FileName(FileName), Code(Code), BuildDir(BuildDir),
-        HeaderSearchInfo(HeaderSearchInfo),
+        HeaderSearchInfo(nullptr), SpellingCache(SpellingCache),
         Inserter(FileName, Code, Style.IncludeStyle) {}
 
   void addExisting(const Inclusion &Inc);
@@ -150,7 +181,8 @@ public:
   /// \param InsertedHeader The preferred header to be inserted. This could be
   /// the same as DeclaringHeader but must be provided.
   ///
-  /// \return A quoted "path" or <path> to be included.
+  /// \return A quoted "path" or <path> to be included, or an empty string if
+  /// the header can't be spelled without header search paths.
   std::string calculateIncludePath(const HeaderFile &DeclaringHeader,
                                    const HeaderFile &InsertedHeader) const;
 
@@ -162,7 +194,8 @@ private:
   StringRef FileName;
   StringRef Code;
   StringRef BuildDir;
-  HeaderSearch &HeaderSearchInfo;
+  HeaderSearch *HeaderSearchInfo; // Can be nullptr.
+  IncludeSpellingCache *SpellingCache; // Can be nullptr.
   llvm::StringSet<> IncludedHeaders; // Both written and resolved.
   tooling::HeaderIncludes Inserter;  // Computers insertion replacement.
 };
@@ -63,8 +63,34 @@ private:
 
 } // namespace
 
-std::vector<Fix> IncludeFixer::fix(DiagnosticsEngine::Level DiagLevel,
-                                   const clang::Diagnostic &Info) const {
+std::shared_ptr<const SymbolSlab> IncludeFixerCache::get(llvm::StringRef Key,
+                                                         uint64_t Generation) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (Generation != this->Generation) {
+    Results.clear();
+    this->Generation = Generation;
+    return nullptr;
+  }
+  auto I = Results.find(Key);
+  return I == Results.end() ? nullptr : I->second;
+}
+
+void IncludeFixerCache::put(llvm::StringRef Key, uint64_t Generation,
+                            std::shared_ptr<const SymbolSlab> Results) {
+  // Most results are empty or hold a few symbols, this bounds the memory used
+  // by names that used to be unresolved.
+  constexpr unsigned MaxResults = 1000;
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (Generation != this->Generation) // The results may be outdated already.
+    return;
+  if (this->Results.size() >= MaxResults)
+    this->Results.clear();
+  this->Results[Key] = std::move(Results);
+}
+
+StoreDiags::DeferredFix
+IncludeFixer::fix(DiagnosticsEngine::Level DiagLevel,
+                  const clang::Diagnostic &Info) const {
   switch (Info.getID()) {
   case diag::err_incomplete_type:
   case diag::err_incomplete_member_access:
@@ -109,10 +135,10 @@ std::vector<Fix> IncludeFixer::fix(DiagnosticsEngine::Level DiagLevel,
         return fixUnresolvedName();
     }
   }
-  return {};
+  return nullptr;
 }
 
-std::vector<Fix> IncludeFixer::fixIncompleteType(const Type &T) const {
+StoreDiags::DeferredFix IncludeFixer::fixIncompleteType(const Type &T) const {
   // Only handle incomplete TagDecl type.
   const TagDecl *TD = T.getAsTagDecl();
   if (!TD)
@@ -124,19 +150,21 @@ std::vector<Fix> IncludeFixer::fixIncompleteType(const Type &T) const {
 
   auto ID = getSymbolID(TD);
   if (!ID)
-    return {};
-  llvm::Optional<const SymbolSlab *> Symbols = lookupCached(*ID);
-  if (!Symbols)
-    return {};
-  const SymbolSlab &Syms = **Symbols;
-  std::vector<Fix> Fixes;
-  if (!Syms.empty()) {
+    return nullptr;
+  std::string Key = "lookup:" + ID->str();
+  if (!request(Key, [&] { PendingLookup.IDs.insert(*ID); }))
+    return nullptr;
+  return [this, Key]() -> std::vector<Fix> {
+    runPendingRequests();
+    const SymbolSlab &Syms = *Results.find(Key)->second;
+    if (Syms.empty())
+      return {};
     auto &Matched = *Syms.begin();
     if (!Matched.IncludeHeaders.empty() && Matched.Definition &&
         Matched.CanonicalDeclaration.FileURI == Matched.Definition.FileURI)
-      Fixes = fixesForSymbols(Syms);
-  }
-  return Fixes;
+      return fixesForSymbols(Syms);
+    return {};
+  };
 }
 
 std::vector<Fix> IncludeFixer::fixesForSymbols(const SymbolSlab &Syms) const {
@@ -375,7 +403,7 @@ IncludeFixer::unresolvedNameRecorder() {
   return new UnresolvedNameRecorder(LastUnresolvedName);
 }
 
-std::vector<Fix> IncludeFixer::fixUnresolvedName() const {
+StoreDiags::DeferredFix IncludeFixer::fixUnresolvedName() const {
   assert(LastUnresolvedName.hasValue());
   auto &Unresolved = *LastUnresolvedName;
   std::vector<std::string> Scopes = Unresolved.GetScopes();
@@ -389,63 +417,80 @@ std::vector<Fix> IncludeFixer::fixUnresolvedName() const {
   Req.RestrictForCodeCompletion = true;
   Req.Limit = 100;
 
-  if (llvm::Optional<const SymbolSlab *> Syms = fuzzyFindCached(Req))
-    return fixesForSymbols(**Syms);
-
-  return {};
+  std::string Key = llvm::formatv("fuzzyFind:{0}", toJSON(Req)).str();
+  if (!request(Key, [&] {
+        PendingFuzzyFinds.push_back(std::move(Req));
+        PendingFuzzyFindKeys.push_back(Key);
+      }))
+    return nullptr;
+  return [this, Key]() -> std::vector<Fix> {
+    runPendingRequests();
+    return fixesForSymbols(*Results.find(Key)->second);
+  };
 }
 
-
-llvm::Optional<const SymbolSlab *>
-IncludeFixer::fuzzyFindCached(const FuzzyFindRequest &Req) const {
-  auto ReqStr = llvm::formatv("{0}", toJSON(Req)).str();
-  auto I = FuzzyFindCache.find(ReqStr);
-  if (I != FuzzyFindCache.end())
-    return &I->second;
-
+bool IncludeFixer::request(llvm::StringRef Key,
+                           llvm::function_ref<void()> AddPending) const {
+  if (Results.count(Key))
+    return true;
+  if (Cache) {
+    if (auto Cached = Cache->get(Key, Index.headerGeneration())) {
+      Results[Key] = std::move(Cached);
+      return true;
+    }
+  }
   if (IndexRequestCount >= IndexRequestLimit)
-    return llvm::None;
+    return false;
   IndexRequestCount++;
-
-  SymbolSlab::Builder Matches;
-  Index.fuzzyFind(Req, [&](const Symbol &Sym) {
-    if (Sym.Name != Req.Query)
-      return;
-    if (!Sym.IncludeHeaders.empty())
-      Matches.insert(Sym);
-  });
-  auto Syms = std::move(Matches).build();
-  auto E = FuzzyFindCache.try_emplace(ReqStr, std::move(Syms));
-  return &E.first->second;
+  Results[Key] = nullptr;
+  AddPending();
+  return true;
 }
 
-llvm::Optional<const SymbolSlab *>
-IncludeFixer::lookupCached(const SymbolID &ID) const {
-  LookupRequest Req;
-  Req.IDs.insert(ID);
-
-  auto I = LookupCache.find(ID);
-  if (I != LookupCache.end())
-    return &I->second;
-
-  if (IndexRequestCount >= IndexRequestLimit)
-    return llvm::None;
-  IndexRequestCount++;
+void IncludeFixer::runPendingRequests() const {
+  if (PendingLookup.IDs.empty() && PendingFuzzyFinds.empty())
+    return;
+  trace::Span Tracer("IncludeFixer index requests");
+  SPAN_ATTACH(Tracer, "lookups", int(PendingLookup.IDs.size()));
+  SPAN_ATTACH(Tracer, "fuzzyFinds", int(PendingFuzzyFinds.size()));
+  // Read before querying: if the index changes meanwhile, we may get outdated
+  // results and must not cache them.
+  uint64_t Generation = Index.headerGeneration();
+  auto Store = [&](llvm::StringRef Key, SymbolSlab::Builder &Matches) {
+    auto Syms = std::make_shared<const SymbolSlab>(std::move(Matches).build());
+    if (Cache)
+      Cache->put(Key, Generation, Syms);
+    Results[Key] = std::move(Syms);
+  };
 
-  // FIXME: consider batching the requests for all diagnostics.
-  SymbolSlab::Builder Matches;
-  Index.lookup(Req, [&](const Symbol &Sym) { Matches.insert(Sym); });
-  auto Syms = std::move(Matches).build();
+  if (!PendingLookup.IDs.empty()) {
+    SymbolSlab::Builder Matches;
+    Index.lookup(PendingLookup,
+                 [&](const Symbol &Sym) { Matches.insert(Sym); });
+    SymbolSlab All = std::move(Matches).build();
+    for (const SymbolID &ID : PendingLookup.IDs) {
+      SymbolSlab::Builder Match;
+      auto It = All.find(ID);
+      if (It != All.end())
+        Match.insert(*It);
+      Store("lookup:" + ID.str(), Match);
+    }
+    PendingLookup.IDs.clear();
+  }
 
-  std::vector<Fix> Fixes;
-  if (!Syms.empty()) {
-    auto &Matched = *Syms.begin();
-    if (!Matched.IncludeHeaders.empty() && Matched.Definition &&
-        Matched.CanonicalDeclaration.FileURI == Matched.Definition.FileURI)
-      Fixes = fixesForSymbols(Syms);
+  if (!PendingFuzzyFinds.empty()) {
+    std::vector<SymbolSlab::Builder> Matches(PendingFuzzyFinds.size());
+    Index.fuzzyFindBatch(PendingFuzzyFinds, [&](size_t I, const Symbol &Sym) {
+      if (Sym.Name != PendingFuzzyFinds[I].Query)
+        return;
+      if (!Sym.IncludeHeaders.empty())
+        Matches[I].insert(Sym);
+    });
+    for (size_t I = 0; I < Matches.size(); ++I)
+      Store(PendingFuzzyFindKeys[I], Matches[I]);
+    PendingFuzzyFinds.clear();
+    PendingFuzzyFindKeys.clear();
   }
-  auto E = LookupCache.try_emplace(ID, std::move(Syms));
-  return &E.first->second;
 }
 
 } // namespace clangd
@@ -22,26 +22,52 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include <memory>
+#include <mutex>
 
 namespace clang {
 namespace clangd {
 
+/// Caches the index results of IncludeFixer across builds, until the symbols
+/// declared in headers change (see SymbolIndex::headerGeneration()).
+/// This is thread-safe.
+class IncludeFixerCache {
+public:
+  /// Returns the results of the query \p Key, or null if they're not cached.
+  /// Forgets all results if the index is now at another \p Generation.
+  std::shared_ptr<const SymbolSlab> get(llvm::StringRef Key,
+                                        uint64_t Generation);
+  /// Caches the \p Results of the query \p Key, which ran when the index was
+  /// at \p Generation.
+  void put(llvm::StringRef Key, uint64_t Generation,
+           std::shared_ptr<const SymbolSlab> Results);
+
+private:
+  std::mutex Mu;
+  uint64_t Generation = 0;
+  llvm::StringMap<std::shared_ptr<const SymbolSlab>> Results;
+};
+
 /// Attempts to recover from error diagnostics by suggesting include insertion
 /// fixes. For example, member access into incomplete type can be fixes by
 /// include headers with the definition.
 class IncludeFixer {
 public:
   IncludeFixer(llvm::StringRef File, std::shared_ptr<IncludeInserter> Inserter,
-               const SymbolIndex &Index, unsigned IndexRequestLimit)
+               const SymbolIndex &Index, unsigned IndexRequestLimit,
+               IncludeFixerCache *Cache = nullptr)
       : File(File), Inserter(std::move(Inserter)), Index(Index),
-        IndexRequestLimit(IndexRequestLimit) {}
+        IndexRequestLimit(IndexRequestLimit), Cache(Cache) {}
 
-  /// Returns include insertions that can potentially recover the diagnostic.
-  std::vector<Fix> fix(DiagnosticsEngine::Level DiagLevel,
-                       const clang::Diagnostic &Info) const;
+  /// Returns a callback computing the include insertions that can potentially
+  /// recover the diagnostic, or null if there are none.
+  /// The index is only queried when the first callback runs, for the
+  /// diagnostics seen until then at once.
+  StoreDiags::DeferredFix fix(DiagnosticsEngine::Level DiagLevel,
+                              const clang::Diagnostic &Info) const;
 
   /// Returns an ExternalSemaSource that records failed name lookups in Sema.
   /// This allows IncludeFixer to suggest inserting headers that define those
@@ -50,7 +76,7 @@ public:
 
 private:
   /// Attempts to recover diagnostic caused by an incomplete type \p T.
-  std::vector<Fix> fixIncompleteType(const Type &T) const;
+  StoreDiags::DeferredFix fixIncompleteType(const Type &T) const;
 
   /// Generates header insertion fixes for all symbols. Fixes are deduplicated.
   std::vector<Fix> fixesForSymbols(const SymbolSlab &Syms) const;
@@ -70,13 +96,14 @@ private:
   /// diagnostic. We assume a diagnostic is caused by a unresolved name when
   /// they have the same source location and the unresolved name is the last
   /// one we've seen during the Sema run.
-  std::vector<Fix> fixUnresolvedName() const;
+  StoreDiags::DeferredFix fixUnresolvedName() const;
 
   std::string File;
   std::shared_ptr<IncludeInserter> Inserter;
   const SymbolIndex &Index;
   const unsigned IndexRequestLimit; // Make at most 5 index requests.
   mutable unsigned IndexRequestCount = 0;
+  IncludeFixerCache *Cache;
 
   // These collect the last unresolved name so that we can associate it with the
   // diagnostic.
@@ -85,13 +112,19 @@ private:
   // There can be multiple diagnostics that are caused by the same unresolved
   // name or incomplete type in one parse, especially when code is
   // copy-and-pasted without #includes. We cache the index results based on
-  // index requests.
-  mutable llvm::StringMap<SymbolSlab> FuzzyFindCache;
-  mutable llvm::DenseMap<SymbolID, SymbolSlab> LookupCache;
-  // Returns None if the number of index requests has reached the limit.
-  llvm::Optional<const SymbolSlab *>
-  fuzzyFindCached(const FuzzyFindRequest &Req) const;
-  llvm::Optional<const SymbolSlab *> lookupCached(const SymbolID &ID) const;
+  // index requests. Results of requests that haven't run yet are null.
+  mutable llvm::StringMap<std::shared_ptr<const SymbolSlab>> Results;
+  // The requests that haven't run yet, with their keys in Results.
+  mutable std::vector<FuzzyFindRequest> PendingFuzzyFinds;
+  mutable std::vector<std::string> PendingFuzzyFindKeys;
+  mutable LookupRequest PendingLookup;
+  // Returns false if the results of \p Key are neither known nor pending, and
+  // the number of index requests has reached the limit. Otherwise, makes sure
+  // Results has \p Key, calling \p AddPending if the request must be run.
+  bool request(llvm::StringRef Key,
+               llvm::function_ref<void()> AddPending) const;
+  // Runs all pending requests: one lookup and one batch of fuzzy finds.
+  void runPendingRequests() const;
 };
 
 } // namespace clangd
@@ -9,6 +9,7 @@
 #include "Protocol.h" // For LSPError
 #include "Transport.h"
 #include "llvm/Support/Errno.h"
+#include <chrono>
 
 namespace clang {
 namespace clangd {
@@ -42,9 +43,13 @@ llvm::Error decodeError(const llvm::json::Object &O) {
 class JSONTransport : public Transport {
 public:
   JSONTransport(std::FILE *In, llvm::raw_ostream &Out,
-                llvm::raw_ostream *InMirror, bool Pretty, JSONStreamStyle Style)
+                llvm::raw_ostream *InMirror, bool Pretty, JSONStreamStyle Style,
+                bool MirrorTimestamps)
       : In(In), Out(Out), InMirror(InMirror ? *InMirror : llvm::nulls()),
-        Pretty(Pretty), Style(Style) {}
+        Pretty(Pretty), Style(Style) {
+    if (InMirror && MirrorTimestamps)
+      MirrorStart = std::chrono::steady_clock::now();
+  }
 
   void notify(llvm::StringRef Method, llvm::json::Value Params) override {
     sendMessage(llvm::json::Object{
@@ -78,20 +83,42 @@ public:
       });
     }
   }
+  // Pretty-printing needs the structure of the payload, so is left to the
+  // default implementations.
+  void notifyRaw(llvm::StringRef Method, llvm::StringRef Params) override {
+    if (Pretty)
+      return Transport::notifyRaw(Method, Params);
+    sendMessage(
+        llvm::json::Object{
+            {"jsonrpc", "2.0"},
+            {"method", Method},
+        },
+        "params", Params);
+  }
+  void replyRaw(llvm::json::Value ID, llvm::StringRef Result) override {
+    if (Pretty)
+      return Transport::replyRaw(std::move(ID), Result);
+    sendMessage(
+        llvm::json::Object{
+            {"jsonrpc", "2.0"},
+            {"id", std::move(ID)},
+        },
+        "result", Result);
+  }
 
   llvm::Error loop(MessageHandler &Handler) override {
     while (!feof(In)) {
       if (ferror(In))
         return llvm::errorCodeToError(
             std::error_code(errno, std::system_category()));
-      if (auto JSON = readRawMessage()) {
-        if (auto Doc = llvm::json::parse(*JSON)) {
+      if (readRawMessage()) {
+        if (auto Doc = llvm::json::parse(JSON)) {
           vlog(Pretty ? "<<< {0:2}\n" : "<<< {0}\n", *Doc);
           if (!handleMessage(std::move(*Doc), Handler))
             return llvm::Error::success(); // we saw the "exit" notification.
         } else {
           // Parse error. Log the raw message.
-          vlog("<<< {0}\n", *JSON);
+          vlog("<<< {0}\n", JSON);
           elog("JSON parse error: {0}", llvm::toString(Doc.takeError()));
         }
       }
@@ -104,28 +131,64 @@ private:
   bool handleMessage(llvm::json::Value Message, MessageHandler &Handler);
   // Writes outgoing message to Out stream.
   void sendMessage(llvm::json::Value Message) {
-    std::string S;
-    llvm::raw_string_ostream OS(S);
+    // Messages are never sent concurrently, so the buffer can be reused.
+    OutputBuffer.clear();
+    llvm::raw_string_ostream OS(OutputBuffer);
     OS << llvm::formatv(Pretty ? "{0:2}" : "{0}", Message);
     OS.flush();
-    Out << "Content-Length: " << S.size() << "\r\n\r\n" << S;
+    writeOutputBuffer();
+  }
+  // Writes Envelope, with Payload (serialized JSON) added under Key.
+  // Object keys are printed in sorted order, and Key must sort last.
+  void sendMessage(llvm::json::Object Envelope, llvm::StringRef Key,
+                   llvm::StringRef Payload) {
+    OutputBuffer.clear();
+    llvm::raw_string_ostream OS(OutputBuffer);
+    OS << llvm::json::Value(std::move(Envelope));
+    OS.flush();
+    assert(!OutputBuffer.empty() && OutputBuffer.back() == '}');
+    OutputBuffer.pop_back();
+    OS << ",\"" << Key << "\":" << Payload << '}';
+    OS.flush();
+    writeOutputBuffer();
+  }
+  void writeOutputBuffer() {
+    Out << "Content-Length: " << OutputBuffer.size() << "\r\n\r\n"
+        << OutputBuffer;
     Out.flush();
-    vlog(">>> {0}\n", S);
+    vlog(">>> {0}\n", OutputBuffer);
   }
 
-  // Read raw string messages from input stream.
-  llvm::Optional<std::string> readRawMessage() {
+  // Read raw string messages from input stream into JSON.
+  bool readRawMessage() {
     return Style == JSONStreamStyle::Delimited ? readDelimitedMessage()
                                                : readStandardMessage();
   }
-  llvm::Optional<std::string> readDelimitedMessage();
-  llvm::Optional<std::string> readStandardMessage();
+  bool readDelimitedMessage();
+  bool readStandardMessage();
+  // Records when a message started to arrive as a comment in the mirror, if
+  // timestamps were requested.
+  void mirrorTimestamp() {
+    if (MirrorStart)
+      InMirror << "# time-ms: "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - *MirrorStart)
+                      .count()
+               << "\n";
+  }
 
   std::FILE *In;
   llvm::raw_ostream &Out;
   llvm::raw_ostream &InMirror;
   bool Pretty;
   JSONStreamStyle Style;
+  llvm::Optional<std::chrono::steady_clock::time_point> MirrorStart;
+
+  // Buffers reused across messages, so that large messages (e.g. didChange
+  // with the whole file) don't cost an allocation each time.
+  std::string JSON;         // The message being read.
+  std::string Line;         // The header line being read.
+  std::string OutputBuffer; // The message being sent.
 };
 
 bool JSONTransport::handleMessage(llvm::json::Value Message,
@@ -189,17 +252,18 @@ bool readLine(std::FILE *In, std::string &Out) {
   }
 }
 
-// Returns None when:
+// Returns false when:
 //  - ferror() or feof() are set.
 //  - Content-Length is missing or empty (protocol error)
-llvm::Optional<std::string> JSONTransport::readStandardMessage() {
+bool JSONTransport::readStandardMessage() {
   // A Language Server Protocol message starts with a set of HTTP headers,
   // delimited  by \r\n, and terminated by an empty line (\r\n).
   unsigned long long ContentLength = 0;
-  std::string Line;
-  while (true) {
+  for (bool FirstLine = true;; FirstLine = false) {
     if (feof(In) || ferror(In) || !readLine(In, Line))
-      return llvm::None;
+      return false;
+    if (FirstLine)
+      mirrorTimestamp();
     InMirror << Line;
 
     llvm::StringRef LineRef(Line);
@@ -234,14 +298,14 @@ llvm::Optional<std::string> JSONTransport::readStandardMessage() {
     elog("Refusing to read message with long Content-Length: {0}. "
          "Expect protocol errors",
          ContentLength);
-    return llvm::None;
+    return false;
   }
   if (ContentLength == 0) {
     log("Warning: Missing Content-Length header, or zero-length message.");
-    return llvm::None;
+    return false;
   }
 
-  std::string JSON(ContentLength, '\0');
+  JSON.resize(ContentLength);
   for (size_t Pos = 0, Read; Pos < ContentLength; Pos += Read) {
     // Handle EINTR which is sent when a debugger attaches on some platforms.
     Read = llvm::sys::RetryAfterSignal(0u, ::fread, &JSON[Pos], 1,
@@ -249,25 +313,25 @@ llvm::Optional<std::string> JSONTransport::readStandardMessage() {
     if (Read == 0) {
       elog("Input was aborted. Read only {0} bytes of expected {1}.", Pos,
            ContentLength);
-      return llvm::None;
+      return false;
     }
     InMirror << llvm::StringRef(&JSON[Pos], Read);
     clearerr(In); // If we're done, the error was transient. If we're not done,
                   // either it was transient or we'll see it again on retry.
-    Pos += Read;
   }
-  return std::move(JSON);
+  return true;
 }
 
 // For lit tests we support a simplified syntax:
 // - messages are delimited by '---' on a line by itself
 // - lines starting with # are ignored.
 // This is a testing path, so favor simplicity over performance here.
-// When returning None, feof() or ferror() will be set.
-llvm::Optional<std::string> JSONTransport::readDelimitedMessage() {
-  std::string JSON;
-  std::string Line;
-  while (readLine(In, Line)) {
+// When returning false, feof() or ferror() will be set.
+bool JSONTransport::readDelimitedMessage() {
+  JSON.clear();
+  for (bool FirstLine = true; readLine(In, Line); FirstLine = false) {
+    if (FirstLine)
+      mirrorTimestamp();
     InMirror << Line;
     auto LineRef = llvm::StringRef(Line).trim();
     if (LineRef.startswith("#")) // comment
@@ -282,19 +346,36 @@ llvm::Optional<std::string> JSONTransport::readDelimitedMessage() {
 
   if (ferror(In)) {
     elog("Input error while reading message!");
-    return llvm::None;
+    return false;
   }
-  return std::move(JSON); // Including at EOF
+  return true; // Including at EOF
 }
 
 } // namespace
 
+static llvm::json::Value parseRaw(llvm::StringRef Raw) {
+  auto Parsed = llvm::json::parse(Raw);
+  if (Parsed)
+    return std::move(*Parsed);
+  elog("Invalid serialized JSON: {0}", Parsed.takeError());
+  return nullptr;
+}
+
+void Transport::notifyRaw(llvm::StringRef Method, llvm::StringRef Params) {
+  notify(Method, parseRaw(Params));
+}
+
+void Transport::replyRaw(llvm::json::Value ID, llvm::StringRef Result) {
+  reply(std::move(ID), parseRaw(Result));
+}
+
 std::unique_ptr<Transport> newJSONTransport(std::FILE *In,
                                             llvm::raw_ostream &Out,
                                             llvm::raw_ostream *InMirror,
-                                            bool Pretty,
-                                            JSONStreamStyle Style) {
-  return llvm::make_unique<JSONTransport>(In, Out, InMirror, Pretty, Style);
+                                            bool Pretty, JSONStreamStyle Style,
+                                            bool MirrorTimestamps) {
+  return llvm::make_unique<JSONTransport>(In, Out, InMirror, Pretty, Style,
+                                          MirrorTimestamps);
 }
 
 } // namespace clangd
@@ -0,0 +1,30 @@
+//===--- MemoryTree.cpp - A special tree for components and sizes ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "MemoryTree.h"
+
+namespace clang {
+namespace clangd {
+
+size_t MemoryTree::total() const {
+  size_t Total = Self;
+  for (const auto &Child : Children)
+    Total += Child.second.total();
+  return Total;
+}
+
+llvm::json::Value toJSON(const MemoryTree &MT) {
+  llvm::json::Object Result{{"_self", int64_t(MT.self())},
+                            {"_total", int64_t(MT.total())}};
+  for (const auto &Child : MT.children())
+    Result[Child.first().str()] = toJSON(Child.second);
+  return std::move(Result);
+}
+
+} // namespace clangd
+} // namespace clang
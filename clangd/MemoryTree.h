@@ -0,0 +1,51 @@
+//===--- MemoryTree.h - A special tree for components and sizes -*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Describes where clangd's memory goes: each component adds its own usage and
+// that of its parts (children) to a node of the tree.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_MEMORYTREE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_MEMORYTREE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/JSON.h"
+#include <cstddef>
+
+namespace clang {
+namespace clangd {
+
+/// A tree of memory usages, in bytes. A node's total is its own usage plus
+/// the totals of its children.
+class MemoryTree {
+public:
+  /// Returns the child named \p Name, creating it if needed.
+  MemoryTree &child(llvm::StringRef Name) { return Children[Name]; }
+
+  /// Adds \p Bytes to the usage of this node itself.
+  void addUsage(size_t Bytes) { Self += Bytes; }
+
+  size_t self() const { return Self; }
+  size_t total() const;
+  const llvm::StringMap<MemoryTree> &children() const { return Children; }
+
+private:
+  size_t Self = 0;
+  llvm::StringMap<MemoryTree> Children;
+};
+
+/// Each node is an object with "_self" and "_total" sizes, and a property for
+/// each child, e.g. {"_self": 0, "_total": 8, "index": {"_self": 8, ...}}.
+llvm::json::Value toJSON(const MemoryTree &MT);
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_MEMORYTREE_H
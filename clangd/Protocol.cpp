@@ -16,6 +16,7 @@
 #include "clang/Basic/LLVM.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
@@ -28,6 +29,59 @@ namespace clangd {
 
 char LSPError::ID;
 
+namespace {
+// Writes JSON text straight to a stream, for messages that are large or
+// frequent enough that building a json::Value first is a noticeable cost.
+// json::Value prints object keys in sorted order, so attributes must be
+// written in that order too for the output to match.
+class JSONWriter {
+public:
+  explicit JSONWriter(llvm::raw_ostream &OS) : OS(OS) {}
+
+  void objectBegin() { open('{'); }
+  void objectEnd() { close('}'); }
+  void arrayBegin() { open('['); }
+  void arrayEnd() { close(']'); }
+  void attribute(llvm::StringRef Key) {
+    separate();
+    OS << llvm::json::Value(Key) << ':';
+    AfterKey = true;
+  }
+  // A json::Value made from a StringRef escapes it without copying.
+  void string(llvm::StringRef S) { value(llvm::json::Value(S)); }
+  void value(const llvm::json::Value &V) {
+    separate();
+    OS << V;
+  }
+
+private:
+  void open(char Bracket) {
+    separate();
+    OS << Bracket;
+    NeedComma.push_back(false);
+  }
+  void close(char Bracket) {
+    NeedComma.pop_back();
+    OS << Bracket;
+  }
+  void separate() {
+    if (AfterKey) {
+      AfterKey = false;
+      return;
+    }
+    if (!NeedComma.empty()) {
+      if (NeedComma.back())
+        OS << ',';
+      NeedComma.back() = true;
+    }
+  }
+
+  llvm::raw_ostream &OS;
+  llvm::SmallVector<bool, 8> NeedComma; // One per open object or array.
+  bool AfterKey = false;
+};
+} // namespace
+
 URIForFile URIForFile::canonicalize(llvm::StringRef AbsPath,
                                     llvm::StringRef TUPath) {
   assert(llvm::sys::path::is_absolute(AbsPath) && "the path is relative");
@@ -49,6 +103,14 @@ llvm::Expected<URIForFile> URIForFile::fromURI(const URI &U,
   return URIForFile(std::move(*Resolved));
 }
 
+llvm::Expected<URIForFile> URIForFile::fromURI(llvm::StringRef FileURI,
+                                               llvm::StringRef HintPath) {
+  auto Resolved = URI::resolve(FileURI, HintPath);
+  if (!Resolved)
+    return Resolved.takeError();
+  return URIForFile(std::move(*Resolved));
+}
+
 bool fromJSON(const llvm::json::Value &E, URIForFile &R) {
   if (auto S = E.getAsString()) {
     auto Parsed = URI::parse(*S);
@@ -100,6 +162,15 @@ llvm::json::Value toJSON(const Position &P) {
   };
 }
 
+static void write(JSONWriter &W, const Position &P) {
+  W.objectBegin();
+  W.attribute("character");
+  W.value(P.character);
+  W.attribute("line");
+  W.value(P.line);
+  W.objectEnd();
+}
+
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const Position &P) {
   return OS << P.line << ':' << P.character;
 }
@@ -116,6 +187,15 @@ llvm::json::Value toJSON(const Range &P) {
   };
 }
 
+static void write(JSONWriter &W, const Range &R) {
+  W.objectBegin();
+  W.attribute("end");
+  write(W, R.end);
+  W.attribute("start");
+  write(W, R.start);
+  W.objectEnd();
+}
+
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const Range &R) {
   return OS << R.start << '-' << R.end;
 }
@@ -127,6 +207,23 @@ llvm::json::Value toJSON(const Location &P) {
   };
 }
 
+static void write(JSONWriter &W, const Location &L) {
+  W.objectBegin();
+  W.attribute("range");
+  write(W, L.range);
+  W.attribute("uri");
+  W.string(L.uri.uri());
+  W.objectEnd();
+}
+
+void writeJSON(llvm::raw_ostream &OS, const std::vector<Location> &Locations) {
+  JSONWriter W(OS);
+  W.arrayBegin();
+  for (const auto &L : Locations)
+    write(W, L);
+  W.arrayEnd();
+}
+
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const Location &L) {
   return OS << L.range << '@' << L.uri;
 }
@@ -149,6 +246,15 @@ llvm::json::Value toJSON(const TextEdit &P) {
   };
 }
 
+static void write(JSONWriter &W, const TextEdit &E) {
+  W.objectBegin();
+  W.attribute("newText");
+  W.string(E.newText);
+  W.attribute("range");
+  write(W, E.range);
+  W.objectEnd();
+}
+
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const TextEdit &TE) {
   OS << TE.range << " => \"";
   llvm::printEscapedString(TE.newText, OS);
@@ -352,6 +458,13 @@ bool fromJSON(const llvm::json::Value &Params, DidChangeTextDocumentParams &R) {
          O.map("wantDiagnostics", R.wantDiagnostics);
 }
 
+bool fromJSON(const llvm::json::Value &Params,
+              DidChangeVisibleRangeParams &R) {
+  llvm::json::ObjectMapper O(Params);
+  return O && O.map("textDocument", R.textDocument) &&
+         O.map("range", R.range);
+}
+
 bool fromJSON(const llvm::json::Value &E, FileChangeType &Out) {
   if (auto T = E.getAsInteger()) {
     if (*T < static_cast<int>(FileChangeType::Created) ||
@@ -432,6 +545,46 @@ llvm::json::Value toJSON(const Diagnostic &D) {
   return std::move(Diag);
 }
 
+static void write(JSONWriter &W, const Diagnostic &D) {
+  W.objectBegin();
+  if (D.category) {
+    W.attribute("category");
+    W.string(*D.category);
+  }
+  // Inline code actions are rare and small, the DOM is fine for them.
+  if (D.codeActions) {
+    W.attribute("codeActions");
+    W.value(llvm::json::Array(*D.codeActions));
+  }
+  W.attribute("message");
+  W.string(D.message);
+  W.attribute("range");
+  write(W, D.range);
+  W.attribute("severity");
+  W.value(D.severity);
+  W.objectEnd();
+}
+
+llvm::json::Value toJSON(const PublishDiagnosticsParams &P) {
+  return llvm::json::Object{
+      {"uri", P.uri},
+      {"diagnostics", P.diagnostics},
+  };
+}
+
+void writeJSON(llvm::raw_ostream &OS, const PublishDiagnosticsParams &P) {
+  JSONWriter W(OS);
+  W.objectBegin();
+  W.attribute("diagnostics");
+  W.arrayBegin();
+  for (const auto &D : P.diagnostics)
+    write(W, D);
+  W.arrayEnd();
+  W.attribute("uri");
+  W.string(P.uri.uri());
+  W.objectEnd();
+}
+
 bool fromJSON(const llvm::json::Value &Params, Diagnostic &R) {
   llvm::json::ObjectMapper O(Params);
   if (!O || !O.map("range", R.range) || !O.map("message", R.message))
@@ -756,6 +909,58 @@ llvm::json::Value toJSON(const CompletionItem &CI) {
   return std::move(Result);
 }
 
+// Keep in sync with toJSON() above, but with the keys in sorted order.
+static void write(JSONWriter &W, const CompletionItem &CI) {
+  assert(!CI.label.empty() && "completion item label is required");
+  W.objectBegin();
+  if (!CI.additionalTextEdits.empty()) {
+    W.attribute("additionalTextEdits");
+    W.arrayBegin();
+    for (const auto &E : CI.additionalTextEdits)
+      write(W, E);
+    W.arrayEnd();
+  }
+  if (CI.deprecated) {
+    W.attribute("deprecated");
+    W.value(CI.deprecated);
+  }
+  if (!CI.detail.empty()) {
+    W.attribute("detail");
+    W.string(CI.detail);
+  }
+  if (!CI.documentation.empty()) {
+    W.attribute("documentation");
+    W.string(CI.documentation);
+  }
+  if (!CI.filterText.empty()) {
+    W.attribute("filterText");
+    W.string(CI.filterText);
+  }
+  if (!CI.insertText.empty()) {
+    W.attribute("insertText");
+    W.string(CI.insertText);
+  }
+  if (CI.insertTextFormat != InsertTextFormat::Missing) {
+    W.attribute("insertTextFormat");
+    W.value(static_cast<int>(CI.insertTextFormat));
+  }
+  if (CI.kind != CompletionItemKind::Missing) {
+    W.attribute("kind");
+    W.value(static_cast<int>(CI.kind));
+  }
+  W.attribute("label");
+  W.string(CI.label);
+  if (!CI.sortText.empty()) {
+    W.attribute("sortText");
+    W.string(CI.sortText);
+  }
+  if (CI.textEdit) {
+    W.attribute("textEdit");
+    write(W, *CI.textEdit);
+  }
+  W.objectEnd();
+}
+
 llvm::raw_ostream &operator<<(llvm::raw_ostream &O, const CompletionItem &I) {
   O << I.label << " - " << toJSON(I);
   return O;
@@ -773,6 +978,19 @@ llvm::json::Value toJSON(const CompletionList &L) {
   };
 }
 
+void writeJSON(llvm::raw_ostream &OS, const CompletionList &L) {
+  JSONWriter W(OS);
+  W.objectBegin();
+  W.attribute("isIncomplete");
+  W.value(L.isIncomplete);
+  W.attribute("items");
+  W.arrayBegin();
+  for (const auto &CI : L.items)
+    write(W, CI);
+  W.arrayEnd();
+  W.objectEnd();
+}
+
 llvm::json::Value toJSON(const ParameterInformation &PI) {
   assert(!PI.label.empty() && "parameter information label is required");
   llvm::json::Object Result{{"label", PI.label}};
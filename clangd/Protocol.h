@@ -87,6 +87,10 @@ struct URIForFile {
 
   static llvm::Expected<URIForFile> fromURI(const URI &U,
                                             llvm::StringRef HintPath);
+  /// Like fromURI(URI::parse(FileURI), HintPath), but cached, see
+  /// URI::resolve().
+  static llvm::Expected<URIForFile> fromURI(llvm::StringRef FileURI,
+                                            llvm::StringRef HintPath);
 
   /// Retrieves absolute path to the file.
   llvm::StringRef file() const { return File; }
@@ -197,6 +201,8 @@ struct Location {
 };
 llvm::json::Value toJSON(const Location &);
 llvm::raw_ostream &operator<<(llvm::raw_ostream &, const Location &);
+/// Writes the JSON array of \p Locations, as formatting toJSON() would.
+void writeJSON(llvm::raw_ostream &, const std::vector<Location> &Locations);
 
 struct TextEdit {
   /// The range of the text document to be manipulated. To insert
@@ -501,6 +507,17 @@ struct DidChangeTextDocumentParams {
 };
 bool fromJSON(const llvm::json::Value &, DidChangeTextDocumentParams &);
 
+/// Sent when the part of a document visible in the editor changes.
+/// This is a clangd extension.
+struct DidChangeVisibleRangeParams {
+  /// The document that is shown.
+  TextDocumentIdentifier textDocument;
+
+  /// The visible range, unset if the document isn't visible anymore.
+  llvm::Optional<Range> range;
+};
+bool fromJSON(const llvm::json::Value &, DidChangeVisibleRangeParams &);
+
 enum class FileChangeType {
   /// The file got created.
   Created = 1,
@@ -629,6 +646,17 @@ struct LSPDiagnosticCompare {
 bool fromJSON(const llvm::json::Value &, Diagnostic &);
 llvm::raw_ostream &operator<<(llvm::raw_ostream &, const Diagnostic &);
 
+struct PublishDiagnosticsParams {
+  /// The URI for which diagnostic information is reported.
+  URIForFile uri;
+  /// An array of diagnostic information items.
+  std::vector<Diagnostic> diagnostics;
+};
+llvm::json::Value toJSON(const PublishDiagnosticsParams &);
+/// Writes \p P as JSON text, as formatting toJSON(P) would. Diagnostics are
+/// republished on every edit, so this skips building a json::Value.
+void writeJSON(llvm::raw_ostream &, const PublishDiagnosticsParams &P);
+
 struct CodeActionContext {
   /// An array of diagnostics.
   std::vector<Diagnostic> diagnostics;
@@ -951,6 +979,10 @@ struct CompletionList {
   std::vector<CompletionItem> items;
 };
 llvm::json::Value toJSON(const CompletionList &);
+/// Writes \p L as JSON text without building a json::Value first. Large
+/// completion lists are the bulk of what clangd sends; the output is the same
+/// as formatting toJSON(L).
+void writeJSON(llvm::raw_ostream &, const CompletionList &L);
 
 /// A single parameter of a particular signature.
 struct ParameterInformation {
@@ -170,6 +170,12 @@ public:
     return Dropped;
   }
 
+  // Returns whether push(V) would keep V. Callers that can bound the score of
+  // a candidate cheaply can use this to skip computing it.
+  bool wouldKeep(const value_type &V) const {
+    return Heap.size() < N || (N > 0 && Greater(V, Heap.front()));
+  }
+
   // Returns candidates from best to worst.
   std::vector<value_type> items() && {
     std::sort_heap(Heap.begin(), Heap.end(), Greater);
@@ -81,6 +81,33 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const File &F) {
   return OS;
 }
 
+void writeFile(llvm::raw_ostream &OS, FourCC Type,
+               llvm::ArrayRef<PiecewiseChunk> Chunks) {
+  std::vector<size_t> Sizes;
+  size_t DataLen = 4;
+  for (const auto &C : Chunks) {
+    size_t Size = 0;
+    for (llvm::StringRef Piece : C.Pieces)
+      Size += Piece.size();
+    Sizes.push_back(Size);
+    DataLen += 4 + 4 + Size + (Size % 2);
+  }
+  OS << "RIFF";
+  char Size[4];
+  llvm::support::endian::write32le(Size, DataLen);
+  OS.write(Size, sizeof(Size));
+  OS.write(Type.data(), Type.size());
+  for (size_t I = 0; I < Chunks.size(); ++I) {
+    OS.write(Chunks[I].ID.data(), Chunks[I].ID.size());
+    llvm::support::endian::write32le(Size, Sizes[I]);
+    OS.write(Size, sizeof(Size));
+    for (llvm::StringRef Piece : Chunks[I].Pieces)
+      OS << Piece;
+    if (Sizes[I] % 2)
+      OS.write(0);
+  }
+}
+
 } // namespace riff
 } // namespace clangd
 } // namespace clang
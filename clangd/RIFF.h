@@ -29,6 +29,7 @@
 //===----------------------------------------------------------------------===//
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_RIFF_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_RIFF_H
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ScopedPrinter.h"
@@ -74,6 +75,17 @@ llvm::Expected<File> readFile(llvm::StringRef Stream);
 // Serialize a RIFF file (i.e. a single RIFF chunk) to OS.
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const File &);
 
+// A chunk whose data is the concatenation of several pieces.
+struct PiecewiseChunk {
+  FourCC ID;
+  std::vector<llvm::StringRef> Pieces;
+};
+
+// Serialize a RIFF file with the given chunks to OS. Large files can be
+// written this way without concatenating the pieces of their chunks first.
+void writeFile(llvm::raw_ostream &OS, FourCC Type,
+               llvm::ArrayRef<PiecewiseChunk> Chunks);
+
 } // namespace riff
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,91 @@
+//===--- ResourceUsage.cpp - Resources used by each thread -------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ResourceUsage.h"
+#include "Trace.h"
+#include <atomic>
+#include <time.h>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+// Time spent blocked on a lock, in milliseconds.
+constexpr trace::Metric LockWait("lock_wait", trace::Metric::Distribution,
+                                 "lock_name");
+
+std::atomic<bool> Enabled(false);
+
+// Counters of the calling thread. Plain integers, so that they need no
+// thread-local initialization and can be bumped by the allocator.
+thread_local uint64_t ThreadAllocations = 0;
+thread_local uint64_t ThreadAllocatedBytes = 0;
+thread_local int64_t ThreadLockWaitNanos = 0;
+
+std::chrono::nanoseconds threadCPUTime() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  struct timespec TS;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &TS) == 0)
+    return std::chrono::seconds(TS.tv_sec) +
+           std::chrono::nanoseconds(TS.tv_nsec);
+#endif
+  return std::chrono::nanoseconds(0);
+}
+
+} // namespace
+
+ResourceUsage operator-(const ResourceUsage &L, const ResourceUsage &R) {
+  ResourceUsage Result;
+  Result.CPUTime = L.CPUTime - R.CPUTime;
+  Result.Allocations = L.Allocations - R.Allocations;
+  Result.AllocatedBytes = L.AllocatedBytes - R.AllocatedBytes;
+  Result.LockWait = L.LockWait - R.LockWait;
+  return Result;
+}
+
+void enableResourceAccounting(bool Enable) { Enabled = Enable; }
+
+bool resourceAccountingEnabled() {
+  return Enabled.load(std::memory_order_relaxed);
+}
+
+ResourceUsage threadResourceUsage() {
+  ResourceUsage Usage;
+  Usage.CPUTime = threadCPUTime();
+  Usage.Allocations = ThreadAllocations;
+  Usage.AllocatedBytes = ThreadAllocatedBytes;
+  Usage.LockWait = std::chrono::nanoseconds(ThreadLockWaitNanos);
+  return Usage;
+}
+
+void countAllocation(size_t Bytes) {
+  ++ThreadAllocations;
+  ThreadAllocatedBytes += Bytes;
+}
+
+std::unique_lock<std::mutex> lockAccounted(std::mutex &Mu,
+                                           llvm::StringRef LockName) {
+  std::unique_lock<std::mutex> Lock(Mu, std::try_to_lock);
+  if (Lock.owns_lock())
+    return Lock;
+  if (!resourceAccountingEnabled()) {
+    Lock.lock();
+    return Lock;
+  }
+  auto Start = std::chrono::steady_clock::now();
+  Lock.lock();
+  auto Waited = std::chrono::steady_clock::now() - Start;
+  ThreadLockWaitNanos +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Waited).count();
+  LockWait.record(std::chrono::duration<double, std::milli>(Waited).count(),
+                  LockName);
+  return Lock;
+}
+
+} // namespace clangd
+} // namespace clang
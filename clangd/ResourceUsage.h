@@ -0,0 +1,67 @@
+//===--- ResourceUsage.h - Resources used by each thread ---------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Accounts for the resources used by each thread: CPU time, allocations, and
+// time spent blocked on the locks that requests commonly contend for. The
+// usage of a thread before and after running a request tells what the request
+// cost, e.g. whether a slow hover spent its time computing, allocating, or
+// waiting for the index.
+//
+// Accounting is off unless enabled, see enableResourceAccounting().
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_RESOURCEUSAGE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_RESOURCEUSAGE_H
+
+#include "llvm/ADT/StringRef.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace clang {
+namespace clangd {
+
+/// Resources used by a thread.
+struct ResourceUsage {
+  /// Zero where the platform can't measure the CPU time of a thread.
+  std::chrono::nanoseconds CPUTime{0};
+  /// Only counted when the allocator calls countAllocation().
+  uint64_t Allocations = 0;
+  uint64_t AllocatedBytes = 0;
+  /// Time spent blocked in lockAccounted().
+  std::chrono::nanoseconds LockWait{0};
+};
+ResourceUsage operator-(const ResourceUsage &L, const ResourceUsage &R);
+
+/// Turns resource accounting for the process on or off. When on, requests
+/// record what they used in the metrics and in their trace spans.
+void enableResourceAccounting(bool Enable = true);
+bool resourceAccountingEnabled();
+
+/// Returns the resources used so far by the calling thread.
+ResourceUsage threadResourceUsage();
+
+/// Counts an allocation of \p Bytes by the calling thread. This is the hook
+/// for the allocator: it only bumps thread-local counters, so it can be called
+/// from operator new. clangd's operator new calls it when built with
+/// CLANGD_COUNT_ALLOCATIONS.
+void countAllocation(size_t Bytes);
+
+/// Locks \p Mu. With accounting enabled, the time spent blocked is added to
+/// the lock wait of the calling thread, and recorded in the "lock_wait"
+/// metric labeled with \p LockName. Taking a free lock costs no more than
+/// with std::unique_lock.
+std::unique_lock<std::mutex> lockAccounted(std::mutex &Mu,
+                                           llvm::StringRef LockName);
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_RESOURCEUSAGE_H
@@ -28,10 +28,19 @@ class SelectionVisitor : public RecursiveASTVisitor<SelectionVisitor> {
 public:
   // Runs the visitor to gather selected nodes and their ancestors.
   // If there is any selection, the root (TUDecl) is the first node.
-  static std::deque<Node> collect(ASTContext &AST, unsigned Begin,
-                                  unsigned End, FileID File) {
+  // If TopLevelDecls is set, they are traversed instead of the whole AST. They
+  // must be in parse order, only those that may intersect the selection are
+  // visited.
+  static std::deque<Node>
+  collect(ASTContext &AST, unsigned Begin, unsigned End, FileID File,
+          llvm::Optional<ArrayRef<Decl *>> TopLevelDecls) {
     SelectionVisitor V(AST, Begin, End, File);
-    V.TraverseAST(AST);
+    if (TopLevelDecls) {
+      for (Decl *D : V.candidateDecls(*TopLevelDecls))
+        V.TraverseDecl(D);
+    } else {
+      V.TraverseAST(AST);
+    }
     assert(V.Stack.size() == 1 && "Unpaired push/pop?");
     assert(V.Stack.top() == &V.Nodes.front());
     if (V.Nodes.size() == 1) // TUDecl, but no nodes under it.
@@ -97,6 +106,43 @@ private:
     Stack.push(&Nodes.back());
   }
 
+  // The offset in SelFile where D begins, or where the file containing it is
+  // included. Top-level decls are sorted by this key, as they're parsed in
+  // order. None if D has no location.
+  llvm::Optional<unsigned> sortKey(const Decl *D) {
+    SourceLocation Loc = SM.getExpansionLoc(D->getBeginLoc());
+    while (Loc.isValid()) {
+      auto Decomposed = SM.getDecomposedLoc(Loc);
+      if (Decomposed.first == SelFile)
+        return Decomposed.second;
+      Loc = SM.getIncludeLoc(Decomposed.first);
+    }
+    return None;
+  }
+
+  // The top-level decls that may intersect the selection, found by binary
+  // search. Top-level decls don't overlap, except those that begin at the same
+  // place (e.g. "struct S {} s;"), so the decls starting before the last one
+  // that begins at or before the selection can't reach it.
+  ArrayRef<Decl *> candidateDecls(ArrayRef<Decl *> Decls) {
+    // Decls without a location can't be selected, and are rare enough not to
+    // throw the search off.
+    auto BeginsBefore = [&](unsigned Offset) {
+      return [this, Offset](const Decl *D) {
+        auto Key = sortKey(D);
+        return !Key || *Key < Offset;
+      };
+    };
+    auto End = std::partition_point(Decls.begin(), Decls.end(),
+                                    BeginsBefore(SelEnd));
+    auto Start = std::partition_point(Decls.begin(), End,
+                                      BeginsBefore(SelBegin + 1));
+    if (Start != Decls.begin())
+      if (auto Key = sortKey(*std::prev(Start)))
+        Start = std::partition_point(Decls.begin(), Start, BeginsBefore(*Key));
+    return ArrayRef<Decl *>(Start, End);
+  }
+
   // Generic case of TraverseFoo. Func should be the call to Base::TraverseFoo.
   // Node is always a pointer so the generic code can handle any null checks.
   template <typename T, typename Func>
@@ -269,7 +315,8 @@ static std::pair<unsigned, unsigned> pointBounds(unsigned Offset, FileID FID,
   return {Offset, Offset + 1};
 }
 
-SelectionTree::SelectionTree(ASTContext &AST, unsigned Begin, unsigned End)
+SelectionTree::SelectionTree(ASTContext &AST, unsigned Begin, unsigned End,
+                             llvm::Optional<ArrayRef<Decl *>> TopLevelDecls)
     : PrintPolicy(AST.getLangOpts()) {
   // No fundamental reason the selection needs to be in the main file,
   // but that's all clangd has needed so far.
@@ -278,10 +325,17 @@ SelectionTree::SelectionTree(ASTContext &AST, unsigned Begin, unsigned End)
     std::tie(Begin, End) = pointBounds(Begin, FID, AST);
   PrintPolicy.TerseOutput = true;
 
-  Nodes = SelectionVisitor::collect(AST, Begin, End, FID);
+  Nodes = SelectionVisitor::collect(AST, Begin, End, FID, TopLevelDecls);
   Root = Nodes.empty() ? nullptr : &Nodes.front();
 }
 
+SelectionTree::SelectionTree(ASTContext &AST, unsigned Begin, unsigned End)
+    : SelectionTree(AST, Begin, End, /*TopLevelDecls=*/None) {}
+
+SelectionTree::SelectionTree(ParsedAST &AST, unsigned Begin, unsigned End)
+    : SelectionTree(AST.getASTContext(), Begin, End,
+                    AST.getLocalTopLevelDecls()) {}
+
 SelectionTree::SelectionTree(ASTContext &AST, unsigned Offset)
     : SelectionTree(AST, Offset, Offset) {}
 
@@ -35,6 +35,8 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_SELECTION_H
 #include "clang/AST/ASTTypeTraits.h"
 #include "clang/AST/PrettyPrinter.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
 
 namespace clang {
@@ -66,6 +68,9 @@ public:
   // The range includes bytes [Start, End).
   // If Start == End, uses the same heuristics as SelectionTree(AST, Start).
   SelectionTree(ASTContext &AST, unsigned Start, unsigned End);
+  // Like above, but only traverses the local top-level decls of the AST that
+  // may intersect the range, found by binary search.
+  SelectionTree(ParsedAST &AST, unsigned Start, unsigned End);
 
   // Describes to what extent an AST node is covered by the selection.
   enum Selection {
@@ -103,6 +108,9 @@ public:
   const Node *root() const { return Root; }
 
 private:
+  SelectionTree(ASTContext &AST, unsigned Start, unsigned End,
+                llvm::Optional<ArrayRef<Decl *>> TopLevelDecls);
+
   std::deque<Node> Nodes; // Stable-pointer storage.
   const Node *Root;
   clang::PrintingPolicy PrintPolicy;
@@ -19,6 +19,8 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
+#include <cstring>
 
 namespace clang {
 namespace clangd {
@@ -56,6 +58,22 @@ static bool iterateCodepoints(llvm::StringRef U8, const Callback &CB) {
   return false;
 }
 
+// Returns the length of the longest ASCII prefix of \p U8. ASCII characters
+// are a single code unit in every encoding, and most code is all ASCII, so
+// this is tested eight bytes at a time before looking at codepoints.
+static size_t asciiPrefixLength(llvm::StringRef U8) {
+  size_t I = 0;
+  for (; I + sizeof(uint64_t) <= U8.size(); I += sizeof(uint64_t)) {
+    uint64_t Word;
+    std::memcpy(&Word, U8.data() + I, sizeof(Word));
+    if (Word & 0x8080808080808080ULL)
+      break;
+  }
+  while (I < U8.size() && !(static_cast<unsigned char>(U8[I]) & 0x80))
+    ++I;
+  return I;
+}
+
 // Returns the byte offset into the string that is an offset of \p Units in
 // the specified encoding.
 // Conceptually, this converts to the encoding, truncates to CodeUnits,
@@ -66,12 +84,21 @@ static size_t measureUnits(llvm::StringRef U8, int Units, OffsetEncoding Enc,
   if (Units <= 0)
     return 0;
   size_t Result = 0;
+  llvm::StringRef Rest = U8;
+  if (Enc != OffsetEncoding::UTF8) {
+    size_t ASCII = asciiPrefixLength(U8);
+    if (static_cast<size_t>(Units) <= ASCII)
+      return Units;
+    Result = ASCII;
+    Units -= ASCII;
+    Rest = U8.drop_front(ASCII);
+  }
   switch (Enc) {
   case OffsetEncoding::UTF8:
     Result = Units;
     break;
   case OffsetEncoding::UTF16:
-    Valid = iterateCodepoints(U8, [&](int U8Len, int U16Len) {
+    Valid = iterateCodepoints(Rest, [&](int U8Len, int U16Len) {
       Result += U8Len;
       Units -= U16Len;
       return Units <= 0;
@@ -80,7 +107,7 @@ static size_t measureUnits(llvm::StringRef U8, int Units, OffsetEncoding Enc,
       Valid = false;
     break;
   case OffsetEncoding::UTF32:
-    Valid = iterateCodepoints(U8, [&](int U8Len, int U16Len) {
+    Valid = iterateCodepoints(Rest, [&](int U8Len, int U16Len) {
       Result += U8Len;
       Units--;
       return Units <= 0;
@@ -111,13 +138,15 @@ size_t lspLength(llvm::StringRef Code) {
     Count = Code.size();
     break;
   case OffsetEncoding::UTF16:
-    iterateCodepoints(Code, [&](int U8Len, int U16Len) {
+    Count = asciiPrefixLength(Code);
+    iterateCodepoints(Code.drop_front(Count), [&](int U8Len, int U16Len) {
       Count += U16Len;
       return false;
     });
     break;
   case OffsetEncoding::UTF32:
-    iterateCodepoints(Code, [&](int U8Len, int U16Len) {
+    Count = asciiPrefixLength(Code);
+    iterateCodepoints(Code.drop_front(Count), [&](int U8Len, int U16Len) {
       ++Count;
       return false;
     });
@@ -128,6 +157,25 @@ size_t lspLength(llvm::StringRef Code) {
   return Count;
 }
 
+// Converts the (already validated) column P.character of the line starting at
+// StartOfLine into an offset in Code.
+static llvm::Expected<size_t> offsetInLine(llvm::StringRef Code,
+                                           size_t StartOfLine, Position P,
+                                           bool AllowColumnsBeyondLineLength) {
+  StringRef Line =
+      Code.substr(StartOfLine).take_until([](char C) { return C == '\n'; });
+
+  // P.character may be in UTF-16, transcode if necessary.
+  bool Valid;
+  size_t ByteInLine = measureUnits(Line, P.character, lspEncoding(), Valid);
+  if (!Valid && !AllowColumnsBeyondLineLength)
+    return llvm::make_error<llvm::StringError>(
+        llvm::formatv("{0} offset {1} is invalid for line {2}", lspEncoding(),
+                      P.character, P.line),
+        llvm::errc::invalid_argument);
+  return StartOfLine + ByteInLine;
+}
+
 llvm::Expected<size_t> positionToOffset(llvm::StringRef Code, Position P,
                                         bool AllowColumnsBeyondLineLength) {
   if (P.line < 0)
@@ -147,18 +195,48 @@ llvm::Expected<size_t> positionToOffset(llvm::StringRef Code, Position P,
           llvm::errc::invalid_argument);
     StartOfLine = NextNL + 1;
   }
-  StringRef Line =
-      Code.substr(StartOfLine).take_until([](char C) { return C == '\n'; });
+  return offsetInLine(Code, StartOfLine, P, AllowColumnsBeyondLineLength);
+}
 
-  // P.character may be in UTF-16, transcode if necessary.
-  bool Valid;
-  size_t ByteInLine = measureUnits(Line, P.character, lspEncoding(), Valid);
-  if (!Valid && !AllowColumnsBeyondLineLength)
+llvm::Expected<size_t> positionToOffset(llvm::StringRef Code,
+                                        llvm::ArrayRef<size_t> LineStarts,
+                                        Position P,
+                                        bool AllowColumnsBeyondLineLength) {
+  if (P.line < 0)
     return llvm::make_error<llvm::StringError>(
-        llvm::formatv("{0} offset {1} is invalid for line {2}", lspEncoding(),
-                      P.character, P.line),
+        llvm::formatv("Line value can't be negative ({0})", P.line),
         llvm::errc::invalid_argument);
-  return StartOfLine + ByteInLine;
+  if (P.character < 0)
+    return llvm::make_error<llvm::StringError>(
+        llvm::formatv("Character value can't be negative ({0})", P.character),
+        llvm::errc::invalid_argument);
+  if (static_cast<size_t>(P.line) >= LineStarts.size())
+    return llvm::make_error<llvm::StringError>(
+        llvm::formatv("Line value is out of range ({0})", P.line),
+        llvm::errc::invalid_argument);
+  return offsetInLine(Code, LineStarts[P.line], P,
+                      AllowColumnsBeyondLineLength);
+}
+
+std::vector<size_t> computeLineStarts(llvm::StringRef Code) {
+  std::vector<size_t> LineStarts = {0};
+  for (size_t NextNL = Code.find('\n'); NextNL != llvm::StringRef::npos;
+       NextNL = Code.find('\n', NextNL + 1))
+    LineStarts.push_back(NextNL + 1);
+  return LineStarts;
+}
+
+Position offsetToPosition(llvm::StringRef Code,
+                          llvm::ArrayRef<size_t> LineStarts, size_t Offset) {
+  Offset = std::min(Code.size(), Offset);
+  // The line is the last one starting at or before Offset.
+  auto Next = std::upper_bound(LineStarts.begin(), LineStarts.end(), Offset);
+  assert(Next != LineStarts.begin() && "LineStarts must start with 0");
+  size_t StartOfLine = *(Next - 1);
+  Position Pos;
+  Pos.line = Next - LineStarts.begin() - 1;
+  Pos.character = lspLength(Code.slice(StartOfLine, Offset));
+  return Pos;
 }
 
 Position offsetToPosition(llvm::StringRef Code, size_t Offset) {
@@ -298,9 +376,16 @@ TextEdit replacementToEdit(llvm::StringRef Code,
 
 std::vector<TextEdit> replacementsToEdits(llvm::StringRef Code,
                                           const tooling::Replacements &Repls) {
+  // Formatting a large file can produce thousands of replacements, don't scan
+  // from the start of the file for each of them.
+  std::vector<size_t> LineStarts = computeLineStarts(Code);
   std::vector<TextEdit> Edits;
-  for (const auto &R : Repls)
-    Edits.push_back(replacementToEdit(Code, R));
+  for (const auto &R : Repls) {
+    Range ReplacementRange = {
+        offsetToPosition(Code, LineStarts, R.getOffset()),
+        offsetToPosition(Code, LineStarts, R.getOffset() + R.getLength())};
+    Edits.push_back({ReplacementRange, R.getReplacementText()});
+  }
   return Edits;
 }
 
@@ -56,10 +56,27 @@ llvm::Expected<size_t>
 positionToOffset(llvm::StringRef Code, Position P,
                  bool AllowColumnsBeyondLineLength = true);
 
+/// Like positionToOffset above, but finds the start of P.line in
+/// \p LineStarts instead of scanning \p Code, so the cost doesn't grow with
+/// the line number. \p LineStarts must hold the offset of every line in
+/// \p Code, as produced by computeLineStarts.
+llvm::Expected<size_t>
+positionToOffset(llvm::StringRef Code, llvm::ArrayRef<size_t> LineStarts,
+                 Position P, bool AllowColumnsBeyondLineLength = true);
+
+/// Returns the offsets at which each line of \p Code starts. The first element
+/// is always 0; there is one more element than there are newlines in \p Code.
+std::vector<size_t> computeLineStarts(llvm::StringRef Code);
+
 /// Turn an offset in Code into a [line, column] pair.
 /// The offset must be in range [0, Code.size()].
 Position offsetToPosition(llvm::StringRef Code, size_t Offset);
 
+/// Like offsetToPosition above, but finds the line in \p LineStarts (as
+/// produced by computeLineStarts) instead of scanning \p Code from the start.
+Position offsetToPosition(llvm::StringRef Code,
+                          llvm::ArrayRef<size_t> LineStarts, size_t Offset);
+
 /// Turn a SourceLocation into a [line, column] pair.
 /// FIXME: This should return an error if the location is invalid.
 Position sourceLocToPosition(const SourceManager &SM, SourceLocation Loc);
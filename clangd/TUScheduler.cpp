@@ -44,6 +44,7 @@
 #include "TUScheduler.h"
 #include "Cancellation.h"
 #include "Logger.h"
+#include "ResourceUsage.h"
 #include "Trace.h"
 #include "index/CanonicalIncludes.h"
 #include "clang/Frontend/CompilerInvocation.h"
@@ -66,6 +67,98 @@ class ASTWorker;
 
 static clang::clangd::Key<std::string> kFileBeingProcessed;
 
+// The part of Contents that the preamble is built from.
+static std::string preambleText(llvm::StringRef Contents,
+                                const LangOptions &LangOpts = LangOptions()) {
+  auto Buffer = llvm::MemoryBuffer::getMemBuffer(
+      Contents, "", /*RequiresNullTerminator=*/false);
+  return Contents.take_front(
+      ComputePreambleBounds(LangOpts, Buffer.get(), /*MaxLines=*/0).Size);
+}
+
+// Whether the AST cache held the AST needed for a read or for diagnostics.
+constexpr trace::Metric ASTAccessForRead("ast_access_read",
+                                         trace::Metric::Counter, "result");
+constexpr trace::Metric ASTAccessForDiag("ast_access_diag",
+                                         trace::Metric::Counter, "result");
+// Number of requests waiting for an ASTWorker, when a new one is added.
+constexpr trace::Metric RequestQueueDepth("ast_worker_queue_depth",
+                                          trace::Metric::Distribution);
+
+// Resources used by the requests run by workers, labeled with the request's
+// name. Times are in milliseconds. Only recorded with resource accounting on.
+constexpr trace::Metric RequestQueueTime("request_queue_time",
+                                         trace::Metric::Distribution,
+                                         "request_name");
+constexpr trace::Metric RequestRunTime("request_run_time",
+                                       trace::Metric::Distribution,
+                                       "request_name");
+constexpr trace::Metric RequestCPUTime("request_cpu_time",
+                                       trace::Metric::Distribution,
+                                       "request_name");
+constexpr trace::Metric RequestAllocations("request_allocations",
+                                           trace::Metric::Distribution,
+                                           "request_name");
+constexpr trace::Metric RequestAllocatedBytes("request_allocated_bytes",
+                                              trace::Metric::Distribution,
+                                              "request_name");
+constexpr trace::Metric RequestLockWait("request_lock_wait",
+                                        trace::Metric::Distribution,
+                                        "request_name");
+
+namespace {
+/// Accounts for the resources a request uses on the current thread, from its
+/// construction to its destruction, and for the time it waited to run since
+/// it was added. They are attached to the request's span, and recorded in the
+/// metrics.
+class RequestAccounting {
+public:
+  RequestAccounting(llvm::StringRef Name, steady_clock::time_point AddTime,
+                    trace::Span &Tracer)
+      : Name(Name), AddTime(AddTime), Tracer(Tracer),
+        Enabled(resourceAccountingEnabled()) {
+    if (!Enabled)
+      return;
+    Start = steady_clock::now();
+    Before = threadResourceUsage();
+  }
+
+  ~RequestAccounting() {
+    if (!Enabled)
+      return;
+    ResourceUsage Used = threadResourceUsage() - Before;
+    double QueueMs = millis(Start - AddTime);
+    double RunMs = millis(steady_clock::now() - Start);
+    double CPUMs = millis(Used.CPUTime);
+    double LockWaitMs = millis(Used.LockWait);
+    RequestQueueTime.record(QueueMs, Name);
+    RequestRunTime.record(RunMs, Name);
+    RequestCPUTime.record(CPUMs, Name);
+    RequestAllocations.record(Used.Allocations, Name);
+    RequestAllocatedBytes.record(Used.AllocatedBytes, Name);
+    RequestLockWait.record(LockWaitMs, Name);
+    SPAN_ATTACH(Tracer, "queue_ms", QueueMs);
+    SPAN_ATTACH(Tracer, "run_ms", RunMs);
+    SPAN_ATTACH(Tracer, "cpu_ms", CPUMs);
+    SPAN_ATTACH(Tracer, "allocations", int64_t(Used.Allocations));
+    SPAN_ATTACH(Tracer, "allocated_bytes", int64_t(Used.AllocatedBytes));
+    SPAN_ATTACH(Tracer, "lock_wait_ms", LockWaitMs);
+  }
+
+private:
+  template <typename Duration> static double millis(Duration D) {
+    return std::chrono::duration<double, std::milli>(D).count();
+  }
+
+  llvm::StringRef Name;
+  steady_clock::time_point AddTime;
+  trace::Span &Tracer;
+  bool Enabled;
+  steady_clock::time_point Start;
+  ResourceUsage Before;
+};
+} // namespace
+
 llvm::Optional<llvm::StringRef> TUScheduler::getFileBeingProcessedInContext() {
   if (auto *File = Context::current().get(kFileBeingProcessed))
     return llvm::StringRef(*File);
@@ -80,7 +173,9 @@ class TUScheduler::ASTCache {
 public:
   using Key = const ASTWorker *;
 
-  ASTCache(unsigned MaxRetainedASTs) : MaxRetainedASTs(MaxRetainedASTs) {}
+  ASTCache(const ASTRetentionPolicy &Policy)
+      : MaxRetainedASTs(Policy.MaxRetainedASTs),
+        MaxRetainedASTBytes(Policy.MaxRetainedASTBytes) {}
 
   /// Returns result of getUsedBytes() for the AST cached by \p K.
   /// If no AST is cached, 0 is returned.
@@ -92,21 +187,26 @@ public:
     return It->second->getUsedBytes();
   }
 
-  /// Store the value in the pool, possibly removing the last used AST.
-  /// The value should not be in the pool when this function is called.
+  /// Store the value in the pool, possibly removing the least recently used
+  /// ASTs. The value should not be in the pool when this function is called.
   void put(Key K, std::unique_ptr<ParsedAST> V) {
     std::unique_lock<std::mutex> Lock(Mut);
     assert(findByKey(K) == LRU.end());
 
+    UsedBytes += V ? V->getUsedBytes() : 0;
     LRU.insert(LRU.begin(), {K, std::move(V)});
-    if (LRU.size() <= MaxRetainedASTs)
-      return;
-    // We're past the limit, remove the last element.
-    std::unique_ptr<ParsedAST> ForCleanup = std::move(LRU.back().second);
-    LRU.pop_back();
-    // Run the expensive destructor outside the lock.
+    // While we're past the limits, remove the last element.
+    std::vector<std::unique_ptr<ParsedAST>> ForCleanup;
+    while (LRU.size() > MaxRetainedASTs ||
+           (MaxRetainedASTBytes && UsedBytes > MaxRetainedASTBytes)) {
+      if (LRU.back().second)
+        UsedBytes -= LRU.back().second->getUsedBytes();
+      ForCleanup.push_back(std::move(LRU.back().second));
+      LRU.pop_back();
+    }
+    // Run the expensive destructors outside the lock.
     Lock.unlock();
-    ForCleanup.reset();
+    ForCleanup.clear();
   }
 
   /// Returns the cached value for \p K, or llvm::None if the value is not in
@@ -118,6 +218,8 @@ public:
     if (Existing == LRU.end())
       return None;
     std::unique_ptr<ParsedAST> V = std::move(Existing->second);
+    if (V)
+      UsedBytes -= V->getUsedBytes();
     LRU.erase(Existing);
     // GCC 4.8 fails to compile `return V;`, as it tries to call the copy
     // constructor of unique_ptr, so we call the move ctor explicitly to avoid
@@ -134,48 +236,125 @@ private:
 
   std::mutex Mut;
   unsigned MaxRetainedASTs;
+  std::size_t MaxRetainedASTBytes;
+  /// Total size of the cached ASTs.
+  std::size_t UsedBytes = 0; /* GUARDED_BY(Mut) */
   /// Items sorted in LRU order, i.e. first item is the most recently accessed
   /// one.
   std::vector<KVPair> LRU; /* GUARDED_BY(Mut) */
 };
 
+/// An LRU cache of preambles of closed files.
+/// Preambles are validated when they are reused, so a cached preamble may be
+/// stale. The total size of the cached preambles is bounded.
+class TUScheduler::PreambleCache {
+public:
+  PreambleCache(std::size_t MaxBytes) : MaxBytes(MaxBytes) {}
+
+  /// Stores the preamble of a closed file. Replaces the one cached for \p File,
+  /// if any, and evicts the least recently closed ones when needed.
+  /// Speculative preambles are stored as the least recent ones, so they're
+  /// evicted first.
+  void put(PathRef File, std::shared_ptr<const PreambleData> Preamble,
+           bool Speculative = false) {
+    std::vector<std::shared_ptr<const PreambleData>> ForCleanup;
+    {
+      std::lock_guard<std::mutex> Lock(Mut);
+      if (auto Existing = takeLocked(File))
+        ForCleanup.push_back(std::move(Existing));
+      std::size_t Size = Preamble->Preamble.getSize();
+      if (Size > MaxBytes)
+        return;
+      LRU.insert(Speculative ? LRU.end() : LRU.begin(),
+                 {File, std::move(Preamble)});
+      UsedBytes += Size;
+      while (UsedBytes > MaxBytes) {
+        UsedBytes -= LRU.back().second->Preamble.getSize();
+        ForCleanup.push_back(std::move(LRU.back().second));
+        LRU.pop_back();
+      }
+    }
+    // Run the expensive destructors outside the lock.
+  }
+
+  /// Returns the preamble cached for \p File, or null. The preamble is removed
+  /// from the cache.
+  std::shared_ptr<const PreambleData> take(PathRef File) {
+    std::lock_guard<std::mutex> Lock(Mut);
+    return takeLocked(File);
+  }
+
+  bool contains(PathRef File) {
+    std::lock_guard<std::mutex> Lock(Mut);
+    return llvm::any_of(LRU, [File](const KVPair &P) { return P.first == File; });
+  }
+
+private:
+  using KVPair = std::pair<std::string, std::shared_ptr<const PreambleData>>;
+
+  std::shared_ptr<const PreambleData> takeLocked(PathRef File) {
+    auto Existing =
+        llvm::find_if(LRU, [File](const KVPair &P) { return P.first == File; });
+    if (Existing == LRU.end())
+      return nullptr;
+    std::shared_ptr<const PreambleData> Preamble = std::move(Existing->second);
+    UsedBytes -= Preamble->Preamble.getSize();
+    LRU.erase(Existing);
+    return Preamble;
+  }
+
+  std::mutex Mut;
+  std::size_t MaxBytes;
+  std::size_t UsedBytes = 0; /* GUARDED_BY(Mut) */
+  /// Items sorted in LRU order, i.e. first item is the most recently closed
+  /// one.
+  std::vector<KVPair> LRU; /* GUARDED_BY(Mut) */
+};
+
 namespace {
 class ASTWorkerHandle;
 
 /// Owns one instance of the AST, schedules updates and reads of it.
 /// Also responsible for building and providing access to the preamble.
-/// Each ASTWorker processes the async requests sent to it on a separate
-/// dedicated thread.
-/// The ASTWorker that manages the AST is shared by both the processing thread
-/// and the TUScheduler. The TUScheduler should discard an ASTWorker when
-/// remove() is called, but its thread may be busy and we don't want to block.
-/// So the workers are accessed via an ASTWorkerHandle. Destroying the handle
-/// signals the worker to exit its run loop and gives up shared ownership of the
-/// worker.
-class ASTWorker {
+/// Each ASTWorker is a serial queue of the async requests sent to it. Its
+/// requests run one at a time, in order, on the threads of a WorkerPool shared
+/// by all files.
+/// The ASTWorker that manages the AST is shared by both the WorkerPool and the
+/// TUScheduler. The TUScheduler should discard an ASTWorker when remove() is
+/// called, but it may be busy and we don't want to block. So the workers are
+/// accessed via an ASTWorkerHandle. Destroying the handle signals the worker to
+/// finish its pending requests and gives up shared ownership of the worker.
+class ASTWorker : public std::enable_shared_from_this<ASTWorker> {
   friend class ASTWorkerHandle;
   ASTWorker(PathRef FileName, TUScheduler::ASTCache &LRUCache,
-            Semaphore &Barrier, bool RunSync,
-            steady_clock::duration UpdateDebounce,
+            Semaphore &Barrier, TUScheduler::WorkerPool *Pool,
+            DebouncePolicy UpdateDebounce,
             std::shared_ptr<PCHContainerOperations> PCHs,
-            bool StorePreamblesInMemory, ParsingCallbacks &Callbacks);
+            bool StorePreamblesInMemory, ParsingCallbacks &Callbacks,
+            std::shared_ptr<const PreambleData> Preamble);
 
 public:
   /// Create a new ASTWorker and return a handle to it.
-  /// The processing thread is spawned using \p Tasks. However, when \p Tasks
+  /// Requests are processed on the threads of \p Pool. However, when \p Pool
   /// is null, all requests will be processed on the calling thread
   /// synchronously instead. \p Barrier is acquired when processing each
   /// request, it is used to limit the number of actively running threads.
+  /// If \p Preamble is non-null, the first update reuses it if it's valid.
   static ASTWorkerHandle create(PathRef FileName,
                                 TUScheduler::ASTCache &IdleASTs,
-                                AsyncTaskRunner *Tasks, Semaphore &Barrier,
-                                steady_clock::duration UpdateDebounce,
+                                TUScheduler::WorkerPool *Pool,
+                                Semaphore &Barrier,
+                                DebouncePolicy UpdateDebounce,
                                 std::shared_ptr<PCHContainerOperations> PCHs,
                                 bool StorePreamblesInMemory,
-                                ParsingCallbacks &Callbacks);
+                                ParsingCallbacks &Callbacks,
+                                std::shared_ptr<const PreambleData> Preamble);
   ~ASTWorker();
 
   void update(ParseInputs Inputs, WantDiagnostics);
+  /// Sets the range of the file visible in the editor. Updates publish the
+  /// diagnostics for it first, from a quick parse. Threadsafe.
+  void setVisibleRange(llvm::Optional<Range> Visible);
   void
   runWithAST(llvm::StringRef Name,
              llvm::unique_function<void(llvm::Expected<InputsAndAST>)> Action);
@@ -191,21 +370,29 @@ public:
   /// return after an unsuccessful build of the preamble too, i.e. result of
   /// getPossiblyStalePreamble() can be null even after this function returns.
   void waitForFirstPreamble() const;
+  /// Returns the compile command of the last update that started building.
+  /// Threadsafe.
+  tooling::CompileCommand getCurrentCompileCommand() const;
 
   std::size_t getUsedBytes() const;
+  void profile(MemoryTree &MT) const;
   bool isASTCached() const;
 
+  /// Runs the first request of the queue if it's due, and schedules the
+  /// worker again if more requests are pending. Called by the WorkerPool.
+  void runNext();
+
 private:
-  // Must be called exactly once on processing thread. Will return after
-  // stop() is called on a separate thread and all pending requests are
-  // processed.
-  void run();
-  /// Signal that run() should finish processing pending requests and exit.
+  /// Signal that the worker should finish processing pending requests, without
+  /// delaying them.
   void stop();
+  /// Schedules the worker on the pool at the deadline of its next request,
+  /// unless it's running (it schedules itself when done) or has no requests.
+  void wakeLocked();
   /// Adds a new task to the end of the request queue.
   void startTask(llvm::StringRef Name, llvm::unique_function<void()> Task,
                  llvm::Optional<WantDiagnostics> UpdateType);
-  /// Updates the TUStatus and emits it. Only called in the worker thread.
+  /// Updates the TUStatus and emits it. Only called while running a request.
   void emitTUStatus(TUAction FAction,
                     const TUStatus::BuildDetails *Detail = nullptr);
 
@@ -216,6 +403,42 @@ private:
   Deadline scheduleLocked();
   /// Should the first task in the queue be skipped instead of run?
   bool shouldSkipHeadLocked() const;
+  /// Adds \p D to a debounce history, dropping the oldest entry if it's full.
+  void recordLocked(std::deque<steady_clock::duration> &History,
+                    steady_clock::duration D);
+  /// Builds the AST of \p Inputs against \p Preamble, which was built from
+  /// \p PreambleText, an older version of the main file's preamble: that one
+  /// replaces the new preamble, padded with blank lines so the lines below it
+  /// don't move. Returns None if the old preamble has more lines.
+  llvm::Optional<ParsedAST>
+  buildStaleAST(const CompilerInvocation &Invocation, const ParseInputs &Inputs,
+                std::shared_ptr<const PreambleData> Preamble,
+                llvm::StringRef PreambleText);
+  /// Builds the stale AST of an update changing the preamble, reports its
+  /// diagnostics below the preamble, and lets reads use it until the new
+  /// preamble is built. Returns false if no AST could be built. Only called in
+  /// the worker thread.
+  bool serveStaleAST(const CompilerInvocation &Invocation,
+                     const ParseInputs &Inputs,
+                     std::shared_ptr<const PreambleData> OldPreamble,
+                     llvm::StringRef OldPreambleText,
+                     llvm::StringRef NewPreambleText);
+  /// Builds the AST of FileInputs for a read, with the last built preamble.
+  llvm::Optional<ParsedAST> buildReadAST(const CompilerInvocation &Invocation);
+  /// Schedules running the deferred clang-tidy matchers on the current AST,
+  /// after the requests already queued. Reports all of its diagnostics, unless
+  /// a newer update makes them obsolete first.
+  void reportClangTidyDiagnostics();
+  /// Is an update that will report diagnostics (not WantDiagnostics::No)
+  /// queued after the currently running task?
+  bool hasNewerDiagnosticsUpdate() const;
+  /// Publishes the diagnostics of the visible range, if set, from an AST only
+  /// parsing the visible function bodies. Diagnostics outside of the range are
+  /// the last reported ones. Returns true if diagnostics were reported. Only
+  /// called in the worker thread.
+  bool reportVisibleDiagnostics(const CompilerInvocation &Invocation,
+                                const ParseInputs &Inputs,
+                                std::shared_ptr<const PreambleData> Preamble);
 
   struct Request {
     llvm::unique_function<void()> Action;
@@ -225,11 +448,20 @@ private:
     llvm::Optional<WantDiagnostics> UpdateType;
   };
 
+  /// Whether the read right after the running update can run now, on the AST
+  /// built with the old preamble.
+  bool staleReadReadyLocked() const;
+  /// Runs \p Req, a read taken out of the queue, alongside the update
+  /// building the new preamble.
+  void runStaleRead(Request Req);
+
   /// Handles retention of ASTs.
   TUScheduler::ASTCache &IdleASTs;
+  /// Null when running requests synchronously.
+  TUScheduler::WorkerPool *const Pool;
   const bool RunSync;
   /// Time to wait after an update to see whether another update obsoletes it.
-  const steady_clock::duration UpdateDebounce;
+  const DebouncePolicy UpdateDebounce;
   /// File that ASTWorker is responsible for.
   const Path FileName;
   /// Whether to keep the built preambles in memory or on disk.
@@ -242,20 +474,43 @@ private:
   TUStatus Status;
 
   Semaphore &Barrier;
-  /// Inputs, corresponding to the current state of AST.
+  /// Inputs, corresponding to the current state of AST. Only written by the
+  /// worker thread, under Mutex.
   ParseInputs FileInputs;
   /// Whether the diagnostics for the current FileInputs were reported to the
   /// users before.
   bool DiagsWereReported = false;
+  /// The diagnostics of the last full AST that were reported.
+  std::vector<Diag> LastDiags;
   /// Size of the last AST
   /// Guards members used by both TUScheduler and the worker thread.
   mutable std::mutex Mutex;
   std::shared_ptr<const PreambleData> LastBuiltPreamble; /* GUARDED_BY(Mutex) */
+  /// The main file's preamble that LastBuiltPreamble was built from, if known.
+  llvm::Optional<std::string> LastBuiltPreambleText; /* GUARDED_BY(Mutex) */
+  /// Set while the running update builds a new preamble. Reads queued right
+  /// after it can meanwhile run on the AST built with the old one.
+  bool ServingStaleAST = false;  /* GUARDED_BY(Mutex) */
+  bool StaleReadRunning = false; /* GUARDED_BY(Mutex) */
+  llvm::Optional<Range> VisibleRange;                    /* GUARDED_BY(Mutex) */
+  /// Recent durations of AST builds, and intervals between updates, used to
+  /// compute the debounce. Oldest first.
+  static constexpr unsigned DebounceHistorySize = 8;
+  std::deque<steady_clock::duration> RebuildTimes;    /* GUARDED_BY(Mutex) */
+  std::deque<steady_clock::duration> UpdateIntervals; /* GUARDED_BY(Mutex) */
+  llvm::Optional<steady_clock::time_point> LastUpdate; /* GUARDED_BY(Mutex) */
+  /// Set while building a preamble that newer updates may cancel, along with
+  /// the preamble text being built. Guarded by Mutex.
+  std::shared_ptr<std::atomic<bool>> PreambleBuildCancelled;
+  std::string BuildingPreambleText;
   /// Becomes ready when the first preamble build finishes.
   Notification PreambleWasBuilt;
-  /// Set to true to signal run() to finish processing.
+  /// Set to true to stop delaying the pending requests.
   bool Done;                    /* GUARDED_BY(Mutex) */
+  /// Whether a pool thread is running the first request of the queue.
+  bool Running = false;         /* GUARDED_BY(Mutex) */
   std::deque<Request> Requests; /* GUARDED_BY(Mutex) */
+  /// Notified when a request finishes, for blockUntilIdle().
   mutable std::condition_variable RequestsCV;
   // FIXME: rename it to better fix the current usage, we also use it to guard
   // emitting TUStatus.
@@ -309,35 +564,116 @@ public:
 private:
   std::shared_ptr<ASTWorker> Worker;
 };
+} // namespace
+
+/// Runs the requests of ASTWorkers on a fixed set of threads, so the number of
+/// threads doesn't grow with the number of open files. A worker is scheduled
+/// when its first request is due (i.e. after the debounce), and runs on one
+/// thread at a time, so its requests stay in order.
+class TUScheduler::WorkerPool {
+public:
+  WorkerPool(unsigned NumThreads) {
+    for (unsigned I = 0; I < NumThreads; ++I)
+      Threads.runAsync("worker:" + llvm::Twine(I), [this] { loop(); });
+  }
+
+  /// Runs the workers that are still scheduled, then stops the threads.
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      ShuttingDown = true;
+    }
+    CV.notify_all();
+    Threads.wait();
+  }
+
+  /// Calls W->runNext() on a pool thread once \p D expires. If \p W is
+  /// already scheduled, its deadline is replaced.
+  void schedule(std::shared_ptr<ASTWorker> W, Deadline D) {
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      auto It = llvm::find_if(
+          Scheduled, [&](const ScheduledWorker &S) { return S.first == W; });
+      if (It != Scheduled.end())
+        It->second = D;
+      else
+        Scheduled.emplace_back(std::move(W), D);
+    }
+    CV.notify_all();
+  }
 
+private:
+  using ScheduledWorker = std::pair<std::shared_ptr<ASTWorker>, Deadline>;
+
+  void loop() {
+    std::unique_lock<std::mutex> Lock(Mu);
+    while (true) {
+      auto Due = llvm::find_if(Scheduled, [](const ScheduledWorker &S) {
+        return S.second.expired();
+      });
+      if (Due == Scheduled.end()) {
+        if (Scheduled.empty() && ShuttingDown)
+          return;
+        // Sleep until the earliest deadline, or until workers are scheduled.
+        Deadline Next = Deadline::infinity();
+        for (const ScheduledWorker &S : Scheduled)
+          if (Next == Deadline::infinity() || S.second.time() < Next.time())
+            Next = S.second;
+        wait(Lock, CV, Next);
+        continue;
+      }
+      std::shared_ptr<ASTWorker> Worker = std::move(Due->first);
+      Scheduled.erase(Due);
+      Lock.unlock();
+      Worker->runNext();
+      // This may destroy the worker, don't hold the lock.
+      Worker.reset();
+      Lock.lock();
+    }
+  }
+
+  std::mutex Mu;
+  std::condition_variable CV;
+  // Workers with pending requests, waiting for their deadline or a thread.
+  std::vector<ScheduledWorker> Scheduled; /* GUARDED_BY(Mu) */
+  bool ShuttingDown = false;              /* GUARDED_BY(Mu) */
+  AsyncTaskRunner Threads;
+};
+
+namespace {
 ASTWorkerHandle ASTWorker::create(PathRef FileName,
                                   TUScheduler::ASTCache &IdleASTs,
-                                  AsyncTaskRunner *Tasks, Semaphore &Barrier,
-                                  steady_clock::duration UpdateDebounce,
+                                  TUScheduler::WorkerPool *Pool,
+                                  Semaphore &Barrier,
+                                  DebouncePolicy UpdateDebounce,
                                   std::shared_ptr<PCHContainerOperations> PCHs,
                                   bool StorePreamblesInMemory,
-                                  ParsingCallbacks &Callbacks) {
-  std::shared_ptr<ASTWorker> Worker(new ASTWorker(
-      FileName, IdleASTs, Barrier, /*RunSync=*/!Tasks, UpdateDebounce,
-      std::move(PCHs), StorePreamblesInMemory, Callbacks));
-  if (Tasks)
-    Tasks->runAsync("worker:" + llvm::sys::path::filename(FileName),
-                    [Worker]() { Worker->run(); });
-
+                                  ParsingCallbacks &Callbacks,
+                                  std::shared_ptr<const PreambleData> Preamble) {
+  std::shared_ptr<ASTWorker> Worker(
+      new ASTWorker(FileName, IdleASTs, Barrier, Pool, UpdateDebounce,
+                    std::move(PCHs), StorePreamblesInMemory, Callbacks,
+                    std::move(Preamble)));
   return ASTWorkerHandle(std::move(Worker));
 }
 
 ASTWorker::ASTWorker(PathRef FileName, TUScheduler::ASTCache &LRUCache,
-                     Semaphore &Barrier, bool RunSync,
-                     steady_clock::duration UpdateDebounce,
+                     Semaphore &Barrier, TUScheduler::WorkerPool *Pool,
+                     DebouncePolicy UpdateDebounce,
                      std::shared_ptr<PCHContainerOperations> PCHs,
-                     bool StorePreamblesInMemory, ParsingCallbacks &Callbacks)
-    : IdleASTs(LRUCache), RunSync(RunSync), UpdateDebounce(UpdateDebounce),
+                     bool StorePreamblesInMemory, ParsingCallbacks &Callbacks,
+                     std::shared_ptr<const PreambleData> Preamble)
+    : IdleASTs(LRUCache), Pool(Pool), RunSync(!Pool),
+      UpdateDebounce(UpdateDebounce),
       FileName(FileName), StorePreambleInMemory(StorePreamblesInMemory),
       Callbacks(Callbacks),
       PCHs(std::move(PCHs)), Status{TUAction(TUAction::Idle, ""),
                                     TUStatus::BuildDetails()},
-      Barrier(Barrier), Done(false) {}
+      Barrier(Barrier), LastBuiltPreamble(std::move(Preamble)), Done(false) {
+  // The preamble can only be reused with the command it was built with.
+  if (LastBuiltPreamble)
+    FileInputs.CompileCommand = LastBuiltPreamble->CompileCommand;
+}
 
 ASTWorker::~ASTWorker() {
   // Make sure we remove the cached AST, if any.
@@ -351,15 +687,39 @@ ASTWorker::~ASTWorker() {
 
 void ASTWorker::update(ParseInputs Inputs, WantDiagnostics WantDiags) {
   llvm::StringRef TaskName = "Update";
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto Now = steady_clock::now();
+    // Updates further apart than the longest debounce aren't a burst of typing.
+    if (LastUpdate && Now - *LastUpdate < UpdateDebounce.Max)
+      recordLocked(UpdateIntervals, Now - *LastUpdate);
+    LastUpdate = Now;
+    // The preamble being built is obsolete if this version changes it. The
+    // cancelled update doesn't report diagnostics, so this one must.
+    if (WantDiags != WantDiagnostics::No && PreambleBuildCancelled &&
+        preambleText(Inputs.Contents) != BuildingPreambleText)
+      *PreambleBuildCancelled = true;
+  }
+  // The compiler diagnostics are reported as soon as the AST is built, those
+  // of clang-tidy by a later task, see reportClangTidyDiagnostics().
+  Inputs.Opts.DeferClangTidy = true;
   auto Task = [=]() mutable {
+    if (Inputs.GetCompileCommand) {
+      Inputs.CompileCommand = Inputs.GetCompileCommand();
+      Inputs.GetCompileCommand = nullptr;
+    }
     // Will be used to check if we can avoid rebuilding the AST.
     bool InputsAreTheSame =
         std::tie(FileInputs.CompileCommand, FileInputs.Contents) ==
         std::tie(Inputs.CompileCommand, Inputs.Contents);
 
-    tooling::CompileCommand OldCommand = std::move(FileInputs.CompileCommand);
+    tooling::CompileCommand OldCommand = FileInputs.CompileCommand;
     bool PrevDiagsWereReported = DiagsWereReported;
-    FileInputs = Inputs;
+    {
+      // getCurrentCompileCommand() reads FileInputs from other threads.
+      std::lock_guard<std::mutex> Lock(Mutex);
+      FileInputs = Inputs;
+    }
     DiagsWereReported = false;
     emitTUStatus({TUAction::BuildingPreamble, TaskName});
     log("Updating file {0} with command [{1}] {2}", FileName,
@@ -381,20 +741,66 @@ void ASTWorker::update(ParseInputs Inputs, WantDiagnostics WantDiags) {
       return;
     }
 
-    std::shared_ptr<const PreambleData> OldPreamble =
-        getPossiblyStalePreamble();
+    std::shared_ptr<const PreambleData> OldPreamble;
+    llvm::Optional<std::string> OldPreambleText;
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      OldPreamble = LastBuiltPreamble;
+      OldPreambleText = LastBuiltPreambleText;
+    }
+    std::string NewPreambleText =
+        preambleText(Inputs.Contents, *Invocation->getLangOpts());
+    // Building the new preamble can take a while. Meanwhile, report the
+    // diagnostics of an AST built with the old one, and serve reads from it.
+    bool UsingStaleAST = false;
+    if (WantDiags != WantDiagnostics::No && OldPreamble && OldPreambleText &&
+        *OldPreambleText != NewPreambleText &&
+        OldPreamble->CompileCommand.Directory ==
+            Inputs.CompileCommand.Directory &&
+        OldPreamble->CompileCommand.CommandLine ==
+            Inputs.CompileCommand.CommandLine)
+      UsingStaleAST = serveStaleAST(*Invocation, Inputs, OldPreamble,
+                                    *OldPreambleText, NewPreambleText);
+    // Newer updates changing the preamble cancel its build, unless the
+    // diagnostics of this version must be reported.
+    std::shared_ptr<std::atomic<bool>> Cancelled;
+    if (WantDiags != WantDiagnostics::Yes) {
+      Cancelled = std::make_shared<std::atomic<bool>>(false);
+      std::lock_guard<std::mutex> Lock(Mutex);
+      PreambleBuildCancelled = Cancelled;
+      BuildingPreambleText = preambleText(Inputs.Contents);
+    }
     std::shared_ptr<const PreambleData> NewPreamble = buildPreamble(
         FileName, *Invocation, OldPreamble, OldCommand, Inputs, PCHs,
         StorePreambleInMemory,
         [this](ASTContext &Ctx, std::shared_ptr<clang::Preprocessor> PP,
                const CanonicalIncludes &CanonIncludes) {
           Callbacks.onPreambleAST(FileName, Ctx, std::move(PP), CanonIncludes);
-        });
+        },
+        Cancelled.get());
+    if (Cancelled) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      PreambleBuildCancelled.reset();
+    }
+    if (UsingStaleAST) {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      ServingStaleAST = false;
+      RequestsCV.wait(Lock, [this] { return !StaleReadRunning; });
+    }
+    if (Cancelled && *Cancelled) {
+      // The newer update builds the preamble. Until then, stale reads use the
+      // old one, and so do reads of this version's AST, see buildReadAST().
+      IdleASTs.take(this);
+      return;
+    }
 
     bool CanReuseAST = InputsAreTheSame && (OldPreamble == NewPreamble);
     {
       std::lock_guard<std::mutex> Lock(Mutex);
       LastBuiltPreamble = NewPreamble;
+      LastBuiltPreambleText = NewPreamble
+                                  ? llvm::Optional<std::string>(NewPreambleText)
+                                  : llvm::None;
     }
     // Before doing the expensive AST reparse, we want to release our reference
     // to the old preamble, so it can be freed if there are no other references
@@ -439,9 +845,23 @@ void ASTWorker::update(ParseInputs Inputs, WantDiagnostics WantDiags) {
 
     // Get the AST for diagnostics.
     llvm::Optional<std::unique_ptr<ParsedAST>> AST = IdleASTs.take(this);
+    ASTAccessForDiag.record(1, AST ? "hit" : "miss");
     if (!AST) {
+      // The next edit obsoletes the full AST, don't spend time on it once the
+      // visible diagnostics are out. Its update reports the rest instead.
+      if (reportVisibleDiagnostics(*Invocation, Inputs, NewPreamble) &&
+          hasNewerDiagnosticsUpdate()) {
+        log("Skipping full rebuild of the AST for {0}, file was edited.",
+            FileName);
+        return;
+      }
+      auto RebuildStart = steady_clock::now();
       llvm::Optional<ParsedAST> NewAST =
           buildAST(FileName, std::move(Invocation), Inputs, NewPreamble, PCHs);
+      {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        recordLocked(RebuildTimes, steady_clock::now() - RebuildStart);
+      }
       AST = NewAST ? llvm::make_unique<ParsedAST>(std::move(*NewAST)) : nullptr;
       if (!(*AST)) { // buildAST fails.
         TUStatus::BuildDetails Details;
@@ -458,22 +878,157 @@ void ASTWorker::update(ParseInputs Inputs, WantDiagnostics WantDiags) {
     // It seems more useful than making the clients wait indefinitely if they
     // spam us with updates.
     // Note *AST can still be null if buildAST fails.
+    bool TidyPending = false;
     if (*AST) {
       {
         std::lock_guard<std::mutex> Lock(DiagsMu);
         if (ReportDiagnostics)
           Callbacks.onDiagnostics(FileName, (*AST)->getDiagnostics());
       }
+      LastDiags = (*AST)->getDiagnostics();
       trace::Span Span("Running main AST callback");
       Callbacks.onMainAST(FileName, **AST);
-      DiagsWereReported = true;
+      TidyPending = (*AST)->hasPendingClangTidy();
+      DiagsWereReported = !TidyPending;
     }
     // Stash the AST in the cache for further use.
     IdleASTs.put(this, std::move(*AST));
+    if (TidyPending)
+      reportClangTidyDiagnostics();
   };
   startTask(TaskName, std::move(Task), WantDiags);
 }
 
+void ASTWorker::setVisibleRange(llvm::Optional<Range> Visible) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  VisibleRange = Visible;
+}
+
+llvm::Optional<ParsedAST>
+ASTWorker::buildStaleAST(const CompilerInvocation &Invocation,
+                         const ParseInputs &Inputs,
+                         std::shared_ptr<const PreambleData> Preamble,
+                         llvm::StringRef PreambleText) {
+  std::string NewPreambleText =
+      preambleText(Inputs.Contents, *Invocation.getLangOpts());
+  size_t OldLines = PreambleText.count('\n');
+  size_t NewLines = llvm::StringRef(NewPreambleText).count('\n');
+  if (OldLines > NewLines)
+    return None;
+  trace::Span Tracer("BuildStaleAST");
+  ParseInputs Patched = Inputs;
+  Patched.Contents = PreambleText.str() +
+                     std::string(NewLines - OldLines, '\n') +
+                     Inputs.Contents.substr(NewPreambleText.size());
+  return buildAST(FileName, llvm::make_unique<CompilerInvocation>(Invocation),
+                  Patched, std::move(Preamble), PCHs);
+}
+
+bool ASTWorker::serveStaleAST(const CompilerInvocation &Invocation,
+                              const ParseInputs &Inputs,
+                              std::shared_ptr<const PreambleData> OldPreamble,
+                              llvm::StringRef OldPreambleText,
+                              llvm::StringRef NewPreambleText) {
+  llvm::Optional<ParsedAST> AST = buildStaleAST(
+      Invocation, Inputs, std::move(OldPreamble), OldPreambleText);
+  if (!AST)
+    return false;
+  // Diagnostics of the preamble region are those of the old preamble, and
+  // will be updated by the new AST.
+  unsigned PreambleLines = NewPreambleText.count('\n');
+  std::vector<Diag> Diags;
+  for (const Diag &D : AST->getDiagnostics())
+    if (D.InsideMainFile && D.Range.start.line >= int(PreambleLines))
+      Diags.push_back(D);
+  {
+    std::lock_guard<std::mutex> Lock(DiagsMu);
+    if (ReportDiagnostics)
+      Callbacks.onDiagnostics(FileName, std::move(Diags));
+  }
+  IdleASTs.put(this, llvm::make_unique<ParsedAST>(std::move(*AST)));
+  std::lock_guard<std::mutex> Lock(Mutex);
+  ServingStaleAST = true;
+  wakeLocked();
+  return true;
+}
+
+llvm::Optional<ParsedAST>
+ASTWorker::buildReadAST(const CompilerInvocation &Invocation) {
+  std::shared_ptr<const PreambleData> Preamble;
+  llvm::Optional<std::string> Text;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Preamble = LastBuiltPreamble;
+    Text = LastBuiltPreambleText;
+  }
+  // The preamble of FileInputs is being built, or its build was cancelled.
+  if (Preamble && Text &&
+      *Text != preambleText(FileInputs.Contents, *Invocation.getLangOpts())) {
+    if (auto AST = buildStaleAST(Invocation, FileInputs, Preamble, *Text))
+      return AST;
+    Preamble = nullptr;
+  }
+  return buildAST(FileName, llvm::make_unique<CompilerInvocation>(Invocation),
+                  FileInputs, std::move(Preamble), PCHs);
+}
+
+bool ASTWorker::reportVisibleDiagnostics(
+    const CompilerInvocation &Invocation, const ParseInputs &Inputs,
+    std::shared_ptr<const PreambleData> Preamble) {
+  llvm::Optional<Range> Visible;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Visible = VisibleRange;
+  }
+  if (!Visible)
+    return false;
+  trace::Span Tracer("VisibleDiagnostics");
+  ParseInputs VisibleInputs = Inputs;
+  VisibleInputs.Opts.ParseBodiesIn = Visible;
+  llvm::Optional<ParsedAST> AST =
+      buildAST(FileName, llvm::make_unique<CompilerInvocation>(Invocation),
+               VisibleInputs, std::move(Preamble), PCHs);
+  if (!AST)
+    return false;
+  auto IsVisible = [&](const Diag &D) {
+    return D.InsideMainFile && D.Range.start <= Visible->end &&
+           Visible->start <= D.Range.end;
+  };
+  // Keep showing the old diagnostics elsewhere until the full AST is built,
+  // even though their positions may be off by the last edit.
+  std::vector<Diag> Diags;
+  for (const Diag &D : LastDiags)
+    if (!IsVisible(D))
+      Diags.push_back(D);
+  for (const Diag &D : AST->getDiagnostics())
+    if (IsVisible(D))
+      Diags.push_back(D);
+  std::lock_guard<std::mutex> Lock(DiagsMu);
+  if (!ReportDiagnostics)
+    return false;
+  Callbacks.onDiagnostics(FileName, std::move(Diags));
+  return true;
+}
+
+void ASTWorker::reportClangTidyDiagnostics() {
+  runWithAST("ClangTidy", [this](llvm::Expected<InputsAndAST> IA) {
+    if (!IA)
+      return llvm::consumeError(IA.takeError());
+    // The diagnostics of a newer version are on their way.
+    if (hasNewerDiagnosticsUpdate() || !IA->AST.hasPendingClangTidy())
+      return;
+    IA->AST.runClangTidy();
+    {
+      std::lock_guard<std::mutex> Lock(DiagsMu);
+      if (!ReportDiagnostics)
+        return;
+      Callbacks.onDiagnostics(FileName, IA->AST.getDiagnostics());
+    }
+    LastDiags = IA->AST.getDiagnostics();
+    DiagsWereReported = true;
+  });
+}
+
 void ASTWorker::runWithAST(
     llvm::StringRef Name,
     llvm::unique_function<void(llvm::Expected<InputsAndAST>)> Action) {
@@ -481,16 +1036,13 @@ void ASTWorker::runWithAST(
     if (isCancelled())
       return Action(llvm::make_error<CancelledError>());
     llvm::Optional<std::unique_ptr<ParsedAST>> AST = IdleASTs.take(this);
+    ASTAccessForRead.record(1, AST ? "hit" : "miss");
     if (!AST) {
       std::unique_ptr<CompilerInvocation> Invocation =
           buildCompilerInvocation(FileInputs);
       // Try rebuilding the AST.
       llvm::Optional<ParsedAST> NewAST =
-          Invocation
-              ? buildAST(FileName,
-                         llvm::make_unique<CompilerInvocation>(*Invocation),
-                         FileInputs, getPossiblyStalePreamble(), PCHs)
-              : None;
+          Invocation ? buildReadAST(*Invocation) : None;
       AST = NewAST ? llvm::make_unique<ParsedAST>(std::move(*NewAST)) : nullptr;
     }
     // Make sure we put the AST back into the LRU cache.
@@ -506,6 +1058,11 @@ void ASTWorker::runWithAST(
             /*UpdateType=*/None);
 }
 
+tooling::CompileCommand ASTWorker::getCurrentCompileCommand() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return FileInputs.CompileCommand;
+}
+
 std::shared_ptr<const PreambleData>
 ASTWorker::getPossiblyStalePreamble() const {
   std::lock_guard<std::mutex> Lock(Mutex);
@@ -536,8 +1093,8 @@ void ASTWorker::getCurrentPreamble(
                           "GetPreamble", steady_clock::now(),
                           Context::current().clone(),
                           /*UpdateType=*/None});
-  Lock.unlock();
-  RequestsCV.notify_all();
+  // Reads aren't debounced.
+  wakeLocked();
 }
 
 void ASTWorker::waitForFirstPreamble() const { PreambleWasBuilt.wait(); }
@@ -552,6 +1109,16 @@ std::size_t ASTWorker::getUsedBytes() const {
   return Result;
 }
 
+void ASTWorker::profile(MemoryTree &MT) const {
+  MT.child("ast").addUsage(IdleASTs.getUsedBytes(this));
+  if (auto Preamble = getPossiblyStalePreamble()) {
+    MT.child("preamble").addUsage(Preamble->Preamble.getSize());
+    if (Preamble->StatCache)
+      MT.child("preamble_stat_cache")
+          .addUsage(Preamble->StatCache->getUsedBytes());
+  }
+}
+
 bool ASTWorker::isASTCached() const { return IdleASTs.getUsedBytes(this) != 0; }
 
 void ASTWorker::stop() {
@@ -559,12 +1126,10 @@ void ASTWorker::stop() {
     std::lock_guard<std::mutex> Lock(DiagsMu);
     ReportDiagnostics = false;
   }
-  {
-    std::lock_guard<std::mutex> Lock(Mutex);
-    assert(!Done && "stop() called twice");
-    Done = true;
-  }
-  RequestsCV.notify_all();
+  std::lock_guard<std::mutex> Lock(Mutex);
+  assert(!Done && "stop() called twice");
+  Done = true;
+  wakeLocked();
 }
 
 void ASTWorker::startTask(llvm::StringRef Name,
@@ -583,8 +1148,9 @@ void ASTWorker::startTask(llvm::StringRef Name,
     Requests.push_back(
         {std::move(Task), Name, steady_clock::now(),
          Context::current().derive(kFileBeingProcessed, FileName), UpdateType});
+    RequestQueueDepth.record(Requests.size());
+    wakeLocked();
   }
-  RequestsCV.notify_all();
 }
 
 void ASTWorker::emitTUStatus(TUAction Action,
@@ -599,64 +1165,104 @@ void ASTWorker::emitTUStatus(TUAction Action,
   }
 }
 
-void ASTWorker::run() {
-  while (true) {
-    Request Req;
-    {
-      std::unique_lock<std::mutex> Lock(Mutex);
-      for (auto Wait = scheduleLocked(); !Wait.expired();
-           Wait = scheduleLocked()) {
-        if (Done) {
-          if (Requests.empty())
-            return;
-          else     // Even though Done is set, finish pending requests.
-            break; // However, skip delays to shutdown fast.
-        }
-
-        // Tracing: we have a next request, attribute this sleep to it.
-        llvm::Optional<WithContext> Ctx;
-        llvm::Optional<trace::Span> Tracer;
-        if (!Requests.empty()) {
-          Ctx.emplace(Requests.front().Ctx.clone());
-          Tracer.emplace("Debounce");
-          SPAN_ATTACH(*Tracer, "next_request", Requests.front().Name);
-          if (!(Wait == Deadline::infinity())) {
-            emitTUStatus({TUAction::Queued, Req.Name});
-            SPAN_ATTACH(*Tracer, "sleep_ms",
-                        std::chrono::duration_cast<std::chrono::milliseconds>(
-                            Wait.time() - steady_clock::now())
-                            .count());
-          }
-        }
-
-        wait(Lock, RequestsCV, Wait);
-      }
-      Req = std::move(Requests.front());
-      // Leave it on the queue for now, so waiters don't see an empty queue.
-    } // unlock Mutex
+void ASTWorker::wakeLocked() {
+  if (Running) {
+    if (staleReadReadyLocked())
+      Pool->schedule(shared_from_this(), Deadline::zero());
+    return;
+  }
+  if (Requests.empty())
+    return;
+  Deadline D = scheduleLocked();
+  // Even though Done is set, finish pending requests. However, skip delays to
+  // shutdown fast.
+  Pool->schedule(shared_from_this(), Done ? Deadline::zero() : D);
+}
 
-    {
-      std::unique_lock<Semaphore> Lock(Barrier, std::try_to_lock);
-      if (!Lock.owns_lock()) {
-        emitTUStatus({TUAction::Queued, Req.Name});
-        Lock.lock();
-      }
-      WithContext Guard(std::move(Req.Ctx));
-      trace::Span Tracer(Req.Name);
-      emitTUStatus({TUAction::RunningAction, Req.Name});
-      Req.Action();
+bool ASTWorker::staleReadReadyLocked() const {
+  // Reads run one at a time. Ones queued after a later update must wait.
+  // Clang-tidy diagnostics replace the ones of the running update, and would
+  // include those in the preamble region that the stale AST got wrong.
+  return ServingStaleAST && !StaleReadRunning && Requests.size() > 1 &&
+         !Requests[1].UpdateType && Requests[1].Name != "ClangTidy";
+}
+
+void ASTWorker::runStaleRead(Request Req) {
+  {
+    // Doesn't take a slot of the Barrier: the update holds one, and waits for
+    // this read to finish.
+    WithContext Guard(std::move(Req.Ctx));
+    trace::Span Tracer(Req.Name);
+    SPAN_ATTACH(Tracer, "stale_preamble", true);
+    RequestAccounting Accounting(Req.Name, Req.AddTime, Tracer);
+    Req.Action();
+  }
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    StaleReadRunning = false;
+    wakeLocked();
+  }
+  RequestsCV.notify_all();
+}
+
+void ASTWorker::runNext() {
+  Request Req;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (Running && staleReadReadyLocked()) {
+      Req = std::move(Requests[1]);
+      Requests.erase(Requests.begin() + 1);
+      StaleReadRunning = true;
     }
+  }
+  if (Req.Action)
+    return runStaleRead(std::move(Req));
 
-    bool IsEmpty = false;
-    {
-      std::lock_guard<std::mutex> Lock(Mutex);
-      Requests.pop_front();
-      IsEmpty = Requests.empty();
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    // The worker can be scheduled again before a pool thread starts running
+    // it. Its requests must not run concurrently, and the running thread
+    // schedules the worker again when it's done.
+    if (Running || Requests.empty())
+      return;
+    // Newer requests may have changed the deadline.
+    Deadline D = scheduleLocked();
+    if (!Done && !D.expired()) {
+      Pool->schedule(shared_from_this(), D);
+      return;
+    }
+    Running = true;
+    Req = std::move(Requests.front());
+    // Leave it on the queue for now, so waiters don't see an empty queue.
+  }
+
+  {
+    std::unique_lock<Semaphore> Lock(Barrier, std::try_to_lock);
+    if (!Lock.owns_lock()) {
+      emitTUStatus({TUAction::Queued, Req.Name});
+      Lock.lock();
     }
-    if (IsEmpty)
-      emitTUStatus({TUAction::Idle, /*Name*/ ""});
-    RequestsCV.notify_all();
+    WithContext Guard(std::move(Req.Ctx));
+    trace::Span Tracer(Req.Name);
+    RequestAccounting Accounting(Req.Name, Req.AddTime, Tracer);
+    emitTUStatus({TUAction::RunningAction, Req.Name});
+    Req.Action();
+  }
+
+  bool IsEmpty = false;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Requests.pop_front();
+    IsEmpty = Requests.empty();
+  }
+  if (IsEmpty)
+    emitTUStatus({TUAction::Idle, /*Name*/ ""});
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Running = false;
+    wakeLocked();
   }
+  RequestsCV.notify_all();
 }
 
 Deadline ASTWorker::scheduleLocked() {
@@ -693,10 +1299,22 @@ Deadline ASTWorker::scheduleLocked() {
     if (R.UpdateType == None || R.UpdateType == WantDiagnostics::Yes)
       return Deadline::zero();
   // Front request needs to be debounced, so determine when we're ready.
-  Deadline D(Requests.front().AddTime + UpdateDebounce);
+  std::vector<steady_clock::duration> Rebuilds(RebuildTimes.begin(),
+                                               RebuildTimes.end());
+  std::vector<steady_clock::duration> Intervals(UpdateIntervals.begin(),
+                                                UpdateIntervals.end());
+  Deadline D(Requests.front().AddTime +
+             UpdateDebounce.compute(Rebuilds, Intervals));
   return D;
 }
 
+void ASTWorker::recordLocked(std::deque<steady_clock::duration> &History,
+                             steady_clock::duration D) {
+  History.push_back(D);
+  if (History.size() > DebounceHistorySize)
+    History.pop_front();
+}
+
 // Returns true if Requests.front() is a dead update that can be skipped.
 bool ASTWorker::shouldSkipHeadLocked() const {
   assert(!Requests.empty());
@@ -726,6 +1344,19 @@ bool ASTWorker::shouldSkipHeadLocked() const {
   llvm_unreachable("Unknown WantDiagnostics");
 }
 
+bool ASTWorker::hasNewerDiagnosticsUpdate() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  // The running task is still at the front of the queue. Like in
+  // shouldSkipHeadLocked(), updates that don't report diagnostics don't take
+  // over the obligation to report them.
+  return Requests.size() > 1 &&
+         std::any_of(std::next(Requests.begin()), Requests.end(),
+                     [](const Request &R) {
+                       return R.UpdateType == WantDiagnostics::Yes ||
+                              R.UpdateType == WantDiagnostics::Auto;
+                     });
+}
+
 bool ASTWorker::blockUntilIdle(Deadline Timeout) const {
   std::unique_lock<std::mutex> Lock(Mutex);
   return wait(Lock, RequestsCV, Timeout, [&] { return Requests.empty(); });
@@ -770,6 +1401,40 @@ unsigned getDefaultAsyncThreadsCount() {
   return HardwareConcurrency;
 }
 
+static DebouncePolicy::clock::duration
+median(llvm::ArrayRef<DebouncePolicy::clock::duration> Durations) {
+  std::vector<DebouncePolicy::clock::duration> Sorted(Durations.begin(),
+                                                      Durations.end());
+  auto Middle = Sorted.begin() + Sorted.size() / 2;
+  std::nth_element(Sorted.begin(), Middle, Sorted.end());
+  return *Middle;
+}
+
+DebouncePolicy::clock::duration
+DebouncePolicy::compute(llvm::ArrayRef<clock::duration> RebuildTimes,
+                        llvm::ArrayRef<clock::duration> UpdateIntervals) const {
+  assert(Min <= Max && "Invalid policy");
+  if (RebuildTimes.empty())
+    return Max; // Haven't built the file yet, be conservative.
+  clock::duration Rebuild = median(RebuildTimes);
+  auto Target = std::chrono::duration_cast<clock::duration>(RebuildRatio *
+                                                              Rebuild);
+  if (!UpdateIntervals.empty()) {
+    clock::duration Interval = median(UpdateIntervals);
+    // Building between keystrokes would mostly produce obsolete diagnostics.
+    if (Interval < Rebuild)
+      Target = std::max(Target, std::chrono::duration_cast<clock::duration>(
+                                    TypingRatio * Interval));
+  }
+  return std::max(Min, std::min(Max, Target));
+}
+
+DebouncePolicy DebouncePolicy::fixed(clock::duration T) {
+  DebouncePolicy P;
+  P.Min = P.Max = T;
+  return P;
+}
+
 FileStatus TUStatus::render(PathRef File) const {
   FileStatus FStatus;
   FStatus.uri = URIForFile::canonicalize(File, /*TUPath=*/File);
@@ -778,27 +1443,29 @@ FileStatus TUStatus::render(PathRef File) const {
 }
 
 struct TUScheduler::FileData {
-  /// Latest inputs, passed to TUScheduler::update().
+  /// Latest contents, passed to TUScheduler::update(). The compile command may
+  /// only be known by the worker, see ParseInputs::GetCompileCommand.
   std::string Contents;
-  tooling::CompileCommand Command;
   ASTWorkerHandle Worker;
 };
 
 TUScheduler::TUScheduler(unsigned AsyncThreadsCount,
                          bool StorePreamblesInMemory,
                          std::unique_ptr<ParsingCallbacks> Callbacks,
-                         std::chrono::steady_clock::duration UpdateDebounce,
+                         DebouncePolicy UpdateDebounce,
                          ASTRetentionPolicy RetentionPolicy)
     : StorePreamblesInMemory(StorePreamblesInMemory),
       PCHOps(std::make_shared<PCHContainerOperations>()),
       Callbacks(Callbacks ? move(Callbacks)
                           : llvm::make_unique<ParsingCallbacks>()),
-      Barrier(AsyncThreadsCount),
-      IdleASTs(llvm::make_unique<ASTCache>(RetentionPolicy.MaxRetainedASTs)),
+      Barrier(std::make_shared<Semaphore>(AsyncThreadsCount)),
+      IdleASTs(llvm::make_unique<ASTCache>(RetentionPolicy)),
+      ClosedPreambles(llvm::make_unique<PreambleCache>(
+          RetentionPolicy.MaxRetainedPreambleBytes)),
       UpdateDebounce(UpdateDebounce) {
   if (0 < AsyncThreadsCount) {
     PreambleTasks.emplace();
-    WorkerThreads.emplace();
+    Workers = llvm::make_unique<WorkerPool>(AsyncThreadsCount);
   }
 }
 
@@ -809,8 +1476,11 @@ TUScheduler::~TUScheduler() {
   // Wait for all in-flight tasks to finish.
   if (PreambleTasks)
     PreambleTasks->wait();
-  if (WorkerThreads)
-    WorkerThreads->wait();
+  Workers.reset();
+}
+
+std::shared_ptr<Semaphore> TUScheduler::concurrencyLimit() const {
+  return PreambleTasks ? Barrier : nullptr;
 }
 
 bool TUScheduler::blockUntilIdle(Deadline D) const {
@@ -829,22 +1499,82 @@ void TUScheduler::update(PathRef File, ParseInputs Inputs,
   if (!FD) {
     // Create a new worker to process the AST-related tasks.
     ASTWorkerHandle Worker = ASTWorker::create(
-        File, *IdleASTs, WorkerThreads ? WorkerThreads.getPointer() : nullptr,
-        Barrier, UpdateDebounce, PCHOps, StorePreamblesInMemory, *Callbacks);
-    FD = std::unique_ptr<FileData>(new FileData{
-        Inputs.Contents, Inputs.CompileCommand, std::move(Worker)});
+        File, *IdleASTs, Workers.get(), *Barrier, UpdateDebounce, PCHOps,
+        StorePreamblesInMemory, *Callbacks, ClosedPreambles->take(File));
+    FD = std::unique_ptr<FileData>(
+        new FileData{Inputs.Contents, std::move(Worker)});
+    std::lock_guard<std::mutex> Lock(PrebuildMutex);
+    OpenFiles.insert(File);
   } else {
     FD->Contents = Inputs.Contents;
-    FD->Command = Inputs.CompileCommand;
   }
   FD->Worker->update(std::move(Inputs), WantDiags);
 }
 
+void TUScheduler::setVisibleRange(PathRef File, llvm::Optional<Range> Visible) {
+  auto It = Files.find(File);
+  if (It == Files.end()) {
+    elog("Trying to set the visible range of a file that is not tracked: {0}",
+         File);
+    return;
+  }
+  It->second->Worker->setVisibleRange(Visible);
+}
+
 void TUScheduler::remove(PathRef File) {
-  bool Removed = Files.erase(File);
-  if (!Removed)
+  auto It = Files.find(File);
+  if (It == Files.end()) {
     elog("Trying to remove file from TUScheduler that is not tracked: {0}",
          File);
+    return;
+  }
+  if (auto Preamble = It->second->Worker->getPossiblyStalePreamble())
+    ClosedPreambles->put(File, std::move(Preamble));
+  Files.erase(It);
+  std::lock_guard<std::mutex> Lock(PrebuildMutex);
+  OpenFiles.erase(File);
+}
+
+void TUScheduler::prebuildPreamble(PathRef File, ParseInputs Inputs) {
+  if (!PreambleTasks || ClosedPreambles->contains(File))
+    return;
+  {
+    std::lock_guard<std::mutex> Lock(PrebuildMutex);
+    // The worker of an open file already builds its preamble. These are only
+    // guesses, don't queue up too many of them.
+    if (OpenFiles.count(File) ||
+        PendingPrebuilds.size() >= MaxPendingPrebuilds ||
+        !PendingPrebuilds.insert(File).second)
+      return;
+  }
+  auto Task = [this](std::string File, ParseInputs Inputs) {
+    auto Done = llvm::make_scope_exit([&] {
+      std::lock_guard<std::mutex> Lock(PrebuildMutex);
+      PendingPrebuilds.erase(File);
+    });
+    // Only use slots that foreground work leaves idle.
+    Barrier->lockIdle();
+    auto ReleaseSlot = llvm::make_scope_exit([&] { Barrier->unlockIdle(); });
+    {
+      // The file may have been opened while this waited.
+      std::lock_guard<std::mutex> Lock(PrebuildMutex);
+      if (OpenFiles.count(File))
+        return;
+    }
+    setCurrentThreadPriority(ThreadPriority::Low);
+    auto Invocation = buildCompilerInvocation(Inputs);
+    if (!Invocation)
+      return;
+    trace::Span Tracer("PrebuildPreamble");
+    SPAN_ATTACH(Tracer, "file", File);
+    if (auto Preamble = buildPreamble(File, *Invocation, /*OldPreamble=*/nullptr,
+                                      Inputs.CompileCommand, Inputs, PCHOps,
+                                      StorePreamblesInMemory,
+                                      /*PreambleCallback=*/nullptr))
+      ClosedPreambles->put(File, std::move(Preamble), /*Speculative=*/true);
+  };
+  PreambleTasks->runAsync("prebuild:" + llvm::sys::path::filename(File),
+                          Bind(Task, std::string(File), std::move(Inputs)));
 }
 
 void TUScheduler::run(llvm::StringRef Name,
@@ -883,7 +1613,8 @@ void TUScheduler::runWithPreamble(
     SPAN_ATTACH(Tracer, "file", File);
     std::shared_ptr<const PreambleData> Preamble =
         It->second->Worker->getPossiblyStalePreamble();
-    Action(InputsAndPreamble{It->second->Contents, It->second->Command,
+    Action(InputsAndPreamble{It->second->Contents,
+                             It->second->Worker->getCurrentCompileCommand(),
                              Preamble.get()});
     return;
   }
@@ -903,8 +1634,8 @@ void TUScheduler::runWithPreamble(
 
   std::shared_ptr<const ASTWorker> Worker = It->second->Worker.lock();
   auto Task = [Worker, this](std::string Name, std::string File,
-                             std::string Contents,
-                             tooling::CompileCommand Command, Context Ctx,
+                             std::string Contents, Context Ctx,
+                             steady_clock::time_point AddTime,
                              decltype(ConsistentPreamble) ConsistentPreamble,
                              decltype(Action) Action) mutable {
     std::shared_ptr<const PreambleData> Preamble;
@@ -918,19 +1649,23 @@ void TUScheduler::runWithPreamble(
       Preamble = Worker->getPossiblyStalePreamble();
     }
 
-    std::lock_guard<Semaphore> BarrierLock(Barrier);
+    // The worker started building the preamble, so it knows the command.
+    tooling::CompileCommand Command = Worker->getCurrentCompileCommand();
+
+    std::lock_guard<Semaphore> BarrierLock(*Barrier);
     WithContext Guard(std::move(Ctx));
     trace::Span Tracer(Name);
     SPAN_ATTACH(Tracer, "file", File);
+    RequestAccounting Accounting(Name, AddTime, Tracer);
     Action(InputsAndPreamble{Contents, Command, Preamble.get()});
   };
 
   PreambleTasks->runAsync(
       "task:" + llvm::sys::path::filename(File),
       Bind(Task, std::string(Name), std::string(File), It->second->Contents,
-           It->second->Command,
            Context::current().derive(kFileBeingProcessed, File),
-           std::move(ConsistentPreamble), std::move(Action)));
+           steady_clock::now(), std::move(ConsistentPreamble),
+           std::move(Action)));
 }
 
 std::vector<std::pair<Path, std::size_t>>
@@ -943,6 +1678,11 @@ TUScheduler::getUsedBytesPerFile() const {
   return Result;
 }
 
+void TUScheduler::profile(MemoryTree &MT) const {
+  for (const auto &PathAndFile : Files)
+    PathAndFile.second->Worker->profile(MT.child(PathAndFile.first()));
+}
+
 std::vector<Path> TUScheduler::getFilesWithCachedAST() const {
   std::vector<Path> Result;
   for (auto &&PathAndFile : Files) {
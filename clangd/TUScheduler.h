@@ -11,9 +11,13 @@
 
 #include "ClangdUnit.h"
 #include "Function.h"
+#include "MemoryTree.h"
 #include "Threading.h"
 #include "index/CanonicalIncludes.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include <chrono>
 #include <future>
 
 namespace clang {
@@ -50,6 +54,14 @@ struct ASTRetentionPolicy {
   /// Maximum number of ASTs to be retained in memory when there are no pending
   /// requests for them.
   unsigned MaxRetainedASTs = 3;
+  /// Maximum total size of the ASTs retained in memory, as reported by
+  /// ParsedAST::getUsedBytes(). Least recently used ASTs are evicted first.
+  /// Zero means there is no limit besides MaxRetainedASTs.
+  std::size_t MaxRetainedASTBytes = 0;
+  /// Maximum total size of the preambles of closed files, which are retained
+  /// so that reopening a file can reuse its preamble if it's still valid.
+  /// Preambles stored on disk count towards this limit too.
+  std::size_t MaxRetainedPreambleBytes = 512 * 1024 * 1024;
 };
 
 struct TUAction {
@@ -113,6 +125,34 @@ public:
   virtual void onFileUpdated(PathRef File, const TUStatus &Status) {}
 };
 
+/// Determines how long to wait after an update before building the AST, so that
+/// a newer update can make it unnecessary.
+/// Files that build fast get diagnostics sooner, while slow files, and bursts
+/// of typing, are debounced for longer.
+struct DebouncePolicy {
+  using clock = std::chrono::steady_clock;
+
+  /// The debounce is never shorter than this.
+  clock::duration Min = std::chrono::milliseconds(50);
+  /// The debounce is never longer than this. Also used until the file has been
+  /// built once.
+  clock::duration Max = std::chrono::milliseconds(500);
+  /// Target debounce, as a fraction of the time the file takes to rebuild.
+  float RebuildRatio = 1;
+  /// While updates come faster than the file rebuilds, wait this many times
+  /// the interval between them, so the build starts after a pause in typing.
+  float TypingRatio = 2;
+
+  /// Computes the debounce from recent rebuild times, and recent intervals
+  /// between updates.
+  clock::duration
+  compute(llvm::ArrayRef<clock::duration> RebuildTimes,
+          llvm::ArrayRef<clock::duration> UpdateIntervals) const;
+
+  /// A policy that always debounces for \p T.
+  static DebouncePolicy fixed(clock::duration T);
+};
+
 /// Handles running tasks for ClangdServer and managing the resources (e.g.,
 /// preambles and ASTs) for opened files.
 /// TUScheduler is not thread-safe, only one thread should be providing updates
@@ -124,7 +164,7 @@ class TUScheduler {
 public:
   TUScheduler(unsigned AsyncThreadsCount, bool StorePreamblesInMemory,
               std::unique_ptr<ParsingCallbacks> ASTCallbacks,
-              std::chrono::steady_clock::duration UpdateDebounce,
+              DebouncePolicy UpdateDebounce,
               ASTRetentionPolicy RetentionPolicy);
   ~TUScheduler();
 
@@ -132,6 +172,10 @@ public:
   /// The order of results is unspecified.
   std::vector<std::pair<Path, std::size_t>> getUsedBytesPerFile() const;
 
+  /// Adds the memory used by each open file to \p MT: its cached AST,
+  /// preamble and preamble stat cache.
+  void profile(MemoryTree &MT) const;
+
   /// Returns a list of files with ASTs currently stored in memory. This method
   /// is not very reliable and is only used for test. E.g., the results will not
   /// contain files that currently run something over their AST.
@@ -149,6 +193,12 @@ public:
   /// if requested with WantDiags::Auto or WantDiags::Yes.
   void remove(PathRef File);
 
+  /// Sets the range of \p File visible in the editor, or clears it. While it's
+  /// set, updates first publish the diagnostics of the visible range from a
+  /// parse skipping the other function bodies, then those of the whole file.
+  /// The full parse is skipped if another update is already queued.
+  void setVisibleRange(PathRef File, llvm::Optional<Range> Visible);
+
   /// Schedule an async task with no dependencies.
   void run(llvm::StringRef Name, llvm::unique_function<void()> Action);
 
@@ -189,6 +239,13 @@ public:
                        PreambleConsistency Consistency,
                        Callback<InputsAndPreamble> Action);
 
+  /// Speculatively builds the preamble of a file that is likely to be opened
+  /// soon, using only otherwise idle threads (see Semaphore::lockIdle()). The
+  /// preamble is reused when the file is opened, if it's still valid.
+  /// Unlike other methods, this is threadsafe. It's a no-op when running tasks
+  /// synchronously, if \p File is open or if too many prebuilds are pending.
+  void prebuildPreamble(PathRef File, ParseInputs Inputs);
+
   /// Wait until there are no scheduled or running tasks.
   /// Mostly useful for synchronizing tests.
   bool blockUntilIdle(Deadline D) const;
@@ -201,6 +258,10 @@ public:
   /// Responsible for retaining and rebuilding idle ASTs. An implementation is
   /// an LRU cache.
   class ASTCache;
+  /// Retains preambles of closed files. An implementation is an LRU cache.
+  class PreambleCache;
+  /// Runs the requests of all open files on a fixed set of threads.
+  class WorkerPool;
 
   // The file being built/processed in the current thread. This is a hack in
   // order to get the file name into the index implementations. Do not depend on
@@ -209,18 +270,29 @@ public:
   // integration.
   static llvm::Optional<llvm::StringRef> getFileBeingProcessedInContext();
 
+  /// Limits the number of ASTs and preambles built at the same time, for
+  /// sharing the limit with background work (see Semaphore::lockIdle()).
+  /// Null when running tasks synchronously.
+  std::shared_ptr<Semaphore> concurrencyLimit() const;
+
 private:
   const bool StorePreamblesInMemory;
   const std::shared_ptr<PCHContainerOperations> PCHOps;
   std::unique_ptr<ParsingCallbacks> Callbacks; // not nullptr
-  Semaphore Barrier;
+  std::shared_ptr<Semaphore> Barrier; // not nullptr
   llvm::StringMap<std::unique_ptr<FileData>> Files;
   std::unique_ptr<ASTCache> IdleASTs;
+  std::unique_ptr<PreambleCache> ClosedPreambles;
+  static constexpr unsigned MaxPendingPrebuilds = 4;
+  std::mutex PrebuildMutex;
+  llvm::StringSet<> PendingPrebuilds; /* GUARDED_BY(PrebuildMutex) */
+  // The keys of Files, for prebuildPreamble() on other threads.
+  llvm::StringSet<> OpenFiles; /* GUARDED_BY(PrebuildMutex) */
   // None when running tasks synchronously and non-None when running tasks
   // asynchronously.
   llvm::Optional<AsyncTaskRunner> PreambleTasks;
-  llvm::Optional<AsyncTaskRunner> WorkerThreads;
-  std::chrono::steady_clock::duration UpdateDebounce;
+  std::unique_ptr<WorkerPool> Workers;
+  DebouncePolicy UpdateDebounce;
 };
 
 /// Runs \p Action asynchronously with a new std::thread. The context will be
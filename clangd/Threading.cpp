@@ -1,5 +1,6 @@
 #include "Threading.h"
 #include "Trace.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Threading.h"
@@ -46,9 +47,13 @@ void Semaphore::lock() {
   // happens when Semaphore's own lock is not held.
   {
     std::unique_lock<std::mutex> Lock(Mutex);
+    ++Waiting;
     SlotsChanged.wait(Lock, [&]() { return FreeSlots > 0; });
+    --Waiting;
     --FreeSlots;
   }
+  // Idle lockers may be waiting for us to stop waiting.
+  SlotsChanged.notify_all();
 }
 
 void Semaphore::unlock() {
@@ -56,9 +61,89 @@ void Semaphore::unlock() {
   ++FreeSlots;
   Lock.unlock();
 
-  SlotsChanged.notify_one();
+  // Wake all waiters: lock() and lockIdle() wait for different conditions.
+  SlotsChanged.notify_all();
 }
 
+void Semaphore::lockIdle() {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  SlotsChanged.wait(Lock, [&]() { return Waiting == 0 && FreeSlots > 0; });
+  --FreeSlots;
+}
+
+void Semaphore::unlockIdle() { unlock(); }
+
+namespace {
+// Idle workers beyond this number exit right away.
+constexpr unsigned MaxIdleWorkers = 16;
+// Idle workers exit after this long without a task.
+constexpr std::chrono::seconds WorkerIdleTimeout(30);
+
+// Threads that run AsyncTaskRunner tasks and wait for the next one when done.
+// Tasks must start right away: ASTWorkers run for as long as their file is
+// open, so a new worker is started whenever none is idle. Reusing workers
+// saves creating a thread for each short task.
+class WorkerCache {
+public:
+  static WorkerCache &instance() {
+    // Leaked: workers may still be running when static destructors run.
+    static WorkerCache *Cache = new WorkerCache;
+    return *Cache;
+  }
+
+  void run(std::string Name, llvm::unique_function<void()> Task) {
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      Queue.push_back({std::move(Name), std::move(Task)});
+      if (Queue.size() <= Idle) {
+        TaskAdded.notify_one();
+        return;
+      }
+    }
+    std::thread([this] { work(); }).detach();
+  }
+
+private:
+  struct QueuedTask {
+    std::string Name;
+    llvm::unique_function<void()> Run;
+  };
+
+  void work() {
+    std::unique_lock<std::mutex> Lock(Mu);
+    while (true) {
+      // The worker is started for a task, so the queue is only empty once it
+      // has been idle.
+      if (Queue.empty()) {
+        if (Idle >= MaxIdleWorkers)
+          return;
+        ++Idle;
+        bool HasTask = TaskAdded.wait_for(Lock, WorkerIdleTimeout,
+                                          [&] { return !Queue.empty(); });
+        --Idle;
+        if (!HasTask)
+          return;
+      }
+      QueuedTask Task = std::move(Queue.front());
+      Queue.pop_front();
+      Lock.unlock();
+      llvm::set_thread_name(Task.Name);
+      Task.Run();
+      // Release the task's state (e.g. its completion notification) before
+      // waiting for the next one.
+      Task.Run = nullptr;
+      setCurrentThreadPriority(ThreadPriority::Normal);
+      Lock.lock();
+    }
+  }
+
+  std::mutex Mu;
+  std::condition_variable TaskAdded;
+  std::deque<QueuedTask> Queue;
+  unsigned Idle = 0; // Workers waiting for a task.
+};
+} // namespace
+
 AsyncTaskRunner::~AsyncTaskRunner() { wait(); }
 
 bool AsyncTaskRunner::wait(Deadline D) const {
@@ -84,16 +169,115 @@ void AsyncTaskRunner::runAsync(const llvm::Twine &Name,
     }
   });
 
-  std::thread(
-      [](std::string Name, decltype(Action) Action, decltype(CleanupTask)) {
-        llvm::set_thread_name(Name);
-        Action();
-        // Make sure function stored by Action is destroyed before CleanupTask
-        // is run.
-        Action = nullptr;
-      },
-      Name.str(), std::move(Action), std::move(CleanupTask))
-      .detach();
+  WorkerCache::instance().run(
+      Name.str(), Bind(
+                      [](decltype(Action) Action, decltype(CleanupTask)) {
+                        Action();
+                        // Make sure function stored by Action is destroyed
+                        // before CleanupTask is run.
+                        Action = nullptr;
+                      },
+                      std::move(Action), std::move(CleanupTask)));
+}
+
+TaskPool::TaskPool(std::size_t NumThreads, std::shared_ptr<Semaphore> Limit)
+    : Limit(std::move(Limit)) {
+  assert(NumThreads > 0 && "Thread pool size can't be zero.");
+  while (NumThreads--)
+    Workers.emplace_back([this] { run(); });
+}
+
+TaskPool::~TaskPool() {
+  stop();
+  for (auto &Worker : Workers)
+    Worker.join();
+}
+
+void TaskPool::stop() {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    ShouldStop = true;
+  }
+  QueueChanged.notify_all();
+}
+
+void TaskPool::run() {
+  while (true) {
+    llvm::unique_function<void()> Task;
+    ThreadPriority Priority;
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      QueueChanged.wait(Lock, [&] { return ShouldStop || !Queue.empty(); });
+      if (ShouldStop) {
+        Queue.clear();
+        QueueChanged.notify_all();
+        return;
+      }
+      ++NumActiveTasks;
+      Task = std::move(Queue.front().Run);
+      Priority = Queue.front().Priority;
+      Queue.pop_front();
+    }
+
+    if (Priority != ThreadPriority::Normal) {
+      if (Limit)
+        Limit->lockIdle();
+      setCurrentThreadPriority(Priority);
+    }
+    Task();
+    if (Priority != ThreadPriority::Normal) {
+      setCurrentThreadPriority(ThreadPriority::Normal);
+      if (Limit)
+        Limit->unlockIdle();
+    }
+
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      assert(NumActiveTasks > 0 && "before decrementing");
+      --NumActiveTasks;
+    }
+    QueueChanged.notify_all();
+  }
+}
+
+bool TaskPool::blockUntilIdle(Deadline D) const {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  return wait(Lock, QueueChanged, D,
+              [&] { return Queue.empty() && NumActiveTasks == 0; });
+}
+
+size_t TaskPool::pendingTasks() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Queue.size();
+}
+
+void TaskPool::enqueue(llvm::unique_function<void()> Task,
+                       ThreadPriority Priority, llvm::StringRef Tag) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto I = Queue.end();
+    // We first store the tasks with Normal priority in the front of the queue.
+    // Then we store low priority tasks. Normal priority tasks are pretty rare,
+    // they should not grow beyond single-digit numbers, so it is OK to do
+    // linear search and insert after that.
+    if (Priority == ThreadPriority::Normal) {
+      I = llvm::find_if(Queue, [](const QueuedTask &Elem) {
+        return Elem.Priority == ThreadPriority::Low;
+      });
+    }
+    Queue.insert(I, {std::move(Task), Priority, Tag.str()});
+  }
+  QueueChanged.notify_all();
+}
+
+void TaskPool::boost(llvm::StringRef Tag) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto FirstLow = llvm::find_if(Queue, [](const QueuedTask &Elem) {
+    return Elem.Priority == ThreadPriority::Low;
+  });
+  std::stable_partition(FirstLow, Queue.end(), [&](const QueuedTask &Elem) {
+    return Elem.Tag == Tag;
+  });
 }
 
 Deadline timeoutSeconds(llvm::Optional<double> Seconds) {
@@ -14,8 +14,10 @@
 #include "llvm/ADT/Twine.h"
 #include <cassert>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -37,6 +39,11 @@ private:
 };
 
 /// Limits the number of threads that can acquire the lock at the same time.
+///
+/// Background work can also run in slots that are left idle: lockIdle() takes
+/// a slot like lock(), but only once no thread is waiting in lock(). So
+/// background work never overtakes foreground work, and the limit holds for
+/// both.
 class Semaphore {
 public:
   Semaphore(std::size_t MaxLocks);
@@ -45,10 +52,14 @@ public:
   void lock();
   void unlock();
 
+  void lockIdle();
+  void unlockIdle();
+
 private:
   std::mutex Mutex;
   std::condition_variable SlotsChanged;
   std::size_t FreeSlots;
+  std::size_t Waiting = 0; // Number of threads blocked in lock().
 };
 
 /// A point in time we can wait for.
@@ -98,9 +109,11 @@ LLVM_NODISCARD bool wait(std::unique_lock<std::mutex> &Lock,
   return true;
 }
 
-/// Runs tasks on separate (detached) threads and wait for all tasks to finish.
+/// Runs tasks on separate threads and wait for all tasks to finish.
 /// Objects that need to spawn threads can own an AsyncTaskRunner to ensure they
 /// all complete on destruction.
+/// Each task starts right away, on a process-wide cache of worker threads.
+/// Workers that finished a task are reused before new ones are started.
 class AsyncTaskRunner {
 public:
   /// Destructor waits for all pending tasks to finish.
@@ -127,6 +140,48 @@ void setCurrentThreadPriority(ThreadPriority Priority);
 // Affects subsequent setThreadPriority() calls.
 void preventThreadStarvationInTests();
 
+/// Runs tasks on a fixed number of worker threads. Tasks with normal priority
+/// run before any task with low priority, and low priority tasks run on a
+/// thread with low priority.
+/// If \p Limit is set, low priority tasks only run in its idle slots (see
+/// Semaphore::lockIdle()), so they share a concurrency cap with, and yield to,
+/// the foreground work using it.
+class TaskPool {
+public:
+  TaskPool(std::size_t NumThreads, std::shared_ptr<Semaphore> Limit = nullptr);
+  /// Discards pending tasks and waits for the running ones to finish.
+  ~TaskPool();
+
+  /// \p Tag identifies related tasks, see boost().
+  void enqueue(llvm::unique_function<void()> Task, ThreadPriority Priority,
+               llvm::StringRef Tag = "");
+  /// Moves the pending low priority tasks with \p Tag ahead of the other low
+  /// priority tasks, keeping their relative order.
+  void boost(llvm::StringRef Tag);
+  /// Makes workers exit after their current task. Pending tasks are discarded.
+  void stop();
+  /// Waits until there are no pending or running tasks.
+  LLVM_NODISCARD bool blockUntilIdle(Deadline D) const;
+  /// Returns the number of tasks that haven't started yet.
+  size_t pendingTasks() const;
+
+private:
+  void run(); // Main loop executed by each worker.
+
+  std::shared_ptr<Semaphore> Limit;
+  mutable std::mutex Mutex;
+  mutable std::condition_variable QueueChanged;
+  bool ShouldStop = false;
+  unsigned NumActiveTasks = 0; // Only idle when queue is empty *and* no tasks.
+  struct QueuedTask {
+    llvm::unique_function<void()> Run;
+    ThreadPriority Priority;
+    std::string Tag;
+  };
+  std::deque<QueuedTask> Queue;
+  std::vector<std::thread> Workers;
+};
+
 } // namespace clangd
 } // namespace clang
 #endif
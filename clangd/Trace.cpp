@@ -9,13 +9,20 @@
 #include "Trace.h"
 #include "Context.h"
 #include "Function.h"
+#include "Threading.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Chrono.h"
 #include "llvm/Support/FormatProviders.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Threading.h"
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
 #include <mutex>
 
 namespace clang {
@@ -186,6 +193,409 @@ private:
 
 Key<std::unique_ptr<JSONTracer::JSONSpan>> JSONTracer::SpanKey;
 
+// The binary trace format is a header followed by chunks of events, each
+// holding consecutive events of one thread. Integers use native byte order.
+//  - Header: BinaryTraceMagic.
+//  - Chunk: u64 thread ID, u32 size in bytes, events.
+//  - Event: u8 kind, u64 nanoseconds since the start of the trace, then
+//      for BeginSpan: name (u16 length, bytes),
+//      for Instant: name, message,
+//      for ThreadName: name.
+const char BinaryTraceMagic[] = {'C', 'D', 'T', '1'};
+enum BinaryEventKind : uint8_t { BeginSpan, EndSpan, Instant, ThreadName };
+
+template <typename T> void appendBinary(std::vector<char> &Out, T V) {
+  const char *Bytes = reinterpret_cast<const char *>(&V);
+  Out.insert(Out.end(), Bytes, Bytes + sizeof(V));
+}
+
+void appendBinary(std::vector<char> &Out, llvm::StringRef S) {
+  uint16_t Len = std::min<size_t>(S.size(), UINT16_MAX);
+  appendBinary(Out, Len);
+  Out.insert(Out.end(), S.begin(), S.begin() + Len);
+}
+
+template <typename T> bool consumeBinary(llvm::StringRef &Data, T &V) {
+  if (Data.size() < sizeof(V))
+    return false;
+  std::memcpy(&V, Data.data(), sizeof(V));
+  Data = Data.drop_front(sizeof(V));
+  return true;
+}
+
+bool consumeBinary(llvm::StringRef &Data, llvm::StringRef &S) {
+  uint16_t Len;
+  if (!consumeBinary(Data, Len) || Data.size() < Len)
+    return false;
+  S = Data.take_front(Len);
+  Data = Data.drop_front(Len);
+  return true;
+}
+
+// Recording an event appends a few bytes to a buffer owned by the thread, no
+// locks or formatting involved. Full buffers are queued (taking a lock once
+// per ChunkSize bytes) and written to Out by a background thread.
+class BinaryTracer : public EventTracer {
+public:
+  BinaryTracer(llvm::raw_ostream &Out)
+      : Out(Out), ID(++LastID), Start(std::chrono::steady_clock::now()) {
+    Out.write(BinaryTraceMagic, sizeof(BinaryTraceMagic));
+    Writer.runAsync("trace-writer", [this] { writeChunks(); });
+  }
+
+  // No events may be recorded concurrently with the destructor.
+  ~BinaryTracer() {
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      for (auto &Buf : Buffers)
+        if (!Buf->Data.empty())
+          Queue.push_back(std::move(*Buf));
+      ShuttingDown = true;
+    }
+    QueueChanged.notify_one();
+    Writer.wait();
+    Out.flush();
+  }
+
+  Context beginSpan(llvm::StringRef Name, llvm::json::Object *Args) override {
+    Chunk &Buf = buffer();
+    appendBinary(Buf.Data, BeginSpan);
+    appendBinary(Buf.Data, timestamp());
+    appendBinary(Buf.Data, Name);
+    maybeFlush(Buf);
+    return Context::current().clone();
+  }
+
+  // beginSpan() and endSpan() nest properly on each thread, so the end of a
+  // span is enough to match it with its beginning.
+  void endSpan() override {
+    Chunk &Buf = buffer();
+    appendBinary(Buf.Data, EndSpan);
+    appendBinary(Buf.Data, timestamp());
+    maybeFlush(Buf);
+  }
+
+  void instant(llvm::StringRef Name, llvm::json::Object &&Args) override {
+    Chunk &Buf = buffer();
+    appendBinary(Buf.Data, Instant);
+    appendBinary(Buf.Data, timestamp());
+    appendBinary(Buf.Data, Name);
+    llvm::StringRef Message;
+    if (auto M = Args.getString("Message"))
+      Message = *M;
+    appendBinary(Buf.Data, Message);
+    maybeFlush(Buf);
+  }
+
+private:
+  struct Chunk {
+    uint64_t TID;
+    std::vector<char> Data;
+  };
+  static constexpr size_t ChunkSize = 64 * 1024;
+
+  // Returns the buffer of the current thread, creating it if needed.
+  Chunk &buffer() {
+    // Identify the tracer by ID rather than address, which may be reused.
+    thread_local uint64_t CachedID = 0;
+    thread_local Chunk *Cached = nullptr;
+    if (CachedID == ID)
+      return *Cached;
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      Buffers.push_back(llvm::make_unique<Chunk>());
+      Cached = Buffers.back().get();
+    }
+    CachedID = ID;
+    Cached->TID = llvm::get_threadid();
+    Cached->Data.reserve(ChunkSize);
+    llvm::SmallString<32> Name;
+    llvm::get_thread_name(Name);
+    if (!Name.empty()) {
+      appendBinary(Cached->Data, ThreadName);
+      appendBinary(Cached->Data, timestamp());
+      appendBinary(Cached->Data, Name.str());
+    }
+    return *Cached;
+  }
+
+  void maybeFlush(Chunk &Buf) {
+    if (Buf.Data.size() < ChunkSize)
+      return;
+    Chunk Full{Buf.TID, {}};
+    Full.Data.reserve(ChunkSize);
+    std::swap(Full.Data, Buf.Data);
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      Queue.push_back(std::move(Full));
+    }
+    QueueChanged.notify_one();
+  }
+
+  // Runs on the Writer thread until the tracer is destroyed.
+  void writeChunks() {
+    std::unique_lock<std::mutex> Lock(Mu);
+    while (true) {
+      QueueChanged.wait(Lock, [&] { return ShuttingDown || !Queue.empty(); });
+      if (Queue.empty())
+        return;
+      std::vector<Chunk> Pending;
+      std::swap(Pending, Queue);
+      Lock.unlock();
+      for (const Chunk &C : Pending) {
+        uint32_t Size = C.Data.size();
+        Out.write(reinterpret_cast<const char *>(&C.TID), sizeof(C.TID));
+        Out.write(reinterpret_cast<const char *>(&Size), sizeof(Size));
+        Out.write(C.Data.data(), C.Data.size());
+      }
+      Lock.lock();
+    }
+  }
+
+  uint64_t timestamp() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now() - Start).count();
+  }
+
+  static std::atomic<uint64_t> LastID;
+
+  llvm::raw_ostream &Out; // Only used by the Writer thread.
+  const uint64_t ID;
+  const std::chrono::steady_clock::time_point Start;
+  std::mutex Mu;
+  std::condition_variable QueueChanged;
+  std::vector<std::unique_ptr<Chunk>> Buffers; // GUARDED_BY(Mu)
+  std::vector<Chunk> Queue;                    // GUARDED_BY(Mu)
+  bool ShuttingDown = false;                   // GUARDED_BY(Mu)
+  AsyncTaskRunner Writer;
+};
+
+constexpr size_t BinaryTracer::ChunkSize;
+std::atomic<uint64_t> BinaryTracer::LastID = {0};
+
+// Decides whether to trace each request when it starts, and stores the
+// decision in the context so it applies to everything the request does.
+class SamplingTracer : public EventTracer {
+public:
+  SamplingTracer(EventTracer &Inner, unsigned Rate)
+      : Inner(Inner), Rate(std::max(Rate, 1u)) {}
+
+  Context beginSpan(llvm::StringRef Name, llvm::json::Object *Args) override {
+    if (const bool *Sampled = Context::current().get(SampledKey))
+      return *Sampled ? Inner.beginSpan(Name, Args)
+                      : Context::current().clone();
+    bool Sample = Requests++ % Rate == 0;
+    WithContextValue WithSampled(SampledKey, Sample);
+    return Sample ? Inner.beginSpan(Name, Args) : Context::current().clone();
+  }
+
+  void endSpan() override {
+    if (sampled())
+      Inner.endSpan();
+  }
+
+  void instant(llvm::StringRef Name, llvm::json::Object &&Args) override {
+    if (sampled())
+      Inner.instant(Name, std::move(Args));
+  }
+
+  // Metrics are aggregates, sampling them would skew them.
+  void record(const Metric &Metric, double Value,
+              llvm::StringRef Label) override {
+    Inner.record(Metric, Value, Label);
+  }
+
+private:
+  static bool sampled() {
+    const bool *Sampled = Context::current().get(SampledKey);
+    return Sampled && *Sampled;
+  }
+
+  static Key<bool> SampledKey;
+  EventTracer &Inner;
+  const unsigned Rate;
+  std::atomic<unsigned> Requests = {0};
+};
+
+Key<bool> SamplingTracer::SampledKey;
+
+// Applies Update to V atomically, for types without fetch_add() & co.
+template <typename T, typename Func>
+void atomicUpdate(std::atomic<T> &V, Func Update) {
+  T Old = V.load(std::memory_order_relaxed);
+  while (!V.compare_exchange_weak(Old, Update(Old), std::memory_order_relaxed))
+    ;
+}
+
+// The aggregated values of a metric with a given label.
+// Distributions are stored as a histogram with exponentially growing buckets,
+// so percentiles have a fixed relative error rather than an absolute one.
+class MetricSeries {
+public:
+  void record(double Value) {
+    Count.fetch_add(1, std::memory_order_relaxed);
+    atomicUpdate(Sum, [&](double S) { return S + Value; });
+    Last.store(Value, std::memory_order_relaxed);
+    atomicUpdate(Min, [&](double M) { return std::min(M, Value); });
+    atomicUpdate(Max, [&](double M) { return std::max(M, Value); });
+    Buckets[bucket(Value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  llvm::json::Object snapshot(Metric::MetricType Type) const {
+    switch (Type) {
+    case Metric::Value:
+      return llvm::json::Object{{"value", Last.load()}};
+    case Metric::Counter:
+      return llvm::json::Object{{"total", Sum.load()}};
+    case Metric::Distribution:
+      break;
+    }
+    uint64_t N = Count.load();
+    llvm::json::Object Result{{"count", int64_t(N)}};
+    if (N) {
+      Result["mean"] = Sum.load() / N;
+      Result["min"] = Min.load();
+      Result["max"] = Max.load();
+      Result["p50"] = percentile(0.5, N);
+      Result["p90"] = percentile(0.9, N);
+      Result["p99"] = percentile(0.99, N);
+    }
+    return Result;
+  }
+
+private:
+  // Buckets cover [2^MinExponent, 2^MaxExponent), BucketsPerOctave per power
+  // of 2. Values outside the range go to the first or the last bucket.
+  static constexpr int MinExponent = -10, MaxExponent = 30;
+  static constexpr int BucketsPerOctave = 4;
+  static constexpr int NumBuckets =
+      (MaxExponent - MinExponent) * BucketsPerOctave;
+
+  static int bucket(double Value) {
+    if (!(Value > 0)) // Also catches NaN.
+      return 0;
+    int B = std::floor((std::log2(Value) - MinExponent) * BucketsPerOctave);
+    return std::max(0, std::min(B, NumBuckets - 1));
+  }
+
+  // Returns the upper bound of the bucket containing the percentile, clamped
+  // to the observed range.
+  double percentile(double P, uint64_t N) const {
+    uint64_t Rank = std::ceil(P * N), Seen = 0;
+    for (int B = 0; B < NumBuckets; ++B) {
+      Seen += Buckets[B].load(std::memory_order_relaxed);
+      if (Seen >= Rank) {
+        double Upper =
+            std::exp2(MinExponent + double(B + 1) / BucketsPerOctave);
+        return std::max(Min.load(), std::min(Max.load(), Upper));
+      }
+    }
+    return Max.load();
+  }
+
+  std::atomic<uint64_t> Count = {0};
+  std::atomic<double> Sum = {0};
+  std::atomic<double> Last = {0};
+  std::atomic<double> Min = {std::numeric_limits<double>::infinity()};
+  std::atomic<double> Max = {-std::numeric_limits<double>::infinity()};
+  std::atomic<uint64_t> Buckets[NumBuckets] = {};
+};
+
+class MetricsTracer : public EventTracer {
+public:
+  MetricsTracer(llvm::raw_ostream &Out, std::chrono::milliseconds Period,
+                EventTracer *Inner)
+      : Out(Out), Inner(Inner), Start(std::chrono::steady_clock::now()) {
+    Dumper.runAsync("metrics-dump", [this, Period] {
+      std::unique_lock<std::mutex> Lock(StopMu);
+      while (!StopCV.wait_for(Lock, Period, [this] { return Stop; }))
+        dump();
+    });
+  }
+
+  ~MetricsTracer() {
+    {
+      std::lock_guard<std::mutex> Lock(StopMu);
+      Stop = true;
+    }
+    StopCV.notify_all();
+    Dumper.wait();
+    dump();
+  }
+
+  Context beginSpan(llvm::StringRef Name, llvm::json::Object *Args) override {
+    return Inner ? Inner->beginSpan(Name, Args) : Context::current().clone();
+  }
+
+  void endSpan() override {
+    if (Inner)
+      Inner->endSpan();
+  }
+
+  void instant(llvm::StringRef Name, llvm::json::Object &&Args) override {
+    if (Inner)
+      Inner->instant(Name, std::move(Args));
+  }
+
+  // The lock is only held to find the series, values are recorded lock-free.
+  void record(const Metric &Metric, double Value,
+              llvm::StringRef Label) override {
+    MetricSeries *Series;
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      auto &Data = Metrics[Metric.Name];
+      Data.Type = &Metric;
+      auto &Entry = Data.Series[Label];
+      if (!Entry)
+        Entry = llvm::make_unique<MetricSeries>();
+      Series = Entry.get();
+    }
+    Series->record(Value);
+    if (Inner)
+      Inner->record(Metric, Value, Label);
+  }
+
+private:
+  void dump() {
+    using namespace std::chrono;
+    llvm::json::Array Snapshot;
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      for (const auto &M : Metrics) {
+        for (const auto &S : M.second.Series) {
+          auto Entry = S.second->snapshot(M.second.Type->Type);
+          Entry["name"] = M.first().str();
+          if (!M.second.Type->LabelName.empty())
+            Entry[M.second.Type->LabelName] = S.first().str();
+          Snapshot.push_back(std::move(Entry));
+        }
+      }
+    }
+    double Seconds = duration<double>(steady_clock::now() - Start).count();
+    Out << llvm::json::Value(llvm::json::Object{
+               {"time", Seconds}, {"metrics", std::move(Snapshot)}})
+        << "\n";
+    Out.flush();
+  }
+
+  struct MetricData {
+    const Metric *Type = nullptr;
+    llvm::StringMap<std::unique_ptr<MetricSeries>> Series;
+  };
+
+  llvm::raw_ostream &Out; // Only used by dump().
+  EventTracer *Inner;
+  const std::chrono::steady_clock::time_point Start;
+  std::mutex Mu;
+  llvm::StringMap<MetricData> Metrics; // GUARDED_BY(Mu)
+  std::mutex StopMu;
+  std::condition_variable StopCV;
+  bool Stop = false; // GUARDED_BY(StopMu)
+  AsyncTaskRunner Dumper;
+};
+
+constexpr int MetricSeries::NumBuckets;
+
 EventTracer *T = nullptr;
 } // namespace
 
@@ -201,6 +611,94 @@ std::unique_ptr<EventTracer> createJSONTracer(llvm::raw_ostream &OS,
   return llvm::make_unique<JSONTracer>(OS, Pretty);
 }
 
+std::unique_ptr<EventTracer> createBinaryTracer(llvm::raw_ostream &OS) {
+  return llvm::make_unique<BinaryTracer>(OS);
+}
+
+std::unique_ptr<EventTracer> createSamplingTracer(EventTracer &Tracer,
+                                                  unsigned Rate) {
+  return llvm::make_unique<SamplingTracer>(Tracer, Rate);
+}
+
+llvm::Error binaryTraceToJSON(llvm::StringRef Data, llvm::raw_ostream &OS) {
+  auto Corrupt = [] {
+    return llvm::make_error<llvm::StringError>("Corrupt binary trace",
+                                               llvm::inconvertibleErrorCode());
+  };
+  if (!Data.consume_front(
+          llvm::StringRef(BinaryTraceMagic, sizeof(BinaryTraceMagic))))
+    return Corrupt();
+  llvm::json::Array Events;
+  Events.push_back(llvm::json::Object{
+      {"ph", "M"},
+      {"pid", 0},
+      {"name", "process_name"},
+      {"args", llvm::json::Object{{"name", "clangd"}}},
+  });
+  while (!Data.empty()) {
+    uint64_t TID;
+    uint32_t Size;
+    if (!consumeBinary(Data, TID) || !consumeBinary(Data, Size) ||
+        Data.size() < Size)
+      return Corrupt();
+    llvm::StringRef Chunk = Data.take_front(Size);
+    Data = Data.drop_front(Size);
+    while (!Chunk.empty()) {
+      uint8_t Kind;
+      uint64_t Time;
+      if (!consumeBinary(Chunk, Kind) || !consumeBinary(Chunk, Time))
+        return Corrupt();
+      llvm::json::Object Event{
+          {"pid", 0}, {"tid", int64_t(TID)}, {"ts", Time / 1000.0}};
+      llvm::StringRef Name, Message;
+      switch (Kind) {
+      case BeginSpan:
+        if (!consumeBinary(Chunk, Name))
+          return Corrupt();
+        Event["ph"] = "B";
+        Event["name"] = Name;
+        break;
+      case EndSpan:
+        Event["ph"] = "E";
+        break;
+      case Instant:
+        if (!consumeBinary(Chunk, Name) || !consumeBinary(Chunk, Message))
+          return Corrupt();
+        Event["ph"] = "i";
+        Event["name"] = Name;
+        if (!Message.empty())
+          Event["args"] = llvm::json::Object{{"Message", Message}};
+        break;
+      case ThreadName:
+        if (!consumeBinary(Chunk, Name))
+          return Corrupt();
+        Event["ph"] = "M";
+        Event["name"] = "thread_name";
+        Event["args"] = llvm::json::Object{{"name", Name}};
+        break;
+      default:
+        return Corrupt();
+      }
+      Events.push_back(std::move(Event));
+    }
+  }
+  OS << llvm::json::Value(llvm::json::Object{
+      {"displayTimeUnit", "ns"}, {"traceEvents", std::move(Events)}});
+  return llvm::Error::success();
+}
+
+std::unique_ptr<EventTracer>
+createMetricsTracer(llvm::raw_ostream &OS, std::chrono::milliseconds Period,
+                    EventTracer *Inner) {
+  return llvm::make_unique<MetricsTracer>(OS, Period, Inner);
+}
+
+void Metric::record(double Value, llvm::StringRef Label) const {
+  if (!T)
+    return;
+  T->record(*this, Value, Label);
+}
+
 void log(const llvm::Twine &Message) {
   if (!T)
     return;
@@ -19,14 +19,49 @@
 
 #include "Context.h"
 #include "Function.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/JSON.h"
 #include "llvm/Support/raw_ostream.h"
+#include <chrono>
 
 namespace clang {
 namespace clangd {
 namespace trace {
 
+/// Represents measurements of clangd events, e.g. operation latency. Each
+/// recorded value has a label (e.g. the LSP method of a request latency),
+/// metrics that don't need one use the empty label. Metrics are cheap to
+/// record and usually defined as constants:
+///   constexpr trace::Metric RequestLatency("request_latency",
+///                                          trace::Metric::Distribution,
+///                                          "method_name");
+///   RequestLatency.record(Millis, Method);
+struct Metric {
+  enum MetricType {
+    /// A number whose value is meaningful, and may vary over time.
+    /// Aggregation keeps the last recorded value.
+    Value,
+    /// An aggregate number whose rate of change over time is meaningful.
+    /// Aggregation sums all recorded values.
+    Counter,
+    /// A distribution of values with a meaningful mean and percentiles.
+    Distribution,
+  };
+  constexpr Metric(llvm::StringLiteral Name, MetricType Type,
+                   llvm::StringLiteral LabelName = llvm::StringLiteral(""))
+      : Name(Name), Type(Type), LabelName(LabelName) {}
+
+  /// Records a measurement for this metric to the active tracer, if any.
+  void record(double Value, llvm::StringRef Label = "") const;
+
+  /// Uniquely identifies the metric.
+  const llvm::StringLiteral Name;
+  const MetricType Type;
+  /// Describes what the labels of the metric are, e.g. "method_name".
+  const llvm::StringLiteral LabelName;
+};
+
 /// A consumer of trace events. The events are produced by Spans and trace::log.
 /// Implmentations of this interface must be thread-safe.
 class EventTracer {
@@ -48,6 +83,10 @@ public:
 
   /// Called for instant events.
   virtual void instant(llvm::StringRef Name, llvm::json::Object &&Args) = 0;
+
+  /// Called whenever a metric records a measurement.
+  virtual void record(const Metric &Metric, double Value,
+                      llvm::StringRef Label) {}
 };
 
 /// Sets up a global EventTracer that consumes events produced by Span and
@@ -67,6 +106,31 @@ public:
 std::unique_ptr<EventTracer> createJSONTracer(llvm::raw_ostream &OS,
                                               bool Pretty = false);
 
+/// Create an instance of EventTracer that records events in a compact binary
+/// format, cheap enough to leave enabled. Each thread appends to its own
+/// buffer without locking, full buffers are written to \p OS by a background
+/// thread. Span args are not recorded.
+/// Use binaryTraceToJSON() to convert the output for Chrome's trace viewer.
+std::unique_ptr<EventTracer> createBinaryTracer(llvm::raw_ostream &OS);
+
+/// Converts the output of a binary tracer to the format of createJSONTracer().
+llvm::Error binaryTraceToJSON(llvm::StringRef Data, llvm::raw_ostream &OS);
+
+/// Create an instance of EventTracer that only passes 1 in \p Rate requests to
+/// \p Tracer: a span without a parent starts a request, nested spans and
+/// events are recorded only if their request is.
+std::unique_ptr<EventTracer> createSamplingTracer(EventTracer &Tracer,
+                                                  unsigned Rate);
+
+/// Create an instance of EventTracer that aggregates metrics: counters, last
+/// values, and histograms of distributions. A JSON snapshot of all metrics is
+/// written to \p OS as a single line every \p Period, and when the tracer is
+/// destroyed. Recording a value takes a few atomic operations.
+/// Other events, and the metrics, are passed on to \p Inner if it is set.
+std::unique_ptr<EventTracer>
+createMetricsTracer(llvm::raw_ostream &OS, std::chrono::milliseconds Period,
+                    EventTracer *Inner = nullptr);
+
 /// Records a single instant event, associated with the current thread.
 void log(const llvm::Twine &Name);
 
@@ -41,6 +41,12 @@ public:
                     llvm::json::Value ID) = 0;
   virtual void reply(llvm::json::Value ID,
                      llvm::Expected<llvm::json::Value> Result) = 0;
+  // Variants of notify() and reply() whose payload is already serialized
+  // JSON text (see writeJSON() in Protocol.h). Transports that send JSON text
+  // can splice it into the message as is. By default it's parsed back into a
+  // json::Value and sent as usual.
+  virtual void notifyRaw(llvm::StringRef Method, llvm::StringRef Params);
+  virtual void replyRaw(llvm::json::Value ID, llvm::StringRef Result);
 
   // Implemented by Clangd to handle incoming messages. (See loop() below).
   class MessageHandler {
@@ -71,7 +77,11 @@ enum JSONStreamStyle {
 
 // Returns a Transport that speaks JSON-RPC over a pair of streams.
 // The input stream must be opened in binary mode.
-// If InMirror is set, data read will be echoed to it.
+// If InMirror is set, data read will be echoed to it. With MirrorTimestamps,
+// each message echoed is preceded by a "# time-ms: N" comment line, recording
+// when (in milliseconds since the transport was created) it started to arrive.
+// Comments are ignored by both input styles, so the mirror can still be read
+// back as input. clangd-replay uses them to reproduce a session's timing.
 //
 // The use of C-style std::FILE* input deserves some explanation.
 // Previously, std::istream was used. When a debugger attached on MacOS, the
@@ -83,7 +93,8 @@ enum JSONStreamStyle {
 std::unique_ptr<Transport>
 newJSONTransport(std::FILE *In, llvm::raw_ostream &Out,
                  llvm::raw_ostream *InMirror, bool Pretty,
-                 JSONStreamStyle = JSONStreamStyle::Standard);
+                 JSONStreamStyle = JSONStreamStyle::Standard,
+                 bool MirrorTimestamps = false);
 
 #ifdef CLANGD_BUILD_XPC
 // Returns a Transport for macOS based on XPC.
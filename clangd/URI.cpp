@@ -8,14 +8,14 @@
 
 #include "URI.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Error.h"
-#include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Path.h"
 #include <algorithm>
-#include <iomanip>
-#include <sstream>
+#include <mutex>
+#include <vector>
 
 LLVM_INSTANTIATE_REGISTRY(clang::clangd::URISchemeRegistry)
 
@@ -60,17 +60,29 @@ public:
   }
 };
 
-llvm::Expected<std::unique_ptr<URIScheme>>
-findSchemeByName(llvm::StringRef Scheme) {
+// The registered schemes, instantiated once. Schemes are registered during
+// static initialization, and are stateless, so instances can be shared by all
+// threads.
+const std::vector<std::pair<std::string, std::unique_ptr<URIScheme>>> &
+registeredSchemes() {
+  static const auto *Schemes = [] {
+    auto *Result =
+        new std::vector<std::pair<std::string, std::unique_ptr<URIScheme>>>();
+    for (const auto &Entry : URISchemeRegistry::entries())
+      Result->emplace_back(Entry.getName(), Entry.instantiate());
+    return Result;
+  }();
+  return *Schemes;
+}
+
+llvm::Expected<const URIScheme *> findSchemeByName(llvm::StringRef Scheme) {
+  static const FileSystemScheme FileScheme{};
   if (Scheme == "file")
-    return llvm::make_unique<FileSystemScheme>();
+    return &FileScheme;
 
-  for (auto I = URISchemeRegistry::begin(), E = URISchemeRegistry::end();
-       I != E; ++I) {
-    if (I->getName() != Scheme)
-      continue;
-    return I->instantiate();
-  }
+  for (const auto &Entry : registeredSchemes())
+    if (Entry.first == Scheme)
+      return Entry.second.get();
   return make_string_error("Can't find scheme: " + Scheme);
 }
 
@@ -96,22 +108,26 @@ bool shouldEscape(unsigned char C) {
 /// - Unreserved characters are not escaped.
 /// - Reserved characters always escaped with exceptions like '/'.
 /// - All other characters are escaped.
-std::string percentEncode(llvm::StringRef Content) {
-  std::string Result;
-  llvm::raw_string_ostream OS(Result);
-  for (unsigned char C : Content)
-    if (shouldEscape(C))
-      OS << '%' << llvm::format_hex_no_prefix(C, 2, /*Upper = */ true);
-    else
-      OS << C;
-
-  OS.flush();
-  return Result;
+void percentEncode(llvm::StringRef Content, std::string &Out) {
+  static constexpr char Hex[] = "0123456789ABCDEF";
+  for (unsigned char C : Content) {
+    if (shouldEscape(C)) {
+      Out.push_back('%');
+      Out.push_back(Hex[C >> 4]);
+      Out.push_back(Hex[C & 0xf]);
+    } else {
+      Out.push_back(C);
+    }
+  }
 }
 
 /// Decodes a string according to percent-encoding.
 std::string percentDecode(llvm::StringRef Content) {
+  // Most URIs have nothing to decode.
+  if (Content.find('%') == llvm::StringRef::npos)
+    return Content;
   std::string Result;
+  Result.reserve(Content.size());
   for (auto I = Content.begin(), E = Content.end(); I != E; ++I) {
     if (*I != '%') {
       Result += *I;
@@ -149,16 +165,19 @@ URI::URI(llvm::StringRef Scheme, llvm::StringRef Authority,
 
 std::string URI::toString() const {
   std::string Result;
-  llvm::raw_string_ostream OS(Result);
-  OS << percentEncode(Scheme) << ":";
+  // Escaping is rare, so this is usually the final size.
+  Result.reserve(Scheme.size() + Authority.size() + Body.size() + 3);
+  percentEncode(Scheme, Result);
+  Result.push_back(':');
   if (Authority.empty() && Body.empty())
-    return OS.str();
+    return Result;
   // If authority if empty, we only print body if it starts with "/"; otherwise,
   // the URI is invalid.
-  if (!Authority.empty() || llvm::StringRef(Body).startswith("/"))
-    OS << "//" << percentEncode(Authority);
-  OS << percentEncode(Body);
-  OS.flush();
+  if (!Authority.empty() || llvm::StringRef(Body).startswith("/")) {
+    Result += "//";
+    percentEncode(Authority, Result);
+  }
+  percentEncode(Body, Result);
   return Result;
 }
 
@@ -191,15 +210,15 @@ llvm::Expected<URI> URI::create(llvm::StringRef AbsolutePath,
   auto S = findSchemeByName(Scheme);
   if (!S)
     return S.takeError();
-  return S->get()->uriFromAbsolutePath(AbsolutePath);
+  return (*S)->uriFromAbsolutePath(AbsolutePath);
 }
 
 URI URI::create(llvm::StringRef AbsolutePath) {
   if (!llvm::sys::path::is_absolute(AbsolutePath))
     llvm_unreachable(
         ("Not a valid absolute path: " + AbsolutePath).str().c_str());
-  for (auto &Entry : URISchemeRegistry::entries()) {
-    auto URI = Entry.instantiate()->uriFromAbsolutePath(AbsolutePath);
+  for (const auto &Entry : registeredSchemes()) {
+    auto URI = Entry.second->uriFromAbsolutePath(AbsolutePath);
     // For some paths, conversion to different URI schemes is impossible. These
     // should be just skipped.
     if (!URI) {
@@ -225,15 +244,44 @@ llvm::Expected<std::string> URI::resolve(const URI &Uri,
   auto S = findSchemeByName(Uri.Scheme);
   if (!S)
     return S.takeError();
-  return S->get()->getAbsolutePath(Uri.Authority, Uri.Body, HintPath);
+  return (*S)->getAbsolutePath(Uri.Authority, Uri.Body, HintPath);
+}
+
+llvm::Expected<std::string> URI::resolve(llvm::StringRef FileURI,
+                                         llvm::StringRef HintPath) {
+  // Remembers recently resolved URIs, keyed by the URI and the hint path.
+  // The cache is cleared when full, which is enough for the bursts of repeated
+  // URIs in index results.
+  static constexpr size_t MaxCachedURIs = 4096;
+  static std::mutex Mu;
+  static llvm::StringMap<std::string> *Cache =
+      new llvm::StringMap<std::string>();
+  std::string Key = (FileURI + llvm::StringRef("\0", 1) + HintPath).str();
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = Cache->find(Key);
+    if (It != Cache->end())
+      return It->second;
+  }
+  auto U = parse(FileURI);
+  if (!U)
+    return U.takeError();
+  auto Path = resolve(*U, HintPath);
+  if (!Path)
+    return Path.takeError();
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (Cache->size() >= MaxCachedURIs)
+    Cache->clear();
+  (*Cache)[Key] = *Path;
+  return Path;
 }
 
 llvm::Expected<std::string> URI::resolvePath(llvm::StringRef AbsPath,
                                              llvm::StringRef HintPath) {
   if (!llvm::sys::path::is_absolute(AbsPath))
     llvm_unreachable(("Not a valid absolute path: " + AbsPath).str().c_str());
-  for (auto &Entry : URISchemeRegistry::entries()) {
-    auto S = Entry.instantiate();
+  for (const auto &Entry : registeredSchemes()) {
+    const URIScheme *S = Entry.second.get();
     auto U = S->uriFromAbsolutePath(AbsPath);
     // For some paths, conversion to different URI schemes is impossible. These
     // should be just skipped.
@@ -252,7 +300,7 @@ llvm::Expected<std::string> URI::includeSpelling(const URI &Uri) {
   auto S = findSchemeByName(Uri.Scheme);
   if (!S)
     return S.takeError();
-  return S->get()->getIncludeSpelling(Uri);
+  return (*S)->getIncludeSpelling(Uri);
 }
 
 } // namespace clangd
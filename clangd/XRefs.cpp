@@ -17,9 +17,7 @@
 #include "clang/AST/DeclTemplate.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/AST/Type.h"
-#include "clang/Index/IndexDataConsumer.h"
 #include "clang/Index/IndexSymbol.h"
-#include "clang/Index/IndexingAction.h"
 #include "clang/Index/USRGeneration.h"
 #include "llvm/Support/Path.h"
 
@@ -63,12 +61,7 @@ llvm::Optional<Location> toLSPLocation(const SymbolLocation &Loc,
                                        llvm::StringRef TUPath) {
   if (!Loc)
     return None;
-  auto Uri = URI::parse(Loc.FileURI);
-  if (!Uri) {
-    elog("Could not parse URI {0}: {1}", Loc.FileURI, Uri.takeError());
-    return None;
-  }
-  auto U = URIForFile::fromURI(*Uri, TUPath);
+  auto U = URIForFile::fromURI(Loc.FileURI, TUPath);
   if (!U) {
     elog("Could not resolve URI {0}: {1}", Loc.FileURI, U.takeError());
     return None;
@@ -114,112 +107,35 @@ struct MacroDecl {
   const MacroInfo *Info;
 };
 
-/// Finds declarations locations that a given source location refers to.
-class DeclarationAndMacrosFinder : public index::IndexDataConsumer {
+/// Finds the macro referenced at a given source location, if any.
+std::vector<MacroDecl> findMacrosAt(ASTContext &AST, Preprocessor &PP,
+                                    SourceLocation SearchedLocation) {
   std::vector<MacroDecl> MacroInfos;
-  llvm::DenseSet<const Decl *> Decls;
-  const SourceLocation &SearchedLocation;
-  const ASTContext &AST;
-  Preprocessor &PP;
-
-public:
-  DeclarationAndMacrosFinder(const SourceLocation &SearchedLocation,
-                             ASTContext &AST, Preprocessor &PP)
-      : SearchedLocation(SearchedLocation), AST(AST), PP(PP) {}
-
-  // The results are sorted by declaration location.
-  std::vector<const Decl *> getFoundDecls() const {
-    std::vector<const Decl *> Result;
-    for (const Decl *D : Decls)
-      Result.push_back(D);
-
-    llvm::sort(Result, [](const Decl *L, const Decl *R) {
-      return L->getBeginLoc() < R->getBeginLoc();
-    });
-    return Result;
-  }
-
-  std::vector<MacroDecl> takeMacroInfos() {
-    // Don't keep the same Macro info multiple times.
-    llvm::sort(MacroInfos, [](const MacroDecl &Left, const MacroDecl &Right) {
-      return Left.Info < Right.Info;
-    });
-
-    auto Last = std::unique(MacroInfos.begin(), MacroInfos.end(),
-                            [](const MacroDecl &Left, const MacroDecl &Right) {
-                              return Left.Info == Right.Info;
-                            });
-    MacroInfos.erase(Last, MacroInfos.end());
-    return std::move(MacroInfos);
-  }
-
-  bool
-  handleDeclOccurence(const Decl *D, index::SymbolRoleSet Roles,
-                      llvm::ArrayRef<index::SymbolRelation> Relations,
-                      SourceLocation Loc,
-                      index::IndexDataConsumer::ASTNodeInfo ASTNode) override {
-    // Skip non-semantic references.
-    if (Roles & static_cast<unsigned>(index::SymbolRole::NameReference))
-      return true;
-
-    if (Loc == SearchedLocation) {
-      auto IsImplicitExpr = [](const Expr *E) {
-        if (!E)
-          return false;
-        // We assume that a constructor expression is implict (was inserted by
-        // clang) if it has an invalid paren/brace location, since such
-        // experssion is impossible to write down.
-        if (const auto *CtorExpr = dyn_cast<CXXConstructExpr>(E))
-          return CtorExpr->getParenOrBraceRange().isInvalid();
-        return isa<ImplicitCastExpr>(E);
-      };
-
-      if (IsImplicitExpr(ASTNode.OrigE))
-        return true;
-      // Find and add definition declarations (for GoToDefinition).
-      // We don't use parameter `D`, as Parameter `D` is the canonical
-      // declaration, which is the first declaration of a redeclarable
-      // declaration, and it could be a forward declaration.
-      if (const auto *Def = getDefinition(D)) {
-        Decls.insert(Def);
-      } else {
-        // Couldn't find a definition, fall back to use `D`.
-        Decls.insert(D);
-      }
+  Token Result;
+  auto &Mgr = AST.getSourceManager();
+  if (!Lexer::getRawToken(Mgr.getSpellingLoc(SearchedLocation), Result, Mgr,
+                          AST.getLangOpts(), false)) {
+    if (Result.is(tok::raw_identifier)) {
+      PP.LookUpIdentifierInfo(Result);
     }
-    return true;
-  }
-
-private:
-  void finish() override {
-    // Also handle possible macro at the searched location.
-    Token Result;
-    auto &Mgr = AST.getSourceManager();
-    if (!Lexer::getRawToken(Mgr.getSpellingLoc(SearchedLocation), Result, Mgr,
-                            AST.getLangOpts(), false)) {
-      if (Result.is(tok::raw_identifier)) {
-        PP.LookUpIdentifierInfo(Result);
-      }
-      IdentifierInfo *IdentifierInfo = Result.getIdentifierInfo();
-      if (IdentifierInfo && IdentifierInfo->hadMacroDefinition()) {
-        std::pair<FileID, unsigned int> DecLoc =
-            Mgr.getDecomposedExpansionLoc(SearchedLocation);
-        // Get the definition just before the searched location so that a macro
-        // referenced in a '#undef MACRO' can still be found.
-        SourceLocation BeforeSearchedLocation = Mgr.getMacroArgExpandedLocation(
-            Mgr.getLocForStartOfFile(DecLoc.first)
-                .getLocWithOffset(DecLoc.second - 1));
-        MacroDefinition MacroDef =
-            PP.getMacroDefinitionAtLoc(IdentifierInfo, BeforeSearchedLocation);
-        MacroInfo *MacroInf = MacroDef.getMacroInfo();
-        if (MacroInf) {
-          MacroInfos.push_back(MacroDecl{IdentifierInfo->getName(), MacroInf});
-          assert(Decls.empty());
-        }
-      }
+    IdentifierInfo *IdentifierInfo = Result.getIdentifierInfo();
+    if (IdentifierInfo && IdentifierInfo->hadMacroDefinition()) {
+      std::pair<FileID, unsigned int> DecLoc =
+          Mgr.getDecomposedExpansionLoc(SearchedLocation);
+      // Get the definition just before the searched location so that a macro
+      // referenced in a '#undef MACRO' can still be found.
+      SourceLocation BeforeSearchedLocation = Mgr.getMacroArgExpandedLocation(
+          Mgr.getLocForStartOfFile(DecLoc.first)
+              .getLocWithOffset(DecLoc.second - 1));
+      MacroDefinition MacroDef =
+          PP.getMacroDefinitionAtLoc(IdentifierInfo, BeforeSearchedLocation);
+      MacroInfo *MacroInf = MacroDef.getMacroInfo();
+      if (MacroInf)
+        MacroInfos.push_back(MacroDecl{IdentifierInfo->getName(), MacroInf});
     }
   }
-};
+  return MacroInfos;
+}
 
 struct IdentifiedSymbol {
   std::vector<const Decl *> Decls;
@@ -227,18 +143,33 @@ struct IdentifiedSymbol {
 };
 
 IdentifiedSymbol getSymbolAtPosition(ParsedAST &AST, SourceLocation Pos) {
-  auto DeclMacrosFinder = DeclarationAndMacrosFinder(Pos, AST.getASTContext(),
-                                                     AST.getPreprocessor());
-  index::IndexingOptions IndexOpts;
-  IndexOpts.SystemSymbolFilter =
-      index::IndexingOptions::SystemSymbolFilterKind::All;
-  IndexOpts.IndexFunctionLocals = true;
-  IndexOpts.IndexParametersInDeclarations = true;
-  IndexOpts.IndexTemplateParameters = true;
-  indexTopLevelDecls(AST.getASTContext(), AST.getPreprocessor(),
-                     AST.getLocalTopLevelDecls(), DeclMacrosFinder, IndexOpts);
-
-  return {DeclMacrosFinder.getFoundDecls(), DeclMacrosFinder.takeMacroInfos()};
+  IdentifiedSymbol Result;
+  llvm::DenseSet<const Decl *> Seen;
+  for (const auto &O : AST.getDeclOccurrences().at(Pos)) {
+    // Skip non-semantic references, and those clang inserted.
+    if (O.Roles & static_cast<unsigned>(index::SymbolRole::NameReference))
+      continue;
+    if (O.Implicit)
+      continue;
+    // Find and add definition declarations (for GoToDefinition).
+    // We don't use O.D, as it is the canonical declaration, which is the first
+    // declaration of a redeclarable declaration, and it could be a forward
+    // declaration. Couldn't find a definition, fall back to use it.
+    const Decl *D = getDefinition(O.D);
+    if (!D)
+      D = O.D;
+    if (Seen.insert(D).second)
+      Result.Decls.push_back(D);
+  }
+  // The results are sorted by declaration location.
+  llvm::sort(Result.Decls, [](const Decl *L, const Decl *R) {
+    return L->getBeginLoc() < R->getBeginLoc();
+  });
+
+  // Also handle possible macro at the searched location.
+  Result.Macros = findMacrosAt(AST.getASTContext(), AST.getPreprocessor(), Pos);
+  assert(Result.Macros.empty() || Result.Decls.empty());
+  return Result;
 }
 
 Range getTokenRange(ParsedAST &AST, SourceLocation TokLoc) {
@@ -373,69 +304,29 @@ std::vector<LocatedSymbol> locateSymbolAt(ParsedAST &AST, Position Pos,
 
 namespace {
 
-/// Collects references to symbols within the main file.
-class ReferenceFinder : public index::IndexDataConsumer {
-public:
-  struct Reference {
-    const Decl *CanonicalTarget;
-    SourceLocation Loc;
-    index::SymbolRoleSet Role;
-  };
-
-  ReferenceFinder(ASTContext &AST, Preprocessor &PP,
-                  const std::vector<const Decl *> &TargetDecls)
-      : AST(AST) {
-    for (const Decl *D : TargetDecls)
-      CanonicalTargets.insert(D->getCanonicalDecl());
-  }
-
-  std::vector<Reference> take() && {
-    llvm::sort(References, [](const Reference &L, const Reference &R) {
-      return std::tie(L.Loc, L.CanonicalTarget, L.Role) <
-             std::tie(R.Loc, R.CanonicalTarget, R.Role);
-    });
-    // We sometimes see duplicates when parts of the AST get traversed twice.
-    References.erase(
-        std::unique(References.begin(), References.end(),
-                    [](const Reference &L, const Reference &R) {
-                      return std::tie(L.CanonicalTarget, L.Loc, L.Role) ==
-                             std::tie(R.CanonicalTarget, R.Loc, R.Role);
-                    }),
-        References.end());
-    return std::move(References);
-  }
-
-  bool
-  handleDeclOccurence(const Decl *D, index::SymbolRoleSet Roles,
-                      llvm::ArrayRef<index::SymbolRelation> Relations,
-                      SourceLocation Loc,
-                      index::IndexDataConsumer::ASTNodeInfo ASTNode) override {
-    assert(D->isCanonicalDecl() && "expect D to be a canonical declaration");
-    const SourceManager &SM = AST.getSourceManager();
-    Loc = SM.getFileLoc(Loc);
-    if (SM.isWrittenInMainFile(Loc) && CanonicalTargets.count(D))
-      References.push_back({D, Loc, Roles});
-    return true;
-  }
+/// A reference to a symbol within the main file.
+struct Reference {
+  const Decl *CanonicalTarget;
+  SourceLocation Loc;
+  index::SymbolRoleSet Role;
+};
 
-private:
+std::vector<Reference> findRefs(const std::vector<const Decl *> &Decls,
+                                ParsedAST &AST) {
   llvm::SmallSet<const Decl *, 4> CanonicalTargets;
   std::vector<Reference> References;
-  const ASTContext &AST;
-};
-
-std::vector<ReferenceFinder::Reference>
-findRefs(const std::vector<const Decl *> &Decls, ParsedAST &AST) {
-  ReferenceFinder RefFinder(AST.getASTContext(), AST.getPreprocessor(), Decls);
-  index::IndexingOptions IndexOpts;
-  IndexOpts.SystemSymbolFilter =
-      index::IndexingOptions::SystemSymbolFilterKind::All;
-  IndexOpts.IndexFunctionLocals = true;
-  IndexOpts.IndexParametersInDeclarations = true;
-  IndexOpts.IndexTemplateParameters = true;
-  indexTopLevelDecls(AST.getASTContext(), AST.getPreprocessor(),
-                     AST.getLocalTopLevelDecls(), RefFinder, IndexOpts);
-  return std::move(RefFinder).take();
+  for (const Decl *D : Decls) {
+    if (!CanonicalTargets.insert(D->getCanonicalDecl()).second)
+      continue;
+    for (const auto &O :
+         AST.getDeclOccurrences().inMainFile(D->getCanonicalDecl()))
+      References.push_back({O.D, O.FileLoc, O.Roles});
+  }
+  llvm::sort(References, [](const Reference &L, const Reference &R) {
+    return std::tie(L.Loc, L.CanonicalTarget, L.Role) <
+           std::tie(R.Loc, R.CanonicalTarget, R.Role);
+  });
+  return References;
 }
 
 } // namespace
@@ -754,6 +645,9 @@ std::vector<Location> findReferences(ParsedAST &AST, Position Pos,
   if (Index && Results.size() < Limit) {
     RefsRequest Req;
     Req.Limit = Limit;
+    // Without a limit, all refs are returned and their order doesn't matter.
+    if (Limit != std::numeric_limits<uint32_t>::max())
+      Req.ProximityPaths.push_back(*MainFilePath);
 
     for (const Decl *D : Symbols.Decls) {
       // Not all symbols can be referenced from outside (e.g. function-locals).
@@ -876,6 +770,43 @@ declToTypeHierarchyItem(ASTContext &Ctx, const NamedDecl &ND) {
   return THI;
 }
 
+static Optional<TypeHierarchyItem>
+symbolToTypeHierarchyItem(const Symbol &S, PathRef TUPath) {
+  auto Loc = toLSPLocation(S.Definition ? S.Definition : S.CanonicalDeclaration,
+                           TUPath);
+  if (!Loc)
+    return llvm::None;
+  TypeHierarchyItem THI;
+  THI.name = S.Name;
+  THI.kind = indexSymbolKindToSymbolKind(S.SymInfo.Kind);
+  THI.deprecated = (S.Flags & Symbol::Deprecated);
+  THI.selectionRange = Loc->range;
+  // FIXME: Populate 'range' correctly
+  // (https://github.com/clangd/clangd/issues/59).
+  THI.range = THI.selectionRange;
+  THI.uri = Loc->uri;
+  return THI;
+}
+
+// Fills the children of \p Item, a symbol with ID \p ID, and their children
+// up to \p Levels levels deep, from the relations in \p Index.
+static void fillSubTypes(const SymbolID &ID, TypeHierarchyItem &Item,
+                         int Levels, const SymbolIndex *Index,
+                         PathRef TUPath) {
+  Item.children.emplace();
+  RelationsRequest Req;
+  Req.Subjects.insert(ID);
+  Req.Predicate = index::SymbolRole::RelationBaseOf;
+  Index->relations(Req, [&](const SymbolID &, const Symbol &Object) {
+    if (Optional<TypeHierarchyItem> ChildSym =
+            symbolToTypeHierarchyItem(Object, TUPath)) {
+      if (Levels > 1)
+        fillSubTypes(Object.ID, *ChildSym, Levels - 1, Index, TUPath);
+      Item.children->emplace_back(std::move(*ChildSym));
+    }
+  });
+}
+
 static Optional<TypeHierarchyItem> getTypeAncestors(const CXXRecordDecl &CXXRD,
                                                     ASTContext &ASTCtx) {
   Optional<TypeHierarchyItem> Result = declToTypeHierarchyItem(ASTCtx, CXXRD);
@@ -947,15 +878,22 @@ std::vector<const CXXRecordDecl *> typeParents(const CXXRecordDecl *CXXRD) {
 
 llvm::Optional<TypeHierarchyItem>
 getTypeHierarchy(ParsedAST &AST, Position Pos, int ResolveLevels,
-                 TypeHierarchyDirection Direction) {
+                 TypeHierarchyDirection Direction, const SymbolIndex *Index,
+                 PathRef TUPath) {
   const CXXRecordDecl *CXXRD = findRecordTypeAt(AST, Pos);
   if (!CXXRD)
     return llvm::None;
 
   Optional<TypeHierarchyItem> Result =
       getTypeAncestors(*CXXRD, AST.getASTContext());
-  // FIXME(nridge): Resolve type descendants if direction is Children or Both,
-  // and ResolveLevels > 0.
+  // Subtypes are only known from the index, which records the derived classes
+  // of each base class.
+  if (Result && ResolveLevels > 0 && Index &&
+      (Direction == TypeHierarchyDirection::Children ||
+       Direction == TypeHierarchyDirection::Both)) {
+    if (Optional<SymbolID> ID = getSymbolID(CXXRD))
+      fillSubTypes(*ID, *Result, ResolveLevels, Index, TUPath);
+  }
   return Result;
 }
 
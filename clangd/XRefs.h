@@ -65,9 +65,12 @@ const CXXRecordDecl *findRecordTypeAt(ParsedAST &AST, Position Pos);
 std::vector<const CXXRecordDecl *> typeParents(const CXXRecordDecl *CXXRD);
 
 /// Get type hierarchy information at \p Pos.
+/// Children are only resolved from \p Index, as the AST doesn't know the
+/// derived classes; their URIs are resolved relative to \p TUPath.
 llvm::Optional<TypeHierarchyItem>
 getTypeHierarchy(ParsedAST &AST, Position Pos, int Resolve,
-                 TypeHierarchyDirection Direction);
+                 TypeHierarchyDirection Direction,
+                 const SymbolIndex *Index = nullptr, PathRef TUPath = PathRef{});
 
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,246 @@
+//===--- CodeCompletionBenchmark.cpp - Clangd completion benchmarks ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Runs code completion on a generated TU with a large header in the preamble,
+// at a few typical positions. Besides the end-to-end time, the main stages are
+// measured separately: Sema completion, the index query, fuzzy matching and
+// bundling of overloads. Each benchmark reports the number of allocations per
+// iteration.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../ClangdUnit.h"
+#include "../CodeComplete.h"
+#include "../Compiler.h"
+#include "../FuzzyMatch.h"
+#include "../Logger.h"
+#include "../SourceCode.h"
+#include "../index/FileIndex.h"
+#include "../index/dex/Dex.h"
+#include "benchmark/benchmark.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/PCHContainerOperations.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Counts allocations made by the benchmarked code.
+static std::atomic<size_t> Allocations = {0};
+
+void *operator new(size_t Size) {
+  ++Allocations;
+  if (void *Result = std::malloc(Size ? Size : 1))
+    return Result;
+  llvm::report_bad_alloc_error("Allocation failed");
+}
+
+void operator delete(void *Ptr) noexcept { std::free(Ptr); }
+
+namespace clang {
+namespace clangd {
+namespace {
+
+// Sizes of the generated header.
+constexpr unsigned NumFunctions = 2000;
+constexpr unsigned NumOverloads = 8;
+constexpr unsigned NumMembers = 500;
+
+const char *MainFile = "/bench/main.cpp";
+const char *HeaderFile = "/bench/bench.h";
+
+std::string headerCode() {
+  std::string Code = "#pragma once\nnamespace bench {\n";
+  for (unsigned I = 0; I < NumFunctions; ++I)
+    Code += llvm::formatv("int function{0}(int X);\n"
+                          "struct Type{0} {{ int field; };\n",
+                          I);
+  // Overloads are folded into one item when bundling.
+  for (unsigned I = 0; I < NumFunctions / NumOverloads; ++I)
+    for (unsigned J = 0; J < NumOverloads; ++J)
+      Code += llvm::formatv("void overload{0}(Type{1} T);\n", I, J);
+  Code += "struct Big {\n";
+  for (unsigned I = 0; I < NumMembers; ++I)
+    Code += llvm::formatv("  int field{0}; void method{0}();\n", I);
+  Code += "};\n} // namespace bench\n";
+  return Code;
+}
+
+// The completion positions: the main file is the preamble plus the text before
+// the cursor, closed off by " }".
+struct CompletionPoint {
+  const char *Name;
+  const char *Prefix;
+};
+const CompletionPoint Points[] = {
+    {"qualified", "bench::fun"},
+    {"unqualified", "fun"},
+    {"member", "B.fie"},
+    {"overloads", "bench::over"},
+};
+
+const char *MainPreamble = "#include \"bench.h\"\n"
+                           "using namespace bench;\n"
+                           "void test(Big B) {\n  ";
+
+// The TU, its preamble, and an index of the header, shared by all benchmarks.
+struct Fixture {
+  Fixture() {
+    IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> FS(
+        new llvm::vfs::InMemoryFileSystem);
+    FS->addFile(HeaderFile, 0, llvm::MemoryBuffer::getMemBufferCopy(Header));
+    FS->setCurrentWorkingDirectory("/bench");
+    this->FS = FS;
+    Inputs.CompileCommand.Filename = MainFile;
+    Inputs.CompileCommand.CommandLine = {"clang", "-ffreestanding", MainFile};
+    Inputs.CompileCommand.Directory = "/bench";
+    Inputs.FS = FS;
+    Inputs.Contents = contents(Points[0]);
+    FS->addFile(MainFile, 0,
+                llvm::MemoryBuffer::getMemBufferCopy(Inputs.Contents));
+
+    auto CI = buildCompilerInvocation(Inputs);
+    if (!CI) {
+      llvm::errs() << "Failed to build compiler invocation\n";
+      exit(1);
+    }
+    Preamble = buildPreamble(MainFile, *CI, /*OldPreamble=*/nullptr,
+                             Inputs.CompileCommand, Inputs, PCHs,
+                             /*StoreInMemory=*/true,
+                             /*PreambleCallback=*/nullptr);
+    auto AST = buildAST(MainFile, std::move(CI), Inputs, Preamble, PCHs);
+    if (!Preamble || !AST) {
+      llvm::errs() << "Failed to build the benchmark TU\n";
+      exit(1);
+    }
+    auto Symbols = std::move(std::get<0>(
+        indexHeaderSymbols(AST->getASTContext(), AST->getPreprocessorPtr(),
+                           AST->getCanonicalIncludes())));
+    for (const Symbol &S : Symbols)
+      SymbolNames.push_back(S.Name);
+    Index = dex::Dex::build(std::move(Symbols), RefSlab());
+  }
+
+  static std::string contents(const CompletionPoint &Point) {
+    return std::string(MainPreamble) + Point.Prefix + " }\n";
+  }
+
+  static Position position(const CompletionPoint &Point) {
+    std::string Code = contents(Point);
+    return offsetToPosition(Code, Code.size() - llvm::StringRef(" }\n").size());
+  }
+
+  CodeCompleteResult complete(const CompletionPoint &Point,
+                              const CodeCompleteOptions &Opts) {
+    return codeComplete(MainFile, Inputs.CompileCommand, Preamble.get(),
+                        contents(Point), position(Point), FS, PCHs, Opts);
+  }
+
+  std::string Header = headerCode();
+  IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS;
+  ParseInputs Inputs;
+  std::shared_ptr<PCHContainerOperations> PCHs =
+      std::make_shared<PCHContainerOperations>();
+  std::shared_ptr<const PreambleData> Preamble;
+  std::unique_ptr<SymbolIndex> Index;
+  std::vector<std::string> SymbolNames; // Of the symbols in Index.
+};
+
+Fixture &fixture() {
+  static Fixture *F = new Fixture();
+  return *F;
+}
+
+// Must be called after the benchmark loop.
+void reportAllocations(benchmark::State &State, size_t AllocationsBefore) {
+  State.counters["allocs"] =
+      double(Allocations - AllocationsBefore) / State.iterations();
+}
+
+// Sema completion only: parsing with the preamble, collecting, scoring and
+// bundling Sema results.
+static void SemaCompletion(benchmark::State &State) {
+  auto &F = fixture();
+  const auto &Point = Points[State.range(0)];
+  State.SetLabel(Point.Name);
+  CodeCompleteOptions Opts;
+  size_t Before = Allocations;
+  for (auto _ : State)
+    benchmark::DoNotOptimize(F.complete(Point, Opts));
+  reportAllocations(State, Before);
+}
+BENCHMARK(SemaCompletion)->DenseRange(0, llvm::array_lengthof(Points) - 1);
+
+// End-to-end completion with the index, with and without bundling.
+static void CodeCompletion(benchmark::State &State) {
+  auto &F = fixture();
+  const auto &Point = Points[State.range(0)];
+  CodeCompleteOptions Opts;
+  Opts.Index = F.Index.get();
+  Opts.BundleOverloads = State.range(1);
+  State.SetLabel(std::string(Point.Name) +
+                 (Opts.BundleOverloads ? " bundled" : ""));
+  size_t Before = Allocations;
+  for (auto _ : State)
+    benchmark::DoNotOptimize(F.complete(Point, Opts));
+  reportAllocations(State, Before);
+}
+static void codeCompletionArgs(benchmark::internal::Benchmark *B) {
+  for (int Point = 0; Point < int(llvm::array_lengthof(Points)); ++Point)
+    for (int Bundle : {0, 1})
+      B->Args({Point, Bundle});
+}
+BENCHMARK(CodeCompletion)->Apply(codeCompletionArgs);
+
+// The index query issued by completion at bench::fun^.
+static void IndexQuery(benchmark::State &State) {
+  auto &F = fixture();
+  FuzzyFindRequest Req;
+  Req.Query = "fun";
+  Req.Scopes = {"bench::"};
+  Req.Limit = 100; // clangd's default.
+  Req.RestrictForCodeCompletion = true;
+  Req.ProximityPaths = {MainFile};
+  size_t Before = Allocations;
+  for (auto _ : State)
+    F.Index->fuzzyFind(Req, [](const Symbol &S) {});
+  reportAllocations(State, Before);
+}
+BENCHMARK(IndexQuery);
+
+// Fuzzy matching all symbol names against a short query.
+static void FuzzyMatcherScoring(benchmark::State &State) {
+  auto &F = fixture();
+  FuzzyMatcher Matcher("fun");
+  size_t Before = Allocations;
+  for (auto _ : State)
+    for (const auto &Name : F.SymbolNames)
+      benchmark::DoNotOptimize(Matcher.match(Name));
+  reportAllocations(State, Before);
+}
+BENCHMARK(FuzzyMatcherScoring);
+
+// Discards clangd's logs, they would dominate the measurements.
+class NullLogger : public Logger {
+  void log(Level, const llvm::formatv_object_base &) override {}
+};
+
+} // namespace
+} // namespace clangd
+} // namespace clang
+
+int main(int argc, char *argv[]) {
+  clang::clangd::NullLogger Logger;
+  clang::clangd::LoggingSession LoggingSession(Logger);
+  ::benchmark::Initialize(&argc, argv);
+  ::benchmark::RunSpecifiedBenchmarks();
+}
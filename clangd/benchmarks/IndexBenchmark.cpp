@@ -6,13 +6,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "../index/MemIndex.h"
 #include "../index/Serialization.h"
 #include "../index/dex/Dex.h"
 #include "benchmark/benchmark.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/raw_ostream.h"
 #include <fstream>
 #include <streambuf>
 #include <string>
@@ -32,6 +35,44 @@ std::unique_ptr<SymbolIndex> buildDex() {
   return loadIndex(IndexFilename, /*UseDex=*/true);
 }
 
+// Returns the raw content of the index file.
+std::string readIndexData() {
+  auto Buffer = llvm::MemoryBuffer::getFile(IndexFilename);
+  if (!Buffer) {
+    llvm::errs() << "Error when reading index file: "
+                 << Buffer.getError().message() << '\n';
+    exit(1);
+  }
+  return (*Buffer)->getBuffer();
+}
+
+IndexFileIn parseIndex(llvm::StringRef Data) {
+  auto Index = readIndexFile(Data);
+  // Panic if the provided file couldn't be parsed.
+  if (!Index) {
+    llvm::errs() << "Error when parsing index file: "
+                 << llvm::toString(Index.takeError()) << '\n';
+    exit(1);
+  }
+  if (!Index->Symbols)
+    Index->Symbols.emplace();
+  if (!Index->Refs)
+    Index->Refs.emplace();
+  return std::move(*Index);
+}
+
+// Returns the IDs of (up to) the first \p Max symbols of the index file.
+std::vector<SymbolID> sampleSymbolIDs(size_t Max = 1000) {
+  auto Index = parseIndex(readIndexData());
+  std::vector<SymbolID> IDs;
+  for (const Symbol &S : *Index.Symbols) {
+    if (IDs.size() == Max)
+      break;
+    IDs.push_back(S.ID);
+  }
+  return IDs;
+}
+
 // Reads JSON array of serialized FuzzyFindRequest's from user-provided file.
 std::vector<FuzzyFindRequest> extractQueriesFromLogs() {
   std::ifstream InputStream(RequestsFilename);
@@ -83,13 +124,114 @@ static void DexQueries(benchmark::State &State) {
 }
 BENCHMARK(DexQueries);
 
+// Builds an index after reading the index file, reporting its size as the
+// "memory" counter. Reading the file isn't measured.
+template <typename BuildFn>
+void buildIndex(benchmark::State &State, BuildFn Build) {
+  const std::string Data = readIndexData();
+  size_t Memory = 0;
+  for (auto _ : State) {
+    State.PauseTiming();
+    IndexFileIn Index = parseIndex(Data);
+    State.ResumeTiming();
+    auto Built = Build(std::move(Index));
+    State.PauseTiming();
+    Memory = Built->estimateMemoryUsage();
+    Built.reset();
+    State.ResumeTiming();
+  }
+  State.counters["memory"] = Memory;
+}
+
+static void MemBuild(benchmark::State &State) {
+  buildIndex(State, [](IndexFileIn Index) {
+    return MemIndex::build(std::move(*Index.Symbols), std::move(*Index.Refs));
+  });
+}
+BENCHMARK(MemBuild);
+
+static void DexBuild(benchmark::State &State) {
+  buildIndex(State, [](IndexFileIn Index) {
+    return dex::Dex::build(std::move(*Index.Symbols), std::move(*Index.Refs));
+  });
+}
+BENCHMARK(DexBuild);
+
+static void IndexFileRead(benchmark::State &State) {
+  const std::string Data = readIndexData();
+  for (auto _ : State)
+    benchmark::DoNotOptimize(parseIndex(Data));
+  State.SetBytesProcessed(int64_t(State.iterations()) * Data.size());
+}
+BENCHMARK(IndexFileRead);
+
+static void RIFFWrite(benchmark::State &State) {
+  const auto Index = parseIndex(readIndexData());
+  IndexFileOut Out(Index);
+  Out.Format = IndexFileFormat::RIFF;
+  Out.CompressStrings = State.range(0);
+  State.SetLabel(Out.CompressStrings ? "compressed" : "uncompressed");
+  size_t Size = 0;
+  for (auto _ : State) {
+    std::string Data;
+    llvm::raw_string_ostream OS(Data);
+    OS << Out;
+    Size = OS.str().size();
+  }
+  State.SetBytesProcessed(int64_t(State.iterations()) * Size);
+}
+BENCHMARK(RIFFWrite)->Arg(0)->Arg(1);
+
+// Looks up symbols one by one, as go-to-definition and hover do.
+template <typename BuildFn>
+void lookupQueries(benchmark::State &State, BuildFn Build) {
+  const auto Index = Build();
+  const auto IDs = sampleSymbolIDs();
+  for (auto _ : State)
+    for (const SymbolID &ID : IDs) {
+      LookupRequest Req;
+      Req.IDs.insert(ID);
+      Index->lookup(Req, [](const Symbol &S) {});
+    }
+}
+
+static void MemLookupQueries(benchmark::State &State) {
+  lookupQueries(State, buildMem);
+}
+BENCHMARK(MemLookupQueries);
+
+static void DexLookupQueries(benchmark::State &State) {
+  lookupQueries(State, buildDex);
+}
+BENCHMARK(DexLookupQueries);
+
+// Finds the references of symbols one by one, as find-references does.
+template <typename BuildFn>
+void refsQueries(benchmark::State &State, BuildFn Build) {
+  const auto Index = Build();
+  const auto IDs = sampleSymbolIDs();
+  for (auto _ : State)
+    for (const SymbolID &ID : IDs) {
+      RefsRequest Req;
+      Req.IDs.insert(ID);
+      Index->refs(Req, [](const Ref &R) {});
+    }
+}
+
+static void MemRefsQueries(benchmark::State &State) {
+  refsQueries(State, buildMem);
+}
+BENCHMARK(MemRefsQueries);
+
+static void DexRefsQueries(benchmark::State &State) {
+  refsQueries(State, buildDex);
+}
+BENCHMARK(DexRefsQueries);
+
 } // namespace
 } // namespace clangd
 } // namespace clang
 
-// FIXME(kbobyrev): Add index building time benchmarks.
-// FIXME(kbobyrev): Add memory consumption "benchmarks" by manually measuring
-// in-memory index size and reporting it as time.
 // FIXME(kbobyrev): Create a logger wrapper to suppress debugging info printer.
 int main(int argc, char *argv[]) {
   if (argc < 3) {
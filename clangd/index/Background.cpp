@@ -9,7 +9,9 @@
 #include "index/Background.h"
 #include "ClangdUnit.h"
 #include "Compiler.h"
+#include "FileDistance.h"
 #include "Logger.h"
+#include "ResourceUsage.h"
 #include "SourceCode.h"
 #include "Symbol.h"
 #include "Threading.h"
@@ -92,9 +94,12 @@ IncludeGraph getSubGraph(const URI &U, const IncludeGraph &FullGraph) {
 // Creates a filter to not collect index results from files with unchanged
 // digests.
 // \p FileDigests contains file digests for the current indexed files.
-decltype(SymbolCollector::Options::FileFilter)
-createFileFilter(const llvm::StringMap<FileDigest> &FileDigests) {
-  return [&FileDigests](const SourceManager &SM, FileID FID) {
+// \p Claim is called for the remaining files, and returns false for those
+// that are already being indexed by another TU.
+decltype(SymbolCollector::Options::FileFilter) createFileFilter(
+    const llvm::StringMap<FileDigest> &FileDigests,
+    std::function<bool(llvm::StringRef, const FileDigest &)> Claim) {
+  return [&FileDigests, Claim](const SourceManager &SM, FileID FID) {
     const auto *F = SM.getFileEntryForID(FID);
     if (!F)
       return false; // Skip invalid files.
@@ -107,7 +112,7 @@ createFileFilter(const llvm::StringMap<FileDigest> &FileDigests) {
     auto D = FileDigests.find(*AbsPath);
     if (D != FileDigests.end() && D->second == Digest)
       return false; // Skip files that haven't changed.
-    return true;
+    return Claim(*AbsPath, *Digest);
   };
 }
 
@@ -131,81 +136,46 @@ BackgroundIndex::BackgroundIndex(
     Context BackgroundContext, const FileSystemProvider &FSProvider,
     const GlobalCompilationDatabase &CDB,
     BackgroundIndexStorage::Factory IndexStorageFactory,
-    size_t BuildIndexPeriodMs, size_t ThreadPoolSize)
+    size_t BuildIndexPeriodMs, size_t ThreadPoolSize,
+    std::shared_ptr<Semaphore> ConcurrencyLimit,
+    llvm::Optional<unsigned> ColdRefsDistance, FileNameIndex *FileNames)
     : SwapIndex(llvm::make_unique<MemIndex>()), FSProvider(FSProvider),
       CDB(CDB), BackgroundContext(std::move(BackgroundContext)),
       BuildIndexPeriodMs(BuildIndexPeriodMs),
       SymbolsUpdatedSinceLastIndex(false),
       IndexStorageFactory(std::move(IndexStorageFactory)),
+      ColdRefsDistance(ColdRefsDistance), FileNames(FileNames),
+      Pool(ThreadPoolSize, std::move(ConcurrencyLimit)),
       CommandsChanged(
           CDB.watch([&](const std::vector<std::string> &ChangedFiles) {
             enqueue(ChangedFiles);
           })) {
-  assert(ThreadPoolSize > 0 && "Thread pool size can't be zero.");
   assert(this->IndexStorageFactory && "Storage factory can not be null!");
-  while (ThreadPoolSize--)
-    ThreadPool.emplace_back([this] { run(); });
   if (BuildIndexPeriodMs > 0) {
     log("BackgroundIndex: build symbol index periodically every {0} ms.",
         BuildIndexPeriodMs);
-    ThreadPool.emplace_back([this] { buildIndex(); });
+    PeriodicRebuilder.emplace([this] { buildIndex(); });
   }
 }
 
 BackgroundIndex::~BackgroundIndex() {
   stop();
-  for (auto &Thread : ThreadPool)
-    Thread.join();
+  if (PeriodicRebuilder)
+    PeriodicRebuilder->join();
 }
 
 void BackgroundIndex::stop() {
+  Pool.stop();
   {
-    std::lock_guard<std::mutex> QueueLock(QueueMu);
     std::lock_guard<std::mutex> IndexLock(IndexMu);
     ShouldStop = true;
   }
-  QueueCV.notify_all();
   IndexCV.notify_all();
 }
 
-void BackgroundIndex::run() {
-  WithContext Background(BackgroundContext.clone());
-  while (true) {
-    llvm::Optional<Task> Task;
-    ThreadPriority Priority;
-    {
-      std::unique_lock<std::mutex> Lock(QueueMu);
-      QueueCV.wait(Lock, [&] { return ShouldStop || !Queue.empty(); });
-      if (ShouldStop) {
-        Queue.clear();
-        QueueCV.notify_all();
-        return;
-      }
-      ++NumActiveTasks;
-      std::tie(Task, Priority) = std::move(Queue.front());
-      Queue.pop_front();
-    }
-
-    if (Priority != ThreadPriority::Normal)
-      setCurrentThreadPriority(Priority);
-    (*Task)();
-    if (Priority != ThreadPriority::Normal)
-      setCurrentThreadPriority(ThreadPriority::Normal);
-
-    {
-      std::unique_lock<std::mutex> Lock(QueueMu);
-      assert(NumActiveTasks > 0 && "before decrementing");
-      --NumActiveTasks;
-    }
-    QueueCV.notify_all();
-  }
-}
-
 bool BackgroundIndex::blockUntilIdleForTest(
     llvm::Optional<double> TimeoutSeconds) {
-  std::unique_lock<std::mutex> Lock(QueueMu);
-  return wait(Lock, QueueCV, timeoutSeconds(TimeoutSeconds),
-              [&] { return Queue.empty() && NumActiveTasks == 0; });
+  return Pool.blockUntilIdle(timeoutSeconds(TimeoutSeconds));
 }
 
 void BackgroundIndex::enqueue(const std::vector<std::string> &ChangedFiles) {
@@ -215,19 +185,63 @@ void BackgroundIndex::enqueue(const std::vector<std::string> &ChangedFiles) {
         // We're doing this asynchronously, because we'll read shards here too.
         log("Enqueueing {0} commands for indexing", ChangedFiles.size());
         SPAN_ATTACH(Tracer, "files", int64_t(ChangedFiles.size()));
+        if (FileNames)
+          for (const std::string &File : ChangedFiles)
+            FileNames->addFile(File);
 
         auto NeedsReIndexing = loadShards(std::move(ChangedFiles));
         // Run indexing for files that need to be updated.
         std::shuffle(NeedsReIndexing.begin(), NeedsReIndexing.end(),
                      std::mt19937(std::random_device{}()));
+        prioritize(NeedsReIndexing);
         for (auto &Elem : NeedsReIndexing)
           enqueue(std::move(Elem.first), Elem.second);
       },
       ThreadPriority::Normal);
 }
 
+void BackgroundIndex::filesChanged(llvm::ArrayRef<std::string> ChangedFiles) {
+  {
+    std::lock_guard<std::mutex> Lock(ChangesMu);
+    for (const std::string &File : ChangedFiles)
+      PendingChanges.insert(File);
+    if (ChangesQueued)
+      return;
+    ChangesQueued = true;
+  }
+  enqueueTask(
+      [this] {
+        llvm::StringSet<> Changes;
+        {
+          std::lock_guard<std::mutex> Lock(ChangesMu);
+          Changes = std::move(PendingChanges);
+          PendingChanges.clear();
+          ChangesQueued = false;
+        }
+        // A changed header is re-indexed by a TU that includes it. Stale
+        // files are found by comparing digests, as with any enqueued TU.
+        std::vector<std::string> TUs;
+        llvm::StringSet<> SeenTUs;
+        {
+          auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
+          for (const auto &File : Changes) {
+            auto It = IndexedBy.find(File.getKey());
+            if (It != IndexedBy.end() && SeenTUs.insert(It->second).second)
+              TUs.push_back(It->second);
+          }
+        }
+        vlog("BackgroundIndex: {0} changed files affect {1} TUs",
+             Changes.size(), TUs.size());
+        if (!TUs.empty())
+          enqueue(TUs);
+      },
+      ThreadPriority::Normal);
+}
+
 void BackgroundIndex::enqueue(tooling::CompileCommand Cmd,
                               BackgroundIndexStorage *Storage) {
+  // Tasks are tagged with the directory of their file, see boostRelated().
+  std::string Dir = llvm::sys::path::parent_path(getAbsolutePath(Cmd));
   enqueueTask(Bind(
                   [this, Storage](tooling::CompileCommand Cmd) {
                     // We can't use llvm::StringRef here since we are going to
@@ -238,25 +252,173 @@ void BackgroundIndex::enqueue(tooling::CompileCommand Cmd,
                            std::move(Error));
                   },
                   std::move(Cmd)),
-              ThreadPriority::Low);
+              ThreadPriority::Low, Dir);
+}
+
+// Number of background indexing tasks waiting to run.
+constexpr trace::Metric BackgroundBacklog("background_index_backlog",
+                                          trace::Metric::Value);
+constexpr trace::Metric IndexMemory("index_memory", trace::Metric::Value,
+                                    "index");
+
+void BackgroundIndex::enqueueTask(Task T, ThreadPriority Priority,
+                                  llvm::StringRef Tag) {
+  Pool.enqueue(Bind(
+                   [this](Task T) {
+                     WithContext Background(BackgroundContext.clone());
+                     BackgroundBacklog.record(Pool.pendingTasks());
+                     T();
+                   },
+                   std::move(T)),
+               Priority, Tag);
+  BackgroundBacklog.record(Pool.pendingTasks());
+}
+
+// Only the last few opened files matter, older ones are stale context.
+constexpr size_t MaxRecentlyBoosted = 8;
+
+void BackgroundIndex::boostRelated(llvm::StringRef Path) {
+  {
+    std::lock_guard<std::mutex> Lock(BoostMu);
+    // Files are boosted whenever they change, avoid repeating the work.
+    if (!RecentlyBoosted.empty() && RecentlyBoosted.front() == Path)
+      return;
+    RecentlyBoosted.erase(llvm::remove_if(RecentlyBoosted,
+                                          [&](const std::string &Recent) {
+                                            return Recent == Path;
+                                          }),
+                          RecentlyBoosted.end());
+    RecentlyBoosted.push_front(Path);
+    if (RecentlyBoosted.size() > MaxRecentlyBoosted)
+      RecentlyBoosted.pop_back();
+  }
+  Pool.boost(llvm::sys::path::parent_path(Path));
+}
+
+std::unique_ptr<FileDistance> BackgroundIndex::boostedDistance() {
+  llvm::StringMap<SourceParams> Sources;
+  {
+    std::lock_guard<std::mutex> Lock(BoostMu);
+    // More recently boosted files give a head start.
+    for (size_t I = 0; I < RecentlyBoosted.size(); ++I)
+      Sources[RecentlyBoosted[I]].Cost = I;
+  }
+  if (Sources.empty())
+    return nullptr;
+  return llvm::make_unique<FileDistance>(std::move(Sources));
+}
+
+void BackgroundIndex::prioritize(
+    std::vector<std::pair<tooling::CompileCommand, BackgroundIndexStorage *>>
+        &Cmds) {
+  auto Distance = boostedDistance();
+  if (!Distance)
+    return;
+  std::vector<std::pair<unsigned, size_t>> Order; // (Distance, Index in Cmds)
+  for (size_t I = 0; I < Cmds.size(); ++I)
+    Order.emplace_back(Distance->distance(getAbsolutePath(Cmds[I].first)), I);
+  llvm::sort(Order);
+  std::vector<std::pair<tooling::CompileCommand, BackgroundIndexStorage *>>
+      Sorted;
+  Sorted.reserve(Cmds.size());
+  for (const auto &Entry : Order)
+    Sorted.push_back(std::move(Cmds[Entry.second]));
+  Cmds = std::move(Sorted);
+}
+
+std::unique_ptr<RefSlab>
+BackgroundIndex::keepRefsInMemory(llvm::StringRef Path,
+                                  std::unique_ptr<RefSlab> Refs,
+                                  BackgroundIndexStorage *Storage,
+                                  FileDistance *Distance) {
+  if (!ColdRefsDistance)
+    return Refs;
+  bool Cold = Refs && !Refs->empty() && Storage &&
+              (!Distance || Distance->distance(Path) > *ColdRefsDistance);
+  std::lock_guard<std::mutex> Lock(ColdRefsMu);
+  auto Inserted = ColdFileIDs.try_emplace(Path, ColdFiles.size());
+  if (!Cold) {
+    if (!Inserted.second)
+      ColdFiles[Inserted.first->second].second = nullptr;
+    else
+      ColdFileIDs.erase(Inserted.first);
+    return Refs;
+  }
+  unsigned FileID = Inserted.first->second;
+  if (Inserted.second)
+    ColdFiles.emplace_back(Path, Storage);
+  else
+    ColdFiles[FileID].second = Storage;
+  for (const auto &SymRefs : *Refs) {
+    auto &Files = ColdRefFiles[SymRefs.first];
+    if (Files.empty() || Files.back() != FileID)
+      Files.push_back(FileID);
+  }
+  return nullptr;
 }
 
-void BackgroundIndex::enqueueTask(Task T, ThreadPriority Priority) {
+void BackgroundIndex::refs(
+    const RefsRequest &Req,
+    llvm::function_ref<void(const Ref &)> Callback) const {
+  uint32_t Remaining =
+      Req.Limit.getValueOr(std::numeric_limits<uint32_t>::max());
+  SwapIndex::refs(Req, [&](const Ref &R) {
+    if (Remaining) {
+      --Remaining;
+      Callback(R);
+    }
+  });
+  if (!ColdRefsDistance || !Remaining)
+    return;
+
+  std::vector<std::pair<std::string, BackgroundIndexStorage *>> Files;
   {
-    std::lock_guard<std::mutex> Lock(QueueMu);
-    auto I = Queue.end();
-    // We first store the tasks with Normal priority in the front of the queue.
-    // Then we store low priority tasks. Normal priority tasks are pretty rare,
-    // they should not grow beyond single-digit numbers, so it is OK to do
-    // linear search and insert after that.
-    if (Priority == ThreadPriority::Normal) {
-      I = llvm::find_if(Queue, [](const std::pair<Task, ThreadPriority> &Elem) {
-        return Elem.second == ThreadPriority::Low;
-      });
+    std::lock_guard<std::mutex> Lock(ColdRefsMu);
+    std::vector<unsigned> FileIDs;
+    for (const SymbolID &ID : Req.IDs) {
+      auto It = ColdRefFiles.find(ID);
+      if (It != ColdRefFiles.end())
+        FileIDs.insert(FileIDs.end(), It->second.begin(), It->second.end());
     }
-    Queue.insert(I, {std::move(T), Priority});
+    llvm::sort(FileIDs);
+    FileIDs.erase(std::unique(FileIDs.begin(), FileIDs.end()), FileIDs.end());
+    for (unsigned FileID : FileIDs)
+      if (ColdFiles[FileID].second)
+        Files.push_back(ColdFiles[FileID]);
+  }
+  if (Files.empty())
+    return;
+  trace::Span Tracer("BackgroundIndexColdRefs");
+  SPAN_ATTACH(Tracer, "files", int64_t(Files.size()));
+  for (const auto &File : Files) {
+    auto Shard = File.second->loadShard(File.first);
+    if (!Shard || !Shard->Refs)
+      continue;
+    for (const auto &SymRefs : *Shard->Refs) {
+      if (!Req.IDs.count(SymRefs.first))
+        continue;
+      for (const Ref &R : SymRefs.second) {
+        if (!static_cast<int>(Req.Filter & R.Kind))
+          continue;
+        if (!Remaining)
+          return;
+        --Remaining;
+        Callback(R);
+      }
+    }
+  }
+}
+
+size_t BackgroundIndex::estimateMemoryUsage() const {
+  size_t Bytes = SwapIndex::estimateMemoryUsage();
+  if (ColdRefsDistance) {
+    std::lock_guard<std::mutex> Lock(ColdRefsMu);
+    Bytes += ColdRefFiles.getMemorySize();
+    for (const auto &SymFiles : ColdRefFiles)
+      Bytes += SymFiles.second.capacity() * sizeof(unsigned);
+    Bytes += ColdFiles.capacity() * sizeof(ColdFiles.front());
   }
-  QueueCV.notify_all();
+  return Bytes;
 }
 
 /// Given index results from a TU, only update symbols coming from files that
@@ -264,18 +426,25 @@ void BackgroundIndex::enqueueTask(Task T, ThreadPriority Priority) {
 /// information on IndexStorage.
 void BackgroundIndex::update(llvm::StringRef MainFile, IndexFileIn Index,
                              const llvm::StringMap<FileDigest> &DigestsSnapshot,
+                             const llvm::StringSet<> &ClaimedElsewhere,
                              BackgroundIndexStorage *IndexStorage) {
   // Partition symbols/references into files.
   struct File {
     llvm::DenseSet<const Symbol *> Symbols;
     llvm::DenseSet<const Ref *> Refs;
+    llvm::DenseSet<const Relation *> Relations;
     FileDigest Digest;
   };
   llvm::StringMap<File> Files;
   URIToFileCache URICache(MainFile);
+  std::vector<llvm::StringRef> SeenFiles;
   for (const auto &IndexIt : *Index.Sources) {
     const auto &IGN = IndexIt.getValue();
     const auto AbsPath = URICache.resolve(IGN.URI);
+    SeenFiles.push_back(AbsPath);
+    // Another TU collects the symbols of this file.
+    if (ClaimedElsewhere.count(AbsPath))
+      continue;
     const auto DigestIt = DigestsSnapshot.find(AbsPath);
     // File has different contents.
     if (DigestIt == DigestsSnapshot.end() || DigestIt->getValue() != IGN.Digest)
@@ -300,6 +469,18 @@ void BackgroundIndex::update(llvm::StringRef MainFile, IndexFileIn Index,
         FileIt->second.Symbols.insert(&Sym);
     }
   }
+  // Relations are stored with the declaration of their object.
+  if (Index.Relations) {
+    for (const auto &R : *Index.Relations) {
+      auto It = Index.Symbols->find(R.Object);
+      if (It == Index.Symbols->end() || !It->CanonicalDeclaration)
+        continue;
+      auto FileIt =
+          Files.find(URICache.resolve(It->CanonicalDeclaration.FileURI));
+      if (FileIt != Files.end())
+        FileIt->second.Relations.insert(&R);
+    }
+  }
   llvm::DenseMap<const Ref *, SymbolID> RefToIDs;
   for (const auto &SymRefs : *Index.Refs) {
     for (const auto &R : SymRefs.second) {
@@ -313,33 +494,60 @@ void BackgroundIndex::update(llvm::StringRef MainFile, IndexFileIn Index,
     }
   }
 
+  {
+    auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
+    for (llvm::StringRef Path : SeenFiles)
+      IndexedBy[Path] = MainFile;
+  }
+  if (FileNames)
+    for (llvm::StringRef Path : SeenFiles)
+      FileNames->addFile(Path);
+
+  auto Distance = ColdRefsDistance ? boostedDistance() : nullptr;
   // Build and store new slabs for each updated file.
   for (const auto &FileIt : Files) {
     llvm::StringRef Path = FileIt.getKey();
-    SymbolSlab::Builder Syms;
-    RefSlab::Builder Refs;
+    {
+      // Another TU may have indexed the file since DigestsSnapshot was taken,
+      // and already stored the same shard.
+      auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
+      auto DigestIt = IndexedFileDigests.find(Path);
+      if (DigestIt != IndexedFileDigests.end() &&
+          DigestIt->second == FileIt.second.Digest)
+        continue;
+    }
+    SymbolSlab::Builder Syms(SharedStringPool::global());
+    RefSlab::Builder Refs(SharedStringPool::global());
+    RelationSlab::Builder Relations;
     for (const auto *S : FileIt.second.Symbols)
       Syms.insert(*S);
     for (const auto *R : FileIt.second.Refs)
       Refs.insert(RefToIDs[R], *R);
+    for (const auto *R : FileIt.second.Relations)
+      Relations.insert(*R);
     auto SS = llvm::make_unique<SymbolSlab>(std::move(Syms).build());
     auto RS = llvm::make_unique<RefSlab>(std::move(Refs).build());
+    auto RelS = llvm::make_unique<RelationSlab>(std::move(Relations).build());
     auto IG = llvm::make_unique<IncludeGraph>(
         getSubGraph(URI::create(Path), Index.Sources.getValue()));
     // We need to store shards before updating the index, since the latter
-    // consumes slabs.
+    // consumes slabs. Refs can only be left out of memory if they were stored.
+    BackgroundIndexStorage *RefsStorage = IndexStorage;
     if (IndexStorage) {
       IndexFileOut Shard;
       Shard.Symbols = SS.get();
       Shard.Refs = RS.get();
+      Shard.Relations = RelS.get();
       Shard.Sources = IG.get();
 
-      if (auto Error = IndexStorage->storeShard(Path, Shard))
+      if (auto Error = IndexStorage->storeShard(Path, Shard)) {
         elog("Failed to write background-index shard for file {0}: {1}", Path,
              std::move(Error));
+        RefsStorage = nullptr;
+      }
     }
     {
-      std::lock_guard<std::mutex> Lock(DigestsMu);
+      auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
       auto Hash = FileIt.second.Digest;
       // Skip if file is already up to date.
       auto DigestIt = IndexedFileDigests.try_emplace(Path);
@@ -349,7 +557,10 @@ void BackgroundIndex::update(llvm::StringRef MainFile, IndexFileIn Index,
       // This can override a newer version that is added in another thread, if
       // this thread sees the older version but finishes later. This should be
       // rare in practice.
-      IndexedSymbols.update(Path, std::move(SS), std::move(RS));
+      IndexedSymbols.update(
+          Path, std::move(SS),
+          keepRefsInMemory(Path, std::move(RS), RefsStorage, Distance.get()),
+          std::move(RelS));
     }
   }
 }
@@ -377,6 +588,7 @@ void BackgroundIndex::buildIndex() {
     log("BackgroundIndex: rebuilt symbol index with estimated memory {0} "
         "bytes.",
         estimateMemoryUsage());
+    IndexMemory.record(estimateMemoryUsage(), "background");
   }
 }
 
@@ -395,7 +607,7 @@ llvm::Error BackgroundIndex::index(tooling::CompileCommand Cmd,
   // Take a snapshot of the digests to avoid locking for each file in the TU.
   llvm::StringMap<FileDigest> DigestsSnapshot;
   {
-    std::lock_guard<std::mutex> Lock(DigestsMu);
+    auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
     DigestsSnapshot = IndexedFileDigests;
   }
 
@@ -416,12 +628,36 @@ llvm::Error BackgroundIndex::index(tooling::CompileCommand Cmd,
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "Couldn't build compiler instance");
 
+  // Files this TU collects symbols for, which concurrently indexed TUs skip.
+  // Files claimed by other TUs are skipped here in turn, so that the symbols
+  // of a header included everywhere are only collected and stored once.
+  llvm::StringSet<> Claimed, ClaimedElsewhere;
+  auto ReleaseClaims = llvm::make_scope_exit([&] {
+    auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
+    for (const auto &Path : Claimed)
+      ClaimedFiles.erase(Path.getKey());
+  });
+  auto Claim = [&](llvm::StringRef Path, const FileDigest &Digest) {
+    auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
+    auto Inserted = ClaimedFiles.try_emplace(Path, Digest);
+    if (Inserted.second) {
+      Claimed.insert(Path);
+      return true;
+    }
+    // A different version is being indexed, don't rely on it.
+    if (Inserted.first->second != Digest)
+      return true;
+    ClaimedElsewhere.insert(Path);
+    return false;
+  };
+
   SymbolCollector::Options IndexOpts;
-  IndexOpts.FileFilter = createFileFilter(DigestsSnapshot);
+  IndexOpts.FileFilter = createFileFilter(DigestsSnapshot, Claim);
   IndexFileIn Index;
   auto Action = createStaticIndexingAction(
       IndexOpts, [&](SymbolSlab S) { Index.Symbols = std::move(S); },
       [&](RefSlab R) { Index.Refs = std::move(R); },
+      [&](RelationSlab R) { Index.Relations = std::move(R); },
       [&](IncludeGraph IG) { Index.Sources = std::move(IG); });
 
   // We're going to run clang here, and it could potentially crash.
@@ -454,7 +690,8 @@ llvm::Error BackgroundIndex::index(tooling::CompileCommand Cmd,
   SPAN_ATTACH(Tracer, "refs", int(Index.Refs->numRefs()));
   SPAN_ATTACH(Tracer, "sources", int(Index.Sources->size()));
 
-  update(AbsolutePath, std::move(Index), DigestsSnapshot, IndexStorage);
+  update(AbsolutePath, std::move(Index), DigestsSnapshot, ClaimedElsewhere,
+         IndexStorage);
 
   if (BuildIndexPeriodMs > 0)
     SymbolsUpdatedSinceLastIndex = true;
@@ -465,143 +702,215 @@ llvm::Error BackgroundIndex::index(tooling::CompileCommand Cmd,
   return llvm::Error::success();
 }
 
-std::vector<BackgroundIndex::Source>
-BackgroundIndex::loadShard(const tooling::CompileCommand &Cmd,
-                           BackgroundIndexStorage *IndexStorage,
-                           llvm::StringSet<> &LoadedShards) {
-  struct ShardInfo {
-    std::string AbsolutePath;
-    std::unique_ptr<IndexFileIn> Shard;
-    FileDigest Digest;
-  };
-  std::vector<ShardInfo> IntermediateSymbols;
-  // Make sure we don't have duplicate elements in the queue. Keys are absolute
-  // paths.
-  llvm::StringSet<> InQueue;
-  auto FS = FSProvider.getFileSystem();
-  // Dependencies of this TU, paired with the information about whether they
-  // need to be re-indexed or not.
-  std::vector<Source> Dependencies;
-  std::queue<Source> ToVisit;
-  std::string AbsolutePath = getAbsolutePath(Cmd).str();
-  // Up until we load the shard related to a dependency it needs to be
-  // re-indexed.
-  ToVisit.emplace(AbsolutePath, true);
-  InQueue.insert(AbsolutePath);
-  // Goes over each dependency.
-  while (!ToVisit.empty()) {
-    Dependencies.push_back(std::move(ToVisit.front()));
-    // Dependencies is not modified during the rest of the loop, so it is safe
-    // to keep the reference.
-    auto &CurDependency = Dependencies.back();
-    ToVisit.pop();
-    // If we have already seen this shard before(either loaded or failed) don't
-    // re-try again. Since the information in the shard won't change from one TU
-    // to another.
-    if (!LoadedShards.try_emplace(CurDependency.Path).second) {
-      // If the dependency needs to be re-indexed, first occurence would already
-      // have detected that, so we don't need to issue it again.
-      CurDependency.NeedsReIndexing = false;
+namespace {
+// Shards read by fewer workers than this aren't worth spawning a thread for.
+constexpr size_t MinShardsPerWorker = 8;
+} // namespace
+
+void BackgroundIndex::loadShard(LoadedShard &LS,
+                                llvm::vfs::FileSystem &FS) const {
+  LS.Shard = LS.Storage->loadShard(LS.AbsolutePath);
+  if (!LS.Shard || !LS.Shard->Sources) {
+    // File will be returned as requiring re-indexing to caller.
+    vlog("Failed to load shard: {0}", LS.AbsolutePath);
+    LS.Shard.reset();
+    return;
+  }
+  // These are the edges in the include graph for current dependency.
+  for (const auto &I : *LS.Shard->Sources) {
+    auto U = URI::parse(I.getKey());
+    if (!U)
+      continue;
+    auto AbsolutePath = URI::resolve(*U, LS.AbsolutePath);
+    if (!AbsolutePath)
+      continue;
+    // The node contains symbol information only for current file, the rest is
+    // just edges.
+    if (*AbsolutePath != LS.AbsolutePath) {
+      LS.Dependencies.push_back(std::move(*AbsolutePath));
       continue;
     }
 
-    auto Shard = IndexStorage->loadShard(CurDependency.Path);
-    if (!Shard || !Shard->Sources) {
-      // File will be returned as requiring re-indexing to caller.
-      vlog("Failed to load shard: {0}", CurDependency.Path);
+    // We found source file info for current dependency.
+    assert(I.getValue().Digest != FileDigest{{0}} && "Digest is empty?");
+    LS.HasSymbols = true;
+    LS.Digest = I.getValue().Digest;
+    // Check if the source needs re-indexing.
+    // Get the digest, skip it if file doesn't exist.
+    auto Digest = digestFile(FS, LS.AbsolutePath);
+    if (!Digest)
       continue;
-    }
-    // These are the edges in the include graph for current dependency.
-    for (const auto &I : *Shard->Sources) {
-      auto U = URI::parse(I.getKey());
-      if (!U)
-        continue;
-      auto AbsolutePath = URI::resolve(*U, CurDependency.Path);
-      if (!AbsolutePath)
-        continue;
-      // Add file as dependency if haven't seen before.
-      if (InQueue.try_emplace(*AbsolutePath).second)
-        ToVisit.emplace(*AbsolutePath, true);
-      // The node contains symbol information only for current file, the rest is
-      // just edges.
-      if (*AbsolutePath != CurDependency.Path)
-        continue;
+    // If digests match then dependency doesn't need re-indexing.
+    LS.NeedsReIndexing = *Digest != LS.Digest;
+  }
+}
 
-      // We found source file info for current dependency.
-      assert(I.getValue().Digest != FileDigest{{0}} && "Digest is empty?");
-      ShardInfo SI;
-      SI.AbsolutePath = CurDependency.Path;
-      SI.Shard = std::move(Shard);
-      SI.Digest = I.getValue().Digest;
-      IntermediateSymbols.push_back(std::move(SI));
-      // Check if the source needs re-indexing.
-      // Get the digest, skip it if file doesn't exist.
-      auto Buf = FS->getBufferForFile(CurDependency.Path);
-      if (!Buf) {
-        elog("Couldn't get buffer for file: {0}: {1}", CurDependency.Path,
-             Buf.getError().message());
-        continue;
-      }
-      // If digests match then dependency doesn't need re-indexing.
-      CurDependency.NeedsReIndexing =
-          digest(Buf->get()->getBuffer()) != I.getValue().Digest;
-    }
+llvm::Optional<FileDigest>
+BackgroundIndex::digestFile(llvm::vfs::FileSystem &FS,
+                            llvm::StringRef Path) const {
+  auto Status = FS.status(Path);
+  if (Status) {
+    std::lock_guard<std::mutex> Lock(DigestCacheMu);
+    auto It = DigestCache.find(Path);
+    if (It != DigestCache.end() &&
+        It->getValue().ModificationTime == Status->getLastModificationTime() &&
+        It->getValue().Size == Status->getSize())
+      return It->getValue().Digest;
   }
-  // Load shard information into background-index.
-  {
-    std::lock_guard<std::mutex> Lock(DigestsMu);
-    // This can override a newer version that is added in another thread,
-    // if this thread sees the older version but finishes later. This
-    // should be rare in practice.
-    for (const ShardInfo &SI : IntermediateSymbols) {
-      auto SS =
-          SI.Shard->Symbols
-              ? llvm::make_unique<SymbolSlab>(std::move(*SI.Shard->Symbols))
-              : nullptr;
-      auto RS = SI.Shard->Refs
-                    ? llvm::make_unique<RefSlab>(std::move(*SI.Shard->Refs))
-                    : nullptr;
-      IndexedFileDigests[SI.AbsolutePath] = SI.Digest;
-      IndexedSymbols.update(SI.AbsolutePath, std::move(SS), std::move(RS));
-    }
+  auto Buf = FS.getBufferForFile(Path);
+  if (!Buf) {
+    elog("Couldn't get buffer for file: {0}: {1}", Path,
+         Buf.getError().message());
+    return llvm::None;
   }
-
-  return Dependencies;
+  FileDigest Digest = digest(Buf->get()->getBuffer());
+  if (Status) {
+    std::lock_guard<std::mutex> Lock(DigestCacheMu);
+    DigestCache[Path] = {Status->getLastModificationTime(), Status->getSize(),
+                         Digest};
+  }
+  return Digest;
 }
 
 // Goes over each changed file and loads them from index. Returns the list of
 // TUs that had out-of-date/no shards.
 std::vector<std::pair<tooling::CompileCommand, BackgroundIndexStorage *>>
 BackgroundIndex::loadShards(std::vector<std::string> ChangedFiles) {
-  std::vector<std::pair<tooling::CompileCommand, BackgroundIndexStorage *>>
-      NeedsReIndexing;
-  // Keeps track of the files that will be reindexed, to make sure we won't
-  // re-index same dependencies more than once. Keys are AbsolutePaths.
-  llvm::StringSet<> FilesToIndex;
-  // Keeps track of the loaded shards to make sure we don't perform redundant
-  // disk IO. Keys are absolute paths.
-  llvm::StringSet<> LoadedShards;
+  struct TU {
+    tooling::CompileCommand Cmd;
+    BackgroundIndexStorage *Storage;
+    std::string AbsolutePath;
+  };
+  std::vector<TU> TUs;
+  // Every shard that was loaded (or failed to load), keyed by absolute path.
+  // Entries are never moved, so the pointers below stay valid.
+  llvm::StringMap<LoadedShard> Shards;
+  std::vector<LoadedShard *> Wave;
+  auto AddShard = [&](llvm::StringRef Path, BackgroundIndexStorage *Storage) {
+    auto Inserted = Shards.try_emplace(Path);
+    if (!Inserted.second)
+      return;
+    LoadedShard &LS = Inserted.first->getValue();
+    LS.AbsolutePath = Path;
+    LS.Storage = Storage;
+    Wave.push_back(&LS);
+  };
   for (const auto &File : ChangedFiles) {
     ProjectInfo PI;
     auto Cmd = CDB.getCompileCommand(File, &PI);
     if (!Cmd)
       continue;
     BackgroundIndexStorage *IndexStorage = IndexStorageFactory(PI.SourceRoot);
-    auto Dependencies = loadShard(*Cmd, IndexStorage, LoadedShards);
-    for (const auto &Dependency : Dependencies) {
-      if (!Dependency.NeedsReIndexing || FilesToIndex.count(Dependency.Path))
+    std::string AbsolutePath = getAbsolutePath(*Cmd).str();
+    AddShard(AbsolutePath, IndexStorage);
+    TUs.push_back({std::move(*Cmd), IndexStorage, std::move(AbsolutePath)});
+  }
+
+  // Shards are loaded in waves: the shards found so far are read, decoded and
+  // checked for staleness in parallel. The files they depend on, as recorded
+  // in their include graphs, make up the next wave.
+  while (!Wave.empty()) {
+    std::atomic<size_t> Next(0);
+    auto LoadWave = [&] {
+      auto FS = FSProvider.getFileSystem();
+      for (size_t I = Next++; I < Wave.size(); I = Next++)
+        loadShard(*Wave[I], *FS);
+    };
+    size_t NumWorkers = std::max<size_t>(
+        1, std::min<size_t>(llvm::heavyweight_hardware_concurrency(),
+                            Wave.size() / MinShardsPerWorker));
+    if (NumWorkers == 1) {
+      LoadWave();
+    } else {
+      AsyncTaskRunner Runner;
+      for (size_t Worker = 0; Worker < NumWorkers; ++Worker)
+        Runner.runAsync("load-shards:" + llvm::Twine(Worker), LoadWave);
+      Runner.wait();
+    }
+    std::vector<LoadedShard *> Loaded = std::move(Wave);
+    Wave.clear();
+    for (LoadedShard *LS : Loaded)
+      for (const std::string &Dependency : LS->Dependencies)
+        AddShard(Dependency, LS->Storage);
+  }
+
+  std::vector<std::pair<tooling::CompileCommand, BackgroundIndexStorage *>>
+      NeedsReIndexing;
+  // Keeps track of the files that will be reindexed, to make sure we won't
+  // re-index same dependencies more than once. Keys are AbsolutePaths.
+  llvm::StringSet<> FilesToIndex;
+  // Shards already attributed to a TU. A TU doesn't look further than those:
+  // if they need re-indexing, the first TU seeing them already took care of it.
+  llvm::StringSet<> SeenShards;
+  // For each shard, the first TU that reached it.
+  llvm::StringMap<std::string> SeenBy;
+  for (TU &T : TUs) {
+    // Dependencies of this TU, in the order they are reached from it.
+    std::vector<const LoadedShard *> Dependencies;
+    llvm::StringSet<> InQueue;
+    std::queue<const LoadedShard *> ToVisit;
+    ToVisit.push(&Shards.find(T.AbsolutePath)->getValue());
+    InQueue.insert(T.AbsolutePath);
+    const LoadedShard *StaleDependency = nullptr;
+    while (!ToVisit.empty()) {
+      const LoadedShard *LS = ToVisit.front();
+      ToVisit.pop();
+      Dependencies.push_back(LS);
+      SeenBy.try_emplace(LS->AbsolutePath, T.AbsolutePath);
+      if (!SeenShards.insert(LS->AbsolutePath).second)
         continue;
-      // FIXME: Currently, we simply schedule indexing on a TU whenever any of
-      // its dependencies needs re-indexing. We might do it smarter by figuring
-      // out a minimal set of TUs that will cover all the stale dependencies.
-      vlog("Enqueueing TU {0} because its dependency {1} needs re-indexing.",
-           Cmd->Filename, Dependency.Path);
-      NeedsReIndexing.push_back({std::move(*Cmd), IndexStorage});
-      // Mark all of this TU's dependencies as to-be-indexed so that we won't
-      // try to re-index those.
-      for (const auto &Dependency : Dependencies)
-        FilesToIndex.insert(Dependency.Path);
-      break;
+      if (!StaleDependency && LS->NeedsReIndexing &&
+          !FilesToIndex.count(LS->AbsolutePath))
+        StaleDependency = LS;
+      for (const std::string &Dependency : LS->Dependencies)
+        if (InQueue.insert(Dependency).second)
+          ToVisit.push(&Shards.find(Dependency)->getValue());
+    }
+    if (!StaleDependency)
+      continue;
+    // FIXME: Currently, we simply schedule indexing on a TU whenever any of
+    // its dependencies needs re-indexing. We might do it smarter by figuring
+    // out a minimal set of TUs that will cover all the stale dependencies.
+    vlog("Enqueueing TU {0} because its dependency {1} needs re-indexing.",
+         T.Cmd.Filename, StaleDependency->AbsolutePath);
+    NeedsReIndexing.push_back({std::move(T.Cmd), T.Storage});
+    // Mark all of this TU's dependencies as to-be-indexed so that we won't
+    // try to re-index those.
+    for (const LoadedShard *Dependency : Dependencies)
+      FilesToIndex.insert(Dependency->AbsolutePath);
+  }
+
+  // Load shard information into background-index, all at once.
+  auto Distance = ColdRefsDistance ? boostedDistance() : nullptr;
+  {
+    auto Lock = lockAccounted(DigestsMu, "BackgroundIndex::DigestsMu");
+    // This can override a newer version that is added in another thread,
+    // if this thread sees the older version but finishes later. This
+    // should be rare in practice.
+    for (auto &Entry : SeenBy) {
+      if (FileNames)
+        FileNames->addFile(Entry.getKey());
+      IndexedBy[Entry.getKey()] = std::move(Entry.getValue());
+    }
+    for (auto &Entry : Shards) {
+      LoadedShard &LS = Entry.getValue();
+      if (!LS.HasSymbols)
+        continue;
+      auto SS =
+          LS.Shard->Symbols
+              ? llvm::make_unique<SymbolSlab>(std::move(*LS.Shard->Symbols))
+              : nullptr;
+      auto RS = LS.Shard->Refs
+                    ? llvm::make_unique<RefSlab>(std::move(*LS.Shard->Refs))
+                    : nullptr;
+      auto RelS = LS.Shard->Relations ? llvm::make_unique<RelationSlab>(
+                                            std::move(*LS.Shard->Relations))
+                                      : nullptr;
+      IndexedFileDigests[LS.AbsolutePath] = LS.Digest;
+      IndexedSymbols.update(LS.AbsolutePath, std::move(SS),
+                            keepRefsInMemory(LS.AbsolutePath, std::move(RS),
+                                             LS.Storage, Distance.get()),
+                            std::move(RelS));
     }
   }
   vlog("Loaded all shards");
@@ -609,6 +918,7 @@ BackgroundIndex::loadShards(std::vector<std::string> ChangedFiles) {
   vlog("BackgroundIndex: built symbol index with estimated memory {0} "
        "bytes.",
        estimateMemoryUsage());
+  IndexMemory.record(estimateMemoryUsage(), "background");
   return NeedsReIndexing;
 }
 
@@ -11,13 +11,17 @@
 
 #include "Context.h"
 #include "FSProvider.h"
+#include "FileDistance.h"
+#include "FileNameIndex.h"
 #include "GlobalCompilationDatabase.h"
 #include "Threading.h"
 #include "index/FileIndex.h"
 #include "index/Index.h"
 #include "index/Serialization.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/Threading.h"
 #include <atomic>
@@ -43,7 +47,7 @@ public:
                                  IndexFileOut Shard) const = 0;
 
   // Tries to load shard with given identifier, returns nullptr if shard
-  // couldn't be loaded.
+  // couldn't be loaded. May be called concurrently for different shards.
   virtual std::unique_ptr<IndexFileIn>
   loadShard(llvm::StringRef ShardIdentifier) const = 0;
 
@@ -56,23 +60,38 @@ public:
   // Creates an Index Storage that saves shards into disk. Index storage uses
   // CDBDirectory + ".clangd/index/" as the folder to save shards.
   static Factory createDiskBackedStorageFactory();
+
+  // Like createDiskBackedStorageFactory, but packs all shards of a CDB into a
+  // few append-only files instead of one file per shard, which is faster to
+  // load on slow file systems. A storage directory must not be used by several
+  // clangd processes at once.
+  static Factory createPackedStorageFactory();
 };
 
 // Builds an in-memory index by by running the static indexer action over
 // all commands in a compilation database. Indexing happens in the background.
 // FIXME: it should also persist its state on disk for fast start.
-// FIXME: it should watch for changes to files on disk.
+// Files changing on disk are only noticed when reported through
+// filesChanged().
 class BackgroundIndex : public SwapIndex {
 public:
   /// If BuildIndexPeriodMs is greater than 0, the symbol index will only be
   /// rebuilt periodically (one per \p BuildIndexPeriodMs); otherwise, index is
   /// rebuilt for each indexed file.
+  /// If \p ConcurrencyLimit is set, files are only indexed in its idle slots,
+  /// so indexing doesn't compete with foreground work for cores.
+  /// If \p ColdRefsDistance is set, refs of files further than this from the
+  /// recently boosted files (as measured by FileDistance) are not kept in
+  /// memory. They are loaded from the shards of these files by refs().
   BackgroundIndex(
       Context BackgroundContext, const FileSystemProvider &,
       const GlobalCompilationDatabase &CDB,
       BackgroundIndexStorage::Factory IndexStorageFactory,
       size_t BuildIndexPeriodMs = 0,
-      size_t ThreadPoolSize = llvm::heavyweight_hardware_concurrency());
+      size_t ThreadPoolSize = llvm::heavyweight_hardware_concurrency(),
+      std::shared_ptr<Semaphore> ConcurrencyLimit = nullptr,
+      llvm::Optional<unsigned> ColdRefsDistance = llvm::None,
+      FileNameIndex *FileNames = nullptr);
   ~BackgroundIndex(); // Blocks while the current task finishes.
 
   // Enqueue translation units for indexing.
@@ -80,10 +99,27 @@ public:
   // available sometime later.
   void enqueue(const std::vector<std::string> &ChangedFiles);
 
+  // Re-indexes the TUs that saw any of \p ChangedFiles when they were last
+  // indexed, e.g. after the client reported the files as changed on disk.
+  // Files no indexed TU saw are ignored. Changes reported before an earlier
+  // batch is processed are merged into it.
+  void filesChanged(llvm::ArrayRef<std::string> ChangedFiles);
+
   // Cause background threads to stop after ther current task, any remaining
   // tasks will be discarded.
   void stop();
 
+  // Indexes the queued files in the directory of \p Path before the others,
+  // and favors files close to \p Path when queueing files later on. Called
+  // when the user opens \p Path, as they are likely to work nearby.
+  void boostRelated(llvm::StringRef Path);
+
+  // Also returns the refs of files kept on disk, see ColdRefsDistance.
+  void refs(const RefsRequest &,
+            llvm::function_ref<void(const Ref &)>) const override;
+
+  size_t estimateMemoryUsage() const override;
+
   // Wait until the queue is empty, to allow deterministic testing.
   LLVM_NODISCARD bool
   blockUntilIdleForTest(llvm::Optional<double> TimeoutSeconds = 10);
@@ -92,8 +128,11 @@ private:
   /// Given index results from a TU, only update symbols coming from files with
   /// different digests than \p DigestsSnapshot. Also stores new index
   /// information on IndexStorage.
+  /// Files in \p ClaimedElsewhere are skipped, their symbols are collected by
+  /// another TU.
   void update(llvm::StringRef MainFile, IndexFileIn Index,
               const llvm::StringMap<FileDigest> &DigestsSnapshot,
+              const llvm::StringSet<> &ClaimedElsewhere,
               BackgroundIndexStorage *IndexStorage);
 
   // configuration
@@ -109,40 +148,98 @@ private:
   std::atomic<bool> SymbolsUpdatedSinceLastIndex;
   std::mutex IndexMu;
   std::condition_variable IndexCV;
+  bool ShouldStop = false;
 
   FileSymbols IndexedSymbols;
   llvm::StringMap<FileDigest> IndexedFileDigests; // Key is absolute file path.
+  // Files whose symbols are being collected by a TU that is being indexed,
+  // and the digest of the contents it sees. Guarded by DigestsMu.
+  llvm::StringMap<FileDigest> ClaimedFiles;
+  // For each file seen by an indexed TU, the main file of such a TU. Guarded
+  // by DigestsMu.
+  llvm::StringMap<std::string> IndexedBy;
   std::mutex DigestsMu;
 
   BackgroundIndexStorage::Factory IndexStorageFactory;
-  struct Source {
-    std::string Path;
-    bool NeedsReIndexing;
-    Source(llvm::StringRef Path, bool NeedsReIndexing)
-        : Path(Path), NeedsReIndexing(NeedsReIndexing) {}
+  // The shard of a source file, and whether the file needs re-indexing.
+  struct LoadedShard {
+    std::string AbsolutePath;
+    BackgroundIndexStorage *Storage = nullptr;
+    std::unique_ptr<IndexFileIn> Shard;
+    // Whether Shard has the symbols of the file itself, indexed with Digest.
+    bool HasSymbols = false;
+    FileDigest Digest = {{0}};
+    bool NeedsReIndexing = true;
+    // Absolute paths of the other files in the shard's include graph.
+    std::vector<std::string> Dependencies;
   };
-  // Loads the shards for a single TU and all of its dependencies. Returns the
-  // list of sources and whether they need to be re-indexed.
-  std::vector<Source> loadShard(const tooling::CompileCommand &Cmd,
-                                BackgroundIndexStorage *IndexStorage,
-                                llvm::StringSet<> &LoadedShards);
-  // Tries to load shards for the ChangedFiles.
+  // Returns the digest of the contents of Path. Files are only read and hashed
+  // again if their size or modification time changed since the last call.
+  llvm::Optional<FileDigest> digestFile(llvm::vfs::FileSystem &FS,
+                                        llvm::StringRef Path) const;
+  struct StampedDigest {
+    llvm::sys::TimePoint<> ModificationTime;
+    uint64_t Size;
+    FileDigest Digest;
+  };
+  mutable std::mutex DigestCacheMu;
+  // Keys are absolute paths.
+  mutable llvm::StringMap<StampedDigest>
+      DigestCache; /* GUARDED_BY(DigestCacheMu) */
+  // Loads the shard for LS.AbsolutePath from LS.Storage and fills in LS.
+  // Threadsafe: shards of different files are loaded concurrently.
+  void loadShard(LoadedShard &LS, llvm::vfs::FileSystem &FS) const;
+  // Tries to load shards for the ChangedFiles and all their dependencies,
+  // in parallel. Returns the TUs that had out-of-date/no shards.
   std::vector<std::pair<tooling::CompileCommand, BackgroundIndexStorage *>>
   loadShards(std::vector<std::string> ChangedFiles);
   void enqueue(tooling::CompileCommand Cmd, BackgroundIndexStorage *Storage);
+  // Sorts Cmds so that files closer to the recently boosted files come first.
+  void prioritize(
+      std::vector<std::pair<tooling::CompileCommand, BackgroundIndexStorage *>>
+          &Cmds);
+  std::mutex BoostMu;
+  // Most recently boosted files first.
+  std::deque<std::string> RecentlyBoosted; /* GUARDED_BY(BoostMu) */
+  // Returns the distance of files from the recently boosted files, or nullptr
+  // if no file was boosted.
+  std::unique_ptr<FileDistance> boostedDistance();
+
+  // Returns Refs, the refs of the file at Path, unless the file is too far from
+  // the recently boosted files (or none was boosted) and its refs can be loaded
+  // from Storage. Then records the symbols the file references instead.
+  std::unique_ptr<RefSlab> keepRefsInMemory(llvm::StringRef Path,
+                                            std::unique_ptr<RefSlab> Refs,
+                                            BackgroundIndexStorage *Storage,
+                                            FileDistance *Distance);
+  const llvm::Optional<unsigned> ColdRefsDistance;
+  // If set, records the main files of compile commands and the files in the
+  // include graphs of indexed TUs.
+  FileNameIndex *const FileNames;
+  mutable std::mutex ColdRefsMu;
+  // Files whose refs are only in their shards, with the storage of the shards.
+  // The storage is null for files whose refs are back in memory.
+  std::vector<std::pair<std::string, BackgroundIndexStorage *>>
+      ColdFiles; /* GUARDED_BY(ColdRefsMu) */
+  // Indexes into ColdFiles.
+  llvm::StringMap<unsigned> ColdFileIDs; /* GUARDED_BY(ColdRefsMu) */
+  // The cold files referencing each symbol. Files may no longer reference it,
+  // entries aren't removed when files are updated.
+  llvm::DenseMap<SymbolID, std::vector<unsigned>>
+      ColdRefFiles; /* GUARDED_BY(ColdRefsMu) */
+  std::mutex ChangesMu;
+  // Files reported by filesChanged() that are yet to be processed, and whether
+  // a task processing them is queued.
+  llvm::StringSet<> PendingChanges; /* GUARDED_BY(ChangesMu) */
+  bool ChangesQueued = false;       /* GUARDED_BY(ChangesMu) */
 
   // queue management
   using Task = std::function<void()>;
-  void run(); // Main loop executed by Thread. Runs tasks from Queue.
-  void enqueueTask(Task T, ThreadPriority Prioirty);
+  void enqueueTask(Task T, ThreadPriority Prioirty, llvm::StringRef Tag = "");
   void enqueueLocked(tooling::CompileCommand Cmd,
                      BackgroundIndexStorage *IndexStorage);
-  std::mutex QueueMu;
-  unsigned NumActiveTasks = 0; // Only idle when queue is empty *and* no tasks.
-  std::condition_variable QueueCV;
-  bool ShouldStop = false;
-  std::deque<std::pair<Task, ThreadPriority>> Queue;
-  std::vector<std::thread> ThreadPool; // FIXME: Abstract this away.
+  TaskPool Pool;
+  llvm::Optional<std::thread> PeriodicRebuilder;
   GlobalCompilationDatabase::CommandChanged::Subscription CommandsChanged;
 };
 
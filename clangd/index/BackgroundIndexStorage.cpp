@@ -9,11 +9,13 @@
 #include "Logger.h"
 #include "index/Background.h"
 #include "llvm/ADT/ScopeExit.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SHA1.h"
+#include <map>
 
 namespace clang {
 namespace clangd {
@@ -89,7 +91,8 @@ public:
     auto Buffer = llvm::MemoryBuffer::getFile(ShardPath);
     if (!Buffer)
       return nullptr;
-    if (auto I = readIndexFile(Buffer->get()->getBuffer()))
+    if (auto I = readIndexFile(Buffer->get()->getBuffer(),
+                               SharedStringPool::global()))
       return llvm::make_unique<IndexFileIn>(std::move(*I));
     else
       elog("Error while reading shard {0}: {1}", ShardIdentifier,
@@ -105,6 +108,220 @@ public:
   }
 };
 
+// Stores all shards of a project in two append-only files under
+// ".clangd/index/", rather than one file per shard:
+//   - "shards.pack" holds the serialized shards back to back.
+//   - "shards.toc" has a record per stored shard: its identifier, and the
+//     digest, offset and size of its data in the pack.
+// The table of contents is read in one go when the storage is created, and the
+// pack is mapped, so loading shards doesn't need a file open per shard.
+// Shards with identical contents (e.g. a header reindexed by another TU)
+// share their data. Later records for an identifier supersede earlier ones.
+//
+// Unlike DiskBackedIndexStorage, the files must not be shared by several
+// clangd processes at once.
+// FIXME: superseded data is never reclaimed, compact the pack when it's
+// mostly garbage.
+class PackedIndexStorage : public BackgroundIndexStorage {
+  struct Blob {
+    uint64_t Offset;
+    uint32_t Size;
+  };
+
+  std::string PackPath;
+  std::string TOCPath;
+  mutable std::mutex Mu;
+  // Content digest of the latest data stored for each shard identifier.
+  mutable llvm::StringMap<FileDigest> Shards;
+  // Location of the data in the pack for each content digest.
+  mutable std::map<FileDigest, Blob> Blobs;
+  // Size of the pack, including data appended by this instance.
+  mutable uint64_t PackSize = 0;
+  // Mapping of the pack, possibly older (and shorter) than the pack itself.
+  mutable std::shared_ptr<llvm::MemoryBuffer> Mapped;
+  mutable std::unique_ptr<llvm::raw_fd_ostream> PackOS, TOCOS;
+
+  static void writeRecord(llvm::raw_ostream &OS,
+                          llvm::StringRef ShardIdentifier,
+                          const FileDigest &Digest, Blob B) {
+    char Buf[8];
+    llvm::support::endian::write32le(Buf, ShardIdentifier.size());
+    OS.write(Buf, 4);
+    OS << ShardIdentifier;
+    OS.write(reinterpret_cast<const char *>(Digest.data()), Digest.size());
+    llvm::support::endian::write64le(Buf, B.Offset);
+    OS.write(Buf, 8);
+    llvm::support::endian::write32le(Buf, B.Size);
+    OS.write(Buf, 4);
+  }
+
+  // Reads the table of contents, ignoring a truncated last record (e.g. if
+  // clangd was killed while writing it) and data beyond the end of the pack.
+  // Returns true if the file has such garbage or superseded records.
+  bool readTOC() {
+    auto Buffer = llvm::MemoryBuffer::getFile(TOCPath);
+    if (!Buffer)
+      return false;
+    llvm::StringRef Data = Buffer->get()->getBuffer();
+    size_t NumRecords = 0;
+    constexpr size_t FixedSize = 4 + sizeof(FileDigest) + 8 + 4;
+    while (Data.size() >= FixedSize) {
+      uint32_t IDSize = llvm::support::endian::read32le(Data.data());
+      if (Data.size() < FixedSize + IDSize)
+        break;
+      ++NumRecords;
+      llvm::StringRef ShardIdentifier = Data.substr(4, IDSize);
+      const char *P = Data.data() + 4 + IDSize;
+      FileDigest Digest;
+      std::copy(P, P + Digest.size(), Digest.begin());
+      P += Digest.size();
+      Blob B;
+      B.Offset = llvm::support::endian::read64le(P);
+      B.Size = llvm::support::endian::read32le(P + 8);
+      Data = Data.drop_front(FixedSize + IDSize);
+      if (B.Offset + B.Size > PackSize)
+        continue;
+      Shards[ShardIdentifier] = Digest;
+      Blobs[Digest] = B;
+    }
+    return !Data.empty() || NumRecords != Shards.size();
+  }
+
+  // Closes a stream that failed to write. Its file may now end with a partial
+  // write, which is harmless as long as offsets are based on the real size.
+  void discardStream(std::unique_ptr<llvm::raw_fd_ostream> &OS) const {
+    OS->clear_error();
+    OS.reset();
+    if (llvm::sys::fs::file_size(PackPath, PackSize))
+      PackSize = 0;
+  }
+
+  llvm::Error openStreams() const {
+    std::error_code EC;
+    if (!PackOS)
+      PackOS = llvm::make_unique<llvm::raw_fd_ostream>(
+          PackPath, EC, llvm::sys::fs::F_Append);
+    if (!EC && !TOCOS)
+      TOCOS = llvm::make_unique<llvm::raw_fd_ostream>(
+          TOCPath, EC, llvm::sys::fs::F_Append);
+    if (EC) {
+      PackOS.reset();
+      TOCOS.reset();
+      return llvm::errorCodeToError(EC);
+    }
+    return llvm::Error::success();
+  }
+
+public:
+  PackedIndexStorage(llvm::StringRef Directory) {
+    llvm::SmallString<128> ShardRoot(Directory);
+    llvm::sys::path::append(ShardRoot, ".clangd", "index");
+    if (std::error_code EC = llvm::sys::fs::create_directories(ShardRoot))
+      elog("Failed to create directory {0} for index storage: {1}",
+           ShardRoot.str(), EC.message());
+    llvm::SmallString<128> Path = ShardRoot;
+    llvm::sys::path::append(Path, "shards.pack");
+    PackPath = Path.str();
+    Path = ShardRoot;
+    llvm::sys::path::append(Path, "shards.toc");
+    TOCPath = Path.str();
+
+    // Anything appended to the pack after a torn write starts at its real end,
+    // the unreferenced bytes before it are just garbage.
+    if (llvm::sys::fs::file_size(PackPath, PackSize))
+      PackSize = 0;
+    // Appending to a torn record would make the rest of the file unreadable,
+    // so rewrite the table of contents with only the live records first.
+    if (readTOC()) {
+      if (llvm::Error Err =
+              writeAtomically(TOCPath, [this](llvm::raw_ostream &OS) {
+                for (const auto &Shard : Shards)
+                  writeRecord(OS, Shard.getKey(), Shard.getValue(),
+                              Blobs.find(Shard.getValue())->second);
+              }))
+        elog("Failed to rewrite index table of contents {0}: {1}", TOCPath,
+             std::move(Err));
+    }
+  }
+
+  std::unique_ptr<IndexFileIn>
+  loadShard(llvm::StringRef ShardIdentifier) const override {
+    Blob B;
+    FileDigest Digest;
+    std::shared_ptr<llvm::MemoryBuffer> Pack;
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      auto It = Shards.find(ShardIdentifier);
+      if (It == Shards.end())
+        return nullptr;
+      Digest = It->second;
+      B = Blobs.find(Digest)->second;
+      if (PackOS)
+        PackOS->flush();
+      if (!Mapped || Mapped->getBufferSize() < B.Offset + B.Size) {
+        auto Buffer = llvm::MemoryBuffer::getFile(
+            PackPath, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+        if (!Buffer) {
+          elog("Failed to map index pack {0}: {1}", PackPath,
+               Buffer.getError().message());
+          return nullptr;
+        }
+        Mapped = std::move(*Buffer);
+      }
+      Pack = Mapped;
+    }
+    // Parsing copies all data out of the pack, so it can happen unlocked.
+    llvm::StringRef Data = Pack->getBuffer().substr(B.Offset, B.Size);
+    if (Data.size() != B.Size || digest(Data) != Digest) {
+      elog("Corrupted data for shard {0} in {1}", ShardIdentifier, PackPath);
+      return nullptr;
+    }
+    if (auto I = readIndexFile(Data, SharedStringPool::global()))
+      return llvm::make_unique<IndexFileIn>(std::move(*I));
+    else
+      elog("Error while reading shard {0}: {1}", ShardIdentifier,
+           I.takeError());
+    return nullptr;
+  }
+
+  llvm::Error storeShard(llvm::StringRef ShardIdentifier,
+                         IndexFileOut Shard) const override {
+    std::string Data = llvm::to_string(Shard);
+    FileDigest Digest = digest(Data);
+
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto ShardIt = Shards.find(ShardIdentifier);
+    if (ShardIt != Shards.end() && ShardIt->second == Digest)
+      return llvm::Error::success();
+    if (llvm::Error Err = openStreams())
+      return Err;
+    auto BlobIt = Blobs.find(Digest);
+    if (BlobIt == Blobs.end()) {
+      Blob B{PackSize, static_cast<uint32_t>(Data.size())};
+      *PackOS << Data;
+      PackOS->flush();
+      if (PackOS->has_error()) {
+        std::error_code EC = PackOS->error();
+        discardStream(PackOS);
+        return llvm::errorCodeToError(EC);
+      }
+      PackSize += Data.size();
+      BlobIt = Blobs.emplace(Digest, B).first;
+    }
+    // The record is only written once the data is, so a reader never sees a
+    // record pointing to missing data.
+    writeRecord(*TOCOS, ShardIdentifier, Digest, BlobIt->second);
+    TOCOS->flush();
+    if (TOCOS->has_error()) {
+      std::error_code EC = TOCOS->error();
+      discardStream(TOCOS);
+      return llvm::errorCodeToError(EC);
+    }
+    Shards[ShardIdentifier] = Digest;
+    return llvm::Error::success();
+  }
+};
+
 // Doesn't persist index shards anywhere (used when the CDB dir is unknown).
 // We could consider indexing into ~/.clangd/ or so instead.
 class NullStorage : public BackgroundIndexStorage {
@@ -125,8 +342,8 @@ public:
 // Creates and owns IndexStorages for multiple CDBs.
 class DiskBackedIndexStorageManager {
 public:
-  DiskBackedIndexStorageManager()
-      : IndexStorageMapMu(llvm::make_unique<std::mutex>()) {}
+  DiskBackedIndexStorageManager(bool Packed)
+      : Packed(Packed), IndexStorageMapMu(llvm::make_unique<std::mutex>()) {}
 
   // Creates or fetches to storage from cache for the specified CDB.
   BackgroundIndexStorage *operator()(llvm::StringRef CDBDirectory) {
@@ -144,9 +361,12 @@ private:
   std::unique_ptr<BackgroundIndexStorage> create(llvm::StringRef CDBDirectory) {
     if (CDBDirectory.empty())
       return llvm::make_unique<NullStorage>();
+    if (Packed)
+      return llvm::make_unique<PackedIndexStorage>(CDBDirectory);
     return llvm::make_unique<DiskBackedIndexStorage>(CDBDirectory);
   }
 
+  bool Packed;
   llvm::StringMap<std::unique_ptr<BackgroundIndexStorage>> IndexStorageMap;
   std::unique_ptr<std::mutex> IndexStorageMapMu;
 };
@@ -155,7 +375,12 @@ private:
 
 BackgroundIndexStorage::Factory
 BackgroundIndexStorage::createDiskBackedStorageFactory() {
-  return DiskBackedIndexStorageManager();
+  return DiskBackedIndexStorageManager(/*Packed=*/false);
+}
+
+BackgroundIndexStorage::Factory
+BackgroundIndexStorage::createPackedStorageFactory() {
+  return DiskBackedIndexStorageManager(/*Packed=*/true);
 }
 
 } // namespace clangd
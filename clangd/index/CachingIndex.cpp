@@ -0,0 +1,146 @@
+//===--- CachingIndex.cpp ----------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "CachingIndex.h"
+#include "Trace.h"
+
+namespace clang {
+namespace clangd {
+
+static size_t bytes(const FuzzyFindRequest &Req) {
+  size_t Bytes = sizeof(Req) + Req.Query.size();
+  for (const auto *Strings : {&Req.Scopes, &Req.ProximityPaths,
+                              &Req.PreferredTypes})
+    for (const auto &S : *Strings)
+      Bytes += sizeof(S) + S.size();
+  return Bytes;
+}
+
+std::shared_ptr<const CachingIndex::Results>
+CachingIndex::makeResults(SymbolSlab Symbols, llvm::ArrayRef<SymbolID> IDs,
+                          bool More) {
+  auto R = std::make_shared<Results>();
+  R->Symbols = std::move(Symbols);
+  R->Order.reserve(IDs.size());
+  for (const SymbolID &ID : IDs)
+    R->Order.push_back(&*R->Symbols.find(ID));
+  R->More = More;
+  return std::move(R);
+}
+
+std::shared_ptr<const CachingIndex::Results>
+CachingIndex::lookupCache(const FuzzyFindRequest &Req,
+                          uint64_t Generation) const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto It = Entries.find(hash_value(Req));
+  if (It == Entries.end() || It->second->Req != Req)
+    return nullptr;
+  if (It->second->Generation != Generation) {
+    // The index changed since, so all of its results are outdated.
+    Bytes -= It->second->Bytes;
+    LRU.erase(It->second);
+    Entries.erase(It);
+    return nullptr;
+  }
+  LRU.splice(LRU.begin(), LRU, It->second);
+  return It->second->Value;
+}
+
+void CachingIndex::insertCache(const FuzzyFindRequest &Req,
+                               uint64_t Generation,
+                               std::shared_ptr<const Results> Value) const {
+  size_t EntryBytes = sizeof(Entry) + bytes(Req) + Value->Symbols.bytes() +
+                      Value->Order.size() * sizeof(const Symbol *);
+  if (EntryBytes > MaxBytes)
+    return;
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto R = Entries.emplace(hash_value(Req), LRU.end());
+  if (!R.second) {
+    // Replace the previous results (or those of a colliding request).
+    Bytes -= R.first->second->Bytes;
+    LRU.erase(R.first->second);
+  }
+  LRU.push_front({Req, Generation, std::move(Value), EntryBytes});
+  R.first->second = LRU.begin();
+  Bytes += EntryBytes;
+  while (Bytes > MaxBytes) {
+    const Entry &Evicted = LRU.back();
+    Bytes -= Evicted.Bytes;
+    Entries.erase(hash_value(Evicted.Req));
+    LRU.pop_back();
+  }
+}
+
+bool CachingIndex::fuzzyFind(
+    const FuzzyFindRequest &Req,
+    llvm::function_ref<void(const Symbol &)> Callback) const {
+  trace::Span Tracer("CachingIndex fuzzyFind");
+  // Read before querying: results must not outlive the index they came from.
+  uint64_t Generation = Base->generation();
+  auto Cached = lookupCache(Req, Generation);
+  SPAN_ATTACH(Tracer, "cached", bool(Cached));
+  if (!Cached) {
+    SymbolSlab::Builder Symbols;
+    std::vector<SymbolID> IDs;
+    bool More = Base->fuzzyFind(Req, [&](const Symbol &S) {
+      Symbols.insert(S);
+      IDs.push_back(S.ID);
+    });
+    Cached = makeResults(std::move(Symbols).build(), IDs, More);
+    insertCache(Req, Generation, Cached);
+  }
+  for (const Symbol *S : Cached->Order)
+    Callback(*S);
+  return Cached->More;
+}
+
+std::vector<bool> CachingIndex::fuzzyFindBatch(
+    llvm::ArrayRef<FuzzyFindRequest> Reqs,
+    llvm::function_ref<void(size_t, const Symbol &)> Callback) const {
+  trace::Span Tracer("CachingIndex fuzzyFindBatch");
+  uint64_t Generation = Base->generation();
+  std::vector<std::shared_ptr<const Results>> Cached(Reqs.size());
+  std::vector<FuzzyFindRequest> Misses;
+  std::vector<size_t> MissIndex; // Index of each miss in Reqs.
+  for (size_t I = 0; I < Reqs.size(); ++I)
+    if (!(Cached[I] = lookupCache(Reqs[I], Generation))) {
+      Misses.push_back(Reqs[I]);
+      MissIndex.push_back(I);
+    }
+  SPAN_ATTACH(Tracer, "misses", static_cast<int>(Misses.size()));
+  if (!Misses.empty()) {
+    std::vector<SymbolSlab::Builder> Symbols(Misses.size());
+    std::vector<std::vector<SymbolID>> IDs(Misses.size());
+    std::vector<bool> More =
+        Base->fuzzyFindBatch(Misses, [&](size_t I, const Symbol &S) {
+          Symbols[I].insert(S);
+          IDs[I].push_back(S.ID);
+        });
+    for (size_t I = 0; I < Misses.size(); ++I) {
+      auto &Result = Cached[MissIndex[I]];
+      Result = makeResults(std::move(Symbols[I]).build(), IDs[I], More[I]);
+      insertCache(Misses[I], Generation, Result);
+    }
+  }
+  std::vector<bool> More;
+  More.reserve(Reqs.size());
+  for (size_t I = 0; I < Reqs.size(); ++I) {
+    for (const Symbol *S : Cached[I]->Order)
+      Callback(I, *S);
+    More.push_back(Cached[I]->More);
+  }
+  return More;
+}
+
+size_t CachingIndex::estimateMemoryUsage() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  return Base->estimateMemoryUsage() + Bytes;
+}
+
+} // namespace clangd
+} // namespace clang
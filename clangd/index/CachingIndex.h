@@ -0,0 +1,94 @@
+//===--- CachingIndex.h ------------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_CACHINGINDEX_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_CACHINGINDEX_H
+
+#include "Index.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace clang {
+namespace clangd {
+
+// CachingIndex remembers the results of recent fuzzyFind() requests to another
+// index, so that requests repeated by the editor (retriggered completions,
+// workspace symbol refreshes) are answered without querying it again.
+// Results are reused while the index's generation() stays the same, and the
+// least recently used ones are evicted to stay within a memory budget.
+// Other requests are forwarded to the index.
+class CachingIndex : public SymbolIndex {
+public:
+  // The constructor does not access the index.
+  CachingIndex(const SymbolIndex *Base, size_t MaxBytes)
+      : Base(Base), MaxBytes(MaxBytes) {}
+
+  bool fuzzyFind(const FuzzyFindRequest &,
+                 llvm::function_ref<void(const Symbol &)>) const override;
+  // Only the requests that miss the cache are sent to the index, in one batch.
+  std::vector<bool> fuzzyFindBatch(
+      llvm::ArrayRef<FuzzyFindRequest>,
+      llvm::function_ref<void(size_t, const Symbol &)>) const override;
+  void
+  lookup(const LookupRequest &Req,
+         llvm::function_ref<void(const Symbol &)> Callback) const override {
+    Base->lookup(Req, Callback);
+  }
+  void refs(const RefsRequest &Req,
+            llvm::function_ref<void(const Ref &)> Callback) const override {
+    Base->refs(Req, Callback);
+  }
+  void relations(const RelationsRequest &Req,
+                 llvm::function_ref<void(const SymbolID &, const Symbol &)>
+                     Callback) const override {
+    Base->relations(Req, Callback);
+  }
+  size_t estimateMemoryUsage() const override;
+  uint64_t generation() const override { return Base->generation(); }
+  uint64_t headerGeneration() const override {
+    return Base->headerGeneration();
+  }
+
+private:
+  // The results of a request, in the order the index returned them.
+  struct Results {
+    SymbolSlab Symbols;
+    std::vector<const Symbol *> Order;
+    bool More;
+  };
+  struct Entry {
+    FuzzyFindRequest Req;
+    uint64_t Generation;
+    std::shared_ptr<const Results> Value;
+    size_t Bytes;
+  };
+
+  // Returns the cached results of Req, if they are still valid.
+  std::shared_ptr<const Results> lookupCache(const FuzzyFindRequest &Req,
+                                             uint64_t Generation) const;
+  void insertCache(const FuzzyFindRequest &Req, uint64_t Generation,
+                   std::shared_ptr<const Results> Value) const;
+  static std::shared_ptr<const Results>
+  makeResults(SymbolSlab Symbols, llvm::ArrayRef<SymbolID> IDs, bool More);
+
+  const SymbolIndex *Base;
+  const size_t MaxBytes;
+  mutable std::mutex Mu;
+  // Most recently used first.
+  mutable std::list<Entry> LRU;
+  // Keyed by hash_value() of the request.
+  mutable std::unordered_map<size_t, std::list<Entry>::iterator> Entries;
+  mutable size_t Bytes = 0;
+};
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_CACHINGINDEX_H
@@ -20,10 +20,16 @@ const char IWYUPragma[] = "// IWYU pragma: private, include ";
 
 void CanonicalIncludes::addPathSuffixMapping(llvm::StringRef Suffix,
                                              llvm::StringRef CanonicalPath) {
-  int Components = std::distance(llvm::sys::path::begin(Suffix),
-                                 llvm::sys::path::end(Suffix));
-  MaxSuffixComponents = std::max(MaxSuffixComponents, Components);
-  SuffixHeaderMapping[Suffix] = CanonicalPath;
+  SuffixNode *Node = &SuffixRoot;
+  for (auto It = llvm::sys::path::rbegin(Suffix),
+            End = llvm::sys::path::rend(Suffix);
+       It != End; ++It) {
+    auto &Child = Node->Children[*It];
+    if (!Child)
+      Child = llvm::make_unique<SuffixNode>();
+    Node = Child.get();
+  }
+  Node->CanonicalPath = CanonicalPath;
 }
 
 void CanonicalIncludes::addMapping(llvm::StringRef Path,
@@ -39,10 +45,19 @@ void CanonicalIncludes::addSymbolMapping(llvm::StringRef QualifiedName,
 llvm::StringRef
 CanonicalIncludes::mapHeader(llvm::ArrayRef<std::string> Headers,
                              llvm::StringRef QualifiedName) const {
-  assert(!Headers.empty());
+  llvm::StringRef Mapped = mapSymbol(QualifiedName);
+  return Mapped.empty() ? mapHeader(Headers) : Mapped;
+}
+
+llvm::StringRef
+CanonicalIncludes::mapSymbol(llvm::StringRef QualifiedName) const {
   auto SE = SymbolMapping.find(QualifiedName);
-  if (SE != SymbolMapping.end())
-    return SE->second;
+  return SE == SymbolMapping.end() ? llvm::StringRef() : SE->second;
+}
+
+llvm::StringRef
+CanonicalIncludes::mapHeader(llvm::ArrayRef<std::string> Headers) const {
+  assert(!Headers.empty());
   // Find the first header such that the extension is not '.inc', and isn't a
   // recognized non-header file
   auto I = llvm::find_if(Headers, [](llvm::StringRef Include) {
@@ -67,14 +82,17 @@ CanonicalIncludes::mapHeader(llvm::ArrayRef<std::string> Headers,
   if (MapIt != FullPathMapping.end())
     return MapIt->second;
 
-  int Components = 1;
+  // The shortest mapped suffix wins.
+  const SuffixNode *Node = &SuffixRoot;
   for (auto It = llvm::sys::path::rbegin(Header),
             End = llvm::sys::path::rend(Header);
-       It != End && Components <= MaxSuffixComponents; ++It, ++Components) {
-    auto SubPath = Header.substr(It->data() - Header.begin());
-    auto MappingIt = SuffixHeaderMapping.find(SubPath);
-    if (MappingIt != SuffixHeaderMapping.end())
-      return MappingIt->second;
+       It != End; ++It) {
+    auto Child = Node->Children.find(*It);
+    if (Child == Node->Children.end())
+      break;
+    Node = Child->second.get();
+    if (!Node->CanonicalPath.empty())
+      return Node->CanonicalPath;
   }
   return Header;
 }
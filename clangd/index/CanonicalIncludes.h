@@ -22,6 +22,7 @@
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Regex.h"
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -55,14 +56,27 @@ public:
   llvm::StringRef mapHeader(llvm::ArrayRef<std::string> Headers,
                             llvm::StringRef QualifiedName) const;
 
+  /// Returns the canonical include set for the symbol \p QualifiedName with
+  /// addSymbolMapping(), or an empty string.
+  llvm::StringRef mapSymbol(llvm::StringRef QualifiedName) const;
+
+  /// Returns the canonical include for symbols without a symbol mapping
+  /// declared in Headers.front(); \p Headers is the include stack.
+  llvm::StringRef mapHeader(llvm::ArrayRef<std::string> Headers) const;
+
 private:
+  /// A trie of path suffixes, keyed by path components from the last one.
+  struct SuffixNode {
+    llvm::StringMap<std::unique_ptr<SuffixNode>> Children;
+    /// The canonical path of files with this suffix, empty if none.
+    std::string CanonicalPath;
+  };
+
   /// A map from full include path to a canonical path.
   llvm::StringMap<std::string> FullPathMapping;
-  /// A map from a suffix (one or components of a path) to a canonical path.
-  llvm::StringMap<std::string> SuffixHeaderMapping;
-  /// Maximum number of path components stored in a key of SuffixHeaderMapping.
-  /// Used to reduce the number of lookups into SuffixHeaderMapping.
-  int MaxSuffixComponents = 0;
+  /// The suffixes (one or more components of a path) mapped to a canonical
+  /// path. Matching a header walks its components once, from the end.
+  SuffixNode SuffixRoot;
   /// A map from fully qualified symbol names to header names.
   llvm::StringMap<std::string> SymbolMapping;
 };
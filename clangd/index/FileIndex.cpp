@@ -9,7 +9,11 @@
 #include "FileIndex.h"
 #include "ClangdUnit.h"
 #include "Logger.h"
+#include "ResourceUsage.h"
+#include "Trace.h"
 #include "SymbolCollector.h"
+#include "SourceCode.h"
+#include "index/Background.h"
 #include "index/CanonicalIncludes.h"
 #include "index/Index.h"
 #include "index/MemIndex.h"
@@ -22,13 +26,16 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/SHA1.h"
 #include <memory>
 
 namespace clang {
 namespace clangd {
 
-static std::pair<SymbolSlab, RefSlab>
+static SlabTuple
 indexSymbols(ASTContext &AST, std::shared_ptr<Preprocessor> PP,
              llvm::ArrayRef<Decl *> DeclsToIndex,
              const CanonicalIncludes &Includes, bool IsIndexMainAST) {
@@ -37,6 +44,7 @@ indexSymbols(ASTContext &AST, std::shared_ptr<Preprocessor> PP,
   CollectorOpts.Includes = &Includes;
   CollectorOpts.CountReferences = false;
   CollectorOpts.Origin = SymbolOrigin::Dynamic;
+  CollectorOpts.SharedStrings = SharedStringPool::global();
 
   index::IndexingOptions IndexOpts;
   // We only need declarations, because we don't count references.
@@ -65,33 +73,36 @@ indexSymbols(ASTContext &AST, std::shared_ptr<Preprocessor> PP,
 
   auto Syms = Collector.takeSymbols();
   auto Refs = Collector.takeRefs();
+  auto Relations = Collector.takeRelations();
   vlog("index AST for {0} (main={1}): \n"
        "  symbol slab: {2} symbols, {3} bytes\n"
-       "  ref slab: {4} symbols, {5} refs, {6} bytes",
+       "  ref slab: {4} symbols, {5} refs, {6} bytes\n"
+       "  relations slab: {7} relations, {8} bytes",
        FileName, IsIndexMainAST, Syms.size(), Syms.bytes(), Refs.size(),
-       Refs.numRefs(), Refs.bytes());
-  return {std::move(Syms), std::move(Refs)};
+       Refs.numRefs(), Refs.bytes(), Relations.size(), Relations.bytes());
+  return std::make_tuple(std::move(Syms), std::move(Refs),
+                         std::move(Relations));
 }
 
-std::pair<SymbolSlab, RefSlab> indexMainDecls(ParsedAST &AST) {
+SlabTuple indexMainDecls(ParsedAST &AST) {
   return indexSymbols(AST.getASTContext(), AST.getPreprocessorPtr(),
                       AST.getLocalTopLevelDecls(), AST.getCanonicalIncludes(),
                       /*IsIndexMainAST=*/true);
 }
 
-SymbolSlab indexHeaderSymbols(ASTContext &AST, std::shared_ptr<Preprocessor> PP,
-                              const CanonicalIncludes &Includes) {
+SlabTuple indexHeaderSymbols(ASTContext &AST, std::shared_ptr<Preprocessor> PP,
+                             const CanonicalIncludes &Includes) {
   std::vector<Decl *> DeclsToIndex(
       AST.getTranslationUnitDecl()->decls().begin(),
       AST.getTranslationUnitDecl()->decls().end());
   return indexSymbols(AST, std::move(PP), DeclsToIndex, Includes,
-                      /*IsIndexMainAST=*/false)
-      .first;
+                      /*IsIndexMainAST=*/false);
 }
 
 void FileSymbols::update(PathRef Path, std::unique_ptr<SymbolSlab> Symbols,
-                         std::unique_ptr<RefSlab> Refs) {
-  std::lock_guard<std::mutex> Lock(Mutex);
+                         std::unique_ptr<RefSlab> Refs,
+                         std::unique_ptr<RelationSlab> Relations) {
+  auto Lock = lockAccounted(Mutex, "FileSymbols");
   if (!Symbols)
     FileToSymbols.erase(Path);
   else
@@ -100,36 +111,31 @@ void FileSymbols::update(PathRef Path, std::unique_ptr<SymbolSlab> Symbols,
     FileToRefs.erase(Path);
   else
     FileToRefs[Path] = std::move(Refs);
+  if (!Relations)
+    FileToRelations.erase(Path);
+  else
+    FileToRelations[Path] = std::move(Relations);
 }
 
+namespace {
+
+// Builds an index over snapshots of symbol and ref slabs, which it keeps alive.
+// Relations are copied into the index.
 std::unique_ptr<SymbolIndex>
-FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle) {
-  std::vector<std::shared_ptr<SymbolSlab>> SymbolSlabs;
-  std::vector<std::shared_ptr<RefSlab>> RefSlabs;
-  {
-    std::lock_guard<std::mutex> Lock(Mutex);
-    for (const auto &FileAndSymbols : FileToSymbols)
-      SymbolSlabs.push_back(FileAndSymbols.second);
-    for (const auto &FileAndRefs : FileToRefs)
-      RefSlabs.push_back(FileAndRefs.second);
-  }
+buildIndexFromSlabs(IndexType Type, DuplicateHandling DuplicateHandle,
+                    std::vector<std::shared_ptr<SymbolSlab>> SymbolSlabs,
+                    std::vector<std::shared_ptr<RefSlab>> RefSlabs,
+                    std::vector<std::shared_ptr<RelationSlab>> RelationSlabs) {
   std::vector<const Symbol *> AllSymbols;
-  std::vector<Symbol> SymsStorage;
+  std::shared_ptr<SymbolSlab> MergedSymbols;
   switch (DuplicateHandle) {
   case DuplicateHandling::Merge: {
-    llvm::DenseMap<SymbolID, Symbol> Merged;
-    for (const auto &Slab : SymbolSlabs) {
-      for (const auto &Sym : *Slab) {
-        auto I = Merged.try_emplace(Sym.ID, Sym);
-        if (!I.second)
-          I.first->second = mergeSymbol(I.first->second, Sym);
-      }
-    }
-    SymsStorage.reserve(Merged.size());
-    for (auto &Sym : Merged) {
-      SymsStorage.push_back(std::move(Sym.second));
-      AllSymbols.push_back(&SymsStorage.back());
-    }
+    MergedSymbols = std::make_shared<SymbolSlab>(mergeSlabs(
+        std::vector<std::shared_ptr<const SymbolSlab>>(SymbolSlabs.begin(),
+                                                       SymbolSlabs.end()),
+        /*Threads=*/0));
+    for (const auto &Sym : *MergedSymbols)
+      AllSymbols.push_back(&Sym);
     // FIXME: aggregate symbol reference count based on references.
     break;
   }
@@ -167,55 +173,481 @@ FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle) {
     }
   }
 
-  size_t StorageSize =
-      RefsStorage.size() * sizeof(Ref) + SymsStorage.size() * sizeof(Symbol);
+  std::vector<Relation> AllRelations;
+  for (const auto &RelationSlab : RelationSlabs)
+    AllRelations.insert(AllRelations.end(), RelationSlab->begin(),
+                        RelationSlab->end());
+  // The same relation may be reported by several files.
+  llvm::sort(AllRelations);
+  AllRelations.erase(std::unique(AllRelations.begin(), AllRelations.end()),
+                     AllRelations.end());
+
+  size_t SymbolStorageSize = MergedSymbols ? MergedSymbols->bytes() : 0;
   for (const auto &Slab : SymbolSlabs)
-    StorageSize += Slab->bytes();
+    SymbolStorageSize += Slab->bytes();
+  size_t RefStorageSize = RefsStorage.size() * sizeof(Ref);
   for (const auto &RefSlab : RefSlabs)
-    StorageSize += RefSlab->bytes();
+    RefStorageSize += RefSlab->bytes();
 
   // Index must keep the slabs and contiguous ranges alive.
   switch (Type) {
   case IndexType::Light:
     return llvm::make_unique<MemIndex>(
-        llvm::make_pointee_range(AllSymbols), std::move(AllRefs),
+        llvm::make_pointee_range(AllSymbols), std::move(AllRefs), AllRelations,
         std::make_tuple(std::move(SymbolSlabs), std::move(RefSlabs),
-                        std::move(RefsStorage), std::move(SymsStorage)),
-        StorageSize);
+                        std::move(RefsStorage), std::move(MergedSymbols)),
+        SymbolStorageSize + RefStorageSize);
   case IndexType::Heavy:
+    // Dex copies refs into its own compact storage.
     return llvm::make_unique<dex::Dex>(
-        llvm::make_pointee_range(AllSymbols), std::move(AllRefs),
-        std::make_tuple(std::move(SymbolSlabs), std::move(RefSlabs),
-                        std::move(RefsStorage), std::move(SymsStorage)),
-        StorageSize);
+        llvm::make_pointee_range(AllSymbols), std::move(AllRefs), AllRelations,
+        std::make_tuple(std::move(SymbolSlabs), std::move(MergedSymbols)),
+        SymbolStorageSize);
   }
   llvm_unreachable("Unknown clangd::IndexType");
 }
 
+// A base index combined with a delta index over recently updated files.
+// Symbols in Hidden are outdated in the base, and are not returned from it.
+// Refs are not shadowed: they are returned from both indexes. Relations are
+// shadowed by their object, as they are stored with the object's file.
+class LayeredIndex : public SymbolIndex {
+public:
+  LayeredIndex(std::shared_ptr<SymbolIndex> Base,
+               std::unique_ptr<SymbolIndex> Delta,
+               llvm::DenseSet<SymbolID> Hidden)
+      : Base(std::move(Base)), Delta(std::move(Delta)),
+        Hidden(std::move(Hidden)) {}
+
+  // Like MergedIndex, this may return up to 2 * Req.Limit symbols. Hidden
+  // symbols count towards the base's limit; the delta is kept small, so few
+  // results are lost this way.
+  bool
+  fuzzyFind(const FuzzyFindRequest &Req,
+            llvm::function_ref<void(const Symbol &)> Callback) const override {
+    bool More = Delta->fuzzyFind(Req, Callback);
+    More |= Base->fuzzyFind(Req, [&](const Symbol &S) {
+      if (!Hidden.count(S.ID))
+        Callback(S);
+    });
+    return More;
+  }
+
+  void lookup(const LookupRequest &Req,
+              llvm::function_ref<void(const Symbol &)> Callback) const override {
+    Delta->lookup(Req, Callback);
+    Base->lookup(Req, [&](const Symbol &S) {
+      if (!Hidden.count(S.ID))
+        Callback(S);
+    });
+  }
+
+  void refs(const RefsRequest &Req,
+            llvm::function_ref<void(const Ref &)> Callback) const override {
+    Delta->refs(Req, Callback);
+    Base->refs(Req, Callback);
+  }
+
+  void relations(const RelationsRequest &Req,
+                 llvm::function_ref<void(const SymbolID &, const Symbol &)>
+                     Callback) const override {
+    Delta->relations(Req, Callback);
+    Base->relations(Req, [&](const SymbolID &Subject, const Symbol &Object) {
+      if (!Hidden.count(Object.ID))
+        Callback(Subject, Object);
+    });
+  }
+
+  size_t estimateMemoryUsage() const override {
+    return Base->estimateMemoryUsage() + Delta->estimateMemoryUsage() +
+           Hidden.getMemorySize();
+  }
+
+private:
+  std::shared_ptr<SymbolIndex> Base;
+  std::unique_ptr<SymbolIndex> Delta;
+  llvm::DenseSet<SymbolID> Hidden;
+};
+
+} // namespace
+
+std::unique_ptr<SymbolIndex>
+FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle) {
+  std::vector<std::shared_ptr<SymbolSlab>> SymbolSlabs;
+  std::vector<std::shared_ptr<RefSlab>> RefSlabs;
+  std::vector<std::shared_ptr<RelationSlab>> RelationSlabs;
+  {
+    auto Lock = lockAccounted(Mutex, "FileSymbols");
+    for (const auto &FileAndSymbols : FileToSymbols)
+      SymbolSlabs.push_back(FileAndSymbols.second);
+    for (const auto &FileAndRefs : FileToRefs)
+      RefSlabs.push_back(FileAndRefs.second);
+    for (const auto &FileAndRelations : FileToRelations)
+      RelationSlabs.push_back(FileAndRelations.second);
+  }
+  return buildIndexFromSlabs(Type, DuplicateHandle, std::move(SymbolSlabs),
+                             std::move(RefSlabs), std::move(RelationSlabs));
+}
+
+struct FileSymbols::IndexSegment {
+  std::shared_ptr<SymbolIndex> Index;
+  /// The symbol snapshots the index was built from.
+  llvm::StringMap<std::shared_ptr<SymbolSlab>> Files;
+  /// Number of files containing each symbol.
+  llvm::DenseMap<SymbolID, unsigned> FileCount;
+};
+
+std::unique_ptr<SymbolIndex> FileSymbols::buildIncrementalIndex() {
+  llvm::StringMap<std::shared_ptr<SymbolSlab>> Files;
+  llvm::StringMap<std::shared_ptr<RelationSlab>> Relations;
+  std::vector<std::shared_ptr<RefSlab>> RefSlabs;
+  std::shared_ptr<const IndexSegment> Base;
+  {
+    auto Lock = lockAccounted(Mutex, "FileSymbols");
+    Files = FileToSymbols;
+    Relations = FileToRelations;
+    for (const auto &FileAndRefs : FileToRefs)
+      RefSlabs.push_back(FileAndRefs.second);
+    Base = this->Base;
+  }
+
+  if (Base) {
+    // Snapshots that are not in the base, and the number of base files each
+    // symbol has been updated or removed from.
+    std::vector<std::shared_ptr<SymbolSlab>> Updated;
+    std::vector<std::shared_ptr<RelationSlab>> UpdatedRelations;
+    llvm::DenseMap<SymbolID, unsigned> OutdatedCount;
+    size_t UpdatedSymbols = 0;
+    for (const auto &File : Files) {
+      auto It = Base->Files.find(File.first());
+      if (It != Base->Files.end() && It->second == File.second)
+        continue;
+      Updated.push_back(File.second);
+      auto RelationsIt = Relations.find(File.first());
+      if (RelationsIt != Relations.end())
+        UpdatedRelations.push_back(RelationsIt->second);
+      UpdatedSymbols += File.second->size();
+      if (It != Base->Files.end())
+        for (const auto &Sym : *It->second)
+          ++OutdatedCount[Sym.ID];
+    }
+    for (const auto &File : Base->Files)
+      if (!Files.count(File.first()))
+        for (const auto &Sym : *File.second)
+          ++OutdatedCount[Sym.ID];
+
+    // Rebuild the base once the delta holds more than a quarter as many
+    // symbols, as queries get slower and hidden symbols cost memory.
+    if (UpdatedSymbols * 4 <= Base->FileCount.size()) {
+      llvm::DenseSet<SymbolID> Hidden;
+      for (const auto &Slab : Updated)
+        for (const auto &Sym : *Slab)
+          Hidden.insert(Sym.ID);
+      for (const auto &Outdated : OutdatedCount)
+        if (Base->FileCount.lookup(Outdated.first) == Outdated.second)
+          Hidden.insert(Outdated.first);
+      return llvm::make_unique<LayeredIndex>(
+          Base->Index,
+          buildIndexFromSlabs(IndexType::Heavy, DuplicateHandling::PickOne,
+                              std::move(Updated), {},
+                              std::move(UpdatedRelations)),
+          std::move(Hidden));
+    }
+  }
+
+  auto NewBase = std::make_shared<IndexSegment>();
+  std::vector<std::shared_ptr<SymbolSlab>> SymbolSlabs;
+  std::vector<std::shared_ptr<RelationSlab>> RelationSlabs;
+  for (const auto &FileAndRelations : Relations)
+    RelationSlabs.push_back(FileAndRelations.second);
+  for (const auto &File : Files) {
+    SymbolSlabs.push_back(File.second);
+    for (const auto &Sym : *File.second)
+      ++NewBase->FileCount[Sym.ID];
+  }
+  NewBase->Files = std::move(Files);
+  NewBase->Index =
+      buildIndexFromSlabs(IndexType::Heavy, DuplicateHandling::PickOne,
+                          std::move(SymbolSlabs), std::move(RefSlabs),
+                          std::move(RelationSlabs));
+  {
+    auto Lock = lockAccounted(Mutex, "FileSymbols");
+    this->Base = NewBase;
+  }
+  return llvm::make_unique<LayeredIndex>(NewBase->Index,
+                                         llvm::make_unique<MemIndex>(),
+                                         llvm::DenseSet<SymbolID>());
+}
+
 FileIndex::FileIndex(bool UseDex)
     : MergedIndex(&MainFileIndex, &PreambleIndex), UseDex(UseDex),
       PreambleIndex(llvm::make_unique<MemIndex>()),
       MainFileIndex(llvm::make_unique<MemIndex>()) {}
 
+// Identifies the symbols of a header, as indexed from some preamble. Headers
+// provide the same symbols in most TUs, so the key is the header and a digest
+// of its symbols.
+static std::string headerSymbolsKey(llvm::StringRef Header,
+                                    const SymbolSlab &Symbols,
+                                    const RelationSlab &Relations) {
+  llvm::SHA1 Hasher;
+  auto AddInt = [&](uint32_t V) {
+    uint8_t Bytes[sizeof(V)];
+    llvm::support::endian::write32le(Bytes, V);
+    Hasher.update(Bytes);
+  };
+  auto AddString = [&](llvm::StringRef S) {
+    AddInt(S.size());
+    Hasher.update(S);
+  };
+  auto AddLocation = [&](const SymbolLocation &Loc) {
+    AddString(Loc.FileURI);
+    AddInt(Loc.Start.line());
+    AddInt(Loc.Start.column());
+    AddInt(Loc.End.line());
+    AddInt(Loc.End.column());
+  };
+  // Slabs are sorted by SymbolID, so equal sets of symbols hash alike.
+  for (const Symbol &Sym : Symbols) {
+    AddString(Sym.ID.raw());
+    AddInt(static_cast<uint32_t>(Sym.SymInfo.Kind));
+    AddInt(static_cast<uint32_t>(Sym.SymInfo.SubKind));
+    AddInt(static_cast<uint32_t>(Sym.SymInfo.Lang));
+    AddInt(Sym.SymInfo.Properties);
+    AddString(Sym.Name);
+    AddString(Sym.Scope);
+    AddLocation(Sym.Definition);
+    AddLocation(Sym.CanonicalDeclaration);
+    AddInt(Sym.References);
+    AddInt(static_cast<uint32_t>(Sym.Origin));
+    AddString(Sym.Signature);
+    AddString(Sym.CompletionSnippetSuffix);
+    AddString(Sym.Documentation);
+    AddString(Sym.ReturnType);
+    AddString(Sym.Type);
+    AddInt(Sym.IncludeHeaders.size());
+    for (const auto &Include : Sym.IncludeHeaders) {
+      AddString(Include.IncludeHeader);
+      AddInt(Include.References);
+    }
+    AddInt(Sym.Flags);
+  }
+  for (const Relation &R : Relations) {
+    AddString(R.Subject.raw());
+    AddInt(static_cast<uint32_t>(R.Predicate));
+    AddString(R.Object.raw());
+  }
+  return (Header + "#" + llvm::toHex(Hasher.result())).str();
+}
+
+// Estimated size of the dynamic index, labelled by what it covers.
+constexpr trace::Metric IndexMemory("index_memory", trace::Metric::Value,
+                                    "index");
+
+// Identifiers of the snapshots of a file in the snapshot storage. They differ
+// from the identifiers of background index shards, which share the storage.
+static std::string preambleSnapshotID(PathRef Path) {
+  return (Path + "#preamble").str();
+}
+static std::string mainSnapshotID(PathRef Path) {
+  return (Path + "#main").str();
+}
+
+constexpr std::chrono::seconds FileIndex::SnapshotPeriod;
+
 void FileIndex::updatePreamble(PathRef Path, ASTContext &AST,
                                std::shared_ptr<Preprocessor> PP,
                                const CanonicalIncludes &Includes) {
-  auto Symbols = indexHeaderSymbols(AST, std::move(PP), Includes);
-  PreambleSymbols.update(Path,
-                         llvm::make_unique<SymbolSlab>(std::move(Symbols)),
-                         llvm::make_unique<RefSlab>());
+  auto Contents = indexHeaderSymbols(AST, std::move(PP), Includes);
+  const auto &Symbols = std::get<0>(Contents);
+  const auto &Relations = std::get<2>(Contents);
+  updatePreambleSymbols(Path, Symbols, Relations, /*OnlyIfMissing=*/false);
+
+  if (BackgroundIndexStorage *Snapshots = Storage ? Storage(Path) : nullptr) {
+    IndexFileOut Snapshot;
+    Snapshot.Symbols = &Symbols;
+    Snapshot.Relations = &Relations;
+    if (auto Err = Snapshots->storeShard(preambleSnapshotID(Path), Snapshot))
+      elog("Failed to save preamble index snapshot of {0}: {1}", Path,
+           std::move(Err));
+  }
+}
+
+bool FileIndex::updatePreambleSymbols(PathRef Path, const SymbolSlab &Symbols,
+                                      const RelationSlab &Relations,
+                                      bool OnlyIfMissing) {
+  auto HeaderOf = [](const Symbol &Sym) {
+    return Sym.CanonicalDeclaration ? Sym.CanonicalDeclaration.FileURI
+                                    : Sym.Definition.FileURI;
+  };
+  llvm::StringMap<SymbolSlab::Builder> HeaderSymbols;
+  for (const Symbol &Sym : Symbols)
+    HeaderSymbols.try_emplace(HeaderOf(Sym), SharedStringPool::global())
+        .first->second.insert(Sym);
+  // Relations are stored with the header of their object, which is the
+  // symbol they are returned as.
+  llvm::StringMap<RelationSlab::Builder> HeaderRelations;
+  for (const Relation &R : Relations) {
+    auto It = Symbols.find(R.Object);
+    if (It != Symbols.end())
+      HeaderRelations[HeaderOf(*It)].insert(R);
+  }
+
+  struct HeaderSlabs {
+    std::string Key;
+    std::unique_ptr<SymbolSlab> Symbols;
+    std::unique_ptr<RelationSlab> Relations;
+  };
+  std::vector<HeaderSlabs> Headers;
+  for (auto &Header : HeaderSymbols) {
+    HeaderSlabs Slabs;
+    Slabs.Symbols =
+        llvm::make_unique<SymbolSlab>(std::move(Header.second).build());
+    auto It = HeaderRelations.find(Header.first());
+    Slabs.Relations = llvm::make_unique<RelationSlab>(
+        It == HeaderRelations.end() ? RelationSlab()
+                                    : std::move(It->second).build());
+    Slabs.Key =
+        headerSymbolsKey(Header.first(), *Slabs.Symbols, *Slabs.Relations);
+    Headers.push_back(std::move(Slabs));
+  }
+
+  {
+    std::lock_guard<std::mutex> Lock(PreambleMutex);
+    if (OnlyIfMissing && PreambleHeaderKeys.count(Path))
+      return false;
+    std::vector<std::string> Keys;
+    for (auto &Header : Headers) {
+      if (PreambleKeyRefs[Header.Key]++ == 0)
+        PreambleSymbols.update(Header.Key, std::move(Header.Symbols), nullptr,
+                               std::move(Header.Relations));
+      Keys.push_back(std::move(Header.Key));
+    }
+    // Release the previous preamble after adding the new one, so headers
+    // shared by both are kept.
+    auto &OldKeys = PreambleHeaderKeys[Path];
+    for (const auto &Key : OldKeys) {
+      auto It = PreambleKeyRefs.find(Key);
+      if (--It->second == 0) {
+        PreambleKeyRefs.erase(It);
+        PreambleSymbols.update(Key, nullptr, nullptr, nullptr);
+      }
+    }
+    OldKeys = std::move(Keys);
+  }
   PreambleIndex.reset(
-      PreambleSymbols.buildIndex(UseDex ? IndexType::Heavy : IndexType::Light,
-                                 DuplicateHandling::PickOne));
+      UseDex ? PreambleSymbols.buildIncrementalIndex()
+             : PreambleSymbols.buildIndex(IndexType::Light,
+                                          DuplicateHandling::PickOne));
+  IndexMemory.record(PreambleIndex.estimateMemoryUsage(), "preamble");
+  return true;
 }
 
 void FileIndex::updateMain(PathRef Path, ParsedAST &AST) {
   auto Contents = indexMainDecls(AST);
-  MainFileSymbols.update(
-      Path, llvm::make_unique<SymbolSlab>(std::move(Contents.first)),
-      llvm::make_unique<RefSlab>(std::move(Contents.second)));
+  auto Symbols =
+      llvm::make_unique<SymbolSlab>(std::move(std::get<0>(Contents)));
+  auto Refs = llvm::make_unique<RefSlab>(std::move(std::get<1>(Contents)));
+  auto Relations =
+      llvm::make_unique<RelationSlab>(std::move(std::get<2>(Contents)));
+
+  BackgroundIndexStorage *Snapshots = Storage ? Storage(Path) : nullptr;
+  llvm::Optional<FileDigest> Digest;
+  if (Snapshots) {
+    const auto &SM = AST.getSourceManager();
+    Digest = digestFile(SM, SM.getMainFileID());
+  }
+  {
+    std::lock_guard<std::mutex> Lock(MainMutex);
+    IndexedMainFiles.insert(Path);
+    if (Digest) {
+      auto Now = std::chrono::steady_clock::now();
+      auto Inserted = MainSnapshots.try_emplace(Path);
+      auto &Last = Inserted.first->second;
+      if (Inserted.second ||
+          (Last.Digest != *Digest && Now - Last.Time >= SnapshotPeriod)) {
+        Last.Digest = *Digest;
+        Last.Time = Now;
+      } else {
+        Digest.reset(); // Saved recently.
+      }
+    }
+    if (Digest) {
+      // The snapshot records the digest of the main file it was built from.
+      IncludeGraph Sources;
+      auto &Source = *Sources.try_emplace(Path).first;
+      Source.second.URI = Source.first();
+      Source.second.IsTU = true;
+      Source.second.Digest = *Digest;
+      IndexFileOut Snapshot;
+      Snapshot.Symbols = Symbols.get();
+      Snapshot.Refs = Refs.get();
+      Snapshot.Relations = Relations.get();
+      Snapshot.Sources = &Sources;
+      if (auto Err = Snapshots->storeShard(mainSnapshotID(Path), Snapshot))
+        elog("Failed to save main file index snapshot of {0}: {1}", Path,
+             std::move(Err));
+    }
+    MainFileSymbols.update(Path, std::move(Symbols), std::move(Refs),
+                           std::move(Relations));
+  }
   MainFileIndex.reset(
       MainFileSymbols.buildIndex(IndexType::Light, DuplicateHandling::PickOne));
+  IndexMemory.record(MainFileIndex.estimateMemoryUsage(), "main_file");
+}
+
+void FileIndex::setSnapshotStorage(SnapshotStorage Storage) {
+  this->Storage = std::move(Storage);
+}
+
+bool FileIndex::restoreSnapshot(PathRef Path, llvm::StringRef Contents) {
+  BackgroundIndexStorage *Snapshots = Storage ? Storage(Path) : nullptr;
+  if (!Snapshots)
+    return false;
+  trace::Span Tracer("RestoreIndexSnapshot");
+  bool RestoredPreamble = false, RestoredMain = false;
+  if (auto Snapshot = Snapshots->loadShard(preambleSnapshotID(Path)))
+    if (Snapshot->Symbols) {
+      if (!Snapshot->Relations)
+        Snapshot->Relations.emplace();
+      RestoredPreamble =
+          updatePreambleSymbols(Path, *Snapshot->Symbols, *Snapshot->Relations,
+                                /*OnlyIfMissing=*/true);
+    }
+
+  auto Snapshot = Snapshots->loadShard(mainSnapshotID(Path));
+  if (Snapshot && Snapshot->Symbols && Snapshot->Refs && Snapshot->Sources) {
+    auto Source = Snapshot->Sources->find(Path);
+    if (Source != Snapshot->Sources->end() &&
+        Source->second.Digest == digest(Contents)) {
+      std::lock_guard<std::mutex> Lock(MainMutex);
+      if (!IndexedMainFiles.count(Path)) {
+        MainFileSymbols.update(
+            Path, llvm::make_unique<SymbolSlab>(std::move(*Snapshot->Symbols)),
+            llvm::make_unique<RefSlab>(std::move(*Snapshot->Refs)),
+            Snapshot->Relations ? llvm::make_unique<RelationSlab>(
+                                      std::move(*Snapshot->Relations))
+                                : nullptr);
+        RestoredMain = true;
+      }
+    }
+  }
+  if (RestoredMain) {
+    MainFileIndex.reset(MainFileSymbols.buildIndex(IndexType::Light,
+                                                   DuplicateHandling::PickOne));
+    IndexMemory.record(MainFileIndex.estimateMemoryUsage(), "main_file");
+  }
+  SPAN_ATTACH(Tracer, "preamble", RestoredPreamble);
+  SPAN_ATTACH(Tracer, "main", RestoredMain);
+  if (RestoredPreamble || RestoredMain)
+    vlog("Restored index snapshot of {0} (preamble={1}, main={2})", Path,
+         RestoredPreamble, RestoredMain);
+  return RestoredPreamble || RestoredMain;
+}
+
+void FileIndex::profile(MemoryTree &MT) const {
+  MT.child("preamble").addUsage(PreambleIndex.estimateMemoryUsage());
+  MT.child("main_file").addUsage(MainFileIndex.estimateMemoryUsage());
 }
 
 } // namespace clangd
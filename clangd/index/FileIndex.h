@@ -18,14 +18,20 @@
 #include "ClangdUnit.h"
 #include "Index.h"
 #include "MemIndex.h"
+#include "MemoryTree.h"
 #include "Merge.h"
 #include "index/CanonicalIncludes.h"
 #include "index/Symbol.h"
 #include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include <chrono>
 #include <memory>
+#include <tuple>
 
 namespace clang {
 namespace clangd {
+class BackgroundIndexStorage;
 
 /// Select between in-memory index implementations, which have tradeoffs.
 enum class IndexType {
@@ -58,23 +64,39 @@ enum class DuplicateHandling {
 /// locking when we swap or obtain references to snapshots.
 class FileSymbols {
 public:
-  /// Updates all symbols and refs in a file.
-  /// If either is nullptr, corresponding data for \p Path will be removed.
+  /// Updates all symbols, refs and relations in a file.
+  /// If any is nullptr, corresponding data for \p Path will be removed.
   void update(PathRef Path, std::unique_ptr<SymbolSlab> Slab,
-              std::unique_ptr<RefSlab> Refs);
+              std::unique_ptr<RefSlab> Refs,
+              std::unique_ptr<RelationSlab> Relations = nullptr);
 
   // The index keeps the symbols alive.
   std::unique_ptr<SymbolIndex>
   buildIndex(IndexType,
              DuplicateHandling DuplicateHandle = DuplicateHandling::PickOne);
 
+  /// Like buildIndex(IndexType::Heavy, DuplicateHandling::PickOne), but the
+  /// cost is proportional to the files updated since the last full build.
+  /// Symbols of those files are indexed in a small delta index, which shadows
+  /// their outdated symbols in the previous (base) index. The base is rebuilt
+  /// from scratch once the delta grows too large.
+  /// Refs are only taken from the base index, so this is meant for files
+  /// without refs (e.g. preamble symbols).
+  std::unique_ptr<SymbolIndex> buildIncrementalIndex();
+
 private:
+  struct IndexSegment;
+
   mutable std::mutex Mutex;
 
   /// Stores the latest symbol snapshots for all active files.
   llvm::StringMap<std::shared_ptr<SymbolSlab>> FileToSymbols;
   /// Stores the latest ref snapshots for all active files.
   llvm::StringMap<std::shared_ptr<RefSlab>> FileToRefs;
+  /// Stores the latest relation snapshots for all active files.
+  llvm::StringMap<std::shared_ptr<RelationSlab>> FileToRelations;
+  /// The last full index built by buildIncrementalIndex().
+  std::shared_ptr<const IndexSegment> Base;
 };
 
 /// This manages symbols from files and an in-memory index on all symbols.
@@ -93,22 +115,64 @@ public:
   /// `indexMainDecls`.
   void updateMain(PathRef Path, ParsedAST &AST);
 
+  /// Adds the memory used by the preamble and main file indexes to \p MT.
+  void profile(MemoryTree &MT) const;
+
+  /// Returns the storage for snapshots of the index of a file, or nullptr.
+  /// Must be thread-safe.
+  using SnapshotStorage =
+      llvm::unique_function<BackgroundIndexStorage *(PathRef)>;
+  /// Saves snapshots of the preamble and main file symbols of each file, so
+  /// that restoreSnapshot() can serve them after a restart, before the file is
+  /// parsed again. Must be called before any update.
+  ///
+  /// Preamble snapshots are saved on each preamble update. Main file snapshots
+  /// are saved at most once per SnapshotPeriod for each file, as main files
+  /// change on every edit.
+  void setSnapshotStorage(SnapshotStorage Storage);
+
+  /// Restores the last snapshot of the symbols of \p Path, unless the file was
+  /// indexed since. Main file symbols are only restored if they were saved for
+  /// \p Contents. Returns whether anything was restored.
+  /// Restored symbols are replaced when the file is indexed again.
+  bool restoreSnapshot(PathRef Path, llvm::StringRef Contents);
+
+  // Only counts preamble updates: the main file index is replaced on each
+  // edit and only holds symbols of main files.
+  uint64_t headerGeneration() const override {
+    return PreambleIndex.headerGeneration();
+  }
+
 private:
+  /// Replaces the preamble symbols and relations of \p Path. If \p OnlyIfMissing is set,
+  /// existing symbols of \p Path are kept instead. Returns whether the symbols
+  /// were replaced.
+  bool updatePreambleSymbols(PathRef Path, const SymbolSlab &Symbols,
+                             const RelationSlab &Relations, bool OnlyIfMissing);
+
   bool UseDex; // FIXME: this should be always on.
 
+  SnapshotStorage Storage;
+  static constexpr std::chrono::seconds SnapshotPeriod{30};
+
   // Contains information from each file's preamble only.
   // These are large, but update fairly infrequently (preambles are stable).
   // Missing information:
   //  - symbol refs (these are always "from the main file")
   //  - definition locations in the main file
   //
-  // FIXME: Because the preambles for different TUs have large overlap and
-  // FileIndex doesn't deduplicate, this uses lots of extra RAM.
-  // The biggest obstacle in fixing this: the obvious approach of partitioning
-  // by declaring file (rather than main file) fails if headers provide
-  // different symbols based on preprocessor state.
+  // Preambles of different TUs have large overlap, so symbols are partitioned
+  // by declaring header and keyed by the header and a digest of its symbols.
+  // Headers that provide the same symbols in several TUs are stored once,
+  // while headers that provide different symbols based on preprocessor state
+  // get one entry per variant.
   FileSymbols PreambleSymbols;
   SwapIndex PreambleIndex;
+  std::mutex PreambleMutex;
+  // Keys in PreambleSymbols of the header symbols in each main file's preamble.
+  llvm::StringMap<std::vector<std::string>> PreambleHeaderKeys;
+  // Number of main files sharing each key in PreambleSymbols.
+  llvm::StringMap<unsigned> PreambleKeyRefs;
 
   // Contains information from each file's main AST.
   // These are updated frequently (on file change), but are relatively small.
@@ -118,17 +182,28 @@ private:
   // (Note that symbols *only* in the main file are not indexed).
   FileSymbols MainFileSymbols;
   SwapIndex MainFileIndex;
+  std::mutex MainMutex;
+  // Main files indexed by this process, whose snapshots are outdated.
+  llvm::StringSet<> IndexedMainFiles;
+  struct MainSnapshot {
+    FileDigest Digest;
+    std::chrono::steady_clock::time_point Time;
+  };
+  // The last main file snapshot saved for each file.
+  llvm::StringMap<MainSnapshot> MainSnapshots;
 };
 
-/// Retrieves symbols and refs of local top level decls in \p AST (i.e.
-/// `AST.getLocalTopLevelDecls()`).
+using SlabTuple = std::tuple<SymbolSlab, RefSlab, RelationSlab>;
+
+/// Retrieves symbols, refs and relations of local top level decls in \p AST
+/// (i.e. `AST.getLocalTopLevelDecls()`).
 /// Exposed to assist in unit tests.
-std::pair<SymbolSlab, RefSlab> indexMainDecls(ParsedAST &AST);
+SlabTuple indexMainDecls(ParsedAST &AST);
 
 /// Idex declarations from \p AST and macros from \p PP that are declared in
-/// included headers.
-SymbolSlab indexHeaderSymbols(ASTContext &AST, std::shared_ptr<Preprocessor> PP,
-                              const CanonicalIncludes &Includes);
+/// included headers. The returned refs are empty.
+SlabTuple indexHeaderSymbols(ASTContext &AST, std::shared_ptr<Preprocessor> PP,
+                             const CanonicalIncludes &Includes);
 
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,61 @@
+//===--- FileRefs.cpp - Files referencing a set of symbols -------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "FileRefs.h"
+#include "Logger.h"
+#include "URI.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+namespace clang {
+namespace clangd {
+
+static std::string pathStem(llvm::StringRef Path) {
+  llvm::SmallString<128> Stem = Path;
+  llvm::sys::path::replace_extension(Stem, "");
+  return Stem.str();
+}
+
+std::vector<std::string>
+filterReferencingFiles(const SymbolIndex &Index,
+                       const llvm::DenseSet<SymbolID> &IDs,
+                       llvm::ArrayRef<std::string> Files) {
+  // A file usually holds many refs, only resolve each URI once.
+  llvm::StringSet<> SeenURIs;
+  llvm::StringSet<> Paths;
+  llvm::StringSet<> Stems;
+  RefsRequest Req;
+  Req.IDs = IDs;
+  Index.refs(Req, [&](const Ref &R) {
+    if (!SeenURIs.insert(R.Location.FileURI).second)
+      return;
+    auto Path = URI::resolve(R.Location.FileURI);
+    if (!Path) {
+      elog("Could not resolve URI {0}: {1}", R.Location.FileURI,
+           Path.takeError());
+      return;
+    }
+    Paths.insert(*Path);
+    Stems.insert(pathStem(*Path));
+  });
+
+  std::vector<std::string> Result;
+  for (const std::string &File : Files) {
+    llvm::SmallString<128> AbsPath = llvm::StringRef(File);
+    llvm::sys::fs::make_absolute(AbsPath);
+    llvm::sys::path::remove_dots(AbsPath, /*remove_dot_dot=*/true);
+    if (Paths.count(AbsPath) || Stems.count(pathStem(AbsPath)))
+      Result.push_back(File);
+  }
+  return Result;
+}
+
+} // namespace clangd
+} // namespace clang
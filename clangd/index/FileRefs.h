@@ -0,0 +1,41 @@
+//===--- FileRefs.h - Files referencing a set of symbols ---------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Helps refactoring tools that run over many translation units only process
+// those that can be affected, according to a static index.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_FILEREFS_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_FILEREFS_H
+
+#include "Index.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace clangd {
+
+/// Returns the files of \p Files, in order, that \p Index records as
+/// referencing (or declaring) one of the symbols \p IDs.
+///
+/// The index does not know which files include a header, so a file is also
+/// kept when it has the same path stem as a referencing file, e.g. foo.cc for
+/// a reference in foo.h. Relative paths in \p Files are resolved against the
+/// working directory.
+std::vector<std::string>
+filterReferencingFiles(const SymbolIndex &Index,
+                       const llvm::DenseSet<SymbolID> &IDs,
+                       llvm::ArrayRef<std::string> Files);
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_FILEREFS_H
@@ -8,6 +8,8 @@
 
 #include "Index.h"
 #include "Logger.h"
+#include "ResourceUsage.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
@@ -21,13 +23,14 @@ void SwapIndex::reset(std::unique_ptr<SymbolIndex> Index) {
   // Keep the old index alive, so we don't destroy it under lock (may be slow).
   std::shared_ptr<SymbolIndex> Pin;
   {
-    std::lock_guard<std::mutex> Lock(Mutex);
+    auto Lock = lockAccounted(Mutex, "SwapIndex");
     Pin = std::move(this->Index);
     this->Index = std::move(Index);
   }
+  OnGenerationChanged.broadcast(++Generation);
 }
 std::shared_ptr<SymbolIndex> SwapIndex::snapshot() const {
-  std::lock_guard<std::mutex> Lock(Mutex);
+  auto Lock = lockAccounted(Mutex, "SwapIndex");
   return Index;
 }
 
@@ -45,6 +48,17 @@ bool fromJSON(const llvm::json::Value &Parameters, FuzzyFindRequest &Request) {
   return OK;
 }
 
+llvm::hash_code hash_value(const FuzzyFindRequest &Req) {
+  return llvm::hash_combine(
+      Req.Query, llvm::hash_combine_range(Req.Scopes.begin(), Req.Scopes.end()),
+      Req.AnyScope, Req.Limit.hasValue(), Req.Limit.getValueOr(0),
+      Req.RestrictForCodeCompletion,
+      llvm::hash_combine_range(Req.ProximityPaths.begin(),
+                               Req.ProximityPaths.end()),
+      llvm::hash_combine_range(Req.PreferredTypes.begin(),
+                               Req.PreferredTypes.end()));
+}
+
 llvm::json::Value toJSON(const FuzzyFindRequest &Request) {
   return llvm::json::Object{
       {"Query", Request.Query},
@@ -57,10 +71,26 @@ llvm::json::Value toJSON(const FuzzyFindRequest &Request) {
   };
 }
 
+std::vector<bool> SymbolIndex::fuzzyFindBatch(
+    llvm::ArrayRef<FuzzyFindRequest> Reqs,
+    llvm::function_ref<void(size_t, const Symbol &)> Callback) const {
+  std::vector<bool> More;
+  More.reserve(Reqs.size());
+  for (size_t I = 0; I < Reqs.size(); ++I)
+    More.push_back(
+        fuzzyFind(Reqs[I], [&](const Symbol &S) { Callback(I, S); }));
+  return More;
+}
+
 bool SwapIndex::fuzzyFind(const FuzzyFindRequest &R,
                           llvm::function_ref<void(const Symbol &)> CB) const {
   return snapshot()->fuzzyFind(R, CB);
 }
+std::vector<bool> SwapIndex::fuzzyFindBatch(
+    llvm::ArrayRef<FuzzyFindRequest> Reqs,
+    llvm::function_ref<void(size_t, const Symbol &)> CB) const {
+  return snapshot()->fuzzyFindBatch(Reqs, CB);
+}
 void SwapIndex::lookup(const LookupRequest &R,
                        llvm::function_ref<void(const Symbol &)> CB) const {
   return snapshot()->lookup(R, CB);
@@ -69,6 +99,11 @@ void SwapIndex::refs(const RefsRequest &R,
                      llvm::function_ref<void(const Ref &)> CB) const {
   return snapshot()->refs(R, CB);
 }
+void SwapIndex::relations(
+    const RelationsRequest &R,
+    llvm::function_ref<void(const SymbolID &, const Symbol &)> CB) const {
+  return snapshot()->relations(R, CB);
+}
 size_t SwapIndex::estimateMemoryUsage() const {
   return snapshot()->estimateMemoryUsage();
 }
@@ -9,15 +9,19 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_INDEX_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_INDEX_H
 
+#include "Function.h"
 #include "Ref.h"
+#include "Relation.h"
 #include "Symbol.h"
 #include "SymbolID.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/JSON.h"
+#include <atomic>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace clang {
 namespace clangd {
@@ -48,14 +52,15 @@ struct FuzzyFindRequest {
   std::vector<std::string> PreferredTypes;
 
   bool operator==(const FuzzyFindRequest &Req) const {
-    return std::tie(Query, Scopes, Limit, RestrictForCodeCompletion,
+    return std::tie(Query, Scopes, AnyScope, Limit, RestrictForCodeCompletion,
                     ProximityPaths, PreferredTypes) ==
-           std::tie(Req.Query, Req.Scopes, Req.Limit,
+           std::tie(Req.Query, Req.Scopes, Req.AnyScope, Req.Limit,
                     Req.RestrictForCodeCompletion, Req.ProximityPaths,
                     Req.PreferredTypes);
   }
   bool operator!=(const FuzzyFindRequest &Req) const { return !(*this == Req); }
 };
+llvm::hash_code hash_value(const FuzzyFindRequest &Req);
 bool fromJSON(const llvm::json::Value &Value, FuzzyFindRequest &Request);
 llvm::json::Value toJSON(const FuzzyFindRequest &Request);
 
@@ -70,6 +75,18 @@ struct RefsRequest {
   /// choose to return less than this, e.g. it tries to avoid returning stale
   /// results.
   llvm::Optional<uint32_t> Limit;
+  /// Absolute paths the request is made from. If there are more than Limit
+  /// refs, the index may prefer returning those in files near these paths.
+  /// Refs in these files themselves are known to the caller (e.g. from the
+  /// AST) and may then be skipped, so that they don't use up the limit.
+  std::vector<std::string> ProximityPaths;
+};
+
+struct RelationsRequest {
+  llvm::DenseSet<SymbolID> Subjects;
+  index::SymbolRole Predicate;
+  /// If set, limit the number of relations returned from the index.
+  llvm::Optional<uint32_t> Limit;
 };
 
 /// Interface for symbol indexes that can be used for searching or
@@ -87,6 +104,19 @@ public:
   fuzzyFind(const FuzzyFindRequest &Req,
             llvm::function_ref<void(const Symbol &)> Callback) const = 0;
 
+  /// Runs each of \p Reqs as fuzzyFind() would, calling \p Callback with the
+  /// index of the request in \p Reqs and a symbol matching it. \p Callback is
+  /// never called concurrently, but results of different requests may be
+  /// interleaved.
+  ///
+  /// Returns, for each request, true if there may be more results.
+  /// The default implementation runs the requests one after another; indexes
+  /// that can share work between requests (or run them in parallel) should
+  /// override it.
+  virtual std::vector<bool> fuzzyFindBatch(
+      llvm::ArrayRef<FuzzyFindRequest> Reqs,
+      llvm::function_ref<void(size_t, const Symbol &)> Callback) const;
+
   /// Looks up symbols with any of the given symbol IDs and applies \p Callback
   /// on each matched symbol.
   /// The returned symbol must be deep-copied if it's used outside Callback.
@@ -102,8 +132,27 @@ public:
   virtual void refs(const RefsRequest &Req,
                     llvm::function_ref<void(const Ref &)> Callback) const = 0;
 
+  /// Finds all relations (S, P, O) stored in the index such that S is among
+  /// Req.Subjects and P is Req.Predicate, and invokes \p Callback for (S, O)
+  /// with the symbol of each O.
+  /// The default implementation finds nothing, for indexes that don't store
+  /// relations.
+  virtual void relations(
+      const RelationsRequest &Req,
+      llvm::function_ref<void(const SymbolID &Subject, const Symbol &Object)>
+          Callback) const {}
+
   /// Returns estimated size of index (in bytes).
   virtual size_t estimateMemoryUsage() const = 0;
+
+  /// Returns a number that increases whenever the results of queries may
+  /// change, so that they can be cached until then. Indexes that never change
+  /// return 0.
+  virtual uint64_t generation() const { return 0; }
+
+  /// Like generation(), but only for the symbols declared in headers: symbols
+  /// of files only indexed as main files may change without affecting it.
+  virtual uint64_t headerGeneration() const { return generation(); }
 };
 
 // Delegating implementation of SymbolIndex whose delegate can be swapped out.
@@ -118,16 +167,33 @@ public:
   // until the call returns (even if reset() is called).
   bool fuzzyFind(const FuzzyFindRequest &,
                  llvm::function_ref<void(const Symbol &)>) const override;
+  // The whole batch runs against one snapshot.
+  std::vector<bool> fuzzyFindBatch(
+      llvm::ArrayRef<FuzzyFindRequest>,
+      llvm::function_ref<void(size_t, const Symbol &)>) const override;
   void lookup(const LookupRequest &,
               llvm::function_ref<void(const Symbol &)>) const override;
   void refs(const RefsRequest &,
             llvm::function_ref<void(const Ref &)>) const override;
+  void relations(const RelationsRequest &,
+                 llvm::function_ref<void(const SymbolID &, const Symbol &)>)
+      const override;
   size_t estimateMemoryUsage() const override;
+  // Counts the calls to reset(), the delegates themselves must not change.
+  uint64_t generation() const override { return Generation; }
+
+  using GenerationChanged = Event<uint64_t>;
+  /// The callback is notified with the new generation after each reset().
+  GenerationChanged::Subscription watch(GenerationChanged::Listener L) const {
+    return OnGenerationChanged.observe(std::move(L));
+  }
 
 private:
   std::shared_ptr<SymbolIndex> snapshot() const;
   mutable std::mutex Mutex;
   std::shared_ptr<SymbolIndex> Index;
+  std::atomic<uint64_t> Generation = {0};
+  mutable GenerationChanged OnGenerationChanged;
 };
 
 } // namespace clangd
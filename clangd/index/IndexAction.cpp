@@ -9,6 +9,7 @@
 #include "IndexAction.h"
 #include "index/SymbolOrigin.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/MultiplexConsumer.h"
 #include "clang/Index/IndexingAction.h"
 #include "clang/Tooling/Tooling.h"
 
@@ -46,11 +47,9 @@ public:
       return;
 
     const auto FileID = SM.getFileID(Loc);
-    const auto File = SM.getFileEntryForID(FileID);
-    auto URI = toURI(File);
-    if (!URI)
+    auto *I = node(SM.getFileEntryForID(FileID));
+    if (!I)
       return;
-    auto I = IG.try_emplace(*URI).first;
 
     auto &Node = I->getValue();
     // Node has already been populated.
@@ -75,18 +74,15 @@ public:
                           llvm::StringRef SearchPath,
                           llvm::StringRef RelativePath, const Module *Imported,
                           SrcMgr::CharacteristicKind FileType) override {
-    auto IncludeURI = toURI(File);
-    if (!IncludeURI)
+    auto *NodeForIncluding = node(SM.getFileEntryForID(SM.getFileID(HashLoc)));
+    if (!NodeForIncluding)
       return;
-
-    auto IncludingURI = toURI(SM.getFileEntryForID(SM.getFileID(HashLoc)));
-    if (!IncludingURI)
+    auto *NodeForInclude = node(File);
+    if (!NodeForInclude)
       return;
 
-    auto NodeForInclude = IG.try_emplace(*IncludeURI).first->getKey();
-    auto NodeForIncluding = IG.try_emplace(*IncludingURI);
-
-    NodeForIncluding.first->getValue().DirectIncludes.push_back(NodeForInclude);
+    NodeForIncluding->getValue().DirectIncludes.push_back(
+        NodeForInclude->getKey());
   }
 
   // Sanity check to ensure we have already populated a skipped file.
@@ -104,8 +100,51 @@ public:
   }
 
 private:
+  using NodeEntry = llvm::StringMapEntry<IncludeGraphNode>;
+
+  // Returns the node of File in IG, creating it if needed, or null if File
+  // has no URI. Files are converted to URIs only once.
+  NodeEntry *node(const FileEntry *File) {
+    auto I = Nodes.try_emplace(File, nullptr);
+    if (I.second)
+      if (auto URI = toURI(File))
+        I.first->second = &*IG.try_emplace(*URI).first;
+    return I.first->second;
+  }
+
   const SourceManager &SM;
   IncludeGraph &IG;
+  // StringMap entries are never moved, so the pointers stay valid.
+  llvm::DenseMap<const FileEntry *, NodeEntry *> Nodes;
+};
+
+// Lets Sema skip the function bodies in files that are filtered out by the
+// SymbolCollector: nothing they contain would be collected.
+class SkipFilteredBodiesConsumer : public MultiplexConsumer {
+public:
+  SkipFilteredBodiesConsumer(std::unique_ptr<ASTConsumer> Consumer,
+                             SymbolCollector &Collector)
+      : MultiplexConsumer(makeVector(std::move(Consumer))),
+        Collector(Collector) {}
+
+  bool shouldSkipFunctionBody(Decl *D) override {
+    const auto &SM = D->getASTContext().getSourceManager();
+    FileID FID = SM.getFileID(SM.getExpansionLoc(D->getLocation()));
+    // Refs in the main file are always wanted.
+    if (FID.isInvalid() || FID == SM.getMainFileID())
+      return false;
+    return !Collector.shouldIndexFile(FID);
+  }
+
+private:
+  static std::vector<std::unique_ptr<ASTConsumer>>
+  makeVector(std::unique_ptr<ASTConsumer> Consumer) {
+    std::vector<std::unique_ptr<ASTConsumer>> Consumers;
+    Consumers.push_back(std::move(Consumer));
+    return Consumers;
+  }
+
+  SymbolCollector &Collector;
 };
 
 // Wraps the index action and reports index data after each translation unit.
@@ -116,9 +155,11 @@ public:
               const index::IndexingOptions &Opts,
               std::function<void(SymbolSlab)> SymbolsCallback,
               std::function<void(RefSlab)> RefsCallback,
+              std::function<void(RelationSlab)> RelationsCallback,
               std::function<void(IncludeGraph)> IncludeGraphCallback)
       : WrapperFrontendAction(index::createIndexingAction(C, Opts, nullptr)),
         SymbolsCallback(SymbolsCallback), RefsCallback(RefsCallback),
+        RelationsCallback(RelationsCallback),
         IncludeGraphCallback(IncludeGraphCallback), Collector(C),
         Includes(std::move(Includes)),
         PragmaHandler(collectIWYUHeaderMaps(this->Includes.get())) {}
@@ -129,7 +170,8 @@ public:
     if (IncludeGraphCallback != nullptr)
       CI.getPreprocessor().addPPCallbacks(
           llvm::make_unique<IncludeGraphCollector>(CI.getSourceManager(), IG));
-    return WrapperFrontendAction::CreateASTConsumer(CI, InFile);
+    return llvm::make_unique<SkipFilteredBodiesConsumer>(
+        WrapperFrontendAction::CreateASTConsumer(CI, InFile), *Collector);
   }
 
   bool BeginInvocation(CompilerInstance &CI) override {
@@ -139,6 +181,9 @@ public:
     // Avoids some analyses too. Set in two places as we're late to the party.
     CI.getDiagnosticOpts().IgnoreWarnings = true;
     CI.getDiagnostics().setIgnoreAllWarnings(true);
+    // Bodies of functions in files we don't collect results from are only
+    // parsed when Sema needs them, see SkipFilteredBodiesConsumer.
+    CI.getFrontendOpts().SkipFunctionBodies = true;
 
     return WrapperFrontendAction::BeginInvocation(CI);
   }
@@ -155,6 +200,8 @@ public:
     SymbolsCallback(Collector->takeSymbols());
     if (RefsCallback != nullptr)
       RefsCallback(Collector->takeRefs());
+    if (RelationsCallback != nullptr)
+      RelationsCallback(Collector->takeRelations());
     if (IncludeGraphCallback != nullptr) {
 #ifndef NDEBUG
       // This checks if all nodes are initialized.
@@ -168,6 +215,7 @@ public:
 private:
   std::function<void(SymbolSlab)> SymbolsCallback;
   std::function<void(RefSlab)> RefsCallback;
+  std::function<void(RelationSlab)> RelationsCallback;
   std::function<void(IncludeGraph)> IncludeGraphCallback;
   std::shared_ptr<SymbolCollector> Collector;
   std::unique_ptr<CanonicalIncludes> Includes;
@@ -181,6 +229,7 @@ std::unique_ptr<FrontendAction> createStaticIndexingAction(
     SymbolCollector::Options Opts,
     std::function<void(SymbolSlab)> SymbolsCallback,
     std::function<void(RefSlab)> RefsCallback,
+    std::function<void(RelationSlab)> RelationsCallback,
     std::function<void(IncludeGraph)> IncludeGraphCallback) {
   index::IndexingOptions IndexOpts;
   IndexOpts.SystemSymbolFilter =
@@ -199,7 +248,8 @@ std::unique_ptr<FrontendAction> createStaticIndexingAction(
   Opts.Includes = Includes.get();
   return llvm::make_unique<IndexAction>(
       std::make_shared<SymbolCollector>(std::move(Opts)), std::move(Includes),
-      IndexOpts, SymbolsCallback, RefsCallback, IncludeGraphCallback);
+      IndexOpts, SymbolsCallback, RefsCallback, RelationsCallback,
+      IncludeGraphCallback);
 }
 
 } // namespace clangd
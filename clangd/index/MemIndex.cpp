@@ -24,6 +24,15 @@ std::unique_ptr<SymbolIndex> MemIndex::build(SymbolSlab Slab, RefSlab Refs) {
                                      BackingDataSize);
 }
 
+std::unique_ptr<SymbolIndex> MemIndex::build(SymbolSlab Slab, RefSlab Refs,
+                                             RelationSlab Relations) {
+  // Store Slab size before it is moved.
+  const auto BackingDataSize = Slab.bytes() + Refs.bytes();
+  auto Data = std::make_pair(std::move(Slab), std::move(Refs));
+  return llvm::make_unique<MemIndex>(Data.first, Data.second, Relations,
+                                     std::move(Data), BackingDataSize);
+}
+
 bool MemIndex::fuzzyFind(
     const FuzzyFindRequest &Req,
     llvm::function_ref<void(const Symbol &)> Callback) const {
@@ -93,8 +102,35 @@ void MemIndex::refs(const RefsRequest &Req,
   }
 }
 
+void MemIndex::relations(
+    const RelationsRequest &Req,
+    llvm::function_ref<void(const SymbolID &, const Symbol &)> Callback) const {
+  trace::Span Tracer("MemIndex relations");
+  uint32_t Remaining =
+      Req.Limit.getValueOr(std::numeric_limits<uint32_t>::max());
+  for (const SymbolID &Subject : Req.Subjects) {
+    auto It = Relations.find(
+        std::make_pair(Subject, static_cast<uint32_t>(Req.Predicate)));
+    if (It == Relations.end())
+      continue;
+    for (const SymbolID &Object : It->second) {
+      if (!Remaining)
+        return;
+      auto Sym = Index.find(Object);
+      if (Sym == Index.end())
+        continue;
+      --Remaining;
+      Callback(Subject, *Sym->second);
+    }
+  }
+}
+
 size_t MemIndex::estimateMemoryUsage() const {
-  return Index.getMemorySize() + Refs.getMemorySize() + BackingDataSize;
+  size_t Bytes =
+      Index.getMemorySize() + Refs.getMemorySize() + Relations.getMemorySize();
+  for (const auto &R : Relations)
+    Bytes += R.second.capacity() * sizeof(SymbolID);
+  return Bytes + BackingDataSize;
 }
 
 } // namespace clangd
@@ -7,16 +7,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "Merge.h"
+#include "Cancellation.h"
 #include "Logger.h"
 #include "Trace.h"
 #include "index/Symbol.h"
+#include "index/SymbolIDMap.h"
 #include "index/SymbolLocation.h"
 #include "index/SymbolOrigin.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <future>
 #include <iterator>
 
 namespace clang {
@@ -36,8 +41,23 @@ bool MergedIndex::fuzzyFind(
   //    a) if it's not in the dynamic slab, yield it directly
   //    b) if it's in the dynamic slab, merge it and yield the result
   //  3) now yield all the dynamic symbols we haven't processed.
+  //
+  // In concurrent mode, 2) runs on another thread alongside 1), slurping the
+  // static symbols into a slab too; they're yielded once both are done.
   trace::Span Tracer("MergedIndex fuzzyFind");
   bool More = false; // We'll be incomplete if either source was.
+  std::future<std::pair<bool, SymbolSlab>> StaticResults;
+  if (Concurrent)
+    StaticResults = std::async(
+        std::launch::async,
+        [this, &Req](Context Ctx) {
+          WithContext WithCtx(std::move(Ctx));
+          SymbolSlab::Builder StaticB;
+          bool StaticMore = Static->fuzzyFind(
+              Req, [&](const Symbol &S) { StaticB.insert(S); });
+          return std::make_pair(StaticMore, std::move(StaticB).build());
+        },
+        Context::current().clone());
   SymbolSlab::Builder DynB;
   unsigned DynamicCount = 0;
   unsigned StaticCount = 0;
@@ -47,9 +67,11 @@ bool MergedIndex::fuzzyFind(
     DynB.insert(S);
   });
   SymbolSlab Dyn = std::move(DynB).build();
+  if (isCancelled())
+    return true; // Nobody will look at the results.
 
-  llvm::DenseSet<SymbolID> SeenDynamicSymbols;
-  More |= Static->fuzzyFind(Req, [&](const Symbol &S) {
+  SymbolIDSet SeenDynamicSymbols;
+  auto OnStatic = [&](const Symbol &S) {
     auto DynS = Dyn.find(S.ID);
     ++StaticCount;
     if (DynS == Dyn.end())
@@ -57,7 +79,15 @@ bool MergedIndex::fuzzyFind(
     ++MergedCount;
     SeenDynamicSymbols.insert(S.ID);
     Callback(mergeSymbol(*DynS, S));
-  });
+  };
+  if (Concurrent) {
+    auto StaticSyms = StaticResults.get();
+    More |= StaticSyms.first;
+    for (const Symbol &S : StaticSyms.second)
+      OnStatic(S);
+  } else {
+    More |= Static->fuzzyFind(Req, OnStatic);
+  }
   SPAN_ATTACH(Tracer, "dynamic", DynamicCount);
   SPAN_ATTACH(Tracer, "static", StaticCount);
   SPAN_ATTACH(Tracer, "merged", MergedCount);
@@ -67,6 +97,39 @@ bool MergedIndex::fuzzyFind(
   return More;
 }
 
+std::vector<bool> MergedIndex::fuzzyFindBatch(
+    llvm::ArrayRef<FuzzyFindRequest> Reqs,
+    llvm::function_ref<void(size_t, const Symbol &)> Callback) const {
+  // Same as fuzzyFind(), but each source sees the whole batch in one call so
+  // it can share work between the requests.
+  trace::Span Tracer("MergedIndex fuzzyFindBatch");
+  SPAN_ATTACH(Tracer, "requests", static_cast<int>(Reqs.size()));
+  std::vector<SymbolSlab::Builder> DynB(Reqs.size());
+  std::vector<bool> More = Dynamic->fuzzyFindBatch(
+      Reqs, [&](size_t I, const Symbol &S) { DynB[I].insert(S); });
+  std::vector<SymbolSlab> Dyn;
+  Dyn.reserve(Reqs.size());
+  for (auto &B : DynB)
+    Dyn.push_back(std::move(B).build());
+
+  std::vector<SymbolIDSet> SeenDynamicSymbols(Reqs.size());
+  std::vector<bool> StaticMore = Static->fuzzyFindBatch(
+      Reqs, [&](size_t I, const Symbol &S) {
+        auto DynS = Dyn[I].find(S.ID);
+        if (DynS == Dyn[I].end())
+          return Callback(I, S);
+        SeenDynamicSymbols[I].insert(S.ID);
+        Callback(I, mergeSymbol(*DynS, S));
+      });
+  for (size_t I = 0; I < Reqs.size(); ++I) {
+    More[I] = More[I] || StaticMore[I];
+    for (const Symbol &S : Dyn[I])
+      if (!SeenDynamicSymbols[I].count(S.ID))
+        Callback(I, S);
+  }
+  return More;
+}
+
 void MergedIndex::lookup(
     const LookupRequest &Req,
     llvm::function_ref<void(const Symbol &)> Callback) const {
@@ -108,7 +171,7 @@ void MergedIndex::refs(const RefsRequest &Req,
     Callback(O);
     --Remaining;
   });
-  if (Remaining == 0)
+  if (Remaining == 0 || isCancelled())
     return;
   // We return less than Req.Limit if static index returns more refs for dirty
   // files.
@@ -120,6 +183,31 @@ void MergedIndex::refs(const RefsRequest &Req,
   });
 }
 
+void MergedIndex::relations(
+    const RelationsRequest &Req,
+    llvm::function_ref<void(const SymbolID &, const Symbol &)> Callback) const {
+  trace::Span Tracer("MergedIndex relations");
+  uint32_t Remaining =
+      Req.Limit.getValueOr(std::numeric_limits<uint32_t>::max());
+  // Return results from both indexes but avoid duplicates.
+  // FIXME: Like refs, we may return stale relations from the static index.
+  llvm::DenseSet<std::pair<SymbolID, SymbolID>> SeenRelations;
+  Dynamic->relations(Req, [&](const SymbolID &Subject, const Symbol &Object) {
+    SeenRelations.insert(std::make_pair(Subject, Object.ID));
+    Callback(Subject, Object);
+    --Remaining;
+  });
+  if (Remaining == 0 || isCancelled())
+    return;
+  Static->relations(Req, [&](const SymbolID &Subject, const Symbol &Object) {
+    if (Remaining > 0 &&
+        !SeenRelations.count(std::make_pair(Subject, Object.ID))) {
+      --Remaining;
+      Callback(Subject, Object);
+    }
+  });
+}
+
 // Returns true if \p L is (strictly) preferred to \p R (e.g. by file paths). If
 // neither is preferred, this returns false.
 bool prefer(const SymbolLocation &L, const SymbolLocation &R) {
@@ -185,5 +273,53 @@ Symbol mergeSymbol(const Symbol &L, const Symbol &R) {
   return S;
 }
 
+SymbolSlab mergeSlabs(llvm::ArrayRef<std::shared_ptr<const SymbolSlab>> Slabs,
+                      unsigned Threads) {
+  trace::Span Tracer("MergeSlabs");
+  // Partitions much smaller than this are not worth a thread.
+  constexpr size_t MinSymbolsPerPartition = 1 << 14;
+  size_t NumSymbols = 0;
+  for (const auto &Slab : Slabs)
+    NumSymbols += Slab->size();
+  if (Threads == 0)
+    Threads = llvm::hardware_concurrency();
+  unsigned NumPartitions = std::max<size_t>(
+      1, std::min<size_t>(Threads, NumSymbols / MinSymbolsPerPartition));
+
+  // Each partition owns the IDs hashing to it, so no locking is needed.
+  std::vector<std::vector<Symbol>> Partitions(NumPartitions);
+  auto MergePartition = [&](unsigned P) {
+    SymbolIDMap<size_t> Index;
+    auto &Out = Partitions[P];
+    for (const auto &Slab : Slabs)
+      for (const Symbol &S : *Slab) {
+        if (NumPartitions > 1 && hash_value(S.ID) % NumPartitions != P)
+          continue;
+        auto R = Index.try_emplace(S.ID, Out.size());
+        if (R.second)
+          Out.push_back(S);
+        else
+          Out[*R.first] = mergeSymbol(Out[*R.first], S);
+      }
+  };
+  if (NumPartitions == 1) {
+    MergePartition(0);
+  } else {
+    llvm::ThreadPool Pool(NumPartitions);
+    for (unsigned P = 0; P < NumPartitions; ++P)
+      Pool.async(MergePartition, P);
+    Pool.wait();
+  }
+
+  // Merged symbols only reference strings of the inputs.
+  SymbolSlab::Builder Builder;
+  for (const auto &Slab : Slabs)
+    Builder.adopt(Slab);
+  for (auto &Partition : Partitions)
+    for (auto &S : Partition)
+      Builder.insertAdopted(std::move(S));
+  return std::move(Builder).build();
+}
+
 } // namespace clangd
 } // namespace clang
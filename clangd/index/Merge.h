@@ -19,6 +19,13 @@ namespace clangd {
 // Returned symbol may contain data owned by either source.
 Symbol mergeSymbol(const Symbol &L, const Symbol &R);
 
+// Merges all symbols of the slabs, combining those with the same ID by
+// mergeSymbol() in slab order. The result adopts the input slabs rather than
+// copying their strings. Symbols are partitioned by ID hash, and partitions
+// are merged on up to \p Threads threads (0 means one per core).
+SymbolSlab mergeSlabs(llvm::ArrayRef<std::shared_ptr<const SymbolSlab>> Slabs,
+                      unsigned Threads = 1);
+
 // MergedIndex is a composite index based on two provided Indexes:
 //  - the Dynamic index covers few files, but is relatively up-to-date.
 //  - the Static index covers a bigger set of files, but is relatively stale.
@@ -29,22 +36,41 @@ Symbol mergeSymbol(const Symbol &L, const Symbol &R);
 // and refs from Static index.
 class MergedIndex : public SymbolIndex {
   const SymbolIndex *Dynamic, *Static;
+  bool Concurrent;
 
 public:
   // The constructor does not access the symbols.
   // It's safe to inherit from this class and pass pointers to derived members.
-  MergedIndex(const SymbolIndex *Dynamic, const SymbolIndex *Static)
-      : Dynamic(Dynamic), Static(Static) {}
+  //
+  // If Concurrent is true, fuzzyFind() queries the Static index on another
+  // thread while querying the Dynamic one, so it takes as long as the slower
+  // of the two rather than both. This costs a thread per query and a copy of
+  // the static results, so it's only worth it if Static may be slow.
+  MergedIndex(const SymbolIndex *Dynamic, const SymbolIndex *Static,
+              bool Concurrent = false)
+      : Dynamic(Dynamic), Static(Static), Concurrent(Concurrent) {}
 
   bool fuzzyFind(const FuzzyFindRequest &,
                  llvm::function_ref<void(const Symbol &)>) const override;
+  std::vector<bool> fuzzyFindBatch(
+      llvm::ArrayRef<FuzzyFindRequest>,
+      llvm::function_ref<void(size_t, const Symbol &)>) const override;
   void lookup(const LookupRequest &,
               llvm::function_ref<void(const Symbol &)>) const override;
   void refs(const RefsRequest &,
             llvm::function_ref<void(const Ref &)>) const override;
+  void relations(const RelationsRequest &,
+                 llvm::function_ref<void(const SymbolID &, const Symbol &)>)
+      const override;
   size_t estimateMemoryUsage() const override {
     return Dynamic->estimateMemoryUsage() + Static->estimateMemoryUsage();
   }
+  uint64_t generation() const override {
+    return Dynamic->generation() + Static->generation();
+  }
+  uint64_t headerGeneration() const override {
+    return Dynamic->headerGeneration() + Static->headerGeneration();
+  }
 };
 
 } // namespace clangd
@@ -36,8 +36,9 @@ void RefSlab::Builder::insert(const SymbolID &ID, const Ref &S) {
   if (M.count(S))
     return;
   Ref R = S;
-  R.Location.FileURI =
-      UniqueStrings.save(R.Location.FileURI).data();
+  R.Location.FileURI = SharedStrings
+                            ? SharedStrings.save(R.Location.FileURI).data()
+                            : UniqueStrings.save(R.Location.FileURI).data();
   M.insert(std::move(R));
 }
 
@@ -52,7 +53,8 @@ RefSlab RefSlab::Builder::build() && {
     NumRefs += SymRefs.size();
     Result.emplace_back(Sym.first, llvm::ArrayRef<Ref>(SymRefs).copy(Arena));
   }
-  return RefSlab(std::move(Result), std::move(Arena), NumRefs);
+  return RefSlab(std::move(Result), std::move(Arena), std::move(SharedStrings),
+                 NumRefs);
 }
 
 } // namespace clangd
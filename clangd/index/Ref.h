@@ -9,6 +9,7 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_REF_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_REF_H
 
+#include "SharedStringPool.h"
 #include "SymbolID.h"
 #include "SymbolLocation.h"
 #include "clang/Index/IndexSymbol.h"
@@ -92,7 +93,10 @@ public:
   /// RefSlab::Builder is a mutable container that can 'freeze' to RefSlab.
   class Builder {
   public:
-    Builder() : UniqueStrings(Arena) {}
+    /// If \p SharedStrings is set, file URIs of refs are stored in it rather
+    /// than in the slab.
+    explicit Builder(std::shared_ptr<SharedStringPool> SharedStrings = nullptr)
+        : UniqueStrings(Arena), SharedStrings(std::move(SharedStrings)) {}
     /// Adds a ref to the slab. Deep copy: Strings will be owned by the slab.
     void insert(const SymbolID &ID, const Ref &S);
     /// Consumes the builder to finalize the slab.
@@ -101,15 +105,18 @@ public:
   private:
     llvm::BumpPtrAllocator Arena;
     llvm::UniqueStringSaver UniqueStrings; // Contents on the arena.
+    SharedStringPool::Lease SharedStrings;
     llvm::DenseMap<SymbolID, std::set<Ref>> Refs;
   };
 
 private:
   RefSlab(std::vector<value_type> Refs, llvm::BumpPtrAllocator Arena,
-          size_t NumRefs)
-      : Arena(std::move(Arena)), Refs(std::move(Refs)), NumRefs(NumRefs) {}
+          SharedStringPool::Lease SharedStrings, size_t NumRefs)
+      : Arena(std::move(Arena)), SharedStrings(std::move(SharedStrings)),
+        Refs(std::move(Refs)), NumRefs(NumRefs) {}
 
   llvm::BumpPtrAllocator Arena;
+  SharedStringPool::Lease SharedStrings;
   std::vector<value_type> Refs;
   /// Number of all references.
   size_t NumRefs = 0;
@@ -16,6 +16,9 @@
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 
 namespace clang {
 namespace clangd {
@@ -34,6 +37,8 @@ llvm::Error makeError(const llvm::Twine &Msg) {
 // This represents 0x1a | 0x2f<<7 = 6042.
 // A 32-bit integer takes 1-5 bytes to encode; small numbers are more compact.
 
+class StringTableIn;
+
 // Reads binary data from a StringRef, and keeps track of position.
 class Reader {
   const char *Begin, *End;
@@ -90,14 +95,8 @@ public:
     return Val;
   }
 
-  llvm::StringRef consumeString(llvm::ArrayRef<llvm::StringRef> Strings) {
-    auto StringIndex = consumeVar();
-    if (LLVM_UNLIKELY(StringIndex >= Strings.size())) {
-      Err = true;
-      return llvm::StringRef();
-    }
-    return Strings[StringIndex];
-  }
+  // Defined after StringTableIn.
+  llvm::StringRef consumeString(StringTableIn &Strings);
 
   SymbolID consumeID() {
     llvm::StringRef Raw = consume(SymbolID::RawSize); // short if truncated.
@@ -127,98 +126,315 @@ void writeVar(uint32_t I, llvm::raw_ostream &OS) {
   }
 }
 
+// Runs Encode(Block, OS) for each of NumBlocks blocks of data on Threads
+// threads (or all cores if 0), and returns the encoded blocks in order.
+// Blocks are encoded into separate strings, so they must be independent.
+template <typename Func>
+std::vector<std::string> encodeBlocks(size_t NumBlocks, unsigned Threads,
+                                      const Func &Encode) {
+  std::vector<std::string> Blocks(NumBlocks);
+  auto EncodeBlock = [&](size_t Block) {
+    llvm::raw_string_ostream OS(Blocks[Block]);
+    Encode(Block, OS);
+  };
+  if (Threads == 1 || NumBlocks <= 1) {
+    for (size_t Block = 0; Block < NumBlocks; ++Block)
+      EncodeBlock(Block);
+    return Blocks;
+  }
+  llvm::ThreadPool Pool(Threads == 0 ? llvm::hardware_concurrency() : Threads);
+  for (size_t Block = 0; Block < NumBlocks; ++Block)
+    Pool.async([&EncodeBlock, Block] { EncodeBlock(Block); });
+  Pool.wait();
+  return Blocks;
+}
+
 // STRING TABLE ENCODING
 // Index data has many string fields, and many strings are identical.
 // We store each string once, and refer to them by index.
 //
 // The string table's format is:
 //   - UncompressedSize : uint32 (or 0 for no compression)
-//   - CompressedData   : byte[CompressedSize]
+//   - NumCold          : uint32, if not compressed
+//   - ColdEnds         : uint32[NumCold], if not compressed
+//   - Data             : byte[], if not compressed
+//   - NumBlocks        : uint32, if compressed
+//   - BlockIndex       : block[NumBlocks], if compressed
+//   - CompressedData   : byte[], if compressed
+//
+// Data contains a sequence of null-terminated strings, e.g. "foo\0bar\0".
+// These are sorted to improve compression. Strings only referenced by cold
+// symbol fields (documentation, signatures...) are sorted after all others.
 //
-// CompressedData is a zlib-compressed byte[UncompressedSize].
-// It contains a sequence of null-terminated strings, e.g. "foo\0bar\0".
-// These are sorted to improve compression.
+// A compressed table splits Data into blocks of whole strings, of about
+// StringBlockSize bytes, which are zlib-compressed independently (and in
+// parallel). CompressedData is the concatenation of the compressed blocks,
+// and each block of BlockIndex is:
+//   - NumStrings       : uint32
+//   - UncompressedSize : uint32
+//   - CompressedSize   : uint32
+// Blocks are only uncompressed once one of their strings is read, so partial
+// reads of an index file only pay for the strings they use.
+//
+// An uncompressed table is read in place: the strings point into the data.
+// The last NumCold strings are the cold ones, and ColdEnds holds the offset
+// of the end of each one (past its null terminator) from the first one. So
+// cold strings are found without reading them, and a mapped index only pages
+// them in for the symbols that are actually rendered.
+
+constexpr static size_t StringBlockSize = 1 << 16;
 
-// Maps each string to a canonical representation.
+// Assigns an index to each distinct string.
 // Strings remain owned externally (e.g. by SymbolSlab).
 class StringTableOut {
   llvm::DenseSet<llvm::StringRef> Unique;
+  // Strings referenced by at least one field that isn't cold.
+  llvm::DenseSet<llvm::StringRef> Hot;
   std::vector<llvm::StringRef> Sorted;
-  // Since strings are interned, look up can be by pointer.
-  llvm::DenseMap<std::pair<const char *, size_t>, unsigned> Index;
+  // Looked up by content, so the records written don't need to be copied to
+  // point at a canonical string.
+  llvm::DenseMap<llvm::StringRef, unsigned> Index;
 
 public:
   StringTableOut() {
     // Ensure there's at least one string in the table.
     // Table size zero is reserved to indicate no compression.
     Unique.insert("");
+    Hot.insert("");
   }
-  // Add a string to the table. Overwrites S if an identical string exists.
-  void intern(llvm::StringRef &S) { S = *Unique.insert(S).first; };
-  // Finalize the table and write it to OS. No more strings may be added.
-  void finalize(llvm::raw_ostream &OS) {
+  // Add a string to the table.
+  // Cold strings are only needed to render a symbol, see isColdString().
+  void intern(llvm::StringRef S, bool Cold = false) {
+    Unique.insert(S);
+    if (!Cold)
+      Hot.insert(S);
+  };
+  // Finalize the table and return its encoding, in pieces. No more strings
+  // may be added. Blocks are compressed on \p Threads threads.
+  std::vector<std::string> finalize(bool Compress, unsigned Threads) {
     Sorted = {Unique.begin(), Unique.end()};
     llvm::sort(Sorted);
+    size_t NumHot =
+        std::stable_partition(Sorted.begin(), Sorted.end(),
+                              [&](llvm::StringRef S) { return Hot.count(S); }) -
+        Sorted.begin();
+    llvm::DenseSet<llvm::StringRef>().swap(Unique);
+    llvm::DenseSet<llvm::StringRef>().swap(Hot);
+    Index.reserve(Sorted.size());
     for (unsigned I = 0; I < Sorted.size(); ++I)
-      Index.try_emplace({Sorted[I].data(), Sorted[I].size()}, I);
+      Index.try_emplace(Sorted[I], I);
 
+    // The number of strings and the end offset of each block.
+    std::vector<std::pair<uint32_t, size_t>> Blocks;
     std::string RawTable;
-    for (llvm::StringRef S : Sorted) {
-      RawTable.append(S);
+    size_t BlockBegin = 0, ColdBegin = 0;
+    std::vector<uint32_t> ColdEnds;
+    for (size_t I = 0; I < Sorted.size(); ++I) {
+      if (Blocks.empty() || RawTable.size() - BlockBegin >= StringBlockSize) {
+        BlockBegin = RawTable.size();
+        Blocks.emplace_back(0, 0);
+      }
+      if (I == NumHot)
+        ColdBegin = RawTable.size();
+      RawTable.append(Sorted[I]);
       RawTable.push_back(0);
+      ++Blocks.back().first;
+      Blocks.back().second = RawTable.size();
+      if (I >= NumHot)
+        ColdEnds.push_back(RawTable.size() - ColdBegin);
     }
-    if (llvm::zlib::isAvailable()) {
-      llvm::SmallString<1> Compressed;
-      llvm::cantFail(llvm::zlib::compress(RawTable, Compressed));
-      write32(RawTable.size(), OS);
-      OS << Compressed;
-    } else {
-      write32(0, OS); // No compression.
-      OS << RawTable;
+    std::string Header;
+    llvm::raw_string_ostream HeaderOS(Header);
+    if (!Compress || !llvm::zlib::isAvailable()) {
+      write32(0, HeaderOS); // No compression.
+      write32(ColdEnds.size(), HeaderOS);
+      for (uint32_t End : ColdEnds)
+        write32(End, HeaderOS);
+      HeaderOS.flush();
+      return {std::move(Header), std::move(RawTable)};
     }
+    llvm::StringRef Raw = RawTable;
+    auto BlockData = [&](size_t Block) {
+      size_t Begin = Block ? Blocks[Block - 1].second : 0;
+      return Raw.slice(Begin, Blocks[Block].second);
+    };
+    std::vector<std::string> Pieces = encodeBlocks(
+        Blocks.size(), Threads, [&](size_t Block, llvm::raw_ostream &OS) {
+          llvm::SmallString<1> Compressed;
+          llvm::cantFail(llvm::zlib::compress(BlockData(Block), Compressed));
+          OS << Compressed;
+        });
+    write32(RawTable.size(), HeaderOS);
+    write32(Blocks.size(), HeaderOS);
+    for (size_t Block = 0; Block < Blocks.size(); ++Block) {
+      write32(Blocks[Block].first, HeaderOS);
+      write32(BlockData(Block).size(), HeaderOS);
+      write32(Pieces[Block].size(), HeaderOS);
+    }
+    HeaderOS.flush();
+    Pieces.insert(Pieces.begin(), std::move(Header));
+    return Pieces;
   }
   // Get the ID of an string, which must be interned. Table must be finalized.
   unsigned index(llvm::StringRef S) const {
     assert(!Sorted.empty() && "table not finalized");
-    assert(Index.count({S.data(), S.size()}) && "string not interned");
-    return Index.find({S.data(), S.size()})->second;
+    auto It = Index.find(S);
+    assert(It != Index.end() && "string not interned");
+    return It->second;
   }
 };
 
-struct StringTableIn {
+// Splits Data, a sequence of null-terminated strings, into Out.
+// Returns false if Data doesn't hold exactly Out.size() strings.
+bool splitStrings(llvm::StringRef Data,
+                  llvm::MutableArrayRef<llvm::StringRef> Out) {
+  Reader R(Data);
+  for (llvm::StringRef &S : Out) {
+    auto Len = R.rest().find(0);
+    if (Len == llvm::StringRef::npos)
+      return false;
+    S = R.consume(Len);
+    R.consume8();
+  }
+  return R.eof() && !R.err();
+}
+
+// The strings of a table that was read. Compressed blocks are uncompressed
+// when one of their strings is first read, and the cold strings of an
+// uncompressed table are only located when they're read.
+class StringTableIn {
+public:
+  size_t size() const { return Strings.size() + numCold(); }
+  // Whether the strings were uncompressed, rather than pointing into the data.
+  bool compressed() const { return !Blocks.empty(); }
+
+  // Sets S to the string with index I. Returns false if there is no such
+  // string, or if its block is corrupt.
+  bool get(size_t I, llvm::StringRef &S) {
+    if (I >= Strings.size()) {
+      I -= Strings.size();
+      if (I >= numCold())
+        return false;
+      // Their ends were validated when reading the table.
+      S = ColdData.slice(I ? coldEnd(I - 1) : 0, coldEnd(I) - 1);
+      return true;
+    }
+    // Strings of uncompressed blocks never point to null.
+    if (!Strings[I].data()) {
+      auto It = std::upper_bound(
+          Blocks.begin(), Blocks.end(), I,
+          [](size_t I, const Block &B) { return I < B.FirstString; });
+      if (!uncompress(*std::prev(It)))
+        return false;
+    }
+    S = Strings[I];
+    return true;
+  }
+
+private:
+  friend llvm::Expected<StringTableIn> readStringTable(llvm::StringRef Data);
+
+  struct Block {
+    size_t FirstString;
+    size_t NumStrings;
+    size_t UncompressedSize;
+    llvm::StringRef Compressed;
+    // Set once uncompressing failed, so that it isn't retried on every read.
+    bool Corrupt = false;
+  };
+
+  bool uncompress(Block &B) {
+    if (B.Corrupt)
+      return false;
+    auto BlockStrings =
+        llvm::makeMutableArrayRef(Strings).slice(B.FirstString, B.NumStrings);
+    char *Storage = Arena.Allocate<char>(B.UncompressedSize);
+    size_t Size = B.UncompressedSize;
+    if (llvm::Error E = llvm::zlib::uncompress(B.Compressed, Storage, Size)) {
+      llvm::consumeError(std::move(E));
+      B.Corrupt = true;
+    } else if (Size != B.UncompressedSize ||
+               !splitStrings(llvm::StringRef(Storage, Size), BlockStrings)) {
+      // Strings split before the error must not be read either.
+      std::fill(BlockStrings.begin(), BlockStrings.end(), llvm::StringRef());
+      B.Corrupt = true;
+    }
+    return !B.Corrupt;
+  }
+
+  size_t numCold() const { return ColdEnds.size() / sizeof(uint32_t); }
+  size_t coldEnd(size_t I) const {
+    return llvm::support::endian::read32le(ColdEnds.data() +
+                                           I * sizeof(uint32_t));
+  }
+
+  // Holds the uncompressed blocks, if the data was compressed.
   llvm::BumpPtrAllocator Arena;
+  std::vector<Block> Blocks; // Sorted by FirstString.
   std::vector<llvm::StringRef> Strings;
+  // The cold strings of an uncompressed table, which follow Strings.
+  llvm::StringRef ColdEnds; // uint32[], see the format.
+  llvm::StringRef ColdData;
 };
 
+llvm::StringRef Reader::consumeString(StringTableIn &Strings) {
+  llvm::StringRef S;
+  if (LLVM_UNLIKELY(!Strings.get(consumeVar(), S)))
+    Err = true;
+  return S;
+}
+
 llvm::Expected<StringTableIn> readStringTable(llvm::StringRef Data) {
   Reader R(Data);
   size_t UncompressedSize = R.consume32();
   if (R.err())
     return makeError("Truncated string table");
 
-  llvm::StringRef Uncompressed;
-  llvm::SmallString<1> UncompressedStorage;
-  if (UncompressedSize == 0) // No compression
-    Uncompressed = R.rest();
-  else {
-    if (llvm::Error E = llvm::zlib::uncompress(R.rest(), UncompressedStorage,
-                                               UncompressedSize))
-      return std::move(E);
-    Uncompressed = UncompressedStorage;
-  }
-
   StringTableIn Table;
-  llvm::StringSaver Saver(Table.Arena);
-  R = Reader(Uncompressed);
-  for (Reader R(Uncompressed); !R.eof();) {
-    auto Len = R.rest().find(0);
-    if (Len == llvm::StringRef::npos)
+  if (UncompressedSize == 0) { // No compression
+    size_t NumCold = R.consume32();
+    if (R.err() || NumCold > R.rest().size() / sizeof(uint32_t))
+      return makeError("Truncated string table");
+    Table.ColdEnds = R.consume(NumCold * sizeof(uint32_t));
+    llvm::StringRef Uncompressed = R.rest();
+    // Each cold string ends after the previous one, with a null terminator.
+    size_t ColdSize = 0;
+    for (size_t I = 0; I < NumCold; ++I) {
+      size_t End = Table.coldEnd(I);
+      if (End <= ColdSize || End > Uncompressed.size())
+        return makeError("Bad string table: malformed cold strings");
+      ColdSize = End;
+    }
+    Table.ColdData = Uncompressed.take_back(ColdSize);
+    Uncompressed = Uncompressed.drop_back(ColdSize);
+    Table.Strings.resize(Uncompressed.count('\0'));
+    if (!splitStrings(Uncompressed, Table.Strings))
       return makeError("Bad string table: not null terminated");
-    Table.Strings.push_back(Saver.save(R.consume(Len)));
-    R.consume8();
+    return std::move(Table);
   }
-  if (R.err())
+
+  std::vector<size_t> CompressedSizes(R.consume32());
+  size_t NumStrings = 0, Size = 0;
+  for (size_t &CompressedSize : CompressedSizes) {
+    StringTableIn::Block B;
+    B.FirstString = NumStrings;
+    B.NumStrings = R.consume32();
+    B.UncompressedSize = R.consume32();
+    CompressedSize = R.consume32();
+    // Each string takes at least its null terminator.
+    if (R.err() || B.NumStrings > B.UncompressedSize)
+      return makeError("Bad string table: malformed block index");
+    NumStrings += B.NumStrings;
+    Size += B.UncompressedSize;
+    Table.Blocks.push_back(B);
+  }
+  if (Size != UncompressedSize)
+    return makeError("Bad string table: malformed block index");
+  for (size_t I = 0; I < CompressedSizes.size(); ++I)
+    Table.Blocks[I].Compressed = R.consume(CompressedSizes[I]);
+  if (R.err() || !R.eof())
     return makeError("Truncated string table");
+  Table.Strings.resize(NumStrings);
   return std::move(Table);
 }
 
@@ -238,7 +454,7 @@ void writeLocation(const SymbolLocation &Loc, const StringTableOut &Strings,
 }
 
 SymbolLocation readLocation(Reader &Data,
-                            llvm::ArrayRef<llvm::StringRef> Strings) {
+                            StringTableIn &Strings) {
   SymbolLocation Loc;
   Loc.FileURI = Data.consumeString(Strings).data();
   for (auto *Endpoint : {&Loc.Start, &Loc.End}) {
@@ -249,7 +465,7 @@ SymbolLocation readLocation(Reader &Data,
 }
 
 IncludeGraphNode readIncludeGraphNode(Reader &Data,
-                                      llvm::ArrayRef<llvm::StringRef> Strings) {
+                                      StringTableIn &Strings) {
   IncludeGraphNode IGN;
   IGN.IsTU = Data.consume8();
   IGN.URI = Data.consumeString(Strings);
@@ -302,7 +518,7 @@ void writeSymbol(const Symbol &Sym, const StringTableOut &Strings,
     WriteInclude(Include);
 }
 
-Symbol readSymbol(Reader &Data, llvm::ArrayRef<llvm::StringRef> Strings) {
+Symbol readSymbol(Reader &Data, StringTableIn &Strings) {
   Symbol Sym;
   Sym.ID = Data.consumeID();
   Sym.SymInfo.Kind = static_cast<index::SymbolKind>(Data.consume8());
@@ -344,16 +560,108 @@ void writeRefs(const SymbolID &ID, llvm::ArrayRef<Ref> Refs,
   }
 }
 
-std::pair<SymbolID, std::vector<Ref>>
-readRefs(Reader &Data, llvm::ArrayRef<llvm::StringRef> Strings) {
-  std::pair<SymbolID, std::vector<Ref>> Result;
-  Result.first = Data.consumeID();
-  Result.second.resize(Data.consumeVar());
-  for (auto &Ref : Result.second) {
-    Ref.Kind = static_cast<RefKind>(Data.consume8());
-    Ref.Location = readLocation(Data, Strings);
+// Reads the refs of a single symbol, appending them to Out.
+// Returns the ID of the symbol.
+SymbolID readRefs(Reader &Data, StringTableIn &Strings,
+                  std::vector<Ref> &Out) {
+  SymbolID ID = Data.consumeID();
+  for (uint32_t NumRefs = Data.consumeVar(); NumRefs > 0 && !Data.err();
+       --NumRefs) {
+    Ref R;
+    R.Kind = static_cast<RefKind>(Data.consume8());
+    R.Location = readLocation(Data, Strings);
+    Out.push_back(R);
   }
-  return Result;
+  return ID;
+}
+
+// RELATIONS ENCODING
+// A relations section is a flat list of relations. Each relation has:
+//  - Subject: 8 bytes
+//  - Predicate: varint
+//  - Object: 8 bytes
+
+void writeRelation(const Relation &R, llvm::raw_ostream &OS) {
+  OS << R.Subject.raw();
+  writeVar(static_cast<uint32_t>(R.Predicate), OS);
+  OS << R.Object.raw();
+}
+
+Relation readRelation(Reader &Data) {
+  SymbolID Subject = Data.consumeID();
+  index::SymbolRole Predicate =
+      static_cast<index::SymbolRole>(Data.consumeVar());
+  SymbolID Object = Data.consumeID();
+  return {Subject, Predicate, Object};
+}
+
+// POSTING LISTS ENCODING
+// A dex section holds a Dex inverted index over the symbols section:
+//  - NumSymbols: varint
+//  - SymbolOrder: varint[NumSymbols]
+//  - a sequence of posting lists, each of which has:
+//    - TokenKind: uint8
+//    - TokenData: varint (index into the string table)
+//    - NumChunks: varint
+//    - Chunk[NumChunks], each a uint32 Head and byte[Chunk::PayloadSize]
+
+void writePostings(const dex::Postings &P, const StringTableOut &Strings,
+                   llvm::raw_ostream &OS) {
+  writeVar(P.SymbolOrder.size(), OS);
+  for (uint32_t Position : P.SymbolOrder)
+    writeVar(Position, OS);
+  for (size_t I = 0; I < P.Lists.size(); ++I) {
+    OS.write(static_cast<uint8_t>(P.Lists[I].first.TokenKind));
+    writeVar(Strings.index(P.Lists[I].first.Data), OS);
+    writeVar(P.Lists[I].second.size(), OS);
+    for (const dex::Chunk &C : P.Lists[I].second) {
+      write32(C.Head, OS);
+      OS.write(reinterpret_cast<const char *>(C.Payload.data()),
+               C.Payload.size());
+    }
+  }
+}
+
+llvm::Expected<dex::Postings>
+readPostings(Reader &Data, StringTableIn &Strings,
+             size_t NumSymbols) {
+  dex::Postings P;
+  if (Data.consumeVar() != NumSymbols)
+    return makeError("posting lists don't match symbols");
+  P.SymbolOrder.reserve(NumSymbols);
+  for (size_t I = 0; I < NumSymbols && !Data.err(); ++I) {
+    uint32_t Position = Data.consumeVar();
+    if (Position >= NumSymbols)
+      return makeError("bad symbol order in posting lists");
+    P.SymbolOrder.push_back(Position);
+  }
+  while (!Data.eof()) {
+    uint8_t Kind = Data.consume8();
+    if (Kind > static_cast<uint8_t>(dex::Token::Kind::Sentinel))
+      return makeError("bad token kind in posting lists");
+    llvm::StringRef TokenData = Data.consumeString(Strings);
+    std::vector<dex::Chunk> Chunks;
+    for (uint32_t NumChunks = Data.consumeVar(); NumChunks > 0 && !Data.err();
+         --NumChunks) {
+      dex::Chunk C;
+      C.Head = Data.consume32();
+      llvm::StringRef Payload = Data.consume(C.Payload.size());
+      if (Data.err())
+        break;
+      std::copy(Payload.bytes_begin(), Payload.bytes_end(), C.Payload.begin());
+      // DocIDs index into the symbols, so must be validated.
+      for (dex::DocID Doc : C.decompress())
+        if (Doc >= NumSymbols)
+          return makeError("bad DocID in posting lists");
+      Chunks.push_back(C);
+    }
+    P.Lists.emplace_back(
+        dex::Token(static_cast<dex::Token::Kind>(Kind), TokenData),
+        std::move(Chunks));
+  }
+  if (Data.err())
+    return makeError("malformed or truncated posting lists");
+  return std::move(P);
 }
 
 // FILE ENCODING
@@ -364,13 +672,17 @@ readRefs(Reader &Data, llvm::ArrayRef<llvm::StringRef> Strings) {
 //   - stri: string table
 //   - symb: symbols
 //   - refs: references to symbols
+//   - rela: relations between symbols
+//   - dex : posting lists of the symbols (optional)
 
 // The current versioning scheme is simple - non-current versions are rejected.
 // If you make a breaking change, bump this version number to invalidate stored
 // data. Later we may want to support some backward compatibility.
-constexpr static uint32_t Version = 8;
+constexpr static uint32_t Version = 13;
 
-llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data) {
+// Splits a RIFF index file into its chunks, and validates the metadata.
+llvm::Expected<llvm::StringMap<llvm::StringRef>>
+readChunks(llvm::StringRef Data) {
   auto RIFF = riff::readFile(Data);
   if (!RIFF)
     return RIFF.takeError();
@@ -388,17 +700,26 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data) {
   Reader Meta(Chunks.lookup("meta"));
   if (Meta.consume32() != Version)
     return makeError("wrong version");
+  return std::move(Chunks);
+}
+
+llvm::Expected<IndexFileIn>
+readRIFF(llvm::StringRef Data,
+         std::shared_ptr<SharedStringPool> SharedStrings) {
+  auto Chunks = readChunks(Data);
+  if (!Chunks)
+    return Chunks.takeError();
 
-  auto Strings = readStringTable(Chunks.lookup("stri"));
+  auto Strings = readStringTable(Chunks->lookup("stri"));
   if (!Strings)
     return Strings.takeError();
 
   IndexFileIn Result;
-  if (Chunks.count("srcs")) {
-    Reader SrcsReader(Chunks.lookup("srcs"));
+  if (Chunks->count("srcs")) {
+    Reader SrcsReader(Chunks->lookup("srcs"));
     Result.Sources.emplace();
     while (!SrcsReader.eof()) {
-      auto IGN = readIncludeGraphNode(SrcsReader, Strings->Strings);
+      auto IGN = readIncludeGraphNode(SrcsReader, *Strings);
       auto Entry = Result.Sources->try_emplace(IGN.URI).first;
       Entry->getValue() = std::move(IGN);
       // We change all the strings inside the structure to point at the keys in
@@ -411,119 +732,269 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data) {
       return makeError("malformed or truncated include uri");
   }
 
-  if (Chunks.count("symb")) {
-    Reader SymbolReader(Chunks.lookup("symb"));
-    SymbolSlab::Builder Symbols;
+  if (Chunks->count("symb")) {
+    Reader SymbolReader(Chunks->lookup("symb"));
+    SymbolSlab::Builder Symbols(SharedStrings);
     while (!SymbolReader.eof())
-      Symbols.insert(readSymbol(SymbolReader, Strings->Strings));
+      Symbols.insert(readSymbol(SymbolReader, *Strings));
     if (SymbolReader.err())
       return makeError("malformed or truncated symbol");
     Result.Symbols = std::move(Symbols).build();
   }
-  if (Chunks.count("refs")) {
-    Reader RefsReader(Chunks.lookup("refs"));
-    RefSlab::Builder Refs;
+  if (Chunks->count("dex ") && Result.Symbols) {
+    Reader PostingsReader(Chunks->lookup("dex "));
+    auto Postings = readPostings(PostingsReader, *Strings,
+                                 Result.Symbols->size());
+    if (!Postings)
+      return Postings.takeError();
+    Result.Postings = std::move(*Postings);
+  }
+  if (Chunks->count("refs")) {
+    Reader RefsReader(Chunks->lookup("refs"));
+    RefSlab::Builder Refs(SharedStrings);
+    std::vector<Ref> SymRefs;
     while (!RefsReader.eof()) {
-      auto RefsBundle = readRefs(RefsReader, Strings->Strings);
-      for (const auto &Ref : RefsBundle.second) // FIXME: bulk insert?
-        Refs.insert(RefsBundle.first, Ref);
+      SymRefs.clear();
+      SymbolID ID = readRefs(RefsReader, *Strings, SymRefs);
+      for (const auto &Ref : SymRefs) // FIXME: bulk insert?
+        Refs.insert(ID, Ref);
     }
     if (RefsReader.err())
       return makeError("malformed or truncated refs");
     Result.Refs = std::move(Refs).build();
   }
+  if (Chunks->count("rela")) {
+    Reader RelationsReader(Chunks->lookup("rela"));
+    RelationSlab::Builder Relations;
+    while (!RelationsReader.eof())
+      Relations.insert(readRelation(RelationsReader));
+    if (RelationsReader.err())
+      return makeError("malformed or truncated relations");
+    Result.Relations = std::move(Relations).build();
+  }
   return std::move(Result);
 }
 
+// Whether the RIFF index file has an uncompressed string table, so that its
+// records can be used without copying the underlying file data.
+bool canReadInPlace(llvm::StringRef Data) {
+  auto Chunks = readChunks(Data);
+  if (!Chunks) {
+    llvm::consumeError(Chunks.takeError());
+    return false;
+  }
+  Reader Strings(Chunks->lookup("stri"));
+  return Strings.consume32() == 0 && !Strings.err();
+}
+
+// Symbols and refs read from a file buffer (typically memory-mapped) without
+// copying. Their strings point into the buffer, which is kept alive here.
+struct MappedIndexFile {
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  std::vector<Symbol> Symbols;
+  std::vector<Ref> RefStorage;
+  std::vector<std::pair<SymbolID, llvm::ArrayRef<Ref>>> Refs; // Into storage.
+  RelationSlab Relations; // Copied, they have no strings.
+  llvm::Optional<dex::Postings> Postings;
+
+  size_t bytes() const {
+    return Buffer->getBufferSize() + Symbols.capacity() * sizeof(Symbol) +
+           RefStorage.capacity() * sizeof(Ref) +
+           Refs.capacity() * sizeof(std::pair<SymbolID, llvm::ArrayRef<Ref>>) +
+           Relations.bytes();
+  }
+};
+
+// Like readRIFF(), but doesn't copy strings: canReadInPlace() must be true.
+llvm::Expected<MappedIndexFile>
+readMappedRIFF(std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  MappedIndexFile Result;
+  Result.Buffer = std::move(Buffer);
+  auto Chunks = readChunks(Result.Buffer->getBuffer());
+  if (!Chunks)
+    return Chunks.takeError();
+  auto Strings = readStringTable(Chunks->lookup("stri"));
+  if (!Strings)
+    return Strings.takeError();
+  assert(!Strings->compressed() && "Strings were copied!");
+
+  if (Chunks->count("symb")) {
+    Reader SymbolReader(Chunks->lookup("symb"));
+    while (!SymbolReader.eof())
+      Result.Symbols.push_back(readSymbol(SymbolReader, *Strings));
+    if (SymbolReader.err())
+      return makeError("malformed or truncated symbol");
+  }
+  if (Chunks->count("dex ")) {
+    Reader PostingsReader(Chunks->lookup("dex "));
+    auto Postings = readPostings(PostingsReader, *Strings,
+                                 Result.Symbols.size());
+    if (!Postings)
+      return Postings.takeError();
+    Result.Postings = std::move(*Postings);
+  }
+  if (Chunks->count("refs")) {
+    Reader RefsReader(Chunks->lookup("refs"));
+    // RefStorage may be reallocated while reading, so record offsets first.
+    std::vector<std::pair<SymbolID, size_t>> Starts;
+    while (!RefsReader.eof()) {
+      size_t Start = Result.RefStorage.size();
+      Starts.emplace_back(
+          readRefs(RefsReader, *Strings, Result.RefStorage), Start);
+    }
+    if (RefsReader.err())
+      return makeError("malformed or truncated refs");
+    Result.RefStorage.shrink_to_fit();
+    llvm::ArrayRef<Ref> AllRefs = Result.RefStorage;
+    Result.Refs.reserve(Starts.size());
+    for (size_t I = 0; I < Starts.size(); ++I) {
+      size_t End =
+          I + 1 < Starts.size() ? Starts[I + 1].second : AllRefs.size();
+      Result.Refs.emplace_back(
+          Starts[I].first,
+          AllRefs.slice(Starts[I].second, End - Starts[I].second));
+    }
+  }
+  if (Chunks->count("rela")) {
+    Reader RelationsReader(Chunks->lookup("rela"));
+    RelationSlab::Builder Relations;
+    while (!RelationsReader.eof())
+      Relations.insert(readRelation(RelationsReader));
+    if (RelationsReader.err())
+      return makeError("malformed or truncated relations");
+    Result.Relations = std::move(Relations).build();
+  }
+  return std::move(Result);
+}
+
+// Whether S is one of the fields of Sym that are only read when the symbol is
+// rendered (e.g. as a completion item or hover), rather than searched.
+bool isColdString(const Symbol &Sym, const llvm::StringRef &S) {
+  return &S == &Sym.Signature || &S == &Sym.CompletionSnippetSuffix ||
+         &S == &Sym.Documentation || &S == &Sym.ReturnType;
+}
+
 template <class Callback>
-void visitStrings(IncludeGraphNode &IGN, const Callback &CB) {
+void visitStrings(const IncludeGraphNode &IGN, const Callback &CB) {
   CB(IGN.URI);
-  for (llvm::StringRef &Include : IGN.DirectIncludes)
+  for (llvm::StringRef Include : IGN.DirectIncludes)
     CB(Include);
 }
 
+// Symbols and symbols' refs are encoded in blocks of this size, in parallel.
+constexpr static size_t RecordsPerBlock = 4096;
+
 void writeRIFF(const IndexFileOut &Data, llvm::raw_ostream &OS) {
   assert(Data.Symbols && "An index file without symbols makes no sense!");
-  riff::File RIFF;
-  RIFF.Type = riff::fourCC("CdIx");
+  std::vector<riff::PiecewiseChunk> Chunks;
 
-  llvm::SmallString<4> Meta;
+  std::string Meta;
   {
-    llvm::raw_svector_ostream MetaOS(Meta);
+    llvm::raw_string_ostream MetaOS(Meta);
     write32(Version, MetaOS);
   }
-  RIFF.Chunks.push_back({riff::fourCC("meta"), Meta});
+  Chunks.push_back({riff::fourCC("meta"), {Meta}});
 
   StringTableOut Strings;
-  std::vector<Symbol> Symbols;
   for (const auto &Sym : *Data.Symbols) {
-    Symbols.emplace_back(Sym);
-    visitStrings(Symbols.back(),
-                 [&](llvm::StringRef &S) { Strings.intern(S); });
+    // visitStrings() takes a mutable symbol, the copy is only inspected.
+    Symbol Copy = Sym;
+    visitStrings(Copy, [&](llvm::StringRef &S) {
+      Strings.intern(S, isColdString(Copy, S));
+    });
   }
-  std::vector<IncludeGraphNode> Sources;
   if (Data.Sources)
-    for (const auto &Source : *Data.Sources) {
-      Sources.push_back(Source.getValue());
-      visitStrings(Sources.back(),
-                   [&](llvm::StringRef &S) { Strings.intern(S); });
-    }
-
-  std::vector<std::pair<SymbolID, std::vector<Ref>>> Refs;
-  if (Data.Refs) {
-    for (const auto &Sym : *Data.Refs) {
-      Refs.emplace_back(Sym);
-      for (auto &Ref : Refs.back().second) {
-        llvm::StringRef File = Ref.Location.FileURI;
-        Strings.intern(File);
-        Ref.Location.FileURI = File.data();
-      }
-    }
+    for (const auto &Source : *Data.Sources)
+      visitStrings(Source.getValue(),
+                   [&](llvm::StringRef S) { Strings.intern(S); });
+  if (Data.Refs)
+    for (const auto &Sym : *Data.Refs)
+      for (const auto &Ref : Sym.second)
+        Strings.intern(Ref.Location.FileURI);
+  if (Data.Postings) {
+    assert(Data.Postings->SymbolOrder.size() == Data.Symbols->size() &&
+           "Posting lists were built for different symbols");
+    for (const auto &TokenToChunks : Data.Postings->Lists)
+      Strings.intern(TokenToChunks.first.Data);
   }
 
-  std::string StringSection;
-  {
-    llvm::raw_string_ostream StringOS(StringSection);
-    Strings.finalize(StringOS);
+  std::vector<std::string> StringSection =
+      Strings.finalize(Data.CompressStrings, Data.Threads);
+  Chunks.push_back({riff::fourCC("stri"),
+                    {StringSection.begin(), StringSection.end()}});
+
+  auto NumBlocks = [](size_t NumRecords) {
+    return (NumRecords + RecordsPerBlock - 1) / RecordsPerBlock;
+  };
+  const SymbolSlab &Symbols = *Data.Symbols;
+  std::vector<std::string> SymbolSection = encodeBlocks(
+      NumBlocks(Symbols.size()), Data.Threads,
+      [&](size_t Block, llvm::raw_ostream &SymbolOS) {
+        size_t Begin = Block * RecordsPerBlock;
+        size_t End = std::min(Begin + RecordsPerBlock, Symbols.size());
+        for (auto It = Symbols.begin() + Begin, E = Symbols.begin() + End;
+             It != E; ++It)
+          writeSymbol(*It, Strings, SymbolOS);
+      });
+  Chunks.push_back({riff::fourCC("symb"),
+                    {SymbolSection.begin(), SymbolSection.end()}});
+
+  std::vector<std::string> RefsSection;
+  if (Data.Refs) {
+    const RefSlab &Refs = *Data.Refs;
+    RefsSection = encodeBlocks(
+        NumBlocks(Refs.size()), Data.Threads,
+        [&](size_t Block, llvm::raw_ostream &RefsOS) {
+          size_t Begin = Block * RecordsPerBlock;
+          size_t End = std::min(Begin + RecordsPerBlock, Refs.size());
+          for (auto It = Refs.begin() + Begin, E = Refs.begin() + End;
+               It != E; ++It)
+            writeRefs(It->first, It->second, Strings, RefsOS);
+        });
+    Chunks.push_back(
+        {riff::fourCC("refs"), {RefsSection.begin(), RefsSection.end()}});
   }
-  RIFF.Chunks.push_back({riff::fourCC("stri"), StringSection});
 
-  std::string SymbolSection;
-  {
-    llvm::raw_string_ostream SymbolOS(SymbolSection);
-    for (const auto &Sym : Symbols)
-      writeSymbol(Sym, Strings, SymbolOS);
+  std::string RelationsSection;
+  if (Data.Relations) {
+    {
+      llvm::raw_string_ostream RelationsOS(RelationsSection);
+      for (const auto &Relation : *Data.Relations)
+        writeRelation(Relation, RelationsOS);
+    }
+    Chunks.push_back({riff::fourCC("rela"), {RelationsSection}});
   }
-  RIFF.Chunks.push_back({riff::fourCC("symb"), SymbolSection});
 
-  std::string RefsSection;
-  if (Data.Refs) {
+  std::string PostingsSection;
+  if (Data.Postings) {
     {
-      llvm::raw_string_ostream RefsOS(RefsSection);
-      for (const auto &Sym : Refs)
-        writeRefs(Sym.first, Sym.second, Strings, RefsOS);
+      llvm::raw_string_ostream PostingsOS(PostingsSection);
+      writePostings(*Data.Postings, Strings, PostingsOS);
     }
-    RIFF.Chunks.push_back({riff::fourCC("refs"), RefsSection});
+    Chunks.push_back({riff::fourCC("dex "), {PostingsSection}});
   }
 
   std::string SrcsSection;
   {
     {
       llvm::raw_string_ostream SrcsOS(SrcsSection);
-      for (const auto &SF : Sources)
-        writeIncludeGraphNode(SF, Strings, SrcsOS);
+      if (Data.Sources)
+        for (const auto &SF : *Data.Sources)
+          writeIncludeGraphNode(SF.getValue(), Strings, SrcsOS);
     }
-    RIFF.Chunks.push_back({riff::fourCC("srcs"), SrcsSection});
+    Chunks.push_back({riff::fourCC("srcs"), {SrcsSection}});
   }
 
-  OS << RIFF;
+  // The sections are written in pieces, rather than concatenated first.
+  riff::writeFile(OS, riff::fourCC("CdIx"), Chunks);
 }
 
 } // namespace
 
 // Defined in YAMLSerialization.cpp.
 void writeYAML(const IndexFileOut &, llvm::raw_ostream &);
-llvm::Expected<IndexFileIn> readYAML(llvm::StringRef);
+llvm::Expected<IndexFileIn> readYAML(llvm::StringRef,
+                                     std::shared_ptr<SharedStringPool>);
 
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const IndexFileOut &O) {
   switch (O.Format) {
@@ -537,10 +1008,12 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const IndexFileOut &O) {
   return OS;
 }
 
-llvm::Expected<IndexFileIn> readIndexFile(llvm::StringRef Data) {
+llvm::Expected<IndexFileIn>
+readIndexFile(llvm::StringRef Data,
+              std::shared_ptr<SharedStringPool> SharedStrings) {
   if (Data.startswith("RIFF")) {
-    return readRIFF(Data);
-  } else if (auto YAMLContents = readYAML(Data)) {
+    return readRIFF(Data, std::move(SharedStrings));
+  } else if (auto YAMLContents = readYAML(Data, std::move(SharedStrings))) {
     return std::move(*YAMLContents);
   } else {
     return makeError("Not a RIFF file and failed to parse as YAML: " +
@@ -551,14 +1024,56 @@ llvm::Expected<IndexFileIn> readIndexFile(llvm::StringRef Data) {
 std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef SymbolFilename,
                                        bool UseDex) {
   trace::Span OverallTracer("LoadIndex");
-  auto Buffer = llvm::MemoryBuffer::getFile(SymbolFilename);
+  // Not requiring a null terminator allows the file to be mapped regardless of
+  // its size. Then records read in place are backed by OS page cache, shared
+  // with other processes using the same index.
+  auto Buffer = llvm::MemoryBuffer::getFile(SymbolFilename, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
   if (!Buffer) {
     llvm::errs() << "Can't open " << SymbolFilename << "\n";
     return nullptr;
   }
 
+  if (canReadInPlace(Buffer->get()->getBuffer())) {
+    llvm::Expected<MappedIndexFile> Mapped = [&] {
+      trace::Span Tracer("ParseIndex");
+      return readMappedRIFF(std::move(*Buffer));
+    }();
+    if (!Mapped) {
+      llvm::errs() << "Bad Index: " << llvm::toString(Mapped.takeError())
+                   << "\n";
+      return nullptr;
+    }
+    size_t NumSym = Mapped->Symbols.size();
+    size_t NumRefs = Mapped->RefStorage.size();
+    size_t Size = Mapped->bytes();
+
+    trace::Span Tracer("BuildIndex");
+    std::unique_ptr<SymbolIndex> Index;
+    if (UseDex && Mapped->Postings)
+      Index = llvm::make_unique<dex::Dex>(
+          Mapped->Symbols, Mapped->Refs, Mapped->Relations,
+          std::move(*Mapped->Postings), std::move(*Mapped), Size);
+    else if (UseDex)
+      Index = llvm::make_unique<dex::Dex>(Mapped->Symbols, Mapped->Refs,
+                                          Mapped->Relations,
+                                          std::move(*Mapped), Size);
+    else
+      Index = llvm::make_unique<MemIndex>(Mapped->Symbols, Mapped->Refs,
+                                          Mapped->Relations,
+                                          std::move(*Mapped), Size);
+    vlog("Loaded {0} from {1} in place with estimated memory usage {2} bytes\n"
+         "  - number of symbols: {3}\n"
+         "  - number of refs: {4}\n",
+         UseDex ? "Dex" : "MemIndex", SymbolFilename,
+         Index->estimateMemoryUsage(), NumSym, NumRefs);
+    return Index;
+  }
+
   SymbolSlab Symbols;
   RefSlab Refs;
+  RelationSlab Relations;
+  llvm::Optional<dex::Postings> Postings;
   {
     trace::Span Tracer("ParseIndex");
     if (auto I = readIndexFile(Buffer->get()->getBuffer())) {
@@ -566,6 +1081,10 @@ std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef SymbolFilename,
         Symbols = std::move(*I->Symbols);
       if (I->Refs)
         Refs = std::move(*I->Refs);
+      if (I->Relations)
+        Relations = std::move(*I->Relations);
+      if (I->Postings)
+        Postings = std::move(*I->Postings);
     } else {
       llvm::errs() << "Bad Index: " << llvm::toString(I.takeError()) << "\n";
       return nullptr;
@@ -576,8 +1095,14 @@ std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef SymbolFilename,
   size_t NumRefs = Refs.numRefs();
 
   trace::Span Tracer("BuildIndex");
-  auto Index = UseDex ? dex::Dex::build(std::move(Symbols), std::move(Refs))
-                      : MemIndex::build(std::move(Symbols), std::move(Refs));
+  auto Index =
+      !UseDex ? MemIndex::build(std::move(Symbols), std::move(Refs),
+                                std::move(Relations))
+              : Postings ? dex::Dex::build(std::move(Symbols), std::move(Refs),
+                                           std::move(Relations),
+                                           std::move(*Postings))
+                         : dex::Dex::build(std::move(Symbols), std::move(Refs),
+                                           std::move(Relations));
   vlog("Loaded {0} from {1} with estimated memory usage {2} bytes\n"
        "  - number of symbols: {3}\n"
        "  - number of refs: {4}\n",
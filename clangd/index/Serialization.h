@@ -10,8 +10,9 @@
 //
 // It writes sections:
 //  - metadata such as version info
-//  - a string table (which is compressed)
+//  - a string table (which is compressed, unless the writer opts out)
 //  - lists of encoded symbols
+//  - optionally, the posting lists of a Dex index over the symbols
 //
 // The format has a simple versioning scheme: the format version number is
 // written in the file and non-current versions are rejected when reading.
@@ -27,6 +28,7 @@
 #include "Headers.h"
 #include "Index.h"
 #include "index/Symbol.h"
+#include "index/dex/Dex.h"
 #include "llvm/Support/Error.h"
 
 namespace clang {
@@ -41,25 +43,43 @@ enum class IndexFileFormat {
 struct IndexFileIn {
   llvm::Optional<SymbolSlab> Symbols;
   llvm::Optional<RefSlab> Refs;
+  llvm::Optional<RelationSlab> Relations;
   // Keys are URIs of the source files.
   llvm::Optional<IncludeGraph> Sources;
+  // Inverted index over Symbols, if it was serialized.
+  llvm::Optional<dex::Postings> Postings;
 };
 // Parse an index file. The input must be a RIFF or YAML file.
-llvm::Expected<IndexFileIn> readIndexFile(llvm::StringRef);
+// If SharedStrings is set, strings common to many slabs are stored there.
+llvm::Expected<IndexFileIn>
+readIndexFile(llvm::StringRef,
+              std::shared_ptr<SharedStringPool> SharedStrings = nullptr);
 
 // Specifies the contents of an index file to be written.
 struct IndexFileOut {
   const SymbolSlab *Symbols = nullptr;
   const RefSlab *Refs = nullptr;
+  const RelationSlab *Relations = nullptr;
   // Keys are URIs of the source files.
   const IncludeGraph *Sources = nullptr;
-  // TODO: Support serializing Dex posting lists.
+  // Posting lists of a Dex built over Symbols, see dex::Dex::postings().
+  // Only written in RIFF format.
+  const dex::Postings *Postings = nullptr;
   IndexFileFormat Format = IndexFileFormat::RIFF;
+  // Whether the RIFF string table is zlib-compressed. Uncompressed tables are
+  // larger on disk, but loadIndex() can use them in place without copying.
+  bool CompressStrings = true;
+  // Threads encoding the symbols and refs, and compressing the string table,
+  // of RIFF files in blocks. 0 uses all cores. The output doesn't depend on
+  // the number of threads.
+  unsigned Threads = 1;
 
   IndexFileOut() = default;
   IndexFileOut(const IndexFileIn &I)
       : Symbols(I.Symbols ? I.Symbols.getPointer() : nullptr),
-        Refs(I.Refs ? I.Refs.getPointer() : nullptr) {}
+        Refs(I.Refs ? I.Refs.getPointer() : nullptr),
+        Relations(I.Relations ? I.Relations.getPointer() : nullptr),
+        Postings(I.Postings ? I.Postings.getPointer() : nullptr) {}
 };
 // Serializes an index file.
 llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const IndexFileOut &O);
@@ -67,9 +87,14 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &OS, const IndexFileOut &O);
 // Convert a single symbol to YAML, a nice debug representation.
 std::string toYAML(const Symbol &);
 std::string toYAML(const std::pair<SymbolID, ArrayRef<Ref>> &);
+std::string toYAML(const Relation &);
 
 // Build an in-memory static index from an index file.
 // The size should be relatively small, so data can be managed in memory.
+// If the file is a RIFF index with an uncompressed string table, the file is
+// memory-mapped and symbols and refs point directly into the mapping.
+// If the file contains posting lists, Dex uses them instead of building its
+// inverted index.
 std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef Filename,
                                        bool UseDex = true);
 
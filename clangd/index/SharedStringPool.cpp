@@ -0,0 +1,71 @@
+//===--- SharedStringPool.cpp ------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "SharedStringPool.h"
+
+namespace clang {
+namespace clangd {
+
+std::shared_ptr<SharedStringPool> SharedStringPool::global() {
+  static std::shared_ptr<SharedStringPool> Pool =
+      std::make_shared<SharedStringPool>();
+  return Pool;
+}
+
+llvm::StringRef SharedStringPool::Lease::save(llvm::StringRef S) {
+  assert(Pool && "Saving a string on an empty lease");
+  auto It = Saved.find(S);
+  if (It != Saved.end())
+    return *It;
+  llvm::StringRef Pooled = Pool->acquire(S);
+  Saved.insert(Pooled);
+  return Pooled;
+}
+
+void SharedStringPool::Lease::release() {
+  if (Pool && !Saved.empty())
+    Pool->release(Saved);
+  Saved.clear();
+}
+
+llvm::StringRef SharedStringPool::acquire(llvm::StringRef S) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto R = Strings.try_emplace(S, 0);
+  if (R.second)
+    StringBytes += S.size() + 1;
+  ++R.first->second;
+  // Map keys are null-terminated, and don't move until they are erased.
+  return R.first->getKey();
+}
+
+void SharedStringPool::release(
+    const llvm::DenseSet<llvm::StringRef> &Released) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  for (llvm::StringRef S : Released) {
+    auto It = Strings.find(S);
+    assert(It != Strings.end() && It->second > 0 && "Released unknown string");
+    if (--It->second == 0) {
+      StringBytes -= S.size() + 1;
+      Strings.erase(It);
+    }
+  }
+}
+
+size_t SharedStringPool::size() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  return Strings.size();
+}
+
+size_t SharedStringPool::bytes() const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  return sizeof(*this) + Strings.getNumBuckets() * sizeof(void *) +
+         Strings.size() * sizeof(llvm::StringMapEntry<unsigned>) + StringBytes;
+}
+
+} // namespace clangd
+} // namespace clang
@@ -0,0 +1,93 @@
+//===--- SharedStringPool.h --------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Symbol and ref slabs own their strings, so strings common to many slabs
+// (file URIs of headers, namespace scopes) are stored once per slab. Slabs can
+// instead keep such strings in a SharedStringPool, which stores each of them
+// once for all slabs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SHAREDSTRINGPOOL_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SHAREDSTRINGPOOL_H
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <memory>
+#include <mutex>
+
+namespace clang {
+namespace clangd {
+
+/// A thread-safe intern table for strings shared by many slabs.
+/// Strings are reference counted by the leases that saved them, and freed
+/// when the last of these leases is destroyed.
+class SharedStringPool {
+public:
+  /// The pool shared by the in-memory indexes of this process.
+  static std::shared_ptr<SharedStringPool> global();
+
+  /// Keeps the strings saved through it alive, and releases them when
+  /// destroyed. A lease without a pool is empty, and saves nothing.
+  /// Leases are not thread-safe, but different leases of a pool may be used
+  /// concurrently.
+  class Lease {
+  public:
+    Lease() = default;
+    explicit Lease(std::shared_ptr<SharedStringPool> Pool)
+        : Pool(std::move(Pool)) {}
+    Lease(Lease &&) = default;
+    Lease &operator=(Lease &&RHS) {
+      release();
+      Pool = std::move(RHS.Pool);
+      Saved = std::move(RHS.Saved);
+      return *this;
+    }
+    ~Lease() { release(); }
+
+    explicit operator bool() const { return bool(Pool); }
+    const std::shared_ptr<SharedStringPool> &pool() const { return Pool; }
+
+    /// Returns the pooled copy of \p S, which is null-terminated.
+    /// Must not be called on an empty lease.
+    llvm::StringRef save(llvm::StringRef S);
+    /// Whether \p S is a string saved through this lease (not just a string
+    /// with the same contents).
+    bool owns(llvm::StringRef S) const {
+      auto It = Saved.find(S);
+      return It != Saved.end() && It->data() == S.data();
+    }
+
+  private:
+    void release();
+
+    std::shared_ptr<SharedStringPool> Pool;
+    // Pooled strings this lease holds a reference to.
+    llvm::DenseSet<llvm::StringRef> Saved;
+  };
+
+  /// Number of distinct strings in the pool.
+  size_t size() const;
+  /// Estimates the memory used by the pooled strings.
+  size_t bytes() const;
+
+private:
+  llvm::StringRef acquire(llvm::StringRef S);
+  void release(const llvm::DenseSet<llvm::StringRef> &Released);
+
+  mutable std::mutex Mu;
+  // Values are the number of leases holding each string.
+  llvm::StringMap<unsigned> Strings;
+  size_t StringBytes = 0;
+};
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SHAREDSTRINGPOOL_H
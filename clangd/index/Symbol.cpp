@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Symbol.h"
+#include "llvm/Support/Endian.h"
 
 namespace clang {
 namespace clangd {
@@ -34,42 +35,102 @@ float quality(const Symbol &S) {
   return std::log(S.References);
 }
 
+// SymbolIDs compare like their bytes read as a big-endian integer.
+static uint64_t orderKey(const SymbolID &ID) {
+  return llvm::support::endian::read64be(ID.raw().data());
+}
+
 SymbolSlab::const_iterator SymbolSlab::find(const SymbolID &ID) const {
+  // IDs are hashes, so they're uniformly distributed: interpolating where ID
+  // would be takes O(log log N) probes on average. A few rounds narrow the
+  // range, then binary search bounds the worst case.
+  uint64_t Key = orderKey(ID);
+  auto Begin = Symbols.begin(), End = Symbols.end();
+  for (unsigned Round = 0; Round < 3 && End - Begin > 8; ++Round) {
+    uint64_t Low = orderKey(Begin->ID), High = orderKey((End - 1)->ID);
+    if (Key < Low || Key > High)
+      return Symbols.end();
+    auto It = Begin + static_cast<size_t>(static_cast<double>(Key - Low) /
+                                          static_cast<double>(High - Low) *
+                                          (End - Begin - 1));
+    if (It->ID == ID)
+      return It;
+    if (It->ID < ID)
+      Begin = It + 1;
+    else
+      End = It;
+  }
   auto It = std::lower_bound(
-      Symbols.begin(), Symbols.end(), ID,
+      Begin, End, ID,
       [](const Symbol &S, const SymbolID &I) { return S.ID < I; });
-  if (It != Symbols.end() && It->ID == ID)
+  if (It != End && It->ID == ID)
     return It;
   return Symbols.end();
 }
 
-// Copy the underlying data of the symbol into the owned arena.
-static void own(Symbol &S, llvm::UniqueStringSaver &Strings) {
-  visitStrings(S, [&](llvm::StringRef &V) { V = Strings.save(V); });
+// Copy the underlying data of the symbol into the owned arena. Strings likely
+// to be common to many slabs go to the shared pool instead, if there is one.
+static void own(Symbol &S, llvm::UniqueStringSaver &Strings,
+                SharedStringPool::Lease &SharedStrings) {
+  if (SharedStrings) {
+    S.Scope = SharedStrings.save(S.Scope);
+    S.CanonicalDeclaration.FileURI =
+        SharedStrings.save(S.CanonicalDeclaration.FileURI).data();
+    S.Definition.FileURI = SharedStrings.save(S.Definition.FileURI).data();
+    for (auto &Include : S.IncludeHeaders)
+      Include.IncludeHeader = SharedStrings.save(Include.IncludeHeader);
+  }
+  visitStrings(S, [&](llvm::StringRef &V) {
+    if (!SharedStrings.owns(V))
+      V = Strings.save(V);
+  });
 }
 
 void SymbolSlab::Builder::insert(const Symbol &S) {
   auto R = SymbolIndex.try_emplace(S.ID, Symbols.size());
   if (R.second) {
     Symbols.push_back(S);
-    own(Symbols.back(), UniqueStrings);
+    own(Symbols.back(), UniqueStrings, SharedStrings);
+  } else {
+    auto &Copy = Symbols[*R.first] = S;
+    own(Copy, UniqueStrings, SharedStrings);
+    Overwritten = true;
+  }
+}
+
+void SymbolSlab::Builder::insert(Symbol &&S) {
+  own(S, UniqueStrings, SharedStrings);
+  insertAdopted(std::move(S));
+}
+
+void SymbolSlab::Builder::insertAdopted(Symbol S) {
+  auto R = SymbolIndex.try_emplace(S.ID, Symbols.size());
+  if (R.second) {
+    Symbols.push_back(std::move(S));
   } else {
-    auto &Copy = Symbols[R.first->second] = S;
-    own(Copy, UniqueStrings);
+    Symbols[*R.first] = std::move(S);
+    Overwritten = true;
   }
 }
 
 SymbolSlab SymbolSlab::Builder::build() && {
-  Symbols = {Symbols.begin(), Symbols.end()}; // Force shrink-to-fit.
+  Symbols = {std::make_move_iterator(Symbols.begin()),
+             std::make_move_iterator(Symbols.end())}; // Force shrink-to-fit.
   // Sort symbols so the slab can binary search over them.
   llvm::sort(Symbols,
              [](const Symbol &L, const Symbol &R) { return L.ID < R.ID; });
-  // We may have unused strings from overwritten symbols. Build a new arena.
+  // We may have unused strings from overwritten symbols. Build a new arena,
+  // unless that would copy strings owned by adopted slabs.
+  if (!Overwritten || !Adopted.empty())
+    return SymbolSlab(std::move(Arena), std::move(SharedStrings),
+                      std::move(Symbols), std::move(Adopted));
   llvm::BumpPtrAllocator NewArena;
   llvm::UniqueStringSaver Strings(NewArena);
+  SharedStringPool::Lease NewSharedStrings(SharedStrings.pool());
   for (auto &S : Symbols)
-    own(S, Strings);
-  return SymbolSlab(std::move(NewArena), std::move(Symbols));
+    own(S, Strings, NewSharedStrings);
+  return SymbolSlab(std::move(NewArena), std::move(NewSharedStrings),
+                    std::move(Symbols), {});
 }
 
 } // namespace clangd
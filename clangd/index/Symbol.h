@@ -9,12 +9,15 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SYMBOL_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SYMBOL_H
 
+#include "SharedStringPool.h"
 #include "SymbolID.h"
+#include "SymbolIDMap.h"
 #include "SymbolLocation.h"
 #include "SymbolOrigin.h"
 #include "clang/Index/IndexSymbol.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/StringSaver.h"
+#include <memory>
 
 namespace clang {
 namespace clangd {
@@ -183,7 +186,7 @@ public:
 
   size_t size() const { return Symbols.size(); }
   bool empty() const { return Symbols.empty(); }
-  // Estimates the total memory usage.
+  // Estimates the total memory usage. Adopted slabs are not included.
   size_t bytes() const {
     return sizeof(*this) + Arena.getTotalMemory() +
            Symbols.capacity() * sizeof(Symbol);
@@ -193,16 +196,37 @@ public:
   /// SymbolSlab. The frozen SymbolSlab will use less memory.
   class Builder {
   public:
-    Builder() : UniqueStrings(Arena) {}
+    /// If \p SharedStrings is set, scopes, file URIs and include headers of
+    /// symbols are stored in it rather than in the slab.
+    explicit Builder(std::shared_ptr<SharedStringPool> SharedStrings = nullptr)
+        : UniqueStrings(Arena), SharedStrings(std::move(SharedStrings)) {}
 
     /// Adds a symbol, overwriting any existing one with the same ID.
     /// This is a deep copy: underlying strings will be owned by the slab.
     void insert(const Symbol &S);
+    /// Like insert(const Symbol &), but reuses the symbol's own storage.
+    void insert(Symbol &&S);
+
+    /// Keeps \p Slab alive as long as the built slab, so that symbols whose
+    /// strings it owns can be added by insertAdopted() without copying them.
+    void adopt(std::shared_ptr<const SymbolSlab> Slab) {
+      Adopted.push_back(std::move(Slab));
+    }
+    /// Adds a symbol, overwriting any existing one with the same ID.
+    /// This is a shallow copy: all strings must be owned by an adopted slab.
+    void insertAdopted(Symbol S);
 
     /// Returns the symbol with an ID, if it exists. Valid until next insert().
     const Symbol *find(const SymbolID &ID) {
-      auto I = SymbolIndex.find(ID);
-      return I == SymbolIndex.end() ? nullptr : &Symbols[I->second];
+      const size_t *I = SymbolIndex.find(ID);
+      return I ? &Symbols[*I] : nullptr;
+    }
+
+    /// Adds a reference to the symbol with an ID, if it exists. Unlike
+    /// inserting a modified copy, this doesn't copy the symbol's strings.
+    void addReference(const SymbolID &ID) {
+      if (const size_t *I = SymbolIndex.find(ID))
+        ++Symbols[*I].References;
     }
 
     /// Consumes the builder to finalize the slab.
@@ -212,17 +236,27 @@ public:
     llvm::BumpPtrAllocator Arena;
     /// Intern table for strings. Contents are on the arena.
     llvm::UniqueStringSaver UniqueStrings;
+    SharedStringPool::Lease SharedStrings;
     std::vector<Symbol> Symbols;
     /// Values are indices into Symbols vector.
-    llvm::DenseMap<SymbolID, size_t> SymbolIndex;
+    SymbolIDMap<size_t> SymbolIndex;
+    std::vector<std::shared_ptr<const SymbolSlab>> Adopted;
+    /// Whether some strings on the arena may no longer be referenced.
+    bool Overwritten = false;
   };
 
 private:
-  SymbolSlab(llvm::BumpPtrAllocator Arena, std::vector<Symbol> Symbols)
-      : Arena(std::move(Arena)), Symbols(std::move(Symbols)) {}
+  SymbolSlab(llvm::BumpPtrAllocator Arena,
+             SharedStringPool::Lease SharedStrings, std::vector<Symbol> Symbols,
+             std::vector<std::shared_ptr<const SymbolSlab>> Adopted)
+      : Arena(std::move(Arena)), SharedStrings(std::move(SharedStrings)),
+        Symbols(std::move(Symbols)), Adopted(std::move(Adopted)) {}
 
   llvm::BumpPtrAllocator Arena; // Owns Symbol data that the Symbols do not.
+  SharedStringPool::Lease SharedStrings; // Keeps pooled Symbol data alive.
   std::vector<Symbol> Symbols;  // Sorted by SymbolID to allow lookup.
+  // Other slabs owning some of the Symbol data.
+  std::vector<std::shared_ptr<const SymbolSlab>> Adopted;
 };
 
 } // namespace clangd
@@ -127,12 +127,20 @@ bool shouldCollectIncludePath(index::SymbolKind Kind) {
   }
 }
 
+/// Turns a header mapped by CanonicalIncludes into an include header.
+std::string toIncludeHeader(const SourceManager &SM, llvm::StringRef Header,
+                            const SymbolCollector::Options &Opts) {
+  if (Header.startswith("<") || Header.startswith("\""))
+    return Header.str();
+  return toURI(SM, Header, Opts);
+}
+
 /// Gets a canonical include (URI of the header or <header>  or "header") for
-/// header of \p Loc.
+/// header of \p Loc, ignoring symbol mappings.
 /// Returns None if fails to get include header for \p Loc.
 llvm::Optional<std::string>
-getIncludeHeader(llvm::StringRef QName, const SourceManager &SM,
-                 SourceLocation Loc, const SymbolCollector::Options &Opts) {
+getFileIncludeHeader(const SourceManager &SM, SourceLocation Loc,
+                     const SymbolCollector::Options &Opts) {
   std::vector<std::string> Headers;
   // Collect the #include stack.
   while (true) {
@@ -148,13 +156,9 @@ getIncludeHeader(llvm::StringRef QName, const SourceManager &SM,
   }
   if (Headers.empty())
     return None;
-  llvm::StringRef Header = Headers[0];
-  if (Opts.Includes) {
-    Header = Opts.Includes->mapHeader(Headers, QName);
-    if (Header.startswith("<") || Header.startswith("\""))
-      return Header.str();
-  }
-  return toURI(SM, Header, Opts);
+  if (!Opts.Includes)
+    return toURI(SM, Headers[0], Opts);
+  return toIncludeHeader(SM, Opts.Includes->mapHeader(Headers), Opts);
 }
 
 // Return the symbol range of the token at \p TokLoc.
@@ -174,36 +178,6 @@ getTokenRange(SourceLocation TokLoc, const SourceManager &SM,
           CreatePosition(TokLoc.getLocWithOffset(TokenLength))};
 }
 
-bool shouldIndexFile(const SourceManager &SM, FileID FID,
-                     const SymbolCollector::Options &Opts,
-                     llvm::DenseMap<FileID, bool> *FilesToIndexCache) {
-  if (!Opts.FileFilter)
-    return true;
-  auto I = FilesToIndexCache->try_emplace(FID);
-  if (I.second)
-    I.first->second = Opts.FileFilter(SM, FID);
-  return I.first->second;
-}
-
-// Return the symbol location of the token at \p TokLoc.
-llvm::Optional<SymbolLocation>
-getTokenLocation(SourceLocation TokLoc, const SourceManager &SM,
-                 const SymbolCollector::Options &Opts,
-                 const clang::LangOptions &LangOpts,
-                 std::string &FileURIStorage) {
-  auto Path = SM.getFilename(TokLoc);
-  if (Path.empty())
-    return None;
-  FileURIStorage = toURI(SM, Path, Opts);
-  SymbolLocation Result;
-  Result.FileURI = FileURIStorage.c_str();
-  auto Range = getTokenRange(TokLoc, SM, LangOpts);
-  Result.Start = Range.first;
-  Result.End = Range.second;
-
-  return Result;
-}
-
 // Checks whether \p ND is a definition of a TagDecl (class/struct/enum/union)
 // in a header file, in which case clangd would prefer to use ND as a canonical
 // declaration.
@@ -223,7 +197,9 @@ RefKind toRefKind(index::SymbolRoleSet Roles) {
 
 } // namespace
 
-SymbolCollector::SymbolCollector(Options Opts) : Opts(std::move(Opts)) {}
+SymbolCollector::SymbolCollector(Options Opts)
+    : Symbols(Opts.SharedStrings), Refs(Opts.SharedStrings),
+      Opts(std::move(Opts)) {}
 
 void SymbolCollector::initialize(ASTContext &Ctx) {
   ASTCtx = &Ctx;
@@ -232,6 +208,58 @@ void SymbolCollector::initialize(ASTContext &Ctx) {
       llvm::make_unique<CodeCompletionTUInfo>(CompletionAllocator);
 }
 
+llvm::Optional<std::string>
+SymbolCollector::getIncludeHeader(llvm::StringRef QName,
+                                  const SourceManager &SM,
+                                  SourceLocation Loc) {
+  if (Opts.Includes) {
+    llvm::StringRef Mapped = Opts.Includes->mapSymbol(QName);
+    if (!Mapped.empty())
+      return toIncludeHeader(SM, Mapped, Opts);
+  }
+  // Otherwise the include header only depends on the file.
+  auto I = IncludeHeaderCache.try_emplace(SM.getFileID(Loc));
+  if (I.second)
+    I.first->second = getFileIncludeHeader(SM, Loc, Opts);
+  return I.first->second;
+}
+
+const char *SymbolCollector::fileURI(const SourceManager &SM, FileID FID) {
+  auto I = FileURICache.try_emplace(FID, nullptr);
+  if (I.second) {
+    // Files without an entry are not interesting, e.g. symbols formed via
+    // macro concatenation.
+    if (const auto *FileEntry = SM.getFileEntryForID(FID))
+      I.first->second =
+          FileURIs.save(toURI(SM, FileEntry->getName(), Opts)).data();
+  }
+  return I.first->second;
+}
+
+llvm::Optional<SymbolLocation>
+SymbolCollector::getTokenLocation(SourceLocation TokLoc,
+                                  const SourceManager &SM,
+                                  const LangOptions &LangOpts) {
+  const char *FileURI = fileURI(SM, SM.getFileID(TokLoc));
+  if (!FileURI)
+    return None;
+  SymbolLocation Result;
+  Result.FileURI = FileURI;
+  auto Range = getTokenRange(TokLoc, SM, LangOpts);
+  Result.Start = Range.first;
+  Result.End = Range.second;
+  return Result;
+}
+
+bool SymbolCollector::shouldIndexFile(FileID FID) {
+  if (!Opts.FileFilter)
+    return true;
+  auto I = FilesToIndexCache.try_emplace(FID);
+  if (I.second)
+    I.first->second = Opts.FileFilter(ASTCtx->getSourceManager(), FID);
+  return I.first->second;
+}
+
 bool SymbolCollector::shouldCollectSymbol(const NamedDecl &ND,
                                           const ASTContext &ASTCtx,
                                           const Options &Opts,
@@ -320,8 +348,11 @@ bool SymbolCollector::handleDeclOccurence(
   bool IsOnlyRef =
       !(Roles & (static_cast<unsigned>(index::SymbolRole::Declaration) |
                  static_cast<unsigned>(index::SymbolRole::Definition)));
+  // Relations are only reported on some occurrences, e.g. RelationBaseOf on
+  // the base-specifier, which is a mere reference.
+  bool HasRelations = isa<TagDecl>(ND) && !Relations.empty();
 
-  if (IsOnlyRef && !CollectRef)
+  if (IsOnlyRef && !CollectRef && !HasRelations)
     return true;
 
   // ND is the canonical (i.e. first) declaration. If it's in the main file,
@@ -330,6 +361,11 @@ bool SymbolCollector::handleDeclOccurence(
       SM.isWrittenInMainFile(SM.getExpansionLoc(ND->getBeginLoc()));
   if (!shouldCollectSymbol(*ND, *ASTCtx, Opts, IsMainFileOnly))
     return true;
+  if (HasRelations)
+    if (auto ID = getSymbolID(ND))
+      processRelations(*ND, *ID, Relations);
+  if (IsOnlyRef && !CollectRef)
+    return true;
   // Do not store references to main-file symbols.
   if (CollectRef && !IsMainFileOnly && !isa<NamespaceDecl>(ND) &&
       (Opts.RefsInHeaders || SM.getFileID(SpellingLoc) == SM.getMainFileID()))
@@ -364,6 +400,23 @@ bool SymbolCollector::handleDeclOccurence(
   return true;
 }
 
+void SymbolCollector::processRelations(
+    const NamedDecl &ND, const SymbolID &ID,
+    ArrayRef<index::SymbolRelation> Relations) {
+  for (const auto &R : Relations) {
+    // Only subtype relations are stored for now: ND is a base of R.
+    if (!(R.Roles & static_cast<unsigned>(index::SymbolRole::RelationBaseOf)))
+      continue;
+    auto ObjectID = getSymbolID(R.RelatedSymbol);
+    if (!ObjectID)
+      continue;
+    // The object may not be indexed (e.g. it's local to a function). Clients
+    // look it up in the index anyway, so the relation is stored regardless.
+    this->Relations.insert(
+        Relation{ID, index::SymbolRole::RelationBaseOf, *ObjectID});
+  }
+}
+
 bool SymbolCollector::handleMacroOccurence(const IdentifierInfo *Name,
                                            const MacroInfo *MI,
                                            index::SymbolRoleSet Roles,
@@ -418,11 +471,9 @@ bool SymbolCollector::handleMacroOccurence(const IdentifierInfo *Name,
     S.Flags |= Symbol::VisibleOutsideFile;
   }
   S.SymInfo = index::getSymbolInfoForMacro(*MI);
-  std::string FileURI;
   // FIXME: use the result to filter out symbols.
-  shouldIndexFile(SM, SM.getFileID(Loc), Opts, &FilesToIndexCache);
-  if (auto DeclLoc =
-          getTokenLocation(DefLoc, SM, Opts, PP->getLangOpts(), FileURI))
+  shouldIndexFile(SM.getFileID(Loc));
+  if (auto DeclLoc = getTokenLocation(DefLoc, SM, PP->getLangOpts()))
     S.CanonicalDeclaration = *DeclLoc;
 
   CodeCompletionResult SymbolCompletion(Name);
@@ -434,8 +485,8 @@ bool SymbolCollector::handleMacroOccurence(const IdentifierInfo *Name,
 
   std::string Include;
   if (Opts.CollectIncludePath && shouldCollectIncludePath(S.SymInfo.Kind)) {
-    if (auto Header = getIncludeHeader(Name->getName(), SM,
-                                       SM.getExpansionLoc(DefLoc), Opts))
+    if (auto Header =
+            getIncludeHeader(Name->getName(), SM, SM.getExpansionLoc(DefLoc)))
       Include = std::move(*Header);
   }
   S.Signature = Signature;
@@ -449,59 +500,34 @@ bool SymbolCollector::handleMacroOccurence(const IdentifierInfo *Name,
 
 void SymbolCollector::finish() {
   // At the end of the TU, add 1 to the refcount of all referenced symbols.
-  auto IncRef = [this](const SymbolID &ID) {
-    if (const auto *S = Symbols.find(ID)) {
-      Symbol Inc = *S;
-      ++Inc.References;
-      Symbols.insert(Inc);
-    }
-  };
   for (const NamedDecl *ND : ReferencedDecls) {
-    if (auto ID = getSymbolID(ND)) {
-      IncRef(*ID);
-    }
+    if (auto ID = getSymbolID(ND))
+      Symbols.addReference(*ID);
   }
   if (Opts.CollectMacro) {
     assert(PP);
     for (const IdentifierInfo *II : ReferencedMacros) {
       if (const auto *MI = PP->getMacroDefinition(II).getMacroInfo())
         if (auto ID = getSymbolID(*II, MI, PP->getSourceManager()))
-          IncRef(*ID);
+          Symbols.addReference(*ID);
     }
   }
 
   const auto &SM = ASTCtx->getSourceManager();
-  llvm::DenseMap<FileID, std::string> URICache;
-  auto GetURI = [&](FileID FID) -> llvm::Optional<std::string> {
-    auto Found = URICache.find(FID);
-    if (Found == URICache.end()) {
-      if (auto *FileEntry = SM.getFileEntryForID(FID)) {
-        auto FileURI = toURI(SM, FileEntry->getName(), Opts);
-        Found = URICache.insert({FID, FileURI}).first;
-      } else {
-        // Ignore cases where we can not find a corresponding file entry
-        // for the loc, thoses are not interesting, e.g. symbols formed
-        // via macro concatenation.
-        return None;
-      }
-    }
-    return Found->second;
-  };
-
-  if (auto MainFileURI = GetURI(SM.getMainFileID())) {
+  if (fileURI(SM, SM.getMainFileID())) {
     for (const auto &It : DeclRefs) {
       if (auto ID = getSymbolID(It.first)) {
         for (const auto &LocAndRole : It.second) {
           auto FileID = SM.getFileID(LocAndRole.first);
           // FIXME: use the result to filter out references.
-          shouldIndexFile(SM, FileID, Opts, &FilesToIndexCache);
-          if (auto FileURI = GetURI(FileID)) {
+          shouldIndexFile(FileID);
+          if (const char *FileURI = fileURI(SM, FileID)) {
             auto Range =
                 getTokenRange(LocAndRole.first, SM, ASTCtx->getLangOpts());
             Ref R;
             R.Location.Start = Range.first;
             R.Location.End = Range.second;
-            R.Location.FileURI = FileURI->c_str();
+            R.Location.FileURI = FileURI;
             R.Kind = toRefKind(LocAndRole.second);
             Refs.insert(*ID, R);
           }
@@ -514,6 +540,9 @@ void SymbolCollector::finish() {
   ReferencedMacros.clear();
   DeclRefs.clear();
   FilesToIndexCache.clear();
+  IncludeHeaderCache.clear();
+  FileURICache.clear();
+  FileURIArena.Reset();
 }
 
 const Symbol *SymbolCollector::addDeclaration(const NamedDecl &ND, SymbolID ID,
@@ -536,12 +565,10 @@ const Symbol *SymbolCollector::addDeclaration(const NamedDecl &ND, SymbolID ID,
   if (!IsMainFileOnly)
     S.Flags |= Symbol::VisibleOutsideFile;
   S.SymInfo = index::getSymbolInfo(&ND);
-  std::string FileURI;
   auto Loc = findNameLoc(&ND);
   // FIXME: use the result to filter out symbols.
-  shouldIndexFile(SM, SM.getFileID(Loc), Opts, &FilesToIndexCache);
-  if (auto DeclLoc =
-          getTokenLocation(Loc, SM, Opts, ASTCtx->getLangOpts(), FileURI))
+  shouldIndexFile(SM.getFileID(Loc));
+  if (auto DeclLoc = getTokenLocation(Loc, SM, ASTCtx->getLangOpts()))
     S.CanonicalDeclaration = *DeclLoc;
 
   S.Origin = Opts.Origin;
@@ -579,8 +606,8 @@ const Symbol *SymbolCollector::addDeclaration(const NamedDecl &ND, SymbolID ID,
   if (Opts.CollectIncludePath && shouldCollectIncludePath(S.SymInfo.Kind)) {
     // Use the expansion location to get the #include header since this is
     // where the symbol is exposed.
-    if (auto Header = getIncludeHeader(
-            QName, SM, SM.getExpansionLoc(ND.getLocation()), Opts))
+    if (auto Header =
+            getIncludeHeader(QName, SM, SM.getExpansionLoc(ND.getLocation())))
       Include = std::move(*Header);
   }
   if (!Include.empty())
@@ -605,13 +632,11 @@ void SymbolCollector::addDefinition(const NamedDecl &ND,
   // This is not ideal, but avoids duplicating the "is this a definition" check
   // in clang::index. We should only see one definition.
   Symbol S = DeclSym;
-  std::string FileURI;
   auto Loc = findNameLoc(&ND);
   const auto &SM = ND.getASTContext().getSourceManager();
   // FIXME: use the result to filter out symbols.
-  shouldIndexFile(SM, SM.getFileID(Loc), Opts, &FilesToIndexCache);
-  if (auto DefLoc =
-          getTokenLocation(Loc, SM, Opts, ASTCtx->getLangOpts(), FileURI))
+  shouldIndexFile(SM.getFileID(Loc));
+  if (auto DefLoc = getTokenLocation(Loc, SM, ASTCtx->getLangOpts()))
     S.Definition = *DefLoc;
   Symbols.insert(S);
 }
@@ -19,6 +19,8 @@
 #include "clang/Index/IndexSymbol.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
 #include <functional>
 
 namespace clang {
@@ -83,6 +85,9 @@ public:
     /// If this is set, only collect symbols/references from a file if
     /// `FileFilter(SM, FID)` is true. If not set, all files are indexed.
     std::function<bool(const SourceManager &, FileID)> FileFilter = nullptr;
+    /// If set, strings common to many slabs (e.g. file URIs) of the collected
+    /// symbols and refs are stored in this pool.
+    std::shared_ptr<SharedStringPool> SharedStrings = nullptr;
   };
 
   SymbolCollector(Options Opts);
@@ -107,8 +112,13 @@ public:
                             index::SymbolRoleSet Roles,
                             SourceLocation Loc) override;
 
+  /// Returns true if symbols and refs in \p FID should be collected, according
+  /// to Options::FileFilter. Must be called after initialize().
+  bool shouldIndexFile(FileID FID);
+
   SymbolSlab takeSymbols() { return std::move(Symbols).build(); }
   RefSlab takeRefs() { return std::move(Refs).build(); }
+  RelationSlab takeRelations() { return std::move(Relations).build(); }
 
   void finish() override;
 
@@ -116,6 +126,20 @@ private:
   const Symbol *addDeclaration(const NamedDecl &, SymbolID,
                                bool IsMainFileSymbol);
   void addDefinition(const NamedDecl &, const Symbol &DeclSymbol);
+  void processRelations(const NamedDecl &ND, const SymbolID &ID,
+                        ArrayRef<index::SymbolRelation> Relations);
+  /// Gets the canonical include (URI of the header, <header> or "header") for
+  /// the symbol \p QName declared at \p Loc. Returns None if there's none.
+  llvm::Optional<std::string> getIncludeHeader(llvm::StringRef QName,
+                                               const SourceManager &SM,
+                                               SourceLocation Loc);
+  /// Returns the URI of \p FID, or null if it isn't a file. URIs are computed
+  /// once per file and live until finish().
+  const char *fileURI(const SourceManager &SM, FileID FID);
+  /// Returns the location of the token at \p TokLoc.
+  llvm::Optional<SymbolLocation> getTokenLocation(SourceLocation TokLoc,
+                                                  const SourceManager &SM,
+                                                  const LangOptions &LangOpts);
 
   // All Symbols collected from the AST.
   SymbolSlab::Builder Symbols;
@@ -123,6 +147,8 @@ private:
   // Only symbols declared in preamble (from #include) and referenced from the
   // main file will be included.
   RefSlab::Builder Refs;
+  // All relations collected from the AST.
+  RelationSlab::Builder Relations;
   ASTContext *ASTCtx;
   std::shared_ptr<Preprocessor> PP;
   std::shared_ptr<GlobalCodeCompletionAllocator> CompletionAllocator;
@@ -141,6 +167,12 @@ private:
   llvm::DenseMap<const Decl *, const Decl *> CanonicalDecls;
   // Cache whether to index a file or not.
   llvm::DenseMap<FileID, bool> FilesToIndexCache;
+  // Include headers of files, for symbols without a symbol mapping.
+  llvm::DenseMap<FileID, llvm::Optional<std::string>> IncludeHeaderCache;
+  // URIs of files, see fileURI().
+  llvm::DenseMap<FileID, const char *> FileURICache;
+  llvm::BumpPtrAllocator FileURIArena;
+  llvm::StringSaver FileURIs{FileURIArena};
 };
 
 } // namespace clangd
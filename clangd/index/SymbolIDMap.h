@@ -0,0 +1,227 @@
+//===--- SymbolIDMap.h - Hash tables keyed by SymbolID ----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// A SymbolID is already a hash of the symbol's USR, 8 bytes long. The tables
+/// here store it as a single 64-bit integer and use its top bits as the slot
+/// directly, rather than hashing it again like DenseMap does. Keys and values
+/// are kept in separate arrays (open addressing with linear probing), so a
+/// probe only touches the keys, and a DenseMap<SymbolID, const Symbol *> goes
+/// from 16 to 8 + 8 bytes per slot without padding.
+///
+/// The top bits are used because the low bits of an ID are those of
+/// hash_value(), which is often used to split IDs between shards.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SYMBOLIDMAP_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SYMBOLIDMAP_H
+
+#include "SymbolID.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace clang {
+namespace clangd {
+
+/// NOTE: This is an implementation detail of SymbolIDMap and SymbolIDSet.
+///
+/// The keys of a table, and the slot of each key. The slot of the key equal to
+/// EmptyKey, which marks unused slots, is one past the last one.
+class SymbolIDTable {
+public:
+  static constexpr size_t NotFound = ~size_t(0);
+
+  size_t size() const { return Size; }
+  bool empty() const { return Size == 0; }
+
+  size_t getMemorySize() const { return Keys.capacity() * sizeof(uint64_t); }
+
+protected:
+  static constexpr uint64_t EmptyKey = 0;
+
+  static uint64_t key(const SymbolID &ID) {
+    static_assert(SymbolID::RawSize == sizeof(uint64_t),
+                  "SymbolID is not 64 bits");
+    uint64_t Key;
+    std::memcpy(&Key, ID.raw().data(), sizeof(Key));
+    return Key;
+  }
+
+  /// Returns the slot of Key, or NotFound.
+  size_t find(uint64_t Key) const {
+    if (Key == EmptyKey)
+      return HasEmptyKey ? Keys.size() : NotFound;
+    if (Keys.empty())
+      return NotFound;
+    size_t Slot = probe(Key);
+    return Keys[Slot] == Key ? Slot : NotFound;
+  }
+
+  /// Returns the slot of Key, adding it if needed, and whether it was added.
+  /// There must be room for one more key, see needsGrow().
+  std::pair<size_t, bool> insert(uint64_t Key) {
+    if (Key == EmptyKey) {
+      bool Inserted = !HasEmptyKey;
+      HasEmptyKey = true;
+      Size += Inserted;
+      return {Keys.size(), Inserted};
+    }
+    size_t Slot = probe(Key);
+    if (Keys[Slot] == Key)
+      return {Slot, false};
+    Keys[Slot] = Key;
+    ++Size;
+    return {Slot, true};
+  }
+
+  /// Returns the number of slots needed for the keys to hold N keys.
+  static size_t capacityFor(size_t N) {
+    // Keep the load factor under 3/4: probe sequences stay short.
+    return std::max<size_t>(16, llvm::NextPowerOf2(N * 4 / 3));
+  }
+  bool needsGrow(size_t N) const {
+    return Keys.empty() || N * 4 > Keys.size() * 3;
+  }
+
+  /// Moves the keys to Capacity slots, calling Move(OldSlot, NewSlot) for each
+  /// key, so that the caller can move its value.
+  template <typename MoveFn> void rehash(size_t Capacity, MoveFn Move) {
+    static_assert(EmptyKey == 0, "new keys must be empty");
+    std::vector<uint64_t> Old(Capacity);
+    Old.swap(Keys);
+    Shift = 64 - llvm::Log2_64(Capacity);
+    for (size_t I = 0; I < Old.size(); ++I)
+      if (Old[I] != EmptyKey) {
+        size_t Slot = probe(Old[I]);
+        Keys[Slot] = Old[I];
+        Move(I, Slot);
+      }
+    if (HasEmptyKey)
+      Move(Old.size(), Keys.size());
+  }
+
+  void clearKeys() {
+    Keys.clear();
+    Size = 0;
+    HasEmptyKey = false;
+  }
+
+private:
+  // Returns the slot holding Key, or the empty slot where it would go.
+  size_t probe(uint64_t Key) const {
+    size_t Mask = Keys.size() - 1;
+    for (size_t Slot = Key >> Shift;; Slot = (Slot + 1) & Mask)
+      if (Keys[Slot] == Key || Keys[Slot] == EmptyKey)
+        return Slot;
+  }
+
+  std::vector<uint64_t> Keys;
+  unsigned Shift = 64;
+  size_t Size = 0;
+  bool HasEmptyKey = false;
+};
+
+/// A map from SymbolIDs to values, smaller and faster than a DenseMap.
+/// Values must be default-constructible: unused slots hold default values.
+/// There's no erase(), and pointers to values are invalidated by insertion.
+template <typename ValueT> class SymbolIDMap : public SymbolIDTable {
+public:
+  /// Returns the value of \p ID, or null if it's not in the map.
+  ValueT *find(const SymbolID &ID) {
+    size_t Slot = SymbolIDTable::find(key(ID));
+    return Slot == NotFound ? nullptr : &Values[Slot];
+  }
+  const ValueT *find(const SymbolID &ID) const {
+    size_t Slot = SymbolIDTable::find(key(ID));
+    return Slot == NotFound ? nullptr : &Values[Slot];
+  }
+
+  /// Returns the value of \p ID, or a default value if it's not in the map.
+  ValueT lookup(const SymbolID &ID) const {
+    size_t Slot = SymbolIDTable::find(key(ID));
+    return Slot == NotFound ? ValueT() : Values[Slot];
+  }
+
+  size_t count(const SymbolID &ID) const {
+    return SymbolIDTable::find(key(ID)) != NotFound;
+  }
+
+  /// Adds \p ID with a value constructed from \p Args, unless it's already in
+  /// the map. Returns its value, and whether it was added.
+  template <typename... Ts>
+  std::pair<ValueT *, bool> try_emplace(const SymbolID &ID, Ts &&... Args) {
+    if (needsGrow(size() + 1))
+      grow(capacityFor(size() + 1));
+    auto R = insert(key(ID));
+    if (R.second)
+      Values[R.first] = ValueT(std::forward<Ts>(Args)...);
+    return {&Values[R.first], R.second};
+  }
+
+  ValueT &operator[](const SymbolID &ID) { return *try_emplace(ID).first; }
+
+  /// Makes room for \p N IDs without growing.
+  void reserve(size_t N) {
+    if (needsGrow(N))
+      grow(capacityFor(N));
+  }
+
+  void clear() {
+    clearKeys();
+    Values.clear();
+  }
+
+  size_t getMemorySize() const {
+    return SymbolIDTable::getMemorySize() + Values.capacity() * sizeof(ValueT);
+  }
+
+private:
+  void grow(size_t Capacity) {
+    std::vector<ValueT> Old(Capacity + 1);
+    Old.swap(Values);
+    rehash(Capacity, [&](size_t From, size_t To) {
+      Values[To] = std::move(Old[From]);
+    });
+  }
+
+  // Values[Slot] is the value of the key in Slot.
+  std::vector<ValueT> Values;
+};
+
+/// A set of SymbolIDs, smaller and faster than a DenseSet.
+class SymbolIDSet : public SymbolIDTable {
+public:
+  /// Adds \p ID, returns false if it was already in the set.
+  bool insert(const SymbolID &ID) {
+    if (needsGrow(size() + 1))
+      rehash(capacityFor(size() + 1), [](size_t, size_t) {});
+    return SymbolIDTable::insert(key(ID)).second;
+  }
+
+  size_t count(const SymbolID &ID) const {
+    return SymbolIDTable::find(key(ID)) != NotFound;
+  }
+
+  /// Makes room for \p N IDs without growing.
+  void reserve(size_t N) {
+    if (needsGrow(N))
+      rehash(capacityFor(N), [](size_t, size_t) {});
+  }
+
+  void clear() { clearKeys(); }
+};
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_SYMBOLIDMAP_H
@@ -35,10 +35,11 @@ LLVM_YAML_IS_SEQUENCE_VECTOR(clang::clangd::Ref)
 namespace {
 using RefBundle =
     std::pair<clang::clangd::SymbolID, std::vector<clang::clangd::Ref>>;
-// This is a pale imitation of std::variant<Symbol, RefBundle>
+// This is a pale imitation of std::variant<Symbol, RefBundle, Relation>
 struct VariantEntry {
   llvm::Optional<clang::clangd::Symbol> Symbol;
   llvm::Optional<RefBundle> Refs;
+  llvm::Optional<clang::clangd::Relation> Relation;
 };
 // A class helps YAML to serialize the 32-bit encoded position (Line&Column),
 // as YAMLIO can't directly map bitfields.
@@ -53,6 +54,7 @@ namespace yaml {
 
 using clang::clangd::Ref;
 using clang::clangd::RefKind;
+using clang::clangd::Relation;
 using clang::clangd::Symbol;
 using clang::clangd::SymbolID;
 using clang::clangd::SymbolLocation;
@@ -273,6 +275,31 @@ template <> struct MappingTraits<Ref> {
   }
 };
 
+struct NormalizedSymbolRole {
+  NormalizedSymbolRole(IO &) {}
+  NormalizedSymbolRole(IO &, clang::index::SymbolRole R) {
+    Role = static_cast<uint32_t>(R);
+  }
+
+  clang::index::SymbolRole denormalize(IO &) {
+    return static_cast<clang::index::SymbolRole>(Role);
+  }
+
+  uint32_t Role = 0;
+};
+
+template <> struct MappingTraits<Relation> {
+  static void mapping(IO &IO, Relation &R) {
+    MappingNormalization<NormalizedSymbolID, SymbolID> NSubject(IO, R.Subject);
+    MappingNormalization<NormalizedSymbolRole, clang::index::SymbolRole>
+        NPredicate(IO, R.Predicate);
+    MappingNormalization<NormalizedSymbolID, SymbolID> NObject(IO, R.Object);
+    IO.mapRequired("Subject", NSubject->HexString);
+    IO.mapRequired("Predicate", NPredicate->Role);
+    IO.mapRequired("Object", NObject->HexString);
+  }
+};
+
 template <> struct MappingTraits<VariantEntry> {
   static void mapping(IO &IO, VariantEntry &Variant) {
     if (IO.mapTag("!Symbol", Variant.Symbol.hasValue())) {
@@ -283,6 +310,10 @@ template <> struct MappingTraits<VariantEntry> {
       if (!IO.outputting())
         Variant.Refs.emplace();
       MappingTraits<RefBundle>::mapping(IO, *Variant.Refs);
+    } else if (IO.mapTag("!Relation", Variant.Relation.hasValue())) {
+      if (!IO.outputting())
+        Variant.Relation.emplace();
+      MappingTraits<Relation>::mapping(IO, *Variant.Relation);
     }
   }
 };
@@ -306,11 +337,20 @@ void writeYAML(const IndexFileOut &O, llvm::raw_ostream &OS) {
       Entry.Refs = Sym;
       Yout << Entry;
     }
+  if (O.Relations)
+    for (const auto &R : *O.Relations) {
+      VariantEntry Entry;
+      Entry.Relation = R;
+      Yout << Entry;
+    }
 }
 
-llvm::Expected<IndexFileIn> readYAML(llvm::StringRef Data) {
-  SymbolSlab::Builder Symbols;
-  RefSlab::Builder Refs;
+llvm::Expected<IndexFileIn>
+readYAML(llvm::StringRef Data,
+         std::shared_ptr<SharedStringPool> SharedStrings) {
+  SymbolSlab::Builder Symbols(SharedStrings);
+  RefSlab::Builder Refs(SharedStrings);
+  RelationSlab::Builder Relations;
   llvm::BumpPtrAllocator
       Arena; // store the underlying data of Position::FileURI.
   llvm::UniqueStringSaver Strings(Arena);
@@ -327,12 +367,15 @@ llvm::Expected<IndexFileIn> readYAML(llvm::StringRef Data) {
     if (Variant.Refs)
       for (const auto &Ref : Variant.Refs->second)
         Refs.insert(Variant.Refs->first, Ref);
+    if (Variant.Relation)
+      Relations.insert(*Variant.Relation);
     Yin.nextDocument();
   }
 
   IndexFileIn Result;
   Result.Symbols.emplace(std::move(Symbols).build());
   Result.Refs.emplace(std::move(Refs).build());
+  Result.Relations.emplace(std::move(Relations).build());
   return std::move(Result);
 }
 
@@ -358,5 +401,16 @@ std::string toYAML(const std::pair<SymbolID, llvm::ArrayRef<Ref>> &Data) {
   return Buf;
 }
 
+std::string toYAML(const Relation &R) {
+  std::string Buf;
+  {
+    llvm::raw_string_ostream OS(Buf);
+    llvm::yaml::Output Yout(OS);
+    Relation Rel = R; // copy: Yout<< requires mutability.
+    Yout << Rel;
+  }
+  return Buf;
+}
+
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,146 @@
+//===--- CompactRefs.cpp - Compressed storage for symbol references -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The refs of a symbol are encoded one after the other, in order of file ID
+// and position. Each ref is:
+//  - VByte: file ID, minus the previous ref's.
+//  - VByte: start line, minus the previous ref's if in the same file.
+//  - VByte: start column.
+//  - VByte: end line minus start line, zigzag-encoded to allow negative values.
+//  - VByte: end column.
+//  - Byte:  RefKind.
+// Sorting makes most deltas small: a typical ref takes 6 bytes instead of 24.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CompactRefs.h"
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+
+namespace clang {
+namespace clangd {
+namespace dex {
+namespace {
+
+void writeVByte(uint32_t V, std::vector<uint8_t> &Out) {
+  do {
+    uint8_t Encoding = V & 0x7f;
+    V >>= 7;
+    Out.push_back(V ? Encoding | 0x80 : Encoding);
+  } while (V != 0);
+}
+
+uint32_t readVByte(const uint8_t *&In) {
+  uint32_t V = 0;
+  for (unsigned Shift = 0;; Shift += 7) {
+    uint8_t Byte = *In++;
+    V |= uint32_t(Byte & 0x7f) << Shift;
+    if (!(Byte & 0x80))
+      return V;
+  }
+}
+
+uint32_t zigzag(int32_t V) {
+  return (static_cast<uint32_t>(V) << 1) ^ static_cast<uint32_t>(V >> 31);
+}
+
+int32_t unzigzag(uint32_t V) {
+  return static_cast<int32_t>(V >> 1) ^ -static_cast<int32_t>(V & 1);
+}
+
+} // namespace
+
+uint32_t CompactRefs::fileID(llvm::StringRef FileURI) {
+  auto R = FileIDs.try_emplace(FileURI, Files.size());
+  if (R.second)
+    Files.push_back(R.first->getKeyData()); // Keys are null-terminated.
+  return R.first->second;
+}
+
+void CompactRefs::insert(const SymbolID &ID, llvm::ArrayRef<Ref> Refs) {
+  struct FileAndRef {
+    uint32_t File;
+    const Ref *R;
+  };
+  std::vector<FileAndRef> Sorted;
+  Sorted.reserve(Refs.size());
+  for (const Ref &R : Refs)
+    Sorted.push_back({fileID(R.Location.FileURI), &R});
+  auto Key = [](const FileAndRef &F) {
+    const SymbolLocation &Loc = F.R->Location;
+    return std::make_tuple(F.File, Loc.Start.line(), Loc.Start.column(),
+                           Loc.End.line(), Loc.End.column(),
+                           static_cast<uint8_t>(F.R->Kind));
+  };
+  std::sort(Sorted.begin(), Sorted.end(),
+            [&](const FileAndRef &L, const FileAndRef &R) {
+              return Key(L) < Key(R);
+            });
+
+  size_t Begin = Data.size();
+  uint32_t LastFile = 0, LastLine = 0;
+  for (const auto &F : Sorted) {
+    const SymbolLocation &Loc = F.R->Location;
+    writeVByte(F.File - LastFile, Data);
+    if (F.File != LastFile)
+      LastLine = 0;
+    writeVByte(Loc.Start.line() - LastLine, Data);
+    writeVByte(Loc.Start.column(), Data);
+    writeVByte(zigzag(static_cast<int32_t>(Loc.End.line()) -
+                      static_cast<int32_t>(Loc.Start.line())),
+               Data);
+    writeVByte(Loc.End.column(), Data);
+    Data.push_back(static_cast<uint8_t>(F.R->Kind));
+    LastFile = F.File;
+    LastLine = Loc.Start.line();
+  }
+  bool Inserted = Ranges.try_emplace(ID, Begin, Data.size()).second;
+  assert(Inserted && "Refs of the symbol were already added");
+  (void)Inserted;
+}
+
+void CompactRefs::forEach(
+    const SymbolID &ID, llvm::function_ref<bool(const Ref &)> Callback) const {
+  const auto *Range = Ranges.find(ID);
+  if (!Range)
+    return;
+  const uint8_t *In = Data.data() + Range->first;
+  const uint8_t *End = Data.data() + Range->second;
+  uint32_t File = 0, Line = 0;
+  Ref R;
+  while (In != End) {
+    uint32_t FileDelta = readVByte(In);
+    if (FileDelta) {
+      File += FileDelta;
+      Line = 0;
+    }
+    Line += readVByte(In);
+    R.Location.FileURI = Files[File];
+    R.Location.Start.setLine(Line);
+    R.Location.Start.setColumn(readVByte(In));
+    R.Location.End.setLine(Line + unzigzag(readVByte(In)));
+    R.Location.End.setColumn(readVByte(In));
+    R.Kind = static_cast<RefKind>(*In++);
+    if (!Callback(R))
+      return;
+  }
+}
+
+size_t CompactRefs::bytes() const {
+  size_t Bytes = Data.capacity() + Files.capacity() * sizeof(const char *) +
+                 Ranges.getMemorySize() + FileIDs.getNumBuckets() *
+                                              sizeof(void *);
+  for (const auto &File : FileIDs)
+    Bytes += sizeof(File) + File.getKeyLength() + 1;
+  return Bytes;
+}
+
+} // namespace dex
+} // namespace clangd
+} // namespace clang
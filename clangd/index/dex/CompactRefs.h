@@ -0,0 +1,66 @@
+//===--- CompactRefs.h - Compressed storage for references -------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// References are by far the largest part of an index: a Ref holds a pointer
+/// to its file's URI and two positions, while there are typically only a few
+/// thousand distinct files. CompactRefs stores the refs of each symbol sorted
+/// by file and position, with files replaced by small integer IDs and
+/// positions by deltas, all in Variable Byte Encoding (like PostingList).
+/// Refs are decoded when they are iterated.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_DEX_COMPACTREFS_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_DEX_COMPACTREFS_H
+
+#include "index/Ref.h"
+#include "index/SymbolID.h"
+#include "index/SymbolIDMap.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include <cstdint>
+#include <vector>
+
+namespace clang {
+namespace clangd {
+namespace dex {
+
+/// The refs of many symbols, compressed. File URIs are copied, so the refs
+/// passed to insert() don't need to outlive this object.
+class CompactRefs {
+public:
+  /// Adds the refs of a symbol, which must not have been added before.
+  void insert(const SymbolID &ID, llvm::ArrayRef<Ref> Refs);
+
+  /// Calls \p Callback on each ref of \p ID, ordered by file and position,
+  /// until it returns false. The Ref is only valid during the call, but its
+  /// FileURI lives as long as this object.
+  void forEach(const SymbolID &ID,
+               llvm::function_ref<bool(const Ref &)> Callback) const;
+
+  size_t bytes() const;
+
+private:
+  uint32_t fileID(llvm::StringRef FileURI);
+
+  /// FileIDs[URI] is the index of URI in Files, which points at the key.
+  llvm::StringMap<uint32_t> FileIDs;
+  std::vector<const char *> Files;
+  /// Encoded refs of all symbols, see CompactRefs.cpp.
+  std::vector<uint8_t> Data;
+  /// The range of Data holding the refs of each symbol.
+  SymbolIDMap<std::pair<size_t, size_t>> Ranges;
+};
+
+} // namespace dex
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_DEX_COMPACTREFS_H
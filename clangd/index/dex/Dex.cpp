@@ -7,26 +7,52 @@
 //===----------------------------------------------------------------------===//
 
 #include "Dex.h"
+#include "Cancellation.h"
 #include "FileDistance.h"
 #include "FuzzyMatch.h"
 #include "Logger.h"
 #include "Quality.h"
+#include "Threading.h"
 #include "Trace.h"
 #include "index/Index.h"
 #include "index/dex/Iterator.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
+#include <atomic>
 #include <queue>
 
 namespace clang {
 namespace clangd {
 namespace dex {
 
+// Refs are copied into compact storage, so the RefSlab is freed once built.
 std::unique_ptr<SymbolIndex> Dex::build(SymbolSlab Symbols, RefSlab Refs) {
-  auto Size = Symbols.bytes() + Refs.bytes();
-  auto Data = std::make_pair(std::move(Symbols), std::move(Refs));
-  return llvm::make_unique<Dex>(Data.first, Data.second, std::move(Data), Size);
+  auto Size = Symbols.bytes();
+  return llvm::make_unique<Dex>(Symbols, Refs, std::move(Symbols), Size);
+}
+
+std::unique_ptr<SymbolIndex> Dex::build(SymbolSlab Symbols, RefSlab Refs,
+                                        Postings P) {
+  auto Size = Symbols.bytes();
+  return llvm::make_unique<Dex>(Symbols, Refs, std::move(P), std::move(Symbols),
+                                Size);
+}
+
+std::unique_ptr<SymbolIndex> Dex::build(SymbolSlab Symbols, RefSlab Refs,
+                                        RelationSlab Relations) {
+  auto Size = Symbols.bytes();
+  return llvm::make_unique<Dex>(Symbols, Refs, Relations, std::move(Symbols),
+                                Size);
+}
+
+std::unique_ptr<SymbolIndex> Dex::build(SymbolSlab Symbols, RefSlab Refs,
+                                        RelationSlab Relations, Postings P) {
+  auto Size = Symbols.bytes();
+  return llvm::make_unique<Dex>(Symbols, Refs, Relations, std::move(P),
+                                std::move(Symbols), Size);
 }
 
 namespace {
@@ -35,16 +61,12 @@ namespace {
 const Token RestrictedForCodeCompletion =
     Token(Token::Kind::Sentinel, "Restricted For Code Completion");
 
-// Returns the tokens which are given symbol's characteristics. Currently, the
-// generated tokens only contain fuzzy matching trigrams and symbol's scope,
-// but in the future this will also return path proximity tokens and other
-// types of tokens such as symbol type (if applicable).
-// Returns the tokens which are given symbols's characteristics. For example,
-// trigrams and scopes.
+// Returns the tokens which are given symbols's characteristics, except for the
+// trigrams of its name. For example, scopes and proximity URIs.
 // FIXME(kbobyrev): Support more token types:
 // * Namespace proximity
 std::vector<Token> generateSearchTokens(const Symbol &Sym) {
-  std::vector<Token> Result = generateIdentifierTrigrams(Sym.Name);
+  std::vector<Token> Result;
   Result.emplace_back(Token::Kind::Scope, Sym.Scope);
   // Skip token generation for symbols with unknown declaration location.
   if (!llvm::StringRef(Sym.CanonicalDeclaration.FileURI).empty())
@@ -58,12 +80,68 @@ std::vector<Token> generateSearchTokens(const Symbol &Sym) {
   return Result;
 }
 
+// Building posting lists for fewer symbols isn't worth spawning a thread.
+constexpr size_t MinSymbolsPerShard = 10000;
+
+// Scopes with at least this many symbols, and at most half of the index, get
+// their own trigram posting lists. Queries restricted to smaller scopes are
+// cheap anyway, and for bigger ones the lists would save little.
+constexpr size_t MinPartitionedScopeSymbols = 1000;
+
+// Queries check for cancellation every so many candidates.
+constexpr size_t CancellationCheckInterval = 1024;
+
+// Proximity boosts are kept for this many distinct ProximityPaths.
+constexpr size_t MaxProximityCacheEntries = 32;
+
+// The DocIDs of each token. Trigrams are by far the most common tokens, so
+// they are kept apart in their packed form rather than as strings.
+struct TempPostings {
+  llvm::DenseMap<Trigram, std::vector<DocID>> Trigrams;
+  llvm::DenseMap<Token, std::vector<DocID>> Tokens;
+};
+
+// The scoped trigram token of a trigram of the names in Scope.
+Token scopedTrigram(llvm::StringRef Scope, const Token &Trigram) {
+  return Token(Token::Kind::ScopedTrigram, (Scope + Trigram.Data).str());
+}
+
+// FIXME: Enable fuzzy find on template specializations once we start storing
+// template arguments in the name. Currently we only store name for class
+// template, which would cause duplication in the results.
+bool isTemplateSpecialization(const Symbol &Sym) {
+  return Sym.SymInfo.Properties &
+         (static_cast<index::SymbolPropertySet>(
+              index::SymbolProperty::TemplateSpecialization) |
+          static_cast<index::SymbolPropertySet>(
+              index::SymbolProperty::TemplatePartialSpecialization));
+}
+
+// Returns the DocIDs of each token, for symbols with DocIDs in [Begin, End).
+TempPostings buildTempPostings(llvm::ArrayRef<const Symbol *> Symbols,
+                               DocID Begin, DocID End) {
+  TempPostings Result;
+  std::vector<Trigram> Trigrams;
+  for (DocID SymbolRank = Begin; SymbolRank < End; ++SymbolRank) {
+    const auto *Sym = Symbols[SymbolRank];
+    if (isTemplateSpecialization(*Sym))
+      continue;
+    generateIdentifierTrigrams(Sym->Name, Trigrams);
+    for (const auto &T : Trigrams)
+      Result.Trigrams[T].push_back(SymbolRank);
+    for (const auto &Token : generateSearchTokens(*Sym))
+      Result.Tokens[Token].push_back(SymbolRank);
+  }
+  return Result;
+}
+
 } // namespace
 
 void Dex::buildIndex() {
   this->Corpus = dex::Corpus(Symbols.size());
   std::vector<std::pair<float, const Symbol *>> ScoredSymbols(Symbols.size());
 
+  LookupTable.reserve(Symbols.size());
   for (size_t I = 0; I < Symbols.size(); ++I) {
     const Symbol *Sym = Symbols[I];
     LookupTable[Sym->ID] = Sym;
@@ -76,45 +154,180 @@ void Dex::buildIndex() {
 
   // SymbolQuality was empty up until now.
   SymbolQuality.resize(Symbols.size());
+  SymbolNames.resize(Symbols.size());
   // Populate internal storage using Symbol + Score pairs.
   for (size_t I = 0; I < ScoredSymbols.size(); ++I) {
     SymbolQuality[I] = ScoredSymbols[I].first;
     Symbols[I] = ScoredSymbols[I].second;
+    SymbolNames[I] = Symbols[I]->Name;
   }
+  SortedByQuality = true;
 
   // Populate TempInvertedIndex with lists for index symbols.
-  llvm::DenseMap<Token, std::vector<DocID>> TempInvertedIndex;
-  for (DocID SymbolRank = 0; SymbolRank < Symbols.size(); ++SymbolRank) {
-    const auto *Sym = Symbols[SymbolRank];
-    // FIXME: Enable fuzzy find on template specializations once we start
-    // storing template arguments in the name. Currently we only store name for
-    // class template, which would cause duplication in the results.
-    if (Sym->SymInfo.Properties &
-        (static_cast<index::SymbolPropertySet>(
-             index::SymbolProperty::TemplateSpecialization) |
-         static_cast<index::SymbolPropertySet>(
-             index::SymbolProperty::TemplatePartialSpecialization)))
-      continue;
-    for (const auto &Token : generateSearchTokens(*Sym))
-      TempInvertedIndex[Token].push_back(SymbolRank);
+  // Generating search tokens dominates the build time of big indexes, so
+  // symbols are split into shards of consecutive DocIDs processed in parallel.
+  // Each shard's lists are sorted and cover a distinct range of DocIDs, so
+  // concatenating them in shard order produces sorted lists again.
+  size_t NumShards = std::max<size_t>(
+      1, std::min<size_t>(llvm::heavyweight_hardware_concurrency(),
+                          Symbols.size() / MinSymbolsPerShard));
+  std::vector<TempPostings> Shards(NumShards);
+  auto ShardBegin = [&](size_t Shard) -> DocID {
+    return Symbols.size() * Shard / NumShards;
+  };
+  if (NumShards == 1) {
+    Shards.front() = buildTempPostings(Symbols, 0, Symbols.size());
+  } else {
+    AsyncTaskRunner Runner;
+    for (size_t Shard = 0; Shard < NumShards; ++Shard)
+      Runner.runAsync("dex-build:" + llvm::Twine(Shard), [&, Shard] {
+        Shards[Shard] = buildTempPostings(Symbols, ShardBegin(Shard),
+                                          ShardBegin(Shard + 1));
+      });
+    Runner.wait();
+  }
+  TempPostings TempInvertedIndex = std::move(Shards.front());
+  for (size_t Shard = 1; Shard < NumShards; ++Shard) {
+    for (auto &TrigramToDocs : Shards[Shard].Trigrams) {
+      auto &Docs = TempInvertedIndex.Trigrams[TrigramToDocs.first];
+      Docs.insert(Docs.end(), TrigramToDocs.second.begin(),
+                  TrigramToDocs.second.end());
+    }
+    for (auto &TokenToDocs : Shards[Shard].Tokens) {
+      auto &Docs = TempInvertedIndex.Tokens[TokenToDocs.first];
+      Docs.insert(Docs.end(), TokenToDocs.second.begin(),
+                  TokenToDocs.second.end());
+    }
+  }
+
+  // Large scopes get trigram lists of their own symbols, see fuzzyFind().
+  // The scope's list holds its symbols in DocID order, so these are sorted.
+  std::vector<std::pair<llvm::StringRef, const std::vector<DocID> *>>
+      Partitions;
+  for (const auto &TokenToDocs : TempInvertedIndex.Tokens)
+    if (TokenToDocs.first.TokenKind == Token::Kind::Scope &&
+        TokenToDocs.second.size() >= MinPartitionedScopeSymbols &&
+        TokenToDocs.second.size() * 2 <= Symbols.size())
+      Partitions.emplace_back(TokenToDocs.first.Data, &TokenToDocs.second);
+  std::vector<llvm::DenseMap<Trigram, std::vector<DocID>>> ScopedTrigrams(
+      Partitions.size());
+  auto BuildPartition = [&](size_t P) {
+    std::vector<Trigram> Trigrams;
+    for (DocID SymbolRank : *Partitions[P].second) {
+      const auto *Sym = Symbols[SymbolRank];
+      if (isTemplateSpecialization(*Sym))
+        continue;
+      generateIdentifierTrigrams(Sym->Name, Trigrams);
+      for (const auto &T : Trigrams)
+        ScopedTrigrams[P][T].push_back(SymbolRank);
+    }
+  };
+  if (NumShards == 1) {
+    for (size_t P = 0; P < Partitions.size(); ++P)
+      BuildPartition(P);
+  } else {
+    AsyncTaskRunner Runner;
+    for (size_t P = 0; P < Partitions.size(); ++P)
+      Runner.runAsync("dex-scope:" + llvm::Twine(P),
+                      [&, P] { BuildPartition(P); });
+    Runner.wait();
   }
 
-  // Convert lists of items to posting lists.
-  for (const auto &TokenToPostingList : TempInvertedIndex)
+  // Convert lists of items to posting lists. Only distinct trigrams need a
+  // string, and there are few of them.
+  size_t NumLists =
+      TempInvertedIndex.Trigrams.size() + TempInvertedIndex.Tokens.size();
+  for (const auto &Partition : ScopedTrigrams)
+    NumLists += Partition.size();
+  InvertedIndex.reserve(NumLists);
+  for (const auto &TrigramToPostingList : TempInvertedIndex.Trigrams)
+    InvertedIndex.insert({TrigramToPostingList.first.token(),
+                          PostingList(TrigramToPostingList.second)});
+  for (size_t P = 0; P < Partitions.size(); ++P) {
+    PartitionedScopes.insert(Partitions[P].first);
+    for (const auto &TrigramToPostingList : ScopedTrigrams[P])
+      InvertedIndex.insert(
+          {scopedTrigram(Partitions[P].first,
+                         TrigramToPostingList.first.token()),
+           PostingList(TrigramToPostingList.second)});
+  }
+  for (const auto &TokenToPostingList : TempInvertedIndex.Tokens)
     InvertedIndex.insert(
         {TokenToPostingList.first, PostingList(TokenToPostingList.second)});
 }
 
+void Dex::buildIndex(Postings P) {
+  assert(P.SymbolOrder.size() == Symbols.size() &&
+         "Posting lists were built for different symbols");
+  this->Corpus = dex::Corpus(Symbols.size());
+  // Symbols are sorted by SymbolID, reorder them by DocID.
+  std::vector<const Symbol *> SortedByID = std::move(Symbols);
+  Symbols.resize(SortedByID.size());
+  SymbolQuality.resize(SortedByID.size());
+  SymbolNames.resize(SortedByID.size());
+  LookupTable.reserve(SortedByID.size());
+  for (DocID SymbolRank = 0; SymbolRank < SortedByID.size(); ++SymbolRank) {
+    const Symbol *Sym = SortedByID[P.SymbolOrder[SymbolRank]];
+    Symbols[SymbolRank] = Sym;
+    SymbolQuality[SymbolRank] = quality(*Sym);
+    SymbolNames[SymbolRank] = Sym->Name;
+    LookupTable[Sym->ID] = Sym;
+  }
+  // Postings built by another version may order symbols differently.
+  SortedByQuality = std::is_sorted(SymbolQuality.begin(), SymbolQuality.end(),
+                                   std::greater<float>());
+
+  InvertedIndex.reserve(P.Lists.size());
+  for (auto &TokenToChunks : P.Lists) {
+    if (TokenToChunks.first.TokenKind == Token::Kind::ScopedTrigram) {
+      llvm::StringRef Data = TokenToChunks.first.Data;
+      size_t ScopeEnd = Data.rfind("::");
+      ScopeEnd = ScopeEnd == llvm::StringRef::npos ? 0 : ScopeEnd + 2;
+      PartitionedScopes.insert(Data.take_front(ScopeEnd));
+    }
+    InvertedIndex.try_emplace(std::move(TokenToChunks.first),
+                              std::move(TokenToChunks.second));
+  }
+}
+
+Postings Dex::postings() const {
+  Postings Result;
+  std::vector<std::pair<SymbolID, DocID>> SortedByID;
+  SortedByID.reserve(Symbols.size());
+  for (DocID SymbolRank = 0; SymbolRank < Symbols.size(); ++SymbolRank)
+    SortedByID.emplace_back(Symbols[SymbolRank]->ID, SymbolRank);
+  llvm::sort(SortedByID);
+  Result.SymbolOrder.resize(SortedByID.size());
+  for (uint32_t Position = 0; Position < SortedByID.size(); ++Position)
+    Result.SymbolOrder[SortedByID[Position].second] = Position;
+
+  Result.Lists.reserve(InvertedIndex.size());
+  for (const auto &TokenToPostingList : InvertedIndex)
+    Result.Lists.emplace_back(TokenToPostingList.first,
+                              TokenToPostingList.second.chunks());
+  return Result;
+}
+
 std::unique_ptr<Iterator> Dex::iterator(const Token &Tok) const {
   auto It = InvertedIndex.find(Tok);
   return It == InvertedIndex.end() ? Corpus.none()
                                    : It->second.iterator(&It->first);
 }
 
-// Constructs BOOST iterators for Path Proximities.
-std::unique_ptr<Iterator> Dex::createFileProximityIterator(
-    llvm::ArrayRef<std::string> ProximityPaths) const {
-  std::vector<std::unique_ptr<Iterator>> BoostingIterators;
+// Computes the boosts of the posting lists of the ProximityPaths' parents.
+// The result is cached, as these don't depend on anything else.
+std::shared_ptr<const Dex::ProximityBoosts>
+Dex::proximityBoosts(llvm::ArrayRef<std::string> ProximityPaths) const {
+  std::string Key = llvm::join(ProximityPaths.begin(), ProximityPaths.end(),
+                               llvm::StringRef("\0", 1));
+  {
+    std::lock_guard<std::mutex> Lock(ProximityMu);
+    auto It = ProximityCache.find(Key);
+    if (It != ProximityCache.end())
+      return It->second;
+  }
+
+  auto Result = std::make_shared<ProximityBoosts>();
   // Deduplicate parent URIs extracted from the ProximityPaths.
   llvm::StringSet<> ParentURIs;
   llvm::StringMap<SourceParams> Sources;
@@ -132,18 +345,35 @@ std::unique_ptr<Iterator> Dex::createFileProximityIterator(
   // any URI extracted from the ProximityPaths.
   URIDistance DistanceCalculator(Sources);
   PathProximitySignals.FileProximityMatch = &DistanceCalculator;
-  // Try to build BOOST iterator for each Proximity Path provided by
-  // ProximityPaths. Boosting factor should depend on the distance to the
-  // Proximity Path: the closer processed path is, the higher boosting factor.
+  // Boosting factor should depend on the distance to the Proximity Path: the
+  // closer processed path is, the higher boosting factor.
   for (const auto &ParentURI : ParentURIs.keys()) {
-    // FIXME(kbobyrev): Append LIMIT on top of every BOOST iterator.
-    auto It = iterator(Token(Token::Kind::ProximityURI, ParentURI));
-    if (It->kind() != Iterator::Kind::False) {
-      PathProximitySignals.SymbolURI = ParentURI;
-      BoostingIterators.push_back(
-          Corpus.boost(std::move(It), PathProximitySignals.evaluate()));
-    }
+    auto It = InvertedIndex.find(Token(Token::Kind::ProximityURI, ParentURI));
+    if (It == InvertedIndex.end())
+      continue;
+    PathProximitySignals.SymbolURI = ParentURI;
+    Result->push_back(
+        {&It->first, &It->second, PathProximitySignals.evaluate()});
   }
+
+  std::lock_guard<std::mutex> Lock(ProximityMu);
+  // Requests come from a handful of files, so this rarely drops useful data.
+  if (ProximityCache.size() >= MaxProximityCacheEntries)
+    ProximityCache.clear();
+  ProximityCache[Key] = Result;
+  return Result;
+}
+
+// Constructs BOOST iterators for Path Proximities.
+std::unique_ptr<Iterator> Dex::createFileProximityIterator(
+    llvm::ArrayRef<std::string> ProximityPaths) const {
+  std::vector<std::unique_ptr<Iterator>> BoostingIterators;
+  // Try to build BOOST iterator for each Proximity Path provided by
+  // ProximityPaths.
+  for (const auto &B : *proximityBoosts(ProximityPaths))
+    // FIXME(kbobyrev): Append LIMIT on top of every BOOST iterator.
+    BoostingIterators.push_back(
+        Corpus.boost(B.List->iterator(B.Tok), B.Boost));
   BoostingIterators.push_back(Corpus.all());
   return Corpus.unionOf(std::move(BoostingIterators));
 }
@@ -183,15 +413,44 @@ bool Dex::fuzzyFind(const FuzzyFindRequest &Req,
   std::vector<std::unique_ptr<Iterator>> TrigramIterators;
   for (const auto &Trigram : TrigramTokens)
     TrigramIterators.push_back(iterator(Trigram));
-  Criteria.push_back(Corpus.intersect(move(TrigramIterators)));
+  auto Trigrams = Corpus.intersect(move(TrigramIterators));
 
   // Generate scope tokens for search query.
   std::vector<std::unique_ptr<Iterator>> ScopeIterators;
-  for (const auto &Scope : Req.Scopes)
-    ScopeIterators.push_back(iterator(Token(Token::Kind::Scope, Scope)));
-  if (Req.AnyScope)
-    ScopeIterators.push_back(
-        Corpus.boost(Corpus.all(), ScopeIterators.empty() ? 1.0 : 0.2));
+  if (!Req.AnyScope &&
+      llvm::any_of(Req.Scopes, [&](const std::string &Scope) {
+        return PartitionedScopes.count(Scope);
+      })) {
+    // Scopes with their own trigram lists only retrieve their own symbols,
+    // rather than intersecting the trigram lists of the whole index. The
+    // other scopes are small, their lists drive the intersection.
+    std::vector<std::unique_ptr<Iterator>> OtherScopes;
+    for (const auto &Scope : Req.Scopes) {
+      if (!PartitionedScopes.count(Scope) || TrigramTokens.empty()) {
+        OtherScopes.push_back(iterator(Token(Token::Kind::Scope, Scope)));
+        continue;
+      }
+      std::vector<std::unique_ptr<Iterator>> ScopedTrigramIterators;
+      for (const auto &Trigram : TrigramTokens)
+        ScopedTrigramIterators.push_back(
+            iterator(scopedTrigram(Scope, Trigram)));
+      ScopeIterators.push_back(
+          Corpus.intersect(move(ScopedTrigramIterators)));
+    }
+    if (!OtherScopes.empty()) {
+      std::vector<std::unique_ptr<Iterator>> Others;
+      Others.push_back(move(Trigrams));
+      Others.push_back(Corpus.unionOf(move(OtherScopes)));
+      ScopeIterators.push_back(Corpus.intersect(move(Others)));
+    }
+  } else {
+    Criteria.push_back(move(Trigrams));
+    for (const auto &Scope : Req.Scopes)
+      ScopeIterators.push_back(iterator(Token(Token::Kind::Scope, Scope)));
+    if (Req.AnyScope)
+      ScopeIterators.push_back(
+          Corpus.boost(Corpus.all(), ScopeIterators.empty() ? 1.0 : 0.2));
+  }
   Criteria.push_back(Corpus.unionOf(move(ScopeIterators)));
 
   // Add proximity paths boosting (all symbols, some boosted).
@@ -214,29 +473,57 @@ bool Dex::fuzzyFind(const FuzzyFindRequest &Req,
   vlog("Dex query tree: {0}", *Root);
 
   using IDAndScore = std::pair<DocID, float>;
-  std::vector<IDAndScore> IDAndScores = consume(*Root);
-
   auto Compare = [](const IDAndScore &LHS, const IDAndScore &RHS) {
     return LHS.second > RHS.second;
   };
   TopN<IDAndScore, decltype(Compare)> Top(
       Req.Limit ? *Req.Limit : std::numeric_limits<size_t>::max(), Compare);
-  for (const auto &IDAndScore : IDAndScores) {
-    const DocID SymbolDocID = IDAndScore.first;
-    const auto *Sym = Symbols[SymbolDocID];
-    const llvm::Optional<float> Score = Filter.match(Sym->Name);
+  // Fuzzy matching is the expensive part of scoring, but the match score is
+  // bounded, so candidates whose quality and boost are too low to make it into
+  // a full Top can be skipped without matching.
+  const float MaxMatchScore = Filter.empty() ? 1 : 2;
+  // Boosts of the query tree don't grow as it advances.
+  const float MaxBoost = Root->maxBoost();
+  unsigned Retrieved = 0, Pruned = 0;
+  for (; !Root->reachedEnd(); Root->advance(), ++Retrieved) {
+    // Nobody is waiting for the results of a cancelled request, so we stop as
+    // soon as we notice, and report that results may be missing.
+    if (Retrieved % CancellationCheckInterval == 0 && isCancelled()) {
+      SPAN_ATTACH(Tracer, "cancelled", true);
+      return true;
+    }
+    const DocID SymbolDocID = Root->peek();
+    // Remaining candidates have at most the quality of this one. Once even
+    // the best of them couldn't make it into Top, we are done.
+    if (SortedByQuality &&
+        !Top.wouldKeep(
+            {SymbolDocID,
+             MaxMatchScore * SymbolQuality[SymbolDocID] * MaxBoost})) {
+      SPAN_ATTACH(Tracer, "stopped_early", true);
+      More = true;
+      break;
+    }
+    const float Boost = Root->consume();
+    const float MaxScore = MaxMatchScore * SymbolQuality[SymbolDocID] * Boost;
+    if (!Top.wouldKeep({SymbolDocID, MaxScore})) {
+      ++Pruned;
+      More = true; // It might have matched.
+      continue;
+    }
+    const llvm::Optional<float> Score = Filter.match(SymbolNames[SymbolDocID]);
     if (!Score)
       continue;
     // Combine Fuzzy Matching score, precomputed symbol quality and boosting
     // score for a cumulative final symbol score.
-    const float FinalScore =
-        (*Score) * SymbolQuality[SymbolDocID] * IDAndScore.second;
+    const float FinalScore = (*Score) * SymbolQuality[SymbolDocID] * Boost;
     // If Top.push(...) returns true, it means that it had to pop an item. In
     // this case, it is possible to retrieve more symbols.
     if (Top.push({SymbolDocID, FinalScore}))
       More = true;
   }
 
+  SPAN_ATTACH(Tracer, "retrieved", static_cast<int>(Retrieved));
+  SPAN_ATTACH(Tracer, "pruned", static_cast<int>(Pruned));
   // Apply callback to the top Req.Limit items in the descending
   // order of cumulative score.
   for (const auto &Item : std::move(Top).items())
@@ -244,38 +531,141 @@ bool Dex::fuzzyFind(const FuzzyFindRequest &Req,
   return More;
 }
 
+std::vector<bool> Dex::fuzzyFindBatch(
+    llvm::ArrayRef<FuzzyFindRequest> Reqs,
+    llvm::function_ref<void(size_t, const Symbol &)> Callback) const {
+  size_t NumWorkers = std::min<size_t>(
+      llvm::heavyweight_hardware_concurrency(), Reqs.size());
+  if (NumWorkers <= 1)
+    return SymbolIndex::fuzzyFindBatch(Reqs, Callback);
+  trace::Span Tracer("Dex fuzzyFindBatch");
+  SPAN_ATTACH(Tracer, "requests", static_cast<int>(Reqs.size()));
+  // Symbols are owned by the index, so workers only need to record pointers.
+  std::vector<std::vector<const Symbol *>> Results(Reqs.size());
+  // Not std::vector<bool>: workers write neighbouring elements concurrently.
+  std::vector<char> More(Reqs.size());
+  std::atomic<size_t> Next(0);
+  // Workers run in the caller's context, so they see its cancellation.
+  const Context &Ctx = Context::current();
+  {
+    AsyncTaskRunner Runner;
+    for (size_t Worker = 0; Worker < NumWorkers; ++Worker)
+      Runner.runAsync("dex-batch:" + llvm::Twine(Worker), [&] {
+        WithContext WithCtx(Ctx.clone());
+        for (size_t I = Next++; I < Reqs.size(); I = Next++)
+          More[I] = fuzzyFind(Reqs[I], [&](const Symbol &S) {
+            Results[I].push_back(&S);
+          });
+      });
+    Runner.wait();
+  }
+  for (size_t I = 0; I < Reqs.size(); ++I)
+    for (const Symbol *S : Results[I])
+      Callback(I, *S);
+  return std::vector<bool>(More.begin(), More.end());
+}
+
 void Dex::lookup(const LookupRequest &Req,
                  llvm::function_ref<void(const Symbol &)> Callback) const {
   trace::Span Tracer("Dex lookup");
   for (const auto &ID : Req.IDs) {
-    auto I = LookupTable.find(ID);
-    if (I != LookupTable.end())
-      Callback(*I->second);
+    if (const Symbol *Sym = LookupTable.lookup(ID))
+      Callback(*Sym);
   }
 }
 
 void Dex::refs(const RefsRequest &Req,
                llvm::function_ref<void(const Ref &)> Callback) const {
   trace::Span Tracer("Dex refs");
+  if (Req.Limit && !Req.ProximityPaths.empty())
+    return nearestRefs(Req, Callback);
   uint32_t Remaining =
       Req.Limit.getValueOr(std::numeric_limits<uint32_t>::max());
-  for (const auto &ID : Req.IDs)
-    for (const auto &Ref : Refs.lookup(ID)) {
-      if (Remaining > 0 && static_cast<int>(Req.Filter & Ref.Kind)) {
+  for (const auto &ID : Req.IDs) {
+    if (isCancelled())
+      return;
+    Refs.forEach(ID, [&](const Ref &R) {
+      if (!Remaining)
+        return false;
+      if (static_cast<int>(Req.Filter & R.Kind)) {
         --Remaining;
-        Callback(Ref);
+        Callback(R);
+      }
+      return true;
+    });
+  }
+}
+
+// Hot symbols may have many more refs than the limit, so rather than the ones
+// that happen to come first we report the ones nearest to ProximityPaths.
+// Only the best Limit refs are kept while scanning. Refs in ProximityPaths
+// themselves would always be nearest, but the caller already has them.
+void Dex::nearestRefs(const RefsRequest &Req,
+                      llvm::function_ref<void(const Ref &)> Callback) const {
+  llvm::StringMap<SourceParams> Sources;
+  for (const auto &Path : Req.ProximityPaths)
+    Sources[Path] = SourceParams();
+  URIDistance Distance(std::move(Sources));
+  // Refs in the same file share a FileURI, so cache distances by pointer.
+  llvm::DenseMap<const char *, unsigned> DistanceByURI;
+  using DistanceAndRef = std::pair<unsigned, Ref>;
+  auto Nearer = [](const DistanceAndRef &L, const DistanceAndRef &R) {
+    return L.first < R.first;
+  };
+  TopN<DistanceAndRef, decltype(Nearer)> Nearest(*Req.Limit, Nearer);
+  for (const auto &ID : Req.IDs) {
+    if (isCancelled())
+      return;
+    Refs.forEach(ID, [&](const Ref &R) {
+      if (static_cast<int>(Req.Filter & R.Kind)) {
+        auto It = DistanceByURI.try_emplace(R.Location.FileURI, 0);
+        if (It.second)
+          It.first->second = Distance.distance(R.Location.FileURI);
+        if (It.first->second != 0)
+          Nearest.push({It.first->second, R});
       }
+      return true;
+    });
+  }
+  for (const auto &Item : std::move(Nearest).items())
+    Callback(Item.second);
+}
+
+void Dex::relations(
+    const RelationsRequest &Req,
+    llvm::function_ref<void(const SymbolID &, const Symbol &)> Callback) const {
+  trace::Span Tracer("Dex relations");
+  uint32_t Remaining =
+      Req.Limit.getValueOr(std::numeric_limits<uint32_t>::max());
+  for (const SymbolID &Subject : Req.Subjects) {
+    auto It = Relations.find(
+        std::make_pair(Subject, static_cast<uint32_t>(Req.Predicate)));
+    if (It == Relations.end())
+      continue;
+    for (const SymbolID &Object : It->second) {
+      if (!Remaining)
+        return;
+      const Symbol *Sym = LookupTable.lookup(Object);
+      if (!Sym)
+        continue;
+      --Remaining;
+      Callback(Subject, *Sym);
     }
+  }
 }
 
 size_t Dex::estimateMemoryUsage() const {
   size_t Bytes = Symbols.size() * sizeof(const Symbol *);
   Bytes += SymbolQuality.size() * sizeof(float);
+  Bytes += SymbolNames.size() * sizeof(llvm::StringRef);
   Bytes += LookupTable.getMemorySize();
   Bytes += InvertedIndex.getMemorySize();
   for (const auto &TokenToPostingList : InvertedIndex)
     Bytes += TokenToPostingList.second.bytes();
-  Bytes += Refs.getMemorySize();
+  Bytes += Refs.bytes();
+  Bytes += Relations.getMemorySize();
+  for (const auto &R : Relations)
+    Bytes += R.second.capacity() * sizeof(SymbolID);
   return Bytes + BackingDataSize;
 }
 
@@ -20,6 +20,7 @@
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_DEX_DEX_H
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_DEX_DEX_H
 
+#include "CompactRefs.h"
 #include "Iterator.h"
 #include "PostingList.h"
 #include "Token.h"
@@ -27,29 +28,41 @@
 #include "index/Index.h"
 #include "index/MemIndex.h"
 #include "index/SymbolCollector.h"
+#include "index/SymbolIDMap.h"
+#include "llvm/ADT/StringSet.h"
+#include <memory>
+#include <mutex>
 
 namespace clang {
 namespace clangd {
 namespace dex {
 
+/// The inverted index of a Dex, detached from the index. It can be serialized
+/// along with the symbols, and used to construct an equivalent Dex without
+/// generating search tokens for every symbol again.
+struct Postings {
+  /// SymbolOrder[ID] is the position of the symbol with DocID ID among the
+  /// indexed symbols sorted by SymbolID.
+  std::vector<uint32_t> SymbolOrder;
+  /// The compressed posting list of each search token.
+  std::vector<std::pair<Token, std::vector<Chunk>>> Lists;
+};
+
 /// In-memory Dex trigram-based index implementation.
-// FIXME(kbobyrev): Introduce serialization and deserialization of the symbol
-// index so that it can be loaded from the disk. Since static index is not
-// changed frequently, it's safe to assume that it has to be built only once
-// (when the clangd process starts). Therefore, it can be easier to store built
-// index on disk and then load it if available.
 class Dex : public SymbolIndex {
 public:
-  // All data must outlive this index.
+  // All symbols must outlive this index. Refs and relations are copied.
   template <typename SymbolRange, typename RefsRange>
-  Dex(SymbolRange &&Symbols, RefsRange &&Refs) : Corpus(0) {
-    for (auto &&Sym : Symbols)
-      this->Symbols.push_back(&Sym);
-    for (auto &&Ref : Refs)
-      this->Refs.try_emplace(Ref.first, Ref.second);
+  Dex(SymbolRange &&Symbols, RefsRange &&Refs)
+      : Dex(std::forward<SymbolRange>(Symbols), std::forward<RefsRange>(Refs),
+            llvm::ArrayRef<Relation>()) {}
+  template <typename SymbolRange, typename RefsRange, typename RelationsRange>
+  Dex(SymbolRange &&Symbols, RefsRange &&Refs, RelationsRange &&Relations)
+      : Corpus(0) {
+    addData(Symbols, Refs, Relations);
     buildIndex();
   }
-  // Symbols and Refs are owned by BackingData, Index takes ownership.
+  // Symbols are owned by BackingData, Index takes ownership.
   template <typename SymbolRange, typename RefsRange, typename Payload>
   Dex(SymbolRange &&Symbols, RefsRange &&Refs, Payload &&BackingData,
       size_t BackingDataSize)
@@ -58,25 +71,99 @@ public:
         std::make_shared<Payload>(std::move(BackingData)), nullptr);
     this->BackingDataSize = BackingDataSize;
   }
+  template <typename SymbolRange, typename RefsRange, typename RelationsRange,
+            typename Payload>
+  Dex(SymbolRange &&Symbols, RefsRange &&Refs, RelationsRange &&Relations,
+      Payload &&BackingData, size_t BackingDataSize)
+      : Dex(std::forward<SymbolRange>(Symbols), std::forward<RefsRange>(Refs),
+            std::forward<RelationsRange>(Relations)) {
+    KeepAlive = std::shared_ptr<void>(
+        std::make_shared<Payload>(std::move(BackingData)), nullptr);
+    this->BackingDataSize = BackingDataSize;
+  }
+  // Symbols (in SymbolID order) are owned by BackingData, Index takes
+  // ownership. The inverted index is restored from P rather than built.
+  template <typename SymbolRange, typename RefsRange, typename Payload>
+  Dex(SymbolRange &&Symbols, RefsRange &&Refs, Postings P,
+      Payload &&BackingData, size_t BackingDataSize)
+      : Dex(std::forward<SymbolRange>(Symbols), std::forward<RefsRange>(Refs),
+            llvm::ArrayRef<Relation>(), std::move(P),
+            std::forward<Payload>(BackingData), BackingDataSize) {}
+  template <typename SymbolRange, typename RefsRange, typename RelationsRange,
+            typename Payload>
+  Dex(SymbolRange &&Symbols, RefsRange &&Refs, RelationsRange &&Relations,
+      Postings P, Payload &&BackingData, size_t BackingDataSize)
+      : Corpus(0) {
+    addData(Symbols, Refs, Relations);
+    buildIndex(std::move(P));
+    KeepAlive = std::shared_ptr<void>(
+        std::make_shared<Payload>(std::move(BackingData)), nullptr);
+    this->BackingDataSize = BackingDataSize;
+  }
 
-  /// Builds an index from slabs. The index takes ownership of the slab.
+  /// Builds an index from slabs. The index takes ownership of the symbols, and
+  /// copies the refs.
   static std::unique_ptr<SymbolIndex> build(SymbolSlab, RefSlab);
+  /// Builds an index from slabs, restoring posting lists that postings()
+  /// returned for an index of the same symbols.
+  static std::unique_ptr<SymbolIndex> build(SymbolSlab, RefSlab, Postings);
+  /// Like the above, and copies the relations too.
+  static std::unique_ptr<SymbolIndex> build(SymbolSlab, RefSlab, RelationSlab);
+  static std::unique_ptr<SymbolIndex> build(SymbolSlab, RefSlab, RelationSlab,
+                                            Postings);
+
+  /// Returns the inverted index in a serializable form.
+  Postings postings() const;
 
   bool
   fuzzyFind(const FuzzyFindRequest &Req,
             llvm::function_ref<void(const Symbol &)> Callback) const override;
 
+  /// Runs the requests in parallel: the index is immutable, so there is no
+  /// contention between them. Callback is invoked on the calling thread.
+  std::vector<bool> fuzzyFindBatch(
+      llvm::ArrayRef<FuzzyFindRequest> Reqs,
+      llvm::function_ref<void(size_t, const Symbol &)> Callback) const override;
+
   void lookup(const LookupRequest &Req,
               llvm::function_ref<void(const Symbol &)> Callback) const override;
 
   void refs(const RefsRequest &Req,
             llvm::function_ref<void(const Ref &)> Callback) const override;
 
+  void relations(const RelationsRequest &Req,
+                 llvm::function_ref<void(const SymbolID &, const Symbol &)>
+                     Callback) const override;
+
   size_t estimateMemoryUsage() const override;
 
 private:
+  template <typename SymbolRange, typename RefsRange, typename RelationsRange>
+  void addData(SymbolRange &&Symbols, RefsRange &&Refs,
+               RelationsRange &&Relations) {
+    for (auto &&Sym : Symbols)
+      this->Symbols.push_back(&Sym);
+    for (auto &&Ref : Refs)
+      this->Refs.insert(Ref.first, Ref.second);
+    for (const Relation &R : Relations)
+      this->Relations[std::make_pair(R.Subject,
+                                     static_cast<uint32_t>(R.Predicate))]
+          .push_back(R.Object);
+  }
+  void nearestRefs(const RefsRequest &Req,
+                   llvm::function_ref<void(const Ref &)> Callback) const;
   void buildIndex();
+  void buildIndex(Postings P);
   std::unique_ptr<Iterator> iterator(const Token &Tok) const;
+  /// A posting list of symbols near the proximity paths, and its boost.
+  struct ProximityBoost {
+    const Token *Tok;
+    const PostingList *List;
+    float Boost;
+  };
+  using ProximityBoosts = std::vector<ProximityBoost>;
+  std::shared_ptr<const ProximityBoosts>
+  proximityBoosts(llvm::ArrayRef<std::string> ProximityPaths) const;
   std::unique_ptr<Iterator>
   createFileProximityIterator(llvm::ArrayRef<std::string> ProximityPaths) const;
   std::unique_ptr<Iterator>
@@ -86,7 +173,14 @@ private:
   std::vector<const Symbol *> Symbols;
   /// SymbolQuality[I] is the quality of Symbols[I].
   std::vector<float> SymbolQuality;
-  llvm::DenseMap<SymbolID, const Symbol *> LookupTable;
+  /// Whether SymbolQuality is non-increasing, so that fuzzyFind() can stop
+  /// retrieving once the remaining symbols' quality is too low.
+  bool SortedByQuality = false;
+  /// SymbolNames[I] is the name of Symbols[I]. Scoring fuzzyFind candidates
+  /// only needs the name and quality, keeping them in contiguous arrays avoids
+  /// touching the (much larger) Symbol of every candidate.
+  std::vector<llvm::StringRef> SymbolNames;
+  SymbolIDMap<const Symbol *> LookupTable;
   /// Inverted index is a mapping from the search token to the posting list,
   /// which contains all items which can be characterized by such search token.
   /// For example, if the search token is scope "std::", the corresponding
@@ -94,8 +188,20 @@ private:
   /// std. Inverted index is used to retrieve posting lists which are processed
   /// during the fuzzyFind process.
   llvm::DenseMap<Token, PostingList> InvertedIndex;
+  /// Scopes whose symbols have their own trigram posting lists, with tokens
+  /// of kind ScopedTrigram.
+  llvm::StringSet<> PartitionedScopes;
   dex::Corpus Corpus;
-  llvm::DenseMap<SymbolID, llvm::ArrayRef<Ref>> Refs;
+  CompactRefs Refs;
+  /// Objects of the relations with each (Subject, Predicate).
+  llvm::DenseMap<std::pair<SymbolID, uint32_t>, std::vector<SymbolID>>
+      Relations;
+  /// Boosts computed for recent ProximityPaths, which are usually the same
+  /// for many requests (e.g. all completions in a file). The index doesn't
+  /// change, so they never get stale.
+  mutable std::mutex ProximityMu;
+  mutable llvm::StringMap<std::shared_ptr<const ProximityBoosts>>
+      ProximityCache; // GUARDED_BY(ProximityMu)
   std::shared_ptr<void> KeepAlive; // poor man's move-only std::any
   // Size of memory retained by KeepAlive.
   size_t BackingDataSize = 0;
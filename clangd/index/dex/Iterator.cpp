@@ -7,7 +7,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "Iterator.h"
+#include "Token.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/MathExtras.h"
 #include <algorithm>
 #include <cassert>
 #include <numeric>
@@ -27,21 +29,23 @@ public:
   explicit AndIterator(std::vector<std::unique_ptr<Iterator>> AllChildren)
       : Iterator(Kind::And), Children(std::move(AllChildren)) {
     assert(!Children.empty() && "AND iterator should have at least one child.");
-    // Establish invariants.
-    for (const auto &Child : Children)
-      ReachedEnd |= Child->reachedEnd();
-    sync();
     // When children are sorted by the estimateSize(), sync() calls are more
     // effective. Each sync() starts with the first child and makes sure all
     // children point to the same element. If any child is "above" the previous
     // ones, the algorithm resets and and advances the children to the next
     // highest element starting from the front. When child iterators in the
     // beginning have smaller estimated size, the sync() will have less restarts
-    // and become more effective.
+    // and become more effective. The rarest child then drives the intersection
+    // and the others skip ahead with advanceTo(). Sort before the first sync()
+    // so that it benefits too.
     llvm::sort(Children, [](const std::unique_ptr<Iterator> &LHS,
                             const std::unique_ptr<Iterator> &RHS) {
       return LHS->estimateSize() < RHS->estimateSize();
     });
+    // Establish invariants.
+    for (const auto &Child : Children)
+      ReachedEnd |= Child->reachedEnd();
+    sync();
   }
 
   bool reachedEnd() const override { return ReachedEnd; }
@@ -70,6 +74,13 @@ public:
     return Boost;
   }
 
+  float maxBoost() const override {
+    float Boost = 1;
+    for (const auto &Child : Children)
+      Boost *= Child->maxBoost();
+    return Boost;
+  }
+
   size_t estimateSize() const override {
     return Children.front()->estimateSize();
   }
@@ -188,6 +199,14 @@ public:
     return Boost;
   }
 
+  float maxBoost() const override {
+    float Boost = 1;
+    for (const auto &Child : Children)
+      if (!Child->reachedEnd())
+        Boost = std::max(Boost, Child->maxBoost());
+    return Boost;
+  }
+
   size_t estimateSize() const override {
     size_t Size = 0;
     for (const auto &Child : Children)
@@ -241,6 +260,8 @@ public:
     return 1;
   }
 
+  float maxBoost() const override { return 1; }
+
   size_t estimateSize() const override { return Size; }
 
 private:
@@ -268,6 +289,7 @@ public:
     assert(false);
     return 1;
   }
+  float maxBoost() const override { return 0; }
   size_t estimateSize() const override { return 0; }
 
 private:
@@ -276,6 +298,132 @@ private:
   }
 };
 
+/// Iterates over the DocIDs set in one or more bitsets, a 64-bit word at a
+/// time. Several bitsets are combined word by word, either intersected or
+/// united, so that the AND or OR of dense posting lists costs a few bitwise
+/// operations per 64 documents instead of an advanceTo() per match.
+class BitsetIterator : public Iterator {
+public:
+  BitsetIterator(llvm::ArrayRef<uint64_t> Bits, size_t Size, const Token *Tok)
+      : Iterator(Kind::Bitset), Sets{{Bits, Tok}}, Size(Size),
+        NumWords(Bits.size()) {
+    rewind();
+  }
+
+  bool reachedEnd() const override { return Word >= NumWords; }
+
+  void advance() override {
+    assert(!reachedEnd() && "Bitset iterator can't advance() at the end.");
+    Remaining &= Remaining - 1; // Clear the current bit.
+    normalize();
+  }
+
+  void advanceTo(DocID ID) override {
+    assert(!reachedEnd() && "Bitset iterator can't advanceTo() at the end.");
+    if (ID <= peek())
+      return;
+    if (ID / 64 != Word) {
+      Word = ID / 64;
+      if (reachedEnd())
+        return;
+      Remaining = load(Word);
+    }
+    Remaining &= ~uint64_t(0) << (ID % 64);
+    normalize();
+  }
+
+  DocID peek() const override {
+    assert(!reachedEnd() && "Bitset iterator can't peek() at the end.");
+    return Word * 64 + llvm::countTrailingZeros(Remaining);
+  }
+
+  float consume() override {
+    assert(!reachedEnd() && "Bitset iterator can't consume() at the end.");
+    return 1;
+  }
+
+  float maxBoost() const override { return 1; }
+
+  size_t estimateSize() const override { return Size; }
+
+private:
+  /// Combines the bitsets of Other into this iterator, using the operation
+  /// given by Intersect.
+  void merge(const BitsetIterator &Other) {
+    assert((Other.Sets.size() == 1 || Other.Intersect == Intersect) &&
+           "Bitsets combined with different operations.");
+    Sets.insert(Sets.end(), Other.Sets.begin(), Other.Sets.end());
+    if (Intersect) {
+      Size = std::min(Size, Other.Size);
+      NumWords = std::min(NumWords, Other.NumWords);
+    } else {
+      Size += Other.Size;
+      NumWords = std::max(NumWords, Other.NumWords);
+    }
+    rewind();
+  }
+
+  /// Computes word W of the combined bitset.
+  uint64_t load(size_t W) const {
+    uint64_t Result = Intersect ? ~uint64_t(0) : 0;
+    for (const auto &Set : Sets) {
+      uint64_t Bits = W < Set.first.size() ? Set.first[W] : 0;
+      Result = Intersect ? Result & Bits : Result | Bits;
+    }
+    return Result;
+  }
+
+  void rewind() {
+    Word = 0;
+    Remaining = NumWords ? load(0) : 0;
+    normalize();
+  }
+
+  /// Skips empty words, so that Remaining holds the current DocID.
+  void normalize() {
+    while (!Remaining && !reachedEnd())
+      if (++Word < NumWords)
+        Remaining = load(Word);
+  }
+
+  llvm::raw_ostream &dump(llvm::raw_ostream &OS) const override {
+    if (Sets.size() == 1)
+      return dumpSet(OS, Sets.front());
+    OS << (Intersect ? "(&" : "(|");
+    for (const auto &Set : Sets)
+      dumpSet(OS << ' ', Set);
+    return OS << ')';
+  }
+
+  static llvm::raw_ostream &
+  dumpSet(llvm::raw_ostream &OS,
+          const std::pair<llvm::ArrayRef<uint64_t>, const Token *> &Set) {
+    if (Set.second != nullptr)
+      return OS << *Set.second;
+    OS << '[';
+    const char *Sep = "";
+    for (size_t W = 0; W < Set.first.size(); ++W)
+      for (uint64_t Bits = Set.first[W]; Bits; Bits &= Bits - 1) {
+        OS << Sep << W * 64 + llvm::countTrailingZeros(Bits);
+        Sep = " ";
+      }
+    return OS << ']';
+  }
+
+  friend Corpus; // For optimizations.
+  /// The combined bitsets, and their tokens if any.
+  std::vector<std::pair<llvm::ArrayRef<uint64_t>, const Token *>> Sets;
+  /// Whether the bitsets are intersected or united.
+  bool Intersect = true;
+  size_t Size;
+  /// Number of words in the combined bitset.
+  size_t NumWords;
+  /// Index of the current word.
+  size_t Word;
+  /// Bits of the current word not yet advanced past.
+  uint64_t Remaining;
+};
+
 /// Boost iterator is a wrapper around its child which multiplies scores of
 /// each retrieved item by a given factor.
 class BoostIterator : public Iterator {
@@ -293,6 +441,8 @@ public:
 
   float consume() override { return Child->consume() * Factor; }
 
+  float maxBoost() const override { return Child->maxBoost() * Factor; }
+
   size_t estimateSize() const override { return Child->estimateSize(); }
 
 private:
@@ -331,6 +481,8 @@ public:
     return Child->consume();
   }
 
+  float maxBoost() const override { return Child->maxBoost(); }
+
   size_t estimateSize() const override {
     return std::min(Child->estimateSize(), Limit);
   }
@@ -354,6 +506,36 @@ std::vector<std::pair<DocID, float>> consume(Iterator &It) {
   return Result;
 }
 
+std::unique_ptr<Iterator> bitsetIterator(llvm::ArrayRef<uint64_t> Bits,
+                                         size_t Size, const Token *Tok) {
+  return llvm::make_unique<BitsetIterator>(Bits, Size, Tok);
+}
+
+void Corpus::mergeBitsets(std::vector<std::unique_ptr<Iterator>> &Children,
+                          bool Intersect) {
+  // Bitset iterators always return a boost of 1, so combining them doesn't
+  // change the boosts of the parent either.
+  BitsetIterator *Merged = nullptr;
+  std::vector<std::unique_ptr<Iterator>> Remaining;
+  for (auto &Child : Children) {
+    if (Child->kind() == Iterator::Kind::Bitset) {
+      auto *Bitset = static_cast<BitsetIterator *>(Child.get());
+      // A single bitset is the same under either operation.
+      if (Bitset->Sets.size() == 1)
+        Bitset->Intersect = Intersect;
+      if (Bitset->Intersect == Intersect) {
+        if (Merged) {
+          Merged->merge(*Bitset);
+          continue;
+        }
+        Merged = Bitset; // The first one absorbs the others.
+      }
+    }
+    Remaining.push_back(std::move(Child));
+  }
+  Children = std::move(Remaining);
+}
+
 std::unique_ptr<Iterator>
 Corpus::intersect(std::vector<std::unique_ptr<Iterator>> Children) const {
   std::vector<std::unique_ptr<Iterator>> RealChildren;
@@ -374,6 +556,7 @@ Corpus::intersect(std::vector<std::unique_ptr<Iterator>> Children) const {
       RealChildren.push_back(std::move(Child));
     }
   }
+  mergeBitsets(RealChildren, /*Intersect=*/true);
   switch (RealChildren.size()) {
   case 0:
     return all();
@@ -404,6 +587,7 @@ Corpus::unionOf(std::vector<std::unique_ptr<Iterator>> Children) const {
       RealChildren.push_back(std::move(Child));
     }
   }
+  mergeBitsets(RealChildren, /*Intersect=*/false);
   switch (RealChildren.size()) {
   case 0:
     return none();
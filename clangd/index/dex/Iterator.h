@@ -40,6 +40,7 @@
 namespace clang {
 namespace clangd {
 namespace dex {
+struct Token;
 
 /// Symbol position in the list of all index symbols sorted by a pre-computed
 /// symbol quality.
@@ -78,6 +79,9 @@ public:
   /// consume() must *not* be called on children that don't contain the current
   /// doc.
   virtual float consume() = 0;
+  /// Returns an upper bound of the boosts consume() returns for the remaining
+  /// documents, used to stop retrieval once no document can score high enough.
+  virtual float maxBoost() const = 0;
   /// Returns an estimate of advance() calls before the iterator is exhausted.
   virtual size_t estimateSize() const = 0;
 
@@ -98,7 +102,7 @@ public:
   }
 
   /// Inspect iterator type, used internally for optimizing query trees.
-  enum class Kind { And, Or, True, False, Other };
+  enum class Kind { And, Or, True, False, Bitset, Other };
   Kind kind() const { return MyKind; }
 
 protected:
@@ -119,6 +123,14 @@ private:
 /// to acquire preliminary scores of requested items.
 std::vector<std::pair<DocID, float>> consume(Iterator &It);
 
+/// Returns an iterator over the DocIDs whose bits are set in Bits, of which
+/// there are Size. Used by dense posting lists, and combined with other such
+/// iterators a word at a time when intersected or united. If given, Tok is only
+/// used for the string representation.
+std::unique_ptr<Iterator> bitsetIterator(llvm::ArrayRef<uint64_t> Bits,
+                                         size_t Size,
+                                         const Token *Tok = nullptr);
+
 namespace detail {
 // Variadic template machinery.
 inline void populateChildren(std::vector<std::unique_ptr<Iterator>> &) {}
@@ -134,6 +146,11 @@ void populateChildren(std::vector<std::unique_ptr<Iterator>> &Children,
 class Corpus {
   DocID Size;
 
+  /// Combines the bitset iterators among Children into one, which intersects
+  /// or unites their bitsets.
+  static void mergeBitsets(std::vector<std::unique_ptr<Iterator>> &Children,
+                           bool Intersect);
+
 public:
   explicit Corpus(DocID Size) : Size(Size) {}
 
@@ -11,6 +11,9 @@
 #include "Token.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MathExtras.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace clang {
 namespace clangd {
@@ -64,6 +67,8 @@ public:
     return 1;
   }
 
+  float maxBoost() const override { return 1; }
+
   size_t estimateSize() const override {
     return Chunks.size() * ApproxEntriesPerChunk;
   }
@@ -97,12 +102,26 @@ private:
   }
 
   /// Advances CurrentChunk to the chunk which might contain ID.
+  ///
+  /// The target is usually close to the current chunk (e.g. when intersecting
+  /// lists of similar density), so this gallops forward with doubling steps to
+  /// bound the target before binary searching. This takes O(log(distance))
+  /// chunk probes rather than O(log(remaining chunks)), with better locality.
   void advanceToChunk(DocID ID) {
     if ((CurrentChunk != Chunks.end() - 1) &&
         ((CurrentChunk + 1)->Head <= ID)) {
-      // Find the next chunk with Head >= ID.
+      // Invariant: Low->Head <= ID.
+      auto Low = CurrentChunk + 1;
+      size_t Step = 1;
+      while (Step < static_cast<size_t>(Chunks.end() - Low) &&
+             (Low + Step)->Head <= ID) {
+        Low += Step;
+        Step *= 2;
+      }
+      auto High = Low + std::min<size_t>(Step, Chunks.end() - Low);
+      // Find the next chunk with Head > ID, the target is the one before it.
       CurrentChunk = std::lower_bound(
-          CurrentChunk + 1, Chunks.end(), ID,
+          Low + 1, High, ID,
           [](const Chunk &C, const DocID ID) { return C.Head <= ID; });
       --CurrentChunk;
       DecompressedChunk = CurrentChunk->decompress();
@@ -181,20 +200,62 @@ std::vector<Chunk> encodeStream(llvm::ArrayRef<DocID> Documents) {
   return std::vector<Chunk>(Result); // no move, shrink-to-fit
 }
 
-/// Reads variable length DocID from the buffer and updates the buffer size. If
-/// the stream is terminated, return None.
-llvm::Optional<DocID> readVByte(llvm::ArrayRef<uint8_t> &Bytes) {
-  if (Bytes.front() == 0 || Bytes.empty())
-    return None;
-  DocID Result = 0;
-  bool HasNextByte = true;
-  for (size_t Length = 0; HasNextByte && !Bytes.empty(); ++Length) {
-    assert(Length <= 5 && "Malformed VByte encoding sequence.");
-    // Write meaningful bits to the correct place in the document decoding.
-    Result |= (Bytes.front() & 0x7f) << (BitsPerEncodingByte * Length);
-    if ((Bytes.front() & 0x80) == 0)
-      HasNextByte = false;
-    Bytes = Bytes.drop_front();
+/// Bit I of each mask describes Payload[I].
+struct PayloadMasks {
+  /// Bytes with the continuation bit set, i.e. not ending a delta.
+  uint32_t Continuation;
+  /// Null bytes. Encoded deltas contain none, so these pad the stream's end.
+  uint32_t Null;
+};
+static_assert(Chunk::PayloadSize <= 32, "Payload masks don't fit 32 bits.");
+
+/// Classifies all payload bytes at once, so that decoding doesn't need to
+/// branch on every byte.
+PayloadMasks
+computeMasks(const std::array<uint8_t, Chunk::PayloadSize> &Payload) {
+#if defined(__SSE2__)
+  static_assert(Chunk::PayloadSize >= 16,
+                "Payload should be covered by two 16-byte loads.");
+  // Two (possibly overlapping) unaligned loads cover the whole payload.
+  constexpr unsigned HighOffset = Chunk::PayloadSize - 16;
+  const __m128i Low =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(Payload.data()));
+  const __m128i High = _mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(Payload.data() + HighOffset));
+  const __m128i Zero = _mm_setzero_si128();
+  PayloadMasks Masks;
+  // movemask collects the top (continuation) bit of each byte.
+  Masks.Continuation = static_cast<uint32_t>(_mm_movemask_epi8(Low)) |
+                       static_cast<uint32_t>(_mm_movemask_epi8(High))
+                           << HighOffset;
+  Masks.Null =
+      static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(Low, Zero))) |
+      static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(High, Zero)))
+          << HighOffset;
+  return Masks;
+#else
+  PayloadMasks Masks = {0, 0};
+  for (size_t I = 0; I < Chunk::PayloadSize; ++I) {
+    Masks.Continuation |= static_cast<uint32_t>(Payload[I] >> 7) << I;
+    Masks.Null |= static_cast<uint32_t>(Payload[I] == 0) << I;
+  }
+  return Masks;
+#endif
+}
+
+/// Shorter lists take only a few chunks, and gain little from a bitset.
+constexpr size_t MinDenseSize = 256;
+
+/// Whether a list of Size DocIDs up to Last is stored as a bitset. A bitset
+/// takes a bit per DocID up to the last one, and chunks take at least a byte
+/// per element.
+bool isDense(size_t Size, DocID Last) { return Size * 8 > Last; }
+
+std::vector<DocID> decompressAll(llvm::ArrayRef<Chunk> Chunks) {
+  std::vector<DocID> Result;
+  for (const Chunk &C : Chunks) {
+    auto Decompressed = C.decompress();
+    Result.insert(Result.end(), Decompressed.begin(), Decompressed.end());
   }
   return Result;
 }
@@ -203,22 +264,73 @@ llvm::Optional<DocID> readVByte(llvm::ArrayRef<uint8_t> &Bytes) {
 
 llvm::SmallVector<DocID, Chunk::PayloadSize + 1> Chunk::decompress() const {
   llvm::SmallVector<DocID, Chunk::PayloadSize + 1> Result{Head};
-  llvm::ArrayRef<uint8_t> Bytes(Payload);
-  DocID Delta;
-  for (DocID Current = Head; !Bytes.empty(); Current += Delta) {
-    auto MaybeDelta = readVByte(Bytes);
-    if (!MaybeDelta)
-      break;
-    Delta = *MaybeDelta;
-    Result.push_back(Current + Delta);
-  }
-  return llvm::SmallVector<DocID, Chunk::PayloadSize + 1>{Result};
+  const PayloadMasks Masks = computeMasks(Payload);
+  // The stream is terminated by the first null byte, if any.
+  const unsigned Length =
+      Masks.Null ? llvm::countTrailingZeros(Masks.Null) : PayloadSize;
+  const uint32_t InStream = (uint64_t(1) << Length) - 1;
+  DocID Current = Head;
+  // Fast path: all deltas fit a single byte (common for dense lists).
+  if ((Masks.Continuation & InStream) == 0) {
+    for (unsigned I = 0; I < Length; ++I)
+      Result.push_back(Current += Payload[I]);
+    return Result;
+  }
+  // Otherwise, each byte without the continuation bit ends a delta.
+  unsigned Start = 0;
+  for (uint32_t Ends = ~Masks.Continuation & InStream; Ends;
+       Ends &= Ends - 1) {
+    const unsigned End = llvm::countTrailingZeros(Ends);
+    assert(End - Start < 5 && "Malformed VByte encoding sequence.");
+    DocID Delta = 0;
+    // Write meaningful bits to the correct place in the document decoding.
+    for (unsigned I = Start; I <= End && I - Start < 5; ++I)
+      Delta |= (Payload[I] & 0x7f) << (BitsPerEncodingByte * (I - Start));
+    Result.push_back(Current += Delta);
+    Start = End + 1;
+  }
+  return Result;
 }
 
-PostingList::PostingList(llvm::ArrayRef<DocID> Documents)
-    : Chunks(encodeStream(Documents)) {}
+PostingList::PostingList(llvm::ArrayRef<DocID> Documents) { init(Documents); }
+
+PostingList::PostingList(std::vector<Chunk> Chunks) {
+  // Only decompress the lists which might be dense.
+  if (Chunks.empty() ||
+      Chunks.size() * (Chunk::PayloadSize + 1) < MinDenseSize ||
+      !isDense(Chunks.size() * (Chunk::PayloadSize + 1), Chunks.back().Head)) {
+    this->Chunks = std::move(Chunks);
+    return;
+  }
+  init(decompressAll(Chunks));
+}
+
+void PostingList::init(llvm::ArrayRef<DocID> Documents) {
+  if (Documents.size() < MinDenseSize ||
+      !isDense(Documents.size(), Documents.back())) {
+    Chunks = encodeStream(Documents);
+    return;
+  }
+  Bits.resize(Documents.back() / 64 + 1);
+  for (DocID Doc : Documents)
+    Bits[Doc / 64] |= uint64_t(1) << (Doc % 64);
+  DenseSize = Documents.size();
+}
+
+std::vector<Chunk> PostingList::chunks() const {
+  if (Bits.empty())
+    return Chunks;
+  std::vector<DocID> Documents;
+  Documents.reserve(DenseSize);
+  for (size_t W = 0; W < Bits.size(); ++W)
+    for (uint64_t Word = Bits[W]; Word; Word &= Word - 1)
+      Documents.push_back(W * 64 + llvm::countTrailingZeros(Word));
+  return encodeStream(Documents);
+}
 
 std::unique_ptr<Iterator> PostingList::iterator(const Token *Tok) const {
+  if (!Bits.empty())
+    return bitsetIterator(Bits, DenseSize, Tok);
   return llvm::make_unique<ChunkIterator>(Tok, Chunks);
 }
 
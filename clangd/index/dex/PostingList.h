@@ -56,9 +56,16 @@ static_assert(sizeof(Chunk) == 32, "Chunk should take 32 bytes of memory.");
 /// Tree as a leaf by constructing Iterator over the PostingList object. DocIDs
 /// are stored in underlying chunks. Compression saves memory at a small cost
 /// in access time, which is still fast enough in practice.
+///
+/// Lists of very frequent tokens (such as a top-level scope) are instead stored
+/// as a bitset over DocIDs, which is smaller when most gaps are under 8 and
+/// lets intersections and unions with other dense lists proceed a word at a
+/// time.
 class PostingList {
 public:
   explicit PostingList(llvm::ArrayRef<DocID> Documents);
+  /// Reuses the chunks of an existing posting list, e.g. a deserialized one.
+  explicit PostingList(std::vector<Chunk> Chunks);
 
   /// Constructs DocumentIterator over given posting list. DocumentIterator will
   /// go through the chunks and decompress them on-the-fly when necessary.
@@ -66,10 +73,24 @@ public:
   std::unique_ptr<Iterator> iterator(const Token *Tok = nullptr) const;
 
   /// Returns in-memory size of external storage.
-  size_t bytes() const { return Chunks.capacity() * sizeof(Chunk); }
+  size_t bytes() const {
+    return Chunks.capacity() * sizeof(Chunk) +
+           Bits.capacity() * sizeof(uint64_t);
+  }
+
+  /// The compressed representation of this posting list. Dense lists are
+  /// encoded on demand.
+  std::vector<Chunk> chunks() const;
 
 private:
-  const std::vector<Chunk> Chunks;
+  void init(llvm::ArrayRef<DocID> Documents);
+
+  /// Empty if the list is dense.
+  std::vector<Chunk> Chunks;
+  /// Bit I is set if DocID I is in a dense list. Empty otherwise.
+  std::vector<uint64_t> Bits;
+  /// Number of DocIDs in a dense list.
+  size_t DenseSize = 0;
 };
 
 } // namespace dex
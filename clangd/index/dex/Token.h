@@ -64,6 +64,13 @@ struct Token {
     ProximityURI,
     /// Type of symbol (see `Symbol::Type`).
     Type,
+    /// Trigram of the names of the symbols in one scope. Only large scopes
+    /// have these, so that queries restricted to them don't go through the
+    /// trigrams of the whole index.
+    ///
+    /// Data stores the scope followed by the trigram, e.g. "foo::bar::abc".
+    /// Trigrams never contain ':', so the scope ends at the last "::".
+    ScopedTrigram,
     /// Internal Token type for invalid/special tokens, e.g. empty tokens for
     /// llvm::DenseMap.
     Sentinel,
@@ -94,6 +101,9 @@ struct Token {
     case Kind::Type:
       OS << "Ty=";
       break;
+    case Kind::ScopedTrigram:
+      OS << "ST=";
+      break;
     case Kind::Sentinel:
       OS << "?=";
       break;
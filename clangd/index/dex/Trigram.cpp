@@ -11,7 +11,11 @@
 #include "Token.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include <algorithm>
 #include <cctype>
 #include <queue>
 #include <string>
@@ -20,13 +24,17 @@ namespace clang {
 namespace clangd {
 namespace dex {
 
-std::vector<Token> generateIdentifierTrigrams(llvm::StringRef Identifier) {
+void generateIdentifierTrigrams(llvm::StringRef Identifier,
+                                std::vector<Trigram> &Out) {
+  Out.clear();
   // Apply fuzzy matching text segmentation.
-  std::vector<CharRole> Roles(Identifier.size());
+  llvm::SmallVector<CharRole, 32> Roles(Identifier.size());
   calculateRoles(Identifier,
                  llvm::makeMutableArrayRef(Roles.data(), Identifier.size()));
 
-  std::string LowercaseIdentifier = Identifier.lower();
+  llvm::SmallString<32> LowercaseIdentifier;
+  for (char C : Identifier)
+    LowercaseIdentifier.push_back(llvm::toLower(C));
 
   // For each character, store indices of the characters to which fuzzy matching
   // algorithm can jump. There are 3 possible variants:
@@ -36,7 +44,8 @@ std::vector<Token> generateIdentifierTrigrams(llvm::StringRef Identifier) {
   //
   // Next stores tuples of three indices in the presented order, if a variant is
   // not available then 0 is stored.
-  std::vector<std::array<unsigned, 3>> Next(LowercaseIdentifier.size());
+  llvm::SmallVector<std::array<unsigned, 3>, 32> Next(
+      LowercaseIdentifier.size());
   unsigned NextTail = 0, NextHead = 0;
   for (int I = LowercaseIdentifier.size() - 1; I >= 0; --I) {
     Next[I] = {{NextTail, NextHead}};
@@ -46,10 +55,8 @@ std::vector<Token> generateIdentifierTrigrams(llvm::StringRef Identifier) {
     }
   }
 
-  llvm::DenseSet<Token> UniqueTrigrams;
-
-  auto Add = [&](std::string Chars) {
-    UniqueTrigrams.insert(Token(Token::Kind::Trigram, Chars));
+  auto Add = [&](std::initializer_list<char> Chars) {
+    Out.emplace_back(llvm::StringRef(Chars.begin(), Chars.size()));
   };
 
   // Iterate through valid sequneces of three characters Fuzzy Matcher can
@@ -64,8 +71,8 @@ std::vector<Token> generateIdentifierTrigrams(llvm::StringRef Identifier) {
       for (const unsigned K : Next[J]) {
         if (K == 0)
           continue;
-        Add({{LowercaseIdentifier[I], LowercaseIdentifier[J],
-              LowercaseIdentifier[K]}});
+        Add({LowercaseIdentifier[I], LowercaseIdentifier[J],
+             LowercaseIdentifier[K]});
       }
     }
   }
@@ -80,7 +87,19 @@ std::vector<Token> generateIdentifierTrigrams(llvm::StringRef Identifier) {
       break;
     }
 
-  return {UniqueTrigrams.begin(), UniqueTrigrams.end()};
+  // Identifiers have few trigrams, sorting them is cheaper than hashing.
+  llvm::sort(Out);
+  Out.erase(std::unique(Out.begin(), Out.end()), Out.end());
+}
+
+std::vector<Token> generateIdentifierTrigrams(llvm::StringRef Identifier) {
+  std::vector<Trigram> Trigrams;
+  generateIdentifierTrigrams(Identifier, Trigrams);
+  std::vector<Token> Result;
+  Result.reserve(Trigrams.size());
+  for (const Trigram &T : Trigrams)
+    Result.push_back(T.token());
+  return Result;
 }
 
 std::vector<Token> generateQueryTrigrams(llvm::StringRef Query) {
@@ -24,13 +24,51 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_DEX_TRIGRAM_H
 
 #include "Token.h"
-
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/Hashing.h"
+#include <cassert>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace clang {
 namespace clangd {
 namespace dex {
 
+/// A trigram packed into an integer, so that generating the trigrams of many
+/// identifiers doesn't allocate a string for each of them. The lowercase
+/// characters are stored in the lower three bytes, and their number (three,
+/// or fewer for short-query trigrams) in the top byte.
+class Trigram {
+public:
+  /// \p Chars must have at most 3 characters.
+  explicit Trigram(llvm::StringRef Chars) : Packed(Chars.size() << 24) {
+    assert(Chars.size() <= 3 && "Trigrams have at most three characters");
+    for (size_t I = 0; I < Chars.size(); ++I)
+      Packed |= static_cast<uint32_t>(static_cast<uint8_t>(Chars[I])) << 8 * I;
+  }
+
+  static Trigram fromPacked(uint32_t Packed) { return Trigram(Packed); }
+  uint32_t packed() const { return Packed; }
+
+  /// The equivalent Token of Kind::Trigram.
+  Token token() const {
+    char Chars[3];
+    size_t Size = Packed >> 24;
+    for (size_t I = 0; I < Size; ++I)
+      Chars[I] = static_cast<char>(Packed >> 8 * I);
+    return Token(Token::Kind::Trigram, llvm::StringRef(Chars, Size));
+  }
+
+  bool operator==(const Trigram &Other) const { return Packed == Other.Packed; }
+  bool operator<(const Trigram &Other) const { return Packed < Other.Packed; }
+
+private:
+  explicit Trigram(uint32_t Packed) : Packed(Packed) {}
+
+  uint32_t Packed;
+};
+
 /// Returns list of unique fuzzy-search trigrams from unqualified symbol.
 /// The trigrams give the 3-character query substrings this symbol can match.
 ///
@@ -46,8 +84,12 @@ namespace dex {
 ///  {f, fo, fb, foo, fob, fba, oob, oba, bar}.
 ///
 /// Trigrams are lowercase, as trigram matching is case-insensitive.
-/// Trigrams in the returned list are deduplicated.
+/// Trigrams in the returned list are deduplicated, in no particular order.
 std::vector<Token> generateIdentifierTrigrams(llvm::StringRef Identifier);
+/// Like above, but replaces the contents of \p Out with packed trigrams, which
+/// is much cheaper when generating the trigrams of many identifiers.
+void generateIdentifierTrigrams(llvm::StringRef Identifier,
+                                std::vector<Trigram> &Out);
 
 /// Returns list of unique fuzzy-search trigrams given a query.
 ///
@@ -64,4 +106,26 @@ std::vector<Token> generateQueryTrigrams(llvm::StringRef Query);
 } // namespace clangd
 } // namespace clang
 
+namespace llvm {
+
+// Support Trigrams as DenseMap keys. No trigram has a count of 0xFF.
+template <> struct DenseMapInfo<clang::clangd::dex::Trigram> {
+  static inline clang::clangd::dex::Trigram getEmptyKey() {
+    return clang::clangd::dex::Trigram::fromPacked(~0u);
+  }
+  static inline clang::clangd::dex::Trigram getTombstoneKey() {
+    return clang::clangd::dex::Trigram::fromPacked(~0u - 1);
+  }
+  static unsigned getHashValue(const clang::clangd::dex::Trigram &T) {
+    // Mix the bits: DenseMap only uses the lower ones.
+    return hash_value(T.packed());
+  }
+  static bool isEqual(const clang::clangd::dex::Trigram &LHS,
+                      const clang::clangd::dex::Trigram &RHS) {
+    return LHS == RHS;
+  }
+};
+
+} // namespace llvm
+
 #endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_DEX_TRIGRAM_H
@@ -8,18 +8,25 @@
 //
 // This file implements a simple interactive tool which can be used to manually
 // evaluate symbol search quality of Clangd index.
+// It can also replay a log of fuzzy find requests, and report their latencies
+// and how many of the MemIndex results the index finds.
 //
 //===----------------------------------------------------------------------===//
 
 #include "SourceCode.h"
 #include "index/Serialization.h"
 #include "index/dex/Dex.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/LineEditor/LineEditor.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
+#include <atomic>
+#include <thread>
 
 namespace clang {
 namespace clangd {
@@ -29,6 +36,21 @@ llvm::cl::opt<std::string> IndexPath("index-path",
                                      llvm::cl::desc("Path to the index"),
                                      llvm::cl::Positional, llvm::cl::Required);
 
+llvm::cl::opt<std::string> RequestsPath(
+    "requests",
+    llvm::cl::desc("Run the fuzzy find requests of this file (one JSON object "
+                   "per line, or a JSON array) and report their latencies, "
+                   "instead of starting the interactive mode"));
+
+llvm::cl::opt<unsigned> Concurrency(
+    "j", llvm::cl::init(1),
+    llvm::cl::desc("Number of threads running the requests of -requests"));
+
+llvm::cl::opt<bool> Recall(
+    "recall", llvm::cl::init(false),
+    llvm::cl::desc("With -requests, also run the requests against a MemIndex "
+                   "and report how many of its results the index finds"));
+
 static const std::string Overview = R"(
 This is an **experimental** interactive tool to process user-provided search
 queries over given symbol collection obtained via clangd-indexer. The
@@ -268,6 +290,142 @@ std::unique_ptr<SymbolIndex> openIndex(llvm::StringRef Index) {
   return loadIndex(Index, /*UseDex=*/true);
 }
 
+// Reads the requests of a query log: either a JSON array of FuzzyFindRequests,
+// as used by IndexBenchmark, or one request per line.
+llvm::Expected<std::vector<FuzzyFindRequest>>
+readRequests(llvm::StringRef Path) {
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return llvm::createStringError(Buffer.getError(), "Can't read %s",
+                                   Path.str().c_str());
+  llvm::StringRef Data = (*Buffer)->getBuffer();
+  std::vector<llvm::json::Value> Items;
+  if (Data.ltrim().startswith("[")) {
+    auto Array = llvm::json::parse(Data);
+    if (!Array)
+      return Array.takeError();
+    if (auto *A = Array->getAsArray())
+      Items.assign(A->begin(), A->end());
+  } else {
+    llvm::SmallVector<llvm::StringRef, 0> Lines;
+    Data.split(Lines, '\n', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+    for (llvm::StringRef Line : Lines) {
+      if (Line.trim().empty())
+        continue;
+      auto Item = llvm::json::parse(Line);
+      if (!Item)
+        return Item.takeError();
+      Items.push_back(std::move(*Item));
+    }
+  }
+  std::vector<FuzzyFindRequest> Requests;
+  for (const auto &Item : Items) {
+    FuzzyFindRequest Request;
+    if (!fromJSON(Item, Request))
+      return llvm::createStringError(
+          llvm::inconvertibleErrorCode(), "Invalid request: %s",
+          llvm::formatv("{0}", Item).str().c_str());
+    Requests.push_back(std::move(Request));
+  }
+  return std::move(Requests);
+}
+
+// Runs \p Requests on \p Index with \p Threads threads. Returns the latency
+// of each request, and fills \p Results with the IDs each one returned.
+std::vector<double> runRequests(const SymbolIndex &Index,
+                                llvm::ArrayRef<FuzzyFindRequest> Requests,
+                                unsigned Threads,
+                                std::vector<std::vector<SymbolID>> &Results) {
+  std::vector<double> LatenciesMs(Requests.size());
+  Results.assign(Requests.size(), {});
+  std::atomic<size_t> Next(0);
+  auto Work = [&] {
+    for (size_t I = Next++; I < Requests.size(); I = Next++) {
+      auto Start = std::chrono::steady_clock::now();
+      Index.fuzzyFind(Requests[I],
+                      [&](const Symbol &S) { Results[I].push_back(S.ID); });
+      LatenciesMs[I] = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - Start)
+                           .count();
+    }
+  };
+  std::vector<std::thread> Workers;
+  for (unsigned I = 1; I < Threads; ++I)
+    Workers.emplace_back(Work);
+  Work();
+  for (auto &W : Workers)
+    W.join();
+  return LatenciesMs;
+}
+
+void reportLatencies(llvm::StringRef Name, std::vector<double> LatenciesMs) {
+  if (LatenciesMs.empty())
+    return;
+  llvm::sort(LatenciesMs);
+  auto Percentile = [&](double P) {
+    return LatenciesMs[std::min(LatenciesMs.size() - 1,
+                                size_t(P * LatenciesMs.size()))];
+  };
+  double Total = 0;
+  for (double L : LatenciesMs)
+    Total += L;
+  llvm::outs() << llvm::formatv(
+      "{0}: {1} requests, mean {2:f3}ms, p50 {3:f3}ms, p90 {4:f3}ms, "
+      "p99 {5:f3}ms, max {6:f3}ms\n",
+      Name, LatenciesMs.size(), Total / LatenciesMs.size(), Percentile(0.5),
+      Percentile(0.9), Percentile(0.99), LatenciesMs.back());
+}
+
+// Replays the requests of RequestsPath. Returns the exit code.
+int runBatch(const SymbolIndex &Index) {
+  auto Requests = readRequests(RequestsPath);
+  if (!Requests) {
+    llvm::errs() << llvm::toString(Requests.takeError()) << "\n";
+    return 1;
+  }
+  unsigned Threads = std::max(1u, unsigned(Concurrency));
+  llvm::outs() << llvm::formatv("Index memory: {0} bytes\n",
+                                Index.estimateMemoryUsage());
+  std::vector<std::vector<SymbolID>> Results;
+  std::vector<double> LatenciesMs;
+  reportTime("Requests", [&] {
+    LatenciesMs = runRequests(Index, *Requests, Threads, Results);
+  });
+  reportLatencies("Index", std::move(LatenciesMs));
+  if (!Recall)
+    return 0;
+
+  std::unique_ptr<SymbolIndex> Mem;
+  reportTime("MemIndex build",
+             [&] { Mem = loadIndex(IndexPath, /*UseDex=*/false); });
+  if (!Mem) {
+    llvm::errs() << "Failed to open the index as a MemIndex.\n";
+    return 1;
+  }
+  llvm::outs() << llvm::formatv("MemIndex memory: {0} bytes\n",
+                                Mem->estimateMemoryUsage());
+  std::vector<std::vector<SymbolID>> Expected;
+  reportLatencies("MemIndex", runRequests(*Mem, *Requests, Threads, Expected));
+  // Both indexes return at most Limit results, so this is the recall at the
+  // requests' limit.
+  size_t Found = 0, Total = 0, Complete = 0;
+  for (size_t I = 0; I < Requests->size(); ++I) {
+    llvm::DenseSet<SymbolID> Returned(Results[I].begin(), Results[I].end());
+    size_t FoundHere = 0;
+    for (const SymbolID &ID : Expected[I])
+      FoundHere += Returned.count(ID);
+    Found += FoundHere;
+    Total += Expected[I].size();
+    Complete += FoundHere == Expected[I].size();
+  }
+  llvm::outs() << llvm::formatv(
+      "Recall: {0:f4} ({1} of {2} MemIndex results), {3} of {4} requests "
+      "found all of them\n",
+      Total ? double(Found) / Total : 1.0, Found, Total, Complete,
+      Requests->size());
+  return 0;
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -289,6 +447,9 @@ int main(int argc, const char *argv[]) {
     return -1;
   }
 
+  if (!RequestsPath.empty())
+    return runBatch(*Index);
+
   llvm::LineEditor LE("dexp");
 
   while (llvm::Optional<std::string> Request = LE.readLine()) {
@@ -10,18 +10,25 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "../../sharded-executor/ShardedExecution.h"
 #include "index/IndexAction.h"
 #include "index/Merge.h"
 #include "index/Ref.h"
 #include "index/Serialization.h"
 #include "index/Symbol.h"
 #include "index/SymbolCollector.h"
+#include "index/dex/Dex.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Execution.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include <atomic>
+#include <mutex>
 
 namespace clang {
 namespace clangd {
@@ -35,6 +42,96 @@ static llvm::cl::opt<IndexFileFormat>
                                        "binary RIFF format")),
            llvm::cl::init(IndexFileFormat::RIFF));
 
+static llvm::cl::opt<bool> CompressStrings(
+    "compress-strings",
+    llvm::cl::desc("Compress the string table of binary index files. "
+                   "Uncompressed indexes are bigger, but clangd can load them "
+                   "in place from a memory-mapped file"),
+    llvm::cl::init(true));
+
+static llvm::cl::opt<bool> DexPostings(
+    "dex-postings",
+    llvm::cl::desc("Write Dex posting lists to binary index files, so clangd "
+                   "doesn't need to build them when loading the index"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<std::string> MergeDir(
+    "merge-dir",
+    llvm::cl::desc("Merge the index files in this directory, e.g. written by "
+                   "runs over shards of the project with --executor=sharded, "
+                   "instead of indexing sources"),
+    llvm::cl::init(""));
+
+// Merges symbols, refs and relations from many sources, possibly concurrently.
+class IndexMerger {
+public:
+  void addSymbols(const SymbolSlab &S) {
+    for (const auto &Sym : S) {
+      Stripe &St = stripeFor(Sym.ID);
+      std::lock_guard<std::mutex> Lock(St.Mu);
+      if (const auto *Existing = St.Symbols.find(Sym.ID))
+        St.Symbols.insert(mergeSymbol(*Existing, Sym));
+      else
+        St.Symbols.insert(Sym);
+    }
+  }
+
+  void addRefs(const RefSlab &S) {
+    for (const auto &Sym : S) {
+      Stripe &St = stripeFor(Sym.first);
+      std::lock_guard<std::mutex> Lock(St.Mu);
+      // Deduplication happens during insertion.
+      for (const auto &Ref : Sym.second)
+        St.Refs.insert(Sym.first, Ref);
+    }
+  }
+
+  void addRelations(const RelationSlab &S) {
+    for (const auto &R : S) {
+      Stripe &St = stripeFor(R.Subject);
+      std::lock_guard<std::mutex> Lock(St.Mu);
+      // Deduplication happens when the slab is built.
+      St.Relations.insert(R);
+    }
+  }
+
+  void build(IndexFileIn &Result) {
+    // Stripes hold disjoint sets of symbols, so they can simply be combined.
+    SymbolSlab::Builder Symbols;
+    RefSlab::Builder Refs;
+    RelationSlab::Builder Relations;
+    for (Stripe &St : Stripes) {
+      for (const auto &Sym : std::move(St.Symbols).build())
+        Symbols.insert(Sym);
+      for (const auto &Sym : std::move(St.Refs).build())
+        for (const auto &Ref : Sym.second)
+          Refs.insert(Sym.first, Ref);
+      for (const auto &R : std::move(St.Relations).build())
+        Relations.insert(R);
+    }
+    Result.Symbols = std::move(Symbols).build();
+    Result.Refs = std::move(Refs).build();
+    Result.Relations = std::move(Relations).build();
+  }
+
+private:
+  // Results are partitioned by SymbolID, so that sources added concurrently
+  // rarely contend for the same lock.
+  struct Stripe {
+    std::mutex Mu;
+    SymbolSlab::Builder Symbols;
+    RefSlab::Builder Refs;
+    RelationSlab::Builder Relations;
+  };
+  static constexpr size_t NumStripes = 64;
+
+  Stripe &stripeFor(const SymbolID &ID) {
+    return Stripes[hash_value(ID) % NumStripes];
+  }
+
+  Stripe Stripes[NumStripes];
+};
+
 class IndexActionFactory : public tooling::FrontendActionFactory {
 public:
   IndexActionFactory(IndexFileIn &Result) : Result(Result) {}
@@ -43,42 +140,71 @@ public:
     SymbolCollector::Options Opts;
     return createStaticIndexingAction(
                Opts,
-               [&](SymbolSlab S) {
-                 // Merge as we go.
-                 std::lock_guard<std::mutex> Lock(SymbolsMu);
-                 for (const auto &Sym : S) {
-                   if (const auto *Existing = Symbols.find(Sym.ID))
-                     Symbols.insert(mergeSymbol(*Existing, Sym));
-                   else
-                     Symbols.insert(Sym);
-                 }
-               },
-               [&](RefSlab S) {
-                 std::lock_guard<std::mutex> Lock(SymbolsMu);
-                 for (const auto &Sym : S) {
-                   // Deduplication happens during insertion.
-                   for (const auto &Ref : Sym.second)
-                     Refs.insert(Sym.first, Ref);
-                 }
-               },
+               // Merge as we go.
+               [&](SymbolSlab S) { Merger.addSymbols(S); },
+               [&](RefSlab S) { Merger.addRefs(S); },
+               [&](RelationSlab S) { Merger.addRelations(S); },
                /*IncludeGraphCallback=*/nullptr)
         .release();
   }
 
   // Awkward: we write the result in the destructor, because the executor
   // takes ownership so it's the easiest way to get our data back out.
-  ~IndexActionFactory() {
-    Result.Symbols = std::move(Symbols).build();
-    Result.Refs = std::move(Refs).build();
-  }
+  ~IndexActionFactory() { Merger.build(Result); }
 
 private:
   IndexFileIn &Result;
-  std::mutex SymbolsMu;
-  SymbolSlab::Builder Symbols;
-  RefSlab::Builder Refs;
+  IndexMerger Merger;
 };
 
+// Merges the index files in \p Dir into \p Result. Files are read and merged
+// in parallel. Returns false if some of them couldn't be read.
+bool mergeIndexFiles(llvm::StringRef Dir, IndexFileIn &Result) {
+  IndexMerger Merger;
+  std::atomic<bool> Failed(false);
+  // Serializes the error messages of the threads.
+  std::mutex DiagMutex;
+  {
+    llvm::ThreadPool Pool;
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator It(Dir, EC), End;
+         It != End && !EC; It.increment(EC)) {
+      Pool.async(
+          [&](std::string Path) {
+            auto Buffer = llvm::MemoryBuffer::getFile(Path);
+            if (!Buffer) {
+              std::lock_guard<std::mutex> Lock(DiagMutex);
+              llvm::errs() << "Can't open " << Path << "\n";
+              Failed = true;
+              return;
+            }
+            auto Index = readIndexFile(Buffer.get()->getBuffer());
+            if (!Index) {
+              std::lock_guard<std::mutex> Lock(DiagMutex);
+              llvm::errs() << "Can't read " << Path << ": "
+                           << llvm::toString(Index.takeError()) << "\n";
+              Failed = true;
+              return;
+            }
+            if (Index->Symbols)
+              Merger.addSymbols(*Index->Symbols);
+            if (Index->Refs)
+              Merger.addRefs(*Index->Refs);
+            if (Index->Relations)
+              Merger.addRelations(*Index->Relations);
+          },
+          It->path());
+    }
+    if (EC) {
+      std::lock_guard<std::mutex> Lock(DiagMutex);
+      llvm::errs() << "Can't read " << Dir << ": " << EC.message() << "\n";
+      Failed = true;
+    }
+  }
+  Merger.build(Result);
+  return !Failed;
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -97,29 +223,55 @@ int main(int argc, const char **argv) {
 
   $ clangd-indexer File1.cpp File2.cpp ... FileN.cpp > clangd.dex
 
+  Example usage for a project indexed in 16 shards, each of them possibly on
+  another machine, and merged into one index:
+
+  $ clangd-indexer --executor=sharded --shard-index=0 --shard-count=16 \
+      compile_commands.json > shards/0.idx
+  ...
+  $ clangd-indexer --executor=sharded --shard-index=15 --shard-count=16 \
+      compile_commands.json > shards/15.idx
+  $ clangd-indexer --merge-dir=shards > clangd.dex
+
   Note: only symbols from header files will be indexed.
   )";
 
   auto Executor = clang::tooling::createExecutorFromCommandLineArgs(
       argc, argv, llvm::cl::GeneralCategory, Overview);
 
-  if (!Executor) {
-    llvm::errs() << llvm::toString(Executor.takeError()) << "\n";
-    return 1;
-  }
-
-  // Collect symbols found in each translation unit, merging as we go.
   clang::clangd::IndexFileIn Data;
-  auto Err = Executor->get()->execute(
-      llvm::make_unique<clang::clangd::IndexActionFactory>(Data),
-      clang::tooling::getStripPluginsAdjuster());
-  if (Err) {
-    llvm::errs() << llvm::toString(std::move(Err)) << "\n";
+  if (!clang::clangd::MergeDir.empty()) {
+    // Merging runs no tool, so it needs no compilation database.
+    if (!Executor)
+      llvm::consumeError(Executor.takeError());
+    if (!clang::clangd::mergeIndexFiles(clang::clangd::MergeDir, Data))
+      return 1;
+  } else {
+    if (!Executor) {
+      llvm::errs() << llvm::toString(Executor.takeError()) << "\n";
+      return 1;
+    }
+
+    // Collect symbols found in each translation unit, merging as we go.
+    auto Err = Executor->get()->execute(
+        llvm::make_unique<clang::clangd::IndexActionFactory>(Data),
+        clang::tooling::getStripPluginsAdjuster());
+    if (Err) {
+      llvm::errs() << llvm::toString(std::move(Err)) << "\n";
+    }
   }
 
   // Emit collected data.
   clang::clangd::IndexFileOut Out(Data);
   Out.Format = clang::clangd::Format;
+  Out.CompressStrings = clang::clangd::CompressStrings;
+  Out.Threads = 0;
+  clang::clangd::dex::Postings Postings;
+  if (clang::clangd::DexPostings && Data.Symbols) {
+    Postings = clang::clangd::dex::Dex(*Data.Symbols, clang::clangd::RefSlab())
+                   .postings();
+    Out.Postings = &Postings;
+  }
   llvm::outs() << Out;
   return 0;
 }
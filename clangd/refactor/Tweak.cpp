@@ -36,11 +36,37 @@ void validateRegistry() {
   }
 #endif
 }
+
+/// The kinds of the selected nodes: the common ancestor of the selection and
+/// its parents.
+std::vector<ast_type_traits::ASTNodeKind>
+selectedKinds(const Tweak::Selection &S) {
+  std::vector<ast_type_traits::ASTNodeKind> Kinds;
+  for (const SelectionTree::Node *N = S.ASTSelection->commonAncestor(); N;
+       N = N->Parent)
+    Kinds.push_back(N->ASTNode.getNodeKind());
+  return Kinds;
+}
+
+/// Whether \p T may apply to a selection of nodes of \p Selected kinds, i.e.
+/// whether it's worth calling prepare().
+bool mayApply(const Tweak &T,
+              llvm::ArrayRef<ast_type_traits::ASTNodeKind> Selected) {
+  auto Kinds = T.nodeKinds();
+  if (Kinds.empty())
+    return true;
+  return llvm::any_of(Kinds, [&](ast_type_traits::ASTNodeKind K) {
+    return llvm::any_of(Selected, [&](ast_type_traits::ASTNodeKind N) {
+      return K.isBaseOf(N);
+    });
+  });
+}
 } // namespace
 
 Tweak::Selection::Selection(ParsedAST &AST, unsigned RangeBegin,
                             unsigned RangeEnd)
-    : AST(AST), ASTSelection(AST.getASTContext(), RangeBegin, RangeEnd) {
+    : AST(AST), RangeBegin(RangeBegin), RangeEnd(RangeEnd),
+      ASTSelection(AST.getSelectionTree(RangeBegin, RangeEnd)) {
   auto &SM = AST.getASTContext().getSourceManager();
   Code = SM.getBufferData(SM.getMainFileID());
   Cursor = SM.getComposedLoc(SM.getMainFileID(), RangeBegin);
@@ -49,10 +75,11 @@ Tweak::Selection::Selection(ParsedAST &AST, unsigned RangeBegin,
 std::vector<std::unique_ptr<Tweak>> prepareTweaks(const Tweak::Selection &S) {
   validateRegistry();
 
+  auto Selected = selectedKinds(S);
   std::vector<std::unique_ptr<Tweak>> Available;
   for (const auto &E : TweakRegistry::entries()) {
     std::unique_ptr<Tweak> T = E.instantiate();
-    if (!T->prepare(S))
+    if (!mayApply(*T, Selected) || !T->prepare(S))
       continue;
     Available.push_back(std::move(T));
   }
@@ -63,6 +90,19 @@ std::vector<std::unique_ptr<Tweak>> prepareTweaks(const Tweak::Selection &S) {
   return Available;
 }
 
+std::vector<std::pair<std::string, std::string>>
+availableTweaks(const Tweak::Selection &S) {
+  auto &Cache = S.AST.cachedTweaks();
+  std::pair<unsigned, unsigned> Range(S.RangeBegin, S.RangeEnd);
+  if (!Cache || Cache->Range != Range) {
+    Cache.emplace();
+    Cache->Range = Range;
+    for (const auto &T : prepareTweaks(S))
+      Cache->Tweaks.emplace_back(T->id(), T->title());
+  }
+  return Cache->Tweaks;
+}
+
 llvm::Expected<std::unique_ptr<Tweak>> prepareTweak(StringRef ID,
                                                     const Tweak::Selection &S) {
   auto It = llvm::find_if(
@@ -72,7 +112,7 @@ llvm::Expected<std::unique_ptr<Tweak>> prepareTweak(StringRef ID,
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "id of the tweak is invalid");
   std::unique_ptr<Tweak> T = It->instantiate();
-  if (!T->prepare(S))
+  if (!mayApply(*T, selectedKinds(S)) || !T->prepare(S))
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "failed to prepare() a check");
   return std::move(T);
@@ -22,7 +22,9 @@
 #include "ClangdUnit.h"
 #include "Protocol.h"
 #include "Selection.h"
+#include "clang/AST/ASTTypeTraits.h"
 #include "clang/Tooling/Core/Replacement.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
 namespace clang {
@@ -47,8 +49,11 @@ public:
     ParsedAST &AST;
     /// A location of the cursor in the editor.
     SourceLocation Cursor;
+    /// The selected range, as offsets in the main file.
+    unsigned RangeBegin;
+    unsigned RangeEnd;
     // The AST nodes that were selected.
-    SelectionTree ASTSelection;
+    std::shared_ptr<const SelectionTree> ASTSelection;
     // FIXME: provide a way to get sources and ASTs for other files.
   };
   virtual ~Tweak() = default;
@@ -56,6 +61,13 @@ public:
   /// defining the Tweak. Definition is provided automatically by
   /// REGISTER_TWEAK.
   virtual const char *id() const = 0;
+  /// The kinds of AST nodes the action applies to, if it only applies inside
+  /// some nodes. prepare() is then only called when the common ancestor of the
+  /// selection or one of its parents is of one of these kinds, which saves
+  /// running it on most selections.
+  virtual llvm::ArrayRef<ast_type_traits::ASTNodeKind> nodeKinds() const {
+    return llvm::None;
+  }
   /// Run the first stage of the action. Returns true indicating that the
   /// action is available and should be shown to the user. Returns false if the
   /// action is not available.
@@ -82,6 +94,12 @@ public:
 /// selection.
 std::vector<std::unique_ptr<Tweak>> prepareTweaks(const Tweak::Selection &S);
 
+/// Returns the IDs and titles of the tweaks that can run on the selection, as
+/// prepareTweaks() would. The result for the last selected range is cached in
+/// the AST, so repeated requests for the same range don't prepare them again.
+std::vector<std::pair<std::string, std::string>>
+availableTweaks(const Tweak::Selection &S);
+
 // Calls prepare() on the tweak with a given ID.
 // If prepare() returns false, returns an error.
 // If prepare() returns true, returns the corresponding tweak.
@@ -36,6 +36,11 @@ class SwapIfBranches : public Tweak {
 public:
   const char *id() const override final;
 
+  llvm::ArrayRef<ast_type_traits::ASTNodeKind> nodeKinds() const override {
+    static const ast_type_traits::ASTNodeKind Kinds[] = {
+        ast_type_traits::ASTNodeKind::getFromNodeKind<IfStmt>()};
+    return Kinds;
+  }
   bool prepare(const Selection &Inputs) override;
   Expected<tooling::Replacements> apply(const Selection &Inputs) override;
   std::string title() const override;
@@ -47,7 +52,7 @@ private:
 REGISTER_TWEAK(SwapIfBranches)
 
 bool SwapIfBranches::prepare(const Selection &Inputs) {
-  for (const SelectionTree::Node *N = Inputs.ASTSelection.commonAncestor();
+  for (const SelectionTree::Node *N = Inputs.ASTSelection->commonAncestor();
        N && !If; N = N->Parent) {
     // Stop once we hit a block, e.g. a lambda in the if condition.
     if (dyn_cast_or_null<CompoundStmt>(N->ASTNode.get<Stmt>()))
@@ -0,0 +1,414 @@
+//===--- ReplayMain.cpp - Replay recorded LSP sessions ----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// clangd-replay feeds a session recorded with `clangd -input-mirror-file` into
+// an in-process ClangdLSPServer, and reports the latency of each kind of
+// request, along with the CPU time and peak memory used by the replay.
+//
+// Recordings made with -input-mirror-timestamps are replayed with their
+// original timing, or faster (see -speed). Others are replayed with no delays.
+// Files the session refers to must exist at the recorded paths.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ClangdLSPServer.h"
+#include "FSProvider.h"
+#include "Logger.h"
+#include "Transport.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#ifdef LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace clang {
+namespace clangd {
+namespace {
+
+llvm::cl::opt<std::string> RecordingPath(llvm::cl::Positional,
+                                         llvm::cl::desc("<recording>"),
+                                         llvm::cl::Required);
+
+llvm::cl::opt<JSONStreamStyle> InputStyle(
+    "input-style", llvm::cl::desc("JSON stream encoding of the recording"),
+    llvm::cl::values(
+        clEnumValN(JSONStreamStyle::Standard, "standard", "usual LSP protocol"),
+        clEnumValN(JSONStreamStyle::Delimited, "delimited",
+                   "messages delimited by --- lines, with # comment support")),
+    llvm::cl::init(JSONStreamStyle::Standard));
+
+llvm::cl::opt<double>
+    Speed("speed",
+          llvm::cl::desc("Replay the session this many times faster than it "
+                         "was recorded. 0 sends each message as soon as the "
+                         "previous one was handled. Recordings without "
+                         "timestamps are always replayed with no delays."),
+          llvm::cl::init(1));
+
+llvm::cl::opt<std::string> CompileCommandsDir(
+    "compile-commands-dir",
+    llvm::cl::desc("Directory to look for compile_commands.json in, as for "
+                   "clangd."));
+
+llvm::cl::opt<unsigned>
+    WorkerThreadsCount("j",
+                       llvm::cl::desc("Number of async workers used by clangd"),
+                       llvm::cl::init(getDefaultAsyncThreadsCount()));
+
+llvm::cl::opt<bool> EnableBackgroundIndex(
+    "background-index",
+    llvm::cl::desc("Index the project in the background, as clangd "
+                   "-background-index does."),
+    llvm::cl::init(false));
+
+llvm::cl::opt<std::string> JSONReportPath(
+    "json-report",
+    llvm::cl::desc("Also write the report as JSON to this file, for comparing "
+                   "replays with each other."));
+
+llvm::cl::opt<Logger::Level> LogLevel(
+    "log", llvm::cl::desc("Verbosity of clangd's log messages"),
+    llvm::cl::values(clEnumValN(Logger::Error, "error", "Error messages only"),
+                     clEnumValN(Logger::Info, "info",
+                                "High level execution tracing"),
+                     clEnumValN(Logger::Debug, "verbose", "Low level details")),
+    llvm::cl::init(Logger::Error));
+
+struct RecordedMessage {
+  // When the message was received, relative to the start of the session.
+  llvm::Optional<std::chrono::milliseconds> Time;
+  std::string JSON;
+};
+
+// Parses a "time-ms: N" comment, as written by JSONTransport.
+void parseTimestamp(llvm::StringRef Comment,
+                    llvm::Optional<std::chrono::milliseconds> &Time) {
+  unsigned long long Ms;
+  Comment = Comment.trim();
+  if (Comment.consume_front("time-ms:") &&
+      !llvm::getAsUnsignedInteger(Comment.trim(), 10, Ms))
+    Time = std::chrono::milliseconds(Ms);
+}
+
+// Splits a recording into its messages, the way JSONTransport reads them.
+llvm::Expected<std::vector<RecordedMessage>>
+readRecording(llvm::StringRef Data, JSONStreamStyle Style) {
+  std::vector<RecordedMessage> Messages;
+  RecordedMessage Message;
+  unsigned long long ContentLength = 0;
+  while (!Data.empty()) {
+    llvm::StringRef RawLine;
+    std::tie(RawLine, Data) = Data.split('\n');
+    llvm::StringRef Line = RawLine.trim();
+    if (Line.consume_front("#")) {
+      // A timestamp applies to the message that follows it.
+      if (Message.JSON.empty())
+        parseTimestamp(Line, Message.Time);
+      continue;
+    }
+
+    if (Style == JSONStreamStyle::Delimited) {
+      if (Line == "---") {
+        if (!llvm::StringRef(Message.JSON).trim().empty())
+          Messages.push_back(std::move(Message));
+        Message = RecordedMessage();
+      } else {
+        Message.JSON += RawLine;
+        Message.JSON += '\n';
+      }
+      continue;
+    }
+
+    if (Line.consume_front("Content-Length:")) {
+      llvm::getAsUnsignedInteger(Line.trim(), 0, ContentLength);
+      continue;
+    }
+    if (!Line.empty()) // Another header, ignore it.
+      continue;
+    // An empty line ends the headers.
+    if (ContentLength == 0)
+      continue;
+    if (ContentLength > Data.size())
+      return llvm::make_error<llvm::StringError>(
+          llvm::formatv("recording ends in the middle of a message: expected "
+                        "{0} bytes, found {1}",
+                        ContentLength, Data.size())
+              .str(),
+          llvm::inconvertibleErrorCode());
+    Message.JSON = Data.take_front(ContentLength).str();
+    Data = Data.drop_front(ContentLength);
+    Messages.push_back(std::move(Message));
+    Message = RecordedMessage();
+    ContentLength = 0;
+  }
+  if (!llvm::StringRef(Message.JSON).trim().empty())
+    Messages.push_back(std::move(Message));
+  return std::move(Messages);
+}
+
+struct MethodStats {
+  std::vector<double> LatenciesMs;
+  unsigned Errors = 0;
+};
+
+// Sends the recorded messages to clangd, and measures how long each request
+// takes to be answered. Everything clangd sends other than replies is dropped.
+class ReplayTransport : public Transport {
+public:
+  ReplayTransport(std::vector<RecordedMessage> Messages, double Speed)
+      : Messages(std::move(Messages)), Speed(Speed) {}
+
+  void notify(llvm::StringRef Method, llvm::json::Value Params) override {}
+  void call(llvm::StringRef Method, llvm::json::Value Params,
+            llvm::json::Value ID) override {}
+  void reply(llvm::json::Value ID,
+             llvm::Expected<llvm::json::Value> Result) override {
+    bool Failed = !Result;
+    if (!Result)
+      llvm::consumeError(Result.takeError());
+    recordReply(ID, Failed);
+  }
+  // Replies don't need to be parsed to be timed.
+  void notifyRaw(llvm::StringRef Method, llvm::StringRef Params) override {}
+  void replyRaw(llvm::json::Value ID, llvm::StringRef Result) override {
+    recordReply(ID, /*Failed=*/false);
+  }
+
+  llvm::Error loop(MessageHandler &Handler) override {
+    auto Start = std::chrono::steady_clock::now();
+    for (const RecordedMessage &Message : Messages) {
+      if (Message.Time && Speed > 0)
+        std::this_thread::sleep_until(
+            Start +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(
+                    Message.Time->count() / Speed)));
+
+      auto Doc = llvm::json::parse(Message.JSON);
+      if (!Doc) {
+        elog("Skipping recorded message that isn't JSON: {0}",
+             Doc.takeError());
+        continue;
+      }
+      auto *Object = Doc->getAsObject();
+      auto Method = Object ? Object->getString("method") : llvm::None;
+      // Replies of the client answer calls this replay never made.
+      if (!Method)
+        continue;
+      llvm::json::Value Params = nullptr;
+      if (auto *P = Object->get("params"))
+        Params = std::move(*P);
+
+      // Measure the session until it ends, not just until clangd exits.
+      if (*Method == "exit")
+        waitForReplies();
+      if (auto *ID = Object->get("id")) {
+        {
+          std::lock_guard<std::mutex> Lock(Mu);
+          Pending[key(*ID)] = {*Method, std::chrono::steady_clock::now()};
+        }
+        if (!Handler.onCall(*Method, std::move(Params), std::move(*ID)))
+          return llvm::Error::success();
+      } else if (!Handler.onNotify(*Method, std::move(Params))) {
+        return llvm::Error::success();
+      }
+    }
+    waitForReplies();
+    return llvm::Error::success();
+  }
+
+  const llvm::StringMap<MethodStats> &stats() const { return Stats; }
+
+private:
+  struct PendingRequest {
+    std::string Method;
+    std::chrono::steady_clock::time_point Sent;
+  };
+
+  static std::string key(const llvm::json::Value &ID) {
+    return llvm::formatv("{0}", ID).str();
+  }
+
+  void recordReply(const llvm::json::Value &ID, bool Failed) {
+    auto Now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = Pending.find(key(ID));
+    if (It == Pending.end())
+      return;
+    MethodStats &S = Stats[It->second.Method];
+    S.LatenciesMs.push_back(
+        std::chrono::duration<double, std::milli>(Now - It->second.Sent)
+            .count());
+    if (Failed)
+      ++S.Errors;
+    Pending.erase(It);
+    if (Pending.empty())
+      RepliesDone.notify_all();
+  }
+
+  void waitForReplies() {
+    std::unique_lock<std::mutex> Lock(Mu);
+    RepliesDone.wait(Lock, [&] { return Pending.empty(); });
+  }
+
+  std::vector<RecordedMessage> Messages;
+  double Speed;
+  std::mutex Mu;
+  std::condition_variable RepliesDone;
+  llvm::StringMap<PendingRequest> Pending; // Keyed by request ID.
+  llvm::StringMap<MethodStats> Stats;      // Keyed by method.
+};
+
+// Returns the peak resident set size of this process, if the platform reports
+// it.
+llvm::Optional<uint64_t> getPeakRSS() {
+#ifdef LLVM_ON_UNIX
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) == 0)
+#ifdef __APPLE__
+    return uint64_t(Usage.ru_maxrss); // In bytes.
+#else
+    return uint64_t(Usage.ru_maxrss) * 1024; // In kilobytes.
+#endif
+#endif
+  return llvm::None;
+}
+
+llvm::json::Object reportMethod(llvm::StringRef Method, MethodStats S) {
+  llvm::sort(S.LatenciesMs);
+  auto Percentile = [&](double P) {
+    return S.LatenciesMs[std::min(S.LatenciesMs.size() - 1,
+                                  size_t(P * S.LatenciesMs.size()))];
+  };
+  double Total = 0;
+  for (double L : S.LatenciesMs)
+    Total += L;
+  llvm::outs() << llvm::formatv(
+      "{0}: {1} requests ({2} failed), mean {3:f3}ms, p50 {4:f3}ms, "
+      "p90 {5:f3}ms, max {6:f3}ms\n",
+      Method, S.LatenciesMs.size(), S.Errors, Total / S.LatenciesMs.size(),
+      Percentile(0.5), Percentile(0.9), S.LatenciesMs.back());
+  return llvm::json::Object{
+      {"count", int64_t(S.LatenciesMs.size())},
+      {"errors", int64_t(S.Errors)},
+      {"mean_ms", Total / S.LatenciesMs.size()},
+      {"p50_ms", Percentile(0.5)},
+      {"p90_ms", Percentile(0.9)},
+      {"max_ms", S.LatenciesMs.back()},
+  };
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
+
+int main(int argc, const char *argv[]) {
+  using namespace clang::clangd;
+  llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
+  llvm::cl::ParseCommandLineOptions(
+      argc, argv,
+      "Replays an LSP session recorded with clangd -input-mirror-file, and "
+      "reports how long clangd took to answer each kind of request.\n");
+
+  auto Buffer = llvm::MemoryBuffer::getFile(RecordingPath);
+  if (!Buffer) {
+    llvm::errs() << "Error while reading " << RecordingPath << ": "
+                 << Buffer.getError().message() << '\n';
+    return 1;
+  }
+  auto Messages = readRecording((*Buffer)->getBuffer(), InputStyle);
+  if (!Messages) {
+    llvm::errs() << "Error while reading " << RecordingPath << ": "
+                 << llvm::toString(Messages.takeError()) << '\n';
+    return 1;
+  }
+  size_t MessageCount = Messages->size();
+
+  llvm::errs().SetBuffered();
+  StreamLogger Logger(llvm::errs(), LogLevel);
+  LoggingSession LoggingSession(Logger);
+
+  llvm::Optional<Path> CompileCommandsDirPath;
+  if (!CompileCommandsDir.empty()) {
+    llvm::SmallString<128> Path(CompileCommandsDir);
+    llvm::sys::fs::make_absolute(Path);
+    CompileCommandsDirPath = Path.str();
+  }
+  ClangdServer::Options Opts;
+  Opts.AsyncThreadsCount = WorkerThreadsCount;
+  Opts.BuildDynamicSymbolIndex = true;
+  Opts.BackgroundIndex = EnableBackgroundIndex;
+
+  ReplayTransport Transport(std::move(*Messages), Speed);
+  RealFileSystemProvider FSProvider;
+  llvm::sys::TimePoint<> Elapsed;
+  std::chrono::nanoseconds UserStart, SystemStart, UserEnd, SystemEnd;
+  llvm::sys::Process::GetTimeUsage(Elapsed, UserStart, SystemStart);
+  auto Start = std::chrono::steady_clock::now();
+  {
+    ClangdLSPServer LSPServer(Transport, FSProvider, CodeCompleteOptions(),
+                              CompileCommandsDirPath, /*UseDirBasedCDB=*/true,
+                              /*ForcedOffsetEncoding=*/llvm::None, Opts);
+    LSPServer.run();
+  }
+  std::chrono::duration<double, std::milli> WallMs =
+      std::chrono::steady_clock::now() - Start;
+  llvm::sys::Process::GetTimeUsage(Elapsed, UserEnd, SystemEnd);
+  std::chrono::duration<double, std::milli> UserMs = UserEnd - UserStart;
+  std::chrono::duration<double, std::milli> SystemMs = SystemEnd - SystemStart;
+  auto PeakRSS = getPeakRSS();
+
+  llvm::outs() << llvm::formatv("Replayed {0} messages in {1:f0}ms, using "
+                                "{2:f0}ms of user and {3:f0}ms of system CPU "
+                                "time.\n",
+                                MessageCount, WallMs.count(), UserMs.count(),
+                                SystemMs.count());
+  if (PeakRSS)
+    llvm::outs() << llvm::formatv("Peak RSS: {0} bytes\n", *PeakRSS);
+  std::vector<llvm::StringRef> MethodNames;
+  for (const auto &Entry : Transport.stats())
+    MethodNames.push_back(Entry.first());
+  llvm::sort(MethodNames);
+  llvm::json::Object Methods;
+  for (llvm::StringRef Method : MethodNames)
+    Methods[Method] = reportMethod(Method, Transport.stats().lookup(Method));
+
+  if (!JSONReportPath.empty()) {
+    llvm::json::Object Report{
+        {"messages", int64_t(MessageCount)},
+        {"wall_ms", WallMs.count()},
+        {"user_cpu_ms", UserMs.count()},
+        {"system_cpu_ms", SystemMs.count()},
+        {"requests", std::move(Methods)},
+    };
+    if (PeakRSS)
+      Report["peak_rss_bytes"] = int64_t(*PeakRSS);
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(JSONReportPath, EC, llvm::sys::fs::F_Text);
+    if (EC) {
+      llvm::errs() << "Error while writing " << JSONReportPath << ": "
+                   << EC.message() << '\n';
+      return 1;
+    }
+    OS << llvm::formatv("{0:2}", llvm::json::Value(std::move(Report))) << '\n';
+  }
+  return 0;
+}
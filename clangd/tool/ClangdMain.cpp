@@ -10,13 +10,16 @@
 #include "ClangdLSPServer.h"
 #include "Path.h"
 #include "Protocol.h"
+#include "ResourceUsage.h"
 #include "Trace.h"
 #include "Transport.h"
 #include "index/Serialization.h"
 #include "clang/Basic/Version.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
@@ -27,6 +30,22 @@
 #include <string>
 #include <thread>
 
+#if CLANGD_COUNT_ALLOCATIONS
+// Counts the allocations of each thread, for resource accounting.
+void *operator new(std::size_t Size) {
+  clang::clangd::countAllocation(Size);
+  void *Result = std::malloc(Size ? Size : 1);
+  if (!Result)
+    llvm::report_bad_alloc_error("Allocation failed");
+  return Result;
+}
+void *operator new[](std::size_t Size) { return ::operator new(Size); }
+void operator delete(void *Ptr) noexcept { std::free(Ptr); }
+void operator delete[](void *Ptr) noexcept { std::free(Ptr); }
+void operator delete(void *Ptr, std::size_t) noexcept { std::free(Ptr); }
+void operator delete[](void *Ptr, std::size_t) noexcept { std::free(Ptr); }
+#endif
+
 namespace clang {
 namespace clangd {
 // FIXME: remove this option when Dex is cheap enough.
@@ -133,6 +152,22 @@ static llvm::cl::opt<Path> InputMirrorFile(
         "Mirror all LSP input to the specified file. Useful for debugging."),
     llvm::cl::init(""), llvm::cl::Hidden);
 
+static llvm::cl::opt<bool> InputMirrorTimestamps(
+    "input-mirror-timestamps",
+    llvm::cl::desc("Record when each message was received in the input "
+                   "mirror file, so that clangd-replay can reproduce the "
+                   "timing of the session."),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
+static llvm::cl::opt<bool> ResourceAccounting(
+    "resource-accounting",
+    llvm::cl::desc("Record the time each request waited in queue and ran, its "
+                   "CPU time, its allocations (if clangd was built with "
+                   "CLANGD_COUNT_ALLOCATIONS) and the time it was blocked on "
+                   "index locks, in the trace (CLANGD_TRACE) and the metrics "
+                   "(CLANGD_METRICS)."),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
 static llvm::cl::opt<bool> EnableIndex(
     "index",
     llvm::cl::desc(
@@ -150,6 +185,14 @@ static llvm::cl::opt<bool> AllScopesCompletion(
         "can insert scope qualifiers."),
     llvm::cl::init(true));
 
+static llvm::cl::opt<bool> IndexResultsFirst(
+    "index-results-first",
+    llvm::cl::desc(
+        "Answer code completion from the index before Sema completion "
+        "finishes, when the scopes of the last completion in the file apply. "
+        "Sema results are merged in when the client asks again."),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
 static llvm::cl::opt<bool> ShowOrigins(
     "debug-origin", llvm::cl::desc("Show origins of completion items"),
     llvm::cl::init(CodeCompleteOptions().ShowOrigins), llvm::cl::Hidden);
@@ -177,6 +220,51 @@ static llvm::cl::opt<bool> EnableBackgroundIndex(
         "Experimental"),
     llvm::cl::init(false), llvm::cl::Hidden);
 
+static llvm::cl::opt<bool> PackedBackgroundIndex(
+    "background-index-packed",
+    llvm::cl::desc("Store the background index of each project in a few pack "
+                   "files instead of one file per source file. Faster to load "
+                   "on slow file systems, but the index directory must not be "
+                   "shared by concurrent clangd instances. Experimental"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
+static llvm::cl::opt<int> BackgroundIndexColdRefsDistance(
+    "background-index-cold-refs-distance",
+    llvm::cl::desc("Keep the refs of background-indexed files further than "
+                   "this from recently opened files on disk only, and load "
+                   "them when requested. Each directory up costs 2, each "
+                   "directory or file down costs 1. -1 keeps all refs in "
+                   "memory. Experimental"),
+    llvm::cl::init(-1), llvm::cl::Hidden);
+
+static llvm::cl::opt<bool> PersistDynamicIndex(
+    "persist-dynamic-index",
+    llvm::cl::desc("Save the index of open files along the background index, "
+                   "and serve it when the files are opened again, until they "
+                   "are parsed. Experimental"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
+static llvm::cl::opt<bool> PrebuildPreambles(
+    "prebuild-preambles",
+    llvm::cl::desc("Build preambles of files that are likely to be opened "
+                   "next (go-to-definition targets, matching headers/sources) "
+                   "on idle threads. Experimental"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
+static llvm::cl::opt<bool> WatchedFilesForPreambles(
+    "watched-files-for-preambles",
+    llvm::cl::desc("Rely on the client to report changes to the headers of "
+                   "preambles (workspace/didChangeWatchedFiles), instead of "
+                   "checking them on every edit. Experimental"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
+static llvm::cl::opt<unsigned> IndexResultCacheMB(
+    "index-result-cache-mb",
+    llvm::cl::desc("Cache the results of repeated index queries (e.g. "
+                   "retriggered completions) until the index changes, using "
+                   "at most this many megabytes. Experimental"),
+    llvm::cl::init(0), llvm::cl::Hidden);
+
 static llvm::cl::opt<int> BackgroundIndexRebuildPeriod(
     "background-index-rebuild-period",
     llvm::cl::desc(
@@ -231,6 +319,12 @@ static llvm::cl::opt<OffsetEncoding> ForceOffsetEncoding(
                                 "Offsets are in UTF-16 code units")),
     llvm::cl::init(OffsetEncoding::UnsupportedEncoding));
 
+static llvm::cl::opt<std::string> ConvertBinaryTrace(
+    "convert-binary-trace",
+    llvm::cl::desc("Print a trace recorded with CLANGD_TRACE_FORMAT=binary "
+                   "as JSON, and exit."),
+    llvm::cl::init(""), llvm::cl::Hidden);
+
 namespace {
 
 /// \brief Supports a test URI scheme with relaxed constraints for lit tests.
@@ -304,6 +398,20 @@ int main(int argc, char *argv[]) {
       "For more information, see:"
       "\n\thttps://clang.llvm.org/extra/clangd.html"
       "\n\thttps://microsoft.github.io/language-server-protocol/");
+  if (!ConvertBinaryTrace.empty()) {
+    auto Buffer = llvm::MemoryBuffer::getFile(ConvertBinaryTrace);
+    if (!Buffer) {
+      llvm::errs() << "Error while opening trace file " << ConvertBinaryTrace
+                   << ": " << Buffer.getError().message() << "\n";
+      return 1;
+    }
+    if (auto Err = trace::binaryTraceToJSON((*Buffer)->getBuffer(),
+                                            llvm::outs())) {
+      llvm::errs() << llvm::toString(std::move(Err)) << "\n";
+      return 1;
+    }
+    return 0;
+  }
   if (Test) {
     RunSynchronously = true;
     InputStyle = JSONStreamStyle::Delimited;
@@ -345,8 +453,10 @@ int main(int argc, char *argv[]) {
   // Setup tracing facilities if CLANGD_TRACE is set. In practice enabling a
   // trace flag in your editor's config is annoying, launching with
   // `CLANGD_TRACE=trace.json vim` is easier.
+  // CLANGD_TRACE_FORMAT=binary selects the cheaper binary tracer, and
+  // CLANGD_TRACE_SAMPLE=N only traces one in N requests.
   llvm::Optional<llvm::raw_fd_ostream> TraceStream;
-  std::unique_ptr<trace::EventTracer> Tracer;
+  std::unique_ptr<trace::EventTracer> Tracer, SamplingTracer;
   if (auto *TraceFile = getenv("CLANGD_TRACE")) {
     std::error_code EC;
     TraceStream.emplace(TraceFile, /*ref*/ EC,
@@ -356,13 +466,45 @@ int main(int argc, char *argv[]) {
       llvm::errs() << "Error while opening trace file " << TraceFile << ": "
                    << EC.message();
     } else {
-      Tracer = trace::createJSONTracer(*TraceStream, PrettyPrint);
+      const char *Format = getenv("CLANGD_TRACE_FORMAT");
+      if (Format && llvm::StringRef(Format) == "binary")
+        Tracer = trace::createBinaryTracer(*TraceStream);
+      else
+        Tracer = trace::createJSONTracer(*TraceStream, PrettyPrint);
+      unsigned SampleRate = 0;
+      const char *Sample = getenv("CLANGD_TRACE_SAMPLE");
+      if (Sample && !llvm::StringRef(Sample).getAsInteger(10, SampleRate) &&
+          SampleRate > 1)
+        SamplingTracer = trace::createSamplingTracer(*Tracer, SampleRate);
+    }
+  }
+
+  trace::EventTracer *ActiveTracer =
+      SamplingTracer ? SamplingTracer.get() : Tracer.get();
+
+  // CLANGD_METRICS=metrics.json appends a snapshot of clangd's metrics (e.g.
+  // request latencies) to the file every minute.
+  llvm::Optional<llvm::raw_fd_ostream> MetricsStream;
+  std::unique_ptr<trace::EventTracer> MetricsTracer;
+  if (auto *MetricsFile = getenv("CLANGD_METRICS")) {
+    std::error_code EC;
+    MetricsStream.emplace(MetricsFile, /*ref*/ EC, llvm::sys::fs::F_Append);
+    if (EC) {
+      MetricsStream.reset();
+      llvm::errs() << "Error while opening metrics file " << MetricsFile
+                   << ": " << EC.message();
+    } else {
+      MetricsTracer = trace::createMetricsTracer(
+          *MetricsStream, std::chrono::minutes(1), ActiveTracer);
+      ActiveTracer = MetricsTracer.get();
     }
   }
 
   llvm::Optional<trace::Session> TracingSession;
-  if (Tracer)
-    TracingSession.emplace(*Tracer);
+  if (ActiveTracer)
+    TracingSession.emplace(*ActiveTracer);
+  if (ResourceAccounting)
+    enableResourceAccounting();
 
   // Use buffered stream to stderr (we still flush each log message). Unbuffered
   // stream can cause significant (non-deterministic) latency for the logger.
@@ -409,6 +551,13 @@ int main(int argc, char *argv[]) {
   Opts.HeavyweightDynamicSymbolIndex = UseDex;
   Opts.BackgroundIndex = EnableBackgroundIndex;
   Opts.BackgroundIndexRebuildPeriodMs = BackgroundIndexRebuildPeriod;
+  Opts.PackedBackgroundIndexStorage = PackedBackgroundIndex;
+  if (BackgroundIndexColdRefsDistance >= 0)
+    Opts.BackgroundIndexColdRefsDistance = BackgroundIndexColdRefsDistance;
+  Opts.PersistDynamicIndex = PersistDynamicIndex;
+  Opts.PrebuildPreambles = PrebuildPreambles;
+  Opts.WatchedFilesForPreambles = WatchedFilesForPreambles;
+  Opts.IndexResultCacheBytes = size_t(IndexResultCacheMB) << 20;
   std::unique_ptr<SymbolIndex> StaticIdx;
   std::future<void> AsyncIndexLoad; // Block exit while loading the index.
   if (EnableIndex && !IndexFile.empty()) {
@@ -435,8 +584,10 @@ int main(int argc, char *argv[]) {
     CCOpts.IncludeIndicator.NoInsert.clear();
   }
   CCOpts.SpeculativeIndexRequest = Opts.StaticIndex;
+  CCOpts.ReuseIndexResults = true;
   CCOpts.EnableFunctionArgSnippets = EnableFunctionArgSnippets;
   CCOpts.AllScopes = AllScopesCompletion;
+  CCOpts.IndexResultsFirst = IndexResultsFirst;
 
   RealFileSystemProvider FSProvider;
   // Initialize and run ClangdLSPServer.
@@ -455,7 +606,7 @@ int main(int argc, char *argv[]) {
     TransportLayer = newJSONTransport(
         stdin, llvm::outs(),
         InputMirrorStream ? InputMirrorStream.getPointer() : nullptr,
-        PrettyPrint, InputStyle);
+        PrettyPrint, InputStyle, InputMirrorTimestamps);
   }
 
   // Create an empty clang-tidy option.
@@ -17,23 +17,62 @@ using namespace llvm;
 namespace clang {
 namespace clangd {
 
+static const char *const PayloadKey = "LSP";
+
 xpc_object_t jsonToXpc(const json::Value &JSON) {
-  const char *const Key = "LSP";
-  xpc_object_t PayloadObj = xpc_string_create(llvm::to_string(JSON).c_str());
-  return xpc_dictionary_create(&Key, &PayloadObj, 1);
+  return serializedJsonToXpc(llvm::to_string(JSON), /*AsData=*/false);
+}
+
+xpc_object_t serializedJsonToXpc(std::string JSON, bool AsData) {
+  xpc_object_t PayloadObj;
+  if (AsData) {
+    // The dispatch data takes ownership of the buffer, and frees it once XPC
+    // is done with it.
+    std::string *Buffer = new std::string(std::move(JSON));
+    dispatch_data_t Data =
+        dispatch_data_create(Buffer->data(), Buffer->size(), nullptr, ^{
+          delete Buffer;
+        });
+    PayloadObj = xpc_data_create_with_dispatch_data(Data);
+    dispatch_release(Data);
+  } else {
+    PayloadObj = xpc_string_create(JSON.c_str());
+  }
+  xpc_object_t Result = xpc_dictionary_create(&PayloadKey, &PayloadObj, 1);
+  xpc_release(PayloadObj);
+  return Result;
 }
 
 json::Value xpcToJson(const xpc_object_t &XPCObject) {
-  if (xpc_get_type(XPCObject) == XPC_TYPE_DICTIONARY) {
-    const char *const LSP = xpc_dictionary_get_string(XPCObject, "LSP");
-    auto Json = json::parse(llvm::StringRef(LSP));
-    if (Json)
-      return *Json;
-    else
-      elog("JSON parse error: {0}", toString(Json.takeError()));
+  if (xpc_get_type(XPCObject) != XPC_TYPE_DICTIONARY)
+    return json::Value(nullptr);
+  // Both kinds of payload are parsed in place.
+  StringRef Payload;
+  xpc_object_t PayloadObj = xpc_dictionary_get_value(XPCObject, PayloadKey);
+  if (PayloadObj && xpc_get_type(PayloadObj) == XPC_TYPE_STRING)
+    Payload = StringRef(xpc_string_get_string_ptr(PayloadObj),
+                        xpc_string_get_length(PayloadObj));
+  else if (PayloadObj && xpc_get_type(PayloadObj) == XPC_TYPE_DATA)
+    Payload = StringRef(
+        static_cast<const char *>(xpc_data_get_bytes_ptr(PayloadObj)),
+        xpc_data_get_length(PayloadObj));
+  else {
+    elog("XPC message has no {0} payload", PayloadKey);
+    return json::Value(nullptr);
   }
+  auto Json = json::parse(Payload);
+  if (Json)
+    return std::move(*Json);
+  elog("JSON parse error: {0}", toString(Json.takeError()));
   return json::Value(nullptr);
 }
 
+bool isXpcDataPayload(const xpc_object_t &XPCObject) {
+  if (xpc_get_type(XPCObject) != XPC_TYPE_DICTIONARY)
+    return false;
+  xpc_object_t PayloadObj = xpc_dictionary_get_value(XPCObject, PayloadKey);
+  return PayloadObj && xpc_get_type(PayloadObj) == XPC_TYPE_DATA;
+}
+
 } // namespace clangd
 } // namespace clang
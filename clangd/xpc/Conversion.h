@@ -10,13 +10,24 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_XPC_XPCJSONCONVERSIONS_H
 
 #include "llvm/Support/JSON.h"
+#include <string>
 #include <xpc/xpc.h>
 
 namespace clang {
 namespace clangd {
 
+// Messages are dictionaries with the serialized JSON under the "LSP" key,
+// either as a string or as data. Large data objects are passed to the peer by
+// mapping their pages rather than copying them, so clients sending big
+// payloads (e.g. didOpen of generated files) should prefer data.
+
 xpc_object_t jsonToXpc(const llvm::json::Value &JSON);
+// Wraps already-serialized JSON. As data, the buffer is handed to XPC without
+// a copy.
+xpc_object_t serializedJsonToXpc(std::string JSON, bool AsData);
 llvm::json::Value xpcToJson(const xpc_object_t &XPCObject);
+// Whether the payload of a message is sent as data rather than a string.
+bool isXpcDataPayload(const xpc_object_t &XPCObject);
 
 } // namespace clangd
 } // namespace clang
@@ -10,7 +10,9 @@
 #include "Protocol.h" // For LSPError
 #include "Transport.h"
 #include "llvm/Support/Errno.h"
+#include "llvm/Support/ScopedPrinter.h"
 
+#include <atomic>
 #include <xpc/xpc.h>
 
 using namespace llvm;
@@ -83,6 +85,24 @@ public:
     }
   }
 
+  // The serialized payload is spliced into the message, never parsed.
+  void notifyRaw(StringRef Method, StringRef Params) override {
+    sendMessage(
+        json::Object{
+            {"jsonrpc", "2.0"},
+            {"method", Method},
+        },
+        "params", Params);
+  }
+  void replyRaw(json::Value ID, StringRef Result) override {
+    sendMessage(
+        json::Object{
+            {"jsonrpc", "2.0"},
+            {"id", std::move(ID)},
+        },
+        "result", Result);
+  }
+
   Error loop(MessageHandler &Handler) override;
 
 private:
@@ -92,7 +112,25 @@ private:
   // Dispatches incoming message to Handler onNotify/onCall/onReply.
   bool handleMessage(json::Value Message, MessageHandler &Handler);
   void sendMessage(json::Value Message) {
-    xpc_object_t response = jsonToXpc(Message);
+    sendSerialized(llvm::to_string(Message));
+  }
+  // Sends Envelope, with Payload (serialized JSON) added under Key.
+  // Object keys are printed in sorted order, and Key must sort last.
+  void sendMessage(json::Object Envelope, StringRef Key, StringRef Payload) {
+    std::string Message = llvm::to_string(json::Value(std::move(Envelope)));
+    assert(!Message.empty() && Message.back() == '}');
+    Message.pop_back();
+    Message.reserve(Message.size() + Key.size() + Payload.size() + 5);
+    Message += ",\"";
+    Message += Key;
+    Message += "\":";
+    Message += Payload;
+    Message += '}';
+    sendSerialized(std::move(Message));
+  }
+  void sendSerialized(std::string Message) {
+    xpc_object_t response =
+        serializedJsonToXpc(std::move(Message), ClientSendsData);
     xpc_connection_send_message(clientConnection, response);
     xpc_release(response);
   }
@@ -100,6 +138,9 @@ private:
     clientConnection = newClientConnection;
   }
   xpc_connection_t clientConnection;
+  // Payloads are sent in the form the client last used: clients that send
+  // data get data back, which avoids copying large replies.
+  std::atomic<bool> ClientSendsData = {false};
 };
 
 bool XPCTransport::handleMessage(json::Value Message, MessageHandler &Handler) {
@@ -165,6 +206,7 @@ void connection_handler(xpc_connection_t clientConnection) {
       return;
     }
 
+    TransportObject->ClientSendsData = isXpcDataPayload(message);
     const json::Value Doc = xpcToJson(message);
     if (Doc == json::Value(nullptr)) {
       log("XPC message was converted to Null JSON message - returning from the "
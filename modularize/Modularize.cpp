@@ -234,6 +234,7 @@
 #include "clang/Driver/Options.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendActions.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "clang/Tooling/Tooling.h"
@@ -245,6 +246,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include <algorithm>
 #include <fstream>
 #include <iterator>
@@ -329,6 +331,12 @@ DisplayFileLists("display-file-lists", cl::init(false),
 cl::desc("Display lists of good files (no compile errors), problem files,"
   " and a combined list with problem files preceded by a '#'."));
 
+// Option for checking headers in parallel.
+static cl::opt<unsigned>
+Jobs("j", cl::init(1),
+cl::desc("Number of headers to check in parallel.  0 means use all available"
+  " hardware threads."));
+
 // Save the program name for error messages.
 const char *Argv0;
 // Save the command line for comments.
@@ -356,13 +364,15 @@ getModularizeArgumentsAdjuster(DependencyMap &Dependencies) {
   return [&Dependencies](const CommandLineArguments &Args,
                          StringRef /*unused*/) {
     std::string InputFile = findInputFile(Args);
-    DependentsVector &FileDependents = Dependencies[InputFile];
     CommandLineArguments NewArgs(Args);
-    if (int Count = FileDependents.size()) {
-      for (int Index = 0; Index < Count; ++Index) {
+    // Don't insert into the map here, as the adjuster may be shared by
+    // tools running in parallel.
+    DependencyMap::const_iterator Found = Dependencies.find(InputFile);
+    if (Found != Dependencies.end()) {
+      const DependentsVector &FileDependents = Found->second;
+      for (int Index = 0, Count = FileDependents.size(); Index < Count;
+           ++Index) {
         NewArgs.push_back("-include");
-        std::string File(std::string("\"") + FileDependents[Index] +
-                         std::string("\""));
         NewArgs.push_back(FileDependents[Index]);
       }
     }
@@ -491,16 +501,8 @@ public:
     HeaderEntry HE = { Name, Loc };
     CurHeaderContents[Loc.File].push_back(HE);
 
-    // Check whether we've seen this entry before.
-    SmallVector<Entry, 2> &Entries = (*this)[Name];
-    for (unsigned I = 0, N = Entries.size(); I != N; ++I) {
-      if (Entries[I].Kind == Kind && Entries[I].Loc == Loc)
-        return;
-    }
-
-    // We have not seen this entry before; record it.
-    Entry E = { Kind, Loc };
-    Entries.push_back(E);
+    // Record the entity, if we haven't seen it before.
+    addEntry(Name, Kind, Loc);
   }
 
   void mergeCurHeaderContents() {
@@ -534,7 +536,58 @@ public:
     CurHeaderContents.clear();
   }
 
+  // Merge in the entities collected by another map for a single
+  // translation unit.  The other map may have been filled by a tool with
+  // its own FileManager, so locations are re-resolved through Files.
+  void merge(const EntityMap &Other, FileManager &Files) {
+    DenseMap<const FileEntry *, const FileEntry *> FileMap;
+    auto MapLocation = [&](Location Loc) -> Location {
+      const FileEntry *&File = FileMap[Loc.File];
+      if (!File)
+        File = Files.getFile(Loc.File->getName());
+      Loc.File = File;
+      return Loc;
+    };
+
+    for (StringMap<SmallVector<Entry, 2> >::const_iterator
+             E = Other.begin(),
+             EEnd = Other.end();
+         E != EEnd; ++E) {
+      for (unsigned I = 0, N = E->second.size(); I != N; ++I) {
+        Location Loc = MapLocation(E->second[I].Loc);
+        if (Loc)
+          addEntry(E->first(), E->second[I].Kind, Loc);
+      }
+    }
+
+    for (DenseMap<const FileEntry *, HeaderContents>::const_iterator
+             H = Other.AllHeaderContents.begin(),
+             HEnd = Other.AllHeaderContents.end();
+         H != HEnd; ++H) {
+      for (unsigned I = 0, N = H->second.size(); I != N; ++I) {
+        HeaderEntry HE = { H->second[I].Name,
+                           MapLocation(H->second[I].Loc) };
+        if (HE.Loc)
+          CurHeaderContents[HE.Loc.File].push_back(HE);
+      }
+    }
+    mergeCurHeaderContents();
+  }
+
 private:
+  // Record an entity, unless we've seen it before.
+  void addEntry(StringRef Name, enum Entry::EntryKind Kind, Location Loc) {
+    SmallVector<Entry, 2> &Entries = (*this)[Name];
+    for (unsigned I = 0, N = Entries.size(); I != N; ++I) {
+      if (Entries[I].Kind == Kind && Entries[I].Loc == Loc)
+        return;
+    }
+
+    // We have not seen this entry before; record it.
+    Entry E = { Kind, Loc };
+    Entries.push_back(E);
+  }
+
   DenseMap<const FileEntry *, HeaderContents> CurHeaderContents;
   DenseMap<const FileEntry *, HeaderContents> AllHeaderContents;
 };
@@ -544,8 +597,8 @@ class CollectEntitiesVisitor
 public:
   CollectEntitiesVisitor(SourceManager &SM, EntityMap &Entities,
                          Preprocessor &PP, PreprocessorTracker &PPTracker,
-                         int &HadErrors)
-      : SM(SM), Entities(Entities), PP(PP), PPTracker(PPTracker),
+                         raw_ostream &OS, int &HadErrors)
+      : SM(SM), Entities(Entities), PP(PP), PPTracker(PPTracker), OS(OS),
         HadErrors(HadErrors) {}
 
   bool TraverseStmt(Stmt *S) { return true; }
@@ -588,8 +641,7 @@ public:
       LinkageLabel = "extern \"C++\" {}";
       break;
     }
-    if (!PPTracker.checkForIncludesInBlock(PP, BlockRange, LinkageLabel,
-                                           errs()))
+    if (!PPTracker.checkForIncludesInBlock(PP, BlockRange, LinkageLabel, OS))
       HadErrors = 1;
     return true;
   }
@@ -601,7 +653,7 @@ public:
     Label += D->getName();
     Label += " {}";
     if (!PPTracker.checkForIncludesInBlock(PP, BlockRange, Label.c_str(),
-                                           errs()))
+                                           OS))
       HadErrors = 1;
     return true;
   }
@@ -648,6 +700,7 @@ private:
   EntityMap &Entities;
   Preprocessor &PP;
   PreprocessorTracker &PPTracker;
+  raw_ostream &OS;
   int &HadErrors;
 };
 
@@ -655,8 +708,9 @@ class CollectEntitiesConsumer : public ASTConsumer {
 public:
   CollectEntitiesConsumer(EntityMap &Entities,
                           PreprocessorTracker &preprocessorTracker,
-                          Preprocessor &PP, StringRef InFile, int &HadErrors)
-      : Entities(Entities), PPTracker(preprocessorTracker), PP(PP),
+                          Preprocessor &PP, StringRef InFile, raw_ostream &OS,
+                          int &HadErrors)
+      : Entities(Entities), PPTracker(preprocessorTracker), PP(PP), OS(OS),
         HadErrors(HadErrors) {
     PPTracker.handlePreprocessorEntry(PP, InFile);
   }
@@ -667,7 +721,7 @@ public:
     SourceManager &SM = Ctx.getSourceManager();
 
     // Collect declared entities.
-    CollectEntitiesVisitor(SM, Entities, PP, PPTracker, HadErrors)
+    CollectEntitiesVisitor(SM, Entities, PP, PPTracker, OS, HadErrors)
         .TraverseDecl(Ctx.getTranslationUnitDecl());
 
     // Collect macro definitions.
@@ -689,6 +743,7 @@ private:
   EntityMap &Entities;
   PreprocessorTracker &PPTracker;
   Preprocessor &PP;
+  raw_ostream &OS;
   int &HadErrors;
 };
 
@@ -696,20 +751,21 @@ class CollectEntitiesAction : public SyntaxOnlyAction {
 public:
   CollectEntitiesAction(EntityMap &Entities,
                         PreprocessorTracker &preprocessorTracker,
-                        int &HadErrors)
-      : Entities(Entities), PPTracker(preprocessorTracker),
+                        raw_ostream &OS, int &HadErrors)
+      : Entities(Entities), PPTracker(preprocessorTracker), OS(OS),
         HadErrors(HadErrors) {}
 
 protected:
   std::unique_ptr<clang::ASTConsumer>
   CreateASTConsumer(CompilerInstance &CI, StringRef InFile) override {
     return llvm::make_unique<CollectEntitiesConsumer>(
-        Entities, PPTracker, CI.getPreprocessor(), InFile, HadErrors);
+        Entities, PPTracker, CI.getPreprocessor(), InFile, OS, HadErrors);
   }
 
 private:
   EntityMap &Entities;
   PreprocessorTracker &PPTracker;
+  raw_ostream &OS;
   int &HadErrors;
 };
 
@@ -717,17 +773,18 @@ class ModularizeFrontendActionFactory : public FrontendActionFactory {
 public:
   ModularizeFrontendActionFactory(EntityMap &Entities,
                                   PreprocessorTracker &preprocessorTracker,
-                                  int &HadErrors)
-      : Entities(Entities), PPTracker(preprocessorTracker),
+                                  raw_ostream &OS, int &HadErrors)
+      : Entities(Entities), PPTracker(preprocessorTracker), OS(OS),
         HadErrors(HadErrors) {}
 
   CollectEntitiesAction *create() override {
-    return new CollectEntitiesAction(Entities, PPTracker, HadErrors);
+    return new CollectEntitiesAction(Entities, PPTracker, OS, HadErrors);
   }
 
 private:
   EntityMap &Entities;
   PreprocessorTracker &PPTracker;
+  raw_ostream &OS;
   int &HadErrors;
 };
 
@@ -806,6 +863,105 @@ public:
   }
 };
 
+// Get the number of threads to use for a parallel check.
+static unsigned getThreadCount() {
+  return Jobs == 0 ? llvm::hardware_concurrency() : unsigned(Jobs);
+}
+
+// Do the compile check pass on the headers in parallel.  Each header gets
+// its own tool, and diagnostics are buffered so they can be printed in
+// header list order.
+static int compileCheckInParallel(const CompilationDatabase &Compilations,
+                                  ModularizeUtilities &ModUtil) {
+  ArrayRef<std::string> Files = ModUtil.HeaderFileNames;
+  std::vector<std::string> Outputs(Files.size());
+  std::vector<int> Results(Files.size());
+  {
+    ThreadPool Pool(getThreadCount());
+    for (size_t I = 0, E = Files.size(); I != E; ++I)
+      Pool.async([&, I] {
+        raw_string_ostream OS(Outputs[I]);
+        TextDiagnosticPrinter Diags(OS, new DiagnosticOptions());
+        ClangTool CompileCheckTool(Compilations, Files[I]);
+        CompileCheckTool.appendArgumentsAdjuster(
+            getModularizeArgumentsAdjuster(ModUtil.Dependencies));
+        CompileCheckTool.setDiagnosticConsumer(&Diags);
+        CompileCheckFrontendActionFactory CompileCheckFactory;
+        Results[I] = CompileCheckTool.run(&CompileCheckFactory);
+      });
+  }
+
+  int HadErrors = 0;
+  for (size_t I = 0, E = Files.size(); I != E; ++I) {
+    errs() << Outputs[I];
+    if (Results[I] != 0) {
+      ModUtil.addUniqueProblemFile(Files[I]); // Save problem file.
+      HadErrors = 1;
+    } else
+      ModUtil.addNoCompileErrorsFile(Files[I]); // Save good file.
+  }
+  return HadErrors;
+}
+
+// The results of checking one header in a parallel run.
+// Each header gets its own tool, entity map and preprocessor tracker, so
+// that nothing is shared between threads.  The tool is kept until the
+// results are merged, as the entity locations refer to its files.
+struct HeaderCheck {
+  std::unique_ptr<ClangTool> Tool;
+  std::unique_ptr<PreprocessorTracker> PPTracker;
+  EntityMap Entities;
+  std::string Output;
+  int HadErrors = 0;
+};
+
+// Collect entities and preprocessor information for the headers in
+// parallel, then merge them into Entities and PPTracker in header list
+// order, so that the results are those of a sequential run.  Merged
+// locations refer to the files of MergedFiles.
+static int collectEntitiesInParallel(const CompilationDatabase &Compilations,
+                                     ArrayRef<std::string> Files,
+                                     ModularizeUtilities &ModUtil,
+                                     FileManager &MergedFiles,
+                                     EntityMap &Entities,
+                                     PreprocessorTracker &PPTracker) {
+  // The header list is only consulted by the trackers for the block check.
+  SmallVector<std::string, 32> NoHeaders;
+  SmallVector<std::string, 32> &TrackerHeaders =
+      BlockCheckHeaderListOnly ? ModUtil.HeaderFileNames : NoHeaders;
+
+  std::vector<HeaderCheck> Checks(Files.size());
+  {
+    ThreadPool Pool(getThreadCount());
+    for (size_t I = 0, E = Files.size(); I != E; ++I)
+      Pool.async([&, I] {
+        HeaderCheck &Check = Checks[I];
+        raw_string_ostream OS(Check.Output);
+        TextDiagnosticPrinter Diags(OS, new DiagnosticOptions());
+        Check.PPTracker.reset(PreprocessorTracker::create(
+            TrackerHeaders, BlockCheckHeaderListOnly));
+        Check.Tool = llvm::make_unique<ClangTool>(Compilations, Files[I]);
+        Check.Tool->appendArgumentsAdjuster(
+            getModularizeArgumentsAdjuster(ModUtil.Dependencies));
+        Check.Tool->setDiagnosticConsumer(&Diags);
+        ModularizeFrontendActionFactory Factory(
+            Check.Entities, *Check.PPTracker, OS, Check.HadErrors);
+        Check.HadErrors |= Check.Tool->run(&Factory);
+      });
+  }
+
+  int HadErrors = 0;
+  for (HeaderCheck &Check : Checks) {
+    errs() << Check.Output;
+    HadErrors |= Check.HadErrors;
+    Entities.merge(Check.Entities, MergedFiles);
+    PPTracker.merge(*Check.PPTracker);
+    // Release the header's files and strings as we go.
+    Check = HeaderCheck();
+  }
+  return HadErrors;
+}
+
 int main(int Argc, const char **Argv) {
 
   // Save program name for error messages.
@@ -877,7 +1033,9 @@ int main(int Argc, const char **Argv) {
   // during the tool run, if we're collecting the file lists
   // for display, we do a first compile pass on individual
   // files to find which ones don't compile stand-alone.
-  if (DisplayFileLists) {
+  if (DisplayFileLists && Jobs != 1) {
+    HadErrors |= compileCheckInParallel(*Compilations, *ModUtil);
+  } else if (DisplayFileLists) {
     // First, make a pass to just get compile errors.
     for (auto &CompileCheckFile : ModUtil->HeaderFileNames) {
       llvm::SmallVector<std::string, 32> CompileCheckFileArray;
@@ -898,12 +1056,21 @@ int main(int Argc, const char **Argv) {
   }
 
   // Then we make another pass on the good files to do the rest of the work.
-  ClangTool Tool(*Compilations,
-    (DisplayFileLists ? ModUtil->GoodFileNames : ModUtil->HeaderFileNames));
+  ArrayRef<std::string> CheckFiles =
+    (DisplayFileLists ? ModUtil->GoodFileNames : ModUtil->HeaderFileNames);
+  ClangTool Tool(*Compilations, CheckFiles);
   Tool.appendArgumentsAdjuster(
     getModularizeArgumentsAdjuster(ModUtil->Dependencies));
-  ModularizeFrontendActionFactory Factory(Entities, *PPTracker, HadErrors);
-  HadErrors |= Tool.run(&Factory);
+  if (Jobs != 1) {
+    // The merged entity locations refer to the files of this tool.
+    HadErrors |= collectEntitiesInParallel(*Compilations, CheckFiles, *ModUtil,
+                                           Tool.getFiles(), Entities,
+                                           *PPTracker);
+  } else {
+    ModularizeFrontendActionFactory Factory(Entities, *PPTracker, errs(),
+                                            HadErrors);
+    HadErrors |= Tool.run(&Factory);
+  }
 
   // Create a place to save duplicate entity locations, separate bins per kind.
   typedef SmallVector<Location, 8> LocationArray;
@@ -120,10 +120,13 @@
 // the index of the stored header file path.
 //
 // A HeaderInclusionPath class abstracts a unique hierarchy of header file
-// inclusions. It simply stores a vector of HeaderHandles ordered from the
-// top-most header (the one from the header list passed to modularize) down
-// to the header containing the macro reference. PreprocessorTrackerImpl
-// stores a vector of these objects. An InclusionPathHandle typedef
+// inclusions, from the top-most header (the one from the header list passed
+// to modularize) down to the header containing the macro reference. Paths
+// are hash-consed: each one stores the handle of the path of the including
+// header and the handle of the included header, so a path is interned in
+// constant time and shares its prefix with the paths it extends.
+// PreprocessorTrackerImpl stores a vector of these objects, along with a
+// hash table for looking them up. An InclusionPathHandle typedef
 // abstracts a reference to one of the HeaderInclusionPath objects, and is
 // simply the index of the stored HeaderInclusionPath object. The
 // MacroExpansionInstance object stores a vector of these handles so that
@@ -153,8 +156,9 @@
 // handleHeaderEntry and handleHeaderExit functions upon entering and
 // exiting a header. These functions manage a stack of header handles
 // representing by a vector, pushing and popping header handles as headers
-// are entered and exited. When a HeaderInclusionPath object is created,
-// it simply copies this stack.
+// are entered and exited. A parallel stack holds the inclusion path handle
+// for each header on the stack, so entering a header only needs to intern
+// the pair of the enclosing path and the new header.
 //
 // The PreprocessorCallbacks object uses an overridden MacroExpands callback
 // to track when a macro expansion is performed. It calls a couple of helper
@@ -247,10 +251,17 @@
 #include "PreprocessorTracker.h"
 #include "clang/Lex/MacroArgs.h"
 #include "clang/Lex/PPCallbacks.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/StringPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "ModularizeUtilities.h"
+#include <algorithm>
+#include <unordered_map>
 
 namespace Modularize {
 
@@ -527,14 +538,27 @@ public:
   int Column;
 };
 
+// Hash function for PPItemKey.
+// Names are pooled strings, so the string pointer identifies the name.
+struct PPItemKeyHash {
+  size_t operator()(const PPItemKey &Key) const {
+    const char *Name = Key.Name ? *Key.Name : nullptr;
+    return llvm::hash_combine(Name, Key.File, Key.Line, Key.Column);
+  }
+};
+
 // Header inclusion path.
+// This is the path of the including header, extended by one header.
 class HeaderInclusionPath {
 public:
-  HeaderInclusionPath(std::vector<HeaderHandle> HeaderInclusionPath)
-      : Path(HeaderInclusionPath) {}
-  HeaderInclusionPath(const HeaderInclusionPath &Other) : Path(Other.Path) {}
-  HeaderInclusionPath() {}
-  std::vector<HeaderHandle> Path;
+  HeaderInclusionPath(InclusionPathHandle Parent, HeaderHandle Header)
+      : Parent(Parent), Header(Header) {}
+  HeaderInclusionPath()
+      : Parent(InclusionPathHandleInvalid), Header(HeaderHandleInvalid) {}
+  // The path of the including header, or InclusionPathHandleInvalid for
+  // a top-most header.
+  InclusionPathHandle Parent;
+  HeaderHandle Header;
 };
 
 // Macro expansion instance.
@@ -577,7 +601,7 @@ public:
   // A place to save the macro definition line string.
   StringHandle DefinitionSourceLine;
   // The header inclusion path handles for all the instances.
-  std::vector<InclusionPathHandle> InclusionPathHandles;
+  llvm::SmallVector<InclusionPathHandle, 1> InclusionPathHandles;
 };
 
 // Macro expansion instance tracker.
@@ -671,7 +695,7 @@ public:
   // A flag representing the evaluated condition value.
   clang::PPCallbacks::ConditionValueKind ConditionValue;
   // The header inclusion path handles for all the instances.
-  std::vector<InclusionPathHandle> InclusionPathHandles;
+  llvm::SmallVector<InclusionPathHandle, 1> InclusionPathHandles;
 };
 
 // Conditional directive instance tracker.
@@ -778,14 +802,14 @@ private:
 };
 
 // Preprocessor macro expansion item map types.
-typedef std::map<PPItemKey, MacroExpansionTracker> MacroExpansionMap;
-typedef std::map<PPItemKey, MacroExpansionTracker>::iterator
-MacroExpansionMapIter;
+typedef std::unordered_map<PPItemKey, MacroExpansionTracker, PPItemKeyHash>
+MacroExpansionMap;
+typedef MacroExpansionMap::iterator MacroExpansionMapIter;
 
 // Preprocessor conditional expansion item map types.
-typedef std::map<PPItemKey, ConditionalTracker> ConditionalExpansionMap;
-typedef std::map<PPItemKey, ConditionalTracker>::iterator
-ConditionalExpansionMapIter;
+typedef std::unordered_map<PPItemKey, ConditionalTracker, PPItemKeyHash>
+ConditionalExpansionMap;
+typedef ConditionalExpansionMap::iterator ConditionalExpansionMapIter;
 
 // Preprocessor tracker for modularize.
 //
@@ -802,7 +826,7 @@ public:
     for (llvm::ArrayRef<std::string>::iterator I = Headers.begin(),
       E = Headers.end();
       I != E; ++I) {
-      HeaderList.push_back(getCanonicalPath(*I));
+      HeaderList.insert(getCanonicalPath(*I));
     }
   }
 
@@ -818,7 +842,10 @@ public:
                                                                rootHeaderFile));
   }
   // Handle exiting a preprocessing session.
-  void handlePreprocessorExit() override { HeaderStack.clear(); }
+  void handlePreprocessorExit() override {
+    HeaderStack.clear();
+    InclusionPathStack.clear();
+  }
 
   // Handle include directive.
   // This function is called every time an include directive is seen by the
@@ -833,16 +860,23 @@ public:
       return;
     HeaderHandle CurrentHeaderHandle = findHeaderHandle(DirectivePath);
     StringHandle IncludeHeaderHandle = addString(TargetPath);
-    for (std::vector<PPItemKey>::const_iterator I = IncludeDirectives.begin(),
-                                                E = IncludeDirectives.end();
+    addIncludeDirective(PPItemKey(IncludeHeaderHandle, CurrentHeaderHandle,
+                                  DirectiveLine, DirectiveColumn));
+  }
+
+  // Add an include directive entry, unless we already have one for the
+  // same header line.
+  void addIncludeDirective(const PPItemKey &IncludeDirectiveItem) {
+    std::vector<PPItemKey> &Directives =
+        IncludeDirectives[IncludeDirectiveItem.File];
+    for (std::vector<PPItemKey>::const_iterator I = Directives.begin(),
+                                                E = Directives.end();
          I != E; ++I) {
       // If we already have an entry for this directive, return now.
-      if ((I->File == CurrentHeaderHandle) && (I->Line == DirectiveLine))
+      if (I->Line == IncludeDirectiveItem.Line)
         return;
     }
-    PPItemKey IncludeDirectiveItem(IncludeHeaderHandle, CurrentHeaderHandle,
-                                   DirectiveLine, DirectiveColumn);
-    IncludeDirectives.push_back(IncludeDirectiveItem);
+    Directives.push_back(IncludeDirectiveItem);
   }
 
   // Check for include directives within the given source line range.
@@ -868,12 +902,14 @@ public:
                                    BlockStartColumn);
     getSourceLocationLineAndColumn(PP, BlockEndLoc, BlockEndLine,
                                    BlockEndColumn);
-    for (std::vector<PPItemKey>::const_iterator I = IncludeDirectives.begin(),
-                                                E = IncludeDirectives.end();
+    auto Directives = IncludeDirectives.find(SourceHandle);
+    if (Directives == IncludeDirectives.end())
+      return true;
+    for (std::vector<PPItemKey>::const_iterator I = Directives->second.begin(),
+                                                E = Directives->second.end();
          I != E; ++I) {
       // If we find an entry within the block, report an error.
-      if ((I->File == SourceHandle) && (I->Line >= BlockStartLine) &&
-          (I->Line < BlockEndLine)) {
+      if ((I->Line >= BlockStartLine) && (I->Line < BlockEndLine)) {
         returnValue = false;
         OS << SourcePath << ":" << I->Line << ":" << I->Column << ":\n";
         OS << getSourceLine(PP, FileID, I->Line) << "\n";
@@ -933,27 +969,16 @@ public:
 
   // Return true if the given header is in the header list.
   bool isHeaderListHeader(llvm::StringRef HeaderPath) const {
-    std::string CanonicalPath = getCanonicalPath(HeaderPath);
-    for (llvm::ArrayRef<std::string>::iterator I = HeaderList.begin(),
-        E = HeaderList.end();
-        I != E; ++I) {
-      if (*I == CanonicalPath)
-        return true;
-    }
-    return false;
+    return HeaderList.count(getCanonicalPath(HeaderPath)) != 0;
   }
 
   // Get the handle of a header file entry.
   // Return HeaderHandleInvalid if not found.
   HeaderHandle findHeaderHandle(llvm::StringRef HeaderPath) const {
-    std::string CanonicalPath = getCanonicalPath(HeaderPath);
-    HeaderHandle H = 0;
-    for (auto I = HeaderPaths.begin(), E = HeaderPaths.end(); I != E;
-         ++I, ++H) {
-      if (**I == CanonicalPath)
-        return H;
-    }
-    return HeaderHandleInvalid;
+    auto I = HeaderHandles.find(getCanonicalPath(HeaderPath));
+    if (I == HeaderHandles.end())
+      return HeaderHandleInvalid;
+    return I->second;
   }
 
   // Add a new header file entry, or return existing handle.
@@ -964,6 +989,7 @@ public:
     if (H == HeaderHandleInvalid) {
       H = HeaderPaths.size();
       HeaderPaths.push_back(addString(CanonicalPath));
+      HeaderHandles[CanonicalPath] = H;
     }
     return H;
   }
@@ -977,15 +1003,23 @@ public:
 
   // Returns a handle to the inclusion path.
   InclusionPathHandle pushHeaderHandle(HeaderHandle H) {
+    InclusionPathHandle Parent = InclusionPathStack.size() != 0
+                                     ? InclusionPathStack.back()
+                                     : InclusionPathHandleInvalid;
     HeaderStack.push_back(H);
-    return CurrentInclusionPathHandle = addInclusionPathHandle(HeaderStack);
+    CurrentInclusionPathHandle = addInclusionPathHandle(Parent, H);
+    InclusionPathStack.push_back(CurrentInclusionPathHandle);
+    return CurrentInclusionPathHandle;
   }
   // Pops the last header handle from the stack;
   void popHeaderHandle() {
     // assert((HeaderStack.size() != 0) && "Header stack already empty.");
     if (HeaderStack.size() != 0) {
       HeaderStack.pop_back();
-      CurrentInclusionPathHandle = addInclusionPathHandle(HeaderStack);
+      InclusionPathStack.pop_back();
+      CurrentInclusionPathHandle = InclusionPathStack.size() != 0
+                                       ? InclusionPathStack.back()
+                                       : InclusionPathHandleInvalid;
     }
   }
   // Get the top handle on the header stack.
@@ -1006,39 +1040,39 @@ public:
 
   // Get the handle of a header inclusion path entry.
   // Return InclusionPathHandleInvalid if not found.
-  InclusionPathHandle
-  findInclusionPathHandle(const std::vector<HeaderHandle> &Path) const {
-    InclusionPathHandle H = 0;
-    for (auto I = InclusionPaths.begin(), E = InclusionPaths.end(); I != E;
-         ++I, ++H) {
-      if (I->Path == Path)
-        return H;
-    }
-    return HeaderHandleInvalid;
+  InclusionPathHandle findInclusionPathHandle(InclusionPathHandle Parent,
+                                              HeaderHandle Header) const {
+    auto I = InclusionPathHandles.find(std::make_pair(Parent, Header));
+    if (I == InclusionPathHandles.end())
+      return InclusionPathHandleInvalid;
+    return I->second;
   }
   // Add a new header inclusion path entry, or return existing handle.
   // Return the header inclusion path entry handle.
-  InclusionPathHandle
-  addInclusionPathHandle(const std::vector<HeaderHandle> &Path) {
-    InclusionPathHandle H = findInclusionPathHandle(Path);
-    if (H == HeaderHandleInvalid) {
-      H = InclusionPaths.size();
-      InclusionPaths.push_back(HeaderInclusionPath(Path));
-    }
-    return H;
+  InclusionPathHandle addInclusionPathHandle(InclusionPathHandle Parent,
+                                             HeaderHandle Header) {
+    auto Inserted = InclusionPathHandles.insert(
+        std::make_pair(std::make_pair(Parent, Header),
+                       (InclusionPathHandle)InclusionPaths.size()));
+    if (Inserted.second)
+      InclusionPaths.push_back(HeaderInclusionPath(Parent, Header));
+    return Inserted.first->second;
   }
   // Return the current inclusion path handle.
   InclusionPathHandle getCurrentInclusionPathHandle() const {
     return CurrentInclusionPathHandle;
   }
 
-  // Return an inclusion path given its handle.
-  const std::vector<HeaderHandle> &
-  getInclusionPath(InclusionPathHandle H) const {
-    if ((H >= 0) && (H <= (InclusionPathHandle)InclusionPaths.size()))
-      return InclusionPaths[H].Path;
-    static std::vector<HeaderHandle> Empty;
-    return Empty;
+  // Return an inclusion path given its handle, as a vector of header
+  // handles ordered from the top-most header down.
+  std::vector<HeaderHandle> getInclusionPath(InclusionPathHandle H) const {
+    std::vector<HeaderHandle> Path;
+    while ((H >= 0) && (H < (InclusionPathHandle)InclusionPaths.size())) {
+      Path.push_back(InclusionPaths[H].Header);
+      H = InclusionPaths[H].Parent;
+    }
+    std::reverse(Path.begin(), Path.end());
+    return Path;
   }
 
   // Add a macro expansion instance.
@@ -1132,9 +1166,10 @@ public:
   // Returns true if any mismatches.
   bool reportInconsistentMacros(llvm::raw_ostream &OS) override {
     bool ReturnValue = false;
-    // Walk all the macro expansion trackers in the map.
-    for (auto I = MacroExpansions.begin(), E = MacroExpansions.end(); I != E;
-         ++I) {
+    // Walk all the macro expansion trackers in the map, in key order.
+    std::vector<MacroExpansionMap::value_type *> SortedExpansions =
+        getSortedEntries(MacroExpansions);
+    for (auto I : SortedExpansions) {
       const PPItemKey &ItemKey = I->first;
       MacroExpansionTracker &MacroExpTracker = I->second;
       // If no mismatch (only one instance value) continue.
@@ -1161,7 +1196,7 @@ public:
         for (auto IIP = MacroInfo.InclusionPathHandles.begin(),
                   EIP = MacroInfo.InclusionPathHandles.end();
              IIP != EIP; ++IIP) {
-          const std::vector<HeaderHandle> &ip = getInclusionPath(*IIP);
+          std::vector<HeaderHandle> ip = getInclusionPath(*IIP);
           auto Count = (int)ip.size();
           for (int Index = 0; Index < Count; ++Index) {
             HeaderHandle H = ip[Index];
@@ -1190,10 +1225,10 @@ public:
   // Returns true if any mismatches.
   bool reportInconsistentConditionals(llvm::raw_ostream &OS) override {
     bool ReturnValue = false;
-    // Walk all the conditional trackers in the map.
-    for (auto I = ConditionalExpansions.begin(),
-              E = ConditionalExpansions.end();
-         I != E; ++I) {
+    // Walk all the conditional trackers in the map, in key order.
+    std::vector<ConditionalExpansionMap::value_type *> SortedConditionals =
+        getSortedEntries(ConditionalExpansions);
+    for (auto I : SortedConditionals) {
       const PPItemKey &ItemKey = I->first;
       ConditionalTracker &CondTracker = I->second;
       if (!CondTracker.hasMismatch())
@@ -1222,7 +1257,7 @@ public:
         for (auto IIP = MacroInfo.InclusionPathHandles.begin(),
                   EIP = MacroInfo.InclusionPathHandles.end();
              IIP != EIP; ++IIP) {
-          const std::vector<HeaderHandle> &ip = getInclusionPath(*IIP);
+          std::vector<HeaderHandle> ip = getInclusionPath(*IIP);
           auto Count = (int)ip.size();
           for (int Index = 0; Index < Count; ++Index) {
             HeaderHandle H = ip[Index];
@@ -1235,6 +1270,143 @@ public:
     return ReturnValue;
   }
 
+  // Merge in the state of another tracker.
+  // Handles and pooled strings are private to a tracker, so everything is
+  // re-interned here.  Merging per-translation-unit trackers in input order
+  // gives the same result as running those translation units through this
+  // tracker.
+  void merge(PreprocessorTracker &OtherTracker) override {
+    PreprocessorTrackerImpl &Other =
+        static_cast<PreprocessorTrackerImpl &>(OtherTracker);
+
+    // Map the other tracker's header and inclusion path handles to ours.
+    std::vector<HeaderHandle> HeaderMap;
+    for (auto I = Other.HeaderPaths.begin(), E = Other.HeaderPaths.end();
+         I != E; ++I)
+      HeaderMap.push_back(addHeader(**I));
+    auto MapHeader = [&](HeaderHandle H) {
+      return H == HeaderHandleInvalid ? H : HeaderMap[H];
+    };
+    std::vector<InclusionPathHandle> InclusionPathMap;
+    auto MapInclusionPath = [&](InclusionPathHandle H) {
+      return H == InclusionPathHandleInvalid ? H : InclusionPathMap[H];
+    };
+    // A path's parent always precedes it, so it is mapped already.
+    for (auto I = Other.InclusionPaths.begin(), E = Other.InclusionPaths.end();
+         I != E; ++I)
+      InclusionPathMap.push_back(addInclusionPathHandle(
+          MapInclusionPath(I->Parent), MapHeader(I->Header)));
+    auto MapString = [&](const StringHandle &S) {
+      return S ? addString(*S) : StringHandle();
+    };
+    auto MapKey = [&](const PPItemKey &Key) {
+      return PPItemKey(MapString(Key.Name), MapHeader(Key.File), Key.Line,
+                       Key.Column);
+    };
+
+    // Merge the include directives.
+    for (auto I = Other.IncludeDirectives.begin(),
+              E = Other.IncludeDirectives.end();
+         I != E; ++I) {
+      for (auto D = I->second.begin(), DE = I->second.end(); D != DE; ++D)
+        addIncludeDirective(MapKey(*D));
+    }
+
+    // Merge the macro expansions.
+    for (auto I = Other.MacroExpansions.begin(),
+              E = Other.MacroExpansions.end();
+         I != E; ++I) {
+      PPItemKey InstanceKey = MapKey(I->first);
+      MacroExpansionTracker &OtherMacroTracker = I->second;
+      bool IsNew = MacroExpansions.find(InstanceKey) == MacroExpansions.end();
+      MacroExpansionTracker &Tracker = MacroExpansions[InstanceKey];
+      if (IsNew) {
+        Tracker.MacroUnexpanded = MapString(OtherMacroTracker.MacroUnexpanded);
+        Tracker.InstanceSourceLine =
+            MapString(OtherMacroTracker.InstanceSourceLine);
+      }
+      for (auto IMT = OtherMacroTracker.MacroExpansionInstances.begin(),
+                EMT = OtherMacroTracker.MacroExpansionInstances.end();
+           IMT != EMT; ++IMT) {
+        StringHandle MacroExpanded = MapString(IMT->MacroExpanded);
+        PPItemKey DefinitionKey = MapKey(IMT->DefinitionLocation);
+        MacroExpansionInstance *MacroInfo =
+            Tracker.findMacroExpansionInstance(MacroExpanded, DefinitionKey);
+        if (!MacroInfo) {
+          Tracker.MacroExpansionInstances.push_back(MacroExpansionInstance());
+          MacroInfo = &Tracker.MacroExpansionInstances.back();
+          MacroInfo->MacroExpanded = MacroExpanded;
+          MacroInfo->DefinitionLocation = DefinitionKey;
+          MacroInfo->DefinitionSourceLine =
+              MapString(IMT->DefinitionSourceLine);
+          for (auto H = IMT->InclusionPathHandles.begin(),
+                    HE = IMT->InclusionPathHandles.end();
+               H != HE; ++H)
+            MacroInfo->InclusionPathHandles.push_back(MapInclusionPath(*H));
+          continue;
+        }
+        for (auto H = IMT->InclusionPathHandles.begin(),
+                  HE = IMT->InclusionPathHandles.end();
+             H != HE; ++H)
+          MacroInfo->addInclusionPathHandle(MapInclusionPath(*H));
+      }
+    }
+
+    // Merge the conditional expansions.
+    for (auto I = Other.ConditionalExpansions.begin(),
+              E = Other.ConditionalExpansions.end();
+         I != E; ++I) {
+      PPItemKey InstanceKey = MapKey(I->first);
+      ConditionalTracker &OtherCondTracker = I->second;
+      bool IsNew = ConditionalExpansions.find(InstanceKey) ==
+                   ConditionalExpansions.end();
+      ConditionalTracker &Tracker = ConditionalExpansions[InstanceKey];
+      if (IsNew) {
+        Tracker.DirectiveKind = OtherCondTracker.DirectiveKind;
+        Tracker.ConditionUnexpanded =
+            MapString(OtherCondTracker.ConditionUnexpanded);
+      }
+      for (auto IMT = OtherCondTracker.ConditionalExpansionInstances.begin(),
+                EMT = OtherCondTracker.ConditionalExpansionInstances.end();
+           IMT != EMT; ++IMT) {
+        ConditionalExpansionInstance *MacroInfo =
+            Tracker.findConditionalExpansionInstance(IMT->ConditionValue);
+        if (!MacroInfo) {
+          Tracker.ConditionalExpansionInstances.push_back(
+              ConditionalExpansionInstance());
+          MacroInfo = &Tracker.ConditionalExpansionInstances.back();
+          MacroInfo->ConditionValue = IMT->ConditionValue;
+          for (auto H = IMT->InclusionPathHandles.begin(),
+                    HE = IMT->InclusionPathHandles.end();
+               H != HE; ++H)
+            MacroInfo->InclusionPathHandles.push_back(MapInclusionPath(*H));
+          continue;
+        }
+        for (auto H = IMT->InclusionPathHandles.begin(),
+                  HE = IMT->InclusionPathHandles.end();
+             H != HE; ++H)
+          MacroInfo->addInclusionPathHandle(MapInclusionPath(*H));
+      }
+    }
+  }
+
+  // Return pointers to the entries of an expansion map, sorted by key,
+  // so that reports don't depend on hash order.
+  template <typename MapType>
+  static std::vector<typename MapType::value_type *>
+  getSortedEntries(MapType &Map) {
+    std::vector<typename MapType::value_type *> Entries;
+    Entries.reserve(Map.size());
+    for (auto I = Map.begin(), E = Map.end(); I != E; ++I)
+      Entries.push_back(&*I);
+    std::sort(Entries.begin(), Entries.end(),
+              [](const typename MapType::value_type *A,
+                 const typename MapType::value_type *B) {
+                return A->first < B->first;
+              });
+    return Entries;
+  }
+
   // Get directive spelling.
   static const char *getDirectiveSpelling(clang::tok::PPKeywordKind kind) {
     switch (kind) {
@@ -1252,16 +1424,23 @@ public:
   }
 
 private:
-  llvm::SmallVector<std::string, 32> HeaderList;
+  llvm::StringSet<> HeaderList;
   // Only do extern, namespace check for headers in HeaderList.
   bool BlockCheckHeaderListOnly;
   llvm::StringPool Strings;
   std::vector<StringHandle> HeaderPaths;
+  llvm::StringMap<HeaderHandle> HeaderHandles;
   std::vector<HeaderHandle> HeaderStack;
+  // The inclusion path handles of the headers in HeaderStack.
+  std::vector<InclusionPathHandle> InclusionPathStack;
   std::vector<HeaderInclusionPath> InclusionPaths;
+  llvm::DenseMap<std::pair<InclusionPathHandle, HeaderHandle>,
+                 InclusionPathHandle>
+      InclusionPathHandles;
   InclusionPathHandle CurrentInclusionPathHandle;
   llvm::SmallSet<HeaderHandle, 32> HeadersInThisCompile;
-  std::vector<PPItemKey> IncludeDirectives;
+  // Include directives, grouped by the header containing them.
+  llvm::DenseMap<HeaderHandle, std::vector<PPItemKey>> IncludeDirectives;
   MacroExpansionMap MacroExpansions;
   ConditionalExpansionMap ConditionalExpansions;
   bool InNestedHeader;
@@ -75,6 +75,11 @@ public:
   // Returns true if any mismatches.
   virtual bool reportInconsistentConditionals(llvm::raw_ostream &OS) = 0;
 
+  // Merge in the state of another tracker, as if the translation units it
+  // saw had been run through this one.  Used to combine the per-header
+  // trackers of a parallel run.
+  virtual void merge(PreprocessorTracker &Other) = 0;
+
   // Create instance of PreprocessorTracker.
   static PreprocessorTracker *create(
     llvm::SmallVector<std::string, 32> &Headers,
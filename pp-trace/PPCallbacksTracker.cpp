@@ -89,13 +89,24 @@ static const char *const MappingStrings[] = { "0",          "MAP_IGNORE",
 
 // PPCallbacksTracker functions.
 
+CallbackWriter::~CallbackWriter() {}
+
 PPCallbacksTracker::PPCallbacksTracker(const FilterType &Filters,
-                                       std::vector<CallbackCall> &CallbackCalls,
+                                       CallbackWriter &Writer,
                                        Preprocessor &PP)
-    : CallbackCalls(CallbackCalls), Filters(Filters), PP(PP) {}
+    : Writer(Writer), HaveCurrent(false), Filters(Filters),
+      DisableTrace(false), PP(PP) {}
 
 PPCallbacksTracker::~PPCallbacksTracker() {}
 
+// Write out the last callback, if it hasn't been yet.
+void PPCallbacksTracker::flush() {
+  if (!HaveCurrent)
+    return;
+  Writer.write(Current);
+  HaveCurrent = false;
+}
+
 // Callback functions.
 
 // Callback invoked whenever a source file is entered or exited.
@@ -271,6 +282,8 @@ void PPCallbacksTracker::PragmaWarning(SourceLocation Loc,
   beginCallback("PragmaWarning");
   appendArgument("Loc", Loc);
   appendArgument("WarningSpec", WarningSpec);
+  if (DisableTrace)
+    return;
 
   std::string Str;
   llvm::raw_string_ostream SS(Str);
@@ -426,16 +439,24 @@ void PPCallbacksTracker::beginCallback(const char *Name) {
   DisableTrace = !R.first->second;
   if (DisableTrace)
     return;
-  CallbackCalls.push_back(CallbackCall(Name));
+  flush();
+  // Reuse the argument storage of the previous callback.
+  Current.Name = Name;
+  Current.Arguments.clear();
+  HaveCurrent = true;
 }
 
 // Append a bool argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name, bool Value) {
+  if (DisableTrace)
+    return;
   appendArgument(Name, (Value ? "true" : "false"));
 }
 
 // Append an int argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name, int Value) {
+  if (DisableTrace)
+    return;
   std::string Str;
   llvm::raw_string_ostream SS(Str);
   SS << Value;
@@ -446,34 +467,44 @@ void PPCallbacksTracker::appendArgument(const char *Name, int Value) {
 void PPCallbacksTracker::appendArgument(const char *Name, const char *Value) {
   if (DisableTrace)
     return;
-  CallbackCalls.back().Arguments.push_back(Argument{Name, Value});
+  Current.Arguments.push_back(Argument{Name, Value});
 }
 
 // Append a string object argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         llvm::StringRef Value) {
+  if (DisableTrace)
+    return;
   appendArgument(Name, Value.str());
 }
 
 // Append a string object argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         const std::string &Value) {
+  if (DisableTrace)
+    return;
   appendArgument(Name, Value.c_str());
 }
 
 // Append a token argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name, const Token &Value) {
+  if (DisableTrace)
+    return;
   appendArgument(Name, PP.getSpelling(Value));
 }
 
 // Append an enum argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name, int Value,
                                         const char *const Strings[]) {
+  if (DisableTrace)
+    return;
   appendArgument(Name, Strings[Value]);
 }
 
 // Append a FileID argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name, FileID Value) {
+  if (DisableTrace)
+    return;
   if (Value.isInvalid()) {
     appendArgument(Name, "(invalid)");
     return;
@@ -489,6 +520,8 @@ void PPCallbacksTracker::appendArgument(const char *Name, FileID Value) {
 // Append a FileEntry argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         const FileEntry *Value) {
+  if (DisableTrace)
+    return;
   if (!Value) {
     appendArgument(Name, "(null)");
     return;
@@ -499,6 +532,8 @@ void PPCallbacksTracker::appendArgument(const char *Name,
 // Append a SourceLocation argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         SourceLocation Value) {
+  if (DisableTrace)
+    return;
   if (Value.isInvalid()) {
     appendArgument(Name, "(invalid)");
     return;
@@ -524,6 +559,8 @@ void PPCallbacksTracker::appendArgument(const char *Name, SourceRange Value) {
 // Append a CharSourceRange argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         CharSourceRange Value) {
+  if (DisableTrace)
+    return;
   if (Value.isInvalid()) {
     appendArgument(Name, "(invalid)");
     return;
@@ -552,6 +589,8 @@ void PPCallbacksTracker::appendArgument(const char *Name, ModuleIdPath Value) {
 // Append an IdentifierInfo argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         const IdentifierInfo *Value) {
+  if (DisableTrace)
+    return;
   if (!Value) {
     appendArgument(Name, "(null)");
     return;
@@ -562,6 +601,8 @@ void PPCallbacksTracker::appendArgument(const char *Name,
 // Append a MacroDirective argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         const MacroDirective *Value) {
+  if (DisableTrace)
+    return;
   if (!Value) {
     appendArgument(Name, "(null)");
     return;
@@ -572,6 +613,8 @@ void PPCallbacksTracker::appendArgument(const char *Name,
 // Append a MacroDefinition argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         const MacroDefinition &Value) {
+  if (DisableTrace)
+    return;
   std::string Str;
   llvm::raw_string_ostream SS(Str);
   SS << "[";
@@ -591,6 +634,8 @@ void PPCallbacksTracker::appendArgument(const char *Name,
 // Append a MacroArgs argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name,
                                         const MacroArgs *Value) {
+  if (DisableTrace)
+    return;
   if (!Value) {
     appendArgument(Name, "(null)");
     return;
@@ -627,6 +672,8 @@ void PPCallbacksTracker::appendArgument(const char *Name,
 
 // Append a Module argument to the top trace item.
 void PPCallbacksTracker::appendArgument(const char *Name, const Module *Value) {
+  if (DisableTrace)
+    return;
   if (!Value) {
     appendArgument(Name, "(null)");
     return;
@@ -637,6 +684,8 @@ void PPCallbacksTracker::appendArgument(const char *Name, const Module *Value) {
 // Append a double-quoted argument to the top trace item.
 void PPCallbacksTracker::appendQuotedArgument(const char *Name,
                                               const std::string &Value) {
+  if (DisableTrace)
+    return;
   std::string Str;
   llvm::raw_string_ostream SS(Str);
   SS << "\"" << Value << "\"";
@@ -646,6 +695,8 @@ void PPCallbacksTracker::appendQuotedArgument(const char *Name,
 // Append a double-quoted file path argument to the top trace item.
 void PPCallbacksTracker::appendFilePathArgument(const char *Name,
                                                 llvm::StringRef Value) {
+  if (DisableTrace)
+    return;
   std::string Path(Value);
   // YAML treats backslash as escape, so use forward slashes.
   std::replace(Path.begin(), Path.end(), '\\', '/');
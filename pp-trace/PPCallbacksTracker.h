@@ -52,6 +52,22 @@ public:
   std::vector<Argument> Arguments;
 };
 
+/// \brief Receives the callback traces as the preprocessor runs, so that
+/// the trace doesn't have to be held in memory.
+class CallbackWriter {
+public:
+  virtual ~CallbackWriter();
+
+  /// \brief Called before the first callback of a translation unit.
+  virtual void beginTrace() {}
+
+  /// \brief Write one completed callback.
+  virtual void write(const CallbackCall &Callback) = 0;
+
+  /// \brief Called after the last callback of a translation unit.
+  virtual void endTrace() {}
+};
+
 using FilterType = std::vector<std::pair<llvm::GlobPattern, bool>>;
 
 /// \brief This class overrides the PPCallbacks class for tracking preprocessor
@@ -76,10 +92,9 @@ public:
   /// \brief Note that all of the arguments are references, and owned
   /// by the caller.
   /// \param Filters - List of (Glob,Enabled) pairs used to filter callbacks.
-  /// \param CallbackCalls - Trace buffer.
+  /// \param Writer - Receives each callback once its arguments are complete.
   /// \param PP - The preprocessor.  Needed for getting some argument strings.
-  PPCallbacksTracker(const FilterType &Filters,
-                     std::vector<CallbackCall> &CallbackCalls,
+  PPCallbacksTracker(const FilterType &Filters, CallbackWriter &Writer,
                      Preprocessor &PP);
 
   ~PPCallbacksTracker() override;
@@ -147,9 +162,13 @@ public:
   void Else(SourceLocation Loc, SourceLocation IfLoc) override;
   void Endif(SourceLocation Loc, SourceLocation IfLoc) override;
 
+  /// \brief Write out the last callback, if it hasn't been yet.
+  /// Call this at the end of the translation unit.
+  void flush();
+
   // Helper functions.
 
-  /// \brief Start a new callback.
+  /// \brief Start a new callback, writing out the previous one.
   void beginCallback(const char *Name);
 
   /// \brief Append a string to the top trace item.
@@ -218,10 +237,14 @@ public:
   /// \brief Get the raw source string of the range.
   llvm::StringRef getSourceString(CharSourceRange Range);
 
-  /// \brief Callback trace information.
-  /// We use a reference so the trace will be preserved for the caller
-  /// after this object is destructed.
-  std::vector<CallbackCall> &CallbackCalls;
+  /// \brief Where completed callbacks are written.
+  CallbackWriter &Writer;
+
+  /// \brief The callback whose arguments are being appended.
+  CallbackCall Current;
+
+  /// \brief Whether Current holds a callback that hasn't been written.
+  bool HaveCurrent;
 
   // List of (Glob,Enabled) pairs used to filter callbacks.
   const FilterType &Filters;
@@ -230,6 +253,8 @@ public:
   llvm::StringMap<bool> CallbackIsEnabled;
 
   /// \brief Inhibit trace while this is set.
+  /// Checked before any argument is formatted, so filtered callbacks cost
+  /// only the filter lookup.
   bool DisableTrace;
 
   Preprocessor &PP;
@@ -42,6 +42,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GlobPattern.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
@@ -68,6 +69,17 @@ static cl::opt<std::string> OutputFileName(
     cl::desc("Output trace to the given file name or '-' for stdout."),
     cl::cat(Cat));
 
+enum class OutputFormatTy { YAML, JSONLines };
+
+static cl::opt<OutputFormatTy> OutputFormat(
+    "output-format", cl::init(OutputFormatTy::YAML),
+    cl::desc("Format of the trace."),
+    cl::values(clEnumValN(OutputFormatTy::YAML, "yaml",
+                          "A YAML document per translation unit (default)"),
+               clEnumValN(OutputFormatTy::JSONLines, "jsonl",
+                          "A JSON object per line for each callback")),
+    cl::cat(Cat));
+
 LLVM_ATTRIBUTE_NORETURN static void error(Twine Message) {
   WithColor::error() << Message << '\n';
   exit(1);
@@ -75,48 +87,88 @@ LLVM_ATTRIBUTE_NORETURN static void error(Twine Message) {
 
 namespace {
 
+// Writes a YAML document per translation unit, with a sequence entry per
+// callback.
+class YAMLCallbackWriter : public CallbackWriter {
+public:
+  YAMLCallbackWriter(raw_ostream &OS) : OS(OS) {}
+
+  void beginTrace() override { OS << "---\n"; }
+
+  void write(const CallbackCall &Callback) override {
+    OS << "- Callback: " << Callback.Name << "\n";
+    for (const Argument &Arg : Callback.Arguments)
+      OS << "  " << Arg.Name << ": " << Arg.Value << "\n";
+  }
+
+  void endTrace() override { OS << "...\n"; }
+
+private:
+  raw_ostream &OS;
+};
+
+// Writes a JSON object per callback, one per line, with the callback name
+// followed by the arguments in order.
+class JSONLinesCallbackWriter : public CallbackWriter {
+public:
+  JSONLinesCallbackWriter(raw_ostream &OS) : OS(OS) {}
+
+  void write(const CallbackCall &Callback) override {
+    OS << "{\"Callback\":" << json::Value(Callback.Name);
+    for (const Argument &Arg : Callback.Arguments)
+      OS << "," << json::Value(Arg.Name) << ":"
+         << json::Value(json::fixUTF8(Arg.Value));
+    OS << "}\n";
+  }
+
+private:
+  raw_ostream &OS;
+};
+
 class PPTraceAction : public ASTFrontendAction {
 public:
-  PPTraceAction(const FilterType &Filters, raw_ostream &OS)
-      : Filters(Filters), OS(OS) {}
+  PPTraceAction(const FilterType &Filters, CallbackWriter &Writer)
+      : Filters(Filters), Writer(Writer), Tracker(nullptr) {}
 
 protected:
   std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
                                                  StringRef InFile) override {
     Preprocessor &PP = CI.getPreprocessor();
-    PP.addPPCallbacks(
-        llvm::make_unique<PPCallbacksTracker>(Filters, CallbackCalls, PP));
+    auto Callbacks = llvm::make_unique<PPCallbacksTracker>(Filters, Writer, PP);
+    Tracker = Callbacks.get();
+    PP.addPPCallbacks(std::move(Callbacks));
+    Writer.beginTrace();
     return llvm::make_unique<ASTConsumer>();
   }
 
   void EndSourceFileAction() override {
-    OS << "---\n";
-    for (const CallbackCall &Callback : CallbackCalls) {
-      OS << "- Callback: " << Callback.Name << "\n";
-      for (const Argument &Arg : Callback.Arguments)
-        OS << "  " << Arg.Name << ": " << Arg.Value << "\n";
-    }
-    OS << "...\n";
-
-    CallbackCalls.clear();
+    if (!Tracker)
+      return;
+    Tracker->flush();
+    Writer.endTrace();
+    Tracker = nullptr;
   }
 
 private:
   const FilterType &Filters;
-  raw_ostream &OS;
-  std::vector<CallbackCall> CallbackCalls;
+  CallbackWriter &Writer;
+  // Owned by the preprocessor.
+  PPCallbacksTracker *Tracker;
 };
 
 class PPTraceFrontendActionFactory : public tooling::FrontendActionFactory {
 public:
-  PPTraceFrontendActionFactory(const FilterType &Filters, raw_ostream &OS)
-      : Filters(Filters), OS(OS) {}
+  PPTraceFrontendActionFactory(const FilterType &Filters,
+                               CallbackWriter &Writer)
+      : Filters(Filters), Writer(Writer) {}
 
-  PPTraceAction *create() override { return new PPTraceAction(Filters, OS); }
+  PPTraceAction *create() override {
+    return new PPTraceAction(Filters, Writer);
+  }
 
 private:
   const FilterType &Filters;
-  raw_ostream &OS;
+  CallbackWriter &Writer;
 };
 } // namespace
 } // namespace pp_trace
@@ -152,7 +204,12 @@ int main(int argc, const char **argv) {
   llvm::ToolOutputFile Out(OutputFileName, EC, llvm::sys::fs::F_Text);
   if (EC)
     error(EC.message());
-  PPTraceFrontendActionFactory Factory(Filters, Out.os());
+  std::unique_ptr<CallbackWriter> Writer;
+  if (OutputFormat == OutputFormatTy::JSONLines)
+    Writer = llvm::make_unique<JSONLinesCallbackWriter>(Out.os());
+  else
+    Writer = llvm::make_unique<YAMLCallbackWriter>(Out.os());
+  PPTraceFrontendActionFactory Factory(Filters, *Writer);
   int HadErrors = Tool.run(&Factory);
 
   // If we had errors, exit early.
@@ -0,0 +1,128 @@
+//===-- ShardedExecution.cpp - Run a tool over part of a project ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ShardedExecution.h"
+#include "clang/Tooling/AllTUsExecution.h"
+#include "clang/Tooling/CommonOptionsParser.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/Execution.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/DJB.h"
+#include "llvm/Support/Error.h"
+
+namespace clang {
+namespace tooling {
+
+llvm::cl::opt<unsigned>
+    ShardIndex("shard-index",
+               llvm::cl::desc("The shard of the files of the compilation "
+                              "database that the sharded executor runs over, "
+                              "from 0 to --shard-count - 1."),
+               llvm::cl::init(0));
+
+llvm::cl::opt<unsigned>
+    ShardCount("shard-count",
+               llvm::cl::desc("The number of shards that the sharded executor "
+                              "splits the files of the compilation database "
+                              "into."),
+               llvm::cl::init(1));
+
+unsigned getShard(llvm::StringRef File, unsigned Count) {
+  return llvm::djbHash(File) % Count;
+}
+
+namespace {
+
+/// The files of a compilation database that belong to one shard.
+class ShardedCompilationDatabase : public CompilationDatabase {
+public:
+  ShardedCompilationDatabase(CommonOptionsParser Options, unsigned Index,
+                             unsigned Count)
+      : Options(llvm::make_unique<CommonOptionsParser>(std::move(Options))),
+        Index(Index), Count(Count) {}
+
+  std::vector<CompileCommand>
+  getCompileCommands(StringRef FilePath) const override {
+    return Options->getCompilations().getCompileCommands(FilePath);
+  }
+
+  std::vector<std::string> getAllFiles() const override {
+    std::vector<std::string> Files = Options->getCompilations().getAllFiles();
+    llvm::erase_if(Files, [&](const std::string &File) {
+      return getShard(File, Count) != Index;
+    });
+    return Files;
+  }
+
+private:
+  // Owns the whole compilation database.
+  std::unique_ptr<CommonOptionsParser> Options;
+  unsigned Index;
+  unsigned Count;
+};
+
+/// Owns the database of the shard. It's a base of ShardedToolExecutor so that
+/// it is constructed before the executor that runs over it.
+struct ShardStorage {
+  ShardStorage(std::unique_ptr<CompilationDatabase> Shard)
+      : Shard(std::move(Shard)) {}
+
+  std::unique_ptr<CompilationDatabase> Shard;
+};
+
+/// Runs FrontendActions on the files of a shard, in parallel, like the all-TUs
+/// executor.
+class ShardedToolExecutor : private ShardStorage, public AllTUsToolExecutor {
+public:
+  static const char *ExecutorName;
+
+  ShardedToolExecutor(std::unique_ptr<CompilationDatabase> Shard,
+                      unsigned ThreadCount)
+      : ShardStorage(std::move(Shard)),
+        AllTUsToolExecutor(*this->Shard, ThreadCount) {}
+
+  StringRef getExecutorName() const override { return ExecutorName; }
+};
+
+const char *ShardedToolExecutor::ExecutorName = "ShardedToolExecutor";
+
+class ShardedToolExecutorPlugin : public ToolExecutorPlugin {
+public:
+  llvm::Expected<std::unique_ptr<ToolExecutor>>
+  create(CommonOptionsParser &OptionsParser) override {
+    if (OptionsParser.getSourcePathList().empty())
+      return llvm::createStringError(
+          llvm::inconvertibleErrorCode(),
+          "[ShardedToolExecutorPlugin] Please provide a directory/file path in "
+          "the compilation database.");
+    if (ShardIndex >= ShardCount)
+      return llvm::createStringError(
+          llvm::inconvertibleErrorCode(),
+          "[ShardedToolExecutorPlugin] --shard-index must be less than "
+          "--shard-count.");
+    return llvm::make_unique<ShardedToolExecutor>(
+        llvm::make_unique<ShardedCompilationDatabase>(
+            std::move(OptionsParser), ShardIndex, ShardCount),
+        ExecutorConcurrency);
+  }
+};
+
+} // namespace
+
+static ToolExecutorPluginRegistry::Add<ShardedToolExecutorPlugin>
+    X("sharded", "Runs FrontendActions on the files of one shard of the "
+                 "compilation database, selected by --shard-index and "
+                 "--shard-count. Each shard runs in its own process, possibly "
+                 "on another host.");
+
+// This anchor is used to force the linker to link in the generated object file
+// and thus register the plugin.
+volatile int ShardedToolExecutorAnchorSource = 0;
+
+} // namespace tooling
+} // namespace clang
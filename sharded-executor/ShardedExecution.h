@@ -0,0 +1,49 @@
+//===-- ShardedExecution.h - Run a tool over part of a project --*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The "sharded" executor runs a tool over one shard of the files of a
+// compilation database, like the all-TUs executor does over all of them:
+//
+//   $ tool --executor=sharded --shard-index=3 --shard-count=16 \
+//       compile_commands.json
+//
+// Files are assigned to shards by a hash of their path, so runs of the same
+// tool on different processes or machines with the same --shard-count process
+// disjoint sets of files that cover the project. Each run writes its partial
+// results, and the tool's merge step combines them.
+//
+// Tools using the executor include this header, which links it in.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_SHARDED_EXECUTOR_SHARDEDEXECUTION_H
+#define LLVM_CLANG_TOOLS_EXTRA_SHARDED_EXECUTOR_SHARDEDEXECUTION_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compiler.h"
+
+namespace clang {
+namespace tooling {
+
+extern llvm::cl::opt<unsigned> ShardIndex;
+extern llvm::cl::opt<unsigned> ShardCount;
+
+/// Returns the shard \p File belongs to, among \p Count. The result only
+/// depends on the path, so it is the same on every host.
+unsigned getShard(llvm::StringRef File, unsigned Count);
+
+// This anchor is used to force the linker to link the sharded executor.
+extern volatile int ShardedToolExecutorAnchorSource;
+static int LLVM_ATTRIBUTE_UNUSED ShardedToolExecutorAnchorDestination =
+    ShardedToolExecutorAnchorSource;
+
+} // namespace tooling
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_SHARDED_EXECUTOR_SHARDEDEXECUTION_H
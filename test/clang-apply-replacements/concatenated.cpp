@@ -0,0 +1,6 @@
+// RUN: mkdir -p %T/Inputs/concatenated
+// RUN: grep -Ev "// *[A-Z-]+:" %S/Inputs/basic/basic.h > %T/Inputs/concatenated/basic.h
+// RUN: sed -e "s#\$(path)#%/T/Inputs/concatenated#" -e "s#/\.\./basic/#/../concatenated/#" %S/Inputs/basic/file1.yaml > %T/Inputs/concatenated/fixes.yaml
+// RUN: sed -e "s#\$(path)#%/T/Inputs/concatenated#" -e "s#/\.\./basic/#/../concatenated/#" %S/Inputs/basic/file2.yaml >> %T/Inputs/concatenated/fixes.yaml
+// RUN: clang-apply-replacements %T/Inputs/concatenated
+// RUN: FileCheck -input-file=%T/Inputs/concatenated/basic.h %S/Inputs/basic/basic.h
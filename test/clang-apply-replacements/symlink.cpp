@@ -0,0 +1,12 @@
+// REQUIRES: shell
+// RUN: rm -rf %T/Inputs/symlink
+// RUN: mkdir -p %T/Inputs/symlink/real
+// RUN: grep -Ev "// *[A-Z-]+:" %S/Inputs/basic/basic.h > %T/Inputs/symlink/real/basic.h
+// RUN: ln -s real/basic.h %T/Inputs/symlink/basic.h
+// RUN: sed "s#\$(path)#%/T/Inputs/symlink#" %S/Inputs/basic/file1.yaml > %T/Inputs/symlink/file1.yaml
+// RUN: sed "s#\$(path)#%/T/Inputs/symlink#" %S/Inputs/basic/file2.yaml > %T/Inputs/symlink/file2.yaml
+// RUN: clang-apply-replacements %T/Inputs/symlink
+//
+// Files are changed through symlinks, which are left in place.
+// RUN: test -L %T/Inputs/symlink/basic.h
+// RUN: FileCheck -input-file=%T/Inputs/symlink/real/basic.h %S/Inputs/basic/basic.h
@@ -0,0 +1,13 @@
+// RUN: echo "namespace na { namespace nb { class A {}; } }" > %T/parallel.h
+// RUN: echo '#include "parallel.h"' > %T/parallel1.cpp
+// RUN: echo '#include "parallel.h"' > %T/parallel2.cpp
+// RUN: clang-change-namespace -old_namespace "na::nb" -new_namespace "x::y" --file_pattern ".*" -j 2 --i %T/parallel1.cpp %T/parallel2.cpp --
+// RUN: FileCheck -input-file=%T/parallel.h %s
+
+// The header is rewritten once even though both files report the same edits.
+// CHECK: namespace x {
+// CHECK-NEXT: namespace y {
+// CHECK-NEXT: class A {};
+// CHECK-NEXT: } // namespace y
+// CHECK-NEXT: } // namespace x
+// CHECK-NOT: namespace
@@ -0,0 +1,17 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: echo "" > %t/compile_flags.txt
+// RUN: cp "%s" "%t/test.cpp"
+// RUN: clang-doc --executor=standalone -p %t %t/test.cpp -output=%t/docs -bundle
+// RUN: cat %t/docs/docs.yaml | FileCheck %s
+// RUN: not ls %t/docs/GlobalNamespace.yaml
+// RUN: rm -rf %t
+
+namespace A {
+void f();
+}
+void g();
+
+// CHECK: Name: {{ *}}'A'
+// CHECK: Name: {{ *}}'f'
+// CHECK: Name: {{ *}}'g'
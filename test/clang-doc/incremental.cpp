@@ -0,0 +1,21 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: echo "" > %t/compile_flags.txt
+// RUN: cp "%s" "%t/test.cpp"
+// RUN: clang-doc --executor=standalone -p %t %t/test.cpp -output=%t/docs -incremental
+// RUN: ls %t/docs/.clang-doc-hashes | FileCheck %s --check-prefix=HASHES
+// RUN: echo "edited" > %t/docs/GlobalNamespace.yaml
+// RUN: clang-doc --executor=standalone -p %t %t/test.cpp -output=%t/docs -incremental
+// RUN: cat %t/docs/GlobalNamespace.yaml | FileCheck %s --check-prefix=UNCHANGED
+// RUN: echo "void other();" >> %t/test.cpp
+// RUN: clang-doc --executor=standalone -p %t %t/test.cpp -output=%t/docs -incremental
+// RUN: cat %t/docs/GlobalNamespace.yaml | FileCheck %s --check-prefix=CHANGED
+// RUN: rm -rf %t
+
+void function(int x);
+
+// HASHES: {{[0-9A-F]+}}.yaml
+
+// UNCHANGED: edited
+
+// CHANGED: Name: {{ *}}'other'
@@ -0,0 +1,18 @@
+// RUN: rm -rf %t
+// RUN: mkdir -p %t/shards
+// RUN: cp "%s" "%t/a.cpp"
+// RUN: echo "void g();" > %t/b.cpp
+// RUN: echo '[{"directory": "%/t", "command": "clang++ -c a.cpp", "file": "a.cpp"}, {"directory": "%/t", "command": "clang++ -c b.cpp", "file": "b.cpp"}]' > %t/compile_commands.json
+// RUN: clang-doc --executor=sharded --shard-index=0 --shard-count=2 %t/compile_commands.json --shard-output=%t/shards/0.bc
+// RUN: clang-doc --executor=sharded --shard-index=1 --shard-count=2 %t/compile_commands.json --shard-output=%t/shards/1.bc
+// RUN: clang-doc --merge-dir=%t/shards -output=%t/docs -bundle
+// RUN: cat %t/docs/docs.yaml | FileCheck %s
+// RUN: rm -rf %t
+
+namespace A {
+void f();
+}
+
+// CHECK: Name: {{ *}}'A'
+// CHECK: Name: {{ *}}'f'
+// CHECK: Name: {{ *}}'g'
@@ -0,0 +1,11 @@
+// RUN: rm -rf %t.dir && mkdir -p %t.dir
+// RUN: cp %p/Inputs/fake_yaml_db.yaml %t.dir/
+// RUN: find-all-symbols -merge-dir=%t.dir -binary %t.bin
+// RUN: sed -e 's#//.*$##' %s > %t.cpp
+// RUN: clang-include-fixer -db=binary -input=%t.bin %t.cpp --
+// RUN: FileCheck %s -input-file=%t.cpp
+
+// CHECK: #include "foo.h"
+// CHECK: b::a::foo f;
+
+b::a::foo f;
@@ -0,0 +1,13 @@
+// RUN: echo "foo f;" > %t.cpp
+// RUN: echo '{"Command": "output-headers", "FilePath": "%/t.cpp"}' > %t.requests
+// RUN: echo '{"Command": "output-headers", "FilePath": "%/t.cpp", "Code": "bar b;"}' >> %t.requests
+// RUN: echo '{"Command": "query-symbol", "FilePath": "%/t.cpp", "Symbol": "foo"}' >> %t.requests
+// RUN: echo '{"Command": "insert-header", "Code": "foo f;", "Context": {"FilePath": "%/t.cpp", "QuerySymbolInfos": [{"RawIdentifier": "foo", "Range": {"Offset": 0, "Length": 3}}], "HeaderInfos": [{"Header": "\"foo.h\"", "QualifiedName": "foo"}]}}' >> %t.requests
+// RUN: echo '{"Command": "frobnicate"}' >> %t.requests
+// RUN: clang-include-fixer -server -db=fixed -input='foo= "foo.h","bar.h";bar=bar.h' %t.cpp -- < %t.requests | FileCheck %s
+//
+// CHECK: "HeaderInfos":[{"Header":"\"foo.h\"","QualifiedName":"foo"},{"Header":"\"bar.h\"","QualifiedName":"foo"}]
+// CHECK-NEXT: "HeaderInfos":[{"Header":"\"bar.h\"","QualifiedName":"bar"}]
+// CHECK-NEXT: "HeaderInfos":[{"Header":"\"foo.h\"","QualifiedName":"foo"},{"Header":"\"bar.h\"","QualifiedName":"foo"}]
+// CHECK-NEXT: {"Code":"#include \"foo.h\"\n
+// CHECK-NEXT: {"Error":"Unknown command 'frobnicate'."}
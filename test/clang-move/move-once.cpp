@@ -0,0 +1,28 @@
+// RUN: mkdir -p %T/move-once/build
+// RUN: mkdir -p %T/move-once/include
+// RUN: mkdir -p %T/move-once/src
+// RUN: sed 's|$test_dir|%/T/move-once|g' %S/Inputs/database_move_once_template.json > %T/move-once/compile_commands.json
+// RUN: cp %S/Inputs/test.h  %T/move-once/include
+// RUN: cp %S/Inputs/test.cpp %T/move-once/src
+// RUN: echo '#include "test.h"' > %T/move-once/src/user.cpp
+// RUN: touch %T/move-once/include/test2.h
+// RUN: cd %T/move-once/build
+// RUN: clang-move -move_once -names="a::Foo" -new_cc=%T/move-once/new_test.cpp -new_header=%T/move-once/new_test.h -old_cc=../src/test.cpp -old_header=../include/test.h %T/move-once/src/user.cpp %T/move-once/src/test.cpp
+// RUN: FileCheck -input-file=%T/move-once/new_test.cpp -check-prefix=CHECK-NEW-TEST-CPP %s
+// RUN: FileCheck -input-file=%T/move-once/new_test.h -check-prefix=CHECK-NEW-TEST-H %s
+// RUN: FileCheck -input-file=%T/move-once/src/test.cpp -check-prefix=CHECK-OLD-TEST-EMPTY -allow-empty %s
+// RUN: FileCheck -input-file=%T/move-once/include/test.h -check-prefix=CHECK-OLD-TEST-EMPTY -allow-empty %s
+//
+// CHECK-NEW-TEST-H: namespace a {
+// CHECK-NEW-TEST-H: class Foo {
+// CHECK-NEW-TEST-H:   int f();
+// CHECK-NEW-TEST-H:   int f2(int a, int b);
+// CHECK-NEW-TEST-H: } // namespace a
+//
+// CHECK-NEW-TEST-CPP: #include "{{.*}}new_test.h"
+// CHECK-NEW-TEST-CPP: namespace a {
+// CHECK-NEW-TEST-CPP: int Foo::f() { return 0; }
+// CHECK-NEW-TEST-CPP: int Foo::f2(int a, int b) { return a + b; }
+// CHECK-NEW-TEST-CPP: } // namespace a
+//
+// CHECK-OLD-TEST-EMPTY: {{^}}{{$}}
@@ -0,0 +1,8 @@
+// RUN: clang-query -c "match functionDecl()" -c reload -c "match functionDecl()" %s -- | FileCheck %s
+// RUN: clang-query -preamble -c "match functionDecl()" -c reload -c "match functionDecl()" %s -- | FileCheck %s
+
+// CHECK: reload.c:8:1: note: "root" binds here
+// CHECK: 1 match.
+// CHECK: reload.c:8:1: note: "root" binds here
+// CHECK: 1 match.
+void foo(void) {}
@@ -0,0 +1,10 @@
+// RUN: clang-query -stream -j 2 -c "match functionDecl()" %s %S/Inputs/stream-other.c -- | FileCheck %s
+// RUN: not clang-query -stream %s -- 2>&1 | FileCheck --check-prefix=CHECK-NOCOMMANDS %s
+
+// CHECK: stream.c:8:1: note: "root" binds here
+// CHECK: 1 match.
+// CHECK: stream-other.c:1:1: note: "root" binds here
+// CHECK: 1 match.
+void foo(void) {}
+
+// CHECK-NOCOMMANDS: --stream requires -c or -f
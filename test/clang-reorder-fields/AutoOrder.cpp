@@ -0,0 +1,19 @@
+// RUN: clang-reorder-fields -record-name Foo -auto-order %s -- -target x86_64-unknown-linux | FileCheck %s
+// RUN: clang-reorder-fields -record-name Packed -auto-order %s -- -target x86_64-unknown-linux | FileCheck --check-prefix=CHECK-PACKED %s
+
+struct Foo {
+  char a;   // CHECK:      {{^  double b;}}
+  double b; // CHECK-NEXT: {{^  int d;}}
+  char c;   // CHECK-NEXT: {{^  char a;}}
+  int d;    // CHECK-NEXT: {{^  char c;}}
+};
+
+struct __attribute__((packed)) Packed {
+  char a;   // CHECK-PACKED:      {{^  char a;}}
+  double b; // CHECK-PACKED-NEXT: {{^  double b;}}
+};
+
+int main() {
+  Foo foo = { 'a', 1.5, 'c', 3 }; // CHECK: {{^  Foo foo = { 1.5, 3, 'a', 'c' };}}
+  return 0;
+}
@@ -0,0 +1,26 @@
+// RUN: echo "# Records to reorder" > %t.spec
+// RUN: echo "::bar::Foo z,w,y,x" >> %t.spec
+// RUN: echo "Bar c,a,b" >> %t.spec
+// RUN: clang-reorder-fields -spec-file %t.spec %s -- | FileCheck %s
+
+namespace bar {
+struct Foo {
+  const int* x; // CHECK:      {{^  double z;}}
+  int y;        // CHECK-NEXT: {{^  int w;}}
+  int w;        // CHECK-NEXT: {{^  int y;}}
+  double z;     // CHECK-NEXT: {{^  const int\* x;}}
+};
+} // end namespace bar
+
+struct Bar {
+  char a;       // CHECK:      {{^  long c;}}
+  int b;        // CHECK-NEXT: {{^  char a;}}
+  long c;       // CHECK-NEXT: {{^  int b;}}
+};
+
+int main() {
+  const int x = 13;
+  bar::Foo foo = { &x, 0, 1, 1.29 }; // CHECK: {{^  bar::Foo foo = { 1.29, 1, 0, &x };}}
+  Bar b = { 'a', 1, 2 };              // CHECK: {{^  Bar b = { 2, 'a', 1 };}}
+  return 0;
+}
@@ -0,0 +1,3 @@
+#ifndef WRONG_GUARD // NOLINT
+#define WRONG_GUARD
+#endif
@@ -0,0 +1,5 @@
+#ifndef HEADER_H
+#define HEADER_H
+int *Header = 0;
+int *Suppressed = 0; // NOLINT
+#endif
@@ -0,0 +1,7 @@
+namespace std {
+template <typename T>
+struct basic_string {
+  basic_string(const T *, int);
+};
+typedef basic_string<char> string;
+} // namespace std
@@ -0,0 +1 @@
+int *Header = 0;
@@ -0,0 +1,5 @@
+#pragma once
+
+struct Header {
+  int *Ptr;
+};
@@ -0,0 +1,7 @@
+// RUN: cp %s %t-a.cpp
+// RUN: cp %s %t-b.cpp
+// RUN: clang-tidy -check-headers-once -header-filter=guard.h -checks='-*,llvm-header-guard' %t-a.cpp %t-b.cpp -- -I%S/Inputs/check-headers-once 2>&1 | FileCheck %s -implicit-check-not='{{warning|error}}:'
+#include "guard.h"
+
+// The guard of the header is only checked by the first file.
+// CHECK: Suppressed 1 warnings (1 NOLINT).
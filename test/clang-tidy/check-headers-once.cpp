@@ -0,0 +1,11 @@
+// RUN: cp %s %t-a.cpp
+// RUN: cp %s %t-b.cpp
+// RUN: clang-tidy -check-headers-once -header-filter=header.h -checks='-*,modernize-use-nullptr' %t-a.cpp %t-b.cpp -- -std=c++11 -I%S/Inputs/check-headers-once 2>&1 | FileCheck %s -implicit-check-not='{{warning|error}}:'
+#include "header.h"
+
+int *p = 0;
+// CHECK-DAG: -a.cpp:[[@LINE-1]]:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK-DAG: -b.cpp:[[@LINE-2]]:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK-DAG: header.h:3:15: warning: use nullptr [modernize-use-nullptr]
+// The NOLINT warning of the header is only found by the first file.
+// CHECK-DAG: Suppressed 1 warnings (1 NOLINT).
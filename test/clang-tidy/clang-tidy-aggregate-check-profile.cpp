@@ -0,0 +1,22 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: clang-tidy -aggregate-check-profile -store-check-profile=%t -checks='-*,readability-function-size' %s %s -- 2>&1 | FileCheck --match-full-lines -implicit-check-not='{{warning:|error:}}' -check-prefix=CHECK-CONSOLE %s
+// RUN: clang-tidy -aggregate-check-profile -j=2 -checks='-*,readability-function-size' %s %s -- 2>&1 | FileCheck --match-full-lines -implicit-check-not='{{warning:|error:}}' -check-prefix=CHECK-CONSOLE %s
+// RUN: %merge_check_profiles %t | FileCheck --match-full-lines -check-prefix=CHECK-CONSOLE %s
+// RUN: %merge_check_profiles -json %t | FileCheck -check-prefix=CHECK-JSON %s
+
+// CHECK-CONSOLE: ===-------------------------------------------------------------------------===
+// CHECK-CONSOLE-NEXT:                 clang-tidy checks profile of 2 translation units
+// CHECK-CONSOLE-NEXT: ===-------------------------------------------------------------------------===
+// CHECK-CONSOLE-NEXT:   Total Wall Time: {{.*}} seconds
+// CHECK-CONSOLE-EMPTY:
+// CHECK-CONSOLE-NEXT: {{.*}}  TUs  --- Name ---
+// CHECK-CONSOLE-NEXT: {{.*}}    2  readability-function-size (slowest: {{.*}}clang-tidy-aggregate-check-profile.cpp)
+// CHECK-CONSOLE-NOT: clang-tidy checks profil
+
+// CHECK-JSON: "files": 2
+// CHECK-JSON: "name": "readability-function-size"
+
+class A {
+  A() {}
+  ~A() {}
+};
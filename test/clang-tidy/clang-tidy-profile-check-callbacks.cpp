@@ -0,0 +1,24 @@
+// RUN: clang-tidy -profile-check-callbacks -checks='-*,readability-function-size' %s -- 2>&1 | FileCheck --match-full-lines -implicit-check-not='{{warning:|error:}}' -check-prefix=CHECK-CONSOLE %s
+// RUN: rm -rf %t
+// RUN: clang-tidy -profile-check-callbacks -store-check-profile=%t -checks='-*,readability-function-size' %s -- 2>&1
+// RUN: cat %t/*-clang-tidy-profile-check-callbacks.cpp.json | FileCheck -check-prefix=CHECK-FILE %s
+
+// CHECK-CONSOLE: {{.*}}  --- Name ---
+// CHECK-CONSOLE-NEXT: {{.*}}  readability-function-size
+// CHECK-CONSOLE-NEXT: {{.*}}  Total
+// CHECK-CONSOLE: ===-------------------------------------------------------------------------===
+// CHECK-CONSOLE-NEXT:                      clang-tidy check callbacks profiling
+// CHECK-CONSOLE-NEXT: ===-------------------------------------------------------------------------===
+// CHECK-CONSOLE-NEXT: {{.*}}  Calls  --- Name ---
+// CHECK-CONSOLE-DAG: {{.*}}  2  readability-function-size::check()
+// CHECK-CONSOLE-DAG: {{.*}}  2  readability-function-size::check(func)
+// CHECK-CONSOLE-DAG: {{.*}}  0  readability-function-size::matching
+
+// CHECK-FILE: "profile": {
+// CHECK-FILE: "callbacks": {
+// CHECK-FILE-DAG: "readability-function-size::check()": {"calls":2,
+// CHECK-FILE-DAG: "readability-function-size::check(func)": {"calls":2,
+// CHECK-FILE-DAG: "readability-function-size::matching": {"calls":0,
+
+void f() {}
+void g() {}
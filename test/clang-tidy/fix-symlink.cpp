@@ -0,0 +1,15 @@
+// REQUIRES: shell
+// RUN: rm -rf %t
+// RUN: mkdir -p %t/real
+// RUN: echo 'int *a = 0;' > %t/real/a.cpp
+// RUN: echo 'int *b = 0;' > %t/b.cpp
+// RUN: ln -s real/a.cpp %t/a.cpp
+// RUN: clang-tidy %t/a.cpp %t/b.cpp -checks='-*,modernize-use-nullptr' -fix -j=0 -- -std=c++11
+//
+// Files are changed through symlinks, which are left in place.
+// RUN: test -L %t/a.cpp
+// RUN: FileCheck -input-file=%t/real/a.cpp -check-prefix=CHECK-A %s
+// RUN: FileCheck -input-file=%t/b.cpp -check-prefix=CHECK-B %s
+
+// CHECK-A: int *a = nullptr;
+// CHECK-B: int *b = nullptr;
@@ -0,0 +1,15 @@
+// RUN: clang-tidy -checks='-*,google-explicit-constructor' -line-filter='[{"name":"line-filter-skip-unchanged-decls.cpp","lines":[[7,7]]}]' -skip-unchanged-decls %s -- 2>&1 | FileCheck %s
+
+class A { A(int); };
+// CHECK-NOT: :[[@LINE-1]]:{{.*}} warning
+
+class B {
+  B(int);
+};
+// CHECK: :[[@LINE-2]]:3: warning: single-argument constructors {{.*}}
+
+class C { C(int); };
+// CHECK-NOT: :[[@LINE-1]]:{{.*}} warning
+
+// The other declarations aren't matched, so there is nothing to suppress.
+// CHECK-NOT: Suppressed
@@ -0,0 +1,7 @@
+// RUN: cp %s %t-a.cpp
+// RUN: cp %s %t-b.cpp
+// RUN: clang-tidy -j=2 -checks='-*,modernize-use-nullptr' %t-a.cpp %t-b.cpp -- -std=c++11 | FileCheck %s -implicit-check-not='{{warning|error}}:'
+
+int *p = 0;
+// CHECK: -a.cpp:[[@LINE-1]]:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK: -b.cpp:[[@LINE-2]]:10: warning: use nullptr [modernize-use-nullptr]
@@ -0,0 +1,130 @@
+// RUN: %check_clang_tidy %s performance-exception-overhead %t -- -- -fexceptions
+
+typedef decltype(sizeof(0)) size_t;
+
+struct ParseError {};
+
+int parse(int X) {
+  if (X < 0)
+    throw ParseError();
+  return X;
+}
+
+int unknown(int X);
+
+void controlFlow(int *Values, int N) {
+  int Sum = 0;
+  for (int I = 0; I < N; ++I) {
+    try {
+      Sum += parse(Values[I]);
+    } catch (const ParseError &) {
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: exception ignored in a loop is used for control flow; throwing is much slower than returning, consider reporting the failure with the return value [performance-exception-overhead]
+      continue;
+    }
+  }
+
+  while (N--) {
+    try {
+      Sum += unknown(N);
+    } catch (...) {
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: exception ignored in a loop
+    }
+  }
+
+  // The exception is handled.
+  for (int I = 0; I < N; ++I) {
+    try {
+      Sum += parse(Values[I]);
+    } catch (const ParseError &) {
+      Sum = -1;
+    }
+  }
+
+  // The try block can't throw.
+  for (int I = 0; I < N; ++I) {
+    try {
+      Sum += Values[I];
+    } catch (...) {
+    }
+  }
+
+  // Not in a loop.
+  try {
+    Sum += parse(N);
+  } catch (...) {
+  }
+}
+
+struct Buffer {
+  int *Data;
+  size_t Size;
+
+  void swap(Buffer &Other);
+  // CHECK-FIXES: void swap(Buffer &Other) noexcept;
+};
+
+void Buffer::swap(Buffer &Other) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:14: warning: swap function 'swap' can't throw but isn't marked noexcept [performance-exception-overhead]
+  // CHECK-FIXES: void Buffer::swap(Buffer &Other) noexcept {
+  int *D = Data;
+  Data = Other.Data;
+  Other.Data = D;
+  size_t S = Size;
+  Size = Other.Size;
+  Other.Size = S;
+}
+
+void swap(Buffer &A, Buffer &B) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:6: warning: swap function 'swap' can't throw
+  // CHECK-FIXES: void swap(Buffer &A, Buffer &B) noexcept {
+  A.swap(B);
+}
+
+struct BufferHash {
+  size_t operator()(const Buffer &B) const { return B.Size; }
+  // CHECK-MESSAGES: :[[@LINE-1]]:10: warning: hash function 'operator()' can't throw
+  // CHECK-FIXES: size_t operator()(const Buffer &B) const noexcept { return B.Size; }
+};
+
+struct BufferLess {
+  bool operator()(const Buffer &A, const Buffer &B) const {
+    // CHECK-MESSAGES: :[[@LINE-1]]:8: warning: comparison function 'operator()' can't throw
+    // CHECK-FIXES: bool operator()(const Buffer &A, const Buffer &B) const noexcept {
+    return A.Size < B.Size;
+  }
+};
+
+struct Checked {
+  int Value;
+
+  // Already noexcept.
+  void swap(Checked &Other) noexcept { Value = Other.Value; }
+};
+
+// May throw.
+struct CheckedLess {
+  bool operator()(const Checked &A, const Checked &B) const {
+    return parse(A.Value) < parse(B.Value);
+  }
+};
+
+// Calls a function without a definition.
+struct UnknownHash {
+  size_t operator()(int X) const { return unknown(X); }
+};
+
+// Not a hash function.
+struct Negate {
+  int operator()(int X) const { return -X; }
+};
+
+// Not a swap: the types differ.
+void swap(Buffer &A, Checked &B) { A.Size = B.Value; }
+
+// Whether it throws depends on T.
+template <typename T>
+struct Less {
+  bool operator()(const T &A, const T &B) const { return A < B; }
+};
+
+bool less(int A, int B) { return Less<int>()(A, B); }
@@ -0,0 +1,67 @@
+// RUN: %check_clang_tidy %s performance-inefficient-std-function %t
+
+namespace std {
+template <typename> class function;
+template <typename R, typename... Args> class function<R(Args...)> {
+public:
+  function();
+  function(const function &);
+  function(function &&);
+  template <typename F> function(F);
+  template <typename F> function &operator=(F &&);
+  ~function();
+  R operator()(Args...) const;
+  explicit operator bool() const;
+
+private:
+  void *Storage[4];
+};
+} // namespace std
+
+void call(const std::function<void()> &F) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:40: warning: parameter 'F' of type 'std::function<void ()>' is only invoked; consider a template parameter or a non-owning callable reference to avoid the type erasure [performance-inefficient-std-function]
+  if (F)
+    F();
+}
+
+int byValue(std::function<int(int)> F, int N) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:37: warning: parameter 'F' of type 'std::function<int (int)>' is only invoked
+  int Sum = 0;
+  for (int I = 0; I < N; ++I)
+    Sum += F(I);
+  return Sum;
+}
+
+std::function<void()> Global;
+
+void stored(std::function<void()> F) {
+  F();
+  Global = F;
+}
+
+void forwarded(const std::function<void()> &F) {
+  F();
+  call(F);
+}
+
+void captured(const std::function<void()> &F) {
+  auto L = [&] { F(); };
+  L();
+}
+
+void unused(const std::function<void()> &F) {}
+
+struct Base {
+  virtual void method(const std::function<void()> &F) { F(); }
+};
+
+void lambdas(int A, int B, int C, int D, int E) {
+  std::function<int()> Small = [A] { return A; };
+  std::function<int()> Big = [A, B, C, D, E] { return A + B + C + D + E; };
+  // CHECK-MESSAGES: :[[@LINE-1]]:30: warning: lambda captures 20 bytes, more than 'std::function<int ()>' can store inline; converting it allocates memory on the heap [performance-inefficient-std-function]
+  Small = [A, B, C, D, E] { return A + B + C + D + E; };
+  // CHECK-MESSAGES: :[[@LINE-1]]:11: warning: lambda captures 20 bytes
+  call([&] { Small(); });
+  call([A, B, C, D, E] { Global(); });
+  // CHECK-MESSAGES: :[[@LINE-1]]:8: warning: lambda captures 20 bytes
+}
@@ -0,0 +1,78 @@
+// RUN: %check_clang_tidy %s performance-inefficient-string-concatenation %t -- \
+// RUN:   -config="{CheckOptions: [{key: performance-inefficient-string-concatenation.StrictMode, value: 1}, \
+// RUN:                            {key: performance-inefficient-string-concatenation.ConcatFunction, value: 'absl::StrCat'}, \
+// RUN:                            {key: performance-inefficient-string-concatenation.ConcatFunctionHeader, value: 'absl/strings/str_cat.h'}]}" \
+// RUN:   -- -std=c++11
+
+// CHECK-FIXES: #include "absl/strings/str_cat.h"
+
+namespace std {
+template <typename T> class allocator {};
+template <typename T, typename A = allocator<T>> class basic_string {
+public:
+  basic_string();
+  basic_string(const basic_string &);
+  basic_string(const T *, const A & = A());
+  ~basic_string();
+  const T *c_str() const;
+  const T *data() const;
+  T *data();
+};
+template <typename T, typename A>
+basic_string<T, A> operator+(const basic_string<T, A> &,
+                             const basic_string<T, A> &);
+template <typename T, typename A>
+basic_string<T, A> operator+(const basic_string<T, A> &, const T *);
+template <typename T, typename A>
+basic_string<T, A> operator+(const basic_string<T, A> &, T);
+typedef basic_string<char> string;
+typedef basic_string<wchar_t> wstring;
+} // namespace std
+
+void log(const std::string &Message);
+void logWide(const std::wstring &Message);
+void logByValue(std::string Message);
+void print(const char *Message);
+void fill(char *Buffer);
+
+struct Logger {
+  Logger(const std::string &Name);
+};
+
+void concatenations(const std::string &Name, const std::string &Value,
+                    const std::wstring &Wide) {
+  log(Name + ": " + Value);
+  // CHECK-MESSAGES: :[[@LINE-1]]:19: warning: string concatenation results in allocation of unnecessary temporary strings; consider using 'absl::StrCat' instead [performance-inefficient-string-concatenation]
+  // CHECK-FIXES: log(absl::StrCat(Name, ": ", Value));
+  Logger L(Name + "." + Value + ".log");
+  // CHECK-MESSAGES: :[[@LINE-1]]:31: warning: string concatenation
+  // CHECK-FIXES: Logger L(absl::StrCat(Name, ".", Value, ".log"));
+  log(Name + ':' + Value);
+  // CHECK-MESSAGES: :[[@LINE-1]]:18: warning: string concatenation
+  // CHECK-FIXES: log(Name + ':' + Value);
+  logWide(Wide + Wide + Wide);
+  // CHECK-MESSAGES: :[[@LINE-1]]:23: warning: string concatenation
+  // CHECK-FIXES: logWide(Wide + Wide + Wide);
+
+  // A single concatenation needs its temporary anyway.
+  log(Name + Value);
+  logByValue(Name + ": " + Value);
+}
+
+void roundTrips(const std::string &Name, const char *Chars) {
+  print(std::string(Chars).c_str());
+  // CHECK-MESSAGES: :[[@LINE-1]]:28: warning: a temporary string is constructed only to call 'c_str()' on it; use the original characters directly [performance-inefficient-string-concatenation]
+  // CHECK-FIXES: print(Chars);
+  print(std::string(Chars + 1).c_str());
+  // CHECK-MESSAGES: :[[@LINE-1]]:32: warning: a temporary string is constructed only to call 'c_str()'
+  // CHECK-FIXES: print((Chars + 1));
+  print(std::string(Name).c_str());
+  // CHECK-MESSAGES: :[[@LINE-1]]:27: warning: a temporary string is constructed only to call 'c_str()' on it; use the original string directly
+  // CHECK-FIXES: print(Name.c_str());
+
+  // The callee may write into the copy.
+  fill(std::string(Chars).data());
+  print(std::string(Name).data());
+  print(std::string().c_str());
+  print(Name.c_str());
+}
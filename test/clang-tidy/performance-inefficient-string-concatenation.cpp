@@ -15,6 +15,7 @@ typedef basic_string<wchar_t> wstring;
 
 void f(std::string) {}
 std::string g(std::string) {}
+void h(const std::string &) {}
 
 int main() {
   std::string mystr1, mystr2;
@@ -25,6 +26,8 @@ int main() {
   for (int i = 0; i < 10; ++i) {
     f(mystr1 + mystr2 + mystr1);
     // CHECK-MESSAGES: :[[@LINE-1]]:23: warning: string concatenation results in allocation of unnecessary temporary strings; consider using 'operator+=' or 'string::append()' instead
+    h(mystr1 + mystr2 + mystr1);
+    // CHECK-MESSAGES: :[[@LINE-1]]:23: warning: string concatenation results in allocation of unnecessary temporary strings; consider building the argument with 'string::append()' instead
     mystr1 = mystr1 + mystr2;
     // CHECK-MESSAGES: :[[@LINE-1]]:5: warning: string concatenation
     mystr1 = mystr2 + mystr2 + mystr2;
@@ -44,5 +47,6 @@ int main() {
     f(mystr2 + mystr1);
     mystr1 = g(mystr1);
   }
+  h(mystr1 + mystr2 + mystr1);
   return 0;
 }
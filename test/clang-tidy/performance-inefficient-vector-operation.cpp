@@ -1,4 +1,8 @@
-// RUN: %check_clang_tidy %s performance-inefficient-vector-operation %t -- -format-style=llvm -- --std=c++11
+// RUN: %check_clang_tidy %s performance-inefficient-vector-operation %t -- \
+// RUN: -format-style=llvm \
+// RUN: -config='{CheckOptions: \
+// RUN:  [{key: performance-inefficient-vector-operation.EnableProto, value: 1}]}' \
+// RUN: -- --std=c++11
 
 namespace std {
 
@@ -48,8 +52,61 @@ class vector {
   const_iterator begin() const;
   const_iterator end() const;
 };
+
+template <class Char>
+class basic_string {
+ public:
+  basic_string();
+  void push_back(Char c);
+  void reserve(size_t n);
+  size_t size() const;
+};
+typedef basic_string<char> string;
+
+template <class T1, class T2>
+struct pair {
+  pair(const T1 &, const T2 &);
+};
+
+template <class Key, class T>
+class unordered_map {
+ public:
+  typedef pair<const Key, T> value_type;
+
+  unordered_map();
+  void insert(const value_type &value);
+  template <class... Args> void emplace(Args &&... args);
+  void reserve(size_t n);
+  size_t size() const;
+};
 } // namespace std
 
+namespace proto2 {
+class MessageLite {};
+class Message : public MessageLite {};
+} // namespace proto2
+
+class FooProto : public proto2::Message {
+ public:
+  int *add_x();  // repeated int x;
+  void add_x(int x);
+  void mutable_x();
+  void mutable_y();
+  int add_z() const; // optional add_z;
+};
+
+class BarProto : public proto2::Message {
+ public:
+  int *add_x();
+  void add_x(int x);
+};
+
+struct Holder {
+  std::vector<int> Items;
+
+  void copy();
+};
+
 class Foo {
  public:
   explicit Foo(int);
@@ -68,7 +125,7 @@ void f(std::vector<int>& t) {
     // CHECK-FIXES: v0.reserve(10);
     for (int i = 0; i < 10; ++i)
       v0.push_back(i);
-      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: 'push_back' is called inside a loop; consider pre-allocating the vector capacity before the loop
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: 'push_back' is called inside a loop; consider pre-allocating the container capacity before the loop
   }
   {
     std::vector<int> v1;
@@ -162,6 +219,46 @@ void f(std::vector<int>& t) {
     }
   }
 
+  {
+    std::string s0;
+    // CHECK-FIXES: s0.reserve(10);
+    for (int i = 0; i < 10; ++i)
+      s0.push_back('a');
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: 'push_back' is called
+  }
+  {
+    std::unordered_map<int, int> m0;
+    // CHECK-FIXES: m0.reserve(t.size());
+    for (const auto &e : t) {
+      m0.insert({e, e});
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: 'insert' is called
+    }
+  }
+  {
+    std::unordered_map<int, int> m1;
+    // CHECK-FIXES: m1.reserve(10);
+    for (int i = 0; i < 10; ++i)
+      m1.emplace(i, i);
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: 'emplace' is called
+  }
+  {
+    Holder h;
+    std::vector<int> v13;
+    // CHECK-FIXES: v13.reserve(h.Items.size());
+    for (int e : h.Items) {
+      v13.push_back(e);
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: 'push_back' is called
+    }
+  }
+  {
+    FooProto foo;
+    // CHECK-FIXES: foo.mutable_x()->Reserve(5);
+    for (int i = 0; i < 5; i++) {
+      foo.add_x(i);
+      // CHECK-MESSAGES: :[[@LINE-1]]:7: warning: 'add_x' is called inside a loop; consider pre-allocating the container capacity before the loop
+    }
+  }
+
   // ---- Non-fixed Cases ----
   {
     std::vector<int> z0;
@@ -274,4 +371,37 @@ void f(std::vector<int>& t) {
       z12.push_back(e);
     }
   }
+  {
+    FooProto foo;
+    foo.mutable_x();
+    // CHECK-FIXES-NOT: foo.mutable_x()->Reserve(5);
+    // There is a ref usage of foo before the loop.
+    for (int i = 0; i < 5; i++) {
+      foo.add_x(i);
+    }
+  }
+  {
+    FooProto foo;
+    // CHECK-FIXES-NOT: foo.mutable_z()->Reserve(5);
+    // add_z is the const getter of an optional field.
+    for (int i = 0; i < 5; i++) {
+      foo.add_z();
+    }
+  }
+  {
+    BarProto bar;
+    // CHECK-FIXES-NOT: bar.mutable_x()->Reserve(5);
+    // There is no mutable accessor to reserve the field with.
+    for (int i = 0; i < 5; i++) {
+      bar.add_x(i);
+    }
+  }
+}
+
+void Holder::copy() {
+  std::vector<int> v;
+  // CHECK-FIXES: v.reserve(this->Items.size());
+  for (int e : this->Items)
+    v.push_back(e);
+    // CHECK-MESSAGES: :[[@LINE-1]]:5: warning: 'push_back' is called
 }
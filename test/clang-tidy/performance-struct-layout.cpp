@@ -0,0 +1,89 @@
+// RUN: %check_clang_tidy %s performance-struct-layout %t -- -- -std=c++11 -target x86_64-unknown-unknown
+
+namespace std {
+inline namespace __1 {
+template <typename T> struct atomic {
+  atomic();
+  T Value;
+};
+} // namespace __1
+} // namespace std
+
+struct Padded {
+  // CHECK-MESSAGES: :[[@LINE-1]]:8: warning: 'Padded' is 12 bytes large with 6 bytes of padding; reordering its fields would make it 8 bytes large [performance-struct-layout]
+  // CHECK-MESSAGES: :[[@LINE-2]]:8: note: fields ordered by decreasing alignment; apply with 'clang-reorder-fields -record-name=Padded -fields-order=B,A,C'
+  char A;
+  int B;
+  char C;
+};
+
+namespace ns {
+struct Nested {
+  // CHECK-MESSAGES: :[[@LINE-1]]:8: warning: 'Nested' is 24 bytes large with 12 bytes of padding; reordering its fields would make it 16 bytes large
+  // CHECK-MESSAGES: :[[@LINE-2]]:8: note: {{.*}} -record-name=ns::Nested -fields-order=B,D,A,C'
+  char A;
+  long long B;
+  char C;
+  short D;
+};
+} // namespace ns
+
+struct Small {
+  char A;
+  int B;
+};
+
+struct Packed {
+  char A;
+  int B;
+  char C;
+} __attribute__((packed));
+
+struct BitFields {
+  char A;
+  int B : 4;
+  char C;
+  int D;
+};
+
+struct Base {
+  int I;
+};
+
+struct Derived : Base {
+  char A;
+  int B;
+  char C;
+};
+
+template <typename T> struct Template {
+  char A;
+  T B;
+  char C;
+};
+
+Template<int> Instance;
+
+struct Counters {
+  std::atomic<int> Reads;
+  std::atomic<int> Writes;
+  // CHECK-MESSAGES: :[[@LINE-1]]:20: warning: atomic field 'Writes' shares a cache line with 'Reads'; consider aligning it to a cache line to avoid false sharing [performance-struct-layout]
+  // CHECK-FIXES: alignas(64) std::atomic<int> Writes;
+};
+
+struct SharedDeclaration {
+  std::atomic<int> First, Second;
+  // CHECK-MESSAGES: :[[@LINE-1]]:27: warning: atomic field 'Second' shares a cache line with 'First'
+  // CHECK-FIXES: std::atomic<int> First, Second;
+};
+
+struct Aligned {
+  std::atomic<int> Reads;
+  alignas(64) std::atomic<int> Writes;
+};
+
+struct Separated {
+  std::atomic<int> Reads;
+  char Unused[64];
+  std::atomic<int> Writes;
+};
@@ -0,0 +1,155 @@
+// RUN: %check_clang_tidy %s performance-unnecessary-const-ref-param %t -- \
+// RUN:   -config="{CheckOptions: [{key: performance-unnecessary-const-ref-param.AllowedTypes, value: '::Allowed'}]}" --
+
+struct Point {
+  int X, Y;
+};
+
+struct Large {
+  int Values[16];
+};
+
+struct NonTrivial {
+  NonTrivial(const NonTrivial &);
+  int Value;
+};
+
+struct Allowed {
+  int Value;
+};
+
+struct Incomplete;
+
+namespace std {
+template <typename T> T *addressof(T &Value) { return &Value; }
+template <typename T> struct reference_wrapper {
+  reference_wrapper(T &Value) : Pointer(&Value) {}
+  T *Pointer;
+};
+template <typename T> reference_wrapper<const T> ref(const T &Value) {
+  return reference_wrapper<const T>(Value);
+}
+} // namespace std
+
+double length(const Point &P);
+// CHECK-FIXES: double length(const Point P);
+
+double length(const Point &P) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:28: warning: the parameter 'P' is a const reference to a small, trivially copyable type; consider passing it by value [performance-unnecessary-const-ref-param]
+  // CHECK-FIXES: double length(const Point P) {
+  return P.X * P.X + P.Y * P.Y;
+}
+
+double scale(const double& Factor, double Value) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:28: warning: the parameter 'Factor'
+  // CHECK-FIXES: double scale(const double Factor, double Value) {
+  return Factor * Value;
+}
+
+void unnamed(const int &) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:{{[0-9]+}}: warning: the parameter #1
+  // CHECK-FIXES: void unnamed(const int ) {
+}
+
+int large(const Large &L) { return L.Values[0]; }
+
+int nonTrivial(const NonTrivial &N) { return N.Value; }
+
+int allowed(const Allowed &A) { return A.Value; }
+
+int incomplete(const Incomplete &I);
+
+int nonConst(Point &P) { return P.X; }
+
+int volatileRef(const volatile int &I) { return I; }
+
+int array(const int (&A)[2]) { return A[0]; }
+
+const int *addressTaken(const int &I) { return &I; }
+
+const int &returned(const int &I) { return I; }
+
+const int &pick(const int &A, const int &B) { return A < B ? A : B; }
+
+const int *addressOf(const int &I) { return std::addressof(I); }
+
+std::reference_wrapper<const int> wrapped(const int &I) { return std::ref(I); }
+
+struct View {
+  View(const int &I) : R(I) {}
+  const int &R;
+};
+
+template <typename F> void store(F Function);
+
+void capturedByReference(const int &I) {
+  store([&] { return I; });
+}
+
+void aliased(const int &Value, int *Data) {
+  Data[0] = 0;
+  Data[1] = Value;
+}
+
+int aliasedCall(int *Data) {
+  aliased(Data[0], Data);
+  return Data[1];
+}
+
+int returnedByValue(const int &I) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:32: warning: the parameter 'I'
+  // CHECK-FIXES: int returnedByValue(const int I) {
+  return I;
+}
+
+struct Class {
+  int Value;
+  Class(const Class &Other) : Value(Other.Value) {}
+  Class &operator=(const Class &Other) {
+    Value = Other.Value;
+    return *this;
+  }
+  void method(const int &I);
+  // CHECK-FIXES: void method(const int I);
+  virtual int virtualMethod(const int &I) {
+    // CHECK-MESSAGES: :[[@LINE-1]]:42: warning: the parameter 'I'
+    // CHECK-FIXES: virtual int virtualMethod(const int &I) {
+    return I;
+  }
+};
+
+void Class::method(const int &I) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:31: warning: the parameter 'I'
+  // CHECK-FIXES: void Class::method(const int I) {
+  Value = I;
+}
+
+struct Derived : Class {
+  int virtualMethod(const int &I) override { return I; }
+};
+
+template <typename T>
+T dependent(const T &Value) { return Value; }
+
+int instantiate() { return dependent(1); }
+
+using IntRef = const int &;
+int typedefDecl(IntRef I);
+int typedefDecl(const int &I) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:28: warning: the parameter 'I'
+  // CHECK-FIXES: int typedefDecl(const int &I) {
+  return I;
+}
+
+int referenced(const int &I) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:27: warning: the parameter 'I'
+  // CHECK-FIXES: int referenced(const int &I) {
+  return I;
+}
+int (*Pointer)(const int &) = referenced;
+
+#define REF_PARAM(Name) const int &Name
+int inMacro(REF_PARAM(I)) {
+  // CHECK-MESSAGES: :[[@LINE-1]]:{{[0-9]+}}: warning: the parameter 'I'
+  return I;
+}
@@ -0,0 +1,173 @@
+// RUN: %check_clang_tidy %s performance-unnecessary-copy-on-last-use %t -- -- -fexceptions
+
+// CHECK-FIXES: #include <utility>
+
+struct ExpensiveToCopy {
+  ExpensiveToCopy();
+  ExpensiveToCopy(const ExpensiveToCopy &);
+  ExpensiveToCopy(ExpensiveToCopy &&);
+  ExpensiveToCopy &operator=(const ExpensiveToCopy &);
+  ExpensiveToCopy &operator=(ExpensiveToCopy &&);
+  ~ExpensiveToCopy();
+  void method() const;
+  int *begin();
+  int &operator[](int);
+  int Field;
+};
+
+struct NoMove {
+  NoMove();
+  NoMove(const NoMove &);
+  ~NoMove();
+};
+
+void consume(ExpensiveToCopy);
+void consumeTwice(ExpensiveToCopy, ExpensiveToCopy);
+void consumeNoMove(NoMove);
+void modify(ExpensiveToCopy &);
+void modifyInt(int &);
+void inspect(const ExpensiveToCopy &);
+bool condition();
+
+void passedByValue() {
+  ExpensiveToCopy E;
+  E.method();
+  consume(E);
+  // CHECK-MESSAGES: :[[@LINE-1]]:11: warning: local variable 'E' is copied on its last use; consider moving it to avoid the copy [performance-unnecessary-copy-on-last-use]
+  // CHECK-FIXES: consume(std::move(E));
+}
+
+void parameter(ExpensiveToCopy P, ExpensiveToCopy &Out) {
+  Out = P;
+  // CHECK-MESSAGES: :[[@LINE-1]]:9: warning: parameter 'P' is copied on its last use
+  // CHECK-FIXES: Out = std::move(P);
+}
+
+void initialization(ExpensiveToCopy P) {
+  if (condition()) {
+    ExpensiveToCopy Copy = P;
+    // CHECK-MESSAGES: :[[@LINE-1]]:28: warning: parameter 'P' is copied
+    // CHECK-FIXES: ExpensiveToCopy Copy = std::move(P);
+    return;
+  }
+  P.method();
+}
+
+void usedAfter() {
+  ExpensiveToCopy E;
+  consume(E);
+  E.method();
+}
+
+void usedOnAnotherPath(ExpensiveToCopy P) {
+  if (condition())
+    consume(P);
+  P.method();
+}
+
+void inLoop() {
+  ExpensiveToCopy E;
+  for (int I = 0; I < 10; ++I)
+    consume(E);
+}
+
+void declaredInLoop() {
+  for (int I = 0; I < 10; ++I) {
+    ExpensiveToCopy E;
+    consume(E);
+    // CHECK-MESSAGES: :[[@LINE-1]]:13: warning: local variable 'E' is copied
+    // CHECK-FIXES: consume(std::move(E));
+  }
+}
+
+void copiedTwice(ExpensiveToCopy P) {
+  consumeTwice(P, P);
+}
+
+void aliased() {
+  ExpensiveToCopy E;
+  const ExpensiveToCopy &Ref = E;
+  consume(E);
+  Ref.method();
+}
+
+void memberAliased() {
+  ExpensiveToCopy E;
+  int *Field = &E.Field;
+  consume(E);
+  *Field = 0;
+}
+
+void elementAliased() {
+  ExpensiveToCopy E;
+  int &Element = E[0];
+  consume(E);
+  Element = 0;
+}
+
+void iteratorAliased() {
+  ExpensiveToCopy E;
+  int *It = E.begin();
+  consume(E);
+  *It = 0;
+}
+
+void passedByReference() {
+  ExpensiveToCopy E;
+  modify(E);
+  consume(E);
+}
+
+void memberPassedByReference() {
+  ExpensiveToCopy E;
+  modifyInt(E.Field);
+  consume(E);
+}
+
+void passedByConstReference() {
+  ExpensiveToCopy E;
+  inspect(E);
+  int I = E[0];
+  consume(E);
+  // CHECK-MESSAGES: :[[@LINE-1]]:11: warning: local variable 'E' is copied
+  // CHECK-FIXES: consume(std::move(E));
+}
+
+void usedInHandler() {
+  ExpensiveToCopy E;
+  try {
+    consume(E);
+  } catch (...) {
+    E.method();
+  }
+}
+
+void capturedByReference() {
+  ExpensiveToCopy E;
+  auto Lambda = [&] { E.method(); };
+  consume(E);
+  Lambda();
+}
+
+void capturedByCopy() {
+  ExpensiveToCopy E;
+  auto Lambda = [E] { consume(E); };
+  Lambda();
+}
+
+void constVariable() {
+  const ExpensiveToCopy E;
+  consume(E);
+}
+
+void notMovable() {
+  NoMove N;
+  consumeNoMove(N);
+}
+
+template <typename T>
+void dependent(T P) {
+  consume(P);
+}
+
+void instantiate() { dependent(ExpensiveToCopy()); }
@@ -0,0 +1,145 @@
+// RUN: %check_clang_tidy %s performance-unnecessary-ordered-container %t
+
+namespace std {
+template <typename T>
+struct less {
+  bool operator()(const T &, const T &) const;
+};
+
+template <typename T>
+struct greater {
+  bool operator()(const T &, const T &) const;
+};
+
+template <typename T>
+struct allocator {};
+
+template <typename Char>
+struct basic_string {
+  basic_string(const Char *);
+};
+typedef basic_string<char> string;
+
+template <typename Key, typename T, typename Compare = less<Key>,
+          typename Alloc = allocator<T>>
+struct map {
+  struct iterator {
+    T &operator*() const;
+    bool operator!=(const iterator &) const;
+    iterator &operator++();
+  };
+  iterator begin();
+  iterator end();
+  iterator find(const Key &);
+  iterator lower_bound(const Key &);
+  int count(const Key &) const;
+  T &operator[](const Key &);
+  void insert(const Key &, const T &);
+  void erase(const Key &);
+  int size() const;
+};
+
+template <typename Key, typename Compare = less<Key>,
+          typename Alloc = allocator<Key>>
+struct set {
+  struct iterator {
+    const Key &operator*() const;
+    bool operator!=(const iterator &) const;
+    iterator &operator++();
+  };
+  iterator begin();
+  iterator end();
+  int count(const Key &) const;
+  void insert(const Key &);
+};
+} // namespace std
+
+struct Point {
+  int X, Y;
+  bool operator<(const Point &) const;
+};
+
+void use(const std::map<int, int> &);
+
+int lookups(int K) {
+  std::map<int, int> M;
+  // CHECK-MESSAGES: :[[@LINE-1]]:22: warning: 'M' is only used for lookups; consider using 'std::unordered_map' instead [performance-unnecessary-ordered-container]
+  M[K] = 1;
+  M.insert(2, 3);
+  M.erase(4);
+  if (M.find(K) != M.end())
+    return M.size();
+
+  std::set<std::string> S;
+  // CHECK-MESSAGES: :[[@LINE-1]]:25: warning: 'S' is only used for lookups; consider using 'std::unordered_set' instead
+  S.insert("a");
+  return S.count("b");
+}
+
+class Cache {
+public:
+  int get(int K) { return Values.count(K) ? Values[K] : 0; }
+  int getPublic(int K) { return Public.count(K); }
+
+private:
+  std::map<int, int> Values;
+  // CHECK-MESSAGES: :[[@LINE-1]]:22: warning: 'Values' is only used for lookups; consider using 'std::unordered_map' instead
+  std::map<int, int> Iterated;
+
+public:
+  std::map<int, int> Public;
+
+  int sum() {
+    int Sum = 0;
+    for (int V : Iterated)
+      Sum += V;
+    return Sum;
+  }
+};
+
+int iterated() {
+  std::map<int, int> M;
+  M[1] = 2;
+  int Sum = 0;
+  for (int V : M)
+    Sum += V;
+  return Sum;
+}
+
+int orderedLookup(int K) {
+  std::map<int, int> M;
+  M[1] = 2;
+  return *M.lower_bound(K);
+}
+
+int escapes() {
+  std::map<int, int> M;
+  M[1] = 2;
+  use(M);
+  return M.count(1);
+}
+
+int unhashableKey() {
+  std::set<Point> S;
+  S.insert(Point{1, 2});
+  return S.count(Point{3, 4});
+}
+
+int customComparison() {
+  std::set<int, std::greater<int>> S;
+  S.insert(1);
+  return S.count(2);
+}
+
+int unused() {
+  std::map<int, int> M;
+  return 0;
+}
+
+template <typename T>
+int inTemplate(T K) {
+  std::map<int, int> M;
+  return M.count(K);
+}
+
+int instantiate() { return inTemplate(1); }
@@ -0,0 +1,54 @@
+// RUN: %check_clang_tidy %s performance-virtual-call-in-loop %t
+
+struct Handler {
+  virtual ~Handler();
+  virtual int handle(int Request);
+};
+
+struct Leaf : Handler {
+  // CHECK-MESSAGES: :[[@LINE-1]]:8: warning: 'Leaf' has no derived classes and its virtual methods are called in loops; mark it 'final' to let them be devirtualized [performance-virtual-call-in-loop]
+  // CHECK-FIXES: struct Leaf final : Handler {
+  int handle(int Request) override;
+};
+
+struct Intermediate : Handler {
+  int handle(int Request) override;
+};
+
+struct Derived : Intermediate {};
+
+struct AlreadyFinal final : Handler {
+  int handle(int Request) override;
+};
+
+struct Abstract {
+  virtual int handle(int Request) = 0;
+};
+
+struct FinalMethod : Handler {
+  int handle(int Request) final;
+};
+
+template <typename T> struct Template : Handler {
+  int handle(int Request) override;
+};
+
+int loops(Handler &H, Leaf *L, Intermediate &I, AlreadyFinal &F, Abstract &A,
+          FinalMethod &M, Template<int> &T) {
+  int Sum = 0;
+  for (int R = 0; R < 10; ++R) {
+    Sum += H.handle(R);
+    Sum += L->handle(R);
+    // CHECK-MESSAGES: :[[@LINE-1]]:15: note: virtual call in a loop
+    Sum += I.handle(R);
+    Sum += F.handle(R);
+    Sum += A.handle(R);
+    Sum += M.handle(R);
+    Sum += T.handle(R);
+    Sum += L->Leaf::handle(R);
+  }
+  while (Sum < 100)
+    Sum += L->handle(Sum);
+  // CHECK-MESSAGES: :[[@LINE-1]]:15: note: virtual call in a loop
+  return Sum + L->handle(0);
+}
@@ -0,0 +1,29 @@
+// RUN: clang-tidy -enable-check-profile -checks='-*,bugprone-string-constructor,readability-function-size' %s -- 2>&1 | FileCheck --match-full-lines -implicit-check-not='{{warning:|error:}}' %s
+// RUN: clang-tidy -enable-check-profile -checks='-*,bugprone-string-constructor,readability-function-size' %s -- -DSTRING 2>&1 | FileCheck --match-full-lines -check-prefix=CHECK-STRING %s
+
+// The matchers of bugprone-string-constructor only run in translation units
+// where "basic_string" appears.
+
+// CHECK: {{.*}}  --- Name ---
+// CHECK-NEXT: {{.*}}  readability-function-size
+// CHECK-NEXT: {{.*}}  Total
+
+// CHECK-STRING: {{.*}}  --- Name ---
+// CHECK-STRING-DAG: {{.*}}  bugprone-string-constructor
+// CHECK-STRING-DAG: {{.*}}  readability-function-size
+// CHECK-STRING: {{.*}}  Total
+
+#ifdef STRING
+#include "Inputs/required-identifiers/string.h"
+#endif
+
+struct A {
+  A(const char *, int);
+};
+
+void f() {
+  A a("", 0);
+#ifdef STRING
+  std::string s("", 0);
+#endif
+}
@@ -0,0 +1,17 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo '#define VALUE 1' > %t/header.h
+// RUN: cp %s %t/a.cpp
+// RUN: clang-tidy -result-cache=%t/cache -checks='-*,modernize-use-nullptr' -header-filter=.* %t/a.cpp -- -std=c++11 -I%t | FileCheck %s -implicit-check-not='{{warning|error}}:'
+// RUN: ls %t/cache/* | FileCheck -check-prefix=CHECK-CACHE %s
+// The second run takes the result from the cache.
+// RUN: clang-tidy -result-cache=%t/cache -checks='-*,modernize-use-nullptr' -header-filter=.* %t/a.cpp -- -std=c++11 -I%t | FileCheck %s -implicit-check-not='{{warning|error}}:'
+// Changing a header invalidates the result.
+// RUN: cp %S/Inputs/result-cache/header.h %t/header.h
+// RUN: clang-tidy -result-cache=%t/cache -checks='-*,modernize-use-nullptr' -header-filter=.* %t/a.cpp -- -std=c++11 -I%t | FileCheck -check-prefixes=CHECK,CHECK-HEADER %s -implicit-check-not='{{warning|error}}:'
+#include "header.h"
+
+int *p = 0;
+// CHECK: a.cpp:[[@LINE-1]]:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK-HEADER: header.h:1:15: warning: use nullptr [modernize-use-nullptr]
+
+// CHECK-CACHE: .json
@@ -0,0 +1,20 @@
+// RUN: rm -rf %t
+// RUN: mkdir -p %t
+// RUN: echo 'int *a = 0;' > %t/a.cpp
+// RUN: echo 'int *b = 0;' > %t/b.cpp
+// RUN: printf '%t/a.cpp\n\n%t/b.cpp\n' | clang-tidy -serve -checks='-*,modernize-use-nullptr' -- -std=c++11 | FileCheck -implicit-check-not='{{warning:|error:}}' %s
+// RUN: printf '%t/a.cpp\n' | not clang-tidy -serve -checks='-*,modernize-use-nullptr' -warnings-as-errors='*' -- -std=c++11 2>&1 | FileCheck -check-prefix=CHECK-WERROR %s
+// RUN: echo 'int c = undeclared;' > %t/c.cpp
+// RUN: printf '%t/c.cpp\n%t/b.cpp\n' | not clang-tidy -serve -checks='-*,modernize-use-nullptr' -- -std=c++11 2>&1 | FileCheck -check-prefix=CHECK-ERROR %s
+
+// CHECK: a.cpp:1:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK-NEXT: int *a = 0;
+// CHECK: clang-tidy: done: {{.*}}a.cpp
+// CHECK-NEXT: {{.*}}b.cpp:1:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK: clang-tidy: done: {{.*}}b.cpp
+
+// CHECK-WERROR: a.cpp:1:10: error: use nullptr [modernize-use-nullptr,-warnings-as-errors]
+// CHECK-WERROR: 1 warning treated as error
+
+// CHECK-ERROR: c.cpp:1:9: error: use of undeclared identifier 'undeclared' [clang-diagnostic-error]
+// CHECK-ERROR: Found compiler error(s).
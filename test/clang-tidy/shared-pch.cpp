@@ -0,0 +1,13 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %S/Inputs/shared-pch/header.h %t/header.h
+// RUN: cp %s %t/a.cpp
+// RUN: cp %s %t/b.cpp
+// RUN: clang-tidy -shared-pch-dir=%t/pch -checks='-*,modernize-use-nullptr' %t/a.cpp %t/b.cpp -- -std=c++11 | FileCheck %s -implicit-check-not='{{warning|error}}:'
+// RUN: ls %t/pch | FileCheck -check-prefix=CHECK-PCH %s
+#include "header.h"
+
+Header H = {0};
+// CHECK: a.cpp:[[@LINE-1]]:13: warning: use nullptr [modernize-use-nullptr]
+// CHECK: b.cpp:[[@LINE-2]]:13: warning: use nullptr [modernize-use-nullptr]
+
+// CHECK-PCH: shared-0.pch
@@ -137,6 +137,12 @@ run_clang_tidy = os.path.join(
 config.substitutions.append(
     ('%run_clang_tidy',
      '%s %s' % (config.python_executable, run_clang_tidy)) )
+merge_check_profiles = os.path.join(
+    config.test_source_root, "..", "clang-tidy", "tool",
+    "merge-check-profiles.py")
+config.substitutions.append(
+    ('%merge_check_profiles',
+     '%s %s' % (config.python_executable, merge_check_profiles)) )
 
 clangd_benchmarks_dir = os.path.join(os.path.dirname(config.clang_tools_dir),
                                      "tools", "clang", "tools", "extra",
@@ -0,0 +1,9 @@
+// RUN: pp-trace -callbacks 'MacroDefined,MacroExpands' -output-format=jsonl %s -- -undef | FileCheck --strict-whitespace %s
+
+#define MACRO 1
+int i = MACRO;
+
+// CHECK-NOT: ---
+// CHECK: {"Callback":"MacroDefined","MacroNameTok":"MACRO","MacroDirective":"MD_Define"}
+// CHECK-NEXT: {"Callback":"MacroExpands","MacroNameTok":"MACRO","MacroDefinition":"[(local)]","Range":"[{{.*}}pp-trace-jsonl.cpp:4:9, {{.*}}pp-trace-jsonl.cpp:4:9]","Args":"(null)"}
+// CHECK-NOT: ...
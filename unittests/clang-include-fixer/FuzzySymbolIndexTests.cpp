@@ -8,11 +8,16 @@
 
 #include "FuzzySymbolIndex.h"
 #include "gmock/gmock.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
+using clang::find_all_symbols::SymbolAndSignals;
+using clang::find_all_symbols::SymbolInfo;
 using testing::ElementsAre;
 using testing::Not;
+using testing::UnorderedElementsAre;
 
 namespace clang {
 namespace include_fixer {
@@ -55,6 +60,46 @@ TEST(FuzzySymbolIndexTest, QueryRegexp) {
   EXPECT_THAT(QueryRegexp("UniP"), MatchesSymbol("unique_ptr"));
 }
 
+std::vector<std::string> searchNames(FuzzySymbolIndex &Index,
+                                     llvm::StringRef Query) {
+  std::vector<std::string> Names;
+  for (const SymbolAndSignals &Symbol : Index.search(Query))
+    Names.push_back(Symbol.Symbol.getName());
+  return Names;
+}
+
+TEST(FuzzySymbolIndexTest, Search) {
+  SymbolInfo::SignalMap Symbols;
+  for (const char *Name : {"URLHandlerCallback", "unique_ptr", "UniP", "fe",
+                           "fee_fie_foe", "_", "shared_ptr"})
+    Symbols[SymbolInfo(Name, SymbolInfo::SymbolKind::Class, "a.h", {})] =
+        SymbolInfo::Signals(1, 0);
+  llvm::SmallString<128> Path;
+  int FD;
+  ASSERT_FALSE(
+      llvm::sys::fs::createTemporaryFile("fuzzy-index", "yaml", FD, Path));
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    find_all_symbols::WriteSymbolInfosToStream(OS, Symbols);
+  }
+  auto Index = FuzzySymbolIndex::createFromYAML(Path);
+  llvm::sys::fs::remove(Path);
+  ASSERT_TRUE(bool(Index)) << llvm::toString(Index.takeError());
+
+  EXPECT_THAT(searchNames(**Index, "uhc"), ElementsAre("URLHandlerCallback"));
+  EXPECT_THAT(searchNames(**Index, "urhaca"),
+              ElementsAre("URLHandlerCallback"));
+  EXPECT_THAT(searchNames(**Index, "uhcb"), ElementsAre());
+  EXPECT_THAT(searchNames(**Index, "uptr"), ElementsAre("unique_ptr"));
+  EXPECT_THAT(searchNames(**Index, "u"),
+              UnorderedElementsAre("URLHandlerCallback", "unique_ptr", "UniP"));
+  EXPECT_THAT(searchNames(**Index, "ff"), ElementsAre("fee_fie_foe"));
+  EXPECT_THAT(searchNames(**Index, "Fe"),
+              UnorderedElementsAre("fe", "fee_fie_foe"));
+  EXPECT_THAT(searchNames(**Index, "ptr"), ElementsAre());
+  EXPECT_EQ(7u, searchNames(**Index, "").size());
+}
+
 } // namespace
 } // namespace include_fixer
 } // namespace clang
@@ -0,0 +1,89 @@
+//===-- BinarySymbolDatabaseTests.cpp - binary database unit tests --------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "BinarySymbolDatabase.h"
+#include "SymbolInfo.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace clang {
+namespace find_all_symbols {
+namespace {
+
+SymbolInfo::SignalMap createSymbols() {
+  SymbolInfo::SignalMap Symbols;
+  Symbols[SymbolInfo("foo", SymbolInfo::SymbolKind::Class, "foo.h",
+                     {{SymbolInfo::ContextType::Namespace, "a"},
+                      {SymbolInfo::ContextType::Namespace, "b"}})] =
+      SymbolInfo::Signals(2, 1);
+  Symbols[SymbolInfo("foo", SymbolInfo::SymbolKind::Function, "foo2.h", {})] =
+      SymbolInfo::Signals(1, 0);
+  Symbols[SymbolInfo("bar", SymbolInfo::SymbolKind::EnumConstantDecl,
+                     "bar.h", {{SymbolInfo::ContextType::EnumDecl, "E"}})] =
+      SymbolInfo::Signals(0, 3);
+  return Symbols;
+}
+
+std::string writeBinary(const SymbolInfo::SignalMap &Symbols) {
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  WriteSymbolInfosToBinary(OS, Symbols);
+  return OS.str();
+}
+
+TEST(BinarySymbolDatabaseTest, RoundTrip) {
+  SymbolInfo::SignalMap Symbols = createSymbols();
+  std::string Data = writeBinary(Symbols);
+  EXPECT_TRUE(isBinarySymbolDatabase(Data));
+  auto DB = BinarySymbolDatabase::create(Data);
+  ASSERT_TRUE(bool(DB)) << llvm::toString(DB.takeError());
+
+  std::vector<SymbolAndSignals> All = DB->getAllSymbols();
+  ASSERT_EQ(Symbols.size(), All.size());
+  for (const SymbolAndSignals &Symbol : All) {
+    auto It = Symbols.find(Symbol.Symbol);
+    ASSERT_NE(It, Symbols.end()) << Symbol.Symbol.getName();
+    EXPECT_EQ(It->second, Symbol.Signals);
+  }
+
+  std::vector<SymbolAndSignals> Foos = DB->lookup("foo");
+  ASSERT_EQ(2u, Foos.size());
+  for (const SymbolAndSignals &Symbol : Foos)
+    EXPECT_EQ("foo", Symbol.Symbol.getName());
+  std::vector<SymbolAndSignals> Bars = DB->lookup("bar");
+  ASSERT_EQ(1u, Bars.size());
+  EXPECT_EQ("bar.h", Bars[0].Symbol.getFilePath());
+  ASSERT_EQ(1u, Bars[0].Symbol.getContexts().size());
+  EXPECT_EQ("E", Bars[0].Symbol.getContexts()[0].second);
+  EXPECT_TRUE(DB->lookup("baz").empty());
+}
+
+TEST(BinarySymbolDatabaseTest, EmptyDatabase) {
+  std::string Data = writeBinary({});
+  auto DB = BinarySymbolDatabase::create(Data);
+  ASSERT_TRUE(bool(DB)) << llvm::toString(DB.takeError());
+  EXPECT_TRUE(DB->getAllSymbols().empty());
+  EXPECT_TRUE(DB->lookup("foo").empty());
+}
+
+TEST(BinarySymbolDatabaseTest, RejectsCorruptedData) {
+  std::string Data = writeBinary(createSymbols());
+  auto Truncated =
+      BinarySymbolDatabase::create(llvm::StringRef(Data).drop_back());
+  EXPECT_FALSE(bool(Truncated));
+  llvm::consumeError(Truncated.takeError());
+
+  auto Yaml = BinarySymbolDatabase::create("---\nName: foo\n");
+  EXPECT_FALSE(bool(Yaml));
+  llvm::consumeError(Yaml.takeError());
+}
+
+} // namespace
+} // namespace find_all_symbols
+} // namespace clang
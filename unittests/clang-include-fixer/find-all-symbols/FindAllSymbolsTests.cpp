@@ -573,5 +573,28 @@ TEST_F(FindAllSymbolsTest, NoFriendTest) {
   EXPECT_EQ(0, seen(Symbol));
 }
 
+TEST(HeaderMapCollectorTest, PostfixAndRegexMappings) {
+  HeaderMapCollector::RegexHeaderMap RegexMap = {
+      {"include/a\\.h$", "<a>"},
+      {"bits/b.h$", "<b>"},
+      {"include/(c|d)\\.h$", "<cd>"},
+      {"a\\.h$", "<shadowed>"},
+      {"x\\+\\+\\.h$", "<x>"},
+  };
+  HeaderMapCollector Collector(&RegexMap);
+  EXPECT_EQ("<a>", Collector.getMappedHeader("/usr/include/a.h"));
+  EXPECT_EQ("<shadowed>", Collector.getMappedHeader("/usr/a.h"));
+  EXPECT_EQ("<b>", Collector.getMappedHeader("/usr/bits/b.h"));
+  EXPECT_EQ("<b>", Collector.getMappedHeader("/usr/bits/b_h"));
+  EXPECT_EQ("<cd>", Collector.getMappedHeader("/usr/include/d.h"));
+  EXPECT_EQ("<x>", Collector.getMappedHeader("/usr/x++.h"));
+  EXPECT_EQ("/usr/a.hpp", Collector.getMappedHeader("/usr/a.hpp"));
+
+  unsigned Generation = Collector.getGeneration();
+  Collector.addHeaderMapping("/usr/a.h", "<exact>");
+  EXPECT_NE(Generation, Collector.getGeneration());
+  EXPECT_EQ("<exact>", Collector.getMappedHeader("/usr/a.h"));
+}
+
 } // namespace find_all_symbols
 } // namespace clang
@@ -135,6 +135,28 @@ TEST_F(QueryEngineTest, Basic) {
   EXPECT_EQ("Not a valid top-level matcher.\n", OS.str());
 }
 
+TEST_F(QueryEngineTest, MaxMatchesAndCountOnly) {
+  DynTypedMatcher FnMatcher = functionDecl();
+
+  EXPECT_TRUE(SetQuery<unsigned>(&QuerySession::MaxMatches, 3).run(OS, S));
+  EXPECT_TRUE(MatchQuery("functionDecl()", FnMatcher).run(OS, S));
+
+  EXPECT_TRUE(OS.str().find("bar.cc:1:1: note: \"root\" binds here") !=
+              std::string::npos);
+  EXPECT_TRUE(OS.str().find("bar.cc:2:1: note: \"root\" binds here") ==
+              std::string::npos);
+  EXPECT_TRUE(OS.str().find("3 matches.") != std::string::npos);
+  EXPECT_TRUE(OS.str().find("Stopped at max-matches") != std::string::npos);
+
+  Str.clear();
+
+  EXPECT_TRUE(SetQuery<unsigned>(&QuerySession::MaxMatches, 0).run(OS, S));
+  EXPECT_TRUE(SetQuery<bool>(&QuerySession::CountOnly, true).run(OS, S));
+  EXPECT_TRUE(MatchQuery("functionDecl()", FnMatcher).run(OS, S));
+
+  EXPECT_EQ("4 matches.\n", OS.str());
+}
+
 TEST_F(QueryEngineTest, LetAndMatch) {
   EXPECT_TRUE(QueryParser::parse("let x \"foo1\"", S)->run(OS, S));
   EXPECT_EQ("", OS.str());
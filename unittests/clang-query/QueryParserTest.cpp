@@ -46,6 +46,15 @@ TEST_F(QueryParserTest, Help) {
   EXPECT_EQ("unexpected extra input: ' me'", cast<InvalidQuery>(Q)->ErrStr);
 }
 
+TEST_F(QueryParserTest, Reload) {
+  QueryRef Q = parse("reload");
+  ASSERT_TRUE(isa<ReloadQuery>(Q));
+
+  Q = parse("reload me");
+  ASSERT_TRUE(isa<InvalidQuery>(Q));
+  EXPECT_EQ("unexpected extra input: ' me'", cast<InvalidQuery>(Q)->ErrStr);
+}
+
 TEST_F(QueryParserTest, Quit) {
   QueryRef Q = parse("quit");
   ASSERT_TRUE(isa<QuitQuery>(Q));
@@ -110,6 +119,20 @@ TEST_F(QueryParserTest, Set) {
   ASSERT_TRUE(isa<SetQuery<bool> >(Q));
   EXPECT_EQ(&QuerySession::BindRoot, cast<SetQuery<bool> >(Q)->Var);
   EXPECT_EQ(true, cast<SetQuery<bool> >(Q)->Value);
+
+  Q = parse("set max-matches foo");
+  ASSERT_TRUE(isa<InvalidQuery>(Q));
+  EXPECT_EQ("expected a non-negative integer, got 'foo'",
+            cast<InvalidQuery>(Q)->ErrStr);
+
+  Q = parse("set max-matches 10");
+  ASSERT_TRUE(isa<SetQuery<unsigned>>(Q));
+  EXPECT_EQ(&QuerySession::MaxMatches, cast<SetQuery<unsigned>>(Q)->Var);
+  EXPECT_EQ(10u, cast<SetQuery<unsigned>>(Q)->Value);
+
+  Q = parse("set count-only true");
+  ASSERT_TRUE(isa<SetQuery<bool>>(Q));
+  EXPECT_EQ(&QuerySession::CountOnly, cast<SetQuery<bool>>(Q)->Var);
 }
 
 TEST_F(QueryParserTest, Match) {
@@ -174,7 +197,7 @@ TEST_F(QueryParserTest, Comment) {
 TEST_F(QueryParserTest, Complete) {
   std::vector<llvm::LineEditor::Completion> Comps =
       QueryParser::complete("", 0, QS);
-  ASSERT_EQ(8u, Comps.size());
+  ASSERT_EQ(9u, Comps.size());
   EXPECT_EQ("help ", Comps[0].TypedText);
   EXPECT_EQ("help", Comps[0].DisplayText);
   EXPECT_EQ("let ", Comps[1].TypedText);
@@ -191,6 +214,8 @@ TEST_F(QueryParserTest, Complete) {
   EXPECT_EQ("disable", Comps[6].DisplayText);
   EXPECT_EQ("unlet ", Comps[7].TypedText);
   EXPECT_EQ("unlet", Comps[7].DisplayText);
+  EXPECT_EQ("reload ", Comps[8].TypedText);
+  EXPECT_EQ("reload", Comps[8].DisplayText);
 
   Comps = QueryParser::complete("set o", 5, QS);
   ASSERT_EQ(1u, Comps.size());
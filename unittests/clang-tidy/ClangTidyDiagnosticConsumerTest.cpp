@@ -29,6 +29,38 @@ TEST(ClangTidyDiagnosticConsumer, SortsErrors) {
   EXPECT_EQ("variable", Errors[1].Message.Message);
 }
 
+class HeaderNoteCheck : public ClangTidyCheck {
+public:
+  HeaderNoteCheck(StringRef Name, ClangTidyContext *Context)
+      : ClangTidyCheck(Name, Context) {}
+  void registerMatchers(ast_matchers::MatchFinder *Finder) override {
+    Finder->addMatcher(ast_matchers::varDecl().bind("var"), this);
+  }
+  void check(const ast_matchers::MatchFinder::MatchResult &Result) override {
+    const auto *Var = Result.Nodes.getNodeAs<VarDecl>("var");
+    const SourceManager &SM = *Result.SourceManager;
+    if (SM.isInMainFile(Var->getLocation()))
+      return;
+    diag(Var->getLocation(), "header variable %0") << Var;
+    // A note in the main file makes the warning relate to user code.
+    if (Var->getName() == "noted")
+      diag(SM.getLocForStartOfFile(SM.getMainFileID()), "main file",
+           DiagnosticIDs::Note);
+  }
+};
+
+TEST(ClangTidyDiagnosticConsumer, KeepsHeaderErrorsWithNotesInUserCode) {
+  std::vector<ClangTidyError> Errors;
+  runCheckOnCode<HeaderNoteCheck>(
+      "#include \"header.h\"\nint a;", &Errors, "input.cc", None,
+      ClangTidyOptions(),
+      {{"header.h", "int ignored;\nint noted;\nint ignored2;\n"}});
+  ASSERT_EQ(1ul, Errors.size());
+  EXPECT_EQ("header variable 'noted'", Errors[0].Message.Message);
+  ASSERT_EQ(1ul, Errors[0].Notes.size());
+  EXPECT_EQ("main file", Errors[0].Notes[0].Message);
+}
+
 TEST(GlobList, Empty) {
   GlobList Filter("");
 
@@ -89,6 +121,24 @@ TEST(GlobList, Complex) {
   EXPECT_TRUE(Filter.contains("asdfqwEasdf"));
 }
 
+TEST(GlobList, MultipleStars) {
+  GlobList Filter("a*b*c,-*x*x*,**z");
+
+  EXPECT_TRUE(Filter.contains("abc"));
+  EXPECT_TRUE(Filter.contains("aXbYc"));
+  EXPECT_TRUE(Filter.contains("abcbc"));
+  EXPECT_TRUE(Filter.contains("z"));
+  EXPECT_FALSE(Filter.contains("ac"));
+  EXPECT_FALSE(Filter.contains("acb"));
+  EXPECT_FALSE(Filter.contains("abcd"));
+  EXPECT_FALSE(Filter.contains("axbxc"));
+  EXPECT_TRUE(Filter.contains("axbxcz"));
+  // The prefix and the suffix can't overlap.
+  GlobList Overlap("ab*ba");
+  EXPECT_FALSE(Overlap.contains("aba"));
+  EXPECT_TRUE(Overlap.contains("abba"));
+}
+
 } // namespace test
 } // namespace tidy
 } // namespace clang
@@ -1,6 +1,9 @@
 #include "ClangTidyOptions.h"
 #include "gtest/gtest.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 namespace clang {
 namespace tidy {
@@ -97,6 +100,52 @@ TEST(ParseConfiguration, MergeConfigurations) {
             llvm::join(Options.ExtraArgsBefore->begin(),
                        Options.ExtraArgsBefore->end(), ","));
 }
+
+TEST(FileOptionsProvider, CachesConfigurations) {
+  llvm::SmallString<128> Root;
+  ASSERT_FALSE(
+      llvm::sys::fs::createUniqueDirectory("clang-tidy-options", Root));
+  auto Path = [&](StringRef Relative) {
+    llvm::SmallString<128> Result(Root);
+    llvm::sys::path::append(Result, Relative);
+    return Result.str().str();
+  };
+  auto WriteFile = [&](StringRef Relative, StringRef Contents) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path(Relative), EC, llvm::sys::fs::F_Text);
+    ASSERT_FALSE(EC);
+    OS << Contents;
+  };
+  ASSERT_FALSE(llvm::sys::fs::create_directories(Path("a/b")));
+  ASSERT_FALSE(llvm::sys::fs::create_directories(Path("c")));
+  ASSERT_FALSE(llvm::sys::fs::create_directories(Path("d")));
+  WriteFile("a/.test-tidy", "Checks: 'check1'");
+  WriteFile("c/.test-tidy", "Checks: 'check1'");
+
+  unsigned Parses = 0;
+  FileOptionsProvider::ConfigFileHandlers Handlers;
+  Handlers.emplace_back(".test-tidy", [&](StringRef Config) {
+    ++Parses;
+    return parseConfiguration(Config);
+  });
+  FileOptionsProvider Provider(ClangTidyGlobalOptions(), ClangTidyOptions(),
+                               ClangTidyOptions(), Handlers);
+
+  EXPECT_EQ("check1", *Provider.getOptions(Path("a/b/file.cpp")).Checks);
+  EXPECT_EQ("check1", *Provider.getOptions(Path("a/file.cpp")).Checks);
+  EXPECT_EQ("check1", *Provider.getOptions(Path("c/file.cpp")).Checks);
+  EXPECT_FALSE(Provider.getOptions(Path("d/file.cpp")).Checks.hasValue());
+  EXPECT_FALSE(Provider.getOptions(Path("d/file.cpp")).Checks.hasValue());
+  // The identical files in a and c are parsed once.
+  EXPECT_EQ(1u, Parses);
+
+  // Configurations are cached, negative results included.
+  WriteFile("d/.test-tidy", "Checks: 'check2'");
+  EXPECT_FALSE(Provider.getOptions(Path("d/file.cpp")).Checks.hasValue());
+
+  llvm::sys::fs::remove_directories(Root);
+}
+
 } // namespace test
 } // namespace tidy
 } // namespace clang
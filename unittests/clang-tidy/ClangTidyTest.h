@@ -25,6 +25,27 @@ namespace clang {
 namespace tidy {
 namespace test {
 
+template <typename Check, typename... Checks> struct CheckFactory {
+  static void
+  createChecks(ClangTidyContext *Context,
+               SmallVectorImpl<std::unique_ptr<ClangTidyCheck>> &Result) {
+    CheckFactory<Check>::createChecks(Context, Result);
+    CheckFactory<Checks...>::createChecks(Context, Result);
+  }
+};
+
+template <typename Check> struct CheckFactory<Check> {
+  static void
+  createChecks(ClangTidyContext *Context,
+               SmallVectorImpl<std::unique_ptr<ClangTidyCheck>> &Result) {
+    if (!Check::isLanguageSupported(Context->getLangOpts()))
+      return;
+    Result.emplace_back(llvm::make_unique<Check>(
+        "test-check-" + std::to_string(Result.size()), Context));
+  }
+};
+
+template <typename... CheckList>
 class TestClangTidyAction : public ASTFrontendAction {
 public:
   TestClangTidyAction(SmallVectorImpl<std::unique_ptr<ClangTidyCheck>> &Checks,
@@ -39,6 +60,8 @@ private:
     Context.setCurrentFile(File);
     Context.setASTContext(&Compiler.getASTContext());
 
+    // Like clang-tidy, only create the checks supporting the language.
+    CheckFactory<CheckList...>::createChecks(&Context, Checks);
     Preprocessor *PP = &Compiler.getPreprocessor();
     for (auto &Check : Checks) {
       Check->registerMatchers(&Finder);
@@ -53,24 +76,6 @@ private:
   ClangTidyContext &Context;
 };
 
-template <typename Check, typename... Checks> struct CheckFactory {
-  static void
-  createChecks(ClangTidyContext *Context,
-               SmallVectorImpl<std::unique_ptr<ClangTidyCheck>> &Result) {
-    CheckFactory<Check>::createChecks(Context, Result);
-    CheckFactory<Checks...>::createChecks(Context, Result);
-  }
-};
-
-template <typename Check> struct CheckFactory<Check> {
-  static void
-  createChecks(ClangTidyContext *Context,
-               SmallVectorImpl<std::unique_ptr<ClangTidyCheck>> &Result) {
-    Result.emplace_back(llvm::make_unique<Check>(
-        "test-check-" + std::to_string(Result.size()), Context));
-  }
-};
-
 template <typename... CheckList>
 std::string
 runCheckOnCode(StringRef Code, std::vector<ClangTidyError> *Errors = nullptr,
@@ -109,9 +114,9 @@ runCheckOnCode(StringRef Code, std::vector<ClangTidyError> *Errors = nullptr,
       new FileManager(FileSystemOptions(), InMemoryFileSystem));
 
   SmallVector<std::unique_ptr<ClangTidyCheck>, 1> Checks;
-  CheckFactory<CheckList...>::createChecks(&Context, Checks);
   tooling::ToolInvocation Invocation(
-      Args, new TestClangTidyAction(Checks, Finder, Context), Files.get());
+      Args, new TestClangTidyAction<CheckList...>(Checks, Finder, Context),
+      Files.get());
   InMemoryFileSystem->addFile(Filename, 0,
                               llvm::MemoryBuffer::getMemBuffer(Code));
   for (const auto &FileContent : PathsToContent) {
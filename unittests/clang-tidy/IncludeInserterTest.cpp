@@ -34,7 +34,8 @@ public:
   void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
                            Preprocessor *ModuleExpanderPP) override {
     Inserter = llvm::make_unique<utils::IncludeInserter>(
-        SM, getLangOpts(), utils::IncludeSorter::IS_Google);
+        SM, getLangOpts(), utils::IncludeSorter::IS_Google,
+        &getIncludeDirectives());
     PP->addPPCallbacks(Inserter->CreatePPCallbacks());
   }
 
@@ -113,28 +114,28 @@ public:
   bool IsAngledInclude() const override { return true; }
 };
 
-template <typename Check>
+template <typename... CheckList>
 std::string runCheckOnCode(StringRef Code, StringRef Filename) {
   std::vector<ClangTidyError> Errors;
-  return test::runCheckOnCode<Check>(Code, &Errors, Filename, None,
-                                     ClangTidyOptions(),
-                                     {// Main file include
-                                      {"clang_tidy/tests/"
-                                       "insert_includes_test_header.h",
-                                       "\n"},
-                                      // Non system headers
-                                      {"a/header.h", "\n"},
-                                      {"path/to/a/header.h", "\n"},
-                                      {"path/to/z/header.h", "\n"},
-                                      {"path/to/header.h", "\n"},
-                                      {"path/to/header2.h", "\n"},
-                                      // Fake system headers.
-                                      {"stdlib.h", "\n"},
-                                      {"unistd.h", "\n"},
-                                      {"list", "\n"},
-                                      {"map", "\n"},
-                                      {"set", "\n"},
-                                      {"vector", "\n"}});
+  return test::runCheckOnCode<CheckList...>(Code, &Errors, Filename, None,
+                                          ClangTidyOptions(),
+                                          {// Main file include
+                                           {"clang_tidy/tests/"
+                                            "insert_includes_test_header.h",
+                                            "\n"},
+                                           // Non system headers
+                                           {"a/header.h", "\n"},
+                                           {"path/to/a/header.h", "\n"},
+                                           {"path/to/z/header.h", "\n"},
+                                           {"path/to/header.h", "\n"},
+                                           {"path/to/header2.h", "\n"},
+                                           // Fake system headers.
+                                           {"stdlib.h", "\n"},
+                                           {"unistd.h", "\n"},
+                                           {"list", "\n"},
+                                           {"map", "\n"},
+                                           {"set", "\n"},
+                                           {"vector", "\n"}});
 }
 
 TEST(IncludeInserterTest, InsertAfterLastNonSystemInclude) {
@@ -603,6 +604,38 @@ void foo() {
                                    "insert_includes_test_header.cc"));
 }
 
+TEST(IncludeInserterTest, ChecksShareIncludeDirectives) {
+  const char *PreCode = R"(
+#include "clang_tidy/tests/insert_includes_test_header.h"
+
+#include <list>
+#include <map>
+
+#include "path/to/a/header.h"
+
+void foo() {
+  int a = 0;
+})";
+  const char *PostCode = R"(
+#include "clang_tidy/tests/insert_includes_test_header.h"
+
+#include <list>
+#include <map>
+#include <set>
+
+#include "path/to/a/header.h"
+#include "path/to/header.h"
+
+void foo() {
+  int a = 0;
+})";
+
+  EXPECT_EQ(PostCode,
+            (runCheckOnCode<NonSystemHeaderInserterCheck,
+                            CXXSystemIncludeInserterCheck>(
+                PreCode, "clang_tidy/tests/insert_includes_test_input2.cc")));
+}
+
 } // anonymous namespace
 } // namespace tidy
 } // namespace clang
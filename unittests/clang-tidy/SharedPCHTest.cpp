@@ -0,0 +1,36 @@
+#include "SharedPCH.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace tidy {
+namespace test {
+
+TEST(GetLeadingIncludes, Includes) {
+  std::vector<std::string> Expected = {"#include \"a.h\"", "#include <b.h>",
+                                       "#include \"c.h\"", "#include \"d.h\""};
+  EXPECT_EQ(Expected, getLeadingIncludes(R"cpp(
+// A comment.
+/* A block
+   comment. */
+#include "a.h"
+  #  include <b.h>
+/* Inline */ #include "c.h"
+
+#include "d.h"
+#define X
+#include "e.h"
+)cpp"));
+}
+
+TEST(GetLeadingIncludes, NoIncludes) {
+  EXPECT_TRUE(getLeadingIncludes("").empty());
+  EXPECT_TRUE(getLeadingIncludes("int x;\n#include \"a.h\"\n").empty());
+  // Macro includes and conditionals end the run.
+  EXPECT_TRUE(getLeadingIncludes("#include HEADER\n").empty());
+  EXPECT_TRUE(
+      getLeadingIncludes("#ifdef X\n#include \"a.h\"\n#endif\n").empty());
+}
+
+} // namespace test
+} // namespace tidy
+} // namespace clang
@@ -1,6 +1,9 @@
 #include "SyncAPI.h"
 #include "TestFS.h"
+#include "TestIndex.h"
 #include "index/Background.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/ScopedPrinter.h"
 #include "llvm/Support/Threading.h"
 #include "gmock/gmock.h"
@@ -68,6 +71,19 @@ public:
   mutable llvm::StringSet<> AccessedPaths;
 };
 
+class FailingShardStorage : public BackgroundIndexStorage {
+public:
+  llvm::Error storeShard(llvm::StringRef ShardIdentifier,
+                         IndexFileOut Shard) const override {
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "disk full");
+  }
+  std::unique_ptr<IndexFileIn>
+  loadShard(llvm::StringRef ShardIdentifier) const override {
+    return nullptr;
+  }
+};
+
 class BackgroundIndexTest : public ::testing::Test {
 protected:
   BackgroundIndexTest() { preventThreadStarvationInTests(); }
@@ -151,6 +167,80 @@ TEST_F(BackgroundIndexTest, IndexTwoFiles) {
                        FileURI("unittest:///root/B.cc")}));
 }
 
+TEST_F(BackgroundIndexTest, ColdRefsLoadedOnDemand) {
+  MockFSProvider FS;
+  FS.Files[testPath("root/A.h")] = "void common();";
+  FS.Files[testPath("root/A.cc")] =
+      "#include \"A.h\"\nvoid f() { (void)common; }";
+  FS.Files[testPath("root/far/B.cc")] =
+      "#include \"A.h\"\nvoid g() { (void)common; }";
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  OverlayCDB CDB(/*Base=*/nullptr);
+  // Only refs of the boosted file itself are kept in memory.
+  BackgroundIndex Idx(
+      Context::empty(), FS, CDB, [&](llvm::StringRef) { return &MSS; },
+      /*BuildIndexPeriodMs=*/0, llvm::heavyweight_hardware_concurrency(),
+      /*ConcurrencyLimit=*/nullptr, /*ColdRefsDistance=*/0u);
+  Idx.boostRelated(testPath("root/A.cc"));
+
+  for (llvm::StringRef File : {"root/A.cc", "root/far/B.cc"}) {
+    tooling::CompileCommand Cmd;
+    Cmd.Filename = testPath(File);
+    Cmd.Directory = testPath("root");
+    Cmd.CommandLine = {"clang++", "-I" + testPath("root"), Cmd.Filename};
+    CDB.setCompileCommand(Cmd.Filename, Cmd);
+  }
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+
+  auto Syms = runFuzzyFind(Idx, "common");
+  ASSERT_THAT(Syms, UnorderedElementsAre(Named("common")));
+  auto Common = *Syms.begin();
+  MSS.AccessedPaths.clear();
+  EXPECT_THAT(getRefs(Idx, Common.ID),
+              RefsAre({FileURI("unittest:///root/A.h"),
+                       FileURI("unittest:///root/A.cc"),
+                       FileURI("unittest:///root/far/B.cc")}));
+  EXPECT_THAT(MSS.AccessedPaths.keys(),
+              UnorderedElementsAre(testPath("root/A.h"),
+                                   testPath("root/far/B.cc")));
+
+  RefsRequest Req;
+  Req.IDs.insert(Common.ID);
+  Req.Limit = 2;
+  size_t Count = 0;
+  Idx.refs(Req, [&](const Ref &) { ++Count; });
+  EXPECT_EQ(Count, 2u);
+}
+
+TEST_F(BackgroundIndexTest, ColdRefsKeptInMemoryIfNotStored) {
+  MockFSProvider FS;
+  FS.Files[testPath("root/A.h")] = "void common();";
+  FS.Files[testPath("root/far/B.cc")] =
+      "#include \"A.h\"\nvoid g() { (void)common; }";
+  FailingShardStorage FSS;
+  OverlayCDB CDB(/*Base=*/nullptr);
+  BackgroundIndex Idx(
+      Context::empty(), FS, CDB, [&](llvm::StringRef) { return &FSS; },
+      /*BuildIndexPeriodMs=*/0, llvm::heavyweight_hardware_concurrency(),
+      /*ConcurrencyLimit=*/nullptr, /*ColdRefsDistance=*/0u);
+  Idx.boostRelated(testPath("root/A.cc"));
+
+  tooling::CompileCommand Cmd;
+  Cmd.Filename = testPath("root/far/B.cc");
+  Cmd.Directory = testPath("root");
+  Cmd.CommandLine = {"clang++", "-I" + testPath("root"), Cmd.Filename};
+  CDB.setCompileCommand(Cmd.Filename, Cmd);
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+
+  auto Syms = runFuzzyFind(Idx, "common");
+  ASSERT_THAT(Syms, UnorderedElementsAre(Named("common")));
+  EXPECT_THAT(getRefs(Idx, Syms.begin()->ID),
+              RefsAre({FileURI("unittest:///root/A.h"),
+                       FileURI("unittest:///root/far/B.cc")}));
+}
+
 TEST_F(BackgroundIndexTest, ShardStorageTest) {
   MockFSProvider FS;
   FS.Files[testPath("root/A.h")] = R"cpp(
@@ -364,6 +454,129 @@ TEST_F(BackgroundIndexTest, ShardStorageLoad) {
               Contains(AllOf(Named("f_b"), Declared(), Defined())));
 }
 
+TEST_F(BackgroundIndexTest, FilesChanged) {
+  MockFSProvider FS;
+  FS.Files[testPath("root/A.h")] = "void common();";
+  FS.Files[testPath("root/A.cc")] = "#include \"A.h\"";
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  OverlayCDB CDB(/*Base=*/nullptr);
+  BackgroundIndex Idx(Context::empty(), FS, CDB,
+                      [&](llvm::StringRef) { return &MSS; });
+
+  tooling::CompileCommand Cmd;
+  Cmd.Filename = testPath("root/A.cc");
+  Cmd.Directory = testPath("root");
+  Cmd.CommandLine = {"clang++", testPath("root/A.cc")};
+  CDB.setCompileCommand(testPath("root/A.cc"), Cmd);
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  EXPECT_THAT(runFuzzyFind(Idx, ""), UnorderedElementsAre(Named("common")));
+
+  // The header is re-indexed through the TU that includes it.
+  FS.Files[testPath("root/A.h")] = "void common(); void added();";
+  Idx.filesChanged({testPath("root/A.h"), testPath("root/unrelated.h")});
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  EXPECT_THAT(runFuzzyFind(Idx, ""),
+              UnorderedElementsAre(Named("common"), Named("added")));
+  auto ShardHeader = MSS.loadShard(testPath("root/A.h"));
+  ASSERT_NE(ShardHeader, nullptr);
+  EXPECT_THAT(*ShardHeader->Symbols, Contains(Named("added")));
+}
+
+TEST_F(BackgroundIndexTest, DigestsCachedByModificationTime) {
+  MockFSProvider FS;
+  FS.Files[testPath("root/A.h")] = "void common();";
+  FS.Files[testPath("root/A.cc")] = "#include \"A.h\"";
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  OverlayCDB CDB(/*Base=*/nullptr);
+  BackgroundIndex Idx(Context::empty(), FS, CDB,
+                      [&](llvm::StringRef) { return &MSS; });
+
+  tooling::CompileCommand Cmd;
+  Cmd.Filename = testPath("root/A.cc");
+  Cmd.Directory = testPath("root");
+  Cmd.CommandLine = {"clang++", testPath("root/A.cc")};
+  CDB.setCompileCommand(testPath("root/A.cc"), Cmd);
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  // Loading the shards hashes A.cc and A.h, which are up to date.
+  CDB.setCompileCommand(testPath("root/A.cc"), Cmd);
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  EXPECT_EQ(CacheHits, 2U);
+  EXPECT_THAT(runFuzzyFind(Idx, ""), ElementsAre(Named("common")));
+
+  // Same size and modification time: A.h isn't read again, so the change goes
+  // unnoticed.
+  FS.Files[testPath("root/A.h")] = "void cheese();";
+  CDB.setCompileCommand(testPath("root/A.cc"), Cmd);
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  EXPECT_THAT(runFuzzyFind(Idx, ""), ElementsAre(Named("common")));
+
+  // A new modification time gets A.h hashed again, and re-indexed.
+  FS.Timestamps[testPath("root/A.h")] = 1;
+  CDB.setCompileCommand(testPath("root/A.cc"), Cmd);
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  EXPECT_THAT(runFuzzyFind(Idx, ""), ElementsAre(Named("cheese")));
+}
+
+// Announces all of its commands at once, like a compile_commands.json does.
+class BatchCDB : public GlobalCompilationDatabase {
+public:
+  llvm::Optional<tooling::CompileCommand>
+  getCompileCommand(PathRef File, ProjectInfo * = nullptr) const override {
+    auto It = Commands.find(File);
+    if (It == Commands.end())
+      return llvm::None;
+    return It->getValue();
+  }
+
+  void announce() {
+    std::vector<std::string> Files;
+    for (const auto &Command : Commands)
+      Files.push_back(Command.getKey());
+    OnCommandChanged.broadcast(Files);
+  }
+
+  llvm::StringMap<tooling::CompileCommand> Commands;
+};
+
+TEST_F(BackgroundIndexTest, ShardStorageLoadMany) {
+  MockFSProvider FS;
+  FS.Files[testPath("root/common.h")] = "void common();";
+  constexpr int NumTUs = 40; // Enough to load shards on several threads.
+  BatchCDB CDB;
+  for (int I = 0; I < NumTUs; ++I) {
+    std::string Name = "tu" + std::to_string(I);
+    tooling::CompileCommand Cmd;
+    Cmd.Filename = testPath("root/" + Name + ".cc");
+    Cmd.Directory = testPath("root");
+    Cmd.CommandLine = {"clang++", Cmd.Filename};
+    FS.Files[Cmd.Filename] = "#include \"common.h\"\nvoid " + Name + "() {}";
+    CDB.Commands[Cmd.Filename] = Cmd;
+  }
+
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  {
+    BackgroundIndex Idx(Context::empty(), FS, CDB,
+                        [&](llvm::StringRef) { return &MSS; });
+    CDB.announce();
+    ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  }
+  EXPECT_EQ(CacheHits, 0U);
+
+  BackgroundIndex Idx(Context::empty(), FS, CDB,
+                      [&](llvm::StringRef) { return &MSS; });
+  CDB.announce();
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  // Every shard is loaded once, even though all TUs include the header.
+  EXPECT_EQ(CacheHits, size_t(NumTUs) + 1);
+  EXPECT_EQ(runFuzzyFind(Idx, "").size(), size_t(NumTUs) + 1);
+}
+
 TEST_F(BackgroundIndexTest, ShardStorageEmptyFile) {
   MockFSProvider FS;
   FS.Files[testPath("root/A.h")] = R"cpp(
@@ -461,5 +674,54 @@ TEST_F(BackgroundIndexTest, NoDotsInAbsPath) {
   }
 }
 
+TEST(PackedIndexStorageTest, StoreAndReload) {
+  llvm::SmallString<128> Root;
+  ASSERT_FALSE(
+      llvm::sys::fs::createUniqueDirectory("clangd-packed-index", Root));
+  llvm::SmallString<128> Pack = Root;
+  llvm::sys::path::append(Pack, ".clangd", "index", "shards.pack");
+  auto PackSize = [&] {
+    uint64_t Size = 0;
+    llvm::sys::fs::file_size(Pack, Size);
+    return Size;
+  };
+
+  SymbolSlab FooSymbols = generateSymbols({"foo"});
+  SymbolSlab BarSymbols = generateSymbols({"bar"});
+  IndexFileOut Foo, Bar;
+  Foo.Symbols = &FooSymbols;
+  Bar.Symbols = &BarSymbols;
+  {
+    auto Factory = BackgroundIndexStorage::createPackedStorageFactory();
+    BackgroundIndexStorage *Storage = Factory(Root);
+    EXPECT_EQ(Storage->loadShard("a.h"), nullptr);
+    ASSERT_FALSE(bool(Storage->storeShard("a.h", Foo)));
+    uint64_t SizeAfterFirst = PackSize();
+    EXPECT_GT(SizeAfterFirst, 0u);
+    // Identical contents are stored once.
+    ASSERT_FALSE(bool(Storage->storeShard("b.h", Foo)));
+    EXPECT_EQ(PackSize(), SizeAfterFirst);
+    // A newer version of a shard supersedes the old one.
+    ASSERT_FALSE(bool(Storage->storeShard("b.h", Bar)));
+    EXPECT_GT(PackSize(), SizeAfterFirst);
+
+    auto A = Storage->loadShard("a.h");
+    ASSERT_TRUE(A && A->Symbols);
+    EXPECT_THAT(*A->Symbols, ElementsAre(Named("foo")));
+  }
+
+  // Shards survive reopening the storage.
+  auto Factory = BackgroundIndexStorage::createPackedStorageFactory();
+  BackgroundIndexStorage *Storage = Factory(Root);
+  auto A = Storage->loadShard("a.h");
+  ASSERT_TRUE(A && A->Symbols);
+  EXPECT_THAT(*A->Symbols, ElementsAre(Named("foo")));
+  auto B = Storage->loadShard("b.h");
+  ASSERT_TRUE(B && B->Symbols);
+  EXPECT_THAT(*B->Symbols, ElementsAre(Named("bar")));
+
+  llvm::sys::fs::remove_directories(Root);
+}
+
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,63 @@
+//===-- CanonicalIncludesTests.cpp - --------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "index/CanonicalIncludes.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace clangd {
+namespace {
+
+TEST(CanonicalIncludesTest, SymbolMapping) {
+  CanonicalIncludes CI;
+  CI.addSymbolMapping("std::string", "<string>");
+  CI.addPathSuffixMapping("bits/basic_string.h", "<basic_string>");
+
+  EXPECT_EQ("<string>", CI.mapSymbol("std::string"));
+  EXPECT_EQ("", CI.mapSymbol("std::vector"));
+  // Symbol mappings take precedence over header mappings.
+  EXPECT_EQ("<string>",
+            CI.mapHeader({"/usr/include/bits/basic_string.h"}, "std::string"));
+  EXPECT_EQ("<basic_string>",
+            CI.mapHeader({"/usr/include/bits/basic_string.h"}, "std::wstring"));
+}
+
+TEST(CanonicalIncludesTest, PathMapping) {
+  CanonicalIncludes CI;
+  CI.addMapping("foo/bar", "<baz>");
+  EXPECT_EQ("<baz>", CI.mapHeader({"foo/bar"}));
+  EXPECT_EQ("bar/bar", CI.mapHeader({"bar/bar"}));
+}
+
+TEST(CanonicalIncludesTest, SuffixMapping) {
+  CanonicalIncludes CI;
+  CI.addPathSuffixMapping("bar/bar.h", "<bar>");
+  CI.addPathSuffixMapping("baz.h", "<baz>");
+  CI.addPathSuffixMapping("sys/baz.h", "<sys/baz>");
+
+  EXPECT_EQ("<bar>", CI.mapHeader({"/usr/include/bar/bar.h"}));
+  EXPECT_EQ("<bar>", CI.mapHeader({"bar/bar.h"}));
+  // Only whole components match.
+  EXPECT_EQ("/usr/include/foobar/bar.h",
+            CI.mapHeader({"/usr/include/foobar/bar.h"}));
+  EXPECT_EQ("/usr/include/bar.h", CI.mapHeader({"/usr/include/bar.h"}));
+  // The shortest matching suffix wins.
+  EXPECT_EQ("<baz>", CI.mapHeader({"/usr/include/sys/baz.h"}));
+}
+
+TEST(CanonicalIncludesTest, SkipsIncFiles) {
+  CanonicalIncludes CI;
+  CI.addPathSuffixMapping("bits/foo.h", "<foo>");
+  // The .inc file is mapped through the header including it.
+  EXPECT_EQ("<foo>", CI.mapHeader({"/usr/include/bits/foo.inc",
+                                   "/usr/include/bits/foo.h", "main.cc"}));
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
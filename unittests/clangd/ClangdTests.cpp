@@ -504,6 +504,9 @@ struct Something {
 
   EXPECT_THAT(Server.getUsedBytesPerFile(),
               UnorderedElementsAre(Pair(FooCpp, Gt(0u)), Pair(BarCpp, Gt(0u))));
+  MemoryTree MT;
+  Server.profile(MT);
+  EXPECT_GT(MT.child("tuscheduler").child(FooCpp).total(), 0u);
 
   Server.removeDocument(FooCpp);
   ASSERT_TRUE(Server.blockUntilIdleForTest());
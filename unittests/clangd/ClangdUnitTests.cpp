@@ -9,6 +9,7 @@
 #include "Annotations.h"
 #include "ClangdUnit.h"
 #include "SourceCode.h"
+#include "TestFS.h"
 #include "TestTU.h"
 #include "llvm/Support/ScopedPrinter.h"
 #include "gmock/gmock.h"
@@ -81,6 +82,38 @@ TEST(ClangdUnitTest, TopLevelDecls) {
   EXPECT_THAT(AST.getLocalTopLevelDecls(), ElementsAre(DeclNamed("main")));
 }
 
+TEST(ClangdUnitTest, CancelledPreambleBuild) {
+  auto MainFile = testPath("foo.cpp");
+  auto Header = testPath("foo.h");
+  ParseInputs PI;
+  PI.CompileCommand.Directory = testRoot();
+  PI.CompileCommand.Filename = MainFile;
+  PI.CompileCommand.CommandLine = {"clang", "-xc++", MainFile};
+  PI.Contents = "#include \"foo.h\"\nint x = foo();";
+  PI.FS = buildTestFS({{MainFile, PI.Contents}, {Header, "int foo();"}});
+
+  bool CallbackRun = false;
+  auto Build = [&](const std::atomic<bool> &Cancelled) {
+    return buildPreamble(
+        MainFile, *buildCompilerInvocation(PI), /*OldPreamble=*/nullptr,
+        tooling::CompileCommand(), PI,
+        std::make_shared<PCHContainerOperations>(), /*StoreInMemory=*/true,
+        [&](ASTContext &, std::shared_ptr<Preprocessor>,
+            const CanonicalIncludes &) { CallbackRun = true; },
+        &Cancelled);
+  };
+
+  std::atomic<bool> Cancelled(true);
+  EXPECT_EQ(nullptr, Build(Cancelled));
+  EXPECT_FALSE(CallbackRun);
+
+  Cancelled = false;
+  auto Preamble = Build(Cancelled);
+  ASSERT_TRUE(Preamble);
+  EXPECT_TRUE(CallbackRun);
+  EXPECT_THAT(Preamble->Includes.MainFileIncludes, testing::SizeIs(1));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -676,6 +676,33 @@ TEST(CompletionTest, DynamicIndexIncludeInsertion) {
                         InsertInclude())));
 }
 
+TEST(CompletionTest, PreambleCompletionStringsReused) {
+  MockFSProvider FS;
+  MockCompilationDatabase CDB;
+  IgnoreDiagnostics DiagConsumer;
+  ClangdServer Server(CDB, FS, DiagConsumer, ClangdServer::optsForTest());
+
+  FS.Files[testPath("foo.h")] = R"cpp(
+    struct Foo {
+      int method(int A, double B);
+      template <class T> T tmpl(T X);
+    };
+  )cpp";
+  // The second request has the same preamble, and gets the strings rendered by
+  // the first one from the cache.
+  for (llvm::StringRef Code : {"#include \"foo.h\"\nvoid f(Foo X) { X.^ }",
+                               "#include \"foo.h\"\nint g(Foo Y) { Y.^ }"}) {
+    auto Results = completions(Server, Code);
+    EXPECT_THAT(Results.Completions,
+                Contains(AllOf(Named("method"), Signature("(int A, double B)"),
+                               SnippetSuffix("(${1:int A}, ${2:double B})"),
+                               ReturnType("int"))));
+    EXPECT_THAT(Results.Completions,
+                Contains(AllOf(Named("tmpl"), Signature("(T X)"),
+                               SnippetSuffix("(${1:T X})"), ReturnType("T"))));
+  }
+}
+
 TEST(CompletionTest, DynamicIndexMultiFile) {
   MockFSProvider FS;
   MockCompilationDatabase CDB;
@@ -1984,6 +2011,152 @@ TEST(CompletionTest, EnableSpeculativeIndexRequest) {
   ASSERT_EQ(Reqs3.size(), 2u);
 }
 
+TEST(CompletionTest, ReuseIndexResults) {
+  MockFSProvider FS;
+  MockCompilationDatabase CDB;
+  IgnoreDiagnostics DiagConsumer;
+  ClangdServer Server(CDB, FS, DiagConsumer, ClangdServer::optsForTest());
+
+  auto File = testPath("foo.cpp");
+  Annotations Test(R"cpp(
+      namespace ns {}
+      void f() { ns::a$1^; ns::ab$2^; ns::x$3^; }
+  )cpp");
+  runAddDocument(Server, File, Test.code());
+
+  // Forwards to a real index, counting the queries.
+  class CountingIndex : public SymbolIndex {
+  public:
+    CountingIndex(std::unique_ptr<SymbolIndex> Base) : Base(std::move(Base)) {}
+    bool fuzzyFind(
+        const FuzzyFindRequest &Req,
+        llvm::function_ref<void(const Symbol &)> Callback) const override {
+      ++Queries;
+      return Base->fuzzyFind(Req, Callback);
+    }
+    void lookup(const LookupRequest &Req,
+                llvm::function_ref<void(const Symbol &)> CB) const override {
+      Base->lookup(Req, CB);
+    }
+    void refs(const RefsRequest &Req,
+              llvm::function_ref<void(const Ref &)> CB) const override {
+      Base->refs(Req, CB);
+    }
+    size_t estimateMemoryUsage() const override { return 0; }
+    uint64_t generation() const override { return Generation; }
+
+    mutable int Queries = 0;
+    uint64_t Generation = 0;
+
+  private:
+    std::unique_ptr<SymbolIndex> Base;
+  };
+  CountingIndex Index(
+      memIndex({var("ns::abc"), var("ns::axy"), var("ns::xyz")}));
+  clangd::CodeCompleteOptions Opts = {};
+  Opts.Index = &Index;
+  Opts.ReuseIndexResults = true;
+
+  auto Results =
+      cantFail(runCodeComplete(Server, File, Test.point("1"), Opts));
+  EXPECT_THAT(Results.Completions,
+              UnorderedElementsAre(Named("abc"), Named("axy")));
+  EXPECT_EQ(Index.Queries, 1);
+
+  // "ab" extends "a": the previous results are filtered again.
+  Results = cantFail(runCodeComplete(Server, File, Test.point("2"), Opts));
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("abc")));
+  EXPECT_EQ(Index.Queries, 1);
+
+  // "x" doesn't, so we query the index.
+  Results = cantFail(runCodeComplete(Server, File, Test.point("3"), Opts));
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("xyz")));
+  EXPECT_EQ(Index.Queries, 2);
+
+  // Results from before an index change are not reused.
+  ++Index.Generation;
+  Results = cantFail(runCodeComplete(Server, File, Test.point("3"), Opts));
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("xyz")));
+  EXPECT_EQ(Index.Queries, 3);
+}
+
+TEST(CompletionTest, IndexResultsFirst) {
+  MockFSProvider FS;
+  MockCompilationDatabase CDB;
+  IgnoreDiagnostics DiagConsumer;
+  ClangdServer Server(CDB, FS, DiagConsumer, ClangdServer::optsForTest());
+
+  auto File = testPath("foo.cpp");
+  auto Index = memIndex({var("ns::abIndex")});
+  clangd::CodeCompleteOptions Opts = {};
+  Opts.Index = Index.get();
+  Opts.IndexResultsFirst = true;
+  auto CompleteAt = [&](llvm::StringRef Code) {
+    Annotations Test(Code);
+    runAddDocument(Server, File, Test.code());
+    auto Results = cantFail(runCodeComplete(Server, File, Test.point(), Opts));
+    EXPECT_TRUE(Server.blockUntilIdleForTest());
+    return Results;
+  };
+
+  // Without an earlier completion, the scopes are unknown.
+  auto Results = CompleteAt("namespace ns { int abSema; }\n"
+                            "void f() { ns::a^ }");
+  EXPECT_THAT(Results.Completions,
+              UnorderedElementsAre(Named("abSema"), Named("abIndex")));
+  EXPECT_FALSE(Results.HasMore);
+
+  // The scopes of the last completion apply to the same qualifier.
+  Results = CompleteAt("namespace ns { int abSema; }\n"
+                       "void f() { ns::ab^ }");
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("abIndex")));
+  EXPECT_TRUE(Results.HasMore);
+
+  // Continuing the identifier reuses the Sema completion that ran after.
+  Results = CompleteAt("namespace ns { int abSema; }\n"
+                       "void f() { ns::abS^ }");
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("abSema")));
+  EXPECT_FALSE(Results.HasMore);
+
+  // Member accesses are never answered from the index alone.
+  Results = CompleteAt("namespace ns { struct S { int abMember; } s; }\n"
+                       "void f() { ns::s.ab^ }");
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("abMember")));
+}
+
+TEST(CompletionTest, IndexResultsFirstRefiltersUntruncatedResults) {
+  MockFSProvider FS;
+  MockCompilationDatabase CDB;
+  IgnoreDiagnostics DiagConsumer;
+  ClangdServer Server(CDB, FS, DiagConsumer, ClangdServer::optsForTest());
+
+  auto File = testPath("foo.cpp");
+  auto Index = memIndex({var("ns::abIndex")});
+  clangd::CodeCompleteOptions Opts = {};
+  Opts.Index = Index.get();
+  Opts.IndexResultsFirst = true;
+  Opts.Limit = 1;
+  auto CompleteAt = [&](llvm::StringRef Code) {
+    Annotations Test(Code);
+    runAddDocument(Server, File, Test.code());
+    auto Results = cantFail(runCodeComplete(Server, File, Test.point(), Opts));
+    EXPECT_TRUE(Server.blockUntilIdleForTest());
+    return Results;
+  };
+  llvm::StringRef Decls =
+      "namespace ns { int abSema; [[deprecated]] int abZeta; }\n";
+
+  CompleteAt((Decls + "void f() { ns::a^ }").str());
+  auto Results = CompleteAt((Decls + "void f() { ns::ab^ }").str());
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("abIndex")));
+  EXPECT_TRUE(Results.HasMore);
+
+  // abZeta ranks last for "ab", but the refiltered results still have it.
+  Results = CompleteAt((Decls + "void f() { ns::abZ^ }").str());
+  EXPECT_THAT(Results.Completions, ElementsAre(Named("abZeta")));
+  EXPECT_FALSE(Results.HasMore);
+}
+
 TEST(CompletionTest, InsertTheMostPopularHeader) {
   std::string DeclFile = URI::create(testPath("foo")).toString();
   Symbol sym = func("Func");
@@ -0,0 +1,159 @@
+//===-- CompileCommandsCacheTests.cpp ---------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "CompileCommandsCache.h"
+#include "TestFS.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Path.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace clangd {
+namespace {
+
+using ::testing::Contains;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+MATCHER_P2(Cmd, File, Args, "") {
+  return arg.Filename == File && arg.CommandLine == Args;
+}
+
+std::vector<tooling::CompileCommand> testCommands() {
+  std::string Dir = testPath("build");
+  return {
+      tooling::CompileCommand(Dir, "../src/a.cc", {"clang", "-DA", "a.cc"},
+                              "a.o"),
+      tooling::CompileCommand(Dir, testPath("src/b.cc"),
+                              {"clang", "-DB", "b.cc"}, ""),
+      // A second command for b.cc.
+      tooling::CompileCommand(Dir, testPath("src/b.cc"),
+                              {"clang", "-DB2", "b.cc"}, ""),
+  };
+}
+
+std::unique_ptr<tooling::CompilationDatabase>
+roundTrip(llvm::ArrayRef<tooling::CompileCommand> Commands,
+          CompileCommandsVersion Written, CompileCommandsVersion Read) {
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  writeCompileCommandsCache(Commands, Written, OS);
+  return readCompileCommandsCache(
+      llvm::MemoryBuffer::getMemBufferCopy(OS.str()), Read);
+}
+
+TEST(CompileCommandsCacheTest, RoundTrip) {
+  CompileCommandsVersion Version;
+  Version.Size = 42;
+  Version.MTime = 1234;
+  auto DB = roundTrip(testCommands(), Version, Version);
+  ASSERT_TRUE(DB);
+
+  // Relative files are looked up by absolute path, like in the JSON database.
+  auto A = DB->getCompileCommands(testPath("src/a.cc"));
+  ASSERT_THAT(A, ElementsAre(Cmd("../src/a.cc", std::vector<std::string>{
+                                                    "clang", "-DA", "a.cc"})));
+  EXPECT_EQ(A[0].Directory, testPath("build"));
+  EXPECT_EQ(A[0].Output, "a.o");
+
+  EXPECT_THAT(
+      DB->getCompileCommands(testPath("src/b.cc")),
+      UnorderedElementsAre(
+          Cmd(testPath("src/b.cc"),
+              std::vector<std::string>{"clang", "-DB", "b.cc"}),
+          Cmd(testPath("src/b.cc"),
+              std::vector<std::string>{"clang", "-DB2", "b.cc"})));
+  EXPECT_THAT(DB->getCompileCommands(testPath("src/c.cc")), IsEmpty());
+  EXPECT_THAT(DB->getAllFiles(),
+              UnorderedElementsAre(testPath("src/a.cc"), testPath("src/b.cc")));
+  EXPECT_EQ(DB->getAllCompileCommands().size(), 3u);
+}
+
+TEST(CompileCommandsCacheTest, Empty) {
+  auto DB = roundTrip({}, CompileCommandsVersion(), CompileCommandsVersion());
+  ASSERT_TRUE(DB);
+  EXPECT_THAT(DB->getCompileCommands(testPath("src/a.cc")), IsEmpty());
+  EXPECT_THAT(DB->getAllFiles(), IsEmpty());
+}
+
+TEST(CompileCommandsCacheTest, Stale) {
+  CompileCommandsVersion Version;
+  Version.Size = 42;
+  Version.MTime = 1234;
+  CompileCommandsVersion Modified = Version;
+  ++Modified.MTime;
+  EXPECT_FALSE(roundTrip(testCommands(), Version, Modified));
+  CompileCommandsVersion Resized = Version;
+  ++Resized.Size;
+  EXPECT_FALSE(roundTrip(testCommands(), Version, Resized));
+}
+
+TEST(CompileCommandsCacheTest, Corrupt) {
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  writeCompileCommandsCache(testCommands(), CompileCommandsVersion(), OS);
+  OS.flush();
+  EXPECT_FALSE(readCompileCommandsCache(
+      llvm::MemoryBuffer::getMemBufferCopy(Data.substr(0, Data.size() - 1)),
+      CompileCommandsVersion()));
+  EXPECT_FALSE(readCompileCommandsCache(
+      llvm::MemoryBuffer::getMemBufferCopy("CDBc"), CompileCommandsVersion()));
+}
+
+TEST(CompileCommandsCacheTest, LoadFromDirectory) {
+  llvm::SmallString<128> Dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("clangd-cdb-cache", Dir));
+  llvm::SmallString<128> JSONPath(Dir), CacheDir(Dir);
+  llvm::sys::path::append(JSONPath, "compile_commands.json");
+  llvm::sys::path::append(CacheDir, "cache");
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(JSONPath, EC, llvm::sys::fs::F_Text);
+    ASSERT_FALSE(EC);
+    OS << llvm::formatv(R"json([{{
+      "directory": "{0}",
+      "command": "clang -DFOO foo.cc",
+      "file": "foo.cc"
+    }])json",
+                        Dir);
+  }
+  llvm::SmallString<128> File(Dir);
+  llvm::sys::path::append(File, "foo.cc");
+
+  // A path through a symlink, that only the JSON database matches.
+  llvm::SmallString<128> Link(Dir), LinkedFile(Dir);
+  llvm::sys::path::append(Link, "link");
+  llvm::sys::path::append(LinkedFile, "link", "foo.cc");
+  ASSERT_FALSE(llvm::sys::fs::create_link(Dir, Link));
+
+  EXPECT_FALSE(loadCachedJSONCompilationDatabase("/does/not/exist", CacheDir));
+  // The first load parses the JSON and writes the cache, the second one reads
+  // the cache.
+  for (int I = 0; I < 2; ++I) {
+    auto DB = loadCachedJSONCompilationDatabase(Dir, CacheDir);
+    ASSERT_TRUE(DB);
+    std::error_code EC;
+    EXPECT_NE(llvm::sys::fs::directory_iterator(CacheDir, EC),
+              llvm::sys::fs::directory_iterator());
+    auto Commands = DB->getCompileCommands(File);
+    ASSERT_EQ(Commands.size(), 1u);
+    EXPECT_THAT(Commands[0].CommandLine, Contains("-DFOO"));
+    // Not inferred from foo.cc, which would use the path that was asked for.
+    Commands = DB->getCompileCommands(LinkedFile);
+    ASSERT_EQ(Commands.size(), 1u);
+    EXPECT_EQ(Commands[0].Filename, "foo.cc");
+  }
+  llvm::sys::fs::remove_directories(Dir);
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
@@ -52,5 +52,36 @@ TEST(ContextTests, Builders) {
   EXPECT_EQ(*ChildCtx.get(ChildParam), 40);
 }
 
+TEST(ContextTests, ValuesCanReferenceParents) {
+  // Reads the parent's value when destroyed.
+  struct Checker {
+    const int *ParentValue;
+    bool *Checked;
+    ~Checker() {
+      if (ParentValue) {
+        EXPECT_EQ(*ParentValue, 10);
+        *Checked = true;
+      }
+    }
+    Checker(const int *ParentValue, bool *Checked)
+        : ParentValue(ParentValue), Checked(Checked) {}
+    Checker(Checker &&Other)
+        : ParentValue(Other.ParentValue), Checked(Other.Checked) {
+      Other.ParentValue = nullptr;
+    }
+  };
+  Key<int> ParentParam;
+  Key<Checker> ChildParam;
+
+  bool Checked = false;
+  {
+    Context ParentCtx = Context::empty().derive(ParentParam, 10);
+    Context ChildCtx = ParentCtx.derive(
+        ChildParam, Checker(ParentCtx.get(ParentParam), &Checked));
+    ParentCtx = Context::empty();
+  }
+  EXPECT_TRUE(Checked);
+}
+
 } // namespace clangd
 } // namespace clang
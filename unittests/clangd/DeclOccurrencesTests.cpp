@@ -0,0 +1,78 @@
+//===-- DeclOccurrencesTests.cpp --------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Annotations.h"
+#include "ClangdUnit.h"
+#include "DeclOccurrences.h"
+#include "SourceCode.h"
+#include "TestTU.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace clangd {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+
+std::vector<Range> ranges(ParsedAST &AST,
+                          llvm::ArrayRef<DeclOccurrences::Occurrence> Occs) {
+  const SourceManager &SM = AST.getASTContext().getSourceManager();
+  const LangOptions &LangOpts = AST.getASTContext().getLangOpts();
+  std::vector<Range> Result;
+  for (const auto &O : Occs) {
+    Position Begin = sourceLocToPosition(SM, O.FileLoc);
+    Position End = Begin;
+    End.character += Lexer::MeasureTokenLength(O.FileLoc, SM, LangOpts);
+    Result.push_back({Begin, End});
+  }
+  return Result;
+}
+
+TEST(DeclOccurrencesTest, InMainFile) {
+  Annotations Code(R"cpp(
+    int [[x]];
+    int y = [[x]] + 1;
+    #define X x
+    void f() { [[x]] = [[X]]; }
+  )cpp");
+  auto AST = TestTU::withCode(Code.code()).build();
+  const auto &Occurrences = AST.getDeclOccurrences();
+  const Decl *X = &findDecl(AST, "x");
+  EXPECT_THAT(ranges(AST, Occurrences.inMainFile(X->getCanonicalDecl())),
+              ElementsAreArray(Code.ranges()));
+  EXPECT_THAT(Occurrences.inMainFile(nullptr), IsEmpty());
+}
+
+TEST(DeclOccurrencesTest, At) {
+  Annotations Code(R"cpp(
+    struct S {};
+    S ^s;
+    int ^y = 0;
+  )cpp");
+  auto AST = TestTU::withCode(Code.code()).build();
+  const SourceManager &SM = AST.getASTContext().getSourceManager();
+  auto LocOf = [&](Position P) {
+    return SM.getComposedLoc(SM.getMainFileID(),
+                             cantFail(positionToOffset(Code.code(), P)));
+  };
+  auto AtS = AST.getDeclOccurrences().at(LocOf(Code.points()[0]));
+  // The declaration of s, and the implicit constructor call.
+  ASSERT_FALSE(AtS.empty());
+  for (const auto &O : AtS)
+    EXPECT_EQ(O.Loc, LocOf(Code.points()[0]));
+  auto AtY = AST.getDeclOccurrences().at(LocOf(Code.points()[1]));
+  ASSERT_EQ(AtY.size(), 1u);
+  EXPECT_EQ(AtY[0].D, findDecl(AST, "y").getCanonicalDecl());
+  EXPECT_FALSE(AtY[0].Implicit);
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
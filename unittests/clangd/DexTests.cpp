@@ -6,11 +6,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "Cancellation.h"
 #include "FuzzyMatch.h"
 #include "TestFS.h"
 #include "TestIndex.h"
+#include "URI.h"
 #include "index/Index.h"
 #include "index/Merge.h"
+#include "index/dex/CompactRefs.h"
 #include "index/dex/Dex.h"
 #include "index/dex/Iterator.h"
 #include "index/dex/Token.h"
@@ -23,8 +26,11 @@
 #include <vector>
 
 using ::testing::AnyOf;
+using ::testing::Contains;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
 
 namespace clang {
 namespace clangd {
@@ -66,6 +72,109 @@ TEST(DexIterators, DocumentIterator) {
   EXPECT_TRUE(DocIterator->reachedEnd());
 }
 
+TEST(DexIterators, DocumentIteratorDeltaWidths) {
+  // Deltas encoded with one to five bytes, in runs spanning several chunks.
+  // The five byte deltas come last, and few enough for DocIDs to fit.
+  std::vector<DocID> Docs;
+  DocID Doc = 0;
+  for (DocID Delta : {1u, 127u, 128u, 16383u, 16384u, 1u << 21})
+    for (int I = 0; I < 20; ++I)
+      Docs.push_back(Doc += Delta);
+  for (int I = 0; I < 10; ++I)
+    Docs.push_back(Doc += 1u << 28);
+  ASSERT_GT(Docs.back(), Docs.front()) << "DocIDs overflowed";
+  const PostingList L(Docs);
+  auto DocIterator = L.iterator();
+  EXPECT_EQ(consumeIDs(*DocIterator), Docs);
+}
+
+TEST(DexIterators, DocumentIteratorAdvanceToFarChunks) {
+  // Sparse enough to be stored in chunks rather than a bitset.
+  std::vector<DocID> Docs;
+  for (DocID Doc = 0; Doc < 100000; Doc += 9)
+    Docs.push_back(Doc);
+  const PostingList L(Docs);
+  auto DocIterator = L.iterator();
+  // Short and long jumps, landing both on and between elements.
+  for (DocID Target : {1u, 2u, 3u, 40u, 41u, 5000u, 5001u, 5003u, 70000u,
+                       99998u}) {
+    DocIterator->advanceTo(Target);
+    ASSERT_FALSE(DocIterator->reachedEnd());
+    EXPECT_EQ(DocIterator->peek(),
+              *std::lower_bound(Docs.begin(), Docs.end(), Target));
+  }
+  DocIterator->advanceTo(100000);
+  EXPECT_TRUE(DocIterator->reachedEnd());
+}
+
+TEST(DexIterators, DenseDocumentIterator) {
+  std::vector<DocID> Docs;
+  for (DocID Doc = 5; Doc < 10000; Doc += 3)
+    Docs.push_back(Doc);
+  Docs.push_back(20000); // A run of empty words.
+  const PostingList L(Docs);
+  EXPECT_LT(L.bytes(), Docs.size());
+  auto DocIterator = L.iterator();
+  EXPECT_EQ(DocIterator->estimateSize(), Docs.size());
+  EXPECT_EQ(consumeIDs(*DocIterator), Docs);
+
+  DocIterator = L.iterator();
+  for (DocID Target : {0u, 6u, 63u, 64u, 65u, 5000u, 9999u, 19999u}) {
+    DocIterator->advanceTo(Target);
+    ASSERT_FALSE(DocIterator->reachedEnd());
+    EXPECT_EQ(DocIterator->peek(),
+              *std::lower_bound(Docs.begin(), Docs.end(), Target));
+  }
+  DocIterator->advanceTo(20001);
+  EXPECT_TRUE(DocIterator->reachedEnd());
+
+  // Dense lists are still serialized as chunks.
+  const PostingList Restored(L.chunks());
+  EXPECT_EQ(Restored.bytes(), L.bytes());
+  auto RestoredIterator = Restored.iterator();
+  EXPECT_EQ(consumeIDs(*RestoredIterator), Docs);
+}
+
+TEST(DexIterators, DenseListsCombineWordwise) {
+  Corpus C{3000};
+  std::vector<DocID> Twos, Threes, Sevens;
+  for (DocID Doc = 0; Doc < 3000; ++Doc) {
+    if (Doc % 2 == 0)
+      Twos.push_back(Doc);
+    if (Doc % 3 == 0)
+      Threes.push_back(Doc);
+    if (Doc % 7 == 0)
+      Sevens.push_back(Doc);
+  }
+  const PostingList L2(Twos), L3(Threes), L7(Sevens);
+  Token T2(Token::Kind::Scope, "two::"), T3(Token::Kind::Scope, "three::"),
+      T7(Token::Kind::Scope, "seven::");
+
+  auto And = C.intersect(L2.iterator(&T2), L3.iterator(&T3));
+  EXPECT_EQ(llvm::to_string(*And), "(& S=two:: S=three::)");
+  std::vector<DocID> Expected;
+  for (DocID Doc = 0; Doc < 3000; Doc += 6)
+    Expected.push_back(Doc);
+  EXPECT_EQ(consumeIDs(*And), Expected);
+
+  // The intersection is united with the third list, not merged into it.
+  auto Or = C.unionOf(C.intersect(L2.iterator(&T2), L3.iterator(&T3)),
+                      L7.iterator(&T7));
+  EXPECT_THAT(llvm::to_string(*Or),
+              AnyOf("(| (& S=two:: S=three::) S=seven::)",
+                    "(| S=seven:: (& S=two:: S=three::))"));
+  Expected.clear();
+  for (DocID Doc = 0; Doc < 3000; ++Doc)
+    if (Doc % 6 == 0 || Doc % 7 == 0)
+      Expected.push_back(Doc);
+  EXPECT_EQ(consumeIDs(*Or), Expected);
+
+  // Sparse lists are still intersected one element at a time.
+  const PostingList Sparse({6, 7, 12, 2999});
+  auto Mixed = C.intersect(L2.iterator(), L3.iterator(), Sparse.iterator());
+  EXPECT_THAT(consumeIDs(*Mixed), ElementsAre(6, 12));
+}
+
 TEST(DexIterators, AndTwoLists) {
   Corpus C{10000};
   const PostingList L0({0, 5, 7, 10, 42, 320, 9000});
@@ -314,6 +423,20 @@ TEST(DexIterators, Boost) {
   EXPECT_THAT(ElementBoost, 3);
 }
 
+TEST(DexIterators, MaxBoost) {
+  Corpus C{5};
+  const PostingList L0({2, 4});
+  const PostingList L1({1, 4});
+  EXPECT_EQ(C.all()->maxBoost(), 1);
+  EXPECT_EQ(C.boost(L0.iterator(), 2U)->maxBoost(), 2);
+
+  auto Root = C.unionOf(C.all(), C.boost(L0.iterator(), 2U),
+                        C.boost(L1.iterator(), 3U));
+  EXPECT_EQ(Root->maxBoost(), 3);
+  Root = C.intersect(std::move(Root), C.boost(L0.iterator(), 0.5));
+  EXPECT_EQ(Root->maxBoost(), 1.5);
+}
+
 TEST(DexIterators, Optimizations) {
   Corpus C{5};
   const PostingList L1{1};
@@ -402,6 +525,19 @@ TEST(DexTrigrams, IdentifierTrigrams) {
                    "hij", "hik", "hkl", "ijk", "ikl", "jkl", "klm"}));
 }
 
+TEST(DexTrigrams, PackedTrigrams) {
+  for (llvm::StringRef Chars : {"", "a", "ab", "abc", "x_8"})
+    EXPECT_EQ(Trigram(Chars).token(), Token(Token::Kind::Trigram, Chars));
+  EXPECT_FALSE(Trigram("a") == Trigram(llvm::StringRef("a\0", 2)));
+
+  std::vector<Trigram> Packed = {Trigram("old")};
+  generateIdentifierTrigrams("abc_def", Packed);
+  std::vector<Token> Tokens;
+  for (const Trigram &T : Packed)
+    Tokens.push_back(T.token());
+  EXPECT_EQ(Tokens, generateIdentifierTrigrams("abc_def"));
+}
+
 TEST(DexTrigrams, QueryTrigrams) {
   EXPECT_THAT(generateQueryTrigrams("c"), trigramsAre({"c"}));
   EXPECT_THAT(generateQueryTrigrams("cl"), trigramsAre({"cl"}));
@@ -488,6 +624,18 @@ TEST(Dex, FuzzyFind) {
                                    "other::A"));
 }
 
+TEST(DexTest, BuildLargeIndex) {
+  // Big enough to be built in several shards, given enough threads.
+  auto I = Dex::build(generateNumSymbols(0, 50000), RefSlab());
+  FuzzyFindRequest Req;
+  Req.AnyScope = true;
+  EXPECT_EQ(match(*I, Req).size(), 50001u);
+  Req.Query = "49999";
+  EXPECT_THAT(match(*I, Req), ElementsAre("49999"));
+  EXPECT_THAT(lookup(*I, {SymbolID("0"), SymbolID("25000")}),
+              UnorderedElementsAre("0", "25000"));
+}
+
 TEST(DexTest, DexLimitedNumMatches) {
   auto I = Dex::build(generateNumSymbols(0, 100), RefSlab());
   FuzzyFindRequest Req;
@@ -501,6 +649,75 @@ TEST(DexTest, DexLimitedNumMatches) {
   EXPECT_TRUE(Incomplete);
 }
 
+TEST(DexTest, LimitKeepsBestMatches) {
+  SymbolSlab::Builder B;
+  for (int I = 0; I < 1000; ++I) {
+    Symbol Sym = symbol("a" + std::to_string(1000 + I));
+    Sym.References = I * I; // Distinct qualities, so the order is unambiguous.
+    B.insert(Sym);
+  }
+  auto I = Dex::build(std::move(B).build(), RefSlab());
+  FuzzyFindRequest Req;
+  Req.Query = "a";
+  Req.AnyScope = true;
+  auto All = match(*I, Req);
+  ASSERT_EQ(All.size(), 1000u);
+  // Most candidates can't beat the best 5 and are skipped.
+  Req.Limit = 5;
+  bool Incomplete;
+  EXPECT_THAT(match(*I, Req, &Incomplete),
+              ElementsAreArray(All.begin(), All.begin() + 5));
+  EXPECT_TRUE(Incomplete);
+}
+
+TEST(DexTest, LimitKeepsBoostedMatches) {
+  SymbolSlab::Builder B;
+  for (int I = 0; I < 1000; ++I) {
+    std::string Name = "a" + std::to_string(1000 + I);
+    Symbol Sym = symbol(Name);
+    Sym.References = I * I;
+    B.insert(Sym);
+  }
+  // Lower quality than the best symbols, but boosted by its scope.
+  Symbol Boosted = symbol("ns::abc");
+  Boosted.References = 1000;
+  B.insert(Boosted);
+  auto I = Dex::build(std::move(B).build(), RefSlab());
+  FuzzyFindRequest Req;
+  Req.Query = "a";
+  Req.Scopes = {"ns::"};
+  Req.AnyScope = true;
+  Req.Limit = 1;
+  bool Incomplete;
+  EXPECT_THAT(match(*I, Req, &Incomplete), ElementsAre("ns::abc"));
+  EXPECT_TRUE(Incomplete);
+}
+
+TEST(DexTest, FuzzyFindBatch) {
+  auto I = Dex::build(generateNumSymbols(0, 100), RefSlab());
+  std::vector<FuzzyFindRequest> Reqs(3);
+  for (auto &Req : Reqs)
+    Req.AnyScope = true;
+  Reqs[0].Query = "42";
+  Reqs[1].Query = "5";
+  Reqs[1].Limit = 3;
+  Reqs[2].Query = "7";
+  std::vector<std::vector<std::string>> Matches(Reqs.size());
+  std::vector<bool> More =
+      I->fuzzyFindBatch(Reqs, [&](size_t Req, const Symbol &S) {
+        Matches[Req].push_back((S.Scope + S.Name).str());
+      });
+  // Each request gets the same results running it alone would.
+  for (size_t Req = 0; Req < Reqs.size(); ++Req) {
+    bool Incomplete;
+    EXPECT_THAT(Matches[Req],
+                UnorderedElementsAreArray(match(*I, Reqs[Req], &Incomplete)));
+    EXPECT_EQ(More[Req], Incomplete);
+  }
+  EXPECT_THAT(Matches[0], ElementsAre("42"));
+  EXPECT_TRUE(More[1]);
+}
+
 TEST(DexTest, FuzzyMatch) {
   auto I = Dex::build(
       generateSymbols({"LaughingOutLoud", "LionPopulation", "LittleOldLady"}),
@@ -588,6 +805,59 @@ TEST(DexTest, WildcardScope) {
               UnorderedElementsAre("a::y1", "a::b::y2", "c::y3"));
 }
 
+TEST(DexTest, ScopePartitions) {
+  // a:: and b:: are large enough to have their own trigram lists.
+  std::vector<std::string> Names = {"c::y12", "c::x12", "a::b::y12"};
+  for (unsigned I = 0; I < 1000; ++I) {
+    Names.push_back("a::y" + std::to_string(I));
+    Names.push_back("b::x" + std::to_string(I));
+  }
+  SymbolSlab Symbols = generateSymbols(Names);
+  Dex I(Symbols, RefSlab());
+  Postings P = I.postings();
+  EXPECT_TRUE(llvm::any_of(
+      P.Lists, [](const std::pair<Token, std::vector<Chunk>> &List) {
+        return List.first == Token(Token::Kind::ScopedTrigram, "a::y12");
+      }));
+  // Restored posting lists keep the partitions.
+  auto Restored = Dex::build(generateSymbols(Names), RefSlab(), std::move(P));
+
+  for (const SymbolIndex *Index :
+       {static_cast<const SymbolIndex *>(&I), Restored.get()}) {
+    // The matches of a query in any scope, that are in one of Scopes.
+    auto MatchesInScopes = [&](llvm::StringRef Query,
+                               std::vector<std::string> Scopes) {
+      FuzzyFindRequest Req;
+      Req.Query = Query;
+      Req.AnyScope = true;
+      std::vector<std::string> Result;
+      for (const std::string &Name : match(*Index, Req)) {
+        llvm::StringRef Scope = llvm::StringRef(Name).rsplit("::").first;
+        if (llvm::is_contained(Scopes, (Scope + "::").str()))
+          Result.push_back(Name);
+      }
+      return Result;
+    };
+    std::vector<std::vector<std::string>> AllScopes = {
+        {"a::"}, {"b::", "c::"}, {"a::b::"}, {"a::", "b::", "c::"}};
+    FuzzyFindRequest Req;
+    for (std::string Query : {"y12", "x12", "y", "12"})
+      for (const auto &Scopes : AllScopes) {
+        Req.Query = Query;
+        Req.Scopes = Scopes;
+        EXPECT_THAT(match(*Index, Req),
+                    UnorderedElementsAreArray(MatchesInScopes(Query, Scopes)))
+            << Query;
+      }
+    Req.Query = "y12";
+    Req.Scopes = {"a::"};
+    EXPECT_THAT(match(*Index, Req), Contains("a::y12"));
+    Req.Query = "";
+    Req.Scopes = {"c::"};
+    EXPECT_THAT(match(*Index, Req), UnorderedElementsAre("c::y12", "c::x12"));
+  }
+}
+
 TEST(DexTest, IgnoreCases) {
   auto I = Dex::build(generateSymbols({"ns::ABC", "ns::abc"}), RefSlab());
   FuzzyFindRequest Req;
@@ -688,6 +958,119 @@ TEST(DexTests, Refs) {
   EXPECT_THAT(Files, ElementsAre(AnyOf("foo.h", "foo.cc")));
 }
 
+TEST(DexTests, Relations) {
+  auto Parent = symbol("Parent");
+  auto Child1 = symbol("Child1");
+  auto Child2 = symbol("Child2");
+
+  std::vector<Symbol> Symbols{Parent, Child1, Child2};
+  std::vector<Relation> Relations{
+      {Parent.ID, index::SymbolRole::RelationBaseOf, Child1.ID},
+      {Parent.ID, index::SymbolRole::RelationBaseOf, Child2.ID}};
+
+  Dex I{Symbols, RefSlab(), Relations};
+
+  std::vector<SymbolID> Results;
+  RelationsRequest Req;
+  Req.Subjects.insert(Parent.ID);
+  Req.Predicate = index::SymbolRole::RelationBaseOf;
+  I.relations(Req, [&](const SymbolID &Subject, const Symbol &Object) {
+    EXPECT_EQ(Subject, Parent.ID);
+    Results.push_back(Object.ID);
+  });
+  EXPECT_THAT(Results, UnorderedElementsAre(Child1.ID, Child2.ID));
+
+  Req.Limit = 1;
+  Results.clear();
+  I.relations(Req, [&](const SymbolID &, const Symbol &Object) {
+    Results.push_back(Object.ID);
+  });
+  EXPECT_THAT(Results, ElementsAre(AnyOf(Child1.ID, Child2.ID)));
+}
+
+TEST(DexTests, CompactRefs) {
+  std::string A = "unittest:///a.h", B = "unittest:///b.h";
+  std::vector<Ref> Refs(3);
+  Refs[0].Location.FileURI = B.c_str();
+  Refs[0].Location.Start.setLine(10);
+  Refs[0].Location.End.setLine(10);
+  Refs[0].Location.End.setColumn(3);
+  Refs[1].Location.FileURI = A.c_str();
+  Refs[1].Location.Start.setLine(200);
+  Refs[1].Location.Start.setColumn(4);
+  Refs[1].Location.End.setLine(201);
+  Refs[1].Kind = RefKind::Definition;
+  Refs[2].Location.FileURI = B.c_str();
+  Refs[2].Location.Start.setLine(2);
+  Refs[2].Location.End.setLine(1); // Bogus, but must round-trip.
+  Refs[2].Kind = RefKind::Reference;
+
+  CompactRefs Compact;
+  Compact.insert(SymbolID("foo"), Refs);
+  std::vector<Ref> Decoded;
+  Compact.forEach(SymbolID("foo"), [&](const Ref &R) {
+    Decoded.push_back(R);
+    return true;
+  });
+  EXPECT_THAT(Decoded, UnorderedElementsAreArray(Refs));
+  // Strings are owned by the CompactRefs.
+  for (const Ref &R : Decoded)
+    EXPECT_TRUE(R.Location.FileURI != A.c_str() &&
+                R.Location.FileURI != B.c_str());
+
+  Decoded.clear();
+  Compact.forEach(SymbolID("foo"), [&](const Ref &R) {
+    Decoded.push_back(R);
+    return false;
+  });
+  EXPECT_EQ(Decoded.size(), 1u);
+  Compact.forEach(SymbolID("bar"), [&](const Ref &) {
+    ADD_FAILURE() << "bar has no refs";
+    return true;
+  });
+}
+
+TEST(DexTests, RefsNearProximityPaths) {
+  std::string Main = URI::create(testPath("a/b/main.cc")).toString();
+  std::string Near = URI::create(testPath("a/b/near.cc")).toString();
+  std::string Middle = URI::create(testPath("a/middle.cc")).toString();
+  std::string Far = URI::create(testPath("c/far.cc")).toString();
+  auto Foo = symbol("foo");
+  llvm::DenseMap<SymbolID, std::vector<Ref>> Refs;
+  // Refs in main.cc itself are skipped, they don't take up the limit.
+  for (const std::string *File : {&Main, &Far, &Near, &Main, &Middle, &Far}) {
+    Refs[Foo.ID].emplace_back();
+    Refs[Foo.ID].back().Kind = RefKind::Reference;
+    Refs[Foo.ID].back().Location.FileURI = File->c_str();
+  }
+
+  RefsRequest Req;
+  Req.IDs.insert(Foo.ID);
+  Req.Limit = 2;
+  Req.ProximityPaths = {testPath("a/b/main.cc")};
+  std::vector<std::string> Files;
+  Dex(std::vector<Symbol>{Foo}, Refs).refs(Req, [&](const Ref &R) {
+    Files.push_back(R.Location.FileURI);
+  });
+  EXPECT_THAT(Files, ElementsAre(Near, Middle));
+}
+
+TEST(DexTest, Cancelled) {
+  auto I = Dex::build(generateNumSymbols(0, 100), RefSlab());
+  FuzzyFindRequest Req;
+  Req.AnyScope = true;
+
+  auto Task = cancelableTask();
+  WithContext Cancelable(std::move(Task.first));
+  bool Incomplete = false;
+  EXPECT_THAT(match(*I, Req, &Incomplete), testing::SizeIs(101));
+  EXPECT_FALSE(Incomplete);
+
+  Task.second();
+  EXPECT_THAT(match(*I, Req, &Incomplete), ElementsAre());
+  EXPECT_TRUE(Incomplete);
+}
+
 TEST(DexTest, PreferredTypesBoosting) {
   auto Sym1 = symbol("t1");
   Sym1.Type = "T1";
@@ -8,6 +8,7 @@
 
 #include "Annotations.h"
 #include "ClangdUnit.h"
+#include "IncludeFixer.h"
 #include "SourceCode.h"
 #include "TestIndex.h"
 #include "TestTU.h"
@@ -124,6 +125,30 @@ o]]();
                "no member named 'test' in namespace 'test'")));
 }
 
+TEST(DiagnosticsTest, DetailLimit) {
+  Annotations Test(R"cpp(
+    void $decl[[foo]]();
+    int main() {
+      $first[[goo]]();
+      $second[[goo]]();
+    }
+  )cpp");
+  auto TU = TestTU::withCode(Test.code());
+  TU.DetailedDiagnosticsLimit = 1;
+  const char *Message = "use of undeclared identifier 'goo'; did you mean "
+                        "'foo'?";
+  EXPECT_THAT(
+      TU.build().getDiagnostics(),
+      ElementsAre(
+          AllOf(Diag(Test.range("first"), Message),
+                WithFix(Fix(Test.range("first"), "foo",
+                            "change 'goo' to 'foo'")),
+                WithNote(Diag(Test.range("decl"), "'foo' declared here"))),
+          AllOf(Diag(Test.range("second"), Message),
+                Field(&Diag::Fixes, IsEmpty()),
+                Field(&Diag::Notes, IsEmpty()))));
+}
+
 TEST(DiagnosticsTest, FlagsMatter) {
   Annotations Test("[[void]] main() {}");
   auto TU = TestTU::withCode(Test.code());
@@ -521,6 +546,77 @@ void bar(X *x) {
   }
 }
 
+// Counts the batches of index requests.
+class CountingIndex : public SwapIndex {
+public:
+  using SwapIndex::SwapIndex;
+
+  std::vector<bool> fuzzyFindBatch(
+      llvm::ArrayRef<FuzzyFindRequest> Reqs,
+      llvm::function_ref<void(size_t, const Symbol &)> CB) const override {
+    ++Requests;
+    return SwapIndex::fuzzyFindBatch(Reqs, CB);
+  }
+  void lookup(const LookupRequest &Req,
+              llvm::function_ref<void(const Symbol &)> CB) const override {
+    ++Requests;
+    SwapIndex::lookup(Req, CB);
+  }
+
+  mutable unsigned Requests = 0;
+};
+
+TEST(IncludeFixerTest, CachedAcrossBuilds) {
+  Annotations Test(R"cpp(
+$insert[[]]void foo() {
+  $x[[X]] x;
+  $z[[Z]] z;
+}
+
+class Y;
+void bar(Y *y) {
+  y$y[[->]]f();
+}
+  )cpp");
+  auto Symbols = [] {
+    return buildIndexWithSymbol(
+        {SymbolWithHeader{"X", "unittest:///x.h", "\"x.h\""},
+         SymbolWithHeader{"Y", "unittest:///y.h", "\"y.h\""},
+         SymbolWithHeader{"Z", "unittest:///z.h", "\"z.h\""}});
+  };
+  CountingIndex Index(Symbols());
+  IncludeFixerCache Cache;
+  auto TU = TestTU::withCode(Test.code());
+  TU.ExternalIndex = &Index;
+  TU.IncludeFixCache = &Cache;
+
+  auto ExpectFixes = [&] {
+    EXPECT_THAT(
+        TU.build().getDiagnostics(),
+        UnorderedElementsAre(
+            AllOf(Diag(Test.range("x"), "unknown type name 'X'"),
+                  WithFix(Fix(Test.range("insert"), "#include \"x.h\"\n",
+                              "Add include \"x.h\" for symbol X"))),
+            AllOf(Diag(Test.range("z"), "unknown type name 'Z'"),
+                  WithFix(Fix(Test.range("insert"), "#include \"z.h\"\n",
+                              "Add include \"z.h\" for symbol Z"))),
+            AllOf(Diag(Test.range("y"),
+                       "member access into incomplete type 'Y'"),
+                  WithFix(Fix(Test.range("insert"), "#include \"y.h\"\n",
+                              "Add include \"y.h\" for symbol Y")))));
+  };
+  // One lookup and one batch of fuzzy finds for all the diagnostics.
+  ExpectFixes();
+  EXPECT_EQ(Index.Requests, 2u);
+  // The results are reused by the next build.
+  ExpectFixes();
+  EXPECT_EQ(Index.Requests, 2u);
+  // Until the index changes.
+  Index.reset(Symbols());
+  ExpectFixes();
+  EXPECT_EQ(Index.Requests, 4u);
+}
+
 TEST(IncludeFixerTest, UnresolvedNameAsSpecifier) {
   Annotations Test(R"cpp(
 $insert[[]]namespace ns {
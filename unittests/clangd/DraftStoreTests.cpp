@@ -180,6 +180,55 @@ cookies()
   allAtOnce(Steps);
 }
 
+TEST(DraftStoreIncrementalUpdateTest, LinesShiftedByEarlierEdits) {
+  // clang-format off
+  IncrementalTestStep Steps[] =
+    {
+      // Split the first line, so the following lines move down.
+      {
+R"cpp(int a;[[]] int b;
+int c;
+int d;)cpp",
+        "\n\n"
+      },
+      // Edit a line that moved.
+      {
+R"cpp(int a;
+
+ int b;
+int [[c]];
+int d;)cpp",
+        "e"
+      },
+      // Join lines, so the following lines move up.
+      {
+R"cpp(int a;[[
+
+ ]]int b;
+int e;
+int d;)cpp",
+        " "
+      },
+      // Edit the (now) last line.
+      {
+R"cpp(int a; int b;
+int e;
+int [[d]];)cpp",
+        "f"
+      },
+      {
+R"cpp(int a; int b;
+int e;
+int f;)cpp",
+        ""
+      }
+    };
+  // clang-format on
+
+  stepByStep(Steps);
+  allAtOnce(Steps);
+}
+
 TEST(DraftStoreIncrementalUpdateTest, WrongRangeLength) {
   DraftStore DS;
   Path File = "foo.cpp";
@@ -220,6 +269,7 @@ TEST(DraftStoreIncrementalUpdateTest, EndBeforeStart) {
   EXPECT_TRUE(!Result);
   EXPECT_EQ(toString(Result.takeError()),
             "Range's end position (0:3) is before start position (0:5)");
+  EXPECT_EQ(*DS.getDraft(File), "int main() {}\n");
 }
 
 TEST(DraftStoreIncrementalUpdateTest, StartCharOutOfRange) {
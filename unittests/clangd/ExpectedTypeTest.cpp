@@ -148,6 +148,37 @@ TEST_F(ExpectedTypeConversionTest, FunctionReturns) {
   EXPECT_EQ(fromCompletionResult(decl("returns_ptr")), IntPtrTy);
 }
 
+TEST_F(ExpectedTypeConversionTest, PreferredTypeMatcher) {
+  build(R"cpp(
+     int int_;
+     long long_;
+     int* int_ptr;
+     int arr[2];
+     int returns_int();
+     struct X {};
+     X user_type;
+  )cpp");
+
+  auto Matches = [&](const PreferredTypeMatcher &Matcher,
+                     llvm::StringRef Name) {
+    return Matcher.matches(CodeCompletionResult(decl(Name), CCP_Declaration));
+  };
+
+  auto IntMatcher = PreferredTypeMatcher::create(ASTCtx(), typeOf("int_"));
+  ASSERT_TRUE(IntMatcher);
+  EXPECT_EQ(IntMatcher->encoded(),
+            *OpaqueType::fromType(ASTCtx(), typeOf("int_")));
+  EXPECT_EQ(Matches(*IntMatcher, "long_"), true);
+  EXPECT_EQ(Matches(*IntMatcher, "returns_int"), true);
+  EXPECT_EQ(Matches(*IntMatcher, "int_ptr"), false);
+  EXPECT_EQ(Matches(*IntMatcher, "user_type"), false);
+
+  auto PtrMatcher = PreferredTypeMatcher::create(ASTCtx(), typeOf("int_ptr"));
+  ASSERT_TRUE(PtrMatcher);
+  EXPECT_EQ(Matches(*PtrMatcher, "arr"), true);
+  EXPECT_EQ(Matches(*PtrMatcher, "int_"), false);
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
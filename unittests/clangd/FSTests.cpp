@@ -45,6 +45,66 @@ TEST(FSTests, PreambleStatusCache) {
   EXPECT_EQ(Cached->getName(), S.getName());
 }
 
+TEST(FSTests, WatchedFiles) {
+  FileChangeTracker Changes;
+  Changes.changed({testPath("x")});
+  uint64_t Version = Changes.version();
+  EXPECT_FALSE(Changes.changedSince(testPath("x"), Version));
+  Changes.changed({testPath("sub/../y")});
+  EXPECT_TRUE(Changes.changedSince(testPath("y"), Version));
+  EXPECT_FALSE(Changes.changedSince(testPath("x"), Version));
+
+  llvm::StringMap<std::string> Files;
+  Files["x"] = "";
+  Files["y"] = "";
+  Files["main"] = "";
+  auto FS = buildTestFS(Files);
+  PreambleFileStatusCache StatCache(testPath("main"));
+  auto ProduceFS = StatCache.getProducingFS(FS);
+  EXPECT_TRUE(ProduceFS->status(testPath("x")));
+  EXPECT_TRUE(ProduceFS->status(testPath("y")));
+
+  // Both files grew, but only y was reported.
+  Files["x"] = "int x;";
+  Files["y"] = "int y;";
+  auto WatchedFS =
+      StatCache.getWatchedFS(buildTestFS(Files), Changes, Version);
+  auto X = WatchedFS->status(testPath("x"));
+  ASSERT_TRUE(X);
+  EXPECT_EQ(X->getSize(), 0u);
+  auto Y = WatchedFS->status(testPath("y"));
+  ASSERT_TRUE(Y);
+  EXPECT_EQ(Y->getSize(), 6u);
+}
+
+TEST(FSTests, SharedFileContentCache) {
+  llvm::StringMap<std::string> Files;
+  Files["x"] = "int x;";
+  auto FS = buildTestFS(Files);
+  FS->setCurrentWorkingDirectory(testRoot());
+
+  SharedFileContentCache Cache;
+  auto CachingFS = Cache.getFS(FS);
+  auto X = CachingFS->getBufferForFile("x");
+  ASSERT_TRUE(X);
+  EXPECT_EQ((*X)->getBuffer(), "int x;");
+  EXPECT_FALSE(CachingFS->status("y"));
+
+  // Another run of the tool, e.g. on another thread, sees the cached files
+  // even though they changed.
+  Files["x"] = "int x = 1;";
+  Files["y"] = "";
+  auto OtherFS = Cache.getFS(buildTestFS(Files));
+  X = OtherFS->getBufferForFile(testPath("sub/../x"));
+  ASSERT_TRUE(X);
+  EXPECT_EQ((*X)->getBuffer(), "int x;");
+  auto S = OtherFS->status(testPath("x"));
+  ASSERT_TRUE(S);
+  EXPECT_EQ(S->getSize(), 6u);
+  EXPECT_EQ(S->getName(), testPath("x"));
+  EXPECT_FALSE(OtherFS->status(testPath("y")));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -108,6 +108,31 @@ TEST(FileDistance, DisallowDownTraversalsFromRoot) {
   EXPECT_EQ(D.distance("/x"), FileDistance::Unreachable);
 }
 
+TEST(URIDistanceCache, ReusedForSameSources) {
+  URIDistanceCache Cache;
+  llvm::StringMap<SourceParams> Sources = {{testPath("foo"), SourceParams()}};
+  auto D = Cache.take("main.cc", Sources);
+  URIDistance *First = D.get();
+  EXPECT_EQ(D->distance(URI::create(testPath("foo/x")).toString()), 1u);
+  Cache.put("main.cc", std::move(D));
+
+  // Same key and sources: reused.
+  D = Cache.take("main.cc", Sources);
+  EXPECT_EQ(D.get(), First);
+  // Already taken: a new one is created.
+  auto Other = Cache.take("main.cc", Sources);
+  EXPECT_NE(Other.get(), First);
+  Cache.put("main.cc", std::move(D));
+
+  // Different key.
+  EXPECT_NE(Cache.take("other.cc", Sources).get(), First);
+  // Different sources, e.g. after an #include was added.
+  Sources[testPath("bar")].Cost = 2;
+  D = Cache.take("main.cc", Sources);
+  EXPECT_NE(D.get(), First);
+  EXPECT_EQ(D->distance(URI::create(testPath("bar/y")).toString()), 3u);
+}
+
 TEST(ScopeDistance, Smoke) {
   ScopeDistance D({"x::y::z", "x::", "", "a::"});
   EXPECT_EQ(D.distance("x::y::z::"), 0u);
@@ -12,6 +12,7 @@
 #include "SyncAPI.h"
 #include "TestFS.h"
 #include "TestTU.h"
+#include "index/Background.h"
 #include "index/CanonicalIncludes.h"
 #include "index/FileIndex.h"
 #include "index/Index.h"
@@ -141,6 +142,46 @@ TEST(FileSymbolsTest, SnapshotAliveAfterRemove) {
   EXPECT_THAT(getRefs(*Symbols, ID), RefsAre({FileURI("f1.cc")}));
 }
 
+std::vector<std::string> allNames(const SymbolIndex &Index) {
+  FuzzyFindRequest Req;
+  Req.AnyScope = true;
+  std::vector<std::string> Names;
+  Index.fuzzyFind(Req, [&](const Symbol &Sym) { Names.push_back(Sym.Name); });
+  llvm::sort(Names);
+  return Names;
+}
+
+TEST(FileSymbolsTest, IncrementalIndex) {
+  FileSymbols FS;
+  for (int I = 0; I < 10; ++I)
+    FS.update("f" + std::to_string(I), numSlab(I * 10, I * 10 + 9), nullptr);
+  // f1 and f2 overlap.
+  FS.update("f2", numSlab(15, 29), nullptr);
+  EXPECT_EQ(allNames(*FS.buildIncrementalIndex()),
+            allNames(*FS.buildIndex(IndexType::Heavy)));
+
+  // Small updates go to the delta. Shared symbols 15..19 remain visible.
+  FS.update("f1", numSlab(100, 105), nullptr);
+  FS.update("f3", nullptr, nullptr);
+  auto Incremental = FS.buildIncrementalIndex();
+  EXPECT_EQ(allNames(*Incremental), allNames(*FS.buildIndex(IndexType::Heavy)));
+  EXPECT_THAT(runFuzzyFind(*Incremental, "10"),
+              UnorderedElementsAre(QName("10"), QName("100"), QName("101"),
+                                   QName("102"), QName("103"), QName("104"),
+                                   QName("105")));
+
+  LookupRequest Req;
+  Req.IDs = {SymbolID("12"), SymbolID("17"), SymbolID("35"), SymbolID("103")};
+  std::vector<std::string> Found;
+  Incremental->lookup(Req, [&](const Symbol &S) { Found.push_back(S.Name); });
+  EXPECT_THAT(Found, UnorderedElementsAre("17", "103"));
+
+  // A large update rebuilds the base.
+  FS.update("f4", numSlab(200, 300), nullptr);
+  EXPECT_EQ(allNames(*FS.buildIncrementalIndex()),
+            allNames(*FS.buildIndex(IndexType::Heavy)));
+}
+
 // Adds Basename.cpp, which includes Basename.h, which contains Code.
 void update(FileIndex &M, llvm::StringRef Basename, llvm::StringRef Code) {
   TestTU File;
@@ -245,6 +286,31 @@ TEST(FileIndexTest, HasSystemHeaderMappingsInPreamble) {
               "<algorithm>");
 }
 
+TEST(FileIndexTest, SharedHeaderSymbols) {
+  FileIndex M;
+  auto UpdatePreamble = [&](llvm::StringRef Filename, llvm::StringRef Header,
+                            llvm::StringRef Code) {
+    TestTU TU;
+    TU.Filename = Filename;
+    TU.HeaderFilename = Header;
+    TU.HeaderCode = Code;
+    auto AST = TU.build();
+    M.updatePreamble(TU.Filename, AST.getASTContext(),
+                     AST.getPreprocessorPtr(), AST.getCanonicalIncludes());
+  };
+  UpdatePreamble("f1.cpp", "common.h", "int common();");
+  UpdatePreamble("f2.cpp", "common.h", "int common();");
+  EXPECT_THAT(runFuzzyFind(M, ""), UnorderedElementsAre(QName("common")));
+
+  // common.h is still used by f2.
+  UpdatePreamble("f1.cpp", "other.h", "int other();");
+  EXPECT_THAT(runFuzzyFind(M, ""),
+              UnorderedElementsAre(QName("common"), QName("other")));
+
+  UpdatePreamble("f2.cpp", "other.h", "int other();");
+  EXPECT_THAT(runFuzzyFind(M, ""), UnorderedElementsAre(QName("other")));
+}
+
 TEST(FileIndexTest, TemplateParamsInLabel) {
   auto Source = R"cpp(
 template <class Ty>
@@ -417,6 +483,80 @@ TEST(FileIndexTest, ReferencesInMainFileWithPreamble) {
   EXPECT_THAT(getRefs(Index, Foo.ID), RefsAre({RefRange(Main.range())}));
 }
 
+// Keeps snapshots in memory, serialized.
+class MemorySnapshotStorage : public BackgroundIndexStorage {
+public:
+  llvm::Error storeShard(llvm::StringRef ShardIdentifier,
+                         IndexFileOut Shard) const override {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Shards[ShardIdentifier] = llvm::to_string(Shard);
+    return llvm::Error::success();
+  }
+
+  std::unique_ptr<IndexFileIn>
+  loadShard(llvm::StringRef ShardIdentifier) const override {
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = Shards.find(ShardIdentifier);
+    if (It == Shards.end())
+      return nullptr;
+    auto IndexFile = readIndexFile(It->second);
+    if (!IndexFile) {
+      ADD_FAILURE() << "Error while reading " << ShardIdentifier << ':'
+                    << IndexFile.takeError();
+      return nullptr;
+    }
+    return llvm::make_unique<IndexFileIn>(std::move(*IndexFile));
+  }
+
+private:
+  mutable std::mutex Mu;
+  mutable llvm::StringMap<std::string> Shards;
+};
+
+TEST(FileIndexTest, RestoreSnapshot) {
+  MemorySnapshotStorage Storage;
+  auto UseStorage = [&](FileIndex &Index) {
+    Index.setSnapshotStorage(
+        [&](PathRef) -> BackgroundIndexStorage * { return &Storage; });
+  };
+  TestTU TU;
+  TU.Filename = "test.cc";
+  TU.HeaderCode = "class Foo {};";
+  TU.Code = "void f() { Foo foo; }";
+  auto Foo = findSymbol(TU.headerSymbols(), "Foo");
+  {
+    FileIndex Index;
+    UseStorage(Index);
+    auto AST = TU.build();
+    Index.updatePreamble(TU.Filename, AST.getASTContext(),
+                         AST.getPreprocessorPtr(), AST.getCanonicalIncludes());
+    Index.updateMain(TU.Filename, AST);
+  }
+
+  {
+    // The main file changed since, only its preamble symbols are restored.
+    FileIndex Index;
+    UseStorage(Index);
+    EXPECT_TRUE(Index.restoreSnapshot(TU.Filename, "void g();"));
+    EXPECT_THAT(runFuzzyFind(Index, "Foo"), ElementsAre(QName("Foo")));
+    EXPECT_THAT(getRefs(Index, Foo.ID), IsEmpty());
+  }
+
+  FileIndex Index;
+  UseStorage(Index);
+  EXPECT_TRUE(Index.restoreSnapshot(TU.Filename, TU.Code));
+  EXPECT_THAT(runFuzzyFind(Index, "Foo"), ElementsAre(QName("Foo")));
+  EXPECT_THAT(getRefs(Index, Foo.ID),
+              RefsAre({FileURI("unittest:///test.cc")}));
+
+  // Once the file is indexed again, its snapshot is outdated.
+  auto AST = TU.build();
+  Index.updatePreamble(TU.Filename, AST.getASTContext(),
+                       AST.getPreprocessorPtr(), AST.getCanonicalIncludes());
+  Index.updateMain(TU.Filename, AST);
+  EXPECT_FALSE(Index.restoreSnapshot(TU.Filename, TU.Code));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,50 @@
+//===-- FileNameIndexTests.cpp  -----------------------*- C++ -*-----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "FileNameIndex.h"
+#include "TestFS.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace clangd {
+namespace {
+
+TEST(FileNameIndexTests, Counterpart) {
+  FileNameIndex Files;
+  Files.addFile(testPath("foo/a.cpp"));
+  Files.addFile(testPath("foo/a.h"));
+  Files.addFile(testPath("foo/a.inc"));
+  Files.addFile(testPath("foo/b.cc"));
+  Files.addFile(testPath("bar/b.h"));
+  Files.addFile(testPath("foo/a.cpp")); // Duplicates are ignored.
+  EXPECT_EQ(Files.size(), 5u);
+
+  EXPECT_EQ(Files.counterpart(testPath("foo/a.cpp")), testPath("foo/a.h"));
+  EXPECT_EQ(Files.counterpart(testPath("foo/a.h")), testPath("foo/a.cpp"));
+  EXPECT_EQ(Files.counterpart(testPath("foo/a.inc")), testPath("foo/a.cpp"));
+  // Counterparts must be in the same directory.
+  EXPECT_EQ(Files.counterpart(testPath("foo/b.cc")), llvm::None);
+  EXPECT_EQ(Files.counterpart(testPath("bar/b.h")), llvm::None);
+  // Unknown files may still have known counterparts.
+  EXPECT_EQ(Files.counterpart(testPath("foo/a.hpp")), testPath("foo/a.cpp"));
+  EXPECT_EQ(Files.counterpart(testPath("foo/a.txt")), llvm::None);
+}
+
+TEST(FileNameIndexTests, Extensions) {
+  EXPECT_TRUE(isSourceFilePath("a.cpp"));
+  EXPECT_TRUE(isSourceFilePath("a.CC"));
+  EXPECT_FALSE(isSourceFilePath("a.h"));
+  EXPECT_TRUE(isHeaderFilePath("a.hpp"));
+  EXPECT_TRUE(isHeaderFilePath("a.H"));
+  EXPECT_FALSE(isHeaderFilePath("a"));
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
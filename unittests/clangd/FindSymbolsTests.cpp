@@ -415,6 +415,16 @@ TEST_F(DocumentSymbolsTest, BasicSymbols) {
                      AllOf(WithName("v2"), WithKind(SymbolKind::Namespace))))}));
 }
 
+TEST_F(DocumentSymbolsTest, NewVersion) {
+  std::string FilePath = testPath("foo.cpp");
+  addFile(FilePath, "int a;");
+  EXPECT_THAT(getSymbols(FilePath), ElementsAre(WithName("a")));
+  // Cached for the same version.
+  EXPECT_THAT(getSymbols(FilePath), ElementsAre(WithName("a")));
+  addFile(FilePath, "int a; int b;");
+  EXPECT_THAT(getSymbols(FilePath), ElementsAre(WithName("a"), WithName("b")));
+}
+
 TEST_F(DocumentSymbolsTest, DeclarationDefinition) {
   std::string FilePath = testPath("foo.cpp");
   Annotations Main(R"(
@@ -10,8 +10,12 @@
 
 #include "TestFS.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Path.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include <thread>
 
 namespace clang {
 namespace clangd {
@@ -37,6 +41,51 @@ TEST(GlobalCompilationDatabaseTest, FallbackCommand) {
                           testPath("foo/bar.h")));
 }
 
+TEST(GlobalCompilationDatabaseTest, ReloadChangedDatabase) {
+  llvm::SmallString<128> Dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("clangd-cdb-reload", Dir));
+  llvm::SmallString<128> JSONPath(Dir), File(Dir);
+  llvm::sys::path::append(JSONPath, "compile_commands.json");
+  llvm::sys::path::append(File, "foo.cc");
+  auto WriteDB = [&](llvm::StringRef Flag) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(JSONPath, EC, llvm::sys::fs::F_Text);
+    ASSERT_FALSE(EC);
+    OS << llvm::formatv(R"json([{{
+      "directory": "{0}",
+      "command": "clang {1} foo.cc",
+      "file": "foo.cc"
+    }])json",
+                        Dir, Flag);
+  };
+
+  DirectoryBasedGlobalCompilationDatabase DB(None);
+  std::vector<std::string> Changes;
+  auto Sub = DB.watch([&](const std::vector<std::string> &ChangedFiles) {
+    Changes.insert(Changes.end(), ChangedFiles.begin(), ChangedFiles.end());
+  });
+  WriteDB("-DFOO");
+  auto Cmd = DB.getCompileCommand(File);
+  ASSERT_TRUE(Cmd);
+  EXPECT_THAT(Cmd->CommandLine, Contains("-DFOO"));
+
+  // Unrelated files and databases in directories that weren't searched don't
+  // cause reloads.
+  Changes.clear();
+  EXPECT_FALSE(DB.filesChanged(
+      {File.str().str(), testPath("other/compile_commands.json")}));
+  EXPECT_TRUE(Changes.empty());
+
+  WriteDB("-DBARBAZ");
+  EXPECT_TRUE(DB.filesChanged({JSONPath.str().str()}));
+  EXPECT_THAT(Changes, Contains(EndsWith("foo.cc")));
+  Cmd = DB.getCompileCommand(File);
+  ASSERT_TRUE(Cmd);
+  EXPECT_THAT(Cmd->CommandLine,
+              AllOf(Contains("-DBARBAZ"), Not(Contains("-DFOO"))));
+  llvm::sys::fs::remove_directories(Dir);
+}
+
 static tooling::CompileCommand cmd(llvm::StringRef File, llvm::StringRef Arg) {
   return tooling::CompileCommand(testRoot(), File, {"clang", Arg, File}, "");
 }
@@ -146,6 +195,26 @@ TEST_F(OverlayCDBTest, Adjustments) {
                     Not(Contains("random-plugin"))));
 }
 
+TEST_F(OverlayCDBTest, ConcurrentReadsAndWrites) {
+  OverlayCDB CDB(Base.get(), {}, std::string(""));
+  std::vector<std::thread> Readers;
+  for (int I = 0; I < 4; ++I)
+    Readers.emplace_back([&] {
+      for (int J = 0; J < 1000; ++J) {
+        auto Cmd = CDB.getCompileCommand(testPath("foo.cc"));
+        ASSERT_TRUE(Cmd);
+        EXPECT_THAT(Cmd->CommandLine,
+                    ::testing::AnyOf(Contains("-DA=1"), Contains("-DA=3")));
+      }
+    });
+  for (int J = 0; J < 100; ++J) {
+    CDB.setCompileCommand(testPath("foo.cc"), cmd(testPath("foo.cc"), "-DA=3"));
+    CDB.setCompileCommand(testPath("foo.cc"), llvm::None);
+  }
+  for (auto &Reader : Readers)
+    Reader.join();
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
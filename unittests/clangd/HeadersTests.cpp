@@ -252,6 +252,14 @@ TEST_F(HeadersTest, PreferInserted) {
   EXPECT_TRUE(StringRef(Edit->newText).contains("<y>"));
 }
 
+TEST(IncludeSpellingCacheTest, KeyedByBuildDir) {
+  IncludeSpellingCache Cache;
+  Cache.put("/build", "/src/a.h", "\"a.h\"");
+  EXPECT_EQ(Cache.get("/build", "/src/a.h"), std::string("\"a.h\""));
+  EXPECT_EQ(Cache.get("/other", "/src/a.h"), llvm::None);
+  EXPECT_EQ(Cache.get("/build", "/src/b.h"), llvm::None);
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
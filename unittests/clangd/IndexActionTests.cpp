@@ -74,9 +74,10 @@ public:
         new FileManager(FileSystemOptions(), InMemoryFileSystem));
 
     auto Action = createStaticIndexingAction(
-        SymbolCollector::Options(),
+        CollectorOpts,
         [&](SymbolSlab S) { IndexFile.Symbols = std::move(S); },
         [&](RefSlab R) { IndexFile.Refs = std::move(R); },
+        [&](RelationSlab R) { IndexFile.Relations = std::move(R); },
         [&](IncludeGraph IG) { IndexFile.Sources = std::move(IG); });
 
     std::vector<std::string> Args = {"index_action", "-fsyntax-only",
@@ -102,6 +103,7 @@ public:
   }
 
 protected:
+  SymbolCollector::Options CollectorOpts;
   std::vector<std::string> FilePaths;
   llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> InMemoryFileSystem;
 };
@@ -248,6 +250,34 @@ TEST_F(IndexActionTest, NoWarnings) {
   EXPECT_THAT(*IndexFile.Symbols, ElementsAre(HasName("foo"), HasName("bar")));
 }
 
+TEST_F(IndexActionTest, SkipFilteredFunctionBodies) {
+  std::string MainFilePath = testPath("main.cpp");
+  std::string MainCode = R"cpp(
+      #include "header.h"
+      void main_file() { callee(); }
+  )cpp";
+  std::string HeaderPath = testPath("header.h");
+  std::string HeaderCode = R"cpp(
+      void callee();
+      inline void header() { callee(); }
+  )cpp";
+  addFile(MainFilePath, MainCode);
+  addFile(HeaderPath, HeaderCode);
+  CollectorOpts.FileFilter = [](const SourceManager &SM, FileID FID) {
+    return FID == SM.getMainFileID();
+  };
+  IndexFileIn IndexFile = runIndexingAction(MainFilePath);
+  ASSERT_TRUE(IndexFile.Refs);
+  // The body of header() isn't parsed, so callee() is only referenced from
+  // the main file.
+  std::vector<std::string> ReferencingFiles;
+  for (const auto &SymbolAndRefs : *IndexFile.Refs)
+    for (const Ref &R : SymbolAndRefs.second)
+      if (R.Kind == RefKind::Reference)
+        ReferencingFiles.push_back(R.Location.FileURI);
+  EXPECT_THAT(ReferencingFiles, ElementsAre(toUri(MainFilePath)));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
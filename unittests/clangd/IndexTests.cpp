@@ -7,9 +7,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "Annotations.h"
+#include "TestFS.h"
 #include "TestIndex.h"
 #include "TestTU.h"
+#include "URI.h"
+#include "index/CachingIndex.h"
 #include "index/FileIndex.h"
+#include "index/FileRefs.h"
 #include "index/Index.h"
 #include "index/MemIndex.h"
 #include "index/Merge.h"
@@ -75,6 +79,84 @@ TEST(SymbolSlab, FindAndIterate) {
     EXPECT_THAT(*S.find(SymbolID(Sym)), Named(Sym));
 }
 
+TEST(SymbolSlab, FindMany) {
+  SymbolSlab::Builder B;
+  for (unsigned I = 0; I < 1000; ++I)
+    B.insert(symbol("S" + std::to_string(I)));
+  SymbolSlab S = std::move(B).build();
+  for (unsigned I = 0; I < 1000; ++I) {
+    std::string Name = "S" + std::to_string(I);
+    EXPECT_THAT(*S.find(SymbolID(Name)), Named(Name));
+    EXPECT_EQ(S.end(), S.find(SymbolID("T" + std::to_string(I))));
+  }
+}
+
+TEST(SymbolSlab, MoveInsertAndAdopt) {
+  auto Other = std::make_shared<SymbolSlab>([] {
+    SymbolSlab::Builder B;
+    B.insert(symbol("X"));
+    return std::move(B).build();
+  }());
+  const Symbol &X = *Other->find(SymbolID("X"));
+
+  SymbolSlab::Builder B;
+  B.adopt(Other);
+  B.insertAdopted(X);
+  B.insert(symbol("Y"));
+  SymbolSlab S = std::move(B).build();
+  Other.reset();
+  EXPECT_THAT(S, UnorderedElementsAre(Named("X"), Named("Y")));
+  // The adopted slab is kept alive, and its strings are not copied.
+  EXPECT_EQ(S.find(SymbolID("X"))->Name.data(), X.Name.data());
+}
+
+TEST(SymbolSlab, AddReference) {
+  SymbolSlab::Builder B;
+  B.insert(symbol("X"));
+  const char *Name = B.find(SymbolID("X"))->Name.data();
+  B.addReference(SymbolID("X"));
+  B.addReference(SymbolID("X"));
+  B.addReference(SymbolID("Y"));
+  SymbolSlab S = std::move(B).build();
+  EXPECT_THAT(S, UnorderedElementsAre(Named("X")));
+  EXPECT_EQ(S.find(SymbolID("X"))->References, 2u);
+  // The symbol wasn't copied, so the arena isn't rebuilt.
+  EXPECT_EQ(S.find(SymbolID("X"))->Name.data(), Name);
+}
+
+TEST(SymbolSlab, SharedStrings) {
+  auto Pool = std::make_shared<SharedStringPool>();
+  auto Build = [&](llvm::StringRef QName) {
+    SymbolSlab::Builder B(Pool);
+    Symbol S = symbol(QName);
+    S.CanonicalDeclaration.FileURI = "unittest:///foo.h";
+    B.insert(S);
+    return std::move(B).build();
+  };
+  llvm::Optional<SymbolSlab> X = Build("ns::X");
+  llvm::Optional<SymbolSlab> Y = Build("ns::Y");
+  const Symbol &SX = *X->find(SymbolID("ns::X"));
+  const Symbol &SY = *Y->find(SymbolID("ns::Y"));
+  EXPECT_EQ(SX.Scope, "ns::");
+  EXPECT_EQ(SX.Scope.data(), SY.Scope.data());
+  EXPECT_EQ(SX.CanonicalDeclaration.FileURI, SY.CanonicalDeclaration.FileURI);
+  EXPECT_EQ(Pool->size(), 3u); // Scope, file URI and empty definition URI.
+
+  RefSlab::Builder RB(Pool);
+  Ref R;
+  R.Location.FileURI = "unittest:///foo.h";
+  RB.insert(SX.ID, R);
+  RefSlab Refs = std::move(RB).build();
+  EXPECT_EQ(Refs.begin()->second.front().Location.FileURI,
+            SX.CanonicalDeclaration.FileURI);
+  EXPECT_EQ(Pool->size(), 3u);
+
+  X.reset();
+  EXPECT_EQ(Pool->size(), 3u);
+  Y.reset();
+  EXPECT_EQ(Pool->size(), 1u);
+}
+
 TEST(SwapIndexTest, OldIndexRecycled) {
   auto Token = std::make_shared<int>();
   std::weak_ptr<int> WeakToken = Token;
@@ -86,6 +168,76 @@ TEST(SwapIndexTest, OldIndexRecycled) {
   EXPECT_TRUE(WeakToken.expired());       // So the token is too.
 }
 
+TEST(SwapIndexTest, Generation) {
+  SwapIndex S(llvm::make_unique<MemIndex>());
+  MemIndex Static;
+  MergedIndex Merged(&S, &Static);
+  EXPECT_EQ(Static.generation(), 0u);
+  EXPECT_EQ(S.generation(), 0u);
+
+  std::vector<uint64_t> Notified;
+  {
+    auto Sub = S.watch([&](uint64_t G) { Notified.push_back(G); });
+    S.reset(llvm::make_unique<MemIndex>());
+    S.reset(llvm::make_unique<MemIndex>());
+  }
+  S.reset(llvm::make_unique<MemIndex>()); // Not watched anymore.
+  EXPECT_THAT(Notified, ElementsAre(1u, 2u));
+  EXPECT_EQ(S.generation(), 3u);
+  EXPECT_EQ(Merged.generation(), 3u);
+}
+
+TEST(CachingIndexTest, ReusesResultsUntilGenerationChanges) {
+  class CountingIndex : public SwapIndex {
+  public:
+    using SwapIndex::SwapIndex;
+    bool fuzzyFind(const FuzzyFindRequest &Req,
+                   llvm::function_ref<void(const Symbol &)> CB) const override {
+      ++Requests;
+      return SwapIndex::fuzzyFind(Req, CB);
+    }
+    mutable int Requests = 0;
+  };
+  CountingIndex Base(
+      MemIndex::build(generateSymbols({"a1", "a2", "b1"}), RefSlab()));
+  CachingIndex Cached(&Base, 1 << 20);
+  FuzzyFindRequest Req;
+  Req.Query = "a";
+  Req.AnyScope = true;
+
+  EXPECT_THAT(match(Cached, Req), UnorderedElementsAre("a1", "a2"));
+  EXPECT_THAT(match(Cached, Req), UnorderedElementsAre("a1", "a2"));
+  EXPECT_EQ(Base.Requests, 1);
+  // Requests differing in any field are not shared.
+  Req.AnyScope = false;
+  Req.Scopes = {""};
+  EXPECT_THAT(match(Cached, Req), UnorderedElementsAre("a1", "a2"));
+  EXPECT_EQ(Base.Requests, 2);
+
+  // Batches only query the requests that missed.
+  FuzzyFindRequest Other;
+  Other.Query = "b";
+  Other.AnyScope = true;
+  std::vector<std::vector<std::string>> Results(2);
+  Cached.fuzzyFindBatch({Req, Other}, [&](size_t I, const Symbol &S) {
+    Results[I].push_back(S.Name);
+  });
+  EXPECT_THAT(Results[0], UnorderedElementsAre("a1", "a2"));
+  EXPECT_THAT(Results[1], ElementsAre("b1"));
+  EXPECT_THAT(match(Cached, Other), ElementsAre("b1"));
+  EXPECT_EQ(Base.Requests, 2);
+
+  Base.reset(MemIndex::build(generateSymbols({"a3"}), RefSlab()));
+  EXPECT_THAT(match(Cached, Req), ElementsAre("a3"));
+  EXPECT_EQ(Base.Requests, 3);
+
+  // Results larger than the budget are not cached.
+  CachingIndex Tiny(&Base, 1);
+  match(Tiny, Req);
+  match(Tiny, Req);
+  EXPECT_EQ(Base.Requests, 5);
+}
+
 TEST(MemIndexTest, MemIndexDeduplicate) {
   std::vector<Symbol> Symbols = {symbol("1"), symbol("2"), symbol("3"),
                                  symbol("2") /* duplicate */};
@@ -218,6 +370,48 @@ TEST(MemIndexTest, TemplateSpecialization) {
                    index::SymbolProperty::TemplatePartialSpecialization));
 }
 
+TEST(MemIndexTest, Relations) {
+  auto Symbols = generateSymbols({"Parent", "Child", "Other"});
+  SymbolID Parent("Parent"), Child("Child"), Other("Other");
+  RelationSlab::Builder Builder;
+  Builder.insert({Parent, index::SymbolRole::RelationBaseOf, Child});
+  Builder.insert({Child, index::SymbolRole::RelationBaseOf, Other});
+  auto I = MemIndex::build(std::move(Symbols), RefSlab(),
+                           std::move(Builder).build());
+
+  RelationsRequest Req;
+  Req.Subjects.insert(Parent);
+  Req.Predicate = index::SymbolRole::RelationBaseOf;
+  std::vector<std::string> Results;
+  I->relations(Req, [&](const SymbolID &Subject, const Symbol &Object) {
+    EXPECT_EQ(Subject, Parent);
+    Results.push_back(Object.Name);
+  });
+  EXPECT_THAT(Results, ElementsAre("Child"));
+}
+
+TEST(MergeIndexTest, Relations) {
+  SymbolID A("A"), B("B"), C("C");
+  RelationSlab::Builder Dyn, Static;
+  Dyn.insert({A, index::SymbolRole::RelationBaseOf, B});
+  Static.insert({A, index::SymbolRole::RelationBaseOf, B});
+  Static.insert({A, index::SymbolRole::RelationBaseOf, C});
+  auto I = MemIndex::build(generateSymbols({"A", "B"}), RefSlab(),
+                           std::move(Dyn).build()),
+       J = MemIndex::build(generateSymbols({"A", "B", "C"}), RefSlab(),
+                           std::move(Static).build());
+  RelationsRequest Req;
+  Req.Subjects.insert(A);
+  Req.Predicate = index::SymbolRole::RelationBaseOf;
+  std::vector<std::string> Results;
+  MergedIndex(I.get(), J.get())
+      .relations(Req, [&](const SymbolID &, const Symbol &Object) {
+        Results.push_back(Object.Name);
+      });
+  // B is related in both indexes, but only reported once.
+  EXPECT_THAT(Results, UnorderedElementsAre("B", "C"));
+}
+
 TEST(MergeIndexTest, Lookup) {
   auto I = MemIndex::build(generateSymbols({"ns::A", "ns::B"}), RefSlab()),
        J = MemIndex::build(generateSymbols({"ns::B", "ns::C"}), RefSlab());
@@ -240,6 +434,26 @@ TEST(MergeIndexTest, FuzzyFind) {
   Req.Scopes = {"ns::"};
   EXPECT_THAT(match(MergedIndex(I.get(), J.get()), Req),
               UnorderedElementsAre("ns::A", "ns::B", "ns::C"));
+  EXPECT_THAT(match(MergedIndex(I.get(), J.get(), /*Concurrent=*/true), Req),
+              UnorderedElementsAre("ns::A", "ns::B", "ns::C"));
+}
+
+TEST(MergeIndexTest, FuzzyFindBatch) {
+  auto I = MemIndex::build(generateSymbols({"ns::A", "ns::B", "other::A"}),
+                           RefSlab()),
+       J = MemIndex::build(generateSymbols({"ns::B", "ns::C"}), RefSlab());
+  MergedIndex M(I.get(), J.get());
+  std::vector<FuzzyFindRequest> Reqs(2);
+  Reqs[0].Scopes = {"ns::"};
+  Reqs[1].Scopes = {"other::"};
+  std::vector<std::vector<std::string>> Matches(Reqs.size());
+  std::vector<bool> More =
+      M.fuzzyFindBatch(Reqs, [&](size_t Req, const Symbol &S) {
+        Matches[Req].push_back((S.Scope + S.Name).str());
+      });
+  EXPECT_THAT(More, ElementsAre(false, false));
+  EXPECT_THAT(Matches[0], UnorderedElementsAre("ns::A", "ns::B", "ns::C"));
+  EXPECT_THAT(Matches[1], ElementsAre("other::A"));
 }
 
 TEST(MergeTest, Merge) {
@@ -269,6 +483,39 @@ TEST(MergeTest, Merge) {
             SymbolOrigin::Dynamic | SymbolOrigin::Static | SymbolOrigin::Merge);
 }
 
+TEST(MergeTest, MergeSlabs) {
+  // Enough symbols to be merged in several partitions.
+  const unsigned NumSymbols = 1 << 15;
+  SymbolSlab::Builder L, R;
+  for (unsigned I = 0; I < NumSymbols; ++I) {
+    std::string QName = "ns::S" + std::to_string(I);
+    Symbol S = symbol(QName);
+    S.References = 1;
+    L.insert(S);
+    if (I % 2 == 0) {
+      S.Documentation = "doc";
+      R.insert(S);
+    }
+  }
+  std::vector<std::shared_ptr<const SymbolSlab>> Slabs = {
+      std::make_shared<SymbolSlab>(std::move(L).build()),
+      std::make_shared<SymbolSlab>(std::move(R).build())};
+
+  for (unsigned Threads : {1, 4}) {
+    SymbolSlab Merged = mergeSlabs(Slabs, Threads);
+    ASSERT_EQ(Merged.size(), NumSymbols);
+    for (const Symbol &S : *Slabs[0]) {
+      auto M = Merged.find(S.ID);
+      ASSERT_NE(M, Merged.end());
+      bool Both = Slabs[1]->find(S.ID) != Slabs[1]->end();
+      EXPECT_EQ(M->References, Both ? 2u : 1u);
+      EXPECT_EQ(M->Documentation, Both ? "doc" : "");
+      // Strings are not copied.
+      EXPECT_EQ(M->Name.data(), S.Name.data());
+    }
+  }
+}
+
 TEST(MergeTest, PreferSymbolWithDefn) {
   Symbol L, R;
 
@@ -362,6 +609,31 @@ TEST(MergeIndexTest, Refs) {
                                        FileURI("unittest:///test2.cc"))))));
 }
 
+TEST(FileRefsTest, FilterReferencingFiles) {
+  SymbolID Foo("Foo"), Bar("Bar");
+  std::string HeaderURI = URI::createFile(testPath("a/foo.h")).toString();
+  std::string UserURI = URI::createFile(testPath("b/user.cc")).toString();
+  std::string OtherURI = URI::createFile(testPath("b/other.cc")).toString();
+  RefSlab::Builder Refs;
+  Ref R;
+  R.Kind = RefKind::Reference;
+  R.Location.FileURI = HeaderURI.c_str();
+  Refs.insert(Foo, R);
+  R.Location.FileURI = UserURI.c_str();
+  Refs.insert(Foo, R);
+  R.Location.FileURI = OtherURI.c_str();
+  Refs.insert(Bar, R);
+  auto I = MemIndex::build(SymbolSlab(), std::move(Refs).build());
+
+  std::vector<std::string> Files = {testPath("a/foo.cc"),
+                                    testPath("b/user.cc"),
+                                    testPath("b/other.cc"),
+                                    testPath("b/foo.cc")};
+  llvm::DenseSet<SymbolID> IDs = {Foo};
+  EXPECT_THAT(filterReferencingFiles(*I, IDs, Files),
+              ElementsAre(testPath("a/foo.cc"), testPath("b/user.cc")));
+}
+
 MATCHER_P2(IncludeHeaderWithRef, IncludeHeader, References, "") {
   return (arg.IncludeHeader == IncludeHeader) && (arg.References == References);
 }
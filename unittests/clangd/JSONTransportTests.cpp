@@ -6,7 +6,9 @@
 //
 //===----------------------------------------------------------------------===//
 #include "Protocol.h"
+#include "TestFS.h"
 #include "Transport.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <cstdio>
@@ -198,8 +200,90 @@ TEST_F(JSONTransportTest, EndOfFile) {
   EXPECT_EQ(trim(input_mirror()), trim(input()));
 }
 
+// Serialized payloads are spliced into the message as they are.
+TEST_F(JSONTransportTest, RawPayloads) {
+  auto T = transport("Content-Length: 36\r\n\r\n"
+                     R"({"jsonrpc": "2.0", "method": "exit"})",
+                     /*Pretty=*/false, JSONStreamStyle::Standard);
+  T->notifyRaw("foo", "[1,2]");
+  T->replyRaw(7, R"({"a":"b"})");
+  Echo E(*T);
+  auto Err = T->loop(E);
+  EXPECT_FALSE(bool(Err)) << toString(std::move(Err));
+
+  const char *WantOutput =
+      "Content-Length: 47\r\n\r\n"
+      R"({"jsonrpc":"2.0","method":"foo","params":[1,2]})"
+      "Content-Length: 43\r\n\r\n"
+      R"({"id":7,"jsonrpc":"2.0","result":{"a":"b"}})";
+  EXPECT_EQ(output(), WantOutput);
+}
+
 #endif
 
+template <typename T> std::string written(const T &V) {
+  std::string Result;
+  llvm::raw_string_ostream OS(Result);
+  writeJSON(OS, V);
+  return OS.str();
+}
+
+template <typename T> std::string formatted(const T &V) {
+  return llvm::formatv("{0}", llvm::json::Value(V));
+}
+
+TEST(WriteJSON, MatchesToJSON) {
+  Range R;
+  R.start.line = 1;
+  R.start.character = 2;
+  R.end.line = 3;
+  R.end.character = 4;
+  TextEdit Edit;
+  Edit.range = R;
+  Edit.newText = "x\n\"y\"";
+
+  CompletionList L;
+  L.isIncomplete = true;
+  L.items.emplace_back();
+  L.items.back().label = "plain";
+  L.items.emplace_back();
+  CompletionItem &Full = L.items.back();
+  Full.label = "f\tull";
+  Full.kind = CompletionItemKind::Function;
+  Full.detail = "int";
+  Full.documentation = "Does things.";
+  Full.sortText = "00001";
+  Full.filterText = "full";
+  Full.insertText = "full()";
+  Full.insertTextFormat = InsertTextFormat::Snippet;
+  Full.textEdit = Edit;
+  Full.additionalTextEdits = {Edit, Edit};
+  Full.deprecated = true;
+  EXPECT_EQ(written(L), formatted(L));
+  EXPECT_EQ(written(CompletionList()), formatted(CompletionList()));
+
+  std::vector<Location> Locations(2);
+  Locations[0].uri = URIForFile::canonicalize(testPath("foo.cc"), "");
+  Locations[1].uri = URIForFile::canonicalize(testPath("bar baz.h"), "");
+  Locations[1].range = R;
+  EXPECT_EQ(written(Locations), formatted(Locations));
+
+  PublishDiagnosticsParams P;
+  P.uri = Locations[1].uri;
+  P.diagnostics.emplace_back();
+  P.diagnostics.back().range = R;
+  P.diagnostics.back().severity = 2;
+  P.diagnostics.back().message = "unused variable 'x'";
+  P.diagnostics.back().category = "Semantic Issue";
+  CodeAction Fix;
+  Fix.title = "remove 'x'";
+  Fix.kind = CodeAction::QUICKFIX_KIND.str();
+  P.diagnostics.back().codeActions = std::vector<CodeAction>{Fix};
+  P.diagnostics.emplace_back();
+  P.diagnostics.back().message = "note";
+  EXPECT_EQ(written(P), formatted(P));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,43 @@
+//===-- MemoryTreeTests.cpp -------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "MemoryTree.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace clangd {
+namespace {
+
+TEST(MemoryTree, Totals) {
+  MemoryTree MT;
+  EXPECT_EQ(MT.total(), 0u);
+  MT.addUsage(1);
+  MT.child("a").addUsage(2);
+  MT.child("a").child("b").addUsage(3);
+  MT.child("c").addUsage(4);
+  MT.child("a").addUsage(5);
+  EXPECT_EQ(MT.self(), 1u);
+  EXPECT_EQ(MT.total(), 15u);
+  EXPECT_EQ(MT.child("a").self(), 7u);
+  EXPECT_EQ(MT.child("a").total(), 10u);
+}
+
+TEST(MemoryTree, ToJSON) {
+  MemoryTree MT;
+  MT.child("a").addUsage(2);
+  MT.child("a").child("b").addUsage(3);
+  llvm::json::Object B{{"_self", 3}, {"_total", 3}};
+  llvm::json::Object A{{"_self", 2}, {"_total", 5}, {"b", std::move(B)}};
+  llvm::json::Object Root{{"_self", 0}, {"_total", 5}, {"a", std::move(A)}};
+  EXPECT_EQ(toJSON(MT), llvm::json::Value(std::move(Root)));
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
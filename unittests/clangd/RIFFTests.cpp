@@ -32,6 +32,22 @@ TEST(RIFFTest, File) {
   EXPECT_EQ(*Parsed, File);
 }
 
+TEST(RIFFTest, PiecewiseChunks) {
+  std::string Serialized;
+  {
+    llvm::raw_string_ostream OS(Serialized);
+    riff::writeFile(OS, riff::fourCC("test"),
+                    {
+                        {riff::fourCC("even"), {"ab", "cd"}},
+                        {riff::fourCC("oddd"), {"abc", "", "de"}},
+                    });
+  }
+  EXPECT_EQ(Serialized, llvm::StringRef("RIFF\x1e\0\0\0test"
+                                        "even\x04\0\0\0abcd"
+                                        "oddd\x05\0\0\0abcde\0",
+                                        38));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -0,0 +1,62 @@
+//===-- ResourceUsageTests.cpp ----------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ResourceUsage.h"
+#include "Threading.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "gtest/gtest.h"
+#include <mutex>
+#include <thread>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+TEST(ResourceUsageTest, Allocations) {
+  ResourceUsage Before = threadResourceUsage();
+  countAllocation(10);
+  countAllocation(20);
+  ResourceUsage Used = threadResourceUsage() - Before;
+  EXPECT_EQ(Used.Allocations, 2u);
+  EXPECT_EQ(Used.AllocatedBytes, 30u);
+
+  // Counters are per thread.
+  std::thread([] { countAllocation(100); }).join();
+  EXPECT_EQ((threadResourceUsage() - Before).Allocations, 2u);
+}
+
+TEST(ResourceUsageTest, LockWait) {
+  bool WasEnabled = resourceAccountingEnabled();
+  auto Restore =
+      llvm::make_scope_exit([&] { enableResourceAccounting(WasEnabled); });
+  enableResourceAccounting();
+  std::mutex Mu;
+
+  ResourceUsage Before = threadResourceUsage();
+  lockAccounted(Mu, "test");
+  EXPECT_EQ((threadResourceUsage() - Before).LockWait.count(), 0);
+
+  std::unique_lock<std::mutex> Held(Mu);
+  Notification Locking;
+  ResourceUsage Used;
+  std::thread Waiter([&] {
+    ResourceUsage Start = threadResourceUsage();
+    Locking.notify();
+    lockAccounted(Mu, "test");
+    Used = threadResourceUsage() - Start;
+  });
+  Locking.wait();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  Held.unlock();
+  Waiter.join();
+  EXPECT_GT(Used.LockWait.count(), 0);
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
@@ -254,6 +254,45 @@ TEST(SelectionTest, Selected) {
   }
 }
 
+TEST(SelectionTest, TopLevelDeclsPruned) {
+  Annotations Test(R"cpp(
+    #define TWO_VARS(A, B) int A; int B;
+    int $a^a = 1;
+    struct S { int $field^field; } $s^s;
+    TWO_VARS($x^x, y)
+    void $foo^foo() { int $local^local = a; }
+    int $z^z;$end^
+  )cpp");
+  auto TU = TestTU::withCode(Test.code());
+  TU.HeaderCode = "int fromHeader;";
+  auto AST = TU.build();
+  std::vector<std::pair<unsigned, unsigned>> Selections = {
+      {0, Test.code().size()}};
+  for (const char *Point :
+       {"a", "field", "s", "x", "foo", "local", "z", "end"}) {
+    unsigned Offset =
+        cantFail(positionToOffset(Test.code(), Test.point(Point)));
+    Selections.push_back({Offset, Offset});
+  }
+  // Traversing the candidate top-level decls gives the same tree as the full
+  // traversal.
+  for (const auto &Sel : Selections) {
+    std::string Full, Pruned;
+    llvm::raw_string_ostream(Full)
+        << SelectionTree(AST.getASTContext(), Sel.first, Sel.second);
+    llvm::raw_string_ostream(Pruned)
+        << SelectionTree(AST, Sel.first, Sel.second);
+    EXPECT_EQ(Full, Pruned) << Sel.first << "-" << Sel.second;
+  }
+}
+
+TEST(SelectionTest, Cached) {
+  auto AST = TestTU::withCode("int x = 1 + 2;").build();
+  auto X = AST.getSelectionTree(4, 5);
+  EXPECT_EQ(X, AST.getSelectionTree(4, 5));
+  EXPECT_NE(X, AST.getSelectionTree(8, 9));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
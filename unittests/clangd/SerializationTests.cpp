@@ -6,8 +6,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "RIFF.h"
 #include "index/Index.h"
 #include "index/Serialization.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/ScopedPrinter.h"
 #include "gmock/gmock.h"
@@ -15,6 +19,7 @@
 
 using testing::_;
 using testing::AllOf;
+using testing::ElementsAre;
 using testing::Pair;
 using testing::UnorderedElementsAre;
 using testing::UnorderedElementsAreArray;
@@ -82,6 +87,11 @@ References:
       End:
         Line: 5
         Column: 8
+...
+--- !Relation
+Subject: 057557CEBF6E6B2D
+Predicate: 2048
+Object: 057557CEBF6E6B2E
 )";
 
 MATCHER_P(ID, I, "") { return arg.ID == cantFail(SymbolID::fromStr(I)); }
@@ -138,6 +148,13 @@ TEST(SerializationTest, YAMLConversions) {
   auto Ref1 = ParsedYAML->Refs->begin()->second.front();
   EXPECT_EQ(Ref1.Kind, RefKind::Reference);
   EXPECT_EQ(StringRef(Ref1.Location.FileURI), "file:///path/foo.cc");
+
+  ASSERT_TRUE(bool(ParsedYAML->Relations));
+  EXPECT_THAT(*ParsedYAML->Relations,
+              UnorderedElementsAre(
+                  Relation{cantFail(SymbolID::fromStr("057557CEBF6E6B2D")),
+                           index::SymbolRole::RelationBaseOf,
+                           cantFail(SymbolID::fromStr("057557CEBF6E6B2E"))}));
 }
 
 std::vector<std::string> YAMLFromSymbols(const SymbolSlab &Slab) {
@@ -152,6 +169,12 @@ std::vector<std::string> YAMLFromRefs(const RefSlab &Slab) {
     Result.push_back(toYAML(Sym));
   return Result;
 }
+std::vector<std::string> YAMLFromRelations(const RelationSlab &Slab) {
+  std::vector<std::string> Result;
+  for (const auto &Rel : Slab)
+    Result.push_back(toYAML(Rel));
+  return Result;
+}
 
 TEST(SerializationTest, BinaryConversions) {
   auto In = readIndexFile(YAML);
@@ -166,12 +189,118 @@ TEST(SerializationTest, BinaryConversions) {
   ASSERT_TRUE(bool(In2)) << In.takeError();
   ASSERT_TRUE(In2->Symbols);
   ASSERT_TRUE(In2->Refs);
+  ASSERT_TRUE(In2->Relations);
 
   // Assert the YAML serializations match, for nice comparisons and diffs.
   EXPECT_THAT(YAMLFromSymbols(*In2->Symbols),
               UnorderedElementsAreArray(YAMLFromSymbols(*In->Symbols)));
   EXPECT_THAT(YAMLFromRefs(*In2->Refs),
               UnorderedElementsAreArray(YAMLFromRefs(*In->Refs)));
+  EXPECT_THAT(YAMLFromRelations(*In2->Relations),
+              UnorderedElementsAreArray(YAMLFromRelations(*In->Relations)));
+}
+
+TEST(SerializationTest, UncompressedStrings) {
+  auto In = readIndexFile(YAML);
+  EXPECT_TRUE(bool(In)) << In.takeError();
+
+  IndexFileOut Out(*In);
+  Out.Format = IndexFileFormat::RIFF;
+  Out.CompressStrings = false;
+  std::string Serialized = llvm::to_string(Out);
+  // Strings are stored verbatim.
+  EXPECT_NE(Serialized.find("Foo doc"), std::string::npos);
+  // Strings only used by documentation and signatures are grouped after the
+  // ones that are searched, although they'd sort before them.
+  EXPECT_GT(Serialized.find("Foo doc"), Serialized.find("Foo1"));
+  EXPECT_GT(Serialized.find("-sig"), Serialized.find("clang::"));
+
+  auto In2 = readIndexFile(Serialized);
+  ASSERT_TRUE(bool(In2)) << In2.takeError();
+  ASSERT_TRUE(In2->Symbols);
+  ASSERT_TRUE(In2->Refs);
+  EXPECT_THAT(YAMLFromSymbols(*In2->Symbols),
+              UnorderedElementsAreArray(YAMLFromSymbols(*In->Symbols)));
+  EXPECT_THAT(YAMLFromRefs(*In2->Refs),
+              UnorderedElementsAreArray(YAMLFromRefs(*In->Refs)));
+}
+
+TEST(SerializationTest, LoadIndexInPlace) {
+  auto In = readIndexFile(YAML);
+  EXPECT_TRUE(bool(In)) << In.takeError();
+
+  IndexFileOut Out(*In);
+  Out.Format = IndexFileFormat::RIFF;
+  Out.CompressStrings = false;
+  int FD;
+  llvm::SmallString<128> IndexPath;
+  ASSERT_FALSE(
+      llvm::sys::fs::createTemporaryFile("clangd-index", "idx", FD, IndexPath));
+  llvm::FileRemover Cleanup(IndexPath);
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Out;
+  }
+
+  for (bool UseDex : {false, true}) {
+    auto Index = loadIndex(IndexPath, UseDex);
+    ASSERT_TRUE(Index);
+    SymbolID Foo1 = cantFail(SymbolID::fromStr("057557CEBF6E6B2D"));
+
+    LookupRequest Lookup;
+    Lookup.IDs = {Foo1};
+    std::vector<Symbol> Found;
+    Index->lookup(Lookup, [&](const Symbol &S) { Found.push_back(S); });
+    ASSERT_THAT(Found, UnorderedElementsAre(QName("clang::Foo1")));
+    EXPECT_EQ(Found.front().Documentation, "Foo doc");
+    EXPECT_EQ(llvm::StringRef(Found.front().CanonicalDeclaration.FileURI),
+              "file:///path/foo.h");
+
+    RefsRequest Refs;
+    Refs.IDs = {Foo1};
+    std::vector<std::string> RefFiles;
+    Index->refs(Refs, [&](const Ref &R) {
+      RefFiles.push_back(R.Location.FileURI);
+    });
+    EXPECT_THAT(RefFiles, UnorderedElementsAre("file:///path/foo.cc"));
+  }
+}
+
+TEST(SerializationTest, DexPostings) {
+  auto In = readIndexFile(YAML);
+  EXPECT_TRUE(bool(In)) << In.takeError();
+
+  dex::Postings Postings = dex::Dex(*In->Symbols, RefSlab()).postings();
+  IndexFileOut Out(*In);
+  Out.Format = IndexFileFormat::RIFF;
+  Out.Postings = &Postings;
+  std::string Serialized = llvm::to_string(Out);
+
+  auto In2 = readIndexFile(Serialized);
+  ASSERT_TRUE(bool(In2)) << In2.takeError();
+  ASSERT_TRUE(In2->Symbols);
+  ASSERT_TRUE(In2->Postings);
+  EXPECT_EQ(In2->Postings->SymbolOrder, Postings.SymbolOrder);
+  EXPECT_EQ(In2->Postings->Lists.size(), Postings.Lists.size());
+
+  auto Index = dex::Dex::build(std::move(*In2->Symbols), RefSlab(),
+                               std::move(*In2->Postings));
+  FuzzyFindRequest Req;
+  Req.Query = "Foo";
+  Req.AnyScope = true;
+  std::vector<std::string> Names;
+  Index->fuzzyFind(Req, [&](const Symbol &S) {
+    Names.push_back((S.Scope + S.Name).str());
+  });
+  EXPECT_THAT(Names, UnorderedElementsAre("clang::Foo1", "clang::Foo2"));
+  Req.Scopes = {"clang::"};
+  Req.AnyScope = false;
+  Req.Query = "Foo2";
+  Names.clear();
+  Index->fuzzyFind(Req, [&](const Symbol &S) {
+    Names.push_back((S.Scope + S.Name).str());
+  });
+  EXPECT_THAT(Names, UnorderedElementsAre("clang::Foo2"));
 }
 
 TEST(SerializationTest, SrcsTest) {
@@ -214,6 +343,100 @@ TEST(SerializationTest, SrcsTest) {
   }
 }
 
+TEST(SerializationTest, ParallelBlocks) {
+  // Enough symbols for several blocks of symbols, and enough documentation
+  // for several blocks of the compressed string table.
+  SymbolSlab::Builder Builder;
+  for (unsigned I = 0; I < 10000; ++I) {
+    Symbol Sym;
+    std::string Name = "Sym" + std::to_string(I);
+    Sym.ID = SymbolID(Name);
+    Sym.Name = Name;
+    std::string Doc = Name + std::string(200, 'x');
+    Sym.Documentation = Doc;
+    Builder.insert(Sym);
+  }
+  SymbolSlab Symbols = std::move(Builder).build();
+  IndexFileOut Out;
+  Out.Symbols = &Symbols;
+  Out.Format = IndexFileFormat::RIFF;
+  std::string Sequential = llvm::to_string(Out);
+  Out.Threads = 0;
+  std::string Parallel = llvm::to_string(Out);
+  EXPECT_EQ(Sequential, Parallel);
+
+  auto In = readIndexFile(Parallel);
+  ASSERT_TRUE(bool(In)) << In.takeError();
+  ASSERT_TRUE(In->Symbols);
+  EXPECT_THAT(YAMLFromSymbols(*In->Symbols),
+              UnorderedElementsAreArray(YAMLFromSymbols(Symbols)));
+}
+
+TEST(SerializationTest, CorruptStringBlock) {
+  // Enough documentation for several blocks of the compressed string table.
+  // Documentation is cold, so it's stored after the names and the file URIs.
+  SymbolSlab::Builder Builder;
+  for (unsigned I = 0; I < 10000; ++I) {
+    Symbol Sym;
+    std::string Name = "Sym" + std::to_string(I);
+    Sym.ID = SymbolID(Name);
+    Sym.Name = Name;
+    std::string Doc = Name + std::string(200, 'x');
+    Sym.Documentation = Doc;
+    Builder.insert(Sym);
+  }
+  SymbolSlab Symbols = std::move(Builder).build();
+  RefSlab::Builder RefsBuilder;
+  Ref R;
+  R.Kind = RefKind::Reference;
+  R.Location.FileURI = "file:///path/foo.cc";
+  RefsBuilder.insert(SymbolID("Sym0"), R);
+  RefSlab Refs = std::move(RefsBuilder).build();
+  IndexFileOut Out;
+  Out.Symbols = &Symbols;
+  Out.Refs = &Refs;
+  Out.Format = IndexFileFormat::RIFF;
+  std::string Serialized = llvm::to_string(Out);
+
+  // Flip a byte in the middle of the last block of the string table.
+  auto RIFF = riff::readFile(Serialized);
+  ASSERT_TRUE(bool(RIFF)) << RIFF.takeError();
+  size_t SymbolsID = 0, LastBlockMiddle = 0;
+  for (const auto &Chunk : RIFF->Chunks) {
+    size_t Offset = Chunk.Data.data() - Serialized.data();
+    if (Chunk.ID == riff::fourCC("symb"))
+      SymbolsID = Offset - 8;
+    if (Chunk.ID != riff::fourCC("stri"))
+      continue;
+    // UncompressedSize, NumBlocks, then 3 uint32 per block.
+    size_t NumBlocks = llvm::support::endian::read32le(Chunk.Data.data() + 4);
+    ASSERT_GT(NumBlocks, 1u);
+    size_t LastBlockSize = llvm::support::endian::read32le(
+        Chunk.Data.data() + 8 + 12 * NumBlocks - 4);
+    LastBlockMiddle = Offset + Chunk.Data.size() - LastBlockSize / 2;
+  }
+  ASSERT_NE(SymbolsID, 0u);
+  ASSERT_NE(LastBlockMiddle, 0u);
+  Serialized[LastBlockMiddle] ^= 0xff;
+
+  // Symbols read documentation from the corrupt block.
+  auto In = readIndexFile(Serialized);
+  EXPECT_FALSE(bool(In));
+  llvm::consumeError(In.takeError());
+
+  // Without the symbols, the corrupt block is never uncompressed.
+  Serialized[SymbolsID + 3] = 'X';
+  In = readIndexFile(Serialized);
+  ASSERT_TRUE(bool(In)) << In.takeError();
+  EXPECT_FALSE(In->Symbols);
+  ASSERT_TRUE(In->Refs);
+  std::vector<std::string> RefFiles;
+  for (const auto &SymRefs : *In->Refs)
+    for (const auto &Ref : SymRefs.second)
+      RefFiles.push_back(Ref.Location.FileURI);
+  EXPECT_THAT(RefFiles, ElementsAre("file:///path/foo.cc"));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -49,6 +49,9 @@ TEST(SourceCodeTests, lspLength) {
   EXPECT_EQ(lspLength("¥"), 1UL);
   // astral
   EXPECT_EQ(lspLength("😂"), 2UL);
+  // Long enough to check the ASCII prefix a word at a time.
+  EXPECT_EQ(lspLength("ascii and more ascii"), 20UL);
+  EXPECT_EQ(lspLength("ascii and more ¥ 😂 and ascii"), 29UL);
 
   WithContextValue UTF8(kCurrentOffsetEncoding, OffsetEncoding::UTF8);
   EXPECT_EQ(lspLength(""), 0UL);
@@ -264,6 +267,18 @@ TEST(SourceCodeTests, OffsetToPosition) {
   EXPECT_THAT(offsetToPosition(File, 30), Pos(2, 11)) << "out of bounds";
 }
 
+TEST(SourceCodeTests, OffsetToPositionWithLineStarts) {
+  auto LineStarts = computeLineStarts(File);
+  for (OffsetEncoding Enc : {OffsetEncoding::UTF8, OffsetEncoding::UTF16,
+                             OffsetEncoding::UTF32}) {
+    WithContextValue Encoding(kCurrentOffsetEncoding, Enc);
+    for (size_t Offset = 0; Offset <= sizeof(File); ++Offset)
+      EXPECT_EQ(offsetToPosition(File, LineStarts, Offset),
+                offsetToPosition(File, Offset))
+          << Enc << " offset " << Offset;
+  }
+}
+
 TEST(SourceCodeTests, IsRangeConsecutive) {
   EXPECT_TRUE(isRangeConsecutive(range({2, 2}, {2, 3}), range({2, 3}, {2, 4})));
   EXPECT_FALSE(
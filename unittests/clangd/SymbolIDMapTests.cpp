@@ -0,0 +1,93 @@
+//===-- SymbolIDMapTests.cpp ------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "index/SymbolIDMap.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+using testing::Pair;
+using testing::Pointee;
+
+// The ID whose bits are all zero, which the tables store out of line.
+SymbolID zeroID() { return SymbolID::fromRaw(std::string(8, '\0')); }
+
+TEST(SymbolIDMapTest, InsertAndFind) {
+  SymbolIDMap<int> M;
+  EXPECT_TRUE(M.empty());
+  EXPECT_EQ(nullptr, M.find(SymbolID("X")));
+  EXPECT_EQ(0, M.lookup(SymbolID("X")));
+
+  EXPECT_TRUE(M.try_emplace(SymbolID("X"), 1).second);
+  EXPECT_FALSE(M.try_emplace(SymbolID("X"), 2).second);
+  M[SymbolID("Y")] = 3;
+  EXPECT_EQ(2u, M.size());
+  EXPECT_THAT(M.find(SymbolID("X")), Pointee(1));
+  EXPECT_EQ(3, M.lookup(SymbolID("Y")));
+  EXPECT_EQ(0u, M.count(SymbolID("Z")));
+
+  M.clear();
+  EXPECT_TRUE(M.empty());
+  EXPECT_EQ(nullptr, M.find(SymbolID("X")));
+}
+
+TEST(SymbolIDMapTest, ZeroID) {
+  SymbolIDMap<int> M;
+  EXPECT_EQ(0u, M.count(zeroID()));
+  M[zeroID()] = 1;
+  EXPECT_EQ(1u, M.size());
+  EXPECT_THAT(M.find(zeroID()), Pointee(1));
+  // The value is kept when the map grows.
+  for (unsigned I = 0; I < 100; ++I)
+    M[SymbolID(std::to_string(I))] = I;
+  EXPECT_EQ(101u, M.size());
+  EXPECT_EQ(1, M.lookup(zeroID()));
+}
+
+TEST(SymbolIDMapTest, Grow) {
+  SymbolIDMap<std::pair<size_t, size_t>> M;
+  for (size_t I = 0; I < 10000; ++I)
+    M.try_emplace(SymbolID(std::to_string(I)), I, I + 1);
+  EXPECT_EQ(10000u, M.size());
+  for (size_t I = 0; I < 10000; ++I) {
+    EXPECT_THAT(M.find(SymbolID(std::to_string(I))), Pointee(Pair(I, I + 1)));
+    EXPECT_EQ(nullptr, M.find(SymbolID("x" + std::to_string(I))));
+  }
+}
+
+TEST(SymbolIDMapTest, Reserve) {
+  SymbolIDMap<int> M;
+  M.reserve(1000);
+  size_t Bytes = M.getMemorySize();
+  for (unsigned I = 0; I < 1000; ++I)
+    M[SymbolID(std::to_string(I))] = I;
+  EXPECT_EQ(Bytes, M.getMemorySize());
+}
+
+TEST(SymbolIDSetTest, InsertAndCount) {
+  SymbolIDSet S;
+  EXPECT_EQ(0u, S.count(SymbolID("X")));
+  EXPECT_TRUE(S.insert(SymbolID("X")));
+  EXPECT_FALSE(S.insert(SymbolID("X")));
+  EXPECT_TRUE(S.insert(zeroID()));
+  for (unsigned I = 0; I < 100; ++I)
+    S.insert(SymbolID(std::to_string(I)));
+  EXPECT_EQ(102u, S.size());
+  EXPECT_EQ(1u, S.count(SymbolID("X")));
+  EXPECT_EQ(1u, S.count(zeroID()));
+  EXPECT_EQ(1u, S.count(SymbolID("42")));
+  EXPECT_EQ(0u, S.count(SymbolID("Y")));
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
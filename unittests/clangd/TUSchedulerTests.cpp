@@ -15,6 +15,8 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
 #include <utility>
 
 namespace clang {
@@ -105,7 +107,8 @@ Key<llvm::unique_function<void(PathRef File, std::vector<Diag>)>>
 TEST_F(TUSchedulerTests, MissingFiles) {
   TUScheduler S(getDefaultAsyncThreadsCount(),
                 /*StorePreamblesInMemory=*/true, /*ASTCallbacks=*/nullptr,
-                /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+                DebouncePolicy::fixed(
+                    std::chrono::steady_clock::duration::zero()),
                 ASTRetentionPolicy());
 
   auto Added = testPath("added.cpp");
@@ -156,7 +159,7 @@ TEST_F(TUSchedulerTests, WantDiagnostics) {
     TUScheduler S(
         getDefaultAsyncThreadsCount(),
         /*StorePreamblesInMemory=*/true, captureDiags(),
-        /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+        DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
         ASTRetentionPolicy());
     auto Path = testPath("foo.cpp");
     updateWithDiags(S, Path, "", WantDiagnostics::Yes,
@@ -186,7 +189,7 @@ TEST_F(TUSchedulerTests, Debounce) {
   {
     TUScheduler S(getDefaultAsyncThreadsCount(),
                   /*StorePreamblesInMemory=*/true, captureDiags(),
-                  /*UpdateDebounce=*/std::chrono::seconds(1),
+                  DebouncePolicy::fixed(std::chrono::seconds(1)),
                   ASTRetentionPolicy());
     // FIXME: we could probably use timeouts lower than 1 second here.
     auto Path = testPath("foo.cpp");
@@ -207,6 +210,38 @@ TEST_F(TUSchedulerTests, Debounce) {
   EXPECT_EQ(2, CallbackCount);
 }
 
+TEST(DebouncePolicy, Compute) {
+  namespace c = std::chrono;
+  DebouncePolicy Policy;
+  Policy.Min = c::seconds(3);
+  Policy.Max = c::seconds(25);
+  Policy.RebuildRatio = 1.5;
+  Policy.TypingRatio = 2;
+  std::vector<DebouncePolicy::clock::duration> Empty;
+  auto Compute = [&](std::vector<DebouncePolicy::clock::duration> Rebuilds,
+                     std::vector<DebouncePolicy::clock::duration> Intervals) {
+    return c::duration_cast<c::duration<float, c::seconds::period>>(
+               Policy.compute(Rebuilds, Intervals))
+        .count();
+  };
+  // No history: max.
+  EXPECT_NEAR(25, Compute(Empty, Empty), 0.01);
+  // Typical: ratio of the median rebuild time.
+  EXPECT_NEAR(
+      12, Compute({c::seconds(1), c::seconds(8), c::seconds(20)}, Empty), 0.01);
+  // Clamped to the bounds.
+  EXPECT_NEAR(3, Compute({c::seconds(1)}, Empty), 0.01);
+  EXPECT_NEAR(25, Compute({c::seconds(30)}, Empty), 0.01);
+  // Typing faster than the file rebuilds: wait for a pause.
+  EXPECT_NEAR(16, Compute({c::seconds(10)}, {c::seconds(8)}), 0.01);
+  // Typing slower than the file rebuilds doesn't matter.
+  EXPECT_NEAR(3, Compute({c::seconds(1)}, {c::seconds(2)}), 0.01);
+
+  DebouncePolicy Fixed = DebouncePolicy::fixed(c::seconds(7));
+  EXPECT_EQ(c::seconds(7), Fixed.compute(Empty, Empty));
+  EXPECT_EQ(c::seconds(7), Fixed.compute({c::seconds(1)}, {c::seconds(1)}));
+}
+
 static std::vector<std::string> includes(const PreambleData *Preamble) {
   std::vector<std::string> Result;
   if (Preamble)
@@ -222,7 +257,7 @@ TEST_F(TUSchedulerTests, PreambleConsistency) {
     TUScheduler S(
         getDefaultAsyncThreadsCount(), /*StorePreamblesInMemory=*/true,
         /*ASTCallbacks=*/nullptr,
-        /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+        DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
         ASTRetentionPolicy());
     auto Path = testPath("foo.cpp");
     // Schedule two updates (A, B) and two preamble reads (stale, consistent).
@@ -279,7 +314,7 @@ TEST_F(TUSchedulerTests, Cancellation) {
     TUScheduler S(
         getDefaultAsyncThreadsCount(), /*StorePreamblesInMemory=*/true,
         /*ASTCallbacks=*/captureDiags(),
-        /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+        DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
         ASTRetentionPolicy());
     auto Path = testPath("foo.cpp");
     // Helper to schedule a named update and return a function to cancel it.
@@ -348,7 +383,7 @@ TEST_F(TUSchedulerTests, ManyUpdates) {
   {
     TUScheduler S(getDefaultAsyncThreadsCount(),
                   /*StorePreamblesInMemory=*/true, captureDiags(),
-                  /*UpdateDebounce=*/std::chrono::milliseconds(50),
+                  DebouncePolicy::fixed(std::chrono::milliseconds(50)),
                   ASTRetentionPolicy());
 
     std::vector<std::string> Files;
@@ -433,6 +468,35 @@ TEST_F(TUSchedulerTests, ManyUpdates) {
   EXPECT_EQ(TotalPreambleReads, FilesCount * UpdatesPerFile);
 }
 
+TEST_F(TUSchedulerTests, MoreFilesThanThreads) {
+  constexpr int FilesCount = 20;
+  std::mutex Mu;
+  llvm::StringMap<std::vector<std::string>> Reported; // GUARDED_BY(Mu)
+  {
+    TUScheduler S(
+        /*AsyncThreadsCount=*/2, /*StorePreamblesInMemory=*/true,
+        captureDiags(),
+        DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+        ASTRetentionPolicy());
+    for (int I = 0; I < FilesCount; ++I) {
+      auto Path = testPath("foo" + std::to_string(I) + ".cpp");
+      for (llvm::StringRef Version : {"int a;", "int b;"}) {
+        std::string Contents = Version;
+        updateWithDiags(S, Path, Contents, WantDiagnostics::Yes,
+                        [&, Path, Contents](std::vector<Diag>) {
+                          std::lock_guard<std::mutex> Lock(Mu);
+                          Reported[Path].push_back(Contents);
+                        });
+      }
+    }
+    ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  }
+  // Every file was built, and its updates ran in order.
+  EXPECT_EQ(FilesCount, static_cast<int>(Reported.size()));
+  for (const auto &File : Reported)
+    EXPECT_THAT(File.second, ElementsAre("int a;", "int b;")) << File.first();
+}
+
 TEST_F(TUSchedulerTests, EvictedAST) {
   std::atomic<int> BuiltASTCounter(0);
   ASTRetentionPolicy Policy;
@@ -440,7 +504,8 @@ TEST_F(TUSchedulerTests, EvictedAST) {
   TUScheduler S(
       /*AsyncThreadsCount=*/1, /*StorePreambleInMemory=*/true,
       /*ASTCallbacks=*/nullptr,
-      /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(), Policy);
+      DebouncePolicy::fixed(
+          std::chrono::steady_clock::duration::zero()), Policy);
 
   llvm::StringLiteral SourceContents = R"cpp(
     int* a;
@@ -486,11 +551,28 @@ TEST_F(TUSchedulerTests, EvictedAST) {
               UnorderedElementsAre(Foo, AnyOf(Bar, Baz)));
 }
 
+TEST_F(TUSchedulerTests, EvictedASTByBytes) {
+  ASTRetentionPolicy Policy;
+  Policy.MaxRetainedASTs = 10;
+  Policy.MaxRetainedASTBytes = 1;
+  TUScheduler S(
+      /*AsyncThreadsCount=*/1, /*StorePreambleInMemory=*/true,
+      /*ASTCallbacks=*/nullptr,
+      DebouncePolicy::fixed(
+          std::chrono::steady_clock::duration::zero()), Policy);
+
+  auto Foo = testPath("foo.cpp");
+  S.update(Foo, getInputs(Foo, "int x;"), WantDiagnostics::Yes);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  // Any AST is larger than the budget.
+  EXPECT_THAT(S.getFilesWithCachedAST(), ElementsAre());
+}
+
 TEST_F(TUSchedulerTests, EmptyPreamble) {
   TUScheduler S(
       /*AsyncThreadsCount=*/4, /*StorePreambleInMemory=*/true,
       /*ASTCallbacks=*/nullptr,
-      /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
       ASTRetentionPolicy());
 
   auto Foo = testPath("foo.cpp");
@@ -529,13 +611,89 @@ TEST_F(TUSchedulerTests, EmptyPreamble) {
       });
 }
 
+TEST_F(TUSchedulerTests, ReuseClosedPreamble) {
+  TUScheduler S(
+      /*AsyncThreadsCount=*/4, /*StorePreambleInMemory=*/true,
+      /*ASTCallbacks=*/nullptr,
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+      ASTRetentionPolicy());
+
+  auto Foo = testPath("foo.cpp");
+  auto Header = testPath("foo.h");
+  Files[Header] = "void foo();";
+  Timestamps[Header] = time_t(0);
+  auto Contents = R"cpp(
+    #include "foo.h"
+    int main() {}
+  )cpp";
+  auto GetPreamble = [&] {
+    const PreambleData *Result = nullptr;
+    S.runWithPreamble("getPreamble", Foo, TUScheduler::Consistent,
+                      [&](Expected<InputsAndPreamble> Preamble) {
+                        Result = cantFail(std::move(Preamble)).Preamble;
+                      });
+    EXPECT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+    return Result;
+  };
+
+  S.update(Foo, getInputs(Foo, Contents), WantDiagnostics::Auto);
+  const PreambleData *Built = GetPreamble();
+  ASSERT_NE(Built, nullptr);
+
+  // Reopening the file reuses the retained preamble.
+  S.remove(Foo);
+  S.update(Foo, getInputs(Foo, Contents), WantDiagnostics::Auto);
+  EXPECT_EQ(GetPreamble(), Built);
+}
+
+TEST_F(TUSchedulerTests, PrebuiltPreamble) {
+  std::atomic<int> PreambleBuilds(0);
+  class CountPreambles : public ParsingCallbacks {
+  public:
+    CountPreambles(std::atomic<int> &Count) : Count(Count) {}
+    void onPreambleAST(PathRef, ASTContext &, std::shared_ptr<Preprocessor>,
+                       const CanonicalIncludes &) override {
+      ++Count;
+    }
+
+  private:
+    std::atomic<int> &Count;
+  };
+  TUScheduler S(
+      /*AsyncThreadsCount=*/4, /*StorePreambleInMemory=*/true,
+      llvm::make_unique<CountPreambles>(PreambleBuilds),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+      ASTRetentionPolicy());
+
+  auto Foo = testPath("foo.cpp");
+  auto Header = testPath("foo.h");
+  Files[Header] = "void foo();";
+  Timestamps[Header] = time_t(0);
+  auto Contents = R"cpp(
+    #include "foo.h"
+    int main() {}
+  )cpp";
+  S.prebuildPreamble(Foo, getInputs(Foo, Contents));
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+
+  // Opening the file reuses the prebuilt preamble.
+  S.update(Foo, getInputs(Foo, Contents), WantDiagnostics::Auto);
+  S.runWithPreamble("getPreamble", Foo, TUScheduler::Consistent,
+                    [&](Expected<InputsAndPreamble> Preamble) {
+                      EXPECT_NE(cantFail(std::move(Preamble)).Preamble,
+                                nullptr);
+                    });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_EQ(PreambleBuilds, 0);
+}
+
 TEST_F(TUSchedulerTests, RunWaitsForPreamble) {
   // Testing strategy: we update the file and schedule a few preamble reads at
   // the same time. All reads should get the same non-null preamble.
   TUScheduler S(
       /*AsyncThreadsCount=*/4, /*StorePreambleInMemory=*/true,
       /*ASTCallbacks=*/nullptr,
-      /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
       ASTRetentionPolicy());
   auto Foo = testPath("foo.cpp");
   auto NonEmptyPreamble = R"cpp(
@@ -567,7 +725,7 @@ TEST_F(TUSchedulerTests, NoopOnEmptyChanges) {
   TUScheduler S(
       /*AsyncThreadsCount=*/getDefaultAsyncThreadsCount(),
       /*StorePreambleInMemory=*/true, captureDiags(),
-      /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
       ASTRetentionPolicy());
 
   auto Source = testPath("foo.cpp");
@@ -620,7 +778,7 @@ TEST_F(TUSchedulerTests, NoChangeDiags) {
   TUScheduler S(
       /*AsyncThreadsCount=*/getDefaultAsyncThreadsCount(),
       /*StorePreambleInMemory=*/true, captureDiags(),
-      /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
       ASTRetentionPolicy());
 
   auto FooCpp = testPath("foo.cpp");
@@ -651,10 +809,220 @@ TEST_F(TUSchedulerTests, NoChangeDiags) {
   ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
 }
 
+TEST_F(TUSchedulerTests, VisibleDiagsFirst) {
+  TUScheduler S(
+      /*AsyncThreadsCount=*/0,
+      /*StorePreambleInMemory=*/true, captureDiags(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+      ASTRetentionPolicy());
+  auto Foo = testPath("foo.cpp");
+  Annotations Code(R"cpp(
+    void hidden() { int x = [[undefined_hidden]]; }
+    $visible[[void visible() { int y = [[undefined_visible]]; }]]
+  )cpp");
+  S.update(Foo, getInputs(Foo, ""), WantDiagnostics::No);
+  S.setVisibleRange(Foo, Code.range("visible"));
+
+  std::vector<std::vector<Range>> Reported;
+  updateWithDiags(S, Foo, Code.code(), WantDiagnostics::Yes,
+                  [&](std::vector<Diag> Diags) {
+                    Reported.emplace_back();
+                    for (const auto &D : Diags)
+                      Reported.back().push_back(D.Range);
+                  });
+  // The visible diagnostics come first, then all of them.
+  EXPECT_THAT(Reported, ElementsAre(ElementsAre(Code.ranges()[1]),
+                                    ElementsAre(Code.ranges()[0],
+                                                Code.ranges()[1])));
+}
+
+TEST_F(TUSchedulerTests, VisibleDiagsFirstThenNoDiagsUpdate) {
+  TUScheduler S(
+      /*AsyncThreadsCount=*/getDefaultAsyncThreadsCount(),
+      /*StorePreambleInMemory=*/true, captureDiags(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+      ASTRetentionPolicy());
+  auto Foo = testPath("foo.cpp");
+  Annotations Code(R"cpp(
+    void hidden() { int x = [[undefined_hidden]]; }
+    $visible[[void visible() { int y = [[undefined_visible]]; }]]
+  )cpp");
+  S.update(Foo, getInputs(Foo, ""), WantDiagnostics::No);
+  S.setVisibleRange(Foo, Code.range("visible"));
+
+  // The update that doesn't want diagnostics is queued while the visible ones
+  // are reported. It doesn't report the rest, so the first update must.
+  Notification Queued;
+  std::mutex Mut;
+  std::vector<std::vector<Range>> Reported;
+  updateWithDiags(S, Foo, Code.code(), WantDiagnostics::Auto,
+                  [&](std::vector<Diag> Diags) {
+                    {
+                      std::lock_guard<std::mutex> Lock(Mut);
+                      Reported.emplace_back();
+                      for (const auto &D : Diags)
+                        Reported.back().push_back(D.Range);
+                    }
+                    Queued.wait();
+                  });
+  S.update(Foo, getInputs(Foo, Code.code()), WantDiagnostics::No);
+  Queued.notify();
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  std::lock_guard<std::mutex> Lock(Mut);
+  EXPECT_THAT(Reported, ElementsAre(ElementsAre(Code.ranges()[1]),
+                                    ElementsAre(Code.ranges()[0],
+                                                Code.ranges()[1])));
+}
+
+TEST_F(TUSchedulerTests, StalePreambleDiagsFirst) {
+  TUScheduler S(
+      /*AsyncThreadsCount=*/0,
+      /*StorePreambleInMemory=*/true, captureDiags(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+      ASTRetentionPolicy());
+  auto Foo = testPath("foo.cpp");
+  Files[testPath("a.h")] = "int a();";
+  Files[testPath("b.h")] = "int b();";
+  S.update(Foo, getInputs(Foo, "#include \"a.h\"\n"), WantDiagnostics::No);
+
+  Annotations Code(R"cpp(#include "a.h"
+#include "b.h"
+int x = [[b]]() + [[undefined]];
+)cpp");
+  std::vector<std::vector<Range>> Reported;
+  updateWithDiags(S, Foo, Code.code(), WantDiagnostics::Yes,
+                  [&](std::vector<Diag> Diags) {
+                    Reported.emplace_back();
+                    for (const auto &D : Diags)
+                      Reported.back().push_back(D.Range);
+                  });
+  // The AST built with the old preamble doesn't see b.h, the lines below the
+  // preamble are unchanged.
+  EXPECT_THAT(Reported,
+              ElementsAre(ElementsAre(Code.ranges()[0], Code.ranges()[1]),
+                          ElementsAre(Code.ranges()[1])));
+}
+
+TEST_F(TUSchedulerTests, StalePreambleReads) {
+  // The new preamble isn't built until the reads queued after the update are
+  // done, so they must run on the AST built with the old one.
+  class BlockPreamble : public ParsingCallbacks {
+  public:
+    void onPreambleAST(PathRef, ASTContext &, std::shared_ptr<Preprocessor>,
+                       const CanonicalIncludes &) override {
+      if (++Builds != 2)
+        return;
+      std::unique_lock<std::mutex> Lock(Mu);
+      EXPECT_TRUE(wait(Lock, ReadsDoneCV, timeoutSeconds(10),
+                       [&] { return ReadsDone == 2; }));
+    }
+
+    std::atomic<int> Builds{0};
+    std::mutex Mu;
+    std::condition_variable ReadsDoneCV;
+    int ReadsDone = 0; /* GUARDED_BY(Mu) */
+  };
+  auto Callbacks = llvm::make_unique<BlockPreamble>();
+  BlockPreamble &Block = *Callbacks;
+  TUScheduler S(
+      /*AsyncThreadsCount=*/4, /*StorePreambleInMemory=*/true,
+      std::move(Callbacks),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+      ASTRetentionPolicy());
+  auto Foo = testPath("foo.cpp");
+  Files[testPath("a.h")] = "int a();";
+  Files[testPath("b.h")] = "int b();";
+  S.update(Foo, getInputs(Foo, "#include \"a.h\"\n"), WantDiagnostics::No);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+
+  S.update(Foo,
+           getInputs(Foo, "#include \"a.h\"\n#include \"b.h\"\nint x = b();\n"),
+           WantDiagnostics::Yes);
+  std::atomic<int> Running(0);
+  std::vector<std::string> Contents;
+  for (int I = 0; I < 2; ++I)
+    S.runWithAST("StaleRead", Foo, [&](Expected<InputsAndAST> IA) {
+      EXPECT_EQ(++Running, 1) << "Stale reads run one at a time";
+      ASSERT_TRUE(bool(IA));
+      const SourceManager &SM = IA->AST.getSourceManager();
+      std::string Buffer = SM.getBufferData(SM.getMainFileID());
+      --Running;
+      std::lock_guard<std::mutex> Lock(Block.Mu);
+      Contents.push_back(std::move(Buffer));
+      ++Block.ReadsDone;
+      Block.ReadsDoneCV.notify_all();
+    });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_EQ(Block.Builds, 2);
+  // The old preamble, padded so that the lines below it don't move.
+  EXPECT_THAT(Contents, ElementsAre("#include \"a.h\"\n\nint x = b();\n",
+                                    "#include \"a.h\"\n\nint x = b();\n"));
+}
+
+TEST_F(TUSchedulerTests, ClangTidyDiagsLast) {
+  TUScheduler S(
+      /*AsyncThreadsCount=*/getDefaultAsyncThreadsCount(),
+      /*StorePreambleInMemory=*/true, captureDiags(),
+      DebouncePolicy::fixed(std::chrono::steady_clock::duration::zero()),
+      ASTRetentionPolicy());
+  auto Foo = testPath("foo.cpp");
+  auto Inputs = getInputs(Foo, R"cpp(
+    int x = sizeof(sizeof(int));
+    int y = undefined;
+  )cpp");
+  Inputs.Opts.ClangTidyOpts.Checks = "-*,bugprone-sizeof-expression";
+
+  std::mutex Mut;
+  std::vector<std::vector<Diag::Source>> Reported;
+  updateWithDiags(S, Foo, Inputs, WantDiagnostics::Yes,
+                  [&](std::vector<Diag> Diags) {
+                    std::lock_guard<std::mutex> Lock(Mut);
+                    Reported.emplace_back();
+                    for (const auto &D : Diags)
+                      Reported.back().push_back(D.S);
+                  });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  // The compiler diagnostics come first, then all of them.
+  std::lock_guard<std::mutex> Lock(Mut);
+  EXPECT_THAT(Reported,
+              ElementsAre(ElementsAre(Diag::Clang),
+                          UnorderedElementsAre(Diag::Clang, Diag::ClangTidy)));
+}
+
+TEST_F(TUSchedulerTests, CompileCommandOnWorkerThread) {
+  TUScheduler S(/*AsyncThreadsCount=*/1, /*StorePreambleInMemory=*/true,
+                /*ASTCallbacks=*/nullptr,
+                DebouncePolicy::fixed(
+                    std::chrono::steady_clock::duration::zero()),
+                ASTRetentionPolicy());
+  auto Foo = testPath("foo.cpp");
+  auto Inputs = getInputs(Foo, "int x;");
+  tooling::CompileCommand Cmd = Inputs.CompileCommand;
+  Cmd.CommandLine.push_back("-DFROM_WORKER");
+  Inputs.CompileCommand = tooling::CompileCommand();
+  Notification Ready;
+  Inputs.GetCompileCommand = [&] {
+    Ready.wait();
+    return Cmd;
+  };
+  // Scheduling doesn't wait for the command.
+  S.update(Foo, Inputs, WantDiagnostics::Yes);
+  std::vector<std::string> PreambleCommand;
+  S.runWithPreamble("Command", Foo, TUScheduler::Consistent,
+                    [&](llvm::Expected<InputsAndPreamble> IP) {
+                      ASSERT_TRUE(bool(IP));
+                      PreambleCommand = IP->Command.CommandLine;
+                    });
+  Ready.notify();
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_EQ(PreambleCommand, Cmd.CommandLine);
+}
+
 TEST_F(TUSchedulerTests, Run) {
   TUScheduler S(/*AsyncThreadsCount=*/getDefaultAsyncThreadsCount(),
                 /*StorePreambleInMemory=*/true, /*ASTCallbacks=*/nullptr,
-                /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+                DebouncePolicy::fixed(
+                    std::chrono::steady_clock::duration::zero()),
                 ASTRetentionPolicy());
   std::atomic<int> Counter(0);
   S.run("add 1", [&] { ++Counter; });
@@ -40,6 +40,9 @@ ParsedAST TestTU::build() const {
   Inputs.Index = ExternalIndex;
   if (Inputs.Index)
     Inputs.Opts.SuggestMissingIncludes = true;
+  Inputs.Opts.IncludeFixCache = IncludeFixCache;
+  if (DetailedDiagnosticsLimit)
+    Inputs.Opts.DetailedDiagnosticsLimit = *DetailedDiagnosticsLimit;
   auto PCHs = std::make_shared<PCHContainerOperations>();
   auto CI = buildCompilerInvocation(Inputs);
   assert(CI && "Failed to build compilation invocation.");
@@ -59,8 +62,9 @@ ParsedAST TestTU::build() const {
 
 SymbolSlab TestTU::headerSymbols() const {
   auto AST = build();
-  return indexHeaderSymbols(AST.getASTContext(), AST.getPreprocessorPtr(),
-                            AST.getCanonicalIncludes());
+  return std::get<0>(indexHeaderSymbols(AST.getASTContext(),
+                                       AST.getPreprocessorPtr(),
+                                       AST.getCanonicalIncludes()));
 }
 
 std::unique_ptr<SymbolIndex> TestTU::index() const {
@@ -51,6 +51,10 @@ struct TestTU {
   llvm::Optional<std::string> ClangTidyChecks;
   // Index to use when building AST.
   const SymbolIndex *ExternalIndex = nullptr;
+  // Index results shared with other builds, used with ExternalIndex.
+  IncludeFixerCache *IncludeFixCache = nullptr;
+  // If set, overrides ParseOptions::DetailedDiagnosticsLimit.
+  llvm::Optional<unsigned> DetailedDiagnosticsLimit;
 
   ParsedAST build() const;
   SymbolSlab headerSymbols() const;
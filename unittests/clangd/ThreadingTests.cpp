@@ -8,7 +8,12 @@
 
 #include "Threading.h"
 #include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace clang {
 namespace clangd {
@@ -60,5 +65,128 @@ TEST_F(ThreadingTest, TaskRunner) {
   std::lock_guard<std::mutex> Lock(Mutex);
   ASSERT_EQ(Counter, TasksCnt * IncrementsPerTask);
 }
+
+TEST_F(ThreadingTest, TaskRunnerStartsTasksRightAway) {
+  // Each task waits for all of them to start, so none can wait for a worker
+  // to be free.
+  const int TasksCnt = 20;
+  std::mutex Mutex;
+  std::condition_variable AllStarted;
+  int Started = 0; /* GUARDED_BY(Mutex) */
+  std::atomic<int> TimedOut(0);
+  {
+    AsyncTaskRunner Tasks;
+    for (int TaskI = 0; TaskI < TasksCnt; ++TaskI)
+      Tasks.runAsync("task", [&] {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        if (++Started == TasksCnt)
+          AllStarted.notify_all();
+        if (!wait(Lock, AllStarted, timeoutSeconds(10),
+                  [&] { return Started == TasksCnt; }))
+          ++TimedOut;
+      });
+  }
+  EXPECT_EQ(TimedOut, 0);
+}
+
+TEST_F(ThreadingTest, TaskRunnerReusesThreads) {
+  // Tasks that ran before on the same thread.
+  static thread_local int TasksOnThread = 0;
+  std::atomic<int> Reused(0);
+  AsyncTaskRunner Tasks;
+  for (int TaskI = 0; TaskI < 20; ++TaskI) {
+    Tasks.runAsync("task", [&] {
+      if (TasksOnThread++)
+        ++Reused;
+    });
+    ASSERT_TRUE(Tasks.wait(timeoutSeconds(10)));
+    // Let the worker get back to waiting for a task.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_GT(Reused, 0);
+}
+
+TEST_F(ThreadingTest, SemaphoreIdleSlots) {
+  Semaphore S(1);
+  // Idle users hold a slot like foreground users.
+  S.lockIdle();
+  EXPECT_FALSE(S.try_lock());
+  S.unlockIdle();
+  EXPECT_TRUE(S.try_lock());
+
+  // They don't get a slot while a foreground user waits for one.
+  std::atomic<int> Acquired(0), ForegroundOrder(0), BackgroundOrder(0);
+  std::thread Foreground([&] {
+    S.lock();
+    ForegroundOrder = ++Acquired;
+    S.unlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::thread Background([&] {
+    S.lockIdle();
+    BackgroundOrder = ++Acquired;
+    S.unlockIdle();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(Acquired, 0);
+  S.unlock();
+  Foreground.join();
+  Background.join();
+  EXPECT_EQ(ForegroundOrder, 1);
+  EXPECT_EQ(BackgroundOrder, 2);
+}
+
+TEST_F(ThreadingTest, TaskPoolPriorities) {
+  std::mutex Mutex;
+  std::vector<int> Order; /* GUARDED_BY(Mutex) */
+  auto Record = [&](int I) {
+    return [&, I] {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Order.push_back(I);
+    };
+  };
+  Notification Start;
+  {
+    TaskPool Pool(1);
+    // Keep the only worker busy until all tasks are queued.
+    Pool.enqueue([&] { Start.wait(); }, ThreadPriority::Normal);
+    Pool.enqueue(Record(1), ThreadPriority::Low);
+    Pool.enqueue(Record(2), ThreadPriority::Normal);
+    Pool.enqueue(Record(3), ThreadPriority::Low);
+    Pool.enqueue(Record(4), ThreadPriority::Normal);
+    Start.notify();
+    ASSERT_TRUE(Pool.blockUntilIdle(timeoutSeconds(10)));
+  }
+  std::lock_guard<std::mutex> Lock(Mutex);
+  EXPECT_EQ(Order, (std::vector<int>{2, 4, 1, 3}));
+}
+
+TEST_F(ThreadingTest, TaskPoolBoost) {
+  std::mutex Mutex;
+  std::vector<int> Order; /* GUARDED_BY(Mutex) */
+  auto Record = [&](int I) {
+    return [&, I] {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Order.push_back(I);
+    };
+  };
+  Notification Start;
+  {
+    TaskPool Pool(1);
+    // Keep the only worker busy until all tasks are queued.
+    Pool.enqueue([&] { Start.wait(); }, ThreadPriority::Normal);
+    Pool.enqueue(Record(1), ThreadPriority::Low, "a");
+    Pool.enqueue(Record(2), ThreadPriority::Low, "b");
+    Pool.enqueue(Record(3), ThreadPriority::Low, "a");
+    Pool.enqueue(Record(4), ThreadPriority::Low, "b");
+    Pool.enqueue(Record(5), ThreadPriority::Normal, "a");
+    Pool.boost("b");
+    Start.notify();
+    ASSERT_TRUE(Pool.blockUntilIdle(timeoutSeconds(10)));
+  }
+  std::lock_guard<std::mutex> Lock(Mutex);
+  // Boosting doesn't overtake normal priority tasks.
+  EXPECT_EQ(Order, (std::vector<int>{5, 2, 4, 1, 3}));
+}
 } // namespace clangd
 } // namespace clang
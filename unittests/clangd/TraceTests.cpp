@@ -10,9 +10,11 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/YAMLParser.h"
+#include "llvm/Testing/Support/Error.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -122,6 +124,119 @@ TEST(TraceTest, SmokeTest) {
   ASSERT_EQ(++Prop, Root->end());
 }
 
+TEST(TraceTest, BinaryTracer) {
+  std::string Binary;
+  {
+    llvm::raw_string_ostream OS(Binary);
+    auto Tracer = trace::createBinaryTracer(OS);
+    trace::Session Session(*Tracer);
+    {
+      trace::Span Tracer("A");
+      trace::log("B");
+    }
+  }
+
+  std::string JSON;
+  llvm::raw_string_ostream OS(JSON);
+  ASSERT_FALSE(bool(trace::binaryTraceToJSON(Binary, OS)));
+  auto Root = llvm::json::parse(OS.str());
+  ASSERT_TRUE(bool(Root)) << llvm::toString(Root.takeError());
+  auto *Events = Root->getAsObject()->getArray("traceEvents");
+  ASSERT_NE(Events, nullptr);
+  std::vector<std::string> Phases;
+  for (const auto &E : *Events) {
+    auto *Event = E.getAsObject();
+    std::string Phase = Event->getString("ph")->str();
+    if (auto Name = Event->getString("name"))
+      Phase += " " + Name->str();
+    if (Phase == "M thread_name")
+      continue; // Depends on the platform.
+    Phases.push_back(Phase);
+  }
+  EXPECT_THAT(Phases,
+              testing::ElementsAre("M process_name", "B A", "i Log", "E"));
+
+  EXPECT_THAT_ERROR(trace::binaryTraceToJSON("garbage", OS), llvm::Failed());
+}
+
+class CountingTracer : public trace::EventTracer {
+public:
+  Context beginSpan(llvm::StringRef Name, llvm::json::Object *Args) override {
+    ++Spans;
+    return Context::current().clone();
+  }
+  void instant(llvm::StringRef Name, llvm::json::Object &&Args) override {
+    ++Instants;
+  }
+
+  int Spans = 0;
+  int Instants = 0;
+};
+
+TEST(TraceTest, SamplingTracer) {
+  CountingTracer Counter;
+  auto Sampler = trace::createSamplingTracer(Counter, 3);
+  trace::Session Session(*Sampler);
+  for (int I = 0; I < 6; ++I) {
+    trace::Span Request("Request");
+    trace::Span Nested("Nested");
+    trace::log("Message");
+  }
+  // Everything in requests 0 and 3.
+  EXPECT_EQ(Counter.Spans, 4);
+  EXPECT_EQ(Counter.Instants, 2);
+}
+
+TEST(TraceTest, MetricsTracer) {
+  constexpr trace::Metric Latency("latency", trace::Metric::Distribution,
+                                  "method");
+  constexpr trace::Metric Hits("hits", trace::Metric::Counter);
+  constexpr trace::Metric Size("size", trace::Metric::Value);
+  std::string Output;
+  {
+    llvm::raw_string_ostream OS(Output);
+    auto Tracer = trace::createMetricsTracer(OS, std::chrono::hours(1));
+    trace::Session Session(*Tracer);
+    for (int I = 1; I <= 100; ++I)
+      Latency.record(I, "hover");
+    Latency.record(5, "completion");
+    Hits.record(1);
+    Hits.record(2);
+    Size.record(10);
+    Size.record(20);
+  }
+
+  // Only the final snapshot, the period is too long for the others.
+  llvm::StringRef Line = llvm::StringRef(Output).rtrim();
+  ASSERT_EQ(Line.count('\n'), 0u);
+  auto Root = llvm::json::parse(Line);
+  ASSERT_TRUE(bool(Root)) << llvm::toString(Root.takeError());
+  llvm::StringMap<const llvm::json::Object *> Metrics;
+  for (const auto &M : *Root->getAsObject()->getArray("metrics")) {
+    auto *Metric = M.getAsObject();
+    std::string Key = Metric->getString("name")->str();
+    if (auto Method = Metric->getString("method"))
+      Key += ":" + Method->str();
+    Metrics[Key] = Metric;
+  }
+  ASSERT_EQ(Metrics.size(), 4u);
+  auto *Hover = Metrics.lookup("latency:hover");
+  ASSERT_NE(Hover, nullptr);
+  EXPECT_EQ(*Hover->getInteger("count"), 100);
+  EXPECT_EQ(*Hover->getNumber("mean"), 50.5);
+  EXPECT_EQ(*Hover->getNumber("min"), 1.0);
+  EXPECT_EQ(*Hover->getNumber("max"), 100.0);
+  // Percentiles are approximate: buckets are 19% wide.
+  EXPECT_NEAR(*Hover->getNumber("p50"), 50, 10);
+  EXPECT_NEAR(*Hover->getNumber("p99"), 99, 1);
+  ASSERT_NE(Metrics.lookup("latency:completion"), nullptr);
+  EXPECT_EQ(*Metrics.lookup("latency:completion")->getNumber("p50"), 5.0);
+  ASSERT_NE(Metrics.lookup("hits"), nullptr);
+  EXPECT_EQ(*Metrics.lookup("hits")->getNumber("total"), 3.0);
+  ASSERT_NE(Metrics.lookup("size"), nullptr);
+  EXPECT_EQ(*Metrics.lookup("size")->getNumber("value"), 20.0);
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
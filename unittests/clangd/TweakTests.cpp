@@ -23,6 +23,9 @@
 using llvm::Failed;
 using llvm::HasValue;
 using llvm::Succeeded;
+using testing::ElementsAre;
+using testing::IsEmpty;
+using testing::Pair;
 
 namespace clang {
 namespace clangd {
@@ -185,6 +188,35 @@ TEST(TweakTest, SwapIfBranches) {
   )cpp");
 }
 
+TEST(TweakTest, AvailableTweaks) {
+  Annotations Code(R"cpp(
+    void test() {
+      ^if (true) { return 100; } else { continue; }
+      ^return;
+    }
+  )cpp");
+  TestTU TU;
+  TU.Filename = "foo.cpp";
+  TU.Code = Code.code();
+  ParsedAST AST = TU.build();
+  unsigned If = cantFail(positionToOffset(Code.code(), Code.points()[0]));
+  unsigned Return = cantFail(positionToOffset(Code.code(), Code.points()[1]));
+
+  auto Swap = Pair("SwapIfBranches", "Swap if branches");
+  EXPECT_THAT(availableTweaks(Tweak::Selection(AST, If, If)),
+              ElementsAre(Swap));
+  ASSERT_TRUE(AST.cachedTweaks());
+  EXPECT_EQ(AST.cachedTweaks()->Range, std::make_pair(If, If));
+  // Served from the cache.
+  AST.cachedTweaks()->Tweaks.emplace_back("Fake", "Fake");
+  EXPECT_THAT(availableTweaks(Tweak::Selection(AST, If, If)),
+              ElementsAre(Swap, Pair("Fake", "Fake")));
+  // A different range prepares the tweaks again.
+  EXPECT_THAT(availableTweaks(Tweak::Selection(AST, Return, Return)),
+              IsEmpty());
+  EXPECT_EQ(AST.cachedTweaks()->Range, std::make_pair(Return, Return));
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -34,6 +34,7 @@ using testing::Field;
 using testing::IsEmpty;
 using testing::Matcher;
 using testing::Pointee;
+using testing::UnorderedElementsAre;
 using testing::UnorderedElementsAreArray;
 
 // GMock helpers for matching TypeHierarchyItem.
@@ -44,6 +45,11 @@ template <class... ParentMatchers>
 testing::Matcher<TypeHierarchyItem> Parents(ParentMatchers... ParentsM) {
   return Field(&TypeHierarchyItem::parents, HasValue(ElementsAre(ParentsM...)));
 }
+template <class... ChildMatchers>
+testing::Matcher<TypeHierarchyItem> Children(ChildMatchers... ChildrenM) {
+  return Field(&TypeHierarchyItem::children,
+               HasValue(UnorderedElementsAre(ChildrenM...)));
+}
 
 TEST(FindRecordTypeAt, TypeOrVariable) {
   Annotations Source(R"cpp(
@@ -457,6 +463,45 @@ TEST(TypeHierarchy, RecursiveHierarchy3) {
               AllOf(WithName("S"), WithKind(SymbolKind::Struct), Parents()));
 }
 
+TEST(TypeHierarchy, Children) {
+  Annotations Source(R"cpp(
+struct Par^ent {};
+struct $Child1Def[[Child1]] : Parent {};
+struct $Child2Def[[Child2]] : Parent {};
+struct $GrandchildDef[[Grandchild]] : Child1 {};
+)cpp");
+
+  TestTU TU = TestTU::withCode(Source.code());
+  auto AST = TU.build();
+  auto Index = TU.index();
+
+  llvm::Optional<TypeHierarchyItem> Result =
+      getTypeHierarchy(AST, Source.point(), /*ResolveLevels=*/2,
+                       TypeHierarchyDirection::Children, Index.get(),
+                       testPath(TU.Filename));
+  ASSERT_TRUE(bool(Result));
+  EXPECT_THAT(
+      *Result,
+      AllOf(WithName("Parent"),
+            Children(AllOf(WithName("Child1"), WithKind(SymbolKind::Struct),
+                           SelectionRangeIs(Source.range("Child1Def")),
+                           // Only two levels are resolved.
+                           Children(AllOf(
+                               WithName("Grandchild"),
+                               SelectionRangeIs(Source.range("GrandchildDef")),
+                               Field(&TypeHierarchyItem::children,
+                                     Eq(llvm::None))))),
+                     AllOf(WithName("Child2"),
+                           SelectionRangeIs(Source.range("Child2Def")),
+                           Children()))));
+
+  // Without an index, children are not resolved.
+  Result = getTypeHierarchy(AST, Source.point(), /*ResolveLevels=*/2,
+                            TypeHierarchyDirection::Children);
+  ASSERT_TRUE(bool(Result));
+  EXPECT_FALSE(Result->children);
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
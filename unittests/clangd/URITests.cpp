@@ -159,6 +159,27 @@ TEST(URITest, ResolvePath) {
   llvm::consumeError(Resolve.takeError());
 }
 
+TEST(URITest, ResolveString) {
+  auto Resolve = [](StringRef Uri, StringRef HintPath) -> std::string {
+    auto Path = URI::resolve(Uri, HintPath);
+    if (!Path) {
+      consumeError(Path.takeError());
+      return "<error>";
+    }
+    return *Path;
+  };
+  // Results are cached, calling twice gives the same answer.
+  EXPECT_EQ(Resolve("unittest:///a", testPath("x")), testPath("a"));
+  EXPECT_EQ(Resolve("unittest:///a", testPath("x")), testPath("a"));
+  // The cache is keyed by the hint path as well.
+  EXPECT_EQ(Resolve("unittest:///a", "/not/under/root"), "<error>");
+  EXPECT_EQ(Resolve("unittest:///a", "/not/under/root"), "<error>");
+  EXPECT_EQ(Resolve("no:/a/b/c", ""), "<error>");
+  EXPECT_EQ(Resolve("no:/a/b/c", ""), "<error>");
+  auto Path = testPath("x");
+  EXPECT_EQ(Resolve(URI::create(Path).toString(), ""), Path);
+}
+
 TEST(URITest, Platform) {
   auto Path = testPath("x");
   auto U = URI::create(Path, "file");